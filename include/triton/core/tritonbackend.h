@@ -94,7 +94,7 @@ struct TRITONBACKEND_Batcher;
 ///   }
 ///
 #define TRITONBACKEND_API_VERSION_MAJOR 1
-#define TRITONBACKEND_API_VERSION_MINOR 13
+#define TRITONBACKEND_API_VERSION_MINOR 22
 
 /// Get the TRITONBACKEND API version supported by Triton. This value
 /// can be compared against the TRITONBACKEND_API_VERSION_MAJOR and
@@ -119,8 +119,14 @@ TRITONBACKEND_DECLSPEC TRITONSERVER_Error* TRITONBACKEND_ApiVersion(
 ///     accessible filesystem. The backend can access these files
 ///     using an appropriate system API.
 ///
+///   TRITONBACKEND_ARTIFACT_STREAM: The model artifacts remain in
+///     the remote model repository and are not localized. The
+///     backend reads them with TRITONBACKEND_ModelRepositoryFileSize
+///     and TRITONBACKEND_ModelRepositoryReadRange.
+///
 typedef enum TRITONBACKEND_artifacttype_enum {
-  TRITONBACKEND_ARTIFACT_FILESYSTEM
+  TRITONBACKEND_ARTIFACT_FILESYSTEM,
+  TRITONBACKEND_ARTIFACT_STREAM
 } TRITONBACKEND_ArtifactType;
 
 
@@ -176,6 +182,40 @@ TRITONBACKEND_DECLSPEC TRITONSERVER_Error* TRITONBACKEND_MemoryManagerFree(
     TRITONBACKEND_MemoryManager* manager, void* buffer,
     const TRITONSERVER_MemoryType memory_type, const int64_t memory_type_id);
 
+/// Perform a batch of copies into memory of a single type using a
+/// memory manager. Copy 'i' moves 'byte_size[i]' bytes from 'src[i]'
+/// to 'dst[i]'. Copies whose destinations follow one another are
+/// performed together: host sources of a run copied to GPU memory are
+/// first gathered into a single pinned staging buffer and moved by a
+/// single DMA, and other sources that are adjacent in the same memory
+/// are merged into a single copy. When a staging buffer is used the
+/// call waits for all copies issued on 'cuda_stream' to complete
+/// before releasing it.
+///
+/// \param manager The memory manager.
+/// \param count The number of copies.
+/// \param src The source buffer of each copy.
+/// \param src_memory_type The memory type of each source buffer.
+/// \param src_memory_type_id The memory type ID of each source buffer.
+/// \param dst The destination buffer of each copy.
+/// \param byte_size The size of each copy, in bytes.
+/// \param dst_memory_type The memory type of all destination buffers.
+/// \param dst_memory_type_id The memory type ID of all destination
+/// buffers.
+/// \param cuda_stream The cudaStream_t to issue the copies on, or
+/// nullptr to use the default stream.
+/// \param cuda_used Returns true if a CUDA copy may still be pending
+/// on 'cuda_stream', in which case the caller must synchronize on the
+/// stream before using the destination buffers.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONBACKEND_DECLSPEC TRITONSERVER_Error*
+TRITONBACKEND_MemoryManagerCopyBatch(
+    TRITONBACKEND_MemoryManager* manager, const uint32_t count,
+    const void** src, const TRITONSERVER_MemoryType* src_memory_type,
+    const int64_t* src_memory_type_id, void** dst, const uint64_t* byte_size,
+    const TRITONSERVER_MemoryType dst_memory_type,
+    const int64_t dst_memory_type_id, void* cuda_stream, bool* cuda_used);
+
 ///
 /// TRITONBACKEND_Input
 ///
@@ -344,6 +384,38 @@ TRITONBACKEND_DECLSPEC TRITONSERVER_Error* TRITONBACKEND_OutputBuffer(
     const uint64_t buffer_byte_size, TRITONSERVER_MemoryType* memory_type,
     int64_t* memory_type_id);
 
+/// Get the buffers of the same output of a batch of responses together,
+/// so that a batched output tensor can be written into them without a
+/// scatter copy. Each buffer is owned by its output as if it was
+/// returned by TRITONBACKEND_OutputBuffer for that output.
+///
+/// If the response allocators of all outputs allow borrowed buffers
+/// and host memory is requested, the buffers are slices of a single
+/// region allocated by Triton. Otherwise each buffer is allocated by the
+/// response allocator of its output. In both cases 'batch_buffer'
+/// returns the start of the buffers if they follow one another in the
+/// requested memory, in which case the batched output can be written
+/// there directly, and nullptr otherwise.
+///
+/// \param outputs The outputs, one per response.
+/// \param output_count The number of outputs.
+/// \param byte_size The byte size of the buffer of each output.
+/// \param memory_type The memory type preferred for the buffers.
+/// \param memory_type_id The memory type id preferred for the buffers.
+/// \param buffers Returns the buffer of each output.
+/// \param buffer_memory_type Returns the memory type of each buffer.
+/// \param buffer_memory_type_id Returns the memory type id of each
+/// buffer.
+/// \param batch_buffer Returns the start of the contiguous buffers, or
+/// nullptr if the buffers are not contiguous.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONBACKEND_DECLSPEC TRITONSERVER_Error* TRITONBACKEND_OutputBufferBatch(
+    TRITONBACKEND_Output** outputs, const uint32_t output_count,
+    const uint64_t* byte_size, const TRITONSERVER_MemoryType memory_type,
+    const int64_t memory_type_id, void** buffers,
+    TRITONSERVER_MemoryType* buffer_memory_type,
+    int64_t* buffer_memory_type_id, void** batch_buffer);
+
 /// Get the buffer attributes associated with the given output buffer. The
 /// returned 'buffer_attributes' is owned by the output and so should not be
 /// modified or freed by the caller. The lifetime of the 'buffer_attributes'
@@ -407,6 +479,34 @@ TRITONBACKEND_RequestCorrelationIdString(
 TRITONBACKEND_DECLSPEC TRITONSERVER_Error* TRITONBACKEND_RequestFlags(
     TRITONBACKEND_Request* request, uint32_t* flags);
 
+/// Query whether the request has been cancelled by the client, see
+/// TRITONSERVER_InferenceRequestCancel. A backend performing a long
+/// running execution, for example generating a sequence of
+/// responses, may poll this to stop early. The backend must still
+/// send a final response and release the request as usual.
+///
+/// \param request The inference request.
+/// \param is_cancelled Returns true if the request has been
+/// cancelled, false otherwise.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONBACKEND_DECLSPEC TRITONSERVER_Error* TRITONBACKEND_RequestIsCancelled(
+    TRITONBACKEND_Request* request, bool* is_cancelled);
+
+/// Query whether the request was created by Triton to warm up the model
+/// instance, either from the 'model_warmup' samples of the model
+/// configuration or by the automatic warmup enabled with the
+/// "TRITON_AUTO_WARMUP" model parameter. A backend can use a warmup
+/// batch to perform the work it would otherwise do lazily for the shape
+/// of the batch, such as capturing a CUDA graph, so that the first
+/// inference requests with that shape don't pay for it.
+///
+/// \param request The inference request.
+/// \param is_warmup Returns true if the request is a warmup request,
+/// false otherwise.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONBACKEND_DECLSPEC TRITONSERVER_Error* TRITONBACKEND_RequestIsWarmup(
+    TRITONBACKEND_Request* request, bool* is_warmup);
+
 /// Get the number of parameters specified in the inference request.
 ///
 /// \param request The inference request.
@@ -492,6 +592,44 @@ TRITONBACKEND_DECLSPEC TRITONSERVER_Error* TRITONBACKEND_RequestInputByIndex(
     TRITONBACKEND_Request* request, const uint32_t index,
     TRITONBACKEND_Input** input);
 
+/// Get the data of an input of a batch of requests as a single
+/// contiguous buffer, the data of each request following the data of
+/// the previous request. If the data of all requests is already
+/// contiguous in the requested memory, that memory is returned as is
+/// and nothing is copied. Otherwise the data is gathered into
+/// 'buffer' in the same way as TRITONBACKEND_MemoryManagerCopyBatch
+/// gathers its copies.
+///
+/// 'buffer' may be nullptr to find out whether the data can be used in
+/// place. If it can't, success is returned with 'batch_buffer' set to
+/// nullptr and 'batch_byte_size' giving the byte size that 'buffer'
+/// must have. The returned buffer is valid until any of the requests is
+/// released or 'buffer' is freed.
+///
+/// \param requests The requests.
+/// \param request_count The number of requests.
+/// \param name The name of the input.
+/// \param buffer The buffer to gather the data into, or nullptr.
+/// \param buffer_byte_size The byte size of 'buffer'.
+/// \param memory_type The memory type of 'buffer', and the memory type
+/// preferred for the data of the requests.
+/// \param memory_type_id The memory type ID of 'buffer'.
+/// \param cuda_stream The cudaStream_t to issue the copies on, or
+/// nullptr to use the default stream.
+/// \param batch_buffer Returns the contiguous data of the batch.
+/// \param batch_byte_size Returns the byte size of the data of the
+/// batch.
+/// \param cuda_used Returns true if a CUDA copy may still be pending
+/// on 'cuda_stream', in which case the caller must synchronize on the
+/// stream before using 'batch_buffer'.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONBACKEND_DECLSPEC TRITONSERVER_Error* TRITONBACKEND_RequestsInputBatch(
+    TRITONBACKEND_Request** requests, const uint32_t request_count,
+    const char* name, void* buffer, const uint64_t buffer_byte_size,
+    const TRITONSERVER_MemoryType memory_type, const int64_t memory_type_id,
+    void* cuda_stream, const void** batch_buffer, uint64_t* batch_byte_size,
+    bool* cuda_used);
+
 /// Get the number of output tensors requested to be returned in the
 /// request.
 ///
@@ -965,6 +1103,13 @@ TRITONBACKEND_DECLSPEC TRITONSERVER_Error* TRITONBACKEND_ModelVersion(
 ///     owned by Triton, not the caller, and so should not be modified
 ///     or freed.
 ///
+///   TRITONBACKEND_ARTIFACT_STREAM: The model artifacts are read from
+///     the remote model repository. 'location' returns the path of
+///     the model in the repository, for example
+///     's3://bucket/models/model_name'. The model is streamed only if
+///     its configuration sets the "TRITON_STREAM_ARTIFACTS" parameter
+///     to "true" and its repository is not local.
+///
 /// \param model The model.
 /// \param artifact_type Returns the artifact type for the model.
 /// \param path Returns the location.
@@ -973,6 +1118,69 @@ TRITONBACKEND_DECLSPEC TRITONSERVER_Error* TRITONBACKEND_ModelRepository(
     TRITONBACKEND_Model* model, TRITONBACKEND_ArtifactType* artifact_type,
     const char** location);
 
+/// Get the size of a file of the model, for any artifact type.
+///
+/// \param model The model.
+/// \param path The path of the file, relative to the location returned
+/// by TRITONBACKEND_ModelRepository.
+/// \param byte_size Returns the size of the file, in bytes.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONBACKEND_DECLSPEC TRITONSERVER_Error*
+TRITONBACKEND_ModelRepositoryFileSize(
+    TRITONBACKEND_Model* model, const char* path, uint64_t* byte_size);
+
+/// Read a range of a file of the model, for any artifact type. For
+/// TRITONBACKEND_ARTIFACT_STREAM each call is a ranged read from the
+/// remote repository, so a backend can overlap loading the weights
+/// with reading them by reading large ranges sequentially or from
+/// several threads. The function may be called concurrently.
+///
+/// \param model The model.
+/// \param path The path of the file, relative to the location returned
+/// by TRITONBACKEND_ModelRepository.
+/// \param offset The offset of the range in the file.
+/// \param byte_size The size of the range. The call fails if the file
+/// ends before the range.
+/// \param buffer Returns the 'byte_size' bytes of the range.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONBACKEND_DECLSPEC TRITONSERVER_Error*
+TRITONBACKEND_ModelRepositoryReadRange(
+    TRITONBACKEND_Model* model, const char* path, const uint64_t offset,
+    const uint64_t byte_size, void* buffer);
+
+/// Map a file of the model read-only into memory. The mapping is
+/// shared by every instance and version of any model that maps a file
+/// with identical content, so a backend that uses the weights in place
+/// keeps a single copy of them in memory however many instances are
+/// loaded. The mapping stays valid until it is released with
+/// TRITONBACKEND_ModelRepositoryUnmapFile or the model is finalized.
+/// Not supported for TRITONBACKEND_ARTIFACT_STREAM.
+///
+/// \param model The model.
+/// \param path The path of the file, relative to the location returned
+/// by TRITONBACKEND_ModelRepository.
+/// \param huge_pages If true, advise the kernel to back the mapping
+/// with transparent huge pages where it supports it for files.
+/// \param base Returns the start of the mapping.
+/// \param byte_size Returns the size of the mapping, which is the size
+/// of the file.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONBACKEND_DECLSPEC TRITONSERVER_Error*
+TRITONBACKEND_ModelRepositoryMapFile(
+    TRITONBACKEND_Model* model, const char* path, const bool huge_pages,
+    const void** base, uint64_t* byte_size);
+
+/// Release a mapping returned by
+/// TRITONBACKEND_ModelRepositoryMapFile. The memory of the mapping
+/// must not be accessed afterwards.
+///
+/// \param model The model.
+/// \param base The start of the mapping.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONBACKEND_DECLSPEC TRITONSERVER_Error*
+TRITONBACKEND_ModelRepositoryUnmapFile(
+    TRITONBACKEND_Model* model, const void* base);
+
 /// Get the model configuration. The caller takes ownership of the
 /// message object and must call TRITONSERVER_MessageDelete to release
 /// the object. The configuration is available via this call even
@@ -1436,6 +1644,81 @@ TRITONBACKEND_ISPEC TRITONSERVER_Error* TRITONBACKEND_ModelInstanceExecute(
     TRITONBACKEND_ModelInstance* instance, TRITONBACKEND_Request** requests,
     const uint32_t request_count);
 
+/// Type for the function that a backend calls to signal that an
+/// execution started by TRITONBACKEND_ModelInstanceExecuteAsync is
+/// complete.
+///
+/// \param userp The 'complete_userp' value passed to
+/// TRITONBACKEND_ModelInstanceExecuteAsync.
+typedef void (*TRITONBACKEND_ExecuteCompleteFn_t)(void* userp);
+
+/// Start the execution of a batch of one or more requests on a model
+/// instance without waiting for it to complete. This function is
+/// optional, a backend is not required to implement it. If it is
+/// implemented Triton calls it instead of
+/// TRITONBACKEND_ModelInstanceExecute to execute the requests of
+/// inference payloads, so that a single backend thread can keep
+/// multiple batches in flight for an instance.
+/// TRITONBACKEND_ModelInstanceExecute is still required and is used
+/// for model warmup.
+///
+/// Triton will not perform multiple simultaneous calls to this
+/// function for a given model 'instance', but it may call it again for
+/// the same instance before the previous executions are complete. A
+/// backend that can't accept another batch may block in this function
+/// until it can.
+///
+/// The ownership of the request objects follows the rules of
+/// TRITONBACKEND_ModelInstanceExecute. If success is returned, the
+/// backend must call 'complete_fn' with 'complete_userp' exactly once
+/// when the execution no longer needs the instance, which may be
+/// before the responses are sent. Triton holds the resources of the
+/// execution, as given in the rate limiter configuration of the
+/// instance, until then. All outstanding executions must be completed
+/// before TRITONBACKEND_ModelInstanceFinalize returns. If an error is
+/// returned, 'complete_fn' must not be called.
+///
+/// \param instance The model instance.
+/// \param requests The requests.
+/// \param request_count The number of requests in the batch.
+/// \param complete_fn The function to call when the execution is
+/// complete.
+/// \param complete_userp The value to pass to 'complete_fn'.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONBACKEND_ISPEC TRITONSERVER_Error*
+TRITONBACKEND_ModelInstanceExecuteAsync(
+    TRITONBACKEND_ModelInstance* instance, TRITONBACKEND_Request** requests,
+    const uint32_t request_count, TRITONBACKEND_ExecuteCompleteFn_t complete_fn,
+    void* complete_userp);
+
+/// Prepare a batch of requests that will be executed next on a model
+/// instance. This function is optional, a backend is not required to
+/// implement it. It is only called for models that enable the
+/// pipelined backend thread with the "TRITON_BACKEND_THREAD_PIPELINE"
+/// model parameter, in which case Triton dequeues the next batch of
+/// an instance while its current batch executes and calls this
+/// function for it. The backend may start the transfer of the input
+/// data to the device here, so that it overlaps with the execution of
+/// the current batch. The same requests are then passed to
+/// TRITONBACKEND_ModelInstanceExecute.
+///
+/// This function may be called for an instance while
+/// TRITONBACKEND_ModelInstanceExecute is running for the same
+/// instance, but Triton will not perform multiple simultaneous calls
+/// to this function for a given instance. The ownership of the
+/// request objects remains with Triton, and the implicit state inputs
+/// of the requests are not available until the requests are executed.
+/// An error returned by this function is logged and otherwise
+/// ignored, the requests are still executed.
+///
+/// \param instance The model instance.
+/// \param requests The requests.
+/// \param request_count The number of requests in the batch.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONBACKEND_ISPEC TRITONSERVER_Error* TRITONBACKEND_ModelInstancePrefetch(
+    TRITONBACKEND_ModelInstance* instance, TRITONBACKEND_Request** requests,
+    const uint32_t request_count);
+
 /// Query the backend for different model attributes. This function is optional,
 /// a backend is not required to implement it. The backend is also not required
 /// to set all backend attribute listed. This function is called when
@@ -84,7 +84,7 @@ struct TRITONCACHE_Allocator;
 ///   }
 ///
 #define TRITONCACHE_API_VERSION_MAJOR 0
-#define TRITONCACHE_API_VERSION_MINOR 1
+#define TRITONCACHE_API_VERSION_MINOR 4
 
 /// Get the TRITONCACHE API version supported by Triton. This
 /// value can be compared against the
@@ -108,6 +108,29 @@ TRITONCACHE_DECLSPEC TRITONSERVER_Error* TRITONCACHE_ApiVersion(
 TRITONCACHE_DECLSPEC TRITONSERVER_Error* TRITONCACHE_CacheEntryBufferCount(
     TRITONCACHE_CacheEntry* entry, size_t* count);
 
+/// Get the total byte size of the buffers held by entry. Together with
+/// TRITONCACHE_CacheEntryComputeCost this lets a cache implementation
+/// make cost-aware admission and eviction decisions, for example
+/// evicting by cost per byte rather than by recency alone.
+///
+/// \param entry The CacheEntry object to query.
+/// \param byte_size Returns the sum of the byte sizes of all buffers
+/// in entry.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONCACHE_DECLSPEC TRITONSERVER_Error* TRITONCACHE_CacheEntryByteSize(
+    TRITONCACHE_CacheEntry* entry, size_t* byte_size);
+
+/// Get the estimated cost of recomputing the responses held by entry,
+/// in nanoseconds of model compute time. The value is a hint only and
+/// is 0 when Triton has no estimate, e.g. when statistics are disabled
+/// or the entry was promoted from another cache tier.
+///
+/// \param entry The CacheEntry object to query.
+/// \param compute_cost_ns Returns the estimated compute cost.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONCACHE_DECLSPEC TRITONSERVER_Error* TRITONCACHE_CacheEntryComputeCost(
+    TRITONCACHE_CacheEntry* entry, uint64_t* compute_cost_ns);
+
 /// Adds buffer to entry.
 ///
 /// NOTE: (DLIS-2673) Only buffers in CPU memory supported currently.
@@ -122,6 +145,40 @@ TRITONCACHE_DECLSPEC TRITONSERVER_Error* TRITONCACHE_CacheEntryAddBuffer(
     TRITONCACHE_CacheEntry* entry, void* base,
     TRITONSERVER_BufferAttributes* buffer_attributes);
 
+/// Type for the function that releases a buffer added to an entry with
+/// TRITONCACHE_CacheEntryAddSharedBuffer.
+///
+/// \param base The base address of the buffer being released.
+/// \param userp The user data pointer provided with the buffer.
+typedef void (*TRITONCACHE_BufferReleaseFn_t)(void* base, void* userp);
+
+/// Adds a buffer to entry that the cache keeps valid until 'release_fn'
+/// is called. On lookup this lets Triton hand the cached data to
+/// responses without copying it: responses reference the buffer until
+/// they are released, after which 'release_fn' is called exactly once,
+/// possibly from a different thread and after TRITONCACHE_CacheLookup
+/// has returned. The cache must not modify or free the buffer before
+/// then, so it should keep a reference count on the underlying storage
+/// if the entry can be evicted concurrently.
+///
+/// If Triton can't borrow the buffer for a given response it is copied
+/// as with TRITONCACHE_CacheEntryAddBuffer, and 'release_fn' is called
+/// once the entry is done with it.
+///
+/// NOTE: (DLIS-2673) Only buffers in CPU memory supported currently.
+///
+/// \param entry The CacheEntry object to add buffer to.
+/// \param base The base address of the buffer to add.
+/// \param buffer_attributes The buffer attributes associated with the buffer.
+/// \param release_fn The function to call when Triton no longer
+/// references the buffer.
+/// \param release_userp User data pointer passed to 'release_fn'.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONCACHE_DECLSPEC TRITONSERVER_Error* TRITONCACHE_CacheEntryAddSharedBuffer(
+    TRITONCACHE_CacheEntry* entry, void* base,
+    TRITONSERVER_BufferAttributes* buffer_attributes,
+    TRITONCACHE_BufferReleaseFn_t release_fn, void* release_userp);
+
 /// Gets the buffer at index from entry.
 ///
 /// The caller does not own the returned buffer and must not modify or delete
@@ -293,6 +350,38 @@ TRITONCACHE_ISPEC TRITONSERVER_Error* TRITONCACHE_CacheLookup(
     TRITONCACHE_Cache* cache, const char* key, TRITONCACHE_CacheEntry* entry,
     TRITONCACHE_Allocator* allocator);
 
+/// Retrieves the entries of multiple keys from the cache in a single
+/// call, so that a cache implementation can pipeline or batch the
+/// lookups, for example into a single round trip to a remote cache.
+///
+/// This function is optional. If the cache doesn't implement it Triton
+/// calls TRITONCACHE_CacheLookup once per key instead.
+///
+/// This API is implemented by the user-provided cache implementation,
+/// so specific details will be found within the cache implementation.
+///
+/// \param cache The object that is used to communicate with the cache
+///              implementation through a shared library.
+/// \param keys The keys to retrieve, an array of 'count' keys.
+/// \param entries The entries to be retrieved from the cache, an array of
+///                'count' entries where entries[i] is to be filled for
+///                keys[i].
+/// \param allocators The allocators used to copy cache data of each entry
+///                   into user provided buffers, an array of 'count'
+///                   allocators where allocators[i] is used for entries[i].
+/// \param errors Returns the result of the lookup of each key, an array of
+///               'count' errors that follows the same conventions as the
+///               return value of TRITONCACHE_CacheLookup. nullptr indicates
+///               a hit. The caller takes ownership of the returned errors.
+/// \param count The number of keys to retrieve.
+/// \return a TRITONSERVER_Error indicating failure of the call as a whole,
+///         in which case the content of 'errors' is ignored, or nullptr if
+///         'errors' holds the result of each lookup.
+TRITONCACHE_ISPEC TRITONSERVER_Error* TRITONCACHE_CacheBatchLookup(
+    TRITONCACHE_Cache* cache, const char** keys,
+    TRITONCACHE_CacheEntry** entries, TRITONCACHE_Allocator** allocators,
+    TRITONSERVER_Error** errors, size_t count);
+
 #ifdef __cplusplus
 }  // extern C
 #endif
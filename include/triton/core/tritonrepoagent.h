@@ -83,7 +83,7 @@ struct TRITONREPOAGENT_AgentModel;
 ///   }
 ///
 #define TRITONREPOAGENT_API_VERSION_MAJOR 0
-#define TRITONREPOAGENT_API_VERSION_MINOR 1
+#define TRITONREPOAGENT_API_VERSION_MINOR 2
 
 /// Get the TRITONREPOAGENT API version supported by Triton. This
 /// value can be compared against the
@@ -223,6 +223,44 @@ TRITONREPOAGENT_ModelRepositoryLocationRelease(
     TRITONREPOAGENT_Agent* agent, TRITONREPOAGENT_AgentModel* model,
     const char* location);
 
+/// Type for the function called by
+/// TRITONREPOAGENT_ModelRepositoryVisitFiles for each file of a
+/// location. The function may be called concurrently from multiple
+/// threads, for the same or for different files. Returning an error
+/// stops the visit of the remaining files.
+///
+/// \param agent The agent.
+/// \param model The model.
+/// \param path The full path of the file.
+/// \param userp The user-specified value passed to
+/// TRITONREPOAGENT_ModelRepositoryVisitFiles.
+/// \return a TRITONSERVER_Error indicating success or failure.
+typedef TRITONSERVER_Error* (*TRITONREPOAGENT_ModelFileVisitFn_t)(
+    TRITONREPOAGENT_Agent* agent, TRITONREPOAGENT_AgentModel* model,
+    const char* path, void* userp);
+
+/// Call 'visit_fn' for every file under a location of the model, such as
+/// the location returned by TRITONREPOAGENT_ModelRepositoryLocation or
+/// TRITONREPOAGENT_ModelRepositoryLocationAcquire. The calls run in
+/// parallel on a thread pool owned by Triton, and start while the
+/// location is still being listed, so an agent can verify or transform
+/// many files of a model at once. 'visit_fn' must not call this function.
+/// This function returns once all calls of 'visit_fn' completed.
+///
+/// \param agent The agent.
+/// \param model The model.
+/// \param location The directory to visit, or nullptr for the current
+/// location of the model.
+/// \param visit_fn The function to call for each file.
+/// \param userp User-specified value passed to 'visit_fn'.
+/// \return a TRITONSERVER_Error indicating success or failure, the first
+/// error returned by 'visit_fn' if any.
+TRITONREPOAGENT_DECLSPEC TRITONSERVER_Error*
+TRITONREPOAGENT_ModelRepositoryVisitFiles(
+    TRITONREPOAGENT_Agent* agent, TRITONREPOAGENT_AgentModel* model,
+    const char* location, TRITONREPOAGENT_ModelFileVisitFn_t visit_fn,
+    void* userp);
+
 /// Inform Triton that the specified repository location should be used for
 /// the model in place of the original model repository. This method can only be
 /// called when TRITONREPOAGENT_ModelAction is invoked with
@@ -56,8 +56,10 @@ struct TRITONSERVER_Error;
 struct TRITONSERVER_InferenceRequest;
 struct TRITONSERVER_InferenceResponse;
 struct TRITONSERVER_InferenceTrace;
+struct TRITONSERVER_InferenceTraceCollector;
 struct TRITONSERVER_Message;
 struct TRITONSERVER_Metrics;
+struct TRITONSERVER_ModelHandle;
 struct TRITONSERVER_Parameter;
 struct TRITONSERVER_ResponseAllocator;
 struct TRITONSERVER_Server;
@@ -91,7 +93,7 @@ struct TRITONSERVER_MetricFamily;
 ///   }
 ///
 #define TRITONSERVER_API_VERSION_MAJOR 1
-#define TRITONSERVER_API_VERSION_MINOR 23
+#define TRITONSERVER_API_VERSION_MINOR 45
 
 /// Get the TRITONBACKEND API version supported by the Triton shared
 /// library. This value can be compared against the
@@ -288,6 +290,19 @@ TRITONSERVER_DECLSPEC struct TRITONSERVER_Error* TRITONSERVER_LogMessage(
     TRITONSERVER_LogLevel level, const char* filename, const int line,
     const char* msg);
 
+/// Enable or disable the profiling ranges that mark each stage of the
+/// request lifecycle, from request normalization through scheduling,
+/// rate limiting and execution to response delivery. The ranges are
+/// emitted as NVTX ranges and as 'triton:range_begin' and
+/// 'triton:range_end' USDT probes when the library is built with NVTX
+/// or USDT support respectively, and are enabled by default. The
+/// setting applies to the whole process and takes effect immediately.
+///
+/// \param enabled True to emit the profiling ranges, false to not.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_DECLSPEC struct TRITONSERVER_Error* TRITONSERVER_ProfilingSetEnabled(
+    bool enabled);
+
 /// TRITONSERVER_Error
 ///
 /// Errors are reported by a TRITONSERVER_Error object. A NULL
@@ -574,6 +589,39 @@ TRITONSERVER_ResponseAllocatorSetQueryFunction(
     struct TRITONSERVER_ResponseAllocator* allocator,
     TRITONSERVER_ResponseAllocatorQueryFn_t query_fn);
 
+/// Allow responses using this allocator to borrow output buffers owned
+/// by Triton instead of always allocating them through alloc_fn. This
+/// is currently used to return response cache hits without copying the
+/// cached data, and for the batched outputs allocated by backends with
+/// TRITONBACKEND_OutputBufferBatch. A borrowed buffer is never passed to
+/// release_fn, the 'userp' returned for it by
+/// TRITONSERVER_InferenceResponseOutput is nullptr, and it is valid until
+/// the response is deleted. A borrowed buffer is in CPU or CPU pinned
+/// memory and has no alignment guarantee beyond that of a byte. Borrowing
+/// is disabled by default.
+///
+/// \param allocator The response allocator object.
+/// \param enable Whether output buffers may be borrowed.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_DECLSPEC struct TRITONSERVER_Error*
+TRITONSERVER_ResponseAllocatorSetBorrowBuffers(
+    struct TRITONSERVER_ResponseAllocator* allocator, bool enable);
+
+/// Declare that the query function of this allocator returns the same
+/// memory type and memory type ID for the same output name and caller
+/// preferred memory type and memory type ID, regardless of the byte
+/// size, for the whole lifetime of a request. Triton then calls
+/// query_fn once per output of a request and reuses the result, which
+/// avoids a query per response for decoupled models. Queries without
+/// a tensor name are never reused. The result is not stable by default.
+///
+/// \param allocator The response allocator object.
+/// \param stable Whether the query result is stable for a request.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_DECLSPEC struct TRITONSERVER_Error*
+TRITONSERVER_ResponseAllocatorSetQueryStable(
+    struct TRITONSERVER_ResponseAllocator* allocator, bool stable);
+
 /// Delete a response allocator.
 ///
 /// \param allocator The response allocator object.
@@ -696,7 +744,10 @@ typedef enum tritonserver_tracelevel_enum {
 TRITONSERVER_DECLSPEC const char* TRITONSERVER_InferenceTraceLevelString(
     TRITONSERVER_InferenceTraceLevel level);
 
-/// Trace activities
+/// Trace activities. TRITONSERVER_TRACE_COPY_PEER and
+/// TRITONSERVER_TRACE_COPY_STAGED are reported when a tensor of the
+/// request is copied between two GPUs, directly over a peer-to-peer
+/// link or staged through host memory respectively.
 typedef enum tritonserver_traceactivity_enum {
   TRITONSERVER_TRACE_REQUEST_START = 0,
   TRITONSERVER_TRACE_QUEUE_START = 1,
@@ -707,7 +758,9 @@ typedef enum tritonserver_traceactivity_enum {
   TRITONSERVER_TRACE_REQUEST_END = 6,
   TRITONSERVER_TRACE_TENSOR_QUEUE_INPUT = 7,
   TRITONSERVER_TRACE_TENSOR_BACKEND_INPUT = 8,
-  TRITONSERVER_TRACE_TENSOR_BACKEND_OUTPUT = 9
+  TRITONSERVER_TRACE_TENSOR_BACKEND_OUTPUT = 9,
+  TRITONSERVER_TRACE_COPY_PEER = 10,
+  TRITONSERVER_TRACE_COPY_STAGED = 11
 } TRITONSERVER_InferenceTraceActivity;
 
 /// Get the string representation of a trace activity. The returned
@@ -868,6 +921,113 @@ TRITONSERVER_InferenceTraceModelVersion(
 TRITONSERVER_DECLSPEC struct TRITONSERVER_Error* TRITONSERVER_InferenceTraceRequestId(
     struct TRITONSERVER_InferenceTrace* trace, const char** request_id);
 
+/// TRITONSERVER_InferenceTraceCollector
+///
+/// Object that collects the timeline activity of the traces created
+/// with it without calling into the user on the threads that report
+/// the activity. The activity records are kept in a ring buffer per
+/// reporting thread and delivered in batches from a background thread.
+///
+
+/// A timeline activity record of a collected trace. 'model_name' lives
+/// as long as the collector that delivers the record.
+typedef struct TRITONSERVER_InferenceTraceRecord {
+  uint64_t trace_id;
+  uint64_t parent_id;
+  uint64_t timestamp_ns;
+  TRITONSERVER_InferenceTraceActivity activity;
+  int64_t model_version;
+  const char* model_name;
+} TRITONSERVER_InferenceTraceRecord;
+
+/// Type for the trace collector batch callback function. This callback
+/// function is called from the background thread of the collector with
+/// the records collected since the last call, in the order they were
+/// reported by each thread. The records are only valid until the
+/// callback returns. The 'userp' data is the same as what is supplied
+/// in the call to TRITONSERVER_InferenceTraceCollectorNew.
+typedef void (*TRITONSERVER_InferenceTraceBatchFn_t)(
+    const TRITONSERVER_InferenceTraceRecord* records, size_t record_count,
+    void* userp);
+
+/// Create a new trace collector object. The caller takes ownership of
+/// the object and must call TRITONSERVER_InferenceTraceCollectorDelete
+/// to release it once all traces created with it are released.
+///
+/// \param collector Returns the new trace collector object.
+/// \param ring_capacity The number of records the ring buffer of each
+/// reporting thread holds. Records reported while the ring is full are
+/// dropped.
+/// \param flush_interval_ms The interval at which the records are
+/// delivered, in milliseconds.
+/// \param batch_fn The callback function the records are delivered to.
+/// \param userp User-provided pointer that is delivered to the batch
+/// callback function.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_DECLSPEC struct TRITONSERVER_Error*
+TRITONSERVER_InferenceTraceCollectorNew(
+    struct TRITONSERVER_InferenceTraceCollector** collector,
+    uint32_t ring_capacity, uint64_t flush_interval_ms,
+    TRITONSERVER_InferenceTraceBatchFn_t batch_fn, void* userp);
+
+/// Delete a trace collector object. The records that are not delivered
+/// yet are delivered before this returns.
+///
+/// \param collector The trace collector object.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_DECLSPEC struct TRITONSERVER_Error*
+TRITONSERVER_InferenceTraceCollectorDelete(
+    struct TRITONSERVER_InferenceTraceCollector* collector);
+
+/// Make a trace collector sample the traces by their outcome. The
+/// records of a trace are then held back until the trace is released
+/// and kept only if a response of the trace failed, the trace took at
+/// least 'latency_threshold_us' from its first to its last activity,
+/// or the trace is picked with probability 'sample_ratio'. Each trace,
+/// including the child traces, is sampled on its own. Must be called
+/// before any trace is created with the collector.
+///
+/// \param collector The trace collector object.
+/// \param latency_threshold_us The duration from which all traces are
+/// kept, in microseconds.
+/// \param sample_ratio The ratio of the other traces that are kept,
+/// between 0 and 1.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_DECLSPEC struct TRITONSERVER_Error*
+TRITONSERVER_InferenceTraceCollectorSetTailSampling(
+    struct TRITONSERVER_InferenceTraceCollector* collector,
+    uint64_t latency_threshold_us, double sample_ratio);
+
+/// Get the number of records a trace collector dropped because the
+/// ring buffer of the reporting thread was full.
+///
+/// \param collector The trace collector object.
+/// \param dropped_count Returns the number of dropped records.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_DECLSPEC struct TRITONSERVER_Error*
+TRITONSERVER_InferenceTraceCollectorDroppedCount(
+    struct TRITONSERVER_InferenceTraceCollector* collector,
+    uint64_t* dropped_count);
+
+/// Create a new inference trace object whose timeline activity, and
+/// the activity of the child traces it spawns, is recorded by
+/// 'collector'. Unlike the traces created by
+/// TRITONSERVER_InferenceTraceNew, the trace is deleted once all
+/// activity for it has completed and the caller must not delete it.
+/// Only TRITONSERVER_TRACE_LEVEL_TIMESTAMPS is supported.
+///
+/// \param trace Returns the new inference trace object.
+/// \param level The tracing level.
+/// \param parent_id The parent trace id for this trace. A value of 0
+/// indicates that there is not parent trace.
+/// \param collector The trace collector the activity is recorded by.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_DECLSPEC struct TRITONSERVER_Error*
+TRITONSERVER_InferenceTraceCollectedNew(
+    struct TRITONSERVER_InferenceTrace** trace,
+    TRITONSERVER_InferenceTraceLevel level, uint64_t parent_id,
+    struct TRITONSERVER_InferenceTraceCollector* collector);
+
 /// TRITONSERVER_InferenceRequest
 ///
 /// Object representing an inference request. The inference request
@@ -878,9 +1038,18 @@ TRITONSERVER_DECLSPEC struct TRITONSERVER_Error* TRITONSERVER_InferenceTraceRequ
 ///
 
 /// Inference request flags. The enum values must be power-of-2 values.
+///
+/// TRITONSERVER_REQUEST_FLAG_LATENCY_BREAKDOWN: Report the latency of
+/// the request in the parameters of each of its responses. The INT64
+/// "triton_queue_ns" parameter holds the time the request waited
+/// before its execution started, and the INT64 "triton_compute_ns"
+/// parameter holds the time from the start of the execution until
+/// the response was sent, both in nanoseconds. The parameters are not
+/// added to responses served from the response cache.
 typedef enum tritonserver_requestflag_enum {
   TRITONSERVER_REQUEST_FLAG_SEQUENCE_START = 1,
-  TRITONSERVER_REQUEST_FLAG_SEQUENCE_END = 2
+  TRITONSERVER_REQUEST_FLAG_SEQUENCE_END = 2,
+  TRITONSERVER_REQUEST_FLAG_LATENCY_BREAKDOWN = 4
 } TRITONSERVER_RequestFlag;
 
 /// Inference request release flags. The enum values must be
@@ -941,6 +1110,24 @@ typedef void (*TRITONSERVER_InferenceResponseCompleteFn_t)(
     struct TRITONSERVER_InferenceResponse* response, const uint32_t flags,
     void* userp);
 
+/// Type for callback function indicating that a batch of inference
+/// responses has completed. The callback function takes ownership of
+/// the 'response_count' TRITONSERVER_InferenceResponse objects in
+/// 'responses', which are in the order they were produced. The
+/// 'responses' array itself is owned by Triton and is only valid for
+/// the duration of the call. The 'userp' data is the data provided as
+/// 'response_userp' in the call to
+/// TRITONSERVER_InferenceRequestSetResponseBatchCallback.
+///
+/// 'flags' has the same meaning as for
+/// TRITONSERVER_InferenceResponseCompleteFn_t. When
+/// TRITONSERVER_RESPONSE_COMPLETE_FINAL is set no more responses will
+/// be delivered for the request, in which case 'response_count' may be
+/// 0.
+typedef void (*TRITONSERVER_InferenceResponseBatchCompleteFn_t)(
+    struct TRITONSERVER_InferenceResponse** responses,
+    const uint32_t response_count, const uint32_t flags, void* userp);
+
 /// Create a new inference request object.
 ///
 /// \param inference_request Returns the new request object.
@@ -955,6 +1142,46 @@ TRITONSERVER_DECLSPEC struct TRITONSERVER_Error* TRITONSERVER_InferenceRequestNe
     struct TRITONSERVER_Server* server, const char* model_name,
     const int64_t model_version);
 
+/// Create a new model handle object. The model name and version are
+/// resolved once when the handle is created and the handle holds a
+/// reference on the model, so the requests created from it with
+/// TRITONSERVER_InferenceRequestNewFromHandle skip the lookup in the
+/// model repository. While a handle exists the model stays loaded: an
+/// unload of the model does not complete until all its handles are
+/// deleted. The caller takes ownership of the handle and must call
+/// TRITONSERVER_ModelHandleDelete to release it.
+///
+/// \param model_handle Returns the new model handle object.
+/// \param server the inference server object.
+/// \param model_name The name of the model.
+/// \param model_version The version of the model. If -1 then the
+/// server will choose a version based on the model's policy.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_DECLSPEC struct TRITONSERVER_Error* TRITONSERVER_ModelHandleNew(
+    struct TRITONSERVER_ModelHandle** model_handle,
+    struct TRITONSERVER_Server* server, const char* model_name,
+    const int64_t model_version);
+
+/// Delete a model handle object. The requests created from the handle
+/// keep their own reference on the model and remain valid.
+///
+/// \param model_handle The model handle object.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_DECLSPEC struct TRITONSERVER_Error* TRITONSERVER_ModelHandleDelete(
+    struct TRITONSERVER_ModelHandle* model_handle);
+
+/// Create a new inference request object for the model of a model
+/// handle. This is equivalent to TRITONSERVER_InferenceRequestNew with
+/// the model name and version of the handle.
+///
+/// \param inference_request Returns the new request object.
+/// \param model_handle The model handle object.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_DECLSPEC struct TRITONSERVER_Error*
+TRITONSERVER_InferenceRequestNewFromHandle(
+    struct TRITONSERVER_InferenceRequest** inference_request,
+    struct TRITONSERVER_ModelHandle* model_handle);
+
 /// Delete an inference request object.
 ///
 /// \param inference_request The request object.
@@ -962,6 +1189,42 @@ TRITONSERVER_DECLSPEC struct TRITONSERVER_Error* TRITONSERVER_InferenceRequestNe
 TRITONSERVER_DECLSPEC struct TRITONSERVER_Error* TRITONSERVER_InferenceRequestDelete(
     struct TRITONSERVER_InferenceRequest* inference_request);
 
+/// Reset an inference request object so that it can be reused for
+/// another inference instead of being deleted and created again. The
+/// ID, flags, correlation ID, priority, timeout, parameters and the
+/// data of all inputs are cleared. The inputs are kept with their
+/// datatype and shape, and the requested outputs are kept, so that a
+/// request made of the same inputs is not normalized again. The
+/// release and response callbacks are cleared and must be set again
+/// before the request is used. The request must not be in use by the
+/// server, that is it must have been released or never been sent for
+/// inference.
+///
+/// \param inference_request The request object.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_DECLSPEC struct TRITONSERVER_Error* TRITONSERVER_InferenceRequestReset(
+    struct TRITONSERVER_InferenceRequest* inference_request);
+
+/// Cancel an inference request that has been sent for inference. If
+/// the request is still waiting in a scheduler queue it is removed
+/// without being executed and completes with an error response. If
+/// the request is already executing the backend is notified through
+/// TRITONBACKEND_RequestIsCancelled and may stop early. Cancellation
+/// is best-effort, a request that completes before the cancellation
+/// is observed is not affected. Cancelling an ensemble request also
+/// cancels its in-flight step requests, except for the steps that the
+/// ensemble scheduler has already batched together with the steps of
+/// other ensemble requests. The requests of a sequence batched model
+/// are never removed from the sequence, the backend must check
+/// TRITONBACKEND_RequestIsCancelled. The caller must make sure that
+/// the request has not yet been released, for example by
+/// synchronizing with the request release callback.
+///
+/// \param inference_request The request object.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_DECLSPEC struct TRITONSERVER_Error* TRITONSERVER_InferenceRequestCancel(
+    struct TRITONSERVER_InferenceRequest* inference_request);
+
 /// Get the ID for a request. The returned ID is owned by
 /// 'inference_request' and must not be modified or freed by the
 /// caller.
@@ -1217,6 +1480,28 @@ TRITONSERVER_InferenceRequestAppendInputDataWithHostPolicy(
     const void* base, size_t byte_size, TRITONSERVER_MemoryType memory_type,
     int64_t memory_type_id, const char* host_policy_name);
 
+/// Set whether the data of an input is replicated on demand for each
+/// host policy instead of being provided for each host policy with
+/// TRITONSERVER_InferenceRequestAppendInputDataWithHostPolicy. When
+/// enabled, the first time a model instance executing with a host
+/// policy reads the input, and no data was appended for that host
+/// policy, a copy of the input data is made in system memory local to
+/// the NUMA node of the host policy and is used for the rest of the
+/// lifetime of the data. Only input data in CPU memory is replicated.
+/// Replication is disabled by default.
+///
+/// \param inference_request The request object.
+/// \param name The name of the input.
+/// \param replicate True to replicate the input data per host policy,
+/// false to use the data appended with
+/// TRITONSERVER_InferenceRequestAppendInputData for host policies
+/// without data of their own.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_DECLSPEC struct TRITONSERVER_Error*
+TRITONSERVER_InferenceRequestSetInputHostPolicyReplication(
+    struct TRITONSERVER_InferenceRequest* inference_request, const char* name,
+    const bool replicate);
+
 /// Assign a buffer of data to an input. The buffer will be appended
 /// to any existing buffers for that input. The 'inference_request'
 /// object takes ownership of the buffer and so the caller should not
@@ -1234,6 +1519,49 @@ TRITONSERVER_InferenceRequestAppendInputDataWithBufferAttributes(
     struct TRITONSERVER_InferenceRequest* inference_request, const char* name,
     const void* base, struct TRITONSERVER_BufferAttributes* buffer_attributes);
 
+/// Assign a buffer of GPU memory exported by another process to an
+/// input. The buffer is the 'byte_size' bytes at 'byte_offset' within
+/// the allocation of the CUDA IPC memory handle 'cuda_ipc_handle', as
+/// returned by cudaIpcGetMemHandle. The buffer will be appended to any
+/// existing buffers for that input. Triton opens the handle on device
+/// 'memory_type_id' and caches the mapping, so requests referencing the
+/// same allocation reuse it instead of opening the handle again. The
+/// mapping is kept until 'inference_request' is deleted or the input is
+/// removed from 'inference_request', and the exporting process must not
+/// free or modify the allocation until then.
+///
+/// \param inference_request The request object.
+/// \param name The name of the input.
+/// \param cuda_ipc_handle The 64-byte CUDA IPC memory handle.
+/// \param byte_offset The offset of the input data within the allocation.
+/// \param byte_size The size, in bytes, of the input data.
+/// \param memory_type_id The id of the GPU to open the handle on.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_DECLSPEC struct TRITONSERVER_Error*
+TRITONSERVER_InferenceRequestAppendInputDataFromCudaIpcHandle(
+    struct TRITONSERVER_InferenceRequest* inference_request, const char* name,
+    const void* cuda_ipc_handle, size_t byte_offset, size_t byte_size,
+    int64_t memory_type_id);
+
+/// Assign the elements of a BYTES input given in offsets+data form to
+/// the input. Element 'i' is the (offsets[i + 1] - offsets[i]) bytes at
+/// 'data' + offsets[i], so 'offsets' holds 'element_count' + 1 entries.
+/// The elements are appended to any existing buffers for that input.
+/// Triton converts the elements into a buffer it owns, so 'data' and
+/// 'offsets' may be freed or modified as soon as the call returns.
+///
+/// \param inference_request The request object.
+/// \param name The name of the input.
+/// \param data The bytes of all elements, in host memory.
+/// \param offsets The offset of each element within 'data' followed by
+/// the offset of the end of the last element, in host memory.
+/// \param element_count The number of elements.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_DECLSPEC struct TRITONSERVER_Error*
+TRITONSERVER_InferenceRequestAppendInputDataFromBytesOffsets(
+    struct TRITONSERVER_InferenceRequest* inference_request, const char* name,
+    const char* data, const uint64_t* offsets, uint64_t element_count);
+
 /// Clear all input data from an input, releasing ownership of the
 /// buffer(s) that were appended to the input with
 /// TRITONSERVER_InferenceRequestAppendInputData or
@@ -1310,6 +1638,38 @@ TRITONSERVER_InferenceRequestSetResponseCallback(
     TRITONSERVER_InferenceResponseCompleteFn_t response_fn,
     void* response_userp);
 
+/// Set the allocator and a batched response callback for an inference
+/// request. This is an alternative to
+/// TRITONSERVER_InferenceRequestSetResponseCallback intended for
+/// decoupled models that produce many responses per request. The
+/// responses produced within 'batch_window_us' microseconds of the
+/// first undelivered one are delivered together by a single call to
+/// 'response_fn'. The final flag is delivered as soon as it is
+/// produced, together with any response still waiting. The request
+/// must be sent for inference after this call, as the state of the
+/// batching is released once the final flag is delivered.
+///
+/// \param inference_request The request object.
+/// \param response_allocator The TRITONSERVER_ResponseAllocator to use
+/// to allocate buffers to hold inference results.
+/// \param response_allocator_userp User-provided pointer that is
+/// delivered to the response allocator's start and allocation functions.
+/// \param response_fn The function called to deliver a batch of
+/// inference responses for this request.
+/// \param response_userp User-provided pointer that is delivered to
+/// the 'response_fn' callback.
+/// \param batch_window_us The time in microseconds that a response may
+/// wait for the following ones. If 0 each response is delivered as
+/// soon as it is produced.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_DECLSPEC struct TRITONSERVER_Error*
+TRITONSERVER_InferenceRequestSetResponseBatchCallback(
+    struct TRITONSERVER_InferenceRequest* inference_request,
+    struct TRITONSERVER_ResponseAllocator* response_allocator,
+    void* response_allocator_userp,
+    TRITONSERVER_InferenceResponseBatchCompleteFn_t response_fn,
+    void* response_userp, const uint64_t batch_window_us);
+
 /// Set a string parameter in the request.
 ///
 /// \param request The request.
@@ -1494,6 +1854,54 @@ TRITONSERVER_InferenceResponseOutputClassificationLabel(
     struct TRITONSERVER_InferenceResponse* inference_response, const uint32_t index,
     const size_t class_index, const char** label);
 
+/// Get the 'class_count' highest scoring classes of an output, the
+/// same classes a classification request for the output reports. The
+/// output must hold a numeric datatype other than FP16 and BF16, and
+/// an output in GPU memory is copied to the host for the selection.
+/// Classes are returned highest score first, and in class index order
+/// among equal scores. The caller does not own the returned arrays and
+/// must not modify or delete them. They remain valid until
+/// 'inference_response' is deleted or this function is called again
+/// for the same output.
+///
+/// \param inference_response The response object.
+/// \param index The index of the output tensor, must be 0 <= index <
+/// count, where 'count' is the value returned by
+/// TRITONSERVER_InferenceResponseOutputCount.
+/// \param class_count The number of classes to return.
+/// \param count Returns the number of classes returned, which is less
+/// than 'class_count' if the output has fewer elements.
+/// \param class_indices Returns the index of each class.
+/// \param scores Returns the score of each class.
+/// \param labels Returns the label of each class, or nullptr for a
+/// class with no label.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_DECLSPEC struct TRITONSERVER_Error*
+TRITONSERVER_InferenceResponseOutputClassificationTopK(
+    struct TRITONSERVER_InferenceResponse* inference_response, const uint32_t index,
+    const uint32_t class_count, uint32_t* count, const uint64_t** class_indices,
+    const double** scores, const char* const** labels);
+
+/// Get the elements of a BYTES output in offsets+data form. Element 'i'
+/// is the (offsets[i + 1] - offsets[i]) bytes at 'data' + offsets[i].
+/// An output in GPU memory is copied to the host for the conversion.
+/// The caller does not own the returned arrays and must not modify or
+/// delete them. They remain valid until 'inference_response' is
+/// deleted.
+///
+/// \param inference_response The response object.
+/// \param index The index of the output tensor, must be 0 <= index <
+/// count, where 'count' is the value returned by
+/// TRITONSERVER_InferenceResponseOutputCount.
+/// \param element_count Returns the number of elements.
+/// \param offsets Returns the 'element_count' + 1 element offsets.
+/// \param data Returns the bytes of all elements.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_DECLSPEC struct TRITONSERVER_Error*
+TRITONSERVER_InferenceResponseOutputBytesOffsets(
+    struct TRITONSERVER_InferenceResponse* inference_response, const uint32_t index,
+    uint64_t* element_count, const uint64_t** offsets, const char** data);
+
 /// TRITONSERVER_BufferAttributes
 ///
 /// API to create, modify, or retrieve attributes associated with a buffer.
@@ -1608,10 +2016,17 @@ typedef enum tritonserver_modelcontrolmode_enum {
   TRITONSERVER_MODEL_CONTROL_EXPLICIT
 } TRITONSERVER_ModelControlMode;
 
-/// Rate limit modes
+/// Rate limit modes. TRITONSERVER_RATE_LIMIT_GPU_TIME behaves as
+/// TRITONSERVER_RATE_LIMIT_EXEC_COUNT and additionally limits each
+/// model to the execution time budget set by the
+/// TRITON_RATE_LIMITER_GPU_TIME_BUDGET_US model parameter, in
+/// microseconds of execution per second. A model that has used its
+/// budget only executes when no other instance is executing on its
+/// device.
 typedef enum tritonserver_ratelimitmode_enum {
   TRITONSERVER_RATE_LIMIT_OFF,
-  TRITONSERVER_RATE_LIMIT_EXEC_COUNT
+  TRITONSERVER_RATE_LIMIT_EXEC_COUNT,
+  TRITONSERVER_RATE_LIMIT_GPU_TIME
 } TRITONSERVER_RateLimitMode;
 
 /// Create a new server options object. The caller takes ownership of
@@ -1748,6 +2163,20 @@ TRITONSERVER_DECLSPEC struct TRITONSERVER_Error*
 TRITONSERVER_ServerOptionsSetPinnedMemoryPoolByteSize(
     struct TRITONSERVER_ServerOptions* options, uint64_t size);
 
+/// Set the byte size up to which the pinned memory pool may grow in a
+/// server options. When the pool of a NUMA node is exhausted it grows
+/// by pinned segments allocated on demand on that node, and segments
+/// that stay unused are released again. The default of 0 keeps the
+/// pool at its pinned memory pool byte size. A value smaller than the
+/// pinned memory pool byte size is ignored.
+///
+/// \param options The server options object.
+/// \param size The maximum pinned memory pool byte size.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_DECLSPEC struct TRITONSERVER_Error*
+TRITONSERVER_ServerOptionsSetPinnedMemoryPoolMaxByteSize(
+    struct TRITONSERVER_ServerOptions* options, uint64_t size);
+
 /// Set the total CUDA memory byte size that the server can allocate
 /// on given GPU device in a server options. The pinned memory pool
 /// will be shared across Triton itself and the backends that use
@@ -1761,6 +2190,46 @@ TRITONSERVER_DECLSPEC struct TRITONSERVER_Error*
 TRITONSERVER_ServerOptionsSetCudaMemoryPoolByteSize(
     struct TRITONSERVER_ServerOptions* options, int gpu_device, uint64_t size);
 
+/// Set whether the CUDA memory pools are CUDA stream-ordered memory
+/// pools instead of fixed-size pools in a server options. A
+/// stream-ordered pool reserves the CUDA memory pool byte size of its
+/// device up front, doesn't serialize allocations from different
+/// threads and returns freed memory beyond its release threshold to
+/// the system. Default is false.
+///
+/// \param options The server options object.
+/// \param enable True to use stream-ordered CUDA memory pools.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_DECLSPEC struct TRITONSERVER_Error*
+TRITONSERVER_ServerOptionsSetCudaMemoryPoolAsync(
+    struct TRITONSERVER_ServerOptions* options, bool enable);
+
+/// Set the byte size of freed memory that the stream-ordered CUDA
+/// memory pool of the given GPU device keeps reserved instead of
+/// returning it to the system in a server options. Default is the CUDA
+/// memory pool byte size of the device. Only used with stream-ordered
+/// CUDA memory pools.
+///
+/// \param options The server options object.
+/// \param gpu_device The GPU device of the memory pool.
+/// \param size The release threshold in bytes.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_DECLSPEC struct TRITONSERVER_Error*
+TRITONSERVER_ServerOptionsSetCudaMemoryPoolReleaseThreshold(
+    struct TRITONSERVER_ServerOptions* options, int gpu_device, uint64_t size);
+
+/// Set whether the stream-ordered CUDA memory pools may grow beyond
+/// their CUDA memory pool byte size in a server options. Default is
+/// true. Only used with stream-ordered CUDA memory pools, the
+/// fixed-size pools never grow.
+///
+/// \param options The server options object.
+/// \param enable True to allow the memory pools to grow.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_DECLSPEC struct TRITONSERVER_Error*
+TRITONSERVER_ServerOptionsSetCudaMemoryPoolGrowth(
+    struct TRITONSERVER_ServerOptions* options, bool enable);
+
 /// Deprecated. See TRITONSERVER_ServerOptionsSetCacheConfig instead.
 ///
 /// Set the total response cache byte size that the server can allocate in CPU
@@ -1868,6 +2337,55 @@ TRITONSERVER_DECLSPEC struct TRITONSERVER_Error*
 TRITONSERVER_ServerOptionsSetModelLoadThreadCount(
     struct TRITONSERVER_ServerOptions* options, unsigned int thread_count);
 
+/// Enable loading models on demand in a server options. With explicit
+/// model control, creating an inference request or a model handle for
+/// a model that is not loaded loads the model first, and the call
+/// returns once the load completes. Default is false.
+///
+/// \param options The server options object.
+/// \param enable True to load models on demand, false otherwise.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_DECLSPEC struct TRITONSERVER_Error*
+TRITONSERVER_ServerOptionsSetModelLoadOnDemand(
+    struct TRITONSERVER_ServerOptions* options, bool enable);
+
+/// Set when the models loaded on demand are unloaded again in a server
+/// options. A model is unloaded once it has not received a request for
+/// 'idle_timeout_sec' seconds, and the least recently used models are
+/// unloaded while the expected memory usage of all models loaded on
+/// demand exceeds 'byte_size_budget'. The expected memory usage of a
+/// model is its TRITON_LOAD_GPU_MEMORY_MB model configuration parameter
+/// times its instance count, or else the size of its version directory
+/// in a local repository. Zero disables the respective limit, the
+/// default is zero for both.
+///
+/// \param options The server options object.
+/// \param idle_timeout_sec The idle timeout, in seconds.
+/// \param byte_size_budget The memory budget, in bytes.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_DECLSPEC struct TRITONSERVER_Error*
+TRITONSERVER_ServerOptionsSetModelIdleUnload(
+    struct TRITONSERVER_ServerOptions* options, uint64_t idle_timeout_sec,
+    uint64_t byte_size_budget);
+
+/// Set the budget for the total input byte size of the inference
+/// requests that the server has accepted and not yet released. A
+/// request whose inputs don't fit in the remaining budget is rejected
+/// by TRITONSERVER_ServerInferAsync with TRITONSERVER_ERROR_UNAVAILABLE
+/// instead of being queued. A model can also limit the input byte size
+/// of its own requests with the TRITON_MAX_QUEUED_INPUT_BYTES model
+/// configuration parameter. The requests that an ensemble issues for
+/// its steps are only charged to the budget of their model, the server
+/// budget already holds the inputs of the ensemble request. Zero
+/// disables the limit, the default is zero.
+///
+/// \param options The server options object.
+/// \param byte_size The budget, in bytes.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_DECLSPEC struct TRITONSERVER_Error*
+TRITONSERVER_ServerOptionsSetMaxQueuedInputByteSize(
+    struct TRITONSERVER_ServerOptions* options, uint64_t byte_size);
+
 /// Enable model namespacing to allow serving models with the same name if
 /// they are in different namespaces.
 ///
@@ -2131,6 +2649,34 @@ TRITONSERVER_ServerUnregisterModelRepository(
 TRITONSERVER_DECLSPEC struct TRITONSERVER_Error*
 TRITONSERVER_ServerPollModelRepository(struct TRITONSERVER_Server* server);
 
+/// Register a long-lived host buffer, such as a shared memory region,
+/// with the CUDA driver. Input data of TRITONSERVER_MEMORY_CPU within
+/// a registered buffer is passed to the backends as
+/// TRITONSERVER_MEMORY_CPU_PINNED, so copies to the device are made
+/// directly from the buffer. Registering a buffer that is already
+/// registered adds a reference that must be dropped by another
+/// unregister call.
+///
+/// \param server The inference server object.
+/// \param base The base address of the buffer.
+/// \param byte_size The byte size of the buffer.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_DECLSPEC struct TRITONSERVER_Error*
+TRITONSERVER_ServerRegisterHostMemory(
+    struct TRITONSERVER_Server* server, void* base, size_t byte_size);
+
+/// Unregister a host buffer registered with
+/// TRITONSERVER_ServerRegisterHostMemory. The buffer must not be used
+/// by any in-flight inference request once its last registration is
+/// dropped.
+///
+/// \param server The inference server object.
+/// \param base The base address of the buffer.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_DECLSPEC struct TRITONSERVER_Error*
+TRITONSERVER_ServerUnregisterHostMemory(
+    struct TRITONSERVER_Server* server, void* base);
+
 /// Is the server live?
 ///
 /// \param server The inference server object.
@@ -2383,6 +2929,35 @@ TRITONSERVER_DECLSPEC struct TRITONSERVER_Error* TRITONSERVER_ServerInferAsync(
     struct TRITONSERVER_InferenceRequest* inference_request,
     struct TRITONSERVER_InferenceTrace* trace);
 
+/// Perform inference for a batch of requests. This is equivalent to
+/// calling TRITONSERVER_ServerInferAsync for each request, but the
+/// requests for the same model are handed to the model's scheduler
+/// together, which lets the dynamic batcher enqueue them in a single
+/// critical section.
+///
+/// All requests are prepared before any is run. If the function
+/// returns an error then no request was run and the caller retains
+/// ownership of all 'inference_requests'. If the function returns
+/// success, then the caller releases ownership of all
+/// 'inference_requests' as with TRITONSERVER_ServerInferAsync. A
+/// request that can't be scheduled after that point receives an error
+/// response and is released via its 'request_release_fn' callback.
+///
+/// The function unconditionally takes ownership of all 'traces'.
+///
+/// \param server The inference server object.
+/// \param inference_requests The array of request objects.
+/// \param request_count The number of requests.
+/// \param traces The array of 'request_count' trace objects, which may
+/// contain nullptr for the requests that are not traced, or nullptr if
+/// no request is traced.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_DECLSPEC struct TRITONSERVER_Error*
+TRITONSERVER_ServerInferAsyncBatch(
+    struct TRITONSERVER_Server* server,
+    struct TRITONSERVER_InferenceRequest** inference_requests,
+    const uint32_t request_count, struct TRITONSERVER_InferenceTrace** traces);
+
 /// TRITONSERVER_MetricKind
 ///
 /// Types of metrics recognized by TRITONSERVER.
@@ -0,0 +1,162 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "artifact_mapper.h"
+
+#include <cstring>
+#include <iterator>
+#include <vector>
+#include "constants.h"
+#include "stream_hash.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#endif  // !_WIN32
+
+namespace triton { namespace core {
+
+ArtifactMapper::Mapping::~Mapping()
+{
+#ifndef _WIN32
+  munmap(base_, byte_size_);
+#endif  // !_WIN32
+}
+
+ArtifactMapper*
+ArtifactMapper::Instance()
+{
+  static ArtifactMapper mapper;
+  return &mapper;
+}
+
+Status
+ArtifactMapper::Map(
+    const std::string& path, const bool huge_pages,
+    std::shared_ptr<const Mapping>* mapping)
+{
+#ifdef _WIN32
+  return Status(
+      Status::Code::UNSUPPORTED,
+      "memory mapping model files is not supported on Windows");
+#else
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    return Status(
+        Status::Code::INTERNAL,
+        "failed to open '" + path + "' for mapping: " + strerror(errno));
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return Status(Status::Code::INTERNAL, "failed to stat file " + path);
+  }
+  if (!S_ISREG(st.st_mode) || (st.st_size == 0)) {
+    close(fd);
+    return Status(
+        Status::Code::INVALID_ARG,
+        "failed to map '" + path + "': not a non-empty regular file");
+  }
+
+  const size_t byte_size = st.st_size;
+  const std::string file_key =
+      std::to_string(st.st_dev) + ":" + std::to_string(st.st_ino) + ":" +
+      std::to_string(byte_size) + ":" +
+      std::to_string(TIMESPEC_TO_NANOS(st.st_mtim));
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    const auto it = by_file_.find(file_key);
+    if (it != by_file_.end()) {
+      *mapping = it->second.lock();
+      if (*mapping != nullptr) {
+        close(fd);
+        return Status::Success;
+      }
+    }
+  }
+
+  void* base = mmap(nullptr, byte_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    return Status(
+        Status::Code::INTERNAL,
+        "failed to map '" + path + "': " + strerror(errno));
+  }
+#ifdef MADV_HUGEPAGE
+  // Best effort, huge pages for files depend on the kernel and filesystem
+  if (huge_pages) {
+    madvise(base, byte_size, MADV_HUGEPAGE);
+  }
+#else
+  (void)huge_pages;
+#endif  // MADV_HUGEPAGE
+
+  StreamHash64 hash;
+  hash.Update(base, byte_size);
+  std::shared_ptr<const Mapping> local_mapping(
+      new Mapping(base, byte_size, hash.Digest()));
+
+  // A different file with the same content may be mapped already, the
+  // content is compared outside of the lock as the files can be large.
+  std::vector<std::shared_ptr<const Mapping>> candidates;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    const auto range = by_content_.equal_range(local_mapping->hash_);
+    for (auto it = range.first; it != range.second; ++it) {
+      auto candidate = it->second.lock();
+      if ((candidate != nullptr) && (candidate->byte_size_ == byte_size)) {
+        candidates.emplace_back(std::move(candidate));
+      }
+    }
+  }
+  for (const auto& candidate : candidates) {
+    if (std::memcmp(candidate->base_, base, byte_size) == 0) {
+      local_mapping = candidate;
+      break;
+    }
+  }
+
+  std::lock_guard<std::mutex> lk(mu_);
+  // Drop the entries of the mappings that are gone
+  for (auto it = by_file_.begin(); it != by_file_.end();) {
+    it = it->second.expired() ? by_file_.erase(it) : std::next(it);
+  }
+  for (auto it = by_content_.begin(); it != by_content_.end();) {
+    it = it->second.expired() ? by_content_.erase(it) : std::next(it);
+  }
+  if (local_mapping->base_ == base) {
+    by_content_.emplace(local_mapping->hash_, local_mapping);
+  }
+  by_file_[file_key] = local_mapping;
+  *mapping = std::move(local_mapping);
+  return Status::Success;
+#endif  // _WIN32
+}
+
+}}  // namespace triton::core
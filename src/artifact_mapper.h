@@ -0,0 +1,87 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "status.h"
+
+namespace triton { namespace core {
+
+//
+// Process-wide read-only memory mappings of model files. A file is mapped
+// once and the mapping is handed to every model instance and version that
+// maps a file with identical content, so the weights share the page cache
+// instead of being read into the private memory of each of them.
+//
+class ArtifactMapper {
+ public:
+  // A read-only shared mapping of a whole file. Unmapped once the last
+  // reference is released.
+  class Mapping {
+   public:
+    ~Mapping();
+
+    const void* Base() const { return base_; }
+    size_t ByteSize() const { return byte_size_; }
+
+   private:
+    friend class ArtifactMapper;
+    Mapping(void* base, size_t byte_size, uint64_t hash)
+        : base_(base), byte_size_(byte_size), hash_(hash)
+    {
+    }
+
+    void* const base_;
+    const size_t byte_size_;
+    const uint64_t hash_;
+  };
+
+  static ArtifactMapper* Instance();
+
+  // Map the local file 'path'. If 'huge_pages' is true, the mapping is
+  // advised to be backed by transparent huge pages where the kernel
+  // supports it for files.
+  Status Map(
+      const std::string& path, const bool huge_pages,
+      std::shared_ptr<const Mapping>* mapping);
+
+ private:
+  ArtifactMapper() = default;
+
+  std::mutex mu_;
+  // The live mappings by file identity (device, inode, size and
+  // modification time), which avoids hashing a file that is mapped already.
+  std::unordered_map<std::string, std::weak_ptr<const Mapping>> by_file_;
+  // The live mappings by content hash
+  std::unordered_multimap<uint64_t, std::weak_ptr<const Mapping>> by_content_;
+};
+
+}}  // namespace triton::core
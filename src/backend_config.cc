@@ -225,4 +225,38 @@ BackendConfigurationModelLoadGpuFraction(
   return Status::Success;
 }
 
+Status
+BackendConfigurationPreloadBackends(
+    const triton::common::BackendCmdlineConfigMap& config_map,
+    std::vector<std::string>* backend_names)
+{
+  backend_names->clear();
+  const auto& itr = config_map.find(std::string());
+  if (itr == config_map.end()) {
+    return Status::Success;
+  }
+
+  std::string preload_str;
+  auto status =
+      BackendConfiguration(itr->second, "preload-backends", &preload_str);
+  // Allow missing key, no backend is preloaded by default
+  if (!status.IsOk()) {
+    return Status::Success;
+  }
+
+  size_t begin = 0;
+  while (begin <= preload_str.size()) {
+    size_t end = preload_str.find(',', begin);
+    if (end == std::string::npos) {
+      end = preload_str.size();
+    }
+    if (end > begin) {
+      backend_names->emplace_back(preload_str.substr(begin, end - begin));
+    }
+    begin = end + 1;
+  }
+
+  return Status::Success;
+}
+
 }}  // namespace triton::core
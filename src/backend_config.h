@@ -25,6 +25,8 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <string>
+#include <vector>
 #include "status.h"
 #include "triton/common/model_config.h"
 
@@ -74,4 +76,11 @@ Status BackendConfigurationModelLoadGpuFraction(
     const triton::common::BackendCmdlineConfigMap& config_map,
     const int device_id, double* memory_limit);
 
+/// Get the names of the backends to load and initialize at server start
+/// from the backend configuration. The names are given as a comma
+/// separated list, no backend is preloaded if the setting is missing.
+Status BackendConfigurationPreloadBackends(
+    const triton::common::BackendCmdlineConfigMap& config_map,
+    std::vector<std::string>* backend_names);
+
 }}  // namespace triton::core
@@ -80,15 +80,22 @@ TritonBackend::Create(
   // object is this TritonBackend object. We must set set shared
   // library path to point to the backend directory in case the
   // backend library attempts to load additional shared libaries.
+  // The library path is only process-wide state on Windows, elsewhere
+  // the initialization runs without holding the shared library lock so
+  // that different backends can initialize concurrently.
   if (local_backend->backend_init_fn_ != nullptr) {
+#ifdef _WIN32
     std::unique_ptr<SharedLibrary> slib;
     RETURN_IF_ERROR(SharedLibrary::Acquire(&slib));
     RETURN_IF_ERROR(slib->SetLibraryDirectory(local_backend->dir_));
+#endif  // _WIN32
 
     TRITONSERVER_Error* err = local_backend->backend_init_fn_(
         reinterpret_cast<TRITONBACKEND_Backend*>(local_backend.get()));
 
+#ifdef _WIN32
     RETURN_IF_ERROR(slib->ResetLibraryDirectory());
+#endif  // _WIN32
     RETURN_IF_TRITONSERVER_ERROR(err);
   }
 
@@ -159,6 +166,8 @@ TritonBackend::ClearHandles()
   inst_init_fn_ = nullptr;
   inst_fini_fn_ = nullptr;
   inst_exec_fn_ = nullptr;
+  inst_exec_async_fn_ = nullptr;
+  inst_prefetch_fn_ = nullptr;
 }
 
 Status
@@ -172,6 +181,8 @@ TritonBackend::LoadBackendLibrary()
   TritonModelInstanceInitFn_t iifn;
   TritonModelInstanceFiniFn_t iffn;
   TritonModelInstanceExecFn_t iefn;
+  TritonModelInstanceExecAsyncFn_t ieafn;
+  TritonModelInstancePrefetchFn_t ipfn;
 
   {
     std::unique_ptr<SharedLibrary> slib;
@@ -211,6 +222,16 @@ TritonBackend::LoadBackendLibrary()
     RETURN_IF_ERROR(slib->GetEntrypoint(
         dlhandle_, "TRITONBACKEND_ModelInstanceExecute", false /* optional */,
         reinterpret_cast<void**>(&iefn)));
+
+    // Model instance asynchronous execute function, optional
+    RETURN_IF_ERROR(slib->GetEntrypoint(
+        dlhandle_, "TRITONBACKEND_ModelInstanceExecuteAsync",
+        true /* optional */, reinterpret_cast<void**>(&ieafn)));
+
+    // Model instance prefetch function, optional
+    RETURN_IF_ERROR(slib->GetEntrypoint(
+        dlhandle_, "TRITONBACKEND_ModelInstancePrefetch", true /* optional */,
+        reinterpret_cast<void**>(&ipfn)));
   }
 
   backend_init_fn_ = bifn;
@@ -221,6 +242,8 @@ TritonBackend::LoadBackendLibrary()
   inst_init_fn_ = iifn;
   inst_fini_fn_ = iffn;
   inst_exec_fn_ = iefn;
+  inst_exec_async_fn_ = ieafn;
+  inst_prefetch_fn_ = ipfn;
 
   return Status::Success;
 }
@@ -339,19 +362,44 @@ TritonBackendManager::CreateBackend(
     const triton::common::BackendCmdlineConfig& backend_cmdline_config,
     std::shared_ptr<TritonBackend>* backend)
 {
-  std::lock_guard<std::mutex> lock(mu_);
+  std::unique_lock<std::mutex> lock(mu_);
+
+  // The backend is created without holding the lock so that different
+  // backends load and initialize concurrently. Callers that want a
+  // backend that is being created wait for that creation to finish and
+  // retry it themselves if it failed.
+  while (true) {
+    const auto& itr = backend_map_.find(libpath);
+    if (itr != backend_map_.end()) {
+      *backend = itr->second;
+      return Status::Success;
+    }
 
-  const auto& itr = backend_map_.find(libpath);
-  if (itr != backend_map_.end()) {
-    *backend = itr->second;
-    return Status::Success;
+    const auto& pending_itr = pending_backends_.find(libpath);
+    if (pending_itr == pending_backends_.end()) {
+      break;
+    }
+    std::shared_future<void> pending = pending_itr->second;
+    lock.unlock();
+    pending.wait();
+    lock.lock();
   }
 
-  RETURN_IF_ERROR(TritonBackend::Create(
-      name, dir, libpath, backend_cmdline_config, backend));
-  backend_map_.insert({libpath, *backend});
+  std::promise<void> created;
+  pending_backends_.emplace(libpath, created.get_future().share());
+  lock.unlock();
 
-  return Status::Success;
+  Status status = TritonBackend::Create(
+      name, dir, libpath, backend_cmdline_config, backend);
+
+  lock.lock();
+  if (status.IsOk()) {
+    backend_map_.insert({libpath, *backend});
+  }
+  pending_backends_.erase(libpath);
+  created.set_value();
+
+  return status;
 }
 
 Status
@@ -25,6 +25,7 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <future>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -58,6 +59,13 @@ class TritonBackend {
   typedef TRITONSERVER_Error* (*TritonModelInstanceExecFn_t)(
       TRITONBACKEND_ModelInstance* instance, TRITONBACKEND_Request** requests,
       const uint32_t request_cnt);
+  typedef TRITONSERVER_Error* (*TritonModelInstanceExecAsyncFn_t)(
+      TRITONBACKEND_ModelInstance* instance, TRITONBACKEND_Request** requests,
+      const uint32_t request_cnt, TRITONBACKEND_ExecuteCompleteFn_t complete_fn,
+      void* complete_userp);
+  typedef TRITONSERVER_Error* (*TritonModelInstancePrefetchFn_t)(
+      TRITONBACKEND_ModelInstance* instance, TRITONBACKEND_Request** requests,
+      const uint32_t request_cnt);
 
   static Status Create(
       const std::string& name, const std::string& dir,
@@ -97,6 +105,14 @@ class TritonBackend {
   {
     return inst_exec_fn_;
   }
+  TritonModelInstanceExecAsyncFn_t ModelInstanceExecAsyncFn() const
+  {
+    return inst_exec_async_fn_;
+  }
+  TritonModelInstancePrefetchFn_t ModelInstancePrefetchFn() const
+  {
+    return inst_prefetch_fn_;
+  }
 
  private:
   typedef TRITONSERVER_Error* (*TritonBackendInitFn_t)(
@@ -142,6 +158,8 @@ class TritonBackend {
   TritonModelInstanceInitFn_t inst_init_fn_;
   TritonModelInstanceFiniFn_t inst_fini_fn_;
   TritonModelInstanceExecFn_t inst_exec_fn_;
+  TritonModelInstanceExecAsyncFn_t inst_exec_async_fn_;
+  TritonModelInstancePrefetchFn_t inst_prefetch_fn_;
 
   // Opaque state associated with the backend.
   void* state_;
@@ -169,6 +187,10 @@ class TritonBackendManager {
   DISALLOW_COPY_AND_ASSIGN(TritonBackendManager);
   TritonBackendManager() = default;
   std::unordered_map<std::string, std::shared_ptr<TritonBackend>> backend_map_;
+  // The backends being created, keyed by library path. The future is
+  // ready once the creation finished, successfully or not.
+  std::unordered_map<std::string, std::shared_future<void>>
+      pending_backends_;
 };
 
 }}  // namespace triton::core
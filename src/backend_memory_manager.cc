@@ -26,6 +26,10 @@
 
 #include "backend_memory_manager.h"
 
+#include <cstring>
+#include <vector>
+
+#include "cuda_utils.h"
 #include "pinned_memory_manager.h"
 #include "status.h"
 #include "tritonserver_apis.h"
@@ -49,6 +53,116 @@
 
 namespace triton { namespace core {
 
+namespace {
+
+bool
+IsHostMemory(const TRITONSERVER_MemoryType memory_type)
+{
+  return (memory_type == TRITONSERVER_MEMORY_CPU) ||
+         (memory_type == TRITONSERVER_MEMORY_CPU_PINNED);
+}
+
+// Perform the copies of TRITONBACKEND_MemoryManagerCopyBatch, returning
+// the pinned buffers used for staging in 'staging_buffers'.
+Status
+StagedCopyBatch(
+    const uint32_t count, const void** src,
+    const TRITONSERVER_MemoryType* src_memory_type,
+    const int64_t* src_memory_type_id, void** dst, const uint64_t* byte_size,
+    const TRITONSERVER_MemoryType dst_memory_type,
+    const int64_t dst_memory_type_id, cudaStream_t stream, bool* cuda_used,
+    std::vector<void*>* staging_buffers)
+{
+  const std::string msg("batched copy");
+  *cuda_used = false;
+
+  uint32_t idx = 0;
+  while (idx < count) {
+    // Collect the run of copies whose destinations follow one another
+    const uint32_t first = idx;
+    uint64_t run_byte_size = byte_size[idx];
+    bool host_sources = IsHostMemory(src_memory_type[idx]);
+    for (++idx; idx < count; ++idx) {
+      if (dst[idx] != (static_cast<char*>(dst[first]) + run_byte_size)) {
+        break;
+      }
+      run_byte_size += byte_size[idx];
+      host_sources &= IsHostMemory(src_memory_type[idx]);
+    }
+
+    bool run_cuda_used = false;
+#ifdef TRITON_ENABLE_GPU
+    // Fill a pinned staging buffer on the host so that the whole run is
+    // moved to the device by a single DMA.
+    if ((dst_memory_type == TRITONSERVER_MEMORY_GPU) && host_sources &&
+        ((idx - first) > 1)) {
+      void* staging = nullptr;
+      TRITONSERVER_MemoryType staging_type;
+      RETURN_IF_ERROR(PinnedMemoryManager::Alloc(
+          &staging, run_byte_size, &staging_type,
+          false /* allow_nonpinned_fallback */));
+      staging_buffers->push_back(staging);
+
+      uint64_t offset = 0;
+      for (uint32_t i = first; i < idx; ++i) {
+        std::memcpy(static_cast<char*>(staging) + offset, src[i], byte_size[i]);
+        offset += byte_size[i];
+      }
+      RETURN_IF_ERROR(CopyBuffer(
+          msg, TRITONSERVER_MEMORY_CPU_PINNED, 0 /* src_memory_type_id */,
+          dst_memory_type, dst_memory_type_id, run_byte_size, staging,
+          dst[first], stream, &run_cuda_used));
+      *cuda_used |= run_cuda_used;
+      continue;
+    }
+#endif  // TRITON_ENABLE_GPU
+
+    std::vector<CopySegment> segments;
+    segments.reserve(idx - first);
+    for (uint32_t i = first; i < idx; ++i) {
+      segments.push_back(CopySegment{
+          src[i], byte_size[i], src_memory_type[i], src_memory_type_id[i]});
+    }
+    RETURN_IF_ERROR(GatherBuffers(
+        msg, segments, dst_memory_type, dst_memory_type_id, dst[first],
+        stream, &run_cuda_used));
+    *cuda_used |= run_cuda_used;
+  }
+
+  return Status::Success;
+}
+
+}  // namespace
+
+Status
+CopyBatch(
+    const uint32_t count, const void** src,
+    const TRITONSERVER_MemoryType* src_memory_type,
+    const int64_t* src_memory_type_id, void** dst, const uint64_t* byte_size,
+    const TRITONSERVER_MemoryType dst_memory_type,
+    const int64_t dst_memory_type_id, cudaStream_t stream, bool* cuda_used)
+{
+  std::vector<void*> staging_buffers;
+  Status status = StagedCopyBatch(
+      count, src, src_memory_type, src_memory_type_id, dst, byte_size,
+      dst_memory_type, dst_memory_type_id, stream, cuda_used,
+      &staging_buffers);
+
+  // The staging buffers can only be released once the copies from them
+  // are done, which leaves nothing pending on the stream.
+  if (!staging_buffers.empty()) {
+#ifdef TRITON_ENABLE_GPU
+    cudaStreamSynchronize(stream);
+#endif  // TRITON_ENABLE_GPU
+    for (void* buffer : staging_buffers) {
+      PinnedMemoryManager::Free(buffer);
+    }
+    *cuda_used = false;
+  }
+
+  return status;
+}
+
 extern "C" {
 
 TRITONAPI_DECLSPEC TRITONSERVER_Error*
@@ -144,6 +258,21 @@ TRITONBACKEND_MemoryManagerFree(
   return nullptr;  // success
 }
 
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONBACKEND_MemoryManagerCopyBatch(
+    TRITONBACKEND_MemoryManager* manager, const uint32_t count,
+    const void** src, const TRITONSERVER_MemoryType* src_memory_type,
+    const int64_t* src_memory_type_id, void** dst, const uint64_t* byte_size,
+    const TRITONSERVER_MemoryType dst_memory_type,
+    const int64_t dst_memory_type_id, void* cuda_stream, bool* cuda_used)
+{
+  RETURN_TRITONSERVER_ERROR_IF_ERROR(CopyBatch(
+      count, src, src_memory_type, src_memory_type_id, dst, byte_size,
+      dst_memory_type, dst_memory_type_id,
+      reinterpret_cast<cudaStream_t>(cuda_stream), cuda_used));
+  return nullptr;  // success
+}
+
 }  // extern C
 
 }}  // namespace triton::core
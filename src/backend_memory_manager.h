@@ -25,6 +25,9 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include "cuda_utils.h"
+#include "status.h"
+
 namespace triton { namespace core {
 
 // Currently there is just a global memory manager that is used for
@@ -33,4 +36,13 @@ namespace triton { namespace core {
 struct TritonMemoryManager {
 };
 
+// Perform a batch of copies as TRITONBACKEND_MemoryManagerCopyBatch
+// describes.
+Status CopyBatch(
+    const uint32_t count, const void** src,
+    const TRITONSERVER_MemoryType* src_memory_type,
+    const int64_t* src_memory_type_id, void** dst, const uint64_t* byte_size,
+    const TRITONSERVER_MemoryType dst_memory_type,
+    const int64_t dst_memory_type_id, cudaStream_t stream, bool* cuda_used);
+
 }}  // namespace triton::core
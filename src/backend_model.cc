@@ -26,14 +26,19 @@
 
 #include "backend_model.h"
 
+#include <algorithm>
+#include <chrono>
 #include <map>
 #include <vector>
 
 #include "backend_config.h"
+#include "backend_memory_manager.h"
+#include "clock.h"
 #include "dynamic_batch_scheduler.h"
 #include "filesystem/api.h"
 #include "model_config_utils.h"
 #include "numa_utils.h"
+#include "pinned_memory_manager.h"
 #include "sequence_batch_scheduler.h"
 #include "sequence_state.h"
 #include "server.h"
@@ -62,7 +67,8 @@ TritonModel::Create(
     const triton::common::BackendCmdlineConfigMap& backend_cmdline_config_map,
     const triton::common::HostPolicyCmdlineConfigMap& host_policy_map,
     const int64_t version, inference::ModelConfig model_config,
-    const bool is_config_provided, std::unique_ptr<TritonModel>* model)
+    const bool is_config_provided, const bool skip_warmup,
+    std::unique_ptr<TritonModel>* model)
 {
   model->reset();
 
@@ -74,11 +80,27 @@ TritonModel::Create(
         "must specify 'backend' for '" + model_config.name() + "'");
   }
 
+  // A model in a remote repository may be streamed to the backend
+  // instead of being localized.
+  bool stream_artifacts = false;
+  RETURN_IF_ERROR(GetBoolModelParameter(
+      model_config, "TRITON_STREAM_ARTIFACTS", false /* default_value */,
+      &stream_artifacts));
+  if (stream_artifacts) {
+    FileSystemType fs_type;
+    RETURN_IF_ERROR(GetFileSystemType(model_path, &fs_type));
+    stream_artifacts = (fs_type != FileSystemType::LOCAL);
+  }
+
   // Localize the content of the model repository corresponding to
   // 'model_path'. This model holds a handle to the localized content
   // so that it persists as long as the model is loaded.
   std::shared_ptr<LocalizedPath> localized_model_dir;
-  RETURN_IF_ERROR(LocalizePath(model_path, &localized_model_dir));
+  if (stream_artifacts) {
+    localized_model_dir = std::make_shared<LocalizedPath>(model_path);
+  } else {
+    RETURN_IF_ERROR(LocalizePath(model_path, &localized_model_dir));
+  }
 
   // Localize paths in backend model config
   // [FIXME] Remove once a more permanent solution is implemented (DLIS-4211)
@@ -114,8 +136,12 @@ TritonModel::Create(
       JoinPath({localized_model_path, std::to_string(version)});
   const std::string global_path =
       JoinPath({backend_dir, specialized_backend_name});
-  const std::vector<std::string> search_paths = {
-      version_path, localized_model_path, global_path};
+  // A backend library in a streamed model directory can't be loaded
+  const std::vector<std::string> search_paths =
+      stream_artifacts
+          ? std::vector<std::string>{global_path}
+          : std::vector<std::string>{
+                version_path, localized_model_path, global_path};
 
   std::string backend_libdir;
   std::string backend_libpath;
@@ -166,6 +192,8 @@ TritonModel::Create(
       server, localized_model_dir, backend, min_compute_capability, version,
       model_config, auto_complete_config, backend_cmdline_config_map,
       host_policy_map));
+  local_model->stream_artifacts_ = stream_artifacts;
+  local_model->skip_warmup_ = skip_warmup;
 
   TritonModel* raw_local_model = local_model.get();
 
@@ -245,9 +273,13 @@ TritonModel::Create(
       raw_local_model, backend_cmdline_config_map, host_policy_map,
       model_config));
   RETURN_IF_ERROR(local_model->CommitInstances());
+  // Instances added by later config updates are warmed up as usual
+  local_model->skip_warmup_ = false;
 
   RETURN_IF_ERROR(local_model->SetConfiguredScheduler());
 
+  RETURN_IF_ERROR(local_model->StartAutoscaler());
+
   *model = std::move(local_model);
   return Status::Success;
 }
@@ -257,6 +289,8 @@ TritonModel::UpdateInstanceGroup(
     const inference::ModelConfig& new_model_config,
     std::unique_lock<std::mutex>* caller_lock)
 {
+  std::lock_guard<std::mutex> lk(instance_group_mu_);
+
   // Generate normalized model config with new instance group.
   inference::ModelConfig model_config = config_;
   model_config.clear_instance_group();
@@ -269,10 +303,14 @@ TritonModel::UpdateInstanceGroup(
   RETURN_IF_ERROR(ValidateInstanceGroup(model_config, min_compute_capability_));
 
   // Update the instances to the new config.
-  caller_lock->unlock();  // allow inference while creating instances
+  if (caller_lock != nullptr) {
+    caller_lock->unlock();  // allow inference while creating instances
+  }
   Status status = TritonModelInstance::SetInstances(
       this, backend_cmdline_config_map_, host_policy_map_, model_config);
-  caller_lock->lock();
+  if (caller_lock != nullptr) {
+    caller_lock->lock();
+  }
   if (!status.IsOk()) {
     return status;
   }
@@ -281,6 +319,7 @@ TritonModel::UpdateInstanceGroup(
   // object. The 'caller_lock' is held, so 'model_lifecycle' will pause any new
   // inference request. It is safe to move forward and commit the change.
   config_.mutable_instance_group()->Swap(model_config.mutable_instance_group());
+  ClearSerialized();
   RETURN_IF_ERROR(CommitInstances());
   // Only model owned dynamic batch scheduler can be updated currently, so there
   // is no need to update the scheduler.
@@ -288,6 +327,210 @@ TritonModel::UpdateInstanceGroup(
   return Status::Success;
 }
 
+Status
+TritonModel::StartAutoscaler()
+{
+  int64_t max_count = 0;
+  RETURN_IF_ERROR(GetInt64ModelParameter(
+      config_, "TRITON_AUTOSCALE_MAX_INSTANCES", 0 /* default_value */,
+      &max_count));
+  bool standby = false;
+  RETURN_IF_ERROR(GetBoolModelParameter(
+      config_, "TRITON_PASSIVE_STANDBY", false /* default_value */,
+      &standby));
+  standby &= !passive_instances_.empty();
+  if ((max_count <= 0) && !standby) {
+    return Status::Success;
+  }
+  int64_t min_count = 1;
+  RETURN_IF_ERROR(GetInt64ModelParameter(
+      config_, "TRITON_AUTOSCALE_MIN_INSTANCES", 1 /* default_value */,
+      &min_count));
+  int64_t interval_ms = 1000;
+  RETURN_IF_ERROR(GetInt64ModelParameter(
+      config_, "TRITON_AUTOSCALE_INTERVAL_MS", 1000 /* default_value */,
+      &interval_ms));
+  if (((max_count > 0) && ((min_count <= 0) || (min_count > max_count))) ||
+      (interval_ms <= 0)) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "autoscaling of model '" + Name() +
+            "' expects 0 < TRITON_AUTOSCALE_MIN_INSTANCES <= "
+            "TRITON_AUTOSCALE_MAX_INSTANCES and a positive "
+            "TRITON_AUTOSCALE_INTERVAL_MS");
+  }
+  // The sequence batcher sizes its slots by the instances it is created
+  // with, so it can't follow a change of the instances.
+  if (config_.has_sequence_batching() || (config_.instance_group_size() == 0)) {
+    LOG_WARNING << "Autoscaling is not supported for model '" << Name()
+                << "', it requires an instance group and no sequence "
+                   "batching";
+    return Status::Success;
+  }
+
+  autoscale_thread_ =
+      std::thread([this, min_count, max_count, interval_ms, standby]() {
+        AutoscaleThread(min_count, max_count, interval_ms, standby);
+      });
+  return Status::Success;
+}
+
+bool
+TritonModel::PromoteStandby()
+{
+  std::lock_guard<std::mutex> lk(instance_group_mu_);
+  for (const auto& instance : passive_instances_) {
+    if (instance->IsPromoted()) {
+      continue;
+    }
+    Status status = instance->Promote();
+    if (status.IsOk()) {
+      LOG_INFO << "Promoted standby instance " << instance->Name()
+               << " of model '" << Name() << "'";
+      return true;
+    }
+    LOG_ERROR << "Failed to promote standby instance " << instance->Name()
+              << " of model '" << Name() << "': " << status.Message();
+  }
+  return false;
+}
+
+bool
+TritonModel::DemoteStandby()
+{
+  std::lock_guard<std::mutex> lk(instance_group_mu_);
+  for (auto it = passive_instances_.rbegin(); it != passive_instances_.rend();
+       ++it) {
+    if (!(*it)->IsPromoted()) {
+      continue;
+    }
+    Status status = (*it)->Demote();
+    if (!status.IsOk()) {
+      LOG_ERROR << "Failed to demote standby instance " << (*it)->Name()
+                << " of model '" << Name() << "': " << status.Message();
+      return false;
+    }
+    LOG_INFO << "Demoted standby instance " << (*it)->Name() << " of model '"
+             << Name() << "'";
+    return true;
+  }
+  return false;
+}
+
+void
+TritonModel::AutoscaleThread(
+    const int64_t min_count, const int64_t max_count,
+    const uint64_t interval_ms, const bool standby)
+{
+  // Scale up when the queue holds more than two requests per instance or
+  // the instances are busy, scale down only once they are mostly idle for
+  // a while to avoid flapping on bursts. Promoting a standby instance is
+  // preferred over creating an instance and demoting one over removing
+  // an instance, as both are fast.
+  constexpr double kScaleUpUtilization = 0.8;
+  constexpr double kScaleDownUtilization = 0.3;
+  constexpr size_t kScaleDownIntervals = 10;
+
+  uint64_t last_ns = SteadyClockNs();
+  uint64_t last_execution_count = 0;
+  uint64_t last_compute_ns = 0;
+  MutableStatsAggregator()->ExecutionStats(
+      &last_execution_count, &last_compute_ns);
+  uint64_t last_failure_count = 0;
+  size_t idle_intervals = 0;
+
+  std::unique_lock<std::mutex> lk(autoscale_mu_);
+  while (!autoscale_cv_.wait_for(
+      lk, std::chrono::milliseconds(interval_ms),
+      [this] { return autoscale_exit_; })) {
+    const uint64_t now_ns = SteadyClockNs();
+    uint64_t execution_count = 0;
+    uint64_t compute_ns = 0;
+    MutableStatsAggregator()->ExecutionStats(&execution_count, &compute_ns);
+    const size_t inflight = InflightInferenceCount();
+
+    inference::ModelConfig new_config;
+    size_t instance_count = 0;
+    uint64_t failure_count = 0;
+    {
+      std::lock_guard<std::mutex> ig_lk(instance_group_mu_);
+      *new_config.mutable_instance_group() = config_.instance_group();
+      for (const auto* instances : {&instances_, &passive_instances_}) {
+        for (const auto& instance : *instances) {
+          if (!instance->IsPassive() || instance->IsPromoted()) {
+            ++instance_count;
+            failure_count += instance->ExecutionFailureCount();
+          }
+        }
+      }
+      instance_count = std::max<size_t>(1, instance_count);
+    }
+    const int64_t count = new_config.instance_group(0).count();
+    const double utilization =
+        static_cast<double>(compute_ns - last_compute_ns) /
+        (static_cast<double>(now_ns - last_ns) * instance_count);
+    // The count of a demoted instance no longer adds up, so only an
+    // increase is a new failure.
+    const bool failed = (failure_count > last_failure_count);
+    last_ns = now_ns;
+    last_compute_ns = compute_ns;
+    last_failure_count = failure_count;
+
+    bool scale_up = false;
+    bool scale_down = false;
+    if ((inflight > (2 * instance_count)) ||
+        (utilization > kScaleUpUtilization)) {
+      idle_intervals = 0;
+      scale_up = true;
+    } else if (
+        (inflight <= instance_count) &&
+        (utilization < kScaleDownUtilization)) {
+      if (++idle_intervals >= kScaleDownIntervals) {
+        idle_intervals = 0;
+        scale_down = true;
+      }
+    } else {
+      idle_intervals = 0;
+    }
+
+    if (standby) {
+      if ((scale_up || failed) && PromoteStandby()) {
+        continue;
+      }
+      if (scale_down && DemoteStandby()) {
+        continue;
+      }
+    }
+    if (max_count <= 0) {
+      continue;
+    }
+
+    int64_t new_count = count;
+    if (scale_up) {
+      new_count = std::min(count + 1, max_count);
+    } else if (scale_down) {
+      new_count = std::max(count - 1, min_count);
+    }
+    // Bring a count set outside of the range by a config update back in
+    new_count = std::min(std::max(new_count, min_count), max_count);
+    if (new_count == count) {
+      continue;
+    }
+
+    LOG_INFO << "Autoscaling instance group '"
+             << new_config.instance_group(0).name() << "' of model '" << Name()
+             << "' from " << count << " to " << new_count << " instances";
+    new_config.mutable_instance_group(0)->set_count(new_count);
+    lk.unlock();
+    Status status = UpdateInstanceGroup(new_config, nullptr);
+    lk.lock();
+    if (!status.IsOk()) {
+      LOG_ERROR << "Failed to autoscale model '" << Name()
+                << "': " << status.Message();
+    }
+  }
+}
+
 Status
 TritonModel::GetExecutionPolicy(const inference::ModelConfig& model_config)
 {
@@ -306,6 +549,50 @@ TritonModel::GetExecutionPolicy(const inference::ModelConfig& model_config)
   return Status::Success;
 }
 
+Status
+TritonModel::PreloadBackend(
+    InferenceServer* server, const std::string& backend_name,
+    const triton::common::BackendCmdlineConfigMap& backend_cmdline_config_map)
+{
+  std::string backend_dir;
+  RETURN_IF_ERROR(BackendConfigurationGlobalBackendsDirectory(
+      backend_cmdline_config_map, &backend_dir));
+
+  std::string specialized_backend_name;
+  RETURN_IF_ERROR(BackendConfigurationSpecializeBackendName(
+      backend_cmdline_config_map, backend_name, &specialized_backend_name));
+
+  std::string backend_libname;
+  RETURN_IF_ERROR(BackendConfigurationBackendLibraryName(
+      specialized_backend_name, &backend_libname));
+
+  // Same library path as a model without its own copy of the backend
+  // resolves to, so that the model picks up the preloaded backend.
+  const std::string backend_libdir =
+      JoinPath({backend_dir, specialized_backend_name});
+  const std::string backend_libpath =
+      JoinPath({backend_libdir, backend_libname});
+  bool exists = false;
+  RETURN_IF_ERROR(FileExists(backend_libpath, &exists));
+  if (!exists) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "unable to find '" + backend_libname + "' to preload backend '" +
+            backend_name + "', searched: " + backend_libdir);
+  }
+
+  triton::common::BackendCmdlineConfig config;
+  RETURN_IF_ERROR(
+      ResolveBackendConfigs(backend_cmdline_config_map, backend_name, config));
+  RETURN_IF_ERROR(SetBackendConfigDefaults(config));
+
+  std::shared_ptr<TritonBackend> backend;
+  RETURN_IF_ERROR(server->BackendManager()->CreateBackend(
+      backend_name, backend_libdir, backend_libpath, config, &backend));
+
+  return Status::Success;
+}
+
 Status
 TritonModel::ResolveBackendConfigs(
     const triton::common::BackendCmdlineConfigMap& backend_cmdline_config_map,
@@ -610,8 +897,55 @@ TritonModel::TritonModel(
 {
 }
 
+Status
+TritonModel::MapFile(
+    const std::string& path, const bool huge_pages, const void** base,
+    uint64_t* byte_size)
+{
+  if (stream_artifacts_) {
+    return Status(
+        Status::Code::UNSUPPORTED,
+        "cannot map file '" + path + "' of model '" + Name() +
+            "', the model artifacts are streamed");
+  }
+
+  std::shared_ptr<const ArtifactMapper::Mapping> mapping;
+  RETURN_IF_ERROR(ArtifactMapper::Instance()->Map(
+      JoinPath({LocalizedModelPath(), path}), huge_pages, &mapping));
+  *base = mapping->Base();
+  *byte_size = mapping->ByteSize();
+
+  std::lock_guard<std::mutex> lk(mapped_files_mu_);
+  mapped_files_.emplace(mapping->Base(), std::move(mapping));
+  return Status::Success;
+}
+
+Status
+TritonModel::UnmapFile(const void* base)
+{
+  std::lock_guard<std::mutex> lk(mapped_files_mu_);
+  const auto it = mapped_files_.find(base);
+  if (it == mapped_files_.end()) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "no file mapping at the given address for model '" + Name() + "'");
+  }
+  mapped_files_.erase(it);
+  return Status::Success;
+}
+
 TritonModel::~TritonModel()
 {
+  // Stop autoscaling before the instances are destroyed.
+  if (autoscale_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lk(autoscale_mu_);
+      autoscale_exit_ = true;
+    }
+    autoscale_cv_.notify_all();
+    autoscale_thread_.join();
+  }
+
   // If there is a custom batcher, finalize it.
   if (batcher_fini_fn_) {
     TRITONSERVER_Error* err = batcher_fini_fn_(*Batcher());
@@ -697,11 +1031,54 @@ TRITONBACKEND_ModelRepository(
     const char** location)
 {
   TritonModel* tm = reinterpret_cast<TritonModel*>(model);
-  *artifact_type = TRITONBACKEND_ARTIFACT_FILESYSTEM;
+  *artifact_type = tm->StreamsArtifacts() ? TRITONBACKEND_ARTIFACT_STREAM
+                                          : TRITONBACKEND_ARTIFACT_FILESYSTEM;
   *location = tm->LocalizedModelPath().c_str();
   return nullptr;  // success
 }
 
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONBACKEND_ModelRepositoryFileSize(
+    TRITONBACKEND_Model* model, const char* path, uint64_t* byte_size)
+{
+  TritonModel* tm = reinterpret_cast<TritonModel*>(model);
+  RETURN_TRITONSERVER_ERROR_IF_ERROR(
+      FileSize(JoinPath({tm->LocalizedModelPath(), path}), byte_size));
+  return nullptr;  // success
+}
+
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONBACKEND_ModelRepositoryReadRange(
+    TRITONBACKEND_Model* model, const char* path, const uint64_t offset,
+    const uint64_t byte_size, void* buffer)
+{
+  TritonModel* tm = reinterpret_cast<TritonModel*>(model);
+  RETURN_TRITONSERVER_ERROR_IF_ERROR(ReadRange(
+      JoinPath({tm->LocalizedModelPath(), path}), offset, byte_size,
+      reinterpret_cast<char*>(buffer)));
+  return nullptr;  // success
+}
+
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONBACKEND_ModelRepositoryMapFile(
+    TRITONBACKEND_Model* model, const char* path, const bool huge_pages,
+    const void** base, uint64_t* byte_size)
+{
+  TritonModel* tm = reinterpret_cast<TritonModel*>(model);
+  RETURN_TRITONSERVER_ERROR_IF_ERROR(
+      tm->MapFile(path, huge_pages, base, byte_size));
+  return nullptr;  // success
+}
+
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONBACKEND_ModelRepositoryUnmapFile(
+    TRITONBACKEND_Model* model, const void* base)
+{
+  TritonModel* tm = reinterpret_cast<TritonModel*>(model);
+  RETURN_TRITONSERVER_ERROR_IF_ERROR(tm->UnmapFile(base));
+  return nullptr;  // success
+}
+
 TRITONAPI_DECLSPEC TRITONSERVER_Error*
 TRITONBACKEND_ModelConfig(
     TRITONBACKEND_Model* model, const uint32_t config_version,
@@ -824,6 +1201,23 @@ TRITONBACKEND_RequestFlags(TRITONBACKEND_Request* request, uint32_t* flags)
   return nullptr;  // success
 }
 
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONBACKEND_RequestIsCancelled(
+    TRITONBACKEND_Request* request, bool* is_cancelled)
+{
+  InferenceRequest* tr = reinterpret_cast<InferenceRequest*>(request);
+  *is_cancelled = tr->IsCancelled();
+  return nullptr;  // success
+}
+
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONBACKEND_RequestIsWarmup(TRITONBACKEND_Request* request, bool* is_warmup)
+{
+  InferenceRequest* tr = reinterpret_cast<InferenceRequest*>(request);
+  *is_warmup = tr->IsWarmup();
+  return nullptr;  // success
+}
+
 TRITONAPI_DECLSPEC TRITONSERVER_Error*
 TRITONBACKEND_RequestCorrelationIdString(
     TRITONBACKEND_Request* request, const char** id)
@@ -844,7 +1238,7 @@ TRITONAPI_DECLSPEC TRITONSERVER_Error*
 TRITONBACKEND_RequestInputCount(TRITONBACKEND_Request* request, uint32_t* count)
 {
   InferenceRequest* tr = reinterpret_cast<InferenceRequest*>(request);
-  *count = tr->ImmutableInputs().size();
+  *count = tr->ImmutableIndexedInputs().size();
   return nullptr;  // success
 }
 
@@ -856,7 +1250,7 @@ TRITONBACKEND_RequestInputName(
   *input_name = nullptr;
 
   InferenceRequest* tr = reinterpret_cast<InferenceRequest*>(request);
-  const auto& inputs = tr->ImmutableInputs();
+  const auto& inputs = tr->ImmutableIndexedInputs();
   if (index >= inputs.size()) {
     return TRITONSERVER_ErrorNew(
         TRITONSERVER_ERROR_INVALID_ARG,
@@ -865,20 +1259,7 @@ TRITONBACKEND_RequestInputName(
             .c_str());
   }
 
-  // The request inputs are not allowed to change once the request
-  // makes it to the backend, so it is ok to just iterate through the
-  // map. This linear search is the best we can do given the need for
-  // the inputs to be in a map and given the typical small number of
-  // inputs is better than having every request maintain the inputs as
-  // both map and vector.
-  uint32_t cnt = 0;
-  for (const auto& pr : inputs) {
-    if (cnt++ == index) {
-      InferenceRequest::Input* in = pr.second;
-      *input_name = in->Name().c_str();
-      break;
-    }
-  }
+  *input_name = inputs[index]->Name().c_str();
 
   return nullptr;  // success
 }
@@ -910,7 +1291,7 @@ TRITONBACKEND_RequestInputByIndex(
     TRITONBACKEND_Input** input)
 {
   InferenceRequest* tr = reinterpret_cast<InferenceRequest*>(request);
-  const auto& inputs = tr->ImmutableInputs();
+  const auto& inputs = tr->ImmutableIndexedInputs();
   if (index >= inputs.size()) {
     return TRITONSERVER_ErrorNew(
         TRITONSERVER_ERROR_INVALID_ARG,
@@ -919,21 +1300,104 @@ TRITONBACKEND_RequestInputByIndex(
             .c_str());
   }
 
-  // The request inputs are not allowed to change once the request
-  // makes it to the backend, so it is ok to just iterate through the
-  // map. This linear search is the best we can do given the need for
-  // the inputs to be in a map and given the typical small number of
-  // inputs is better than having every request maintain the inputs as
-  // both map and vector.
-  uint32_t cnt = 0;
-  for (const auto& pr : inputs) {
-    if (cnt++ == index) {
-      InferenceRequest::Input* in = pr.second;
-      *input = reinterpret_cast<TRITONBACKEND_Input*>(in);
-      break;
+  *input = reinterpret_cast<TRITONBACKEND_Input*>(inputs[index]);
+
+  return nullptr;  // success
+}
+
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONBACKEND_RequestsInputBatch(
+    TRITONBACKEND_Request** requests, const uint32_t request_count,
+    const char* name, void* buffer, const uint64_t buffer_byte_size,
+    const TRITONSERVER_MemoryType memory_type, const int64_t memory_type_id,
+    void* cuda_stream, const void** batch_buffer, uint64_t* batch_byte_size,
+    bool* cuda_used)
+{
+  *batch_buffer = nullptr;
+  *batch_byte_size = 0;
+  *cuda_used = false;
+
+  std::vector<const void*> src;
+  std::vector<TRITONSERVER_MemoryType> src_memory_type;
+  std::vector<int64_t> src_memory_type_id;
+  std::vector<uint64_t> byte_size;
+  const bool host_memory = (memory_type != TRITONSERVER_MEMORY_GPU);
+  bool in_place = true;
+  for (uint32_t r = 0; r < request_count; ++r) {
+    InferenceRequest* tr = reinterpret_cast<InferenceRequest*>(requests[r]);
+    const auto& inputs = tr->ImmutableInputs();
+    const auto& itr = inputs.find(name);
+    if (itr == inputs.end()) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (tr->LogRequest() + "unknown request input name " + name).c_str());
+    }
+
+    const InferenceRequest::Input* in = itr->second;
+    for (size_t idx = 0; idx < in->DataBufferCount(); ++idx) {
+      const void* base;
+      size_t chunk_byte_size;
+      TRITONSERVER_MemoryType chunk_memory_type = memory_type;
+      int64_t chunk_memory_type_id = memory_type_id;
+      RETURN_TRITONSERVER_ERROR_IF_ERROR(in->DataBuffer(
+          idx, &base, &chunk_byte_size, &chunk_memory_type,
+          &chunk_memory_type_id));
+      if (chunk_byte_size == 0) {
+        continue;
+      }
+
+      // The data can be used in place if every chunk is in the requested
+      // memory and continues the previous chunk.
+      const bool same_memory =
+          host_memory ? (chunk_memory_type != TRITONSERVER_MEMORY_GPU)
+                      : ((chunk_memory_type == memory_type) &&
+                         (chunk_memory_type_id == memory_type_id));
+      in_place &= same_memory &&
+                  (src.empty() ||
+                   (base == (static_cast<const char*>(src.front()) +
+                             *batch_byte_size)));
+
+      src.push_back(base);
+      src_memory_type.push_back(chunk_memory_type);
+      src_memory_type_id.push_back(chunk_memory_type_id);
+      byte_size.push_back(chunk_byte_size);
+      *batch_byte_size += chunk_byte_size;
     }
   }
 
+  if (src.empty()) {
+    return nullptr;  // success
+  }
+  if (in_place) {
+    *batch_buffer = src.front();
+    return nullptr;  // success
+  }
+  if (buffer == nullptr) {
+    return nullptr;  // success
+  }
+  if (buffer_byte_size < *batch_byte_size) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        (std::string("buffer of ") + std::to_string(buffer_byte_size) +
+         " bytes is too small for the " + std::to_string(*batch_byte_size) +
+         " bytes of input '" + name + "'")
+            .c_str());
+  }
+
+  std::vector<void*> dst;
+  dst.reserve(src.size());
+  uint64_t offset = 0;
+  for (const uint64_t chunk_byte_size : byte_size) {
+    dst.push_back(static_cast<char*>(buffer) + offset);
+    offset += chunk_byte_size;
+  }
+  RETURN_TRITONSERVER_ERROR_IF_ERROR(CopyBatch(
+      src.size(), src.data(), src_memory_type.data(),
+      src_memory_type_id.data(), dst.data(), byte_size.data(), memory_type,
+      memory_type_id, reinterpret_cast<cudaStream_t>(cuda_stream),
+      cuda_used));
+  *batch_buffer = buffer;
+
   return nullptr;  // success
 }
 
@@ -1465,6 +1929,90 @@ TRITONBACKEND_InputBufferForHostPolicy(
 ///
 /// TRITONBACKEND_Output
 ///
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONBACKEND_OutputBufferBatch(
+    TRITONBACKEND_Output** outputs, const uint32_t output_count,
+    const uint64_t* byte_size, const TRITONSERVER_MemoryType memory_type,
+    const int64_t memory_type_id, void** buffers,
+    TRITONSERVER_MemoryType* buffer_memory_type,
+    int64_t* buffer_memory_type_id, void** batch_buffer)
+{
+  *batch_buffer = nullptr;
+
+  uint64_t total_byte_size = 0;
+  bool borrow = (memory_type != TRITONSERVER_MEMORY_GPU);
+  for (uint32_t idx = 0; idx < output_count; ++idx) {
+    InferenceResponse::Output* to =
+        reinterpret_cast<InferenceResponse::Output*>(outputs[idx]);
+    total_byte_size += byte_size[idx];
+    borrow &= to->CanBorrowDataBuffer();
+  }
+  if ((output_count == 0) || (total_byte_size == 0)) {
+    return nullptr;  // success
+  }
+
+  // Allocate a single region and let each output borrow its slice, the
+  // region is freed once every response is done with it.
+  if (borrow) {
+    void* region = nullptr;
+    TRITONSERVER_MemoryType region_memory_type = memory_type;
+    std::shared_ptr<void> owner;
+    if (memory_type == TRITONSERVER_MEMORY_CPU_PINNED) {
+      RETURN_TRITONSERVER_ERROR_IF_ERROR(PinnedMemoryManager::Alloc(
+          &region, total_byte_size, &region_memory_type,
+          true /* allow_nonpinned_fallback */));
+      owner.reset(region, [](void* p) { PinnedMemoryManager::Free(p); });
+    } else {
+      region = malloc(total_byte_size);
+      if (region == nullptr) {
+        return TRITONSERVER_ErrorNew(
+            TRITONSERVER_ERROR_INTERNAL,
+            "failed to allocate batched output buffer");
+      }
+      owner.reset(region, free);
+    }
+
+    uint64_t offset = 0;
+    for (uint32_t idx = 0; idx < output_count; ++idx) {
+      InferenceResponse::Output* to =
+          reinterpret_cast<InferenceResponse::Output*>(outputs[idx]);
+      buffers[idx] = static_cast<char*>(region) + offset;
+      buffer_memory_type[idx] = region_memory_type;
+      buffer_memory_type_id[idx] = 0;
+      RETURN_TRITONSERVER_ERROR_IF_ERROR(to->BorrowDataBuffer(
+          buffers[idx], byte_size[idx], region_memory_type,
+          0 /* memory_type_id */, owner));
+      offset += byte_size[idx];
+    }
+    *batch_buffer = region;
+    return nullptr;  // success
+  }
+
+  // Allocate through the response allocators, the buffers can still be
+  // written as one if the allocators place them one after another.
+  bool contiguous = true;
+  uint64_t offset = 0;
+  for (uint32_t idx = 0; idx < output_count; ++idx) {
+    InferenceResponse::Output* to =
+        reinterpret_cast<InferenceResponse::Output*>(outputs[idx]);
+    buffer_memory_type[idx] = memory_type;
+    buffer_memory_type_id[idx] = memory_type_id;
+    RETURN_TRITONSERVER_ERROR_IF_ERROR(to->AllocateDataBuffer(
+        &buffers[idx], byte_size[idx], &buffer_memory_type[idx],
+        &buffer_memory_type_id[idx]));
+    contiguous &=
+        (buffer_memory_type[idx] == memory_type) &&
+        (buffer_memory_type_id[idx] == memory_type_id) &&
+        (buffers[idx] == (static_cast<char*>(buffers[0]) + offset));
+    offset += byte_size[idx];
+  }
+  if (contiguous) {
+    *batch_buffer = buffers[0];
+  }
+
+  return nullptr;  // success
+}
+
 TRITONAPI_DECLSPEC TRITONSERVER_Error*
 TRITONBACKEND_OutputBuffer(
     TRITONBACKEND_Output* output, void** buffer,
@@ -25,8 +25,13 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include "artifact_mapper.h"
 #include "backend_manager.h"
 #include "backend_model_instance.h"
 #include "filesystem/api.h"
@@ -61,14 +66,37 @@ class TritonModel : public Model {
       const triton::common::BackendCmdlineConfigMap& backend_cmdline_config_map,
       const triton::common::HostPolicyCmdlineConfigMap& host_policy_map,
       const int64_t version, inference::ModelConfig model_config,
-      const bool is_config_provided, std::unique_ptr<TritonModel>* model);
+      const bool is_config_provided, const bool skip_warmup,
+      std::unique_ptr<TritonModel>* model);
   ~TritonModel();
 
-  // Return path to the localized model directory.
+  // Load and initialize the backend 'backend_name' from the global
+  // backends directory so that the first model using it doesn't pay for
+  // the backend initialization.
+  static Status PreloadBackend(
+      InferenceServer* server, const std::string& backend_name,
+      const triton::common::BackendCmdlineConfigMap&
+          backend_cmdline_config_map);
+
+  // Return path to the localized model directory. If the artifacts of
+  // the model are streamed this is the path in the remote repository.
   const std::string& LocalizedModelPath() const
   {
     return localized_model_dir_->Path();
   }
+  // Return whether the artifacts of the model are read from the remote
+  // repository instead of being localized.
+  bool StreamsArtifacts() const { return stream_artifacts_; }
+  // Return whether the instances being created skip their warm-up.
+  bool SkipsWarmup() const { return skip_warmup_; }
+  // Map the model file 'path', relative to the model directory, through
+  // the shared artifact mappings. The mapping is kept until UnmapFile() or
+  // until the model is destroyed.
+  Status MapFile(
+      const std::string& path, const bool huge_pages, const void** base,
+      uint64_t* byte_size);
+  // Release a mapping returned by MapFile().
+  Status UnmapFile(const void* base);
   // Return pointer to the underlying server.
   InferenceServer* Server() { return server_; }
   // Return whether the backend should attempt to auto-complete the model config
@@ -106,7 +134,7 @@ class TritonModel : public Model {
 
   // Update instance group. 'caller_lock' will be released when creating new
   // instances and re-held when returning, to allow atomic switch over to the
-  // new instances.
+  // new instances. 'caller_lock' may be nullptr if the caller holds no lock.
   Status UpdateInstanceGroup(
       const inference::ModelConfig& new_model_config,
       std::unique_lock<std::mutex>* caller_lock);
@@ -132,6 +160,19 @@ class TritonModel : public Model {
   // Replace the foreground instances with background instances.
   Status CommitInstances();
 
+  // Start the thread that scales the instance count of the first instance
+  // group with the load, if enabled by the "TRITON_AUTOSCALE_*" model
+  // parameters, and that promotes and demotes the passive instances as
+  // hot standbys if "TRITON_PASSIVE_STANDBY" is set.
+  Status StartAutoscaler();
+  void AutoscaleThread(
+      const int64_t min_count, const int64_t max_count,
+      const uint64_t interval_ms, const bool standby);
+  // Promote one more passive instance, or demote the last promoted one.
+  // Return false if there is no instance to promote or demote.
+  bool PromoteStandby();
+  bool DemoteStandby();
+
   // Gets the execution policy setting from the backend.
   Status GetExecutionPolicy(const inference::ModelConfig& model_config);
 
@@ -199,6 +240,18 @@ class TritonModel : public Model {
   // required creation of a temporary local copy then that copy will
   // persist as along as this object is retained by this model.
   std::shared_ptr<LocalizedPath> localized_model_dir_;
+  // Whether 'localized_model_dir_' is the remote model directory, whose
+  // artifacts are streamed to the backend.
+  bool stream_artifacts_ = false;
+  // Whether the instances created with the model skip the warm-up, set
+  // when the same model was already warmed up by an earlier run.
+  bool skip_warmup_ = false;
+
+  // The file mappings held on behalf of the backend, by their base.
+  std::mutex mapped_files_mu_;
+  std::unordered_multimap<
+      const void*, std::shared_ptr<const ArtifactMapper::Mapping>>
+      mapped_files_;
 
   // Backend used by this model.
   std::shared_ptr<TritonBackend> backend_;
@@ -224,6 +277,15 @@ class TritonModel : public Model {
   TritonModelBatcherInitFn_t batcher_init_fn_ = nullptr;
   TritonModelBatcherFiniFn_t batcher_fini_fn_ = nullptr;
   TRITONBACKEND_Batcher* batcher_ = nullptr;
+
+  // Serializes the updates of the instance group.
+  std::mutex instance_group_mu_;
+
+  // The autoscaler thread and its exit signal.
+  std::thread autoscale_thread_;
+  std::mutex autoscale_mu_;
+  std::condition_variable autoscale_cv_;
+  bool autoscale_exit_ = false;
 };
 
 }}  // namespace triton::core
@@ -31,16 +31,21 @@
 #include <sys/syscall.h>
 #include <unistd.h>
 #endif
+
+#include <algorithm>
+#include <chrono>
+#include <set>
 #include "backend_config.h"
 #include "backend_model.h"
+#include "clock.h"
 #include "cuda_utils.h"
 #include "metrics.h"
 #include "model_config.pb.h"
 #include "numa_utils.h"
+#include "profiling.h"
 #include "server.h"
 #include "shared_library.h"
 #include "triton/common/logging.h"
-#include "triton/common/nvtx.h"
 #include "tritonserver_apis.h"
 
 // For unknown reason, windows will not export the TRITONBACKEND_*
@@ -58,6 +63,10 @@
 namespace triton { namespace core {
 
 namespace {
+// Execution time granted to an instance of priority 1 in each round of
+// the backend thread fair scheduling.
+constexpr int64_t DRR_QUANTUM_NS = 10 * 1000 * 1000;
+
 // Utilities for warmup feature
 TRITONSERVER_Error*
 WarmupResponseAlloc(
@@ -134,6 +143,70 @@ WarmupRequestComplete(
   }
 }
 
+void
+AsyncExecuteComplete(void* userp)
+{
+  std::unique_ptr<std::function<void()>> on_complete(
+      reinterpret_cast<std::function<void()>*>(userp));
+  (*on_complete)();
+}
+
+// Return the warmup settings of the automatic warmup enabled by the
+// "TRITON_AUTO_WARMUP" model parameter. A zero-filled sample is run for
+// batch size 1, each preferred batch size and the max batch size.
+Status
+AutoWarmupSettings(
+    const inference::ModelConfig& config,
+    std::vector<inference::ModelWarmup>* settings)
+{
+  settings->clear();
+  bool auto_warmup = false;
+  RETURN_IF_ERROR(GetBoolModelParameter(
+      config, "TRITON_AUTO_WARMUP", false /* default_value */,
+      &auto_warmup));
+  if (!auto_warmup) {
+    return Status::Success;
+  }
+
+  // The samples can't provide the control inputs and state of a sequence
+  if (config.has_sequence_batching()) {
+    LOG_WARNING << "Skipping automatic warmup for model '" << config.name()
+                << "', it is not supported for sequence batching";
+    return Status::Success;
+  }
+  for (const auto& input : config.input()) {
+    if (triton::common::GetElementCount(input.dims()) == -1) {
+      LOG_WARNING << "Skipping automatic warmup for model '" << config.name()
+                  << "', input '" << input.name()
+                  << "' has variable-size dimensions";
+      return Status::Success;
+    }
+  }
+
+  std::set<uint32_t> batch_sizes{1};
+  if (config.max_batch_size() > 0) {
+    batch_sizes.insert(config.max_batch_size());
+    for (const auto pbs : config.dynamic_batching().preferred_batch_size()) {
+      batch_sizes.insert(pbs);
+    }
+  }
+  for (const auto batch_size : batch_sizes) {
+    settings->emplace_back();
+    auto& setting = settings->back();
+    setting.set_name("auto_batch_" + std::to_string(batch_size));
+    setting.set_batch_size(batch_size);
+    setting.set_count(1);
+    for (const auto& input : config.input()) {
+      auto& warmup_input = (*setting.mutable_inputs())[input.name()];
+      warmup_input.set_data_type(input.data_type());
+      *warmup_input.mutable_dims() = input.dims();
+      warmup_input.set_zero_data(true);
+    }
+  }
+
+  return Status::Success;
+}
+
 bool
 ShareBackendThread(
     const bool device_blocking, const TRITONSERVER_InstanceGroupKind kind)
@@ -153,8 +226,18 @@ TritonModelInstance::TritonModelInstance(
     : model_(model), name_(name), signature_(signature), kind_(kind),
       device_id_(device_id), host_policy_(host_policy),
       host_policy_message_(host_policy_message), profile_names_(profile_names),
-      passive_(passive), secondary_devices_(secondary_devices), state_(nullptr)
+      passive_(passive), secondary_devices_(secondary_devices), state_(nullptr),
+      parallel_warmup_(false), promoted_(false), execution_failure_count_(0)
 {
+  device_ids_.push_back(device_id_);
+  if (kind_ == TRITONSERVER_INSTANCEGROUPKIND_GPU) {
+    for (const auto& secondary_device : secondary_devices_) {
+      if (secondary_device.kind_ == SecondaryDevice::kGpuKind) {
+        device_ids_.push_back(secondary_device.id_);
+      }
+    }
+  }
+
 #ifdef TRITON_ENABLE_METRICS
   if (Metrics::Enabled()) {
     // Use an ID in the metric only for GPU instances. Otherwise use
@@ -207,6 +290,25 @@ TritonModelInstance::SetInstances(
 
   static triton::common::HostPolicyCmdlineConfig empty_host_policy;
 
+  // The new instances whose warm-up runs in parallel with the creation
+  // of the other instances.
+  std::vector<std::shared_ptr<TritonModelInstance>> warming_up_instances;
+
+  // A GPU instance runs on this many consecutive GPUs starting at its
+  // device, for models that shard across GPUs. The other GPUs are given
+  // to the backend as secondary devices. ValidateInstanceGroup() makes sure
+  // that the spanned GPUs exist and that the spans don't overlap.
+  int64_t gpu_span = 1;
+  RETURN_IF_ERROR(GetInt64ModelParameter(
+      model_config, "TRITON_INSTANCE_GPU_SPAN", 1 /* default_value */,
+      &gpu_span));
+  if (gpu_span < 1) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "TRITON_INSTANCE_GPU_SPAN must be at least 1, got " +
+            std::to_string(gpu_span));
+  }
+
   for (const auto& group : model_config.instance_group()) {
     std::vector<std::string> profile_names;
     for (const auto& profile_name : group.profile()) {
@@ -257,11 +359,23 @@ TritonModelInstance::SetInstances(
         const auto& kind = std::get<1>(is);
         const auto& id = std::get<2>(is);
 
+        std::vector<SecondaryDevice> instance_secondary_devices(
+            secondary_devices);
+        std::vector<int32_t> device_ids{id};
+        if (kind == TRITONSERVER_INSTANCEGROUPKIND_GPU) {
+          for (int32_t offset = 1; offset < gpu_span; ++offset) {
+            instance_secondary_devices.emplace_back(
+                SecondaryDevice::kGpuKind, id + offset);
+            device_ids.push_back(id + offset);
+          }
+        }
+
         const Signature signature(group, id);
         // Check if an existing instance can be re-used.
         if (!ShareBackendThread(model->DeviceBlocking(), kind)) {
           auto itr = existing_instances.find(signature);
-          if (itr != existing_instances.end() && !itr->second.empty()) {
+          if (itr != existing_instances.end() && !itr->second.empty() &&
+              (itr->second.back()->DeviceIds() == device_ids)) {
             auto existing_instance = itr->second.back();
             itr->second.pop_back();
             LOG_VERBOSE(2) << "Re-using model instance named '"
@@ -286,10 +400,13 @@ TritonModelInstance::SetInstances(
         RETURN_IF_ERROR(SetNumaConfigOnThread(*host_policy));
         auto err = CreateInstance(
             model, instance_name, signature, kind, id, profile_names, passive,
-            policy_name, *host_policy, *(std::get<3>(is)), secondary_devices,
-            &new_instance);
+            policy_name, *host_policy, *(std::get<3>(is)),
+            instance_secondary_devices, &new_instance);
         RETURN_IF_ERROR(ResetNumaMemoryPolicy());
         RETURN_IF_ERROR(err);
+        if (new_instance->warmup_payload_ != nullptr) {
+          warming_up_instances.push_back(new_instance);
+        }
         RETURN_IF_ERROR(
             model->RegisterInstance(std::move(new_instance), passive));
 
@@ -300,27 +417,33 @@ TritonModelInstance::SetInstances(
         // the limit. If we check before loading, we may create instance
         // that occupies the rest of available memory which against the purpose
         if (kind == TRITONSERVER_INSTANCEGROUPKIND_GPU) {
-          size_t free, total;
-          double memory_limit;
-          RETURN_IF_ERROR(GetDeviceMemoryInfo(id, &free, &total));
-          RETURN_IF_ERROR(BackendConfigurationModelLoadGpuFraction(
-              backend_cmdline_config_map, id, &memory_limit));
-          const size_t allow = total * memory_limit;
-          const size_t used = total - free;
-          if (used > allow) {
-            return Status(
-                Status::Code::UNAVAILABLE,
-                std::string("can not create model '") + instance_name +
-                    "': memory limit set for " +
-                    TRITONSERVER_InstanceGroupKindString(kind) + " " +
-                    std::to_string(id) +
-                    " has exceeded, model loading is rejected.");
+          for (const int32_t device_id : device_ids) {
+            size_t free, total;
+            double memory_limit;
+            RETURN_IF_ERROR(GetDeviceMemoryInfo(device_id, &free, &total));
+            RETURN_IF_ERROR(BackendConfigurationModelLoadGpuFraction(
+                backend_cmdline_config_map, device_id, &memory_limit));
+            const size_t allow = total * memory_limit;
+            const size_t used = total - free;
+            if (used > allow) {
+              return Status(
+                  Status::Code::UNAVAILABLE,
+                  std::string("can not create model '") + instance_name +
+                      "': memory limit set for " +
+                      TRITONSERVER_InstanceGroupKindString(kind) + " " +
+                      std::to_string(device_id) +
+                      " has exceeded, model loading is rejected.");
+            }
           }
         }
       }
     }
   }
 
+  for (const auto& instance : warming_up_instances) {
+    RETURN_IF_ERROR(instance->WaitForWarmUp());
+  }
+
   return Status::Success;
 }
 
@@ -386,7 +509,10 @@ TritonModelInstance::CreateInstance(
     RETURN_IF_ERROR(model->Server()->GetRateLimiter()->RegisterModelInstance(
         local_instance.get(), rate_limiter_config));
     RETURN_IF_ERROR(local_instance->SetBackendThread(
-        kind, device_id, model->DeviceBlocking()));
+        kind, device_id, model->DeviceBlocking(),
+        rate_limiter_config.priority()));
+  } else {
+    local_instance->rate_limiter_config_ = rate_limiter_config;
   }
 
   triton_model_instance->reset(local_instance.release());
@@ -394,10 +520,63 @@ TritonModelInstance::CreateInstance(
   return Status::Success;
 }
 
+Status
+TritonModelInstance::Promote()
+{
+  if (!passive_ || promoted_) {
+    return Status::Success;
+  }
+
+  RETURN_IF_ERROR(model_->Server()->GetRateLimiter()->RegisterModelInstance(
+      this, rate_limiter_config_));
+  // A dedicated thread lets the instance be demoted without stopping the
+  // thread of any other instance.
+  std::unique_ptr<TritonBackendThread> local_backend_thread;
+  Status status = TritonBackendThread::CreateBackendThread(
+      Name(), this, 0 /* nice */, device_id_, rate_limiter_config_.priority(),
+      &local_backend_thread);
+  if (status.IsOk()) {
+    triton_backend_thread_ = std::move(local_backend_thread);
+    status = triton_backend_thread_->InitAndWarmUpModelInstance(this);
+  }
+  if (!status.IsOk()) {
+    if (triton_backend_thread_ != nullptr) {
+      triton_backend_thread_->StopBackendThread();
+      triton_backend_thread_.reset();
+    }
+    LOG_STATUS_ERROR(
+        model_->Server()->GetRateLimiter()->UnregisterModelInstance(this),
+        "failed unregistering model instance");
+    return status;
+  }
+
+  promoted_ = true;
+  LOG_VERBOSE(1) << "Promoted passive instance " << Name();
+  return Status::Success;
+}
+
+Status
+TritonModelInstance::Demote()
+{
+  if (!promoted_) {
+    return Status::Success;
+  }
+
+  // The backend thread finishes the payloads already scheduled on the
+  // instance before it exits.
+  triton_backend_thread_->StopBackendThread();
+  triton_backend_thread_.reset();
+  promoted_ = false;
+  RETURN_IF_ERROR(
+      model_->Server()->GetRateLimiter()->UnregisterModelInstance(this));
+  LOG_VERBOSE(1) << "Demoted passive instance " << Name();
+  return Status::Success;
+}
+
 Status
 TritonModelInstance::SetBackendThread(
     const TRITONSERVER_InstanceGroupKind kind, const int32_t device_id,
-    const bool device_blocking)
+    const bool device_blocking, const uint32_t priority)
 {
   if (ShareBackendThread(device_blocking, kind)) {
     auto device_instances = model_->GetInstancesByDevice(device_id);
@@ -410,10 +589,11 @@ TritonModelInstance::SetBackendThread(
   if (triton_backend_thread_.get() == nullptr) {
     std::unique_ptr<TritonBackendThread> local_backend_thread;
     RETURN_IF_ERROR(TritonBackendThread::CreateBackendThread(
-        Name(), this, 0 /* nice */, device_id, &local_backend_thread));
+        Name(), this, 0 /* nice */, device_id, priority,
+        &local_backend_thread));
     triton_backend_thread_ = std::move(local_backend_thread);
   } else {
-    triton_backend_thread_->AddModelInstance(this);
+    triton_backend_thread_->AddModelInstance(this, priority);
   }
   RETURN_IF_ERROR(triton_backend_thread_->InitAndWarmUpModelInstance(this));
 
@@ -424,7 +604,27 @@ Status
 TritonModelInstance::GenerateWarmupData()
 {
   warmup_samples_.clear();
+  if (model_->SkipsWarmup()) {
+    LOG_VERBOSE(1) << "Skipping warmup of model '" << model_->Name()
+                   << "', it was warmed up by an earlier run";
+    return Status::Success;
+  }
+
+  // The automatic warmup samples run after the configured ones, and the
+  // instances then warm up in parallel.
+  std::vector<inference::ModelWarmup> auto_settings;
+  RETURN_IF_ERROR(AutoWarmupSettings(model_->Config(), &auto_settings));
+  parallel_warmup_ = !auto_settings.empty();
+  std::vector<const inference::ModelWarmup*> warmup_settings;
   for (const auto& warmup_setting : model_->Config().model_warmup()) {
+    warmup_settings.push_back(&warmup_setting);
+  }
+  for (const auto& warmup_setting : auto_settings) {
+    warmup_settings.push_back(&warmup_setting);
+  }
+
+  for (const auto* setting : warmup_settings) {
+    const auto& warmup_setting = *setting;
     if (warmup_setting.batch_size() == 0) {
       LOG_VERBOSE(1) << "Skipping batch 0 warmup sample '"
                      << warmup_setting.name() << "'";
@@ -506,6 +706,7 @@ TritonModelInstance::GenerateWarmupData()
       warmup_data.requests_.emplace_back(
           new InferenceRequest(model_, model_->Version()));
       auto& lrequest = warmup_data.requests_.back();
+      lrequest->SetWarmup(true);
 
       // Second pass to prepare original inputs.
       std::vector<std::shared_ptr<InferenceRequest::Input>> input_sps;
@@ -606,6 +807,17 @@ TritonModelInstance::GenerateWarmupData()
   return Status::Success;
 }
 
+Status
+TritonModelInstance::WaitForWarmUp()
+{
+  if (warmup_payload_ == nullptr) {
+    return Status::Success;
+  }
+  std::shared_ptr<Payload> warmup_payload = std::move(warmup_payload_);
+  warmup_payload_.reset();
+  return warmup_payload->Wait();
+}
+
 void
 TritonModelInstance::Schedule(
     std::vector<std::unique_ptr<InferenceRequest>>&& requests,
@@ -618,6 +830,7 @@ TritonModelInstance::Schedule(
   for (auto& r : requests) {
     // Load the input states for the inference request.
     r->LoadInputStates();
+    r->CaptureExecutionStartNs();
     triton_requests.push_back(
         reinterpret_cast<TRITONBACKEND_Request*>(r.release()));
   }
@@ -627,6 +840,58 @@ TritonModelInstance::Schedule(
   OnCompletion();
 }
 
+bool
+TritonModelInstance::ExecutesAsync() const
+{
+  return model_->Backend()->ModelInstanceExecAsyncFn() != nullptr;
+}
+
+void
+TritonModelInstance::ScheduleAsync(
+    std::vector<std::unique_ptr<InferenceRequest>>&& requests,
+    std::function<void()>&& OnCompletion)
+{
+  thread_local std::vector<TRITONBACKEND_Request*> triton_requests(1024);
+  triton_requests.clear();
+  for (auto& r : requests) {
+    // Load the input states for the inference request.
+    r->LoadInputStates();
+    r->CaptureExecutionStartNs();
+    triton_requests.push_back(
+        reinterpret_cast<TRITONBACKEND_Request*>(r.release()));
+  }
+
+  ExecuteAsync(triton_requests, std::move(OnCompletion));
+}
+
+void
+TritonModelInstance::Prefetch(
+    const std::vector<std::unique_ptr<InferenceRequest>>& requests)
+{
+  TritonBackend::TritonModelInstancePrefetchFn_t inst_prefetch_fn =
+      model_->Backend()->ModelInstancePrefetchFn();
+  if ((inst_prefetch_fn == nullptr) || requests.empty()) {
+    return;
+  }
+
+  thread_local std::vector<TRITONBACKEND_Request*> triton_requests;
+  triton_requests.clear();
+  for (const auto& r : requests) {
+    triton_requests.push_back(
+        reinterpret_cast<TRITONBACKEND_Request*>(r.get()));
+  }
+
+  // The requests are still executed if they can't be prefetched
+  TRITONSERVER_Error* err = inst_prefetch_fn(
+      reinterpret_cast<TRITONBACKEND_ModelInstance*>(this),
+      &triton_requests[0], triton_requests.size());
+  if (err != nullptr) {
+    LOG_VERBOSE(1) << "failed to prefetch requests on instance " << Name()
+                   << ": " << TRITONSERVER_ErrorMessage(err);
+    TRITONSERVER_ErrorDelete(err);
+  }
+}
+
 Status
 TritonModelInstance::Initialize()
 {
@@ -703,6 +968,8 @@ void
 TritonModelInstance::Execute(
     std::vector<TRITONBACKEND_Request*>& triton_requests)
 {
+  PROFILE_RANGE(range, "Execute");
+
   TRITONBACKEND_ModelInstance* triton_model_instance =
       reinterpret_cast<TRITONBACKEND_ModelInstance*>(this);
   TritonBackend::TritonModelInstanceExecFn_t inst_exec_fn =
@@ -713,6 +980,44 @@ TritonModelInstance::Execute(
   TRITONSERVER_Error* err = inst_exec_fn(
       triton_model_instance, &triton_requests[0], triton_requests.size());
   if (err != nullptr) {
+    ++execution_failure_count_;
+    Status status = Status(
+        TritonCodeToStatusCode(TRITONSERVER_ErrorCode(err)),
+        TRITONSERVER_ErrorMessage(err));
+    for (TRITONBACKEND_Request* tr : triton_requests) {
+      std::unique_ptr<InferenceRequest> ur(
+          reinterpret_cast<InferenceRequest*>(tr));
+      InferenceRequest::RespondIfError(ur, status, true /* release_requests */);
+    }
+
+    TRITONSERVER_ErrorDelete(err);
+  }
+}
+
+void
+TritonModelInstance::ExecuteAsync(
+    std::vector<TRITONBACKEND_Request*>& triton_requests,
+    std::function<void()>&& OnCompletion)
+{
+  PROFILE_RANGE(range, "ExecuteAsync");
+
+  TRITONBACKEND_ModelInstance* triton_model_instance =
+      reinterpret_cast<TRITONBACKEND_ModelInstance*>(this);
+  TritonBackend::TritonModelInstanceExecAsyncFn_t inst_exec_async_fn =
+      model_->Backend()->ModelInstanceExecAsyncFn();
+
+  // Owned by the backend until it calls the complete function
+  std::function<void()>* on_complete =
+      new std::function<void()>(std::move(OnCompletion));
+
+  // If there is an error then we retain ownership of 'requests'
+  // and must send error responses, the backend will not complete the
+  // execution.
+  TRITONSERVER_Error* err = inst_exec_async_fn(
+      triton_model_instance, &triton_requests[0], triton_requests.size(),
+      AsyncExecuteComplete, reinterpret_cast<void*>(on_complete));
+  if (err != nullptr) {
+    ++execution_failure_count_;
     Status status = Status(
         TritonCodeToStatusCode(TRITONSERVER_ErrorCode(err)),
         TRITONSERVER_ErrorMessage(err));
@@ -723,23 +1028,29 @@ TritonModelInstance::Execute(
     }
 
     TRITONSERVER_ErrorDelete(err);
+    AsyncExecuteComplete(reinterpret_cast<void*>(on_complete));
   }
 }
 
 Status
 TritonModelInstance::TritonBackendThread::CreateBackendThread(
     const std::string name, TritonModelInstance* model_instance, const int nice,
-    const int32_t device_id,
+    const int32_t device_id, const uint32_t priority,
     std::unique_ptr<TritonBackendThread>* triton_backend_thread)
 {
   TritonBackendThread* raw_triton_backend_thread =
       new TritonBackendThread(name, model_instance->Model(), nice, device_id);
   std::unique_ptr<TritonBackendThread> runner(raw_triton_backend_thread);
 
-  runner->AddModelInstance(model_instance);
+  runner->AddModelInstance(model_instance, priority);
   runner->backend_thread_ = std::thread([raw_triton_backend_thread]() {
     raw_triton_backend_thread->BackendThread();
   });
+  if (runner->pipelined_) {
+    runner->prepare_thread_ = std::thread([raw_triton_backend_thread]() {
+      raw_triton_backend_thread->PrepareThread();
+    });
+  }
 
   triton_backend_thread->reset(runner.release());
 
@@ -748,11 +1059,60 @@ TritonModelInstance::TritonBackendThread::CreateBackendThread(
 
 void
 TritonModelInstance::TritonBackendThread::AddModelInstance(
-    TritonModelInstance* model_instance)
+    TritonModelInstance* model_instance, const uint32_t priority)
 {
+  {
+    std::lock_guard<std::mutex> lk(shares_mu_);
+    const int64_t quantum_ns =
+        DRR_QUANTUM_NS / std::max(priority, (uint32_t)1);
+    shares_[model_instance] = InstanceShare{quantum_ns, quantum_ns};
+  }
   model_instances_.push_back(model_instance);
 }
 
+void
+TritonModelInstance::TritonBackendThread::OrderIdleInstances()
+{
+  std::lock_guard<std::mutex> lk(shares_mu_);
+  auto deficit = [this](const TritonModelInstance* instance) {
+    auto it = shares_.find(instance);
+    return (it != shares_.end()) ? it->second.deficit_ns_ : 0;
+  };
+
+  bool has_time_left = false;
+  for (const auto instance : model_instances_) {
+    if (deficit(instance) > 0) {
+      has_time_left = true;
+      break;
+    }
+  }
+  if (!has_time_left) {
+    // An instance that didn't use its time can't carry more than one
+    // quantum into the next round.
+    for (auto& share : shares_) {
+      share.second.deficit_ns_ = std::min(
+          share.second.deficit_ns_ + share.second.quantum_ns_,
+          share.second.quantum_ns_);
+    }
+  }
+  std::stable_sort(
+      model_instances_.begin(), model_instances_.end(),
+      [&deficit](const TritonModelInstance* a, const TritonModelInstance* b) {
+        return deficit(a) > deficit(b);
+      });
+}
+
+void
+TritonModelInstance::TritonBackendThread::ChargeInstance(
+    const TritonModelInstance* model_instance, const uint64_t exec_ns)
+{
+  std::lock_guard<std::mutex> lk(shares_mu_);
+  auto it = shares_.find(model_instance);
+  if (it != shares_.end()) {
+    it->second.deficit_ns_ -= (int64_t)exec_ns;
+  }
+}
+
 Status
 TritonModelInstance::TritonBackendThread::InitAndWarmUpModelInstance(
     TritonModelInstance* model_instance)
@@ -769,6 +1129,10 @@ TritonModelInstance::TritonBackendThread::InitAndWarmUpModelInstance(
       Payload::Operation::WARM_UP, model_instance);
   RETURN_IF_ERROR(model_->Server()->GetRateLimiter()->EnqueuePayload(
       model_, warmup_payload));
+  if (model_instance->parallel_warmup_) {
+    model_instance->warmup_payload_ = std::move(warmup_payload);
+    return Status::Success;
+  }
   RETURN_IF_ERROR(warmup_payload->Wait());
 
   return Status::Success;
@@ -777,8 +1141,27 @@ TritonModelInstance::TritonBackendThread::InitAndWarmUpModelInstance(
 TritonModelInstance::TritonBackendThread::TritonBackendThread(
     const std::string& name, TritonModel* model, const int nice,
     const int32_t device_id)
-    : name_(name), nice_(nice), device_id_(device_id), model_(model)
+    : name_(name), nice_(nice), device_id_(device_id), model_(model),
+      fair_scheduling_(false), pipelined_(false)
 {
+  auto status = GetBoolModelParameter(
+      model_->Config(), "TRITON_BACKEND_THREAD_FAIR_SCHEDULING",
+      false /* default_value */, &fair_scheduling_);
+  if (!status.IsOk()) {
+    LOG_WARNING << "Failed to read fair scheduling parameter for backend "
+                   "thread "
+                << name_ << ": " << status.Message();
+    fair_scheduling_ = false;
+  }
+
+  status = GetBoolModelParameter(
+      model_->Config(), "TRITON_BACKEND_THREAD_PIPELINE",
+      false /* default_value */, &pipelined_);
+  if (!status.IsOk()) {
+    LOG_WARNING << "Failed to read pipeline parameter for backend thread "
+                << name_ << ": " << status.Message();
+    pipelined_ = false;
+  }
 }
 
 TritonModelInstance::TritonBackendThread::~TritonBackendThread()
@@ -795,6 +1178,9 @@ TritonModelInstance::TritonBackendThread::StopBackendThread()
         Payload::Operation::EXIT, model_instances_.back());
     model_->Server()->GetRateLimiter()->EnqueuePayload(model_, exit_payload);
     backend_thread_.join();
+    if (prepare_thread_.joinable()) {
+      prepare_thread_.join();
+    }
   }
 }
 
@@ -815,20 +1201,107 @@ TritonModelInstance::TritonBackendThread::BackendThread()
                  << " at default nice on device " << device_id_ << "...";
 #endif
 
+  const std::string range_label = "BackendThread " + name_;
   bool should_exit = false;
   while (!should_exit) {
     std::shared_ptr<Payload> payload;
-    model_->Server()->GetRateLimiter()->DequeuePayload(
-        model_instances_, &payload);
-    NVTX_RANGE(nvtx_, "BackendThread " + name_);
+    if (pipelined_) {
+      {
+        std::unique_lock<std::mutex> lk(prepared_mu_);
+        prepared_cv_.wait(lk, [this] { return prepared_payload_ != nullptr; });
+        payload = std::move(prepared_payload_);
+        prepared_payload_.reset();
+      }
+      prepared_cv_.notify_all();
+    } else {
+      if (fair_scheduling_) {
+        OrderIdleInstances();
+      }
+      model_->Server()->GetRateLimiter()->DequeuePayload(
+          model_instances_, &payload);
+    }
+    PROFILE_RANGE(range, range_label);
+    if ((payload->GetOpType() == Payload::Operation::INFER_RUN) &&
+        payload->GetInstance()->ExecutesAsync()) {
+      // The payload is released once the backend completes the
+      // execution, meanwhile the instance can be given another payload.
+      std::shared_ptr<RateLimiter> rate_limiter =
+          model_->Server()->GetRateLimiter();
+      std::shared_ptr<Payload> executing_payload = payload;
+      payload->ExecuteAsync([rate_limiter, executing_payload]() mutable {
+        rate_limiter->PayloadRelease(executing_payload);
+      });
+      if (!pipelined_) {
+        model_instances_.push_back(payload->GetInstance());
+      }
+      continue;
+    }
+
+    const uint64_t exec_start_ns = SteadyClockNs();
     payload->Execute(&should_exit);
-    model_instances_.push_back(payload->GetInstance());
+    if (fair_scheduling_) {
+      const uint64_t exec_end_ns = SteadyClockNs();
+      ChargeInstance(payload->GetInstance(), exec_end_ns - exec_start_ns);
+    }
+    // When pipelined the prepare thread already returned the instance
+    if (!pipelined_) {
+      model_instances_.push_back(payload->GetInstance());
+    }
     // Release the payload to the RateLimiter
     model_->Server()->GetRateLimiter()->PayloadRelease(payload);
   }
   LOG_VERBOSE(1) << "Stopping backend thread for " << name_ << "...";
 }
 
+void
+TritonModelInstance::TritonBackendThread::PrepareThread()
+{
+  bool should_exit = false;
+  while (!should_exit) {
+    // The next payload is only dequeued once the backend thread has taken
+    // the previous one, so a single payload waits for the instance.
+    {
+      std::unique_lock<std::mutex> lk(prepared_mu_);
+      prepared_cv_.wait(lk, [this] { return prepared_payload_ == nullptr; });
+    }
+
+    std::shared_ptr<Payload> payload;
+    if (fair_scheduling_) {
+      OrderIdleInstances();
+    }
+    model_->Server()->GetRateLimiter()->DequeuePayload(
+        model_instances_, &payload);
+    switch (payload->GetOpType()) {
+      case Payload::Operation::INFER_RUN:
+        payload->Prepare();
+        break;
+      case Payload::Operation::INIT: {
+        // Apply the host policy of the instance to this thread as well
+        Status status =
+            SetNumaConfigOnThread(payload->GetInstance()->HostPolicy());
+        if (!status.IsOk()) {
+          LOG_WARNING << "Failed to set host policy on prepare thread for "
+                      << name_ << ": " << status.Message();
+        }
+        break;
+      }
+      case Payload::Operation::WARM_UP:
+        break;
+      case Payload::Operation::EXIT:
+        should_exit = true;
+        break;
+    }
+    // The instance may be dequeued for again while this payload executes
+    model_instances_.push_back(payload->GetInstance());
+
+    {
+      std::lock_guard<std::mutex> lk(prepared_mu_);
+      prepared_payload_ = std::move(payload);
+    }
+    prepared_cv_.notify_all();
+  }
+}
+
 extern "C" {
 
 TRITONAPI_DECLSPEC TRITONSERVER_Error*
@@ -25,10 +25,14 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <atomic>
 #include <boost/core/span.hpp>
+#include <condition_variable>
 #include <functional>
 #include <future>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include "constants.h"
@@ -44,6 +48,7 @@ namespace triton { namespace core {
 
 class TritonModel;
 class InferenceRequest;
+class Payload;
 
 //
 // Represents a model instance.
@@ -51,6 +56,10 @@ class InferenceRequest;
 class TritonModelInstance {
  public:
   struct SecondaryDevice {
+    // The kind of the secondary devices that are the other GPUs spanned
+    // by a GPU instance.
+    static constexpr const char* kGpuKind = "KIND_GPU";
+
     SecondaryDevice(const std::string kind, const int64_t id)
         : kind_(kind), id_(id)
     {
@@ -93,6 +102,10 @@ class TritonModelInstance {
   Signature& GetSignature() { return signature_; }
   TRITONSERVER_InstanceGroupKind Kind() const { return kind_; }
   int32_t DeviceId() const { return device_id_; }
+  // The devices the instance runs on, DeviceId() first. A GPU instance
+  // also runs on the GPUs of its kGpuKind secondary devices, which are
+  // set by the "TRITON_INSTANCE_GPU_SPAN" model parameter.
+  const std::vector<int32_t>& DeviceIds() const { return device_ids_; }
   const triton::common::HostPolicyCmdlineConfig& HostPolicy() const
   {
     return host_policy_;
@@ -102,6 +115,15 @@ class TritonModelInstance {
     return host_policy_message_;
   }
   bool IsPassive() const { return passive_; }
+  // Whether the passive instance is promoted to receive work as a hot
+  // standby.
+  bool IsPromoted() const { return promoted_; }
+  // Let a passive instance receive work until it is demoted. The
+  // instance gets its own backend thread and skips the warmup.
+  Status Promote();
+  Status Demote();
+  // The number of executions that the backend failed.
+  uint64_t ExecutionFailureCount() const { return execution_failure_count_; }
   const std::vector<std::string>& Profiles() const { return profile_names_; }
 
   const std::vector<SecondaryDevice>& SecondaryDevices() const
@@ -111,9 +133,22 @@ class TritonModelInstance {
 
   Status Initialize();
   Status WarmUp();
+  // Wait for the warm-up of an instance that warms up in parallel with
+  // the other instances of the model.
+  Status WaitForWarmUp();
   void Schedule(
       std::vector<std::unique_ptr<InferenceRequest>>&& requests,
       const std::function<void()>& OnCompletion);
+  // Whether the backend implements TRITONBACKEND_ModelInstanceExecuteAsync
+  bool ExecutesAsync() const;
+  // Start the execution of 'requests' and return without waiting for it.
+  // 'OnCompletion' is called once the backend completes the execution.
+  void ScheduleAsync(
+      std::vector<std::unique_ptr<InferenceRequest>>&& requests,
+      std::function<void()>&& OnCompletion);
+  // Let the backend prepare 'requests', which will be scheduled next,
+  // if it implements TRITONBACKEND_ModelInstancePrefetch.
+  void Prefetch(const std::vector<std::unique_ptr<InferenceRequest>>& requests);
 
   TritonModel* Model() const { return model_; }
   void* State() { return state_; }
@@ -144,9 +179,13 @@ class TritonModelInstance {
    public:
     static Status CreateBackendThread(
         const std::string name, TritonModelInstance* model, const int nice,
-        const int32_t device_id,
+        const int32_t device_id, const uint32_t priority,
         std::unique_ptr<TritonBackendThread>* triton_backend_thread);
-    void AddModelInstance(TritonModelInstance* model_instance);
+    // 'priority' is the rate limiter priority of the instance, with fair
+    // scheduling an instance receives a share of the execution time of
+    // the thread inversely proportional to it.
+    void AddModelInstance(
+        TritonModelInstance* model_instance, const uint32_t priority = 1);
     Status InitAndWarmUpModelInstance(TritonModelInstance* model_instance);
     void StopBackendThread();
     ~TritonBackendThread();
@@ -156,6 +195,16 @@ class TritonModelInstance {
         const std::string& name, TritonModel* model, const int nice,
         const int32_t device_id);
     void BackendThread();
+    // Dequeue and prepare the next payload while the backend thread
+    // executes the current one, when the thread is pipelined.
+    void PrepareThread();
+    // Order the idle instances by the execution time they have left in
+    // the current deficit round robin round, starting a new round if none
+    // of them has time left.
+    void OrderIdleInstances();
+    // Charge the execution time to the instance.
+    void ChargeInstance(
+        const TritonModelInstance* model_instance, const uint64_t exec_ns);
 
     const std::string name_;
     const int nice_;
@@ -164,6 +213,28 @@ class TritonModelInstance {
     TritonModel* model_;
     std::deque<TritonModelInstance*> model_instances_;
 
+    // Whether the instances sharing the thread are served in deficit round
+    // robin order weighted by execution time, instead of in the order
+    // they become idle.
+    bool fair_scheduling_;
+    struct InstanceShare {
+      // Execution time the instance may still use in the current round
+      int64_t deficit_ns_;
+      // Execution time added to the instance in each round
+      int64_t quantum_ns_;
+    };
+    std::map<const TritonModelInstance*, InstanceShare> shares_;
+    std::mutex shares_mu_;
+
+    // Whether the payloads are dequeued and prepared by 'prepare_thread_'
+    // instead of by the backend thread itself. At most one payload is
+    // prepared ahead of the one executing.
+    bool pipelined_;
+    std::thread prepare_thread_;
+    std::mutex prepared_mu_;
+    std::condition_variable prepared_cv_;
+    std::shared_ptr<Payload> prepared_payload_;
+
     std::thread backend_thread_;
     std::atomic<bool> backend_thread_exit_;
   };
@@ -206,10 +277,13 @@ class TritonModelInstance {
       std::shared_ptr<TritonModelInstance>* triton_model_instance);
   Status SetBackendThread(
       const TRITONSERVER_InstanceGroupKind kind, const int32_t device_id,
-      const bool device_blocking);
+      const bool device_blocking, const uint32_t priority);
   Status GenerateWarmupData();
 
   void Execute(std::vector<TRITONBACKEND_Request*>& triton_requests);
+  void ExecuteAsync(
+      std::vector<TRITONBACKEND_Request*>& triton_requests,
+      std::function<void()>&& OnCompletion);
 
   std::shared_ptr<TritonBackendThread> triton_backend_thread_;
 
@@ -234,6 +308,7 @@ class TritonModelInstance {
   bool passive_;
 
   std::vector<SecondaryDevice> secondary_devices_;
+  std::vector<int32_t> device_ids_;
 
   // Reporter for metrics, or nullptr if no metrics should be reported
   std::shared_ptr<MetricModelReporter> reporter_;
@@ -244,6 +319,17 @@ class TritonModelInstance {
 
   // Opaque state associated with this model instance.
   void* state_;
+
+  // Whether the warm-up is waited for by WaitForWarmUp() instead of
+  // when the instance is created, and the pending warm-up payload.
+  bool parallel_warmup_;
+  std::shared_ptr<Payload> warmup_payload_;
+
+  // The rate limiter config of a passive instance, used on promotion.
+  bool promoted_;
+  inference::ModelRateLimiter rate_limiter_config_;
+
+  std::atomic<uint64_t> execution_failure_count_;
 };
 
 }}  // namespace triton::core
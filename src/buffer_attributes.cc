@@ -27,7 +27,6 @@
 #include "buffer_attributes.h"
 
 #include <cstring>
-#include "constants.h"
 
 namespace triton { namespace core {
 void
@@ -51,20 +50,17 @@ BufferAttributes::SetMemoryTypeId(const int64_t& memory_type_id)
 void
 BufferAttributes::SetCudaIpcHandle(void* cuda_ipc_handle)
 {
-  char* lcuda_ipc_handle = reinterpret_cast<char*>(cuda_ipc_handle);
-  cuda_ipc_handle_.clear();
-  std::copy(
-      lcuda_ipc_handle, lcuda_ipc_handle + CUDA_IPC_STRUCT_SIZE,
-      std::back_inserter(cuda_ipc_handle_));
+  std::memcpy(cuda_ipc_handle_, cuda_ipc_handle, CUDA_IPC_STRUCT_SIZE);
+  has_cuda_ipc_handle_ = true;
 }
 
 void*
 BufferAttributes::CudaIpcHandle()
 {
-  if (cuda_ipc_handle_.empty()) {
+  if (!has_cuda_ipc_handle_) {
     return nullptr;
   } else {
-    return reinterpret_cast<void*>(cuda_ipc_handle_.data());
+    return reinterpret_cast<void*>(cuda_ipc_handle_);
   }
 }
 
@@ -90,15 +86,10 @@ BufferAttributes::BufferAttributes(
     size_t byte_size, TRITONSERVER_MemoryType memory_type,
     int64_t memory_type_id, char* cuda_ipc_handle)
     : byte_size_(byte_size), memory_type_(memory_type),
-      memory_type_id_(memory_type_id)
+      memory_type_id_(memory_type_id), has_cuda_ipc_handle_(false)
 {
-  // cuda ipc handle size
-  cuda_ipc_handle_.reserve(CUDA_IPC_STRUCT_SIZE);
-
   if (cuda_ipc_handle != nullptr) {
-    std::copy(
-        cuda_ipc_handle, cuda_ipc_handle + CUDA_IPC_STRUCT_SIZE,
-        std::back_inserter(cuda_ipc_handle_));
+    SetCudaIpcHandle(cuda_ipc_handle);
   }
 }
 }}  // namespace triton::core
@@ -24,8 +24,8 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
-#include <iterator>
-#include <vector>
+#include <cstddef>
+#include "constants.h"
 #include "tritonserver_apis.h"
 
 #pragma once
@@ -40,10 +40,9 @@ class BufferAttributes {
       size_t byte_size, TRITONSERVER_MemoryType memory_type,
       int64_t memory_type_id, char cuda_ipc_handle[64]);
   BufferAttributes()
+      : byte_size_(0), memory_type_(TRITONSERVER_MEMORY_CPU),
+        memory_type_id_(0), has_cuda_ipc_handle_(false)
   {
-    memory_type_ = TRITONSERVER_MEMORY_CPU;
-    memory_type_id_ = 0;
-    cuda_ipc_handle_.reserve(64);
   }
 
   // Set the buffer byte size
@@ -74,6 +73,9 @@ class BufferAttributes {
   size_t byte_size_;
   TRITONSERVER_MemoryType memory_type_;
   int64_t memory_type_id_;
-  std::vector<char> cuda_ipc_handle_;
+  // The handle is stored inline so that creating and copying the
+  // attributes never allocates.
+  bool has_cuda_ipc_handle_;
+  char cuda_ipc_handle_[CUDA_IPC_STRUCT_SIZE];
 };
 }}  // namespace triton::core
@@ -0,0 +1,74 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace triton { namespace core {
+
+//
+// Byte budget shared by concurrent reservations, used to bound the
+// memory held by queued work. Reservations that would take the used
+// bytes over the limit are refused, the caller is expected to reject
+// the work instead of waiting.
+//
+class ByteBudget {
+ public:
+  explicit ByteBudget(const uint64_t limit) : limit_(limit), used_(0) {}
+
+  ByteBudget(const ByteBudget&) = delete;
+  ByteBudget& operator=(const ByteBudget&) = delete;
+
+  // Reserve 'byte_size' bytes. Return false without reserving anything
+  // if the budget doesn't have that many bytes left.
+  bool TryReserve(const uint64_t byte_size)
+  {
+    uint64_t used = used_.load(std::memory_order_relaxed);
+    do {
+      if ((byte_size > limit_) || (used > (limit_ - byte_size))) {
+        return false;
+      }
+    } while (!used_.compare_exchange_weak(
+        used, used + byte_size, std::memory_order_relaxed));
+    return true;
+  }
+
+  // Return 'byte_size' bytes of an earlier reservation.
+  void Release(const uint64_t byte_size)
+  {
+    used_.fetch_sub(byte_size, std::memory_order_relaxed);
+  }
+
+  uint64_t Limit() const { return limit_; }
+  uint64_t Used() const { return used_.load(std::memory_order_relaxed); }
+
+ private:
+  const uint64_t limit_;
+  std::atomic<uint64_t> used_;
+};
+
+}}  // namespace triton::core
@@ -0,0 +1,132 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "bytes_tensor.h"
+
+#include <cstring>
+#include <limits>
+#include <string>
+
+namespace triton { namespace core {
+
+Status
+SerializedBytesSize(
+    const uint64_t* offsets, const size_t element_count, size_t* byte_size)
+{
+  for (size_t idx = 0; idx < element_count; ++idx) {
+    if (offsets[idx + 1] < offsets[idx]) {
+      return Status(
+          Status::Code::INVALID_ARG,
+          "offset of element " + std::to_string(idx + 1) +
+              " is smaller than the offset of the element before it");
+    }
+    const uint64_t element_size = offsets[idx + 1] - offsets[idx];
+    if (element_size > std::numeric_limits<uint32_t>::max()) {
+      return Status(
+          Status::Code::INVALID_ARG,
+          "element " + std::to_string(idx) + " of " +
+              std::to_string(element_size) +
+              " bytes is too large for a BYTES tensor");
+    }
+  }
+
+  const uint64_t data_size = offsets[element_count] - offsets[0];
+  if (data_size > (std::numeric_limits<size_t>::max() -
+                   (element_count * sizeof(uint32_t)))) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "BYTES tensor of " + std::to_string(element_count) +
+            " elements is too large");
+  }
+  *byte_size = (element_count * sizeof(uint32_t)) + data_size;
+  return Status::Success;
+}
+
+void
+SerializeBytes(
+    const char* data, const uint64_t* offsets, const size_t element_count,
+    char* dst)
+{
+  for (size_t idx = 0; idx < element_count; ++idx) {
+    const uint32_t length = offsets[idx + 1] - offsets[idx];
+    memcpy(dst, &length, sizeof(uint32_t));
+    dst += sizeof(uint32_t);
+    memcpy(dst, data + offsets[idx], length);
+    dst += length;
+  }
+}
+
+Status
+DeserializeBytes(
+    const char* serialized, const size_t byte_size,
+    const size_t element_count, ContiguousBytes* bytes)
+{
+  // Every element takes at least its length, which bounds the data size
+  // and lets the data be sized before any element is copied.
+  if (byte_size < (element_count * sizeof(uint32_t))) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "BYTES tensor of " + std::to_string(byte_size) +
+            " bytes can't hold " + std::to_string(element_count) +
+            " elements");
+  }
+
+  bytes->offsets_.resize(element_count + 1);
+  bytes->data_.resize(byte_size - (element_count * sizeof(uint32_t)));
+  char* dst = bytes->data_.data();
+  size_t pos = 0;
+  uint64_t offset = 0;
+  for (size_t idx = 0; idx < element_count; ++idx) {
+    bytes->offsets_[idx] = offset;
+    uint32_t length;
+    memcpy(&length, serialized + pos, sizeof(uint32_t));
+    pos += sizeof(uint32_t);
+    // The bytes left must also hold the lengths of the elements after
+    const size_t reserved = (element_count - idx - 1) * sizeof(uint32_t);
+    if ((byte_size - pos - reserved) < length) {
+      return Status(
+          Status::Code::INVALID_ARG,
+          "element " + std::to_string(idx) + " of BYTES tensor exceeds the " +
+              std::to_string(byte_size) + " bytes of the tensor");
+    }
+    memcpy(dst + offset, serialized + pos, length);
+    pos += length;
+    offset += length;
+  }
+  bytes->offsets_[element_count] = offset;
+
+  if (pos != byte_size) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "BYTES tensor of " + std::to_string(byte_size) +
+            " bytes holds more than " + std::to_string(element_count) +
+            " elements");
+  }
+
+  return Status::Success;
+}
+
+}}  // namespace triton::core
@@ -0,0 +1,69 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "status.h"
+
+namespace triton { namespace core {
+
+// A BYTES tensor in offsets+data form. Element 'i' is the
+// ('offsets_[i + 1]' - 'offsets_[i]') bytes at 'data_' + 'offsets_[i]',
+// so 'offsets_' holds one entry more than there are elements. All the
+// element bytes are contiguous, so the tensor can be copied, batched or
+// hashed with a single pass over 'data_'.
+struct ContiguousBytes {
+  std::vector<uint64_t> offsets_;
+  std::vector<char> data_;
+};
+
+// Compute into 'byte_size' the byte size of the length-prefixed
+// serialization of the 'element_count' elements described by
+// 'offsets', which holds 'element_count' + 1 entries. Error if the
+// offsets are decreasing or an element is too large for the 4-byte
+// length, so the offsets are valid for SerializeBytes() on success.
+Status SerializedBytesSize(
+    const uint64_t* offsets, const size_t element_count, size_t* byte_size);
+
+// Write the 'element_count' elements of 'data' described by 'offsets'
+// into 'dst' in the length-prefixed serialization used for BYTES
+// tensors, each element preceded by its 4-byte length. 'offsets' must
+// have been validated by SerializedBytesSize() and 'dst' must hold the
+// bytes it returned.
+void SerializeBytes(
+    const char* data, const uint64_t* offsets, const size_t element_count,
+    char* dst);
+
+// Convert the 'byte_size' bytes of length-prefixed serialization at
+// 'serialized' into 'bytes'. Error if the buffer doesn't hold exactly
+// 'element_count' elements.
+Status DeserializeBytes(
+    const char* serialized, const size_t byte_size,
+    const size_t element_count, ContiguousBytes* bytes);
+
+}}  // namespace triton::core
@@ -0,0 +1,230 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "cache_codec.h"
+#include <algorithm>
+#include <cstring>
+
+namespace triton { namespace core {
+
+namespace {
+
+// Run-length encoding used after the byte shuffle. A control byte 'c'
+// below 128 is followed by a literal run of (c + 1) bytes, otherwise the
+// single byte that follows is repeated (c - 128 + kMinRepeat) times.
+constexpr size_t kMaxLiteral = 128;
+constexpr size_t kMinRepeat = 3;
+constexpr size_t kMaxRepeat = 127 + kMinRepeat;
+
+// Append the run-length encoding of 'size' bytes at 'src' to 'dst'.
+// Return false as soon as 'dst' reaches 'limit' bytes.
+bool
+RunLengthEncode(
+    const uint8_t* src, const size_t size, const size_t limit,
+    std::vector<uint8_t>* dst)
+{
+  size_t pos = 0;
+  size_t literal_start = 0;
+  while (pos < size) {
+    size_t run = 1;
+    while (((pos + run) < size) && (src[pos + run] == src[pos]) &&
+           (run < kMaxRepeat)) {
+      ++run;
+    }
+
+    if (run >= kMinRepeat) {
+      while (literal_start < pos) {
+        const size_t count = std::min(kMaxLiteral, pos - literal_start);
+        dst->push_back(count - 1);
+        dst->insert(
+            dst->end(), src + literal_start, src + literal_start + count);
+        literal_start += count;
+      }
+      dst->push_back(128 + (run - kMinRepeat));
+      dst->push_back(src[pos]);
+      pos += run;
+      literal_start = pos;
+    } else {
+      pos += run;
+    }
+
+    if (dst->size() >= limit) {
+      return false;
+    }
+  }
+
+  while (literal_start < size) {
+    const size_t count = std::min(kMaxLiteral, size - literal_start);
+    dst->push_back(count - 1);
+    dst->insert(dst->end(), src + literal_start, src + literal_start + count);
+    literal_start += count;
+  }
+
+  return dst->size() < limit;
+}
+
+Status
+RunLengthDecode(
+    const uint8_t* src, const size_t size, uint8_t* dst, const size_t dst_size)
+{
+  const Status malformed(
+      Status::Code::INTERNAL, "malformed compressed response cache payload");
+  size_t in = 0;
+  size_t out = 0;
+  while (in < size) {
+    const uint8_t control = src[in++];
+    if (control < 128) {
+      const size_t count = control + 1;
+      if (((in + count) > size) || ((out + count) > dst_size)) {
+        return malformed;
+      }
+      std::memcpy(dst + out, src + in, count);
+      in += count;
+      out += count;
+    } else {
+      const size_t count = control - 128 + kMinRepeat;
+      if ((in >= size) || ((out + count) > dst_size)) {
+        return malformed;
+      }
+      std::memset(dst + out, src[in++], count);
+      out += count;
+    }
+  }
+
+  if (out != dst_size) {
+    return malformed;
+  }
+  return Status::Success;
+}
+
+}  // namespace
+
+Status
+ParseCacheCodec(const std::string& name, CacheCodec* codec)
+{
+  if (name == "none") {
+    *codec = CacheCodec::NONE;
+  } else if (name == "shuffle") {
+    *codec = CacheCodec::SHUFFLE;
+  } else if (name == "float_delta") {
+    *codec = CacheCodec::FLOAT_DELTA;
+  } else {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "unknown response cache codec '" + name +
+            "', expected one of 'none', 'shuffle' or 'float_delta'");
+  }
+  return Status::Success;
+}
+
+bool
+CacheEncode(
+    const CacheCodec codec, const size_t element_size, const void* src,
+    const size_t byte_size, std::vector<uint8_t>* dst)
+{
+  dst->clear();
+  if ((codec == CacheCodec::NONE) || (element_size == 0) ||
+      ((byte_size % element_size) != 0) ||
+      ((codec == CacheCodec::FLOAT_DELTA) && (element_size != 4))) {
+    return false;
+  }
+
+  const uint8_t* bytes = static_cast<const uint8_t*>(src);
+  std::vector<uint8_t> delta;
+  if (codec == CacheCodec::FLOAT_DELTA) {
+    delta.resize(byte_size);
+    uint32_t prev = 0;
+    for (size_t i = 0; i < byte_size; i += 4) {
+      uint32_t value;
+      std::memcpy(&value, bytes + i, sizeof(value));
+      const uint32_t x = value ^ prev;
+      std::memcpy(&delta[i], &x, sizeof(x));
+      prev = value;
+    }
+    bytes = delta.data();
+  }
+
+  // Shuffle the bytes into planes, then run-length encode all planes.
+  const size_t count = byte_size / element_size;
+  std::vector<uint8_t> planes(byte_size);
+  for (size_t e = 0; e < count; ++e) {
+    for (size_t b = 0; b < element_size; ++b) {
+      planes[b * count + e] = bytes[e * element_size + b];
+    }
+  }
+
+  dst->reserve(byte_size);
+  return RunLengthEncode(planes.data(), byte_size, byte_size, dst);
+}
+
+size_t
+CacheMaxDecodedByteSize(const size_t byte_size)
+{
+  // The densest encoding is a sequence of two byte repeats
+  return (byte_size / 2) * kMaxRepeat;
+}
+
+Status
+CacheDecode(
+    const CacheCodec codec, const size_t element_size, const void* src,
+    const size_t byte_size, void* dst, const size_t dst_byte_size)
+{
+  if ((codec == CacheCodec::NONE) || (element_size == 0) ||
+      ((dst_byte_size % element_size) != 0) ||
+      ((codec == CacheCodec::FLOAT_DELTA) && (element_size != 4))) {
+    return Status(
+        Status::Code::INTERNAL,
+        "unexpected codec " + std::to_string(static_cast<uint32_t>(codec)) +
+            " for compressed response cache payload");
+  }
+
+  std::vector<uint8_t> planes(dst_byte_size);
+  RETURN_IF_ERROR(RunLengthDecode(
+      static_cast<const uint8_t*>(src), byte_size, planes.data(),
+      dst_byte_size));
+
+  uint8_t* bytes = static_cast<uint8_t*>(dst);
+  const size_t count = dst_byte_size / element_size;
+  for (size_t e = 0; e < count; ++e) {
+    for (size_t b = 0; b < element_size; ++b) {
+      bytes[e * element_size + b] = planes[b * count + e];
+    }
+  }
+
+  if (codec == CacheCodec::FLOAT_DELTA) {
+    uint32_t prev = 0;
+    for (size_t i = 0; i < dst_byte_size; i += 4) {
+      uint32_t x;
+      std::memcpy(&x, bytes + i, sizeof(x));
+      prev ^= x;
+      std::memcpy(bytes + i, &prev, sizeof(prev));
+    }
+  }
+
+  return Status::Success;
+}
+
+}}  // namespace triton::core
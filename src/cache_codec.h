@@ -0,0 +1,73 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "status.h"
+
+namespace triton { namespace core {
+
+// Lossless codecs that may be applied to output payloads stored in the
+// response cache. The value is persisted in cache entries so existing
+// values must not change.
+enum class CacheCodec : uint32_t {
+  // Payload is stored as is.
+  NONE = 0,
+  // Bytes of each element are grouped into planes (the first byte of
+  // every element, then the second, ...) which are run-length encoded.
+  // Works well for tensors with many zeros or slowly varying values.
+  SHUFFLE = 1,
+  // Each 32-bit element is XOR-ed with the previous one before the
+  // SHUFFLE step, so that the sign, exponent and high mantissa bits of
+  // similar FP32 values become runs of zeros.
+  FLOAT_DELTA = 2
+};
+
+// Parse the codec named 'name', which is one of "none", "shuffle" or
+// "float_delta".
+Status ParseCacheCodec(const std::string& name, CacheCodec* codec);
+
+// Encode 'byte_size' bytes of elements of 'element_size' bytes each
+// from 'src' into 'dst'. Return false, leaving 'dst' unspecified, if
+// the encoding would not be smaller than the input.
+bool CacheEncode(
+    const CacheCodec codec, const size_t element_size, const void* src,
+    const size_t byte_size, std::vector<uint8_t>* dst);
+
+// Return the largest size that 'byte_size' encoded bytes can decode to,
+// so that a corrupted decoded size is rejected before allocating for it.
+size_t CacheMaxDecodedByteSize(const size_t byte_size);
+
+// Decode 'byte_size' encoded bytes from 'src' into 'dst' which must hold
+// exactly 'dst_byte_size' bytes.
+Status CacheDecode(
+    const CacheCodec codec, const size_t element_size, const void* src,
+    const size_t byte_size, void* dst, const size_t dst_byte_size);
+
+}}  // namespace triton::core
@@ -25,10 +25,37 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "cache_entry.h"
+#include <algorithm>
 #include <iostream>
 
 namespace triton { namespace core {
 
+namespace {
+
+// Identifies the packed response layout, "TCE2" in memory. Buffers
+// packed by a different layout are rejected on lookup.
+constexpr uint32_t kPackedResponseMagic = 0x32454354;
+
+// Alignment of each output payload relative to the start of the packed
+// buffer, so that borrowed outputs are as aligned as the cache buffer.
+constexpr uint64_t kPayloadAlignment = 64;
+
+uint64_t
+AlignPayload(const uint64_t position)
+{
+  return (position + kPayloadAlignment - 1) & ~(kPayloadAlignment - 1);
+}
+
+// Size of the elements a codec operates on, byte-granular for types
+// without a fixed size.
+size_t
+ElementByteSize(const inference::DataType dtype)
+{
+  return std::max<size_t>(1, triton::common::GetDataTypeByteSize(dtype));
+}
+
+}  // namespace
+
 /* CacheEntry */
 
 size_t
@@ -64,6 +91,16 @@ CacheEntry::AddBuffer(void* base, size_t byte_size)
 {
   std::unique_lock<std::mutex> lk(buffer_mu_);
   buffers_.emplace_back(std::make_pair(base, byte_size));
+  buffer_owners_.emplace_back(nullptr);
+}
+
+void
+CacheEntry::AddSharedBuffer(
+    void* base, size_t byte_size, std::shared_ptr<void>&& owner)
+{
+  std::unique_lock<std::mutex> lk(buffer_mu_);
+  buffers_.emplace_back(std::make_pair(base, byte_size));
+  buffer_owners_.emplace_back(std::move(owner));
 }
 
 CacheEntry::~CacheEntry()
@@ -115,23 +152,10 @@ CacheEntry::SetBufferSize(InferenceResponse* response)
     return Status(Status::Code::INTERNAL, "response was nullptr");
   }
 
-  // The packed_response buffer will look like:
-  //   [num_outputs, sizeof(output1), output1, ..., sizeof(outputN), outputN]
-  // So the entire packed_response_buffer will be the sum of all the output
-  // sizes and the metadata included to parse them.
+  // The size is used to request an allocated buffer from the cache to
+  // copy directly into
   uint64_t packed_response_byte_size = 0;
-  // 1. First the packed buffer will hold the number of outputs as a uint32_t
-  packed_response_byte_size += sizeof(uint32_t);
-  // These sizes will be used to request allocated buffers from the cache
-  // to copy direcly into
-  for (const auto& output : response->Outputs()) {
-    uint64_t packed_output_byte_size = 0;
-    RETURN_IF_ERROR(GetByteSize(output, &packed_output_byte_size));
-    // 2. Then the packed buffer will hold pairs of (output_size, output_bytes)
-    packed_response_byte_size += sizeof(uint64_t);
-    packed_response_byte_size += packed_output_byte_size;
-  }
-
+  RETURN_IF_ERROR(GetByteSize(*response, &packed_response_byte_size));
   AddPlaceholderBuffer(packed_response_byte_size);
   return Status::Success;
 }
@@ -155,134 +179,129 @@ CacheEntry::SerializeResponses(boost::span<InferenceResponse*> responses)
 }
 
 Status
-CacheEntry::SerializeResponse(InferenceResponse* response, Buffer& buffer)
+CacheEntry::AppendResponse(InferenceResponse* response)
 {
-  if (!response) {
-    return Status(Status::Code::INTERNAL, "response was nullptr");
-  }
-
-  // The packed_response buffer will look like:
-  //   [num_outputs, sizeof(output1), output1, ..., sizeof(outputN), outputN]
-  size_t position = 0;
-  Byte* base = static_cast<Byte*>(buffer.first);
-  // 1. First the packed buffer will hold the number of outputs as a uint32_t
-  uint32_t num_outputs = response->Outputs().size();
-  std::memcpy(base, &num_outputs, sizeof(uint32_t));
-  position += sizeof(uint32_t);
-
-  for (const auto& output : response->Outputs()) {
-    uint64_t packed_output_byte_size = 0;
-    RETURN_IF_ERROR(SerializeResponseOutput(
-        output, base + position, &packed_output_byte_size));
-    // 2. Then the packed buffer will hold pairs of (output_size, output_bytes)
-    position += sizeof(packed_output_byte_size);
-    position += packed_output_byte_size;
-  }
-
-  // Validate serialization fit expected size
-  uint64_t total_buffer_size = buffer.second;
-  if (position != total_buffer_size) {
+  RETURN_IF_ERROR(SetBufferSize(response));
+  free_buffers_ = true;
+  auto& buffer = buffers_.back();
+  buffer.first = malloc(buffer.second);
+  if (buffer.first == nullptr) {
     return Status(
         Status::Code::INTERNAL,
-        "Serialized buffer size does not match. Expected: " +
-            std::to_string(position) +
-            ", received: " + std::to_string(total_buffer_size));
+        "failed to allocate " + std::to_string(buffer.second) +
+            " bytes for cached response");
   }
-
+  RETURN_IF_ERROR(SerializeResponse(response, buffer));
+  // The encodings are only needed until the response is serialized
+  encoded_payloads_.clear();
   return Status::Success;
 }
 
 Status
-CacheEntry::SerializeResponseOutput(
-    const InferenceResponse::Output& output, Byte* buffer, size_t* output_size)
+CacheEntry::SerializeResponse(InferenceResponse* response, Buffer& buffer)
 {
-  if (!buffer) {
-    return Status(Status::Code::INVALID_ARG, "buffer arg was nullptr");
+  if (!response) {
+    return Status(Status::Code::INTERNAL, "response was nullptr");
   }
 
-  // Fetch output buffer details
-  const void* output_base = nullptr;
-  size_t output_byte_size = 0;
-  TRITONSERVER_MemoryType memory_type = TRITONSERVER_MEMORY_CPU;
-  int64_t memory_type_id = 0;
-  void* userp = nullptr;
-  auto status = output.DataBuffer(
-      &output_base, &output_byte_size, &memory_type, &memory_type_id, &userp);
-  if (!status.IsOk()) {
-    return status;
+  Byte* base = static_cast<Byte*>(buffer.first);
+  if (!base) {
+    return Status(Status::Code::INTERNAL, "buffer was nullptr");
   }
 
-  // DLIS-2673: Add better memory_type support
-  if (memory_type != TRITONSERVER_MEMORY_CPU &&
-      memory_type != TRITONSERVER_MEMORY_CPU_PINNED) {
+  // See PackedResponseHeader for the layout. Metadata for all outputs
+  // is written ahead of the first payload, so its size is needed up
+  // front to place the payloads.
+  const auto& outputs = response->Outputs();
+  const uint64_t buffer_byte_size = buffer.second;
+  const uint64_t table_end =
+      sizeof(PackedResponseHeader) + outputs.size() * sizeof(PackedOutput);
+  uint64_t name_position = table_end;
+  for (const auto& output : outputs) {
+    name_position += output.Shape().size() * sizeof(int64_t);
+  }
+  uint64_t shape_position = table_end;
+  uint64_t data_position = MetadataByteSize(*response);
+  if (data_position > buffer_byte_size) {
     return Status(
-        Status::Code::INVALID_ARG,
-        "Only input buffers in CPU memory are allowed in cache currently");
+        Status::Code::INTERNAL,
+        "Serialized buffer size does not match. Expected at least: " +
+            std::to_string(data_position) +
+            ", received: " + std::to_string(buffer_byte_size));
   }
 
-  // Exit early if response buffer from output is invalid
-  if (!output_base) {
+  Byte* table = base + sizeof(PackedResponseHeader);
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    const auto& output = outputs[i];
+    const void* output_base = nullptr;
+    size_t output_byte_size = 0;
+    RETURN_IF_ERROR(OutputData(output, &output_base, &output_byte_size));
+
+    // Use the encoding prepared when the buffer size was computed, if any
+    const auto encoded = encoded_payloads_.find(output_base);
+    const bool is_encoded = (encoded != encoded_payloads_.end());
+    const uint64_t stored_byte_size =
+        is_encoded ? (sizeof(uint64_t) + encoded->second.size())
+                   : output_byte_size;
+
+    const uint64_t payload_position = AlignPayload(data_position);
+    if ((payload_position + stored_byte_size) > buffer_byte_size) {
+      return Status(
+          Status::Code::INTERNAL,
+          "Serialized buffer size does not match. Expected at least: " +
+              std::to_string(payload_position + stored_byte_size) +
+              ", received: " + std::to_string(buffer_byte_size));
+    }
+    // Zero the padding so identical responses pack to identical bytes
+    std::memset(base + data_position, 0, payload_position - data_position);
+    data_position = payload_position;
+
+    const auto& name = output.Name();
+    const auto& shape = output.Shape();
+    PackedOutput record;
+    record.data_offset_ = data_position;
+    record.data_byte_size_ = stored_byte_size;
+    record.name_offset_ = name_position;
+    record.name_byte_size_ = name.size();
+    record.shape_offset_ = shape_position;
+    record.dims_count_ = shape.size();
+    record.dtype_ = static_cast<int32_t>(output.DType());
+    record.codec_ = static_cast<uint32_t>(
+        is_encoded ? codec_ : CacheCodec::NONE);
+
+    std::memcpy(table + i * sizeof(PackedOutput), &record, sizeof(record));
+
+    const size_t shape_byte_size = shape.size() * sizeof(int64_t);
+    std::memcpy(base + shape_position, shape.data(), shape_byte_size);
+    shape_position += shape_byte_size;
+    std::memcpy(base + name_position, name.data(), name.size());
+    name_position += name.size();
+    if (is_encoded) {
+      const uint64_t decoded_byte_size = output_byte_size;
+      std::memcpy(base + data_position, &decoded_byte_size, sizeof(uint64_t));
+      std::memcpy(
+          base + data_position + sizeof(uint64_t), encoded->second.data(),
+          encoded->second.size());
+    } else if (output_byte_size > 0) {
+      std::memcpy(base + data_position, output_base, output_byte_size);
+    }
+    data_position += stored_byte_size;
+  }
+
+  // Validate serialization fit expected size
+  if (data_position != buffer_byte_size) {
     return Status(
-        Status::Code::INTERNAL, "Response buffer from output was nullptr");
+        Status::Code::INTERNAL,
+        "Serialized buffer size does not match. Expected: " +
+            std::to_string(data_position) +
+            ", received: " + std::to_string(buffer_byte_size));
   }
 
-  size_t total_byte_size = 0;
-
-  // Name
-  std::string name = output.Name();
-  uint32_t name_byte_size = name.size();
-  total_byte_size += sizeof(uint32_t);
-  total_byte_size += name_byte_size;
-
-  // Dtype
-  std::string dtype = triton::common::DataTypeToProtocolString(output.DType());
-  uint32_t dtype_byte_size = dtype.size();
-  total_byte_size += sizeof(uint32_t);
-  total_byte_size += dtype_byte_size;
-
-  // Shape
-  std::vector<int64_t> shape = output.Shape();
-  uint32_t shape_byte_size = shape.size() * sizeof(int64_t);
-  total_byte_size += sizeof(uint32_t);
-  total_byte_size += shape_byte_size;
-
-  // Output Buffer: Convert size_t to uint64_t for a fixed-size guarantee
-  uint64_t u64_output_byte_size = static_cast<uint64_t>(output_byte_size);
-  total_byte_size += sizeof(uint64_t);
-  total_byte_size += u64_output_byte_size;
-
-  // Pack everything into provided buffer
-  uint64_t position = 0;
-  // Total serialized output size
-  memcpy(buffer + position, &total_byte_size, sizeof(uint64_t));
-  position += sizeof(uint64_t);
-
-  // Name
-  memcpy(buffer + position, &name_byte_size, sizeof(uint32_t));
-  position += sizeof(uint32_t);
-  memcpy(buffer + position, name.c_str(), name_byte_size);
-  position += name_byte_size;
-
-  // Dtype
-  memcpy(buffer + position, &dtype_byte_size, sizeof(uint32_t));
-  position += sizeof(uint32_t);
-  memcpy(buffer + position, dtype.c_str(), dtype_byte_size);
-  position += dtype_byte_size;
-
-  // Shape
-  memcpy(buffer + position, &shape_byte_size, sizeof(uint32_t));
-  position += sizeof(uint32_t);
-  memcpy(buffer + position, shape.data(), shape_byte_size);
-  position += shape_byte_size;
-
-  // Response Output Buffer
-  memcpy(buffer + position, &u64_output_byte_size, sizeof(uint64_t));
-  position += sizeof(uint64_t);
-  memcpy(buffer + position, output_base, u64_output_byte_size);
-  position += u64_output_byte_size;
-
-  // Used to increment global position in total response buffer
-  *output_size = total_byte_size;
+  PackedResponseHeader header;
+  header.magic_ = kPackedResponseMagic;
+  header.num_outputs_ = outputs.size();
+  header.byte_size_ = data_position;
+  std::memcpy(base, &header, sizeof(header));
   return Status::Success;
 }
 
@@ -298,14 +317,17 @@ CacheEntry::DeserializeBuffers(boost::span<InferenceResponse*> responses)
   }
 
   for (size_t i = 0; i < responses.size(); i++) {
-    RETURN_IF_ERROR(DeserializeBuffer(responses[i], buffers_[i]));
+    RETURN_IF_ERROR(
+        DeserializeBuffer(responses[i], buffers_[i], buffer_owners_[i]));
   }
 
   return Status::Success;
 }
 
 Status
-CacheEntry::DeserializeBuffer(InferenceResponse* response, const Buffer& buffer)
+CacheEntry::DeserializeBuffer(
+    InferenceResponse* response, const Buffer& buffer,
+    const std::shared_ptr<void>& owner)
 {
   if (!response) {
     return Status(Status::Code::INTERNAL, "response was nullptr");
@@ -317,25 +339,15 @@ CacheEntry::DeserializeBuffer(InferenceResponse* response, const Buffer& buffer)
     return Status(Status::Code::INTERNAL, "buffer was nullptr");
   }
 
-  uint64_t position = 0;
-  // Number of response outputs serialized in buffer
-  uint32_t num_outputs = 0;
-  std::memcpy(&num_outputs, base, sizeof(num_outputs));
-  position += sizeof(num_outputs);
-
+  const boost::span<const Byte> packed_bytes(base, buffer.second);
+  PackedResponseHeader header;
+  RETURN_IF_ERROR(ReadHeader(packed_bytes, &header));
 
-  for (size_t i = 0; i < num_outputs; i++) {
-    // Get size of packed output
-    uint64_t packed_output_size = 0;
-    std::memcpy(
-        &packed_output_size, base + position, sizeof(packed_output_size));
-    position += sizeof(packed_output_size);
-
-    // Parse packed output
+  for (size_t i = 0; i < header.num_outputs_; i++) {
+    // Parse packed output, the output buffer references the packed bytes
     auto cache_output = CacheOutput();
-    RETURN_IF_ERROR(DeserializeResponseOutput(
-        {base + position, packed_output_size}, &cache_output));
-    position += packed_output_size;
+    RETURN_IF_ERROR(
+        DeserializeResponseOutput(packed_bytes, header, i, &cache_output));
 
     InferenceResponse::Output* response_output = nullptr;
     RETURN_IF_ERROR(response->AddOutput(
@@ -348,6 +360,16 @@ CacheEntry::DeserializeBuffer(InferenceResponse* response, const Buffer& buffer)
           "InferenceResponse::Output pointer as nullptr");
     }
 
+    // ZERO COPY: if the cache keeps the buffer alive on behalf of the
+    // response, point the output directly at the cached data.
+    if ((owner != nullptr) && (cache_output.codec_ == CacheCodec::NONE) &&
+        response_output->CanBorrowDataBuffer()) {
+      RETURN_IF_ERROR(response_output->BorrowDataBuffer(
+          cache_output.buffer_, cache_output.byte_size_,
+          TRITONSERVER_MEMORY_CPU, 0 /* memory_type_id */, owner));
+      continue;
+    }
+
     TRITONSERVER_MemoryType memory_type = TRITONSERVER_MEMORY_CPU;
     int64_t memory_type_id = 0;
 
@@ -364,37 +386,39 @@ CacheEntry::DeserializeBuffer(InferenceResponse* response, const Buffer& buffer)
           "Only input buffers in CPU memory are allowed in cache currently");
     }
 
-    if (!output_buffer) {
+    if (!output_buffer && (cache_output.byte_size_ > 0)) {
       return Status(
           Status::Code::INTERNAL,
           "failed to allocate buffer for output '" + cache_output.name_ + "'");
     }
+    if (cache_output.codec_ != CacheCodec::NONE) {
+      // DECODE: cached output buffer into allocated response output buffer
+      RETURN_IF_ERROR(CacheDecode(
+          cache_output.codec_, ElementByteSize(cache_output.dtype_),
+          cache_output.buffer_, cache_output.encoded_byte_size_,
+          output_buffer, cache_output.byte_size_));
+      continue;
+    }
     // COPY: cached output buffer to allocated response output buffer
-    memcpy(output_buffer, cache_output.buffer_, cache_output.byte_size_);
+    if (cache_output.byte_size_ > 0) {
+      memcpy(output_buffer, cache_output.buffer_, cache_output.byte_size_);
+    }
   }
 
   return Status::Success;
 }
 
 Status
-CacheEntry::GetByteSize(
-    const InferenceResponse::Output& output, uint64_t* packed_output_byte_size)
+CacheEntry::OutputData(
+    const InferenceResponse::Output& output, const void** base,
+    size_t* byte_size)
 {
-  if (!packed_output_byte_size) {
-    return Status(Status::Code::INVALID_ARG, "byte_size arg was null");
-  }
-
   // Fetch output buffer details
-  const void* output_base = nullptr;
-  size_t output_byte_size = 0;
   TRITONSERVER_MemoryType memory_type = TRITONSERVER_MEMORY_CPU;
   int64_t memory_type_id = 0;
   void* userp = nullptr;
-  auto status = output.DataBuffer(
-      &output_base, &output_byte_size, &memory_type, &memory_type_id, &userp);
-  if (!status.IsOk()) {
-    return status;
-  }
+  RETURN_IF_ERROR(output.DataBuffer(
+      base, byte_size, &memory_type, &memory_type_id, &userp));
 
   // DLIS-2673: Add better memory_type support
   if (memory_type != TRITONSERVER_MEMORY_CPU &&
@@ -404,103 +428,166 @@ CacheEntry::GetByteSize(
         "Only input buffers in CPU memory are allowed in cache currently");
   }
 
-  // Exit early if response buffer from output is invalid
-  if (!output_base) {
+  // Exit early if response buffer from output is invalid, an empty
+  // output may have no buffer
+  if (!*base && (*byte_size > 0)) {
     return Status(
         Status::Code::INTERNAL, "Response buffer from output was nullptr");
   }
 
-  size_t total_byte_size = 0;
+  return Status::Success;
+}
+
+uint64_t
+CacheEntry::PayloadByteSize(
+    const InferenceResponse::Output& output, const void* base,
+    const size_t byte_size)
+{
+  if (codec_ == CacheCodec::NONE) {
+    return byte_size;
+  }
+
+  // Only keep the encoding if it still saves space after the decoded
+  // size prefix is added
+  std::vector<uint8_t> encoded;
+  if (!CacheEncode(
+          codec_, ElementByteSize(output.DType()), base, byte_size,
+          &encoded) ||
+      ((encoded.size() + sizeof(uint64_t)) >= byte_size)) {
+    encoded_payloads_.erase(base);
+    return byte_size;
+  }
+
+  const uint64_t encoded_byte_size = sizeof(uint64_t) + encoded.size();
+  encoded_payloads_[base] = std::move(encoded);
+  return encoded_byte_size;
+}
+
+uint64_t
+CacheEntry::MetadataByteSize(const InferenceResponse& response)
+{
+  uint64_t byte_size = sizeof(PackedResponseHeader);
+  for (const auto& output : response.Outputs()) {
+    byte_size += sizeof(PackedOutput);
+    byte_size += output.Shape().size() * sizeof(int64_t);
+    byte_size += output.Name().size();
+  }
+  return byte_size;
+}
+
+Status
+CacheEntry::GetByteSize(
+    const InferenceResponse& response, uint64_t* packed_response_byte_size)
+{
+  if (!packed_response_byte_size) {
+    return Status(Status::Code::INVALID_ARG, "byte_size arg was null");
+  }
 
-  // Name
-  std::string name = output.Name();
-  uint32_t name_byte_size = name.size();
-  total_byte_size += sizeof(uint32_t);
-  total_byte_size += name_byte_size;
+  uint64_t byte_size = MetadataByteSize(response);
+  for (const auto& output : response.Outputs()) {
+    const void* output_base = nullptr;
+    size_t output_byte_size = 0;
+    RETURN_IF_ERROR(OutputData(output, &output_base, &output_byte_size));
+    byte_size = AlignPayload(byte_size) +
+                PayloadByteSize(output, output_base, output_byte_size);
+  }
 
-  // Dtype
-  std::string dtype = triton::common::DataTypeToProtocolString(output.DType());
-  uint32_t dtype_byte_size = dtype.size();
-  total_byte_size += sizeof(uint32_t);
-  total_byte_size += dtype_byte_size;
+  *packed_response_byte_size = byte_size;
+  return Status::Success;
+}
 
-  // Shape
-  std::vector<int64_t> shape = output.Shape();
-  uint32_t shape_byte_size = shape.size() * sizeof(int64_t);
-  total_byte_size += sizeof(uint32_t);
-  total_byte_size += shape_byte_size;
+Status
+CacheEntry::ReadHeader(
+    boost::span<const Byte> packed_bytes, PackedResponseHeader* header)
+{
+  if (packed_bytes.size() < sizeof(PackedResponseHeader)) {
+    return Status(
+        Status::Code::INTERNAL,
+        "Unexpected number of bytes received: " +
+            std::to_string(packed_bytes.size()));
+  }
+  std::memcpy(header, packed_bytes.data(), sizeof(PackedResponseHeader));
 
-  // Output Buffer: Convert size_t to uint64_t for a fixed-size guarantee
-  uint64_t u64_output_byte_size = static_cast<uint64_t>(output_byte_size);
-  total_byte_size += sizeof(uint64_t);
-  total_byte_size += u64_output_byte_size;
+  if (header->magic_ != kPackedResponseMagic) {
+    return Status(Status::Code::INTERNAL, "Unrecognized cache entry format");
+  }
+  const uint64_t table_end = sizeof(PackedResponseHeader) +
+                             header->num_outputs_ * sizeof(PackedOutput);
+  if ((header->byte_size_ != packed_bytes.size()) ||
+      (table_end > packed_bytes.size())) {
+    return Status(
+        Status::Code::INTERNAL,
+        "Unexpected number of bytes received: " +
+            std::to_string(packed_bytes.size()) +
+            ", expected: " + std::to_string(header->byte_size_));
+  }
 
-  *packed_output_byte_size = total_byte_size;
   return Status::Success;
 }
 
 Status
 CacheEntry::DeserializeResponseOutput(
-    boost::span<const Byte> packed_bytes, CacheOutput* output)
+    boost::span<const Byte> packed_bytes, const PackedResponseHeader& header,
+    const size_t index, CacheOutput* output)
 {
   if (!output) {
     return Status(Status::Code::INVALID_ARG, "output arg was nullptr");
   }
 
-  // Name
-  size_t position = 0;
-  uint32_t name_byte_size = 0;
-  memcpy(&name_byte_size, packed_bytes.begin() + position, sizeof(uint32_t));
-  position += sizeof(uint32_t);
-
-  auto name_start = packed_bytes.begin() + position;
-  std::string name(name_start, name_start + name_byte_size);
-  position += name_byte_size;
-
-  // Dtype
-  uint32_t dtype_byte_size = 0;
-  memcpy(&dtype_byte_size, packed_bytes.begin() + position, sizeof(uint32_t));
-  position += sizeof(uint32_t);
-
-  auto dtype_start = packed_bytes.begin() + position;
-  std::string dtype(dtype_start, dtype_start + dtype_byte_size);
-  position += dtype_byte_size;
-
-  // Shape
-  uint32_t shape_byte_size = 0;
-  memcpy(&shape_byte_size, packed_bytes.begin() + position, sizeof(uint32_t));
-  position += sizeof(uint32_t);
-
-  std::vector<int64_t> shape(shape_byte_size / sizeof(int64_t), 0);
-  memcpy(shape.data(), packed_bytes.begin() + position, shape_byte_size);
-  position += shape_byte_size;
-
-  // Output Buffer
-  uint64_t output_byte_size = 0;
-  memcpy(&output_byte_size, packed_bytes.begin() + position, sizeof(uint64_t));
-  position += sizeof(uint64_t);
-
-  // NOTE: Reference buffer section of packed bytes directly, DO NOT copy here.
-  // We will copy this buffer into the response object in BufferToResponse, so
-  // the buffer must remain valid until then. They should remain valid until the
-  // CacheEntry is destructed.
-  const void* output_buffer =
-      static_cast<const void*>(packed_bytes.data() + position);
-  position += output_byte_size;
-
-  // Verify packed bytes matched expected size before allocating output_buffer
-  if (packed_bytes.begin() + position != packed_bytes.end()) {
+  PackedOutput record;
+  std::memcpy(
+      &record,
+      packed_bytes.data() + sizeof(PackedResponseHeader) +
+          index * sizeof(PackedOutput),
+      sizeof(PackedOutput));
+
+  // Every section must lie within the packed bytes
+  const uint64_t size = header.byte_size_;
+  const uint64_t shape_byte_size = record.dims_count_ * sizeof(int64_t);
+  if ((record.name_offset_ + uint64_t(record.name_byte_size_) > size) ||
+      (record.shape_offset_ + shape_byte_size > size) ||
+      (record.data_offset_ > size) ||
+      (record.data_byte_size_ > (size - record.data_offset_))) {
     return Status(
-        Status::Code::INTERNAL, "Unexpected number of bytes received: " +
-                                    std::to_string(packed_bytes.size()) +
-                                    ", expected: " + std::to_string(position));
+        Status::Code::INTERNAL,
+        "Cache entry output " + std::to_string(index) + " is out of bounds");
+  }
+
+  const Byte* base = packed_bytes.data();
+  output->name_.assign(
+      reinterpret_cast<const char*>(base + record.name_offset_),
+      record.name_byte_size_);
+  output->dtype_ = static_cast<inference::DataType>(record.dtype_);
+  output->shape_.resize(record.dims_count_);
+  std::memcpy(
+      output->shape_.data(), base + record.shape_offset_, shape_byte_size);
+  // NOTE: Reference buffer section of packed bytes directly, DO NOT copy
+  // here. It is copied into or borrowed by the response object in
+  // DeserializeBuffer, so the buffer must remain valid until then.
+  output->codec_ = static_cast<CacheCodec>(record.codec_);
+  if (output->codec_ == CacheCodec::NONE) {
+    output->byte_size_ = record.data_byte_size_;
+    output->buffer_ = const_cast<Byte*>(base + record.data_offset_);
+    return Status::Success;
   }
 
-  output->name_ = name;
-  output->dtype_ = triton::common::ProtocolStringToDataType(dtype);
-  output->shape_ = shape;
-  output->byte_size_ = output_byte_size;
-  output->buffer_ = const_cast<void*>(output_buffer);
+  if (record.data_byte_size_ < sizeof(uint64_t)) {
+    return Status(
+        Status::Code::INTERNAL,
+        "Cache entry output " + std::to_string(index) + " is out of bounds");
+  }
+  std::memcpy(
+      &output->byte_size_, base + record.data_offset_, sizeof(uint64_t));
+  output->encoded_byte_size_ = record.data_byte_size_ - sizeof(uint64_t);
+  if (output->byte_size_ >
+      CacheMaxDecodedByteSize(output->encoded_byte_size_)) {
+    return Status(
+        Status::Code::INTERNAL,
+        "Cache entry output " + std::to_string(index) +
+            " has an invalid decoded size");
+  }
+  output->buffer_ =
+      const_cast<Byte*>(base + record.data_offset_ + sizeof(uint64_t));
   return Status::Success;
 }
 
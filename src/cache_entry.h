@@ -28,7 +28,9 @@
 #include <boost/core/span.hpp>
 #include <memory>
 #include <mutex>
+#include <unordered_map>
 #include <vector>
+#include "cache_codec.h"
 #include "infer_response.h"
 #include "triton/common/logging.h"
 #include "tritonserver_apis.h"
@@ -48,6 +50,39 @@ struct CacheOutput {
   void* buffer_ = nullptr;
   // Inference Response output buffer size
   uint64_t byte_size_ = 0;
+  // Codec of the cached buffer, if not NONE 'buffer_' holds
+  // 'encoded_byte_size_' encoded bytes that decode to 'byte_size_' bytes
+  CacheCodec codec_ = CacheCodec::NONE;
+  uint64_t encoded_byte_size_ = 0;
+};
+
+// Each response is packed into a single buffer laid out as:
+//   [PackedResponseHeader]
+//   [PackedOutput x num_outputs]
+//   [shape dims of each output, int64_t]
+//   [name of each output]
+//   [payload of each output, aligned to 64 bytes]
+// All offsets are relative to the start of the buffer, so an entry can
+// be read in place by pointer arithmetic wherever it is mapped.
+struct PackedResponseHeader {
+  uint32_t magic_;
+  uint32_t num_outputs_;
+  // Total size of the packed buffer
+  uint64_t byte_size_;
+};
+
+struct PackedOutput {
+  uint64_t data_offset_;
+  uint64_t data_byte_size_;
+  uint32_t name_offset_;
+  uint32_t name_byte_size_;
+  uint32_t shape_offset_;
+  uint32_t dims_count_;
+  // inference::DataType of the output
+  int32_t dtype_;
+  // CacheCodec of the payload. A compressed payload starts with its
+  // decoded byte size as a uint64_t.
+  uint32_t codec_;
 };
 
 // A Buffer is an arbitrary data blob whose type need not be known
@@ -64,9 +99,18 @@ class CacheEntry {
   size_t BufferCount();
   void AddBuffer(boost::span<Byte> buffer);
   void AddBuffer(void* base, size_t byte_size);
+  // Adds a buffer that stays valid for as long as 'owner' is referenced,
+  // which allows responses to reference it directly instead of copying.
+  void AddSharedBuffer(
+      void* base, size_t byte_size, std::shared_ptr<void>&& owner);
 
   /* Insert helpers */
   Status SerializeResponses(boost::span<InferenceResponse*> responses);
+  // Serializes 'response' into a buffer allocated and owned by this entry
+  // and appends it, so that responses released as soon as they are sent,
+  // such as the responses of a decoupled request, can be accumulated in
+  // order. Must not be mixed with buffers added by other means.
+  Status AppendResponse(InferenceResponse* response);
 
   // Adds a placeholder buffer to this CacheEntry object containing the
   // necessary size to hold the data we plan to insert into the cache.
@@ -91,23 +135,46 @@ class CacheEntry {
   // can be used to signal that the entry should free its buffers on destruction
   void FreeBuffersOnExit() { free_buffers_ = true; }
 
+  // Set the codec used to compress output payloads on insertion. Must be
+  // called before SetBufferSizes(). Lookups decode whatever codec the
+  // cached entry was written with.
+  void SetCodec(const CacheCodec codec) { codec_ = codec; }
+
+  // Estimated cost, in nanoseconds of compute, of recomputing the
+  // responses held by this entry. 0 if unknown.
+  void SetComputeCostNs(const uint64_t cost_ns) { compute_cost_ns_ = cost_ns; }
+  uint64_t ComputeCostNs() const { return compute_cost_ns_; }
+
  private:
   // Insert helpers
   Status SerializeResponse(InferenceResponse* response, Buffer& buffer);
-  Status SerializeResponseOutput(
-      const InferenceResponse::Output& output, Byte* buffer,
-      size_t* output_size);
   Status SetBufferSize(InferenceResponse* response);
-  // Calculates total byte size required to serialize response output and
-  // returns it in packed_output_byte_size
+  // Calculates total byte size required to serialize response and
+  // returns it in packed_response_byte_size
   Status GetByteSize(
-      const InferenceResponse::Output& output,
-      uint64_t* packed_output_byte_size);
+      const InferenceResponse& response, uint64_t* packed_response_byte_size);
+  // Returns the byte size of the header, output table, shapes and names
+  // that precede the first payload
+  static uint64_t MetadataByteSize(const InferenceResponse& response);
+  // Returns the byte size 'output' occupies in the payload section,
+  // encoding it into 'encoded_payloads_' if 'codec_' shrinks it
+  uint64_t PayloadByteSize(
+      const InferenceResponse::Output& output, const void* base,
+      const size_t byte_size);
+  // Fetches the data buffer of 'output', which must be in CPU memory
+  static Status OutputData(
+      const InferenceResponse::Output& output, const void** base,
+      size_t* byte_size);
 
   // Lookup helpers
-  Status DeserializeBuffer(InferenceResponse* response, const Buffer& buffer);
+  Status DeserializeBuffer(
+      InferenceResponse* response, const Buffer& buffer,
+      const std::shared_ptr<void>& owner);
+  static Status ReadHeader(
+      boost::span<const Byte> packed_bytes, PackedResponseHeader* header);
   Status DeserializeResponseOutput(
-      boost::span<const Byte> packed_bytes, CacheOutput* output);
+      boost::span<const Byte> packed_bytes, const PackedResponseHeader& header,
+      const size_t index, CacheOutput* output);
 
   // NOTE: performance gain may be possible by removing this mutex and
   //   guaranteeing that no two threads will access/modify an entry
@@ -117,8 +184,18 @@ class CacheEntry {
   //   This will remain for simplicity until further profiling is done.
   std::mutex buffer_mu_;
   std::vector<Buffer> buffers_;
+  // Owner of each buffer in 'buffers_', nullptr unless the buffer was
+  // added with AddSharedBuffer().
+  std::vector<std::shared_ptr<void>> buffer_owners_;
   // Free buffers on exit, default is false unless explicitly toggled
   bool free_buffers_ = false;
+
+  // Codec applied to payloads on insertion, and the payloads encoded by
+  // SetBufferSizes() keyed by the output data buffer they were encoded
+  // from. Outputs that don't shrink are stored as is and have no entry.
+  CacheCodec codec_ = CacheCodec::NONE;
+  uint64_t compute_cost_ns_ = 0;
+  std::unordered_map<const void*, std::vector<uint8_t>> encoded_payloads_;
 };
 
 }}  // namespace triton::core
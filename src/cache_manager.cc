@@ -25,8 +25,10 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "cache_manager.h"
-#include <boost/functional/hash.hpp>
+#include <algorithm>
+#include <cstdio>
 #include "cache_entry.h"
+#include "cuda_utils.h"
 #include "filesystem/api.h"
 #include "server_message.h"
 #include "shared_library.h"
@@ -34,6 +36,38 @@
 
 namespace triton { namespace core {
 
+namespace {
+
+// Prefix of every cache key, bumped whenever the way a request is
+// hashed or the way its responses are packed changes so that entries of
+// different formats never collide.
+constexpr char kCacheKeyVersion[] = "v3:";
+
+// Maximum number of insertions queued for the background insert
+// threads, either asynchronous inserts or write-backs to a cache tier,
+// and the number of threads performing them.
+constexpr size_t kMaxPendingInserts = 1024;
+constexpr size_t kInsertThreadCount = 2;
+
+#ifdef TRITON_ENABLE_GPU
+// Size of the host buffer used to stage device-resident inputs for
+// hashing.
+constexpr size_t kDeviceHashStagingSize = 4 * 1024 * 1024;
+#endif  // TRITON_ENABLE_GPU
+
+// Returns a view of each buffer of 'entry'
+std::vector<boost::span<Byte>>
+BufferSpans(CacheEntry* entry)
+{
+  std::vector<boost::span<Byte>> buffers;
+  for (const auto& buffer : entry->Buffers()) {
+    buffers.emplace_back(static_cast<Byte*>(buffer.first), buffer.second);
+  }
+  return buffers;
+}
+
+}  // namespace
+
 std::string
 TritonCacheLibraryName(const std::string& cache_name)
 {
@@ -68,6 +102,32 @@ CacheToResponseAllocator::Allocate(TRITONCACHE_CacheEntry* entry)
   return Status::Success;
 }
 
+CacheToResponseStreamAllocator::CacheToResponseStreamAllocator(
+    const InferenceResponseFactory* factory,
+    std::vector<std::unique_ptr<InferenceResponse>>* responses)
+    : factory_(factory), responses_(responses)
+{
+}
+
+Status
+CacheToResponseStreamAllocator::Allocate(TRITONCACHE_CacheEntry* entry)
+{
+  if (!entry) {
+    return Status(Status::Code::INVALID_ARG, "entry is nullptr");
+  }
+
+  const auto lentry = reinterpret_cast<CacheEntry*>(entry);
+  responses_->clear();
+  std::vector<InferenceResponse*> lresponses;
+  for (size_t i = 0; i < lentry->BufferCount(); ++i) {
+    responses_->emplace_back();
+    RETURN_IF_ERROR(factory_->CreateResponse(&responses_->back()));
+    lresponses.push_back(responses_->back().get());
+  }
+  RETURN_IF_ERROR(lentry->DeserializeBuffers(lresponses));
+  return Status::Success;
+}
+
 // NOTE: Bytes-related allocators only used for unit testing currently
 Status
 CacheToBytesAllocator::Allocate(TRITONCACHE_CacheEntry* entry)
@@ -185,13 +245,26 @@ TritonCache::Create(
 TritonCache::TritonCache(
     const std::string& name, const std::string& libpath,
     const std::string& cache_config)
-    : name_(name), libpath_(libpath), cache_config_(cache_config)
+    : name_(name), libpath_(libpath), cache_config_(cache_config),
+      write_back_(false), insert_exit_(false)
 {
   ClearHandles();
 }
 
 TritonCache::~TritonCache()
 {
+  // Drain pending inserts before the next tier may be released
+  if (!insert_threads_.empty()) {
+    {
+      std::lock_guard<std::mutex> lk(insert_mu_);
+      insert_exit_ = true;
+    }
+    insert_cv_.notify_all();
+    for (auto& thread : insert_threads_) {
+      thread.join();
+    }
+  }
+
   LOG_VERBOSE(1) << "unloading cache '" << name_ << "'";
   if (fini_fn_) {
     if (cache_impl_) {
@@ -222,6 +295,7 @@ TritonCache::ClearHandles()
   init_fn_ = nullptr;
   fini_fn_ = nullptr;
   lookup_fn_ = nullptr;
+  batch_lookup_fn_ = nullptr;
   insert_fn_ = nullptr;
 }
 
@@ -233,6 +307,7 @@ TritonCache::LoadCacheLibrary()
   TritonCacheInitFn_t init_fn;
   TritonCacheFiniFn_t fini_fn;
   TritonCacheLookupFn_t lookup_fn;
+  TritonCacheBatchLookupFn_t batch_lookup_fn;
   TritonCacheInsertFn_t insert_fn;
 
   // Load the library and initialize all the entrypoints
@@ -254,11 +329,16 @@ TritonCache::LoadCacheLibrary()
     RETURN_IF_ERROR(slib->GetEntrypoint(
         dlhandle_, "TRITONCACHE_CacheInsert", false /* optional */,
         reinterpret_cast<void**>(&insert_fn)));
+    // Batched lookup, optional
+    RETURN_IF_ERROR(slib->GetEntrypoint(
+        dlhandle_, "TRITONCACHE_CacheBatchLookup", true /* optional */,
+        reinterpret_cast<void**>(&batch_lookup_fn)));
   }
 
   init_fn_ = init_fn;
   fini_fn_ = fini_fn;
   lookup_fn_ = lookup_fn;
+  batch_lookup_fn_ = batch_lookup_fn;
   insert_fn_ = insert_fn;
   return Status::Success;
 }
@@ -282,31 +362,32 @@ TritonCache::InitializeCacheImpl()
 
 Status
 TritonCache::HashInputBuffers(
-    const InferenceRequest::Input* input, size_t* seed)
+    const InferenceRequest::Input* input, StreamHash64* hasher)
 {
+  // Hash the total size ahead of the data so that the boundary between
+  // this input and the next one is unambiguous.
+  hasher->Update(static_cast<uint64_t>(input->Data()->TotalByteSize()));
+
   // Iterate over each data buffer in input in case of non-contiguous memory
   for (size_t idx = 0; idx < input->DataBufferCount(); ++idx) {
     const void* src_buffer;
     size_t src_byte_size;
     TRITONSERVER_MemoryType src_memory_type;
     int64_t src_memory_type_id;
-
     RETURN_IF_ERROR(input->DataBuffer(
         idx, &src_buffer, &src_byte_size, &src_memory_type,
         &src_memory_type_id));
 
-    if (src_memory_type != TRITONSERVER_MEMORY_CPU &&
-        src_memory_type != TRITONSERVER_MEMORY_CPU_PINNED) {
-      return Status(
-          Status::Code::INTERNAL,
-          "Only input buffers in CPU memory are allowed in cache currently");
+    if (src_memory_type == TRITONSERVER_MEMORY_GPU) {
+      RETURN_IF_ERROR(HashDeviceBuffer(
+          input->Name(), src_buffer, src_byte_size, src_memory_type_id,
+          hasher));
+      continue;
     }
 
-    // Add each byte of input buffer chunk to hash
-    const unsigned char* tmp = static_cast<const unsigned char*>(src_buffer);
-    for (uint64_t byte = 0; byte < src_byte_size; byte++) {
-      boost::hash_combine(*seed, tmp[byte]);
-    }
+    // Buffer chunks are streamed into the same hash state so the result
+    // doesn't depend on how the input data is split.
+    hasher->Update(src_buffer, src_byte_size);
   }
 
   return Status::Success;
@@ -314,7 +395,44 @@ TritonCache::HashInputBuffers(
 
 
 Status
-TritonCache::HashInputs(const InferenceRequest& request, size_t* seed)
+TritonCache::HashDeviceBuffer(
+    const std::string& name, const void* buffer, const size_t byte_size,
+    const int64_t memory_type_id, StreamHash64* hasher)
+{
+#ifdef TRITON_ENABLE_GPU
+  // Stage the device buffer through a bounded host buffer so that large
+  // inputs don't require a host copy of the whole tensor. The bytes are
+  // hashed identically to a CPU input holding the same data.
+  const size_t staging_size = std::min(byte_size, kDeviceHashStagingSize);
+  std::unique_ptr<char[]> staging(new char[staging_size]);
+  const char* src = static_cast<const char*>(buffer);
+  for (size_t offset = 0; offset < byte_size; offset += staging_size) {
+    const size_t chunk_size = std::min(staging_size, byte_size - offset);
+    bool cuda_used = false;
+    RETURN_IF_ERROR(CopyBuffer(
+        "cache hash '" + name + "'", TRITONSERVER_MEMORY_GPU, memory_type_id,
+        TRITONSERVER_MEMORY_CPU, 0 /* dst_memory_type_id */, chunk_size,
+        src + offset, staging.get(), nullptr /* cuda_stream */, &cuda_used));
+    if (cuda_used) {
+      RETURN_IF_CUDA_ERR(
+          cudaStreamSynchronize(nullptr),
+          std::string("failed to copy input '") + name + "' for hashing");
+    }
+    hasher->Update(staging.get(), chunk_size);
+  }
+  return Status::Success;
+#else
+  return Status(
+      Status::Code::INTERNAL,
+      "input '" + name +
+          "' is in GPU memory but GPU support is not enabled, can't hash "
+          "it for the response cache");
+#endif  // TRITON_ENABLE_GPU
+}
+
+
+Status
+TritonCache::HashInputs(const InferenceRequest& request, StreamHash64* hasher)
 {
   const auto& inputs = request.ImmutableInputs();
   // Convert inputs to ordered map for consistency in hashing
@@ -323,9 +441,9 @@ TritonCache::HashInputs(const InferenceRequest& request, size_t* seed)
       inputs.begin(), inputs.end());
   for (const auto& input : ordered_inputs) {
     // Add input name to hash
-    boost::hash_combine(*seed, input.second->Name());
+    hasher->Update(input.second->Name());
     // Fetch input buffer for hashing raw data
-    RETURN_IF_ERROR(HashInputBuffers(input.second, seed));
+    RETURN_IF_ERROR(HashInputBuffers(input.second, hasher));
   }
 
   return Status::Success;
@@ -335,14 +453,21 @@ TritonCache::HashInputs(const InferenceRequest& request, size_t* seed)
 Status
 TritonCache::Hash(const InferenceRequest& request, std::string* key)
 {
-  std::size_t seed = 0;
+  StreamHash64 hasher;
   // Add request model name to hash
-  boost::hash_combine(seed, request.ModelName());
+  hasher.Update(request.ModelName());
   // Add request model version to hash
-  boost::hash_combine(seed, request.ActualModelVersion());
-  RETURN_IF_ERROR(HashInputs(request, &seed));
+  hasher.Update(request.ActualModelVersion());
+  RETURN_IF_ERROR(HashInputs(request, &hasher));
+
+  // The key is prefixed with the hash format version so that entries
+  // written by a different hash scheme can never be matched by mistake.
   // NOTE: Could prepend model name/version in key for readability/debugging
-  *key = std::to_string(seed);
+  char digest[17];
+  snprintf(
+      digest, sizeof(digest), "%016llx",
+      static_cast<unsigned long long>(hasher.Digest()));
+  *key = std::string(kCacheKeyVersion) + digest;
   return Status::Success;
 }
 
@@ -367,9 +492,11 @@ TritonCache::Insert(
 
 Status
 TritonCache::Insert(
-    std::vector<boost::span<Byte>> buffers, const std::string& key)
+    std::vector<boost::span<Byte>> buffers, const std::string& key,
+    const uint64_t compute_cost_ns)
 {
   std::unique_ptr<CacheEntry> entry = std::make_unique<CacheEntry>();
+  entry->SetComputeCostNs(compute_cost_ns);
   RETURN_IF_ERROR(entry->SetBufferSizes(buffers));
 
   auto allocator = BytesToCacheAllocator(buffers);
@@ -377,11 +504,170 @@ TritonCache::Insert(
   return Insert(entry.get(), key, opaque_allocator);
 }
 
+void
+TritonCache::SetNextTier(
+    const std::shared_ptr<TritonCache>& next_tier, const bool write_back)
+{
+  next_tier_ = next_tier;
+  write_back_ = write_back;
+}
+
 Status
 TritonCache::Insert(
-    boost::span<InferenceResponse*> responses, const std::string& key)
+    boost::span<InferenceResponse*> responses, const std::string& key,
+    const CacheCodec codec, const uint64_t compute_cost_ns)
+{
+  // The status of this cache is returned so that ALREADY_EXISTS still
+  // tells the caller that another request inserted the key first.
+  Status status = InsertLocal(responses, key, codec, compute_cost_ns);
+  if ((next_tier_ != nullptr) && status.IsOk()) {
+    if (write_back_) {
+      LOG_STATUS_ERROR(
+          QueueInsert(
+              responses, key, codec, compute_cost_ns, false /* local */),
+          "failed to queue write-back to cache '" + next_tier_->Name() + "'");
+    } else {
+      LOG_STATUS_ERROR(
+          next_tier_->Insert(responses, key, codec, compute_cost_ns),
+          "failed to insert into cache '" + next_tier_->Name() + "'");
+    }
+  }
+  return status;
+}
+
+Status
+TritonCache::InsertEntry(
+    std::unique_ptr<CacheEntry>&& entry, const std::string& key,
+    const bool async)
+{
+  if (!entry) {
+    return Status(Status::Code::INVALID_ARG, "entry is nullptr");
+  }
+  if (async) {
+    return QueueInsert(std::move(entry), key, true /* local */);
+  }
+
+  const auto buffers = BufferSpans(entry.get());
+  const uint64_t cost_ns = entry->ComputeCostNs();
+  Status status = Insert(buffers, key, cost_ns);
+  if ((next_tier_ != nullptr) && status.IsOk()) {
+    if (write_back_) {
+      LOG_STATUS_ERROR(
+          QueueInsert(std::move(entry), key, false /* local */),
+          "failed to queue write-back to cache '" + next_tier_->Name() + "'");
+    } else {
+      LOG_STATUS_ERROR(
+          next_tier_->Insert(buffers, key, cost_ns),
+          "failed to insert into cache '" + next_tier_->Name() + "'");
+    }
+  }
+  return status;
+}
+
+Status
+TritonCache::InsertAsync(
+    InferenceResponse* response, const std::string& key,
+    const CacheCodec codec, const uint64_t compute_cost_ns)
+{
+  if (!response) {
+    return Status(Status::Code::INVALID_ARG, "response is nullptr");
+  }
+
+  return QueueInsert(
+      {&response, 1}, key, codec, compute_cost_ns, true /* local */);
+}
+
+Status
+TritonCache::QueueInsert(
+    boost::span<InferenceResponse*> responses, const std::string& key,
+    const CacheCodec codec, const uint64_t compute_cost_ns, const bool local)
+{
+  // The responses are released once this returns, so they are packed
+  // into buffers owned by the entry first.
+  std::unique_ptr<CacheEntry> entry = std::make_unique<CacheEntry>();
+  entry->SetCodec(codec);
+  entry->SetComputeCostNs(compute_cost_ns);
+  for (const auto response : responses) {
+    RETURN_IF_ERROR(entry->AppendResponse(response));
+  }
+  return QueueInsert(std::move(entry), key, local);
+}
+
+Status
+TritonCache::QueueInsert(
+    std::unique_ptr<CacheEntry>&& entry, const std::string& key,
+    const bool local)
+{
+  std::call_once(insert_threads_once_, [this]() {
+    for (size_t i = 0; i < kInsertThreadCount; ++i) {
+      insert_threads_.emplace_back([this]() { InsertThread(); });
+    }
+  });
+
+  {
+    std::lock_guard<std::mutex> lk(insert_mu_);
+    // Queued inserts are best effort, drop the insert rather than
+    // growing without bound if the cache can't keep up.
+    if (insert_queue_.size() >= kMaxPendingInserts) {
+      LOG_VERBOSE(1) << "dropping pending insert of cache key " << key
+                     << " into cache '"
+                     << (local ? name_ : next_tier_->Name()) << "'";
+      return Status::Success;
+    }
+    insert_queue_.emplace_back(PendingInsert{key, std::move(entry), local});
+  }
+  insert_cv_.notify_one();
+  return Status::Success;
+}
+
+void
+TritonCache::InsertThread()
+{
+  std::unique_lock<std::mutex> lk(insert_mu_);
+  while (true) {
+    insert_cv_.wait(
+        lk, [this]() { return insert_exit_ || !insert_queue_.empty(); });
+    if (insert_queue_.empty()) {
+      // Only reached on exit once all pending inserts are done
+      break;
+    }
+
+    auto pending = std::move(insert_queue_.front());
+    insert_queue_.pop_front();
+    lk.unlock();
+
+    const auto buffers = BufferSpans(pending.entry_.get());
+
+    // An asynchronous insert into this cache also goes to the next tier
+    // as this thread is already off the request path.
+    const uint64_t cost_ns = pending.entry_->ComputeCostNs();
+    Status status = Status::Success;
+    if (pending.local_) {
+      status = Insert(buffers, pending.key_, cost_ns);
+      if ((next_tier_ != nullptr) && status.IsOk()) {
+        status = next_tier_->Insert(buffers, pending.key_, cost_ns);
+      }
+    } else {
+      status = next_tier_->Insert(buffers, pending.key_, cost_ns);
+    }
+    if (!status.IsOk() &&
+        (status.StatusCode() != Status::Code::ALREADY_EXISTS)) {
+      LOG_VERBOSE(1) << "failed pending insert of cache key " << pending.key_
+                     << ": " << status.AsString();
+    }
+
+    lk.lock();
+  }
+}
+
+Status
+TritonCache::InsertLocal(
+    boost::span<InferenceResponse*> responses, const std::string& key,
+    const CacheCodec codec, const uint64_t compute_cost_ns)
 {
   std::unique_ptr<CacheEntry> entry = std::make_unique<CacheEntry>();
+  entry->SetCodec(codec);
+  entry->SetComputeCostNs(compute_cost_ns);
   RETURN_IF_ERROR(entry->SetBufferSizes(responses));
 
   auto allocator = ResponseToCacheAllocator(responses);
@@ -390,13 +676,15 @@ TritonCache::Insert(
 }
 
 Status
-TritonCache::Insert(InferenceResponse* response, const std::string& key)
+TritonCache::Insert(
+    InferenceResponse* response, const std::string& key,
+    const CacheCodec codec, const uint64_t compute_cost_ns)
 {
   if (!response) {
     return Status(Status::Code::INVALID_ARG, "response is nullptr");
   }
 
-  return Insert({&response, 1}, key);
+  return Insert({&response, 1}, key, codec, compute_cost_ns);
 }
 
 Status
@@ -428,8 +716,39 @@ TritonCache::Lookup(const std::string& key, CacheEntry* entry)
   return Lookup(key, entry, opaque_allocator);
 }
 
-// NOTE: Multiple responses won't be expected until supporting decoupled
-// or sequence models.
+Status
+TritonCache::Lookup(
+    const std::string& key,
+    const std::shared_ptr<InferenceResponseFactory>& factory,
+    std::vector<std::unique_ptr<InferenceResponse>>* responses)
+{
+  if (!factory || !responses) {
+    return Status(Status::Code::INVALID_ARG, "factory or responses is nullptr");
+  }
+
+  auto lentry = std::make_unique<CacheEntry>();
+  auto allocator = CacheToResponseStreamAllocator(factory.get(), responses);
+  auto opaque_allocator = reinterpret_cast<TRITONCACHE_Allocator*>(&allocator);
+  Status status = Lookup(key, lentry.get(), opaque_allocator);
+  if (status.IsOk()) {
+    return status;
+  }
+  responses->clear();
+  if (next_tier_ == nullptr) {
+    return status;
+  }
+
+  RETURN_IF_ERROR(next_tier_->Lookup(key, factory, responses));
+  std::vector<InferenceResponse*> lresponses;
+  for (const auto& response : *responses) {
+    lresponses.push_back(response.get());
+  }
+  LOG_STATUS_ERROR(
+      InsertLocal(lresponses, key, CacheCodec::NONE, 0 /* compute_cost_ns */),
+      "failed to promote cache key into cache '" + name_ + "'");
+  return Status::Success;
+}
+
 Status
 TritonCache::Lookup(
     boost::span<InferenceResponse*> responses, const std::string& key)
@@ -438,7 +757,17 @@ TritonCache::Lookup(
   // Create response allocator to copy directly from cache to response buffers
   auto allocator = CacheToResponseAllocator(responses);
   auto opaque_allocator = reinterpret_cast<TRITONCACHE_Allocator*>(&allocator);
-  RETURN_IF_ERROR(Lookup(key, lentry.get(), opaque_allocator));
+  Status status = Lookup(key, lentry.get(), opaque_allocator);
+  if (status.IsOk() || (next_tier_ == nullptr)) {
+    return status;
+  }
+
+  // Serve the miss from the next tier and promote the hit so that the
+  // following lookups of 'key' are served by this cache.
+  RETURN_IF_ERROR(next_tier_->Lookup(responses, key));
+  LOG_STATUS_ERROR(
+      InsertLocal(responses, key, CacheCodec::NONE, 0 /* compute_cost_ns */),
+      "failed to promote cache key into cache '" + name_ + "'");
   return Status::Success;
 }
 
@@ -451,6 +780,118 @@ TritonCache::Lookup(InferenceResponse* response, const std::string& key)
   return Lookup({&response, 1}, key);
 }
 
+Status
+TritonCache::Lookup(
+    const std::vector<std::string>& keys,
+    const std::vector<InferenceResponse*>& responses,
+    std::vector<Status>* statuses)
+{
+  if (keys.size() != responses.size()) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "expected the same number of keys and responses, got " +
+            std::to_string(keys.size()) + " keys and " +
+            std::to_string(responses.size()) + " responses");
+  }
+
+  statuses->clear();
+  statuses->reserve(keys.size());
+
+  // Without batched lookup support in the cache implementation, fall back
+  // to looking up each key individually.
+  if (batch_lookup_fn_ == nullptr) {
+    for (size_t idx = 0; idx < keys.size(); ++idx) {
+      statuses->emplace_back(Lookup(responses[idx], keys[idx]));
+    }
+    return Status::Success;
+  }
+
+  const size_t count = keys.size();
+  std::vector<std::unique_ptr<CacheEntry>> entries;
+  std::vector<CacheToResponseAllocator> allocators;
+  entries.reserve(count);
+  allocators.reserve(count);
+  std::vector<const char*> opaque_keys(count);
+  std::vector<TRITONCACHE_CacheEntry*> opaque_entries(count);
+  std::vector<TRITONCACHE_Allocator*> opaque_allocators(count);
+  std::vector<TRITONSERVER_Error*> errors(count, nullptr);
+  for (size_t idx = 0; idx < count; ++idx) {
+    if (responses[idx] == nullptr) {
+      return Status(Status::Code::INVALID_ARG, "response is nullptr");
+    }
+    LOG_VERBOSE(2) << "Looking up cache key: " << keys[idx];
+    entries.emplace_back(new CacheEntry());
+    InferenceResponse* response = responses[idx];
+    allocators.emplace_back(boost::span<InferenceResponse*>(&response, 1));
+    opaque_keys[idx] = keys[idx].c_str();
+    opaque_entries[idx] =
+        reinterpret_cast<TRITONCACHE_CacheEntry*>(entries.back().get());
+    opaque_allocators[idx] =
+        reinterpret_cast<TRITONCACHE_Allocator*>(&allocators.back());
+  }
+
+  RETURN_IF_TRITONSERVER_ERROR(batch_lookup_fn_(
+      cache_impl_, opaque_keys.data(), opaque_entries.data(),
+      opaque_allocators.data(), errors.data(), count));
+
+  for (auto err : errors) {
+    if (err == nullptr) {
+      statuses->emplace_back(Status::Success);
+    } else {
+      statuses->emplace_back(
+          TritonCodeToStatusCode(TRITONSERVER_ErrorCode(err)),
+          TRITONSERVER_ErrorMessage(err));
+      TRITONSERVER_ErrorDelete(err);
+    }
+  }
+
+  if (next_tier_ != nullptr) {
+    LookupNextTier(keys, responses, statuses);
+  }
+  return Status::Success;
+}
+
+void
+TritonCache::LookupNextTier(
+    const std::vector<std::string>& keys,
+    const std::vector<InferenceResponse*>& responses,
+    std::vector<Status>* statuses)
+{
+  // Look up the misses of this cache in the next tier as one batch
+  std::vector<size_t> misses;
+  std::vector<std::string> miss_keys;
+  std::vector<InferenceResponse*> miss_responses;
+  for (size_t idx = 0; idx < keys.size(); ++idx) {
+    if (!(*statuses)[idx].IsOk()) {
+      misses.push_back(idx);
+      miss_keys.push_back(keys[idx]);
+      miss_responses.push_back(responses[idx]);
+    }
+  }
+  if (misses.empty()) {
+    return;
+  }
+
+  std::vector<Status> miss_statuses;
+  Status status = next_tier_->Lookup(miss_keys, miss_responses, &miss_statuses);
+  if (!status.IsOk()) {
+    LOG_VERBOSE(1) << "failed to look up cache '" << next_tier_->Name()
+                   << "': " << status.AsString();
+    return;
+  }
+
+  for (size_t i = 0; i < misses.size(); ++i) {
+    if (miss_statuses[i].IsOk()) {
+      (*statuses)[misses[i]] = Status::Success;
+      LOG_STATUS_ERROR(
+          InsertLocal(
+              {&miss_responses[i], 1}, miss_keys[i], CacheCodec::NONE,
+              0 /* compute_cost_ns */),
+          "failed to promote cache key into cache '" + name_ + "'");
+    }
+  }
+}
+
 //
 // TritonCacheManager
 //
@@ -495,6 +936,70 @@ TritonCacheManager::CreateCache(
         "TritonCacheManager already holds a cache");
   }
 
+  RETURN_IF_ERROR(LoadCache(name, cache_config, &cache_));
+  *cache = cache_;
+  return Status::Success;
+}
+
+Status
+TritonCacheManager::CreateTieredCache(
+    const std::string& tier_config,
+    const std::unordered_map<std::string, std::string>& cache_configs,
+    std::shared_ptr<TritonCache>* cache)
+{
+  std::lock_guard<std::mutex> lock(mu_);
+
+  if (cache_ != nullptr) {
+    return Status(
+        Status::Code::ALREADY_EXISTS,
+        "TritonCacheManager already holds a cache");
+  }
+
+  triton::common::TritonJson::Value tier_json;
+  RETURN_IF_ERROR(tier_json.Parse(tier_config));
+  std::string l1_name, l2_name;
+  RETURN_IF_ERROR(tier_json.MemberAsString("l1", &l1_name));
+  RETURN_IF_ERROR(tier_json.MemberAsString("l2", &l2_name));
+  std::string write_policy = "write_through";
+  if (tier_json.Find("write_policy")) {
+    RETURN_IF_ERROR(tier_json.MemberAsString("write_policy", &write_policy));
+  }
+  if ((write_policy != "write_through") && (write_policy != "write_back")) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "unknown tiered cache write_policy '" + write_policy +
+            "', expected 'write_through' or 'write_back'");
+  }
+
+  // Every other cache configuration must be one of the tiers
+  const auto l1_config = cache_configs.find(l1_name);
+  const auto l2_config = cache_configs.find(l2_name);
+  if ((l1_name == l2_name) || (l1_config == cache_configs.end()) ||
+      (l2_config == cache_configs.end()) || (cache_configs.size() != 3)) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "tiered cache expects exactly two other cache configurations, "
+        "named by its 'l1' and 'l2' settings, got l1: '" +
+            l1_name + "', l2: '" + l2_name + "'");
+  }
+
+  std::shared_ptr<TritonCache> l1, l2;
+  RETURN_IF_ERROR(LoadCache(l1_name, l1_config->second, &l1));
+  RETURN_IF_ERROR(LoadCache(l2_name, l2_config->second, &l2));
+  LOG_INFO << "Stacking cache '" << l1_name << "' in front of cache '"
+           << l2_name << "' with " << write_policy << " policy";
+  l1->SetNextTier(l2, (write_policy == "write_back"));
+
+  cache_ = std::move(l1);
+  *cache = cache_;
+  return Status::Success;
+}
+
+Status
+TritonCacheManager::LoadCache(
+    const std::string& name, const std::string& cache_config,
+    std::shared_ptr<TritonCache>* cache)
+{
   // Get the path to the cache shared library. Search path is global
   // cache directory.
   const std::vector<std::string> search_paths = {JoinPath({cache_dir_, name})};
@@ -519,9 +1024,7 @@ TritonCacheManager::CreateCache(
                                        "' for cache. Searched: " + cache_dir_);
   }
 
-  RETURN_IF_ERROR(TritonCache::Create(name, libpath, cache_config, &cache_));
-  *cache = cache_;
-  return Status::Success;
+  return TritonCache::Create(name, libpath, cache_config, cache);
 }
 
 }}  // namespace triton::core
@@ -26,17 +26,23 @@
 #pragma once
 
 #include <boost/core/span.hpp>
+#include <condition_variable>
 #include <cstddef>
+#include <deque>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
+#include "cache_codec.h"
 #include "cache_entry.h"
 #include "constants.h"
 #include "infer_request.h"
 #include "infer_response.h"
 #include "server_message.h"
 #include "status.h"
+#include "stream_hash.h"
 #include "triton/common/model_config.h"
 #include "tritonserver_apis.h"
 
@@ -60,6 +66,20 @@ class CacheToResponseAllocator : TritonCacheAllocator {
   std::vector<InferenceResponse*> responses_;
 };
 
+// Creates a response with 'factory' for each buffer of the cache entry,
+// for lookups where the number of cached responses isn't known up front.
+class CacheToResponseStreamAllocator : TritonCacheAllocator {
+ public:
+  CacheToResponseStreamAllocator(
+      const InferenceResponseFactory* factory,
+      std::vector<std::unique_ptr<InferenceResponse>>* responses);
+  Status Allocate(TRITONCACHE_CacheEntry* entry);
+
+ private:
+  const InferenceResponseFactory* factory_;
+  std::vector<std::unique_ptr<InferenceResponse>>* responses_;
+};
+
 class ResponseToCacheAllocator : TritonCacheAllocator {
  public:
   ResponseToCacheAllocator(boost::span<InferenceResponse*> responses);
@@ -97,10 +117,43 @@ class TritonCache {
 
   const std::string& Name() const { return name_; }
   const std::string& CacheConfig() const { return cache_config_; }
-  Status Insert(InferenceResponse* response, const std::string& key);
+
+  // Place 'next_tier' behind this cache. Lookups that miss this cache
+  // are forwarded to 'next_tier' and hits there are promoted into this
+  // cache. Insertions are written to 'next_tier' synchronously, or by
+  // the background insert threads if 'write_back' is true. Must be
+  // called before the cache is used.
+  void SetNextTier(
+      const std::shared_ptr<TritonCache>& next_tier, const bool write_back);
+  // Insert responses under "key", compressing output payloads with
+  // "codec" where that makes them smaller. "compute_cost_ns" is the
+  // estimated cost of recomputing the responses, 0 if unknown, which is
+  // passed to the cache implementation as an eviction hint.
   Status Insert(
-      boost::span<InferenceResponse*> responses, const std::string& key);
-  Status Insert(std::vector<boost::span<Byte>> buffers, const std::string& key);
+      InferenceResponse* response, const std::string& key,
+      const CacheCodec codec = CacheCodec::NONE,
+      const uint64_t compute_cost_ns = 0);
+  Status Insert(
+      boost::span<InferenceResponse*> responses, const std::string& key,
+      const CacheCodec codec = CacheCodec::NONE,
+      const uint64_t compute_cost_ns = 0);
+  Status Insert(
+      std::vector<boost::span<Byte>> buffers, const std::string& key,
+      const uint64_t compute_cost_ns = 0);
+  // Snapshot "response" and leave the insertion to background threads.
+  // The insert is dropped if too many are pending, so success only means
+  // that the response was accepted.
+  Status InsertAsync(
+      InferenceResponse* response, const std::string& key,
+      const CacheCodec codec = CacheCodec::NONE,
+      const uint64_t compute_cost_ns = 0);
+  // Insert the responses accumulated in "entry" with
+  // CacheEntry::AppendResponse() under "key", e.g. the response stream of
+  // a decoupled request. The insertion is left to the background insert
+  // threads if "async".
+  Status InsertEntry(
+      std::unique_ptr<CacheEntry>&& entry, const std::string& key,
+      const bool async);
   Status Insert(
       CacheEntry* entry, const std::string& key,
       TRITONCACHE_Allocator* allocator);
@@ -108,11 +161,26 @@ class TritonCache {
   Status Lookup(
       boost::span<InferenceResponse*> responses, const std::string& key);
   Status Lookup(const std::string& key, CacheEntry* entry);
+  // Lookup "key" and create a response with "factory" for each of the
+  // cached responses, in the order they were inserted. "responses" is
+  // empty unless the lookup succeeds.
+  Status Lookup(
+      const std::string& key,
+      const std::shared_ptr<InferenceResponseFactory>& factory,
+      std::vector<std::unique_ptr<InferenceResponse>>* responses);
   Status Lookup(
       const std::string& key, CacheEntry* entry,
       TRITONCACHE_Allocator* allocator);
-  // Hashes fields of request and stores it in "key"
-  Status Hash(const InferenceRequest& request, std::string* key);
+  // Lookup each of 'keys' and copy the cached entry into the response at
+  // the same index of 'responses'. 'statuses' returns the result of each
+  // lookup. A non-success return indicates that no lookup was performed.
+  Status Lookup(
+      const std::vector<std::string>& keys,
+      const std::vector<InferenceResponse*>& responses,
+      std::vector<Status>* statuses);
+  // Hashes fields of request and stores it in "key". The hash doesn't
+  // depend on the cache so it can be used without a cache instance.
+  static Status Hash(const InferenceRequest& request, std::string* key);
 
  private:
   TritonCache(
@@ -122,10 +190,38 @@ class TritonCache {
   void ClearHandles();
   Status LoadCacheLibrary();
   Status InitializeCacheImpl();
+  // Insert "responses" into this cache only, not into the next tier
+  Status InsertLocal(
+      boost::span<InferenceResponse*> responses, const std::string& key,
+      const CacheCodec codec, const uint64_t compute_cost_ns);
+  // Serialize "responses" in the calling thread and queue the insert
+  // into this cache if "local", or into the next tier otherwise, for
+  // the background insert threads
+  Status QueueInsert(
+      boost::span<InferenceResponse*> responses, const std::string& key,
+      const CacheCodec codec, const uint64_t compute_cost_ns,
+      const bool local);
+  Status QueueInsert(
+      std::unique_ptr<CacheEntry>&& entry, const std::string& key,
+      const bool local);
+  void InsertThread();
+  // Look up the keys whose status in "statuses" is not OK in the next
+  // tier, updating "statuses" and promoting the hits
+  void LookupNextTier(
+      const std::vector<std::string>& keys,
+      const std::vector<InferenceResponse*>& responses,
+      std::vector<Status>* statuses);
   // Helper function to hash data buffers used by "input"
-  Status HashInputBuffers(const InferenceRequest::Input* input, size_t* seed);
+  static Status HashInputBuffers(
+      const InferenceRequest::Input* input, StreamHash64* hasher);
+  // Helper function to hash an input data buffer that resides in GPU
+  // memory by staging it through host memory
+  static Status HashDeviceBuffer(
+      const std::string& name, const void* buffer, const size_t byte_size,
+      const int64_t memory_type_id, StreamHash64* hasher);
   // Helper function to hash each input in "request"
-  Status HashInputs(const InferenceRequest& request, size_t* seed);
+  static Status HashInputs(
+      const InferenceRequest& request, StreamHash64* hasher);
 
   // The name of the cache.
   const std::string name_;
@@ -150,10 +246,34 @@ class TritonCache {
       TRITONCACHE_Cache* cache, const char* key, TRITONCACHE_CacheEntry* entry,
       TRITONCACHE_Allocator* allocator);
   TritonCacheLookupFn_t lookup_fn_;
+  typedef TRITONSERVER_Error* (*TritonCacheBatchLookupFn_t)(
+      TRITONCACHE_Cache* cache, const char** keys,
+      TRITONCACHE_CacheEntry** entries, TRITONCACHE_Allocator** allocators,
+      TRITONSERVER_Error** errors, size_t count);
+  // Optional, nullptr if the cache doesn't implement batched lookup.
+  TritonCacheBatchLookupFn_t batch_lookup_fn_;
   typedef TRITONSERVER_Error* (*TritonCacheInsertFn_t)(
       TRITONCACHE_Cache* cache, const char* key, TRITONCACHE_CacheEntry* entry,
       TRITONCACHE_Allocator* allocator);
   TritonCacheInsertFn_t insert_fn_;
+
+  // The next cache tier, if any.
+  std::shared_ptr<TritonCache> next_tier_;
+  bool write_back_;
+
+  // Inserts queued by InsertAsync() and write-backs to the next tier,
+  // performed by the background insert threads started on first use.
+  struct PendingInsert {
+    std::string key_;
+    std::unique_ptr<CacheEntry> entry_;
+    bool local_;
+  };
+  std::mutex insert_mu_;
+  std::condition_variable insert_cv_;
+  std::deque<PendingInsert> insert_queue_;
+  bool insert_exit_;
+  std::once_flag insert_threads_once_;
+  std::vector<std::thread> insert_threads_;
 };
 
 //
@@ -168,10 +288,23 @@ class TritonCacheManager {
       const std::string& name, const std::string& cache_config,
       std::shared_ptr<TritonCache>* cache);
 
+  // Create the caches named by 'tier_config', a JSON object with an
+  // "l1" and an "l2" cache name and an optional "write_policy" of
+  // "write_through" (default) or "write_back", from their configs in
+  // 'cache_configs', and stack them with the L1 cache in front.
+  Status CreateTieredCache(
+      const std::string& tier_config,
+      const std::unordered_map<std::string, std::string>& cache_configs,
+      std::shared_ptr<TritonCache>* cache);
+
   std::shared_ptr<TritonCache> Cache() { return cache_; }
 
  private:
   DISALLOW_COPY_AND_ASSIGN(TritonCacheManager);
+  // Load the cache library 'name' and create a cache from it
+  Status LoadCache(
+      const std::string& name, const std::string& cache_config,
+      std::shared_ptr<TritonCache>* cache);
   TritonCacheManager(std::string cache_dir) : cache_dir_(cache_dir) {}
   // Global search path for cache libraries
   std::string cache_dir_;
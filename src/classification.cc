@@ -0,0 +1,169 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "classification.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace triton { namespace core {
+
+namespace {
+
+// The number of elements compared against the threshold at once
+constexpr size_t kBlockSize = 64;
+
+template <typename T>
+void
+SelectTopK(
+    const T* scores, const size_t element_count, const size_t k,
+    std::vector<std::pair<T, uint64_t>>* selected)
+{
+  // Min-heap of the best 'k' so far, the worst of them at the front. An
+  // entry is worse if its score is lower or, for equal scores, if its
+  // class index is higher.
+  auto worse = [](const std::pair<T, uint64_t>& lhs,
+                  const std::pair<T, uint64_t>& rhs) {
+    return (lhs.first > rhs.first) ||
+           ((lhs.first == rhs.first) && (lhs.second < rhs.second));
+  };
+  auto& heap = *selected;
+  heap.clear();
+  if (k == 0) {
+    return;
+  }
+  heap.reserve(k);
+
+  size_t idx = 0;
+  // Fill the heap, skipping NaN which compares false with everything
+  for (; (idx < element_count) && (heap.size() < k); ++idx) {
+    if (scores[idx] == scores[idx]) {
+      heap.emplace_back(scores[idx], idx);
+      std::push_heap(heap.begin(), heap.end(), worse);
+    }
+  }
+  if (heap.size() < k) {
+    return;
+  }
+
+  T threshold = heap.front().first;
+  while (idx < element_count) {
+    const size_t block_end = std::min(element_count, idx + kBlockSize);
+    // Elements equal to the threshold have a higher class index than
+    // every element in the heap, so only greater ones are candidates.
+    size_t candidates = 0;
+    for (size_t i = idx; i < block_end; ++i) {
+      candidates += (scores[i] > threshold) ? 1 : 0;
+    }
+    if (candidates != 0) {
+      for (size_t i = idx; i < block_end; ++i) {
+        if (scores[i] > threshold) {
+          std::pop_heap(heap.begin(), heap.end(), worse);
+          heap.back() = std::make_pair(scores[i], i);
+          std::push_heap(heap.begin(), heap.end(), worse);
+          threshold = heap.front().first;
+        }
+      }
+    }
+    idx = block_end;
+  }
+}
+
+template <typename T>
+void
+TopK(
+    const void* base, const size_t element_count, const size_t k,
+    std::vector<uint64_t>* indices, std::vector<double>* scores)
+{
+  std::vector<std::pair<T, uint64_t>> selected;
+  SelectTopK(static_cast<const T*>(base), element_count, k, &selected);
+  std::sort(
+      selected.begin(), selected.end(),
+      [](const std::pair<T, uint64_t>& lhs, const std::pair<T, uint64_t>& rhs) {
+        return (lhs.first > rhs.first) ||
+               ((lhs.first == rhs.first) && (lhs.second < rhs.second));
+      });
+
+  indices->clear();
+  scores->clear();
+  indices->reserve(selected.size());
+  scores->reserve(selected.size());
+  for (const auto& entry : selected) {
+    indices->push_back(entry.second);
+    scores->push_back(static_cast<double>(entry.first));
+  }
+}
+
+}  // namespace
+
+Status
+TopKClasses(
+    const void* base, const inference::DataType dtype,
+    const size_t element_count, const size_t k, std::vector<uint64_t>* indices,
+    std::vector<double>* scores)
+{
+  switch (dtype) {
+    case inference::DataType::TYPE_UINT8:
+      TopK<uint8_t>(base, element_count, k, indices, scores);
+      break;
+    case inference::DataType::TYPE_UINT16:
+      TopK<uint16_t>(base, element_count, k, indices, scores);
+      break;
+    case inference::DataType::TYPE_UINT32:
+      TopK<uint32_t>(base, element_count, k, indices, scores);
+      break;
+    case inference::DataType::TYPE_UINT64:
+      TopK<uint64_t>(base, element_count, k, indices, scores);
+      break;
+    case inference::DataType::TYPE_INT8:
+      TopK<int8_t>(base, element_count, k, indices, scores);
+      break;
+    case inference::DataType::TYPE_INT16:
+      TopK<int16_t>(base, element_count, k, indices, scores);
+      break;
+    case inference::DataType::TYPE_INT32:
+      TopK<int32_t>(base, element_count, k, indices, scores);
+      break;
+    case inference::DataType::TYPE_INT64:
+      TopK<int64_t>(base, element_count, k, indices, scores);
+      break;
+    case inference::DataType::TYPE_FP32:
+      TopK<float>(base, element_count, k, indices, scores);
+      break;
+    case inference::DataType::TYPE_FP64:
+      TopK<double>(base, element_count, k, indices, scores);
+      break;
+    default:
+      return Status(
+          Status::Code::UNSUPPORTED,
+          "classification is not supported for datatype " +
+              inference::DataType_Name(dtype));
+  }
+
+  return Status::Success;
+}
+
+}}  // namespace triton::core
@@ -0,0 +1,52 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "model_config.pb.h"
+#include "status.h"
+
+namespace triton { namespace core {
+
+// Select the 'k' highest scores among the 'element_count' elements of
+// datatype 'dtype' at 'base', a host buffer. Return the class index and
+// score of each selected element in 'indices' and 'scores', highest
+// score first and lower class index first among equal scores. NaN
+// scores are never selected. Fewer than 'k' classes are returned if
+// there are fewer elements.
+//
+// Most elements of a large output are below the k-th best score seen
+// so far, so the scan compares whole blocks against that threshold in
+// a branch-free loop the compiler vectorizes, and only the blocks with
+// a candidate are inspected element by element.
+Status TopKClasses(
+    const void* base, const inference::DataType dtype,
+    const size_t element_count, const size_t k, std::vector<uint64_t>* indices,
+    std::vector<double>* scores);
+
+}}  // namespace triton::core
@@ -0,0 +1,139 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "clock.h"
+
+#if defined(TRITON_ENABLE_TSC_CLOCK) && defined(__x86_64__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+namespace triton { namespace core {
+
+namespace {
+
+uint64_t
+SystemClockNs()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+#ifdef TRITON_ENABLE_TSC_CLOCK
+
+#ifdef __x86_64__
+// The steady clock is sampled again after this many nanoseconds so that
+// the TSC time doesn't drift away from the clock adjusted by NTP.
+constexpr uint64_t kAnchorIntervalNs = 10 * 1000 * 1000;
+// The duration of the calibration of the TSC frequency.
+constexpr uint64_t kCalibrationNs = 2 * 1000 * 1000;
+
+// Return the nanoseconds per TSC tick, or 0 if the TSC doesn't tick at
+// a constant rate or can't be calibrated.
+double
+CalibrateNsPerTick()
+{
+  unsigned int eax, ebx, ecx, edx;
+  if ((__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) == 0) ||
+      ((edx & (1 << 8)) == 0)) {
+    return 0;
+  }
+
+  // The first read of the clock may be slow, don't let it skew the start
+  SystemClockNs();
+  const uint64_t start_tsc = __rdtsc();
+  const uint64_t start_ns = SystemClockNs();
+  uint64_t end_ns;
+  do {
+    end_ns = SystemClockNs();
+  } while ((end_ns - start_ns) < kCalibrationNs);
+  const uint64_t end_tsc = __rdtsc();
+  if (end_tsc <= start_tsc) {
+    return 0;
+  }
+  return static_cast<double>(end_ns - start_ns) / (end_tsc - start_tsc);
+}
+
+// A pair of TSC and steady clock readings that later TSC readings are
+// converted against, kept per thread to avoid sharing a cache line.
+struct TscAnchor {
+  uint64_t tsc_ = 0;
+  uint64_t ns_ = 0;
+  uint64_t interval_ticks_ = 0;
+  uint64_t last_ns_ = 0;
+};
+#endif  // __x86_64__
+
+// Return the current time in nanoseconds computed from the time stamp
+// counter of the processor, see SteadyClockNs().
+uint64_t
+TscClockNs()
+{
+#ifdef __x86_64__
+  static const double ns_per_tick = CalibrateNsPerTick();
+  if (ns_per_tick == 0) {
+    return SystemClockNs();
+  }
+
+  thread_local TscAnchor anchor;
+  const uint64_t tsc = __rdtsc();
+  uint64_t ns;
+  if ((anchor.interval_ticks_ == 0) ||
+      ((tsc - anchor.tsc_) > anchor.interval_ticks_)) {
+    anchor.tsc_ = tsc;
+    anchor.ns_ = SystemClockNs();
+    anchor.interval_ticks_ = kAnchorIntervalNs / ns_per_tick;
+    ns = anchor.ns_;
+  } else {
+    ns = anchor.ns_ + static_cast<uint64_t>((tsc - anchor.tsc_) * ns_per_tick);
+  }
+
+  // Moving the anchor must not make the time of the thread go backward
+  if (ns < anchor.last_ns_) {
+    ns = anchor.last_ns_;
+  }
+  anchor.last_ns_ = ns;
+  return ns;
+#else
+  return SystemClockNs();
+#endif  // __x86_64__
+}
+#endif  // TRITON_ENABLE_TSC_CLOCK
+
+}  // namespace
+
+uint64_t
+SteadyClockNs()
+{
+#ifdef TRITON_ENABLE_TSC_CLOCK
+  return TscClockNs();
+#else
+  return SystemClockNs();
+#endif  // TRITON_ENABLE_TSC_CLOCK
+}
+
+}}  // namespace triton::core
@@ -64,6 +64,10 @@ constexpr char kPythonBackend[] = "python";
 constexpr char kEnsemblePlatform[] = "ensemble";
 #endif  // TRITON_ENABLE_ENSEMBLE
 
+// Name of the cache configuration that stacks two other configured
+// caches into an L1 / L2 hierarchy instead of loading a cache library.
+constexpr char kTieredCacheName[] = "tiered";
+
 constexpr char kTensorRTExecutionAccelerator[] = "tensorrt";
 constexpr char kOpenVINOExecutionAccelerator[] = "openvino";
 constexpr char kGPUIOExecutionAccelerator[] = "gpu_io";
@@ -85,6 +89,9 @@ constexpr int MAX_GRPC_MESSAGE_SIZE = INT32_MAX;
 constexpr uint64_t SEQUENCE_IDLE_DEFAULT_MICROSECONDS = 1000 * 1000;
 constexpr size_t STRING_CORRELATION_ID_MAX_LENGTH_BYTES = 128;
 constexpr size_t CUDA_IPC_STRUCT_SIZE = 64;
+constexpr size_t DYNAMIC_BATCHER_ENQUEUE_RING_SIZE = 4096;
+constexpr uint64_t DYNAMIC_BATCHER_DELAY_UPDATE_INTERVAL_NS =
+    100 * NANOS_PER_MILLIS;
 
 #ifdef TRITON_ENABLE_METRICS
 // MetricModelReporter expects a device ID for GPUs, but we reuse this device
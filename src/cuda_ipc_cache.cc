@@ -0,0 +1,156 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "cuda_ipc_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "cuda_utils.h"
+#include "triton/common/logging.h"
+
+#ifdef TRITON_ENABLE_GPU
+#include <cuda_runtime_api.h>
+#endif  // TRITON_ENABLE_GPU
+
+namespace triton { namespace core {
+
+std::mutex CudaIpcCache::mu_;
+std::map<CudaIpcCache::Key, CudaIpcCache::Entry> CudaIpcCache::entries_;
+uint64_t CudaIpcCache::use_clock_ = 0;
+
+CudaIpcCache::Mapping::~Mapping()
+{
+#ifdef TRITON_ENABLE_GPU
+  int current_device;
+  if (cudaGetDevice(&current_device) != cudaSuccess) {
+    LOG_ERROR << "failed to get device to close CUDA IPC memory handle";
+    return;
+  }
+  const bool overridden = (current_device != device_id_);
+  if (overridden && (cudaSetDevice(device_id_) != cudaSuccess)) {
+    LOG_ERROR << "failed to set device to close CUDA IPC memory handle";
+    return;
+  }
+  auto err = cudaIpcCloseMemHandle(base_);
+  if (err != cudaSuccess) {
+    LOG_ERROR << "failed to close CUDA IPC memory handle on GPU "
+              << device_id_ << ": " << cudaGetErrorString(err);
+  }
+  if (overridden) {
+    cudaSetDevice(current_device);
+  }
+#endif  // TRITON_ENABLE_GPU
+}
+
+Status
+CudaIpcCache::Open(
+    const void* handle, const int device_id, std::shared_ptr<Mapping>* mapping)
+{
+  Key key;
+  std::memcpy(key.first.data(), handle, CUDA_IPC_STRUCT_SIZE);
+  key.second = device_id;
+
+  std::lock_guard<std::mutex> lk(mu_);
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    it->second.last_use_ = ++use_clock_;
+    *mapping = it->second.mapping_;
+    return Status::Success;
+  }
+
+#ifdef TRITON_ENABLE_GPU
+  int current_device;
+  RETURN_IF_CUDA_ERR(
+      cudaGetDevice(&current_device), std::string("Failed to get device"));
+  const bool overridden = (current_device != device_id);
+  if (overridden) {
+    RETURN_IF_CUDA_ERR(
+        cudaSetDevice(device_id), std::string("Failed to set device"));
+  }
+
+  // Defer returning error to make sure the device is recovered
+  cudaIpcMemHandle_t ipc_handle;
+  std::memcpy(&ipc_handle, handle, sizeof(ipc_handle));
+  void* base = nullptr;
+  auto err = cudaIpcOpenMemHandle(
+      &base, ipc_handle, cudaIpcMemLazyEnablePeerAccess);
+
+  if (overridden) {
+    cudaSetDevice(current_device);
+  }
+  RETURN_IF_CUDA_ERR(
+      err, std::string("Failed to open CUDA IPC memory handle on GPU ") +
+               std::to_string(device_id));
+
+  std::shared_ptr<Mapping> local_mapping(new Mapping(base, device_id));
+  entries_.emplace(key, Entry{local_mapping, ++use_clock_});
+  *mapping = std::move(local_mapping);
+  LOG_VERBOSE(1) << "opened CUDA IPC memory handle on GPU " << device_id
+                 << " at " << base;
+
+  EvictIdle(kMaxIdleMappings);
+  return Status::Success;
+#else
+  return Status(
+      Status::Code::UNSUPPORTED,
+      "CUDA IPC memory handles require GPU support");
+#endif  // TRITON_ENABLE_GPU
+}
+
+size_t
+CudaIpcCache::CloseIdle()
+{
+  std::lock_guard<std::mutex> lk(mu_);
+  return EvictIdle(0);
+}
+
+size_t
+CudaIpcCache::EvictIdle(const size_t max_idle_count)
+{
+  // A mapping is idle when the cache holds the only reference. References
+  // are only added under 'mu_', so an idle mapping stays idle here.
+  std::vector<std::pair<uint64_t, std::map<Key, Entry>::iterator>> idle;
+  for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+    if (it->second.mapping_.use_count() == 1) {
+      idle.emplace_back(it->second.last_use_, it);
+    }
+  }
+  if (idle.size() <= max_idle_count) {
+    return 0;
+  }
+
+  const size_t close_count = idle.size() - max_idle_count;
+  std::partial_sort(
+      idle.begin(), idle.begin() + close_count, idle.end(),
+      [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+  for (size_t i = 0; i < close_count; ++i) {
+    entries_.erase(idle[i].second);
+  }
+  return close_count;
+}
+
+}}  // namespace triton::core
@@ -0,0 +1,102 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include "constants.h"
+#include "status.h"
+
+namespace triton { namespace core {
+
+//
+// The CUDA IPC memory handles opened in this process. Opening a handle
+// with cudaIpcOpenMemHandle costs hundreds of microseconds, so each
+// handle is opened once per device and the mapping is shared by all the
+// requests that reference it. A mapping stays open while a request
+// holds it and remains cached once idle, the least recently used idle
+// mappings are closed when more than kMaxIdleMappings are cached.
+//
+class CudaIpcCache {
+ public:
+  static constexpr size_t kMaxIdleMappings = 64;
+
+  // An opened IPC handle, closed with the last reference to it.
+  class Mapping {
+   public:
+    ~Mapping();
+    Mapping(const Mapping&) = delete;
+    Mapping& operator=(const Mapping&) = delete;
+
+    // The base address of the exported allocation in this process
+    char* Base() const { return base_; }
+    int DeviceId() const { return device_id_; }
+
+   private:
+    friend class CudaIpcCache;
+    Mapping(void* base, const int device_id)
+        : base_(static_cast<char*>(base)), device_id_(device_id)
+    {
+    }
+
+    char* const base_;
+    const int device_id_;
+  };
+
+  // Return the mapping of the IPC memory handle 'handle', of
+  // CUDA_IPC_STRUCT_SIZE bytes, on device 'device_id'. The handle is
+  // opened if it isn't cached. The exported memory must not be freed by
+  // the exporting process while the mapping is referenced.
+  static Status Open(
+      const void* handle, const int device_id,
+      std::shared_ptr<Mapping>* mapping);
+
+  // Close the idle mappings. Return the number of mappings closed.
+  static size_t CloseIdle();
+
+ private:
+  using Handle = std::array<char, CUDA_IPC_STRUCT_SIZE>;
+  using Key = std::pair<Handle, int>;
+  struct Entry {
+    std::shared_ptr<Mapping> mapping_;
+    // The value of 'use_clock_' when the mapping was last opened
+    uint64_t last_use_;
+  };
+
+  // Close the least recently used idle mappings beyond
+  // 'max_idle_count'. Must be called with 'mu_' held.
+  static size_t EvictIdle(const size_t max_idle_count);
+
+  static std::mutex mu_;
+  static std::map<Key, Entry> entries_;
+  static uint64_t use_clock_;
+};
+
+}}  // namespace triton::core
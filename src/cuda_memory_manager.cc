@@ -32,6 +32,10 @@
 #include "cuda_utils.h"
 #include "triton/common/logging.h"
 
+#ifdef TRITON_ENABLE_METRICS
+#include "metrics.h"
+#endif  // TRITON_ENABLE_METRICS
+
 namespace {
 
 #define RETURN_IF_CNMEM_ERROR(S, MSG)                    \
@@ -57,11 +61,33 @@ PointerToString(void* ptr)
 namespace triton { namespace core {
 
 std::unique_ptr<CudaMemoryManager> CudaMemoryManager::instance_;
-std::mutex CudaMemoryManager::instance_mu_;
+InstrumentedMutex CudaMemoryManager::instance_mu_(
+    "CudaMemoryManager::instance_mu_");
 
 CudaMemoryManager::~CudaMemoryManager()
 {
-  if (has_allocation_) {
+#ifdef TRITON_ENABLE_METRICS
+  if (has_collect_callback_) {
+    Metrics::RemoveCollectCallback(collect_callback_id_);
+  }
+#endif  // TRITON_ENABLE_METRICS
+
+  for (auto& it : async_pools_) {
+    auto& async_pool = it.second;
+    if (async_pool.stream_ != nullptr) {
+      cudaStreamSynchronize(async_pool.stream_);
+      cudaStreamDestroy(async_pool.stream_);
+    }
+    if (async_pool.pool_ != nullptr) {
+      auto err = cudaMemPoolDestroy(async_pool.pool_);
+      if (err != cudaSuccess) {
+        LOG_ERROR << "Failed to destroy CUDA memory pool on GPU " << it.first
+                  << ": " << cudaGetErrorString(err);
+      }
+    }
+  }
+
+  if (has_allocation_ && (pool_type_ == PoolType::CNMEM)) {
     auto status = cnmemFinalize();
     if (status != CNMEM_STATUS_SUCCESS) {
       LOG_ERROR << "Failed to finalize CUDA memory manager: [" << status << "] "
@@ -73,7 +99,7 @@ CudaMemoryManager::~CudaMemoryManager()
 void
 CudaMemoryManager::Reset()
 {
-  std::lock_guard<std::mutex> lock(instance_mu_);
+  std::lock_guard<InstrumentedMutex> lock(instance_mu_);
   instance_.reset();
 }
 
@@ -81,7 +107,7 @@ Status
 CudaMemoryManager::Create(const CudaMemoryManager::Options& options)
 {
   // Ensure thread-safe creation of CUDA memory pool
-  std::lock_guard<std::mutex> lock(instance_mu_);
+  std::lock_guard<InstrumentedMutex> lock(instance_mu_);
   if (instance_ != nullptr) {
     LOG_WARNING << "New CUDA memory pools could not be created since they "
                    "already exists";
@@ -91,7 +117,22 @@ CudaMemoryManager::Create(const CudaMemoryManager::Options& options)
   std::set<int> supported_gpus;
   auto status = GetSupportedGPUs(
       &supported_gpus, options.min_supported_compute_capability_);
-  if (status.IsOk()) {
+  if (status.IsOk() && (options.pool_type_ == PoolType::ASYNC)) {
+    // The pools created so far are destroyed with 'manager' on failure
+    std::unique_ptr<CudaMemoryManager> manager(new CudaMemoryManager(false));
+    status = manager->CreateAsyncPools(options, supported_gpus);
+    if (status.IsOk()) {
+#ifdef TRITON_ENABLE_METRICS
+      std::set<int> pool_gpus;
+      for (const auto& it : manager->async_pools_) {
+        pool_gpus.insert(it.first);
+      }
+      manager->InitializeMetrics(pool_gpus);
+#endif  // TRITON_ENABLE_METRICS
+      instance_ = std::move(manager);
+      return Status::Success;
+    }
+  } else if (status.IsOk()) {
     std::vector<cnmemDevice_t> devices;
     for (auto gpu : supported_gpus) {
       const auto it = options.memory_pool_byte_size_.find(gpu);
@@ -117,15 +158,297 @@ CudaMemoryManager::Create(const CudaMemoryManager::Options& options)
 
     // Use to finalize CNMeM properly when out of scope
     instance_.reset(new CudaMemoryManager(!devices.empty()));
-  } else {
+#ifdef TRITON_ENABLE_METRICS
+    std::set<int> pool_gpus;
+    for (const auto& device : devices) {
+      pool_gpus.insert(device.device);
+    }
+    instance_->InitializeMetrics(pool_gpus);
+#endif  // TRITON_ENABLE_METRICS
+    return Status::Success;
+  }
+
+  return Status(
+      status.ErrorCode(),
+      "Failed to initialize CUDA memory manager: " + status.Message());
+}
+
+Status
+CudaMemoryManager::CreateAsyncPools(
+    const Options& options, const std::set<int>& gpus)
+{
+  pool_type_ = PoolType::ASYNC;
+
+  int current_device;
+  RETURN_IF_CUDA_ERR(
+      cudaGetDevice(&current_device), std::string("Failed to get device"));
+  for (const auto gpu : gpus) {
+    const auto it = options.memory_pool_byte_size_.find(gpu);
+    if ((it == options.memory_pool_byte_size_.end()) || (it->second == 0)) {
+      continue;
+    }
+
+    const uint64_t pool_byte_size = it->second;
+    const auto threshold_it = options.release_threshold_.find(gpu);
+    const uint64_t release_threshold =
+        (threshold_it != options.release_threshold_.end())
+            ? threshold_it->second
+            : pool_byte_size;
+    const uint64_t limit_byte_size = options.allow_growth_ ? 0 : pool_byte_size;
+
+    RETURN_IF_CUDA_ERR(cudaSetDevice(gpu), std::string("Failed to set device"));
+    // Defer returning error to make sure the device is recovered
+    auto status = CreateAsyncPool(
+        gpu, pool_byte_size, release_threshold, limit_byte_size);
+    cudaSetDevice(current_device);
+    RETURN_IF_ERROR(status);
+
+    LOG_INFO << "CUDA stream-ordered memory pool is created on device " << gpu
+             << " with size " << pool_byte_size << ", release threshold "
+             << release_threshold
+             << (options.allow_growth_ ? ", growable" : ", not growable");
+  }
+
+  // Memory of a pool is only accessible from its own device unless
+  // access is granted explicitly, like peer access for cudaMalloc().
+  for (const auto& it : async_pools_) {
+    for (const auto& peer : async_pools_) {
+      int can_access = 0;
+      if ((peer.first == it.first) ||
+          (cudaDeviceCanAccessPeer(&can_access, peer.first, it.first) !=
+           cudaSuccess) ||
+          !can_access) {
+        continue;
+      }
+      cudaMemAccessDesc access;
+      memset(&access, 0, sizeof(access));
+      access.location.type = cudaMemLocationTypeDevice;
+      access.location.id = peer.first;
+      access.flags = cudaMemAccessFlagsProtReadWrite;
+      auto err = cudaMemPoolSetAccess(it.second.pool_, &access, 1);
+      if (err != cudaSuccess) {
+        LOG_WARNING << "Failed to grant GPU " << peer.first
+                    << " access to the CUDA memory pool on GPU " << it.first
+                    << ": " << cudaGetErrorString(err);
+      }
+    }
+  }
+
+  if (async_pools_.empty()) {
+    LOG_INFO << "CUDA memory pool disabled";
+  }
+  has_allocation_ = !async_pools_.empty();
+  return Status::Success;
+}
+
+Status
+CudaMemoryManager::CreateAsyncPool(
+    const int gpu, const uint64_t pool_byte_size,
+    const uint64_t release_threshold, const uint64_t limit_byte_size)
+{
+  auto& async_pool = async_pools_[gpu];
+  async_pool.limit_byte_size_ = limit_byte_size;
+
+  cudaMemPoolProps props;
+  memset(&props, 0, sizeof(props));
+  props.allocType = cudaMemAllocationTypePinned;
+  props.handleTypes = cudaMemHandleTypeNone;
+  props.location.type = cudaMemLocationTypeDevice;
+  props.location.id = gpu;
+  RETURN_IF_CUDA_ERR(
+      cudaMemPoolCreate(&async_pool.pool_, &props),
+      std::string("Failed to create CUDA memory pool on GPU ") +
+          std::to_string(gpu));
+
+  uint64_t threshold = release_threshold;
+  RETURN_IF_CUDA_ERR(
+      cudaMemPoolSetAttribute(
+          async_pool.pool_, cudaMemPoolAttrReleaseThreshold, &threshold),
+      std::string("Failed to set release threshold on GPU ") +
+          std::to_string(gpu));
+  RETURN_IF_CUDA_ERR(
+      cudaStreamCreateWithFlags(&async_pool.stream_, cudaStreamNonBlocking),
+      std::string("Failed to create CUDA stream on GPU ") +
+          std::to_string(gpu));
+
+  // Reserve the pool byte size up front so that the first allocations
+  // don't have to wait for the system, the memory stays reserved up to
+  // the release threshold.
+  void* reserved = nullptr;
+  RETURN_IF_CUDA_ERR(
+      cudaMallocFromPoolAsync(
+          &reserved, pool_byte_size, async_pool.pool_, async_pool.stream_),
+      std::string("Failed to reserve CUDA memory with byte size ") +
+          std::to_string(pool_byte_size) + " on GPU " + std::to_string(gpu));
+  RETURN_IF_CUDA_ERR(
+      cudaFreeAsync(reserved, async_pool.stream_),
+      std::string("Failed to release reserved CUDA memory on GPU ") +
+          std::to_string(gpu));
+  RETURN_IF_CUDA_ERR(
+      cudaStreamSynchronize(async_pool.stream_),
+      std::string("Failed to synchronize CUDA stream on GPU ") +
+          std::to_string(gpu));
+  return Status::Success;
+}
+
+Status
+CudaMemoryManager::AsyncAlloc(
+    void** ptr, uint64_t size, int64_t device_id, cudaStream_t stream,
+    const bool ordered)
+{
+  const auto it = async_pools_.find(device_id);
+  if (it == async_pools_.end()) {
     return Status(
-        status.ErrorCode(),
-        "Failed to initialize CUDA memory manager: " + status.Message());
+        Status::Code::UNAVAILABLE,
+        "CudaMemoryManager has no CUDA memory pool on GPU " +
+            std::to_string(device_id));
   }
+  const auto& async_pool = it->second;
 
+  // The usage is only sampled so concurrent allocations may exceed the
+  // limit by the size of the allocations in flight.
+  if (async_pool.limit_byte_size_ != 0) {
+    uint64_t used_byte_size = 0;
+    RETURN_IF_CUDA_ERR(
+        cudaMemPoolGetAttribute(
+            async_pool.pool_, cudaMemPoolAttrUsedMemCurrent, &used_byte_size),
+        std::string("Failed to get usage of CUDA memory pool on GPU ") +
+            std::to_string(device_id));
+    if ((used_byte_size + size) > async_pool.limit_byte_size_) {
+      return Status(
+          Status::Code::UNAVAILABLE,
+          "Failed to allocate CUDA memory with byte size " +
+              std::to_string(size) + " on GPU " + std::to_string(device_id) +
+              ": CUDA memory pool of byte size " +
+              std::to_string(async_pool.limit_byte_size_) + " is exhausted");
+    }
+  }
+
+  const cudaStream_t lstream = ordered ? stream : async_pool.stream_;
+  RETURN_IF_CUDA_ERR(
+      cudaMallocFromPoolAsync(ptr, size, async_pool.pool_, lstream),
+      std::string("Failed to allocate CUDA memory with byte size ") +
+          std::to_string(size) + " on GPU " + std::to_string(device_id));
+  if (!ordered) {
+    RETURN_IF_CUDA_ERR(
+        cudaStreamSynchronize(lstream),
+        std::string("Failed to synchronize CUDA stream on GPU ") +
+            std::to_string(device_id));
+  }
   return Status::Success;
 }
 
+Status
+CudaMemoryManager::AsyncFree(
+    void* ptr, int64_t device_id, cudaStream_t stream, const bool ordered)
+{
+  const auto it = async_pools_.find(device_id);
+  if (it == async_pools_.end()) {
+    return Status(
+        Status::Code::UNAVAILABLE,
+        "CudaMemoryManager has no CUDA memory pool on GPU " +
+            std::to_string(device_id));
+  }
+
+  // An unordered free is only requested once the memory is no longer in
+  // use, so it doesn't have to wait for any stream.
+  const cudaStream_t lstream = ordered ? stream : it->second.stream_;
+  RETURN_IF_CUDA_ERR(
+      cudaFreeAsync(ptr, lstream),
+      std::string("Failed to deallocate CUDA memory at address ") +
+          PointerToString(ptr) + " on GPU " + std::to_string(device_id));
+  return Status::Success;
+}
+
+#ifdef TRITON_ENABLE_METRICS
+void
+CudaMemoryManager::InitializeMetrics(const std::set<int>& gpus)
+{
+  if (!Metrics::Enabled() || gpus.empty()) {
+    return;
+  }
+
+  for (const auto gpu : gpus) {
+    std::map<std::string, std::string> labels{{"gpu", std::to_string(gpu)}};
+    std::string uuid;
+    if (Metrics::UUIDForCudaDevice(gpu, &uuid)) {
+      labels.emplace("gpu_uuid", uuid);
+    }
+    auto& pool_metrics = pool_metrics_[gpu];
+    pool_metrics.allocation_count_ =
+        &Metrics::FamilyCudaMemoryAllocationCount().Add(labels);
+    pool_metrics.allocation_failure_count_ =
+        &Metrics::FamilyCudaMemoryAllocationFailureCount().Add(labels);
+    pool_metrics.used_bytes_ =
+        &Metrics::FamilyCudaMemoryPoolUsedBytes().Add(labels);
+    pool_metrics.free_bytes_ =
+        &Metrics::FamilyCudaMemoryPoolFreeBytes().Add(labels);
+  }
+  collect_callback_id_ =
+      Metrics::AddCollectCallback([this]() { CollectMetrics(); });
+  has_collect_callback_ = true;
+}
+
+void
+CudaMemoryManager::CollectMetrics()
+{
+  for (auto& it : pool_metrics_) {
+    const int64_t device_id = it.first;
+    uint64_t used_byte_size = 0;
+    uint64_t free_byte_size = 0;
+    if (pool_type_ == PoolType::ASYNC) {
+      // The memory reserved by the pool beyond what is in use is free
+      const auto& async_pool = async_pools_.at(device_id);
+      uint64_t reserved_byte_size = 0;
+      if ((cudaMemPoolGetAttribute(
+               async_pool.pool_, cudaMemPoolAttrReservedMemCurrent,
+               &reserved_byte_size) != cudaSuccess) ||
+          (cudaMemPoolGetAttribute(
+               async_pool.pool_, cudaMemPoolAttrUsedMemCurrent,
+               &used_byte_size) != cudaSuccess)) {
+        continue;
+      }
+      free_byte_size = reserved_byte_size - used_byte_size;
+    } else {
+      int current_device;
+      if (cudaGetDevice(&current_device) != cudaSuccess) {
+        continue;
+      }
+      bool overridden = (current_device != device_id);
+      if (overridden && (cudaSetDevice(device_id) != cudaSuccess)) {
+        continue;
+      }
+      size_t free_size = 0;
+      size_t total_size = 0;
+      auto err = cnmemMemGetInfo(&free_size, &total_size, nullptr);
+      if (overridden) {
+        cudaSetDevice(current_device);
+      }
+      if (err != CNMEM_STATUS_SUCCESS) {
+        continue;
+      }
+      used_byte_size = total_size - free_size;
+      free_byte_size = free_size;
+    }
+    it.second.used_bytes_->Set(used_byte_size);
+    it.second.free_bytes_->Set(free_byte_size);
+  }
+}
+
+void
+CudaMemoryManager::ReportAllocation(int64_t device_id, bool success)
+{
+  const auto it = pool_metrics_.find(device_id);
+  if (it != pool_metrics_.end()) {
+    if (success) {
+      it->second.allocation_count_->Increment();
+    } else {
+      it->second.allocation_failure_count_->Increment();
+    }
+  }
+}
+#endif  // TRITON_ENABLE_METRICS
+
 Status
 CudaMemoryManager::Alloc(void** ptr, uint64_t size, int64_t device_id)
 {
@@ -136,6 +459,13 @@ CudaMemoryManager::Alloc(void** ptr, uint64_t size, int64_t device_id)
     return Status(
         Status::Code::UNAVAILABLE,
         "CudaMemoryManager has no preallocated CUDA memory");
+  } else if (instance_->pool_type_ == PoolType::ASYNC) {
+    auto status = instance_->AsyncAlloc(
+        ptr, size, device_id, nullptr, false /* ordered */);
+#ifdef TRITON_ENABLE_METRICS
+    instance_->ReportAllocation(device_id, status.IsOk());
+#endif  // TRITON_ENABLE_METRICS
+    return status;
   }
 
   int current_device;
@@ -153,6 +483,9 @@ CudaMemoryManager::Alloc(void** ptr, uint64_t size, int64_t device_id)
   if (overridden) {
     cudaSetDevice(current_device);
   }
+#ifdef TRITON_ENABLE_METRICS
+  instance_->ReportAllocation(device_id, err == CNMEM_STATUS_SUCCESS);
+#endif  // TRITON_ENABLE_METRICS
 
   RETURN_IF_CNMEM_ERROR(
       err, std::string("Failed to allocate CUDA memory with byte size ") +
@@ -160,6 +493,24 @@ CudaMemoryManager::Alloc(void** ptr, uint64_t size, int64_t device_id)
   return Status::Success;
 }
 
+Status
+CudaMemoryManager::Alloc(
+    void** ptr, uint64_t size, int64_t device_id, cudaStream_t stream)
+{
+  // The cnmem pools are created without streams, so their allocations
+  // are not stream-ordered.
+  if ((instance_ != nullptr) && instance_->has_allocation_ &&
+      (instance_->pool_type_ == PoolType::ASYNC)) {
+    auto status = instance_->AsyncAlloc(
+        ptr, size, device_id, stream, true /* ordered */);
+#ifdef TRITON_ENABLE_METRICS
+    instance_->ReportAllocation(device_id, status.IsOk());
+#endif  // TRITON_ENABLE_METRICS
+    return status;
+  }
+  return Alloc(ptr, size, device_id);
+}
+
 Status
 CudaMemoryManager::Free(void* ptr, int64_t device_id)
 {
@@ -170,6 +521,8 @@ CudaMemoryManager::Free(void* ptr, int64_t device_id)
     return Status(
         Status::Code::UNAVAILABLE,
         "CudaMemoryManager has no preallocated CUDA memory");
+  } else if (instance_->pool_type_ == PoolType::ASYNC) {
+    return instance_->AsyncFree(ptr, device_id, nullptr, false /* ordered */);
   }
 
   int current_device;
@@ -194,4 +547,14 @@ CudaMemoryManager::Free(void* ptr, int64_t device_id)
   return Status::Success;
 }
 
+Status
+CudaMemoryManager::Free(void* ptr, int64_t device_id, cudaStream_t stream)
+{
+  if ((instance_ != nullptr) && instance_->has_allocation_ &&
+      (instance_->pool_type_ == PoolType::ASYNC)) {
+    return instance_->AsyncFree(ptr, device_id, stream, true /* ordered */);
+  }
+  return Free(ptr, device_id);
+}
+
 }}  // namespace triton::core
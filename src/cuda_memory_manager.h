@@ -26,11 +26,19 @@
 //
 #pragma once
 
+#include <cuda_runtime_api.h>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <set>
+#include "instrumented_mutex.h"
 #include "status.h"
 
+#ifdef TRITON_ENABLE_METRICS
+#include "prometheus/counter.h"
+#include "prometheus/gauge.h"
+#endif  // TRITON_ENABLE_METRICS
+
 namespace triton { namespace core {
 
 // This is a singleton class responsible for maintaining CUDA memory pool
@@ -38,10 +46,24 @@ namespace triton { namespace core {
 // must be requested via functions provided by this class.
 class CudaMemoryManager {
  public:
+  // The allocator that backs the memory pool of each device.
+  enum class PoolType {
+    // A fixed-size cnmem pool per device.
+    CNMEM,
+    // A CUDA stream-ordered memory pool per device, allocated from with
+    // cudaMallocFromPoolAsync(). Allocations on different streams don't
+    // serialize and freed memory beyond the release threshold is
+    // returned to the system.
+    ASYNC
+  };
+
   // Options to configure CUDA memory manager.
   struct Options {
-    Options(double cc = 6.0, const std::map<int, uint64_t>& s = {})
-        : min_supported_compute_capability_(cc), memory_pool_byte_size_(s)
+    Options(
+        double cc = 6.0, const std::map<int, uint64_t>& s = {},
+        PoolType t = PoolType::CNMEM)
+        : min_supported_compute_capability_(cc), memory_pool_byte_size_(s),
+          pool_type_(t), allow_growth_(true)
     {
     }
 
@@ -53,6 +75,18 @@ class CudaMemoryManager {
     // the default granularity (512 bytes).
     // No memory will be reserved for devices that is not listed.
     std::map<int, uint64_t> memory_pool_byte_size_;
+
+    // The allocator backing the memory pools.
+    PoolType pool_type_;
+
+    // ASYNC only. Whether a pool may grow beyond its memory pool byte
+    // size. A cnmem pool never grows.
+    bool allow_growth_;
+
+    // ASYNC only. The byte size of freed memory that the pool of the
+    // specified devices keeps reserved instead of releasing it to the
+    // system. Devices not listed keep their memory pool byte size.
+    std::map<int, uint64_t> release_threshold_;
   };
 
   ~CudaMemoryManager();
@@ -70,15 +104,77 @@ class CudaMemoryManager {
   // Return Status object indicating success or failure.
   static Status Alloc(void** ptr, uint64_t size, int64_t device_id);
 
+  // Allocate CUDA memory on GPU 'device_id' in the order of 'stream'.
+  // With an ASYNC pool the memory may only be used by work ordered after
+  // the allocation on 'stream', otherwise the memory is ready on return.
+  static Status Alloc(
+      void** ptr, uint64_t size, int64_t device_id, cudaStream_t stream);
+
   // Free the memory allocated by the memory manager on 'device_id'.
   // Return Status object indicating success or failure.
   static Status Free(void* ptr, int64_t device_id);
 
+  // Free the memory allocated by the memory manager on 'device_id' once
+  // the work submitted to 'stream' so far completes.
+  static Status Free(void* ptr, int64_t device_id, cudaStream_t stream);
+
  private:
-  CudaMemoryManager(bool has_allocation) : has_allocation_(has_allocation) {}
+  CudaMemoryManager(bool has_allocation)
+      : has_allocation_(has_allocation), pool_type_(PoolType::CNMEM)
+  {
+  }
+  // Create an ASYNC pool on each of 'gpus' that has a memory pool byte
+  // size in 'options'.
+  Status CreateAsyncPools(const Options& options, const std::set<int>& gpus);
+  // Create the ASYNC pool of the current device 'gpu'.
+  Status CreateAsyncPool(
+      const int gpu, const uint64_t pool_byte_size,
+      const uint64_t release_threshold, const uint64_t limit_byte_size);
+  // Allocate from / free to the ASYNC pool of 'device_id' in the order of
+  // 'stream' if 'ordered'. Otherwise the allocation is ready on return
+  // and the memory is freed without waiting for any stream.
+  Status AsyncAlloc(
+      void** ptr, uint64_t size, int64_t device_id, cudaStream_t stream,
+      const bool ordered);
+  Status AsyncFree(
+      void* ptr, int64_t device_id, cudaStream_t stream, const bool ordered);
+#ifdef TRITON_ENABLE_METRICS
+  // Create the metrics of the pools on 'gpus' and update them whenever
+  // the metrics are collected.
+  void InitializeMetrics(const std::set<int>& gpus);
+  void CollectMetrics();
+  // Count an allocation from the pool of 'device_id' in the metrics
+  void ReportAllocation(int64_t device_id, bool success);
+#endif  // TRITON_ENABLE_METRICS
+
   bool has_allocation_;
+  PoolType pool_type_;
+
+  // The ASYNC pool of each device, the stream used for allocations that
+  // are not ordered on a stream, and the byte size that the pool may not
+  // grow beyond, 0 if growth is allowed. Only modified on creation.
+  struct AsyncPool {
+    cudaMemPool_t pool_ = nullptr;
+    cudaStream_t stream_ = nullptr;
+    uint64_t limit_byte_size_ = 0;
+  };
+  std::map<int64_t, AsyncPool> async_pools_;
+
+#ifdef TRITON_ENABLE_METRICS
+  // The metrics of the pool of each device. Only modified on creation.
+  struct PoolMetrics {
+    prometheus::Counter* allocation_count_ = nullptr;
+    prometheus::Counter* allocation_failure_count_ = nullptr;
+    prometheus::Gauge* used_bytes_ = nullptr;
+    prometheus::Gauge* free_bytes_ = nullptr;
+  };
+  std::map<int64_t, PoolMetrics> pool_metrics_;
+  bool has_collect_callback_ = false;
+  uint64_t collect_callback_id_ = 0;
+#endif  // TRITON_ENABLE_METRICS
+
   static std::unique_ptr<CudaMemoryManager> instance_;
-  static std::mutex instance_mu_;
+  static InstrumentedMutex instance_mu_;
 };
 
 }}  // namespace triton::core
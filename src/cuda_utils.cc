@@ -27,7 +27,8 @@
 #include "cuda_utils.h"
 
 #include "model_config_utils.h"
-#include "triton/common/nvtx.h"
+#include "profiling.h"
+#include "triton/common/logging.h"
 
 namespace triton { namespace core {
 
@@ -77,6 +78,44 @@ GetDeviceMemoryInfo(const int device_id, size_t* free, size_t* total)
   return Status::Success;
 }
 
+namespace {
+
+// The (source, destination) device pairs with peer access enabled. Only
+// written by EnablePeerAccess() during server initialization.
+std::set<std::pair<int64_t, int64_t>> peer_access_pairs_;
+
+}  // namespace
+
+bool
+PeerAccessEnabled(const int64_t src_device, const int64_t dst_device)
+{
+  // Peer access is granted to the device that accesses the memory of the
+  // other, the copy is direct if either device has access.
+  return (peer_access_pairs_.find(std::make_pair(dst_device, src_device)) !=
+          peer_access_pairs_.end()) ||
+         (peer_access_pairs_.find(std::make_pair(src_device, dst_device)) !=
+          peer_access_pairs_.end());
+}
+
+const char*
+CopyPathString(const CopyPath path)
+{
+  switch (path) {
+    case CopyPath::HOST:
+      return "HOST";
+    case CopyPath::HOST_ON_STREAM:
+      return "HOST_ON_STREAM";
+    case CopyPath::CUDA:
+      return "CUDA";
+    case CopyPath::PEER:
+      return "PEER";
+    case CopyPath::STAGED:
+      return "STAGED";
+  }
+
+  return "<unknown>";
+}
+
 Status
 EnablePeerAccess(const double min_compute_capability)
 {
@@ -101,6 +140,17 @@ EnablePeerAccess(const double min_compute_capability)
           if ((cuerr == cudaSuccess) && (can_access_peer == 1)) {
             cuerr = cudaDeviceEnablePeerAccess(peer, 0);
           }
+          if ((cuerr == cudaSuccess) && (can_access_peer == 1)) {
+            peer_access_pairs_.emplace(host, peer);
+            // The relative performance of the link, NVLink connected
+            // devices rank better than the ones connected over PCIe.
+            int rank = 0;
+            cudaDeviceGetP2PAttribute(
+                &rank, cudaDevP2PAttrPerformanceRank, host, peer);
+            LOG_VERBOSE(1) << "peer access enabled from GPU " << host
+                           << " to GPU " << peer << ", performance rank "
+                           << rank;
+          }
 
           all_enabled &= ((cuerr == cudaSuccess) && (can_access_peer == 1));
         }
@@ -122,11 +172,13 @@ CopyBuffer(
     const int64_t src_memory_type_id,
     const TRITONSERVER_MemoryType dst_memory_type,
     const int64_t dst_memory_type_id, const size_t byte_size, const void* src,
-    void* dst, cudaStream_t cuda_stream, bool* cuda_used, bool copy_on_stream)
+    void* dst, cudaStream_t cuda_stream, bool* cuda_used, bool copy_on_stream,
+    CopyPath* copy_path)
 {
-  NVTX_RANGE(nvtx_, "CopyBuffer");
+  PROFILE_RANGE(range, "CopyBuffer");
 
   *cuda_used = false;
+  CopyPath path = CopyPath::HOST;
 
   // For CUDA memcpy, all host to host copy will be blocked in respect to the
   // host, so use memcpy() directly. In this case, need to be careful on whether
@@ -139,6 +191,7 @@ CopyBuffer(
       cudaLaunchHostFunc(
           cuda_stream, MemcpyHost, reinterpret_cast<void*>(params));
       *cuda_used = true;
+      path = CopyPath::HOST_ON_STREAM;
     } else {
       memcpy(dst, src, byte_size);
     }
@@ -147,9 +200,23 @@ CopyBuffer(
 #endif  // TRITON_ENABLE_GPU
   } else {
 #ifdef TRITON_ENABLE_GPU
-    RETURN_IF_CUDA_ERR(
-        cudaMemcpyAsync(dst, src, byte_size, cudaMemcpyDefault, cuda_stream),
-        msg + ": failed to perform CUDA copy");
+    if ((src_memory_type == TRITONSERVER_MEMORY_GPU) &&
+        (dst_memory_type == TRITONSERVER_MEMORY_GPU) &&
+        (src_memory_type_id != dst_memory_type_id)) {
+      path = PeerAccessEnabled(src_memory_type_id, dst_memory_type_id)
+                 ? CopyPath::PEER
+                 : CopyPath::STAGED;
+      RETURN_IF_CUDA_ERR(
+          cudaMemcpyPeerAsync(
+              dst, dst_memory_type_id, src, src_memory_type_id, byte_size,
+              cuda_stream),
+          msg + ": failed to perform CUDA peer copy");
+    } else {
+      path = CopyPath::CUDA;
+      RETURN_IF_CUDA_ERR(
+          cudaMemcpyAsync(dst, src, byte_size, cudaMemcpyDefault, cuda_stream),
+          msg + ": failed to perform CUDA copy");
+    }
 
     *cuda_used = true;
 #else
@@ -159,6 +226,58 @@ CopyBuffer(
 #endif  // TRITON_ENABLE_GPU
   }
 
+  if (copy_path != nullptr) {
+    *copy_path = path;
+  }
+  return Status::Success;
+}
+
+Status
+GatherBuffers(
+    const std::string& msg, const std::vector<CopySegment>& segments,
+    const TRITONSERVER_MemoryType dst_memory_type,
+    const int64_t dst_memory_type_id, void* dst, cudaStream_t cuda_stream,
+    bool* cuda_used, CopyPath* copy_path)
+{
+  *cuda_used = false;
+  CopyPath gathered_path = CopyPath::HOST;
+  bool across_devices = false;
+  size_t offset = 0;
+  size_t idx = 0;
+  while (idx < segments.size()) {
+    // Extend the copy over the following segments that continue it in the
+    // same memory.
+    const CopySegment& first = segments[idx];
+    size_t byte_size = first.byte_size_;
+    for (++idx; idx < segments.size(); ++idx) {
+      const CopySegment& next = segments[idx];
+      if ((next.memory_type_ != first.memory_type_) ||
+          (next.memory_type_id_ != first.memory_type_id_) ||
+          (next.base_ != (static_cast<const char*>(first.base_) + byte_size))) {
+        break;
+      }
+      byte_size += next.byte_size_;
+    }
+
+    bool segment_cuda_used = false;
+    CopyPath path;
+    RETURN_IF_ERROR(CopyBuffer(
+        msg, first.memory_type_, first.memory_type_id_, dst_memory_type,
+        dst_memory_type_id, byte_size, first.base_,
+        static_cast<char*>(dst) + offset, cuda_stream, &segment_cuda_used,
+        false /* copy_on_stream */, &path));
+    *cuda_used |= segment_cuda_used;
+    offset += byte_size;
+    if (!across_devices) {
+      gathered_path = path;
+      across_devices =
+          ((path == CopyPath::PEER) || (path == CopyPath::STAGED));
+    }
+  }
+
+  if (copy_path != nullptr) {
+    *copy_path = gathered_path;
+  }
   return Status::Success;
 }
 
@@ -26,6 +26,7 @@
 #pragma once
 
 #include <set>
+#include <vector>
 #include "status.h"
 #include "triton/common/sync_queue.h"
 
@@ -63,6 +64,36 @@ Status GetDeviceMemoryInfo(const int device_id, size_t* free, size_t* total);
 /// \return The error status. A non-OK status means not all pairs are enabled
 Status EnablePeerAccess(const double min_compute_capability);
 
+/// Whether peer access from 'src_device' to 'dst_device' has been enabled
+/// by EnablePeerAccess().
+bool PeerAccessEnabled(const int64_t src_device, const int64_t dst_device);
+
+/// The way a copy has been performed.
+enum class CopyPath {
+  // memcpy() on the host
+  HOST,
+  // memcpy() in a CUDA host function on the stream
+  HOST_ON_STREAM,
+  // CUDA copy between the host and a device, or within a device
+  CUDA,
+  // CUDA copy between devices that have peer access
+  PEER,
+  // CUDA copy between devices without peer access, which the driver
+  // stages through the host
+  STAGED
+};
+
+/// Get the string representation of a copy path.
+const char* CopyPathString(const CopyPath path);
+
+/// A source buffer of a gathered copy.
+struct CopySegment {
+  const void* base_;
+  size_t byte_size_;
+  TRITONSERVER_MemoryType memory_type_;
+  int64_t memory_type_id_;
+};
+
 /// Copy buffer from 'src' to 'dst' for given 'byte_size'. The buffer location
 /// is identified by the memory type and id, and the corresponding copy will be
 /// initiated.
@@ -81,6 +112,7 @@ Status EnablePeerAccess(const double min_compute_capability);
 /// is completed.
 /// \param copy_on_stream whether the memory copies should be performed in cuda
 /// host functions on the 'cuda_stream'.
+/// \param copy_path If non-null, returns the way the copy is performed.
 /// \return The error status. A non-ok status indicates failure to copy the
 /// buffer.
 Status CopyBuffer(
@@ -89,7 +121,28 @@ Status CopyBuffer(
     const TRITONSERVER_MemoryType dst_memory_type,
     const int64_t dst_memory_type_id, const size_t byte_size, const void* src,
     void* dst, cudaStream_t cuda_stream, bool* cuda_used,
-    bool copy_on_stream = false);
+    bool copy_on_stream = false, CopyPath* copy_path = nullptr);
+
+/// Copy 'segments' one after another into the contiguous buffer 'dst'.
+/// Segments that are adjacent in the same memory are merged so that they
+/// are moved by a single copy.
+/// \param msg The message to be prepended in error message.
+/// \param segments The source buffers, in order.
+/// \param dst_memory_type The memory type CPU/GPU of the destination.
+/// \param dst_memory_type_id The device id of the destination.
+/// \param dst The buffer start address of the destination.
+/// \param cuda_stream The stream to be associated with.
+/// \param cuda_used returns whether a CUDA memory copy is initiated.
+/// \param copy_path If non-null, returns the way the copy between devices
+/// is performed if there is one, the way the last copy is performed
+/// otherwise.
+/// \return The error status. A non-ok status indicates failure to copy the
+/// buffers.
+Status GatherBuffers(
+    const std::string& msg, const std::vector<CopySegment>& segments,
+    const TRITONSERVER_MemoryType dst_memory_type,
+    const int64_t dst_memory_type_id, void* dst, cudaStream_t cuda_stream,
+    bool* cuda_used, CopyPath* copy_path = nullptr);
 
 #ifdef TRITON_ENABLE_GPU
 /// Validates the compute capability of the GPU indexed
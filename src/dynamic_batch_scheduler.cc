@@ -31,22 +31,18 @@
 #include <sys/syscall.h>
 #include <unistd.h>
 #endif
+#include "cache_entry.h"
+#include "clock.h"
 #include "constants.h"
+#include "model_config_utils.h"
+#include "numa_utils.h"
+#include "profiling.h"
 #include "server.h"
 #include "triton/common/logging.h"
 #include "triton/common/model_config.h"
-#include "triton/common/nvtx.h"
 
 namespace triton { namespace core {
 
-uint64_t
-CaptureTimeNs()
-{
-  return std::chrono::duration_cast<std::chrono::nanoseconds>(
-             std::chrono::steady_clock::now().time_since_epoch())
-      .count();
-}
-
 bool
 IsStaleState(Payload::State payload_state)
 {
@@ -68,13 +64,26 @@ DynamicBatchScheduler::DynamicBatchScheduler(
       model_name_(model->Name()),
       dynamic_batching_enabled_(dynamic_batching_enabled),
       queue_(default_queue_policy, priority_levels, queue_policy_map),
-      stop_(false), max_batch_size_((size_t)std::max(1, max_batch_size)),
+      stop_(false), mu_("DynamicBatchScheduler::mu_"), ring_batch_size_(0),
+      batcher_parked_(false), ring_wake_batch_size_(0),
+      ring_preempt_priority_level_(0),
+      root_(nullptr), next_shard_(0),
+      max_batch_size_((size_t)std::max(1, max_batch_size)),
       preferred_batch_sizes_(preferred_batch_sizes),
       pending_batch_delay_ns_(max_queue_delay_microseconds * 1000),
       pending_batch_size_(0), queued_batch_size_(0),
       next_preferred_batch_size_(0),
       enforce_equal_shape_tensors_(enforce_equal_shape_tensors),
-      has_optional_input_(false), preserve_ordering_(preserve_ordering)
+      has_optional_input_(false), shape_bucketing_(false),
+      priority_preemption_(false), pending_batch_preempted_(false),
+      deadline_admission_(false), last_estimate_update_ns_(0),
+      estimate_execution_count_(0), estimate_compute_duration_ns_(0),
+      batch_exec_ns_(0), estimate_concurrency_(1),
+      preserve_ordering_(preserve_ordering),
+      batched_cache_lookup_(false), cache_codec_(CacheCodec::NONE),
+      async_cache_insert_(false), decoupled_(false),
+      request_coalescing_(false),
+      finalizing_(false)
 {
   rate_limiter_ = model_->Server()->GetRateLimiter();
   // Both the server and model config should specify
@@ -82,12 +91,18 @@ DynamicBatchScheduler::DynamicBatchScheduler(
   response_cache_enabled_ =
       response_cache_enable && model_->Server()->ResponseCacheEnabled();
 #ifdef TRITON_ENABLE_METRICS
-  // Initialize metric reporter for cache statistics if cache enabled
-  if (response_cache_enabled_) {
+  // Initialize metric reporter for cache statistics if cache enabled, and
+  // for reporting the queue delay if dynamic batching is enabled
+  if (response_cache_enabled_ ||
+      (dynamic_batching_enabled_ && Metrics::Enabled())) {
     MetricModelReporter::Create(
         model_name_, model_->Version(), METRIC_REPORTER_ID_RESPONSE_CACHE,
         response_cache_enabled_, model_->Config().metric_tags(), &reporter_);
   }
+  if (dynamic_batching_enabled_ && (reporter_ != nullptr)) {
+    reporter_->SetGauge(
+        MetricGauge::BATCHER_QUEUE_DELAY, pending_batch_delay_ns_ / 1000);
+  }
 #endif  // TRITON_ENABLE_METRICS
   max_preferred_batch_size_ = 0;
   for (const auto size : preferred_batch_sizes_) {
@@ -150,9 +165,73 @@ DynamicBatchScheduler::Create(
 
   sched->scheduler_thread_exit_.store(false);
   if (dynamic_batching_enabled) {
-    sched->NewPayload();
-    sched->scheduler_thread_ =
-        std::thread([dyna_sched, nice]() { dyna_sched->BatcherThread(nice); });
+    RETURN_IF_ERROR(sched->InitBatcherParameters());
+
+    // Additional batcher shards are only created for the model level
+    // scheduler, a scheduler bound to a model instance must form all
+    // batches for that instance itself.
+    int64_t shard_count = 1;
+    if (model_instance == nullptr) {
+      RETURN_IF_ERROR(GetInt64ModelParameter(
+          model->Config(), "TRITON_DYNAMIC_BATCHER_SHARD_COUNT",
+          1 /* default_value */, &shard_count));
+      if (shard_count < 1) {
+        return Status(
+            Status::Code::INVALID_ARG,
+            "TRITON_DYNAMIC_BATCHER_SHARD_COUNT must be at least 1 for "
+            "model '" +
+                model->Name() + "', got " + std::to_string(shard_count));
+      }
+      // The response order is reserved when a batcher dequeues a
+      // request, after the request is assigned to a shard, so shards
+      // would respond in the order the requests reach the head of
+      // their own queues rather than in arrival order.
+      if ((shard_count > 1) && batcher_config.preserve_ordering()) {
+        LOG_WARNING << "ignoring TRITON_DYNAMIC_BATCHER_SHARD_COUNT "
+                    << shard_count << " for model '" << model->Name()
+                    << "', preserve_ordering requires a single batcher";
+        shard_count = 1;
+      }
+    }
+
+    for (int64_t i = 1; i < shard_count; ++i) {
+      std::unique_ptr<DynamicBatchScheduler> shard(new DynamicBatchScheduler(
+          model, model_instance, dynamic_batching_enabled, max_batch_size,
+          enforce_equal_shape_tensors, batcher_config.preserve_ordering(),
+          response_cache_enable, preferred_batch_sizes,
+          batcher_config.max_queue_delay_microseconds(),
+          batcher_config.default_queue_policy(),
+          batcher_config.priority_levels(),
+          batcher_config.priority_queue_policy()));
+      shard->scheduler_thread_exit_.store(false);
+      shard->root_ = dyna_sched;
+      RETURN_IF_ERROR(shard->InitBatcherParameters());
+      sched->shards_.emplace_back(std::move(shard));
+    }
+
+    // Every shard may steal from every other shard.
+    std::vector<DynamicBatchScheduler*> group{dyna_sched};
+    for (auto& shard : sched->shards_) {
+      group.push_back(shard.get());
+    }
+    if (group.size() > 1) {
+      for (auto shard : group) {
+        for (auto sibling : group) {
+          if (sibling != shard) {
+            shard->siblings_.push_back(sibling);
+          }
+        }
+      }
+      LOG_VERBOSE(1) << "Using " << group.size()
+                     << " batcher shards for dynamic batcher of "
+                     << sched->model_name_;
+    }
+
+    for (auto shard : group) {
+      shard->NewPayload();
+      shard->scheduler_thread_ =
+          std::thread([shard, nice]() { shard->BatcherThread(nice); });
+    }
   }
 
   scheduler->reset(sched.release());
@@ -160,19 +239,187 @@ DynamicBatchScheduler::Create(
   return Status::Success;
 }
 
+Status
+DynamicBatchScheduler::InitBatcherParameters()
+{
+  // With lock-free enqueue the requests are handed to the scheduler
+  // thread through a ring so that the enqueue path doesn't contend
+  // on 'mu_'.
+  bool lock_free_enqueue = false;
+  RETURN_IF_ERROR(GetBoolModelParameter(
+      model_->Config(), "TRITON_DYNAMIC_BATCHER_LOCK_FREE_ENQUEUE",
+      false /* default_value */, &lock_free_enqueue));
+  if (lock_free_enqueue) {
+    enqueue_ring_.reset(new MPSCRing<std::unique_ptr<InferenceRequest>>(
+        DYNAMIC_BATCHER_ENQUEUE_RING_SIZE));
+    LOG_VERBOSE(1) << "Using lock-free enqueue for dynamic batcher of "
+                   << model_name_;
+  }
+
+  // Shape bucketing is only meaningful if the batch requires equal
+  // shapes.
+  bool shape_bucketing = false;
+  RETURN_IF_ERROR(GetBoolModelParameter(
+      model_->Config(), "TRITON_DYNAMIC_BATCHER_SHAPE_BUCKETING",
+      false /* default_value */, &shape_bucketing));
+  shape_bucketing_ = shape_bucketing && !enforce_equal_shape_tensors_.empty();
+  // Bucketing changes the order in which the requests are dequeued, which
+  // is the order of their responses when the ordering is preserved.
+  if (shape_bucketing_ && preserve_ordering_) {
+    LOG_WARNING << "Shape bucketing is not supported with preserve_ordering "
+                   "for model "
+                << model_name_ << ", disabling";
+    shape_bucketing_ = false;
+  }
+
+  // If a target latency is given the queue delay is adjusted online,
+  // bounded by 'max_queue_delay_microseconds' if it is set. The target
+  // is met on the mean compute time, see QueueDelayController.
+  int64_t target_latency_us = 0;
+  RETURN_IF_ERROR(GetInt64ModelParameter(
+      model_->Config(), "TRITON_DYNAMIC_BATCHER_TARGET_LATENCY_MICROSECONDS",
+      0 /* default_value */, &target_latency_us));
+  if (target_latency_us > 0) {
+    const uint64_t target_latency_ns = target_latency_us * 1000;
+    const uint64_t max_delay_ns = (pending_batch_delay_ns_ != 0)
+                                      ? pending_batch_delay_ns_
+                                      : target_latency_ns;
+    const size_t target_batch_size = (max_preferred_batch_size_ != 0)
+                                         ? max_preferred_batch_size_
+                                         : max_batch_size_;
+    delay_controller_.reset(new QueueDelayController(
+        target_latency_ns, max_delay_ns, pending_batch_delay_ns_,
+        target_batch_size));
+    pending_batch_delay_ns_ = delay_controller_->DelayNs();
+    LOG_VERBOSE(1) << "Using adaptive queue delay for dynamic batcher of "
+                   << model_name_ << " with target latency "
+                   << target_latency_us << " us";
+  }
+
+  // With padding each batch is padded with null requests up to the
+  // nearest preferred batch size, so a backend that is optimized for the
+  // preferred batch sizes always executes one of them. The null requests
+  // don't request any output so no response is produced for the padding.
+  // Padding is not used for the per instance schedulers of the sequence
+  // batcher as the null requests would be missing the control inputs.
+  bool pad_batch = false;
+  RETURN_IF_ERROR(GetBoolModelParameter(
+      model_->Config(), "TRITON_DYNAMIC_BATCHER_PAD_TO_PREFERRED_BATCH_SIZE",
+      false /* default_value */, &pad_batch));
+  if (pad_batch && !preferred_batch_sizes_.empty() &&
+      (model_instance_ == nullptr)) {
+    padded_batch_sizes_ =
+        std::make_shared<const std::set<int32_t>>(preferred_batch_sizes_);
+    LOG_VERBOSE(1) << "Padding batches to preferred batch sizes for dynamic "
+                      "batcher of "
+                   << model_name_;
+  }
+
+  // With priority preemption a pending batch is rebuilt and sent as soon
+  // as a request of higher priority than the pending batch arrives,
+  // instead of the request waiting for the queue delay of the lower
+  // priority requests.
+  RETURN_IF_ERROR(GetBoolModelParameter(
+      model_->Config(), "TRITON_DYNAMIC_BATCHER_PRIORITY_PREEMPTION",
+      false /* default_value */, &priority_preemption_));
+
+  // With batched cache lookup the requests are looked up in the response
+  // cache by the batcher thread in windows of requests instead of one by
+  // one on the enqueue path.
+  // A decoupled model may send any number of responses per request, the
+  // batched lookup only fills a single response so the response streams
+  // are looked up on enqueue.
+  decoupled_ = model_->Config().model_transaction_policy().decoupled();
+  RETURN_IF_ERROR(GetBoolModelParameter(
+      model_->Config(), "TRITON_DYNAMIC_BATCHER_BATCHED_CACHE_LOOKUP",
+      false /* default_value */, &batched_cache_lookup_));
+  batched_cache_lookup_ &= response_cache_enabled_ && !decoupled_;
+
+  // Responses inserted into the response cache may be compressed to fit
+  // more entries into the same cache size, at some CPU cost on insertion
+  // and on every hit.
+  std::string cache_codec;
+  RETURN_IF_ERROR(GetStringModelParameter(
+      model_->Config(), "TRITON_RESPONSE_CACHE_CODEC", "none" /* default */,
+      &cache_codec));
+  RETURN_IF_ERROR(ParseCacheCodec(cache_codec, &cache_codec_));
+
+  // With asynchronous cache insertion the response is only snapshotted
+  // on the response path and inserted into the cache by background
+  // threads, so the insertion latency isn't added to every cache miss.
+  RETURN_IF_ERROR(GetBoolModelParameter(
+      model_->Config(), "TRITON_RESPONSE_CACHE_ASYNC_INSERT",
+      false /* default_value */, &async_cache_insert_));
+
+  // With request coalescing a request with the same inputs as a request
+  // that is still in flight waits for the response of that request
+  // instead of being executed again. A decoupled model may send any
+  // number of responses so its requests can't be coalesced. The
+  // coalesced requests are responded to with their original, outside of
+  // the ordered completion queue, so they can't be coalesced either when
+  // the responses must preserve the request order.
+  RETURN_IF_ERROR(GetBoolModelParameter(
+      model_->Config(), "TRITON_DYNAMIC_BATCHER_COALESCE_REQUESTS",
+      false /* default_value */, &request_coalescing_));
+  if (request_coalescing_ && decoupled_) {
+    LOG_WARNING << "Request coalescing is not supported for decoupled model "
+                << model_name_ << ", disabling";
+    request_coalescing_ = false;
+  }
+  if (request_coalescing_ && preserve_ordering_) {
+    LOG_WARNING << "Request coalescing is not supported with "
+                   "preserve_ordering for model "
+                << model_name_ << ", disabling";
+    request_coalescing_ = false;
+  }
+  request_coalescing_ &= dynamic_batching_enabled_;
+
+  // With deadline-aware admission requests that are expected to time out
+  // in the queue are rejected on enqueue. The estimate is based on the
+  // execution statistics of the model so it requires statistics.
+  RETURN_IF_ERROR(GetBoolModelParameter(
+      model_->Config(), "TRITON_DYNAMIC_BATCHER_DEADLINE_ADMISSION",
+      false /* default_value */, &deadline_admission_));
+#ifndef TRITON_ENABLE_STATS
+  if (deadline_admission_) {
+    LOG_WARNING << "Deadline-aware admission for dynamic batcher of "
+                << model_name_ << " requires statistics, disabling";
+    deadline_admission_ = false;
+  }
+#endif  // TRITON_ENABLE_STATS
+  // The instances have been created by the time the scheduler is, the
+  // instances execute batches of this scheduler concurrently.
+  estimate_concurrency_ = std::max((size_t)1, model_->Instances().size());
+
+  return Status::Success;
+}
+
 DynamicBatchScheduler::~DynamicBatchScheduler()
 {
   // Signal the scheduler thread to exit and then wait for it..
   scheduler_thread_exit_.store(true);
   cv_.notify_one();
+  // The shard threads may steal from each other so all of them must exit
+  // before any shard is destroyed.
+  for (auto& shard : shards_) {
+    shard->scheduler_thread_exit_.store(true);
+    shard->cv_.notify_one();
+  }
   if (scheduler_thread_.joinable()) {
     scheduler_thread_.join();
   }
+  for (auto& shard : shards_) {
+    if (shard->scheduler_thread_.joinable()) {
+      shard->scheduler_thread_.join();
+    }
+  }
 }
 
 Status
 DynamicBatchScheduler::Enqueue(std::unique_ptr<InferenceRequest>& request)
 {
+  PROFILE_RANGE(range, "DynamicBatcher Enqueue");
+
   if (stop_) {
     return Status(
         Status::Code::UNAVAILABLE,
@@ -180,6 +427,73 @@ DynamicBatchScheduler::Enqueue(std::unique_ptr<InferenceRequest>& request)
             "Server is stopping, scheduler for model has stopped accepting new "
             "inference requests");
   }
+  CaptureEnqueueStartNs(request);
+
+  std::unique_ptr<InferenceResponse> cached_response;
+
+  if (response_cache_enabled_) {
+    // With batched cache lookup the request is looked up by the batcher
+    // thread together with the other requests that arrived meanwhile.
+    if (batched_cache_lookup_) {
+      return NextShard()->EnqueueForCacheLookUp(request);
+    }
+    if (decoupled_) {
+      std::vector<std::unique_ptr<InferenceResponse>> cached_responses;
+      CacheLookUp(request, &cached_responses);
+      if (!cached_responses.empty()) {
+        SendCachedResponses(request, cached_responses);
+        return Status::Success;
+      }
+    } else {
+      CacheLookUp(request, cached_response);
+    }
+  }
+
+  if (cached_response != nullptr) {
+    SendCachedResponse(request, cached_response);
+    return Status::Success;
+  }
+
+  if (request_coalescing_) {
+    bool coalesced = false;
+    CoalesceRequest(request, &coalesced);
+    if (coalesced) {
+      return Status::Success;
+    }
+  }
+
+  if (!dynamic_batching_enabled_) {
+    if (preserve_ordering_ || response_cache_enabled_) {
+      DelegateResponse(request);
+    }
+    // If not using dynamic batching, directly enqueue the
+    // request to model for execution
+    auto payload = model_->Server()->GetRateLimiter()->GetPayload(
+        Payload::Operation::INFER_RUN, nullptr /* TritonModelInstance*/);
+    payload->AddRequest(std::move(request));
+    RETURN_IF_ERROR(
+        model_->Server()->GetRateLimiter()->EnqueuePayload(model_, payload));
+
+  } else {
+    // Keep the key as the request is moved from on success
+    const bool is_original = request_coalescing_ && request->CacheKeyIsSet();
+    const std::string key = is_original ? CoalescingKey(*request) : "";
+    auto status = NextShard()->EnqueueToBatcher(request);
+    if (!status.IsOk() && is_original) {
+      // The original is returned to the caller, the requests coalesced
+      // meanwhile are executed on their own.
+      CompleteCoalescedRequests(key, nullptr);
+    }
+    return status;
+  }
+
+  return Status::Success;
+}
+
+void
+DynamicBatchScheduler::CaptureEnqueueStartNs(
+    std::unique_ptr<InferenceRequest>& request)
+{
   // If queue start timestamp hasn't been set, queue timer starts at
   // the beginning of the queueing and scheduling process. Otherwise,
   // dynamic batcher is used as component of another batcher and should not
@@ -201,78 +515,421 @@ DynamicBatchScheduler::Enqueue(std::unique_ptr<InferenceRequest>& request)
   // batcher won't be needing this value and it can be safely reused by
   // the dynamic batcher.
   request->CaptureBatcherStartNs();
+}
 
-  std::unique_ptr<InferenceResponse> cached_response;
+void
+DynamicBatchScheduler::EnqueueBatch(
+    std::vector<std::unique_ptr<InferenceRequest>>& requests)
+{
+  // Cache lookups and coalescing are decided per request, so only the
+  // requests that go straight to the batcher queue are enqueued at once.
+  if (stop_ || !dynamic_batching_enabled_ || response_cache_enabled_ ||
+      request_coalescing_) {
+    Scheduler::EnqueueBatch(requests);
+    return;
+  }
 
-  if (response_cache_enabled_) {
-    CacheLookUp(request, cached_response);
+  for (auto& request : requests) {
+    CaptureEnqueueStartNs(request);
   }
+  NextShard()->EnqueueBatchToBatcher(requests);
+}
 
-  if (cached_response != nullptr) {
-    // If there was a cache hit then try sending the cached response
-    // and release the request.
-    if (preserve_ordering_) {
-      // In order to preserve the order, the response send must be
-      // delegated.
-      DelegateResponse(request);
+void
+DynamicBatchScheduler::CoalesceRequest(
+    std::unique_ptr<InferenceRequest>& request, bool* coalesced)
+{
+  *coalesced = false;
+  if (!request->CacheKeyIsSet()) {
+    std::string key;
+    auto status = TritonCache::Hash(*request, &key);
+    if (!status.IsOk()) {
+      LOG_VERBOSE(1) << request->LogRequest()
+                     << "Request can't be coalesced: " << status.Message();
+      return;
     }
+    request->SetCacheKey(key);
+  }
 
-    // Send cached response and release request
-    InferenceResponse::Send(
-        std::move(cached_response), TRITONSERVER_RESPONSE_COMPLETE_FINAL);
-    InferenceRequest::Release(
-        std::move(request), TRITONSERVER_REQUEST_RELEASE_ALL);
+  const std::string key = CoalescingKey(*request);
+  {
+    std::lock_guard<std::mutex> lock(coalesce_mu_);
+    auto it = coalesced_requests_.find(key);
+    if (it != coalesced_requests_.end()) {
+      it->second.emplace_back(std::move(request));
+      *coalesced = true;
+      return;
+    }
+    coalesced_requests_.emplace(
+        key, std::vector<std::unique_ptr<InferenceRequest>>());
+  }
 
-    return Status::Success;
+  DelegateCoalescedResponse(request);
+}
+
+std::string
+DynamicBatchScheduler::CoalescingKey(const InferenceRequest& request)
+{
+  // The inputs are hashed into the cache key but the requests must also
+  // ask for the same outputs to be answered by the same response.
+  std::string key = request.CacheKey();
+  for (const auto& output : request.ImmutableRequestedOutputs()) {
+    key += ":" + output;
   }
+  return key;
+}
 
-  if (!dynamic_batching_enabled_) {
-    if (preserve_ordering_ || response_cache_enabled_) {
-      DelegateResponse(request);
+void
+DynamicBatchScheduler::DelegateCoalescedResponse(
+    std::unique_ptr<InferenceRequest>& request)
+{
+  // The delegator is replaced by DelegateResponse() if the response of the
+  // original must also be ordered or cached, which then completes the
+  // coalesced requests itself.
+  const std::string key = CoalescingKey(*request);
+  request->SetResponseDelegator(
+      [this, key](
+          std::unique_ptr<InferenceResponse>&& response, const uint32_t flags) {
+        if ((flags & TRITONSERVER_RESPONSE_COMPLETE_FINAL) != 0) {
+          CompleteCoalescedRequests(key, response.get());
+        }
+        InferenceResponse::Send(std::move(response), flags);
+      });
+}
+
+void
+DynamicBatchScheduler::CompleteCoalescedRequests(
+    const std::string& key, InferenceResponse* response)
+{
+  std::vector<std::unique_ptr<InferenceRequest>> coalesced;
+  {
+    std::lock_guard<std::mutex> lock(coalesce_mu_);
+    auto it = coalesced_requests_.find(key);
+    if (it == coalesced_requests_.end()) {
+      return;
     }
-    // If not using dynamic batching, directly enqueue the
-    // request to model for execution
-    auto payload = model_->Server()->GetRateLimiter()->GetPayload(
-        Payload::Operation::INFER_RUN, nullptr /* TritonModelInstance*/);
-    payload->AddRequest(std::move(request));
-    RETURN_IF_ERROR(
-        model_->Server()->GetRateLimiter()->EnqueuePayload(model_, payload));
+    coalesced.swap(it->second);
+    coalesced_requests_.erase(it);
+  }
+  if (coalesced.empty()) {
+    return;
+  }
 
+  // Copy the response through the same serialization used by the response
+  // cache, into buffers owned by the local entry.
+  Status status;
+  CacheEntry entry;
+  if (response == nullptr) {
+    status =
+        Status(Status::Code::UNAVAILABLE, "original request not executed");
+  } else if (!response->ResponseStatus().IsOk()) {
+    status = response->ResponseStatus();
   } else {
-    bool wake_batcher = true;
-    {
-      std::lock_guard<std::mutex> lock(mu_);
+    std::vector<InferenceResponse*> responses{response};
+    status = entry.SetBufferSizes(responses);
+    if (status.IsOk()) {
+      entry.FreeBuffersOnExit();
+      for (auto& buffer : entry.MutableBuffers()) {
+        buffer.first = malloc(buffer.second);
+      }
+      status = entry.SerializeResponses(responses);
+    }
+  }
 
-      queued_batch_size_ += std::max(1U, request->BatchSize());
+  for (auto& request : coalesced) {
+    if (status.IsOk()) {
+      std::unique_ptr<InferenceResponse> copy;
+      auto copy_status = request->ResponseFactory()->CreateResponse(&copy);
+      if (copy_status.IsOk()) {
+        std::vector<InferenceResponse*> copies{copy.get()};
+        copy_status = entry.DeserializeBuffers(copies);
+      }
+      if (copy_status.IsOk()) {
+        InferenceResponse::Send(
+            std::move(copy), TRITONSERVER_RESPONSE_COMPLETE_FINAL);
+        InferenceRequest::Release(
+            std::move(request), TRITONSERVER_REQUEST_RELEASE_ALL);
+        continue;
+      }
+    }
 
-      // Assuming no error is returned, this call takes ownership of
-      // 'request' and so we can't use it after this point.
-      RETURN_IF_ERROR(queue_.Enqueue(request->Priority(), request));
+    // Execute the request on its own, it will not be coalesced again.
+    LOG_VERBOSE(1) << request->LogRequest()
+                   << "Executing coalesced request: " << status.Message();
+    auto enqueue_status = NextShard()->EnqueueToBatcher(request);
+    if (!enqueue_status.IsOk()) {
+      InferenceRequest::RespondIfError(
+          request, enqueue_status, true /* release_requests */);
+    }
+  }
+}
 
-      // If there are any idle runners and the queued batch size is greater or
-      // equal to next preferred batch size, then wake batcher up to service
-      // this request. We do the actual wake outside of the lock to avoid
-      // having the woken thread immediately block on the lock
-      wake_batcher =
-          model_->Server()->GetRateLimiter()->PayloadSlotAvailable(model_);
+DynamicBatchScheduler*
+DynamicBatchScheduler::NextShard()
+{
+  // Spread the requests over the batcher shards, each shard forms
+  // batches from its own queue.
+  if (!shards_.empty()) {
+    const size_t idx = next_shard_.fetch_add(1) % (shards_.size() + 1);
+    if (idx != 0) {
+      return shards_[idx - 1].get();
+    }
+  }
+  return this;
+}
 
-      // We may wake up runner less often if we don't enforce equal shape
-      // within a batch, otherwise must always wake up runner to check it
-      if (enforce_equal_shape_tensors_.empty()) {
-        std::lock_guard<std::mutex> exec_lock(*(curr_payload_->GetExecMutex()));
-        auto payload_state = curr_payload_->GetState();
-        wake_batcher &=
-            (payload_saturated_ || IsStaleState(payload_state) ||
-             (queued_batch_size_ >= next_preferred_batch_size_));
+Status
+DynamicBatchScheduler::EnqueueForCacheLookUp(
+    std::unique_ptr<InferenceRequest>& request)
+{
+  {
+    std::lock_guard<InstrumentedMutex> lock(mu_);
+    cache_lookup_window_.emplace_back(std::move(request));
+  }
+  cv_.notify_one();
+  return Status::Success;
+}
+
+void
+DynamicBatchScheduler::SendCachedResponse(
+    std::unique_ptr<InferenceRequest>& request,
+    std::unique_ptr<InferenceResponse>& cached_response)
+{
+  // If there was a cache hit then try sending the cached response
+  // and release the request.
+  if (preserve_ordering_) {
+    // In order to preserve the order, the response send must be
+    // delegated.
+    DelegateResponse(request);
+  }
+
+  // Send cached response and release request
+  InferenceResponse::Send(
+      std::move(cached_response), TRITONSERVER_RESPONSE_COMPLETE_FINAL);
+  InferenceRequest::Release(
+      std::move(request), TRITONSERVER_REQUEST_RELEASE_ALL);
+}
+
+void
+DynamicBatchScheduler::SendCachedResponses(
+    std::unique_ptr<InferenceRequest>& request,
+    std::vector<std::unique_ptr<InferenceResponse>>& cached_responses)
+{
+  if (preserve_ordering_) {
+    DelegateResponse(request);
+  }
+
+  // Replay the stream in the order it was cached, the final flag goes
+  // with the last response as a stream is never cached empty.
+  for (size_t i = 0; i < cached_responses.size(); ++i) {
+    const uint32_t flags = ((i + 1) == cached_responses.size())
+                               ? TRITONSERVER_RESPONSE_COMPLETE_FINAL
+                               : 0;
+    InferenceResponse::Send(std::move(cached_responses[i]), flags);
+  }
+  InferenceRequest::Release(
+      std::move(request), TRITONSERVER_REQUEST_RELEASE_ALL);
+}
+
+void
+DynamicBatchScheduler::CacheLookUpWindow(
+    std::vector<std::pair<std::unique_ptr<InferenceRequest>, Status>>*
+        rejected)
+{
+  std::vector<std::unique_ptr<InferenceRequest>> requests;
+  {
+    std::lock_guard<InstrumentedMutex> lock(mu_);
+    if (cache_lookup_window_.empty()) {
+      return;
+    }
+    requests.swap(cache_lookup_window_);
+  }
+
+  std::vector<std::unique_ptr<InferenceResponse>> cached_responses;
+  CacheLookUp(requests, &cached_responses);
+
+  // Only the misses are forwarded to the model.
+  size_t miss_count = 0;
+  {
+    std::lock_guard<InstrumentedMutex> lock(mu_);
+    for (size_t idx = 0; idx < requests.size(); ++idx) {
+      if (cached_responses[idx] != nullptr) {
+        continue;
+      }
+      ++miss_count;
+      const size_t batch_size = std::max(1U, requests[idx]->BatchSize());
+      auto status = queue_.Enqueue(requests[idx]->Priority(), requests[idx]);
+      if (status.IsOk()) {
+        queued_batch_size_ += batch_size;
+      } else {
+        rejected->emplace_back(std::move(requests[idx]), status);
       }
     }
+  }
+  if ((miss_count != 0) && (delay_controller_ != nullptr)) {
+    delay_controller_->RecordArrival(miss_count);
+  }
 
-    if (wake_batcher) {
-      cv_.notify_one();
+  for (size_t idx = 0; idx < requests.size(); ++idx) {
+    if (cached_responses[idx] != nullptr) {
+      SendCachedResponse(requests[idx], cached_responses[idx]);
     }
   }
+}
 
-  return Status::Success;
+Status
+DynamicBatchScheduler::EnqueueToBatcher(
+    std::unique_ptr<InferenceRequest>& request)
+{
+  if (delay_controller_ != nullptr) {
+    delay_controller_->RecordArrival(1);
+  }
+
+  // Try the lock-free ring first, fall back to enqueuing under 'mu_'
+  // if the ring is full. The fallback drains the ring first so that the
+  // requests already in the ring stay ahead of this one.
+  if (enqueue_ring_ != nullptr) {
+    const size_t batch_size = std::max(1U, request->BatchSize());
+    const uint64_t priority = request->Priority();
+    if (enqueue_ring_->TryPush(request)) {
+      const size_t ring_batch_size =
+          ring_batch_size_.fetch_add(batch_size) + batch_size;
+      // Only wake the batcher if it is parked and the new requests are
+      // worth looking at. Acquiring 'mu_' before notifying guarantees
+      // that the parked batcher is already waiting on 'cv_'.
+      if (batcher_parked_.load()) {
+        const bool preempt = (priority < ring_preempt_priority_level_.load());
+        if (preempt || (ring_batch_size >= ring_wake_batch_size_.load())) {
+          {
+            std::lock_guard<InstrumentedMutex> lock(mu_);
+            pending_batch_preempted_ |= preempt;
+          }
+          cv_.notify_one();
+        }
+      }
+      return Status::Success;
+    }
+  }
+
+  std::vector<std::pair<std::unique_ptr<InferenceRequest>, Status>>
+      ring_rejected;
+  Status enqueue_status;
+  bool wake_batcher = true;
+  bool wake_sibling = false;
+  {
+    std::lock_guard<InstrumentedMutex> lock(mu_);
+
+    DrainEnqueueRing(&ring_rejected);
+    queued_batch_size_ += std::max(1U, request->BatchSize());
+
+    // A request that is placed within the pending batch preempts the
+    // pending batch, which is then rebuilt and sent right away.
+    const bool preempt = priority_preemption_ &&
+                         (queue_.PendingBatchCount() != 0) &&
+                         queue_.PrecedesCursor(request->Priority());
+
+    // Assuming no error is returned, this call takes ownership of
+    // 'request' and so we can't use it after this point.
+    enqueue_status = queue_.Enqueue(request->Priority(), request);
+    if (!enqueue_status.IsOk()) {
+      queued_batch_size_ -= std::max(1U, request->BatchSize());
+    }
+    pending_batch_preempted_ |= (preempt && enqueue_status.IsOk());
+
+    // If there are any idle runners and the queued batch size is greater or
+    // equal to next preferred batch size, then wake batcher up to service
+    // this request. We do the actual wake outside of the lock to avoid
+    // having the woken thread immediately block on the lock
+    wake_batcher =
+        model_->Server()->GetRateLimiter()->PayloadSlotAvailable(model_);
+
+    // We may wake up runner less often if we don't enforce equal shape
+    // within a batch, otherwise must always wake up runner to check it
+    if (enforce_equal_shape_tensors_.empty()) {
+      std::lock_guard<std::mutex> exec_lock(*(curr_payload_->GetExecMutex()));
+      auto payload_state = curr_payload_->GetState();
+      wake_batcher &=
+          (payload_saturated_ || IsStaleState(payload_state) || preempt ||
+           (queued_batch_size_ >= next_preferred_batch_size_));
+    }
+
+    // If more than a full batch is waiting in this shard, give an idle
+    // sibling shard the chance to steal part of it.
+    wake_sibling = !siblings_.empty() && (queued_batch_size_ > max_batch_size_);
+  }
+
+  for (auto& pr : ring_rejected) {
+    InferenceRequest::RespondIfError(pr.first, pr.second, true);
+  }
+  if (wake_batcher) {
+    cv_.notify_one();
+  }
+  if (wake_sibling) {
+    siblings_[next_shard_.fetch_add(1) % siblings_.size()]->cv_.notify_one();
+  }
+
+  // The caller keeps a request that was not enqueued
+  return enqueue_status;
+}
+
+void
+DynamicBatchScheduler::EnqueueBatchToBatcher(
+    std::vector<std::unique_ptr<InferenceRequest>>& requests)
+{
+  if (delay_controller_ != nullptr) {
+    delay_controller_->RecordArrival(requests.size());
+  }
+
+  // The enqueue ring is bypassed, pushing the requests one by one would
+  // wake the batcher for each of them. The requests already in the ring
+  // arrived earlier so they are queued first.
+  std::vector<std::pair<std::unique_ptr<InferenceRequest>, Status>> rejected;
+  bool wake_batcher = true;
+  bool wake_sibling = false;
+  {
+    std::lock_guard<InstrumentedMutex> lock(mu_);
+
+    DrainEnqueueRing(&rejected);
+    bool preempt = false;
+    for (auto& request : requests) {
+      const size_t batch_size = std::max(1U, request->BatchSize());
+      const bool request_preempt = priority_preemption_ &&
+                                   (queue_.PendingBatchCount() != 0) &&
+                                   queue_.PrecedesCursor(request->Priority());
+      Status status = queue_.Enqueue(request->Priority(), request);
+      if (!status.IsOk()) {
+        rejected.emplace_back(std::move(request), status);
+        continue;
+      }
+      queued_batch_size_ += batch_size;
+      preempt |= request_preempt;
+    }
+    pending_batch_preempted_ |= preempt;
+
+    wake_batcher =
+        model_->Server()->GetRateLimiter()->PayloadSlotAvailable(model_);
+    if (enforce_equal_shape_tensors_.empty()) {
+      std::lock_guard<std::mutex> exec_lock(*(curr_payload_->GetExecMutex()));
+      auto payload_state = curr_payload_->GetState();
+      wake_batcher &=
+          (payload_saturated_ || IsStaleState(payload_state) || preempt ||
+           (queued_batch_size_ >= next_preferred_batch_size_));
+    }
+    wake_sibling = !siblings_.empty() && (queued_batch_size_ > max_batch_size_);
+  }
+  requests.clear();
+
+  if (wake_batcher) {
+    cv_.notify_one();
+  }
+  if (wake_sibling) {
+    siblings_[next_shard_.fetch_add(1) % siblings_.size()]->cv_.notify_one();
+  }
+
+  for (auto& entry : rejected) {
+    InferenceRequest::RespondIfError(
+        entry.first, entry.second, true /* release_requests */);
+  }
 }
 
 void
@@ -280,10 +937,174 @@ DynamicBatchScheduler::NewPayload()
 {
   curr_payload_ = model_->Server()->GetRateLimiter()->GetPayload(
       Payload::Operation::INFER_RUN, model_instance_);
+  curr_payload_->SetPaddedBatchSizes(padded_batch_sizes_);
   payload_saturated_ = false;
   CustomBatchInit();
 }
 
+void
+DynamicBatchScheduler::UpdateQueueDelay()
+{
+  const uint64_t now_ns = SteadyClockNs();
+  if (!delay_controller_->UpdateDue(now_ns)) {
+    return;
+  }
+
+  uint64_t execution_count = 0;
+  uint64_t compute_duration_ns = 0;
+#ifdef TRITON_ENABLE_STATS
+  model_->MutableStatsAggregator()->ExecutionStats(
+      &execution_count, &compute_duration_ns);
+#endif  // TRITON_ENABLE_STATS
+  delay_controller_->Update(now_ns, execution_count, compute_duration_ns);
+  pending_batch_delay_ns_ = delay_controller_->DelayNs();
+
+#ifdef TRITON_ENABLE_METRICS
+  if (reporter_ != nullptr) {
+    reporter_->SetGauge(
+        MetricGauge::BATCHER_QUEUE_DELAY, pending_batch_delay_ns_ / 1000);
+  }
+#endif  // TRITON_ENABLE_METRICS
+}
+
+void
+DynamicBatchScheduler::UpdateExecutionEstimate()
+{
+  const uint64_t now_ns = SteadyClockNs();
+  if ((now_ns - last_estimate_update_ns_) <
+      DYNAMIC_BATCHER_DELAY_UPDATE_INTERVAL_NS) {
+    return;
+  }
+  last_estimate_update_ns_ = now_ns;
+
+  uint64_t execution_count = 0;
+  uint64_t compute_duration_ns = 0;
+#ifdef TRITON_ENABLE_STATS
+  model_->MutableStatsAggregator()->ExecutionStats(
+      &execution_count, &compute_duration_ns);
+#endif  // TRITON_ENABLE_STATS
+  if (execution_count > estimate_execution_count_) {
+    // Smooth the observed compute time per execution the same way as
+    // the queue delay controller does.
+    constexpr double alpha = 0.25;
+    const double exec_ns =
+        (double)(compute_duration_ns - estimate_compute_duration_ns_) /
+        (execution_count - estimate_execution_count_);
+    batch_exec_ns_ = (batch_exec_ns_ == 0)
+                         ? exec_ns
+                         : (1 - alpha) * batch_exec_ns_ + alpha * exec_ns;
+    queue_.SetBatchExecutionEstimate(
+        (uint64_t)batch_exec_ns_, max_batch_size_, estimate_concurrency_);
+  }
+  estimate_execution_count_ = execution_count;
+  estimate_compute_duration_ns_ = compute_duration_ns;
+}
+
+void
+DynamicBatchScheduler::SelectShapeBucket()
+{
+  // Once the oldest request has waited for the queue delay it must be
+  // sent so its bucket is used, this bounds how long a request in a small
+  // bucket can be passed over by larger buckets.
+  const auto& oldest = queue_.RequestAtCursor();
+  if ((pending_batch_delay_ns_ == 0) ||
+      ((SteadyClockNs() - oldest->BatcherStartNs()) >=
+       pending_batch_delay_ns_)) {
+    return;
+  }
+
+  std::unordered_map<size_t, size_t> bucket_batch_sizes;
+  size_t best_signature =
+      InputShapeSignature(oldest, enforce_equal_shape_tensors_);
+  size_t best_batch_size = 0;
+  queue_.ForEachAtCursorLevel(
+      [this, &bucket_batch_sizes, &best_signature,
+       &best_batch_size](const std::unique_ptr<InferenceRequest>& request) {
+        const size_t signature =
+            InputShapeSignature(request, enforce_equal_shape_tensors_);
+        auto& batch_size = bucket_batch_sizes[signature];
+        batch_size += std::max(1U, request->BatchSize());
+        if (batch_size > best_batch_size) {
+          best_batch_size = batch_size;
+          best_signature = signature;
+        }
+      });
+
+  queue_.PartitionAtCursor(
+      [this, best_signature](const std::unique_ptr<InferenceRequest>& request) {
+        return InputShapeSignature(request, enforce_equal_shape_tensors_) ==
+               best_signature;
+      });
+}
+
+void
+DynamicBatchScheduler::DrainEnqueueRing(
+    std::vector<std::pair<std::unique_ptr<InferenceRequest>, Status>>*
+        rejected)
+{
+  if (enqueue_ring_ == nullptr) {
+    return;
+  }
+
+  ring_batch_size_.store(0);
+  std::unique_ptr<InferenceRequest> request;
+  while (enqueue_ring_->TryPop(&request)) {
+    const size_t batch_size = std::max(1U, request->BatchSize());
+    auto status = queue_.Enqueue(request->Priority(), request);
+    if (status.IsOk()) {
+      queued_batch_size_ += batch_size;
+    } else {
+      rejected->emplace_back(std::move(request), status);
+    }
+  }
+}
+
+void
+DynamicBatchScheduler::StealRequests(
+    std::vector<std::pair<std::unique_ptr<InferenceRequest>, Status>>*
+        rejected)
+{
+  for (auto sibling : siblings_) {
+    // Never block on a sibling, if it is busy forming a batch it is not
+    // the one that needs help. Because only try-lock is used two shards
+    // stealing from each other can't deadlock.
+    std::unique_lock<InstrumentedMutex> sibling_lock(
+        sibling->mu_, std::try_to_lock);
+    if (!sibling_lock.owns_lock() ||
+        (sibling->queued_batch_size_ <= sibling->max_batch_size_)) {
+      continue;
+    }
+
+    // Take the oldest half of the sibling's backlog. Dequeue invalidates
+    // the sibling's pending batch so it recomputes it on its next pass.
+    const size_t steal_batch_size = sibling->queued_batch_size_ / 2;
+    size_t stolen_batch_size = 0;
+    while (stolen_batch_size < steal_batch_size) {
+      std::unique_ptr<InferenceRequest> request;
+      if (!sibling->queue_.Dequeue(&request).IsOk()) {
+        break;
+      }
+      const size_t batch_size = std::max(1U, request->BatchSize());
+      stolen_batch_size += batch_size;
+      auto status = queue_.Enqueue(request->Priority(), request);
+      if (status.IsOk()) {
+        queued_batch_size_ += batch_size;
+      } else {
+        rejected->emplace_back(std::move(request), status);
+      }
+    }
+    sibling->queued_batch_size_ -=
+        std::min(sibling->queued_batch_size_, stolen_batch_size);
+
+    if (stolen_batch_size > 0) {
+      LOG_VERBOSE(2) << "Dynamic batcher shard of " << model_name_
+                     << " stole batch size " << stolen_batch_size
+                     << " from a sibling shard";
+      return;
+    }
+  }
+}
+
 void
 DynamicBatchScheduler::BatcherThread(const int nice)
 {
@@ -300,6 +1121,21 @@ DynamicBatchScheduler::BatcherThread(const int nice)
   LOG_VERBOSE(1) << "Starting dynamic-batcher thread for " << model_name_
                  << " at default nice...";
 #endif
+  // Pin the thread to the batcher CPUs of the host policy of the instance
+  // the batches are formed for, or of the first instance of the model.
+  {
+    const TritonModelInstance* policy_instance = model_instance_;
+    if ((policy_instance == nullptr) && !model_->Instances().empty()) {
+      policy_instance = model_->Instances().front().get();
+    }
+    if (policy_instance != nullptr) {
+      auto status = SetNumaConfigOnBatcherThread(policy_instance->HostPolicy());
+      if (!status.IsOk()) {
+        LOG_ERROR << "Failed to set host policy for dynamic-batcher thread of "
+                  << model_name_ << ": " << status.Message();
+      }
+    }
+  }
   // For debugging/testing, delay start of threads until the queue
   // contains the specified number of entries.
   size_t delay_cnt = 0;
@@ -317,8 +1153,18 @@ DynamicBatchScheduler::BatcherThread(const int nice)
   };
   const uint64_t default_wait_microseconds = 500 * 1000;
 
+  // Requests from 'enqueue_ring_' that were rejected by 'queue_' and
+  // must be responded to outside of 'mu_'.
+  std::vector<std::pair<std::unique_ptr<InferenceRequest>, Status>>
+      ring_rejected;
+
+  const std::string range_label = "DynamicBatcher " + model_name_;
   while (!scheduler_thread_exit_.load()) {
-    NVTX_RANGE(nvtx_, "DynamicBatcher " + model_name_);
+    PROFILE_RANGE(range, range_label);
+
+    if (batched_cache_lookup_) {
+      CacheLookUpWindow(&ring_rejected);
+    }
 
     std::shared_ptr<std::vector<std::deque<std::unique_ptr<InferenceRequest>>>>
         rejected_requests;
@@ -326,7 +1172,14 @@ DynamicBatchScheduler::BatcherThread(const int nice)
 
     // Hold the lock for as short a time as possible.
     {
-      std::unique_lock<std::mutex> lock(mu_);
+      std::unique_lock<std::mutex> lock = mu_.Acquire();
+      DrainEnqueueRing(&ring_rejected);
+      if (deadline_admission_) {
+        UpdateExecutionEstimate();
+      }
+      if (queue_.Empty() && !siblings_.empty()) {
+        StealRequests(&ring_rejected);
+      }
       {
         std::lock_guard<std::mutex> exec_lock(*(curr_payload_->GetExecMutex()));
         auto payload_state = curr_payload_->GetState();
@@ -352,7 +1205,18 @@ DynamicBatchScheduler::BatcherThread(const int nice)
         if (payload_saturated_) {
           continue;
         }
-        cv_.wait(lock, wait_for_slots);
+        if (batched_cache_lookup_) {
+          // Requests waiting for cache lookup must not wait for a slot,
+          // a cache hit doesn't need one.
+          cv_.wait(lock, [this, &wait_for_slots]() {
+            return wait_for_slots() || !cache_lookup_window_.empty();
+          });
+          if (!cache_lookup_window_.empty()) {
+            continue;
+          }
+        } else {
+          cv_.wait(lock, wait_for_slots);
+        }
         {
           std::lock_guard<std::mutex> exec_lock(
               *(curr_payload_->GetExecMutex()));
@@ -371,6 +1235,9 @@ DynamicBatchScheduler::BatcherThread(const int nice)
           // Extract batch only if there is pending batch
           auto pending_batch_queue_cnt = queue_.PendingBatchCount();
           if ((wait_microseconds == 0) && (pending_batch_queue_cnt != 0)) {
+#ifdef TRITON_ENABLE_METRICS
+            const size_t queue_depth = queue_.Size();
+#endif  // TRITON_ENABLE_METRICS
             curr_payload_->ReserveRequests(pending_batch_queue_cnt);
             for (size_t idx = 0; idx < pending_batch_queue_cnt; ++idx) {
               std::unique_ptr<InferenceRequest> request;
@@ -400,6 +1267,12 @@ DynamicBatchScheduler::BatcherThread(const int nice)
 
             queued_batch_size_ -= pending_batch_size_;
             pending_batch_size_ = 0;
+#ifdef TRITON_ENABLE_METRICS
+            if (reporter_ != nullptr) {
+              reporter_->ObserveBatch(
+                  curr_payload_->BatchSize(), queue_depth, max_batch_size_);
+            }
+#endif  // TRITON_ENABLE_METRICS
           }
         }
       }
@@ -408,7 +1281,30 @@ DynamicBatchScheduler::BatcherThread(const int nice)
       // for the specified timeout before checking the queue again.
       if (wait_microseconds > 0) {
         std::chrono::microseconds wait_timeout(wait_microseconds);
-        cv_.wait_for(lock, wait_timeout);
+        if (enqueue_ring_ != nullptr) {
+          // Let producers know how much new work is needed before they
+          // should wake this thread, mirroring the wake condition of the
+          // locked enqueue path.
+          size_t wake_batch_size = 0;
+          if (enforce_equal_shape_tensors_.empty() && !payload_saturated_ &&
+              !queue_.Empty() &&
+              (next_preferred_batch_size_ > queued_batch_size_)) {
+            wake_batch_size = next_preferred_batch_size_ - queued_batch_size_;
+          }
+          ring_wake_batch_size_.store(wake_batch_size);
+          ring_preempt_priority_level_.store(
+              (priority_preemption_ && (queue_.PendingBatchCount() != 0))
+                  ? queue_.CursorPriorityLevel()
+                  : 0);
+          batcher_parked_.store(true);
+          if (enqueue_ring_->Empty() ||
+              (ring_batch_size_.load() < wake_batch_size)) {
+            cv_.wait_for(lock, wait_timeout);
+          }
+          batcher_parked_.store(false);
+        } else {
+          cv_.wait_for(lock, wait_timeout);
+        }
       }
     }
 
@@ -422,19 +1318,33 @@ DynamicBatchScheduler::BatcherThread(const int nice)
       model_->Server()->GetRateLimiter()->EnqueuePayload(model_, curr_payload_);
     }
 
+    for (auto& pr : ring_rejected) {
+      InferenceRequest::RespondIfError(pr.first, pr.second, true);
+    }
+    ring_rejected.clear();
+
     // Finish rejected requests if any
     if (rejected_requests != nullptr) {
       static Status rejected_status =
           Status(Status::Code::UNAVAILABLE, "Request timeout expired");
+      static Status cancelled_status =
+          Status(Status::Code::UNAVAILABLE, "Request cancelled");
       for (auto& rejected_queue : *rejected_requests) {
         for (auto& rejected_request : rejected_queue) {
           InferenceRequest::RespondIfError(
-              rejected_request, rejected_status, true);
+              rejected_request,
+              rejected_request->IsCancelled() ? cancelled_status
+                                              : rejected_status,
+              true);
         }
       }
     }
   }  // end runner loop
 
+  for (auto& pr : ring_rejected) {
+    InferenceRequest::RespondIfError(pr.first, pr.second, true);
+  }
+
   LOG_VERBOSE(1) << "Stopping dynamic-batcher thread for " << model_name_
                  << "...";
 }
@@ -444,6 +1354,9 @@ DynamicBatchScheduler::GetDynamicBatch()
 {
   // 'mu_' mutex must be held when this function is called. queue_
   // must not be empty.
+  //
+  // The batch formation rules are mirrored by test/batcher_simulator.cc,
+  // which should be updated along with them.
 
   // Examine the new requests. If adding these new requests to the
   // pending batch allows a preferred batch size then execute it
@@ -452,6 +1365,14 @@ DynamicBatchScheduler::GetDynamicBatch()
   // does not match the shape of the pending batch.
   bool send_now = false;
 
+  // A preempted pending batch is sent once it is rebuilt.
+  const bool preempted = pending_batch_preempted_;
+  pending_batch_preempted_ = false;
+
+  if (delay_controller_ != nullptr) {
+    UpdateQueueDelay();
+  }
+
   // If the previous payload was not executed, reset the cursor to the start
   // of the queue to re-iterate over it and find the ideal batch.
   if (!queue_.IsCursorValid()) {
@@ -470,6 +1391,10 @@ DynamicBatchScheduler::GetDynamicBatch()
   const bool check_input =
       !enforce_equal_shape_tensors_.empty() || has_optional_input_;
   auto payload_batch_size = curr_payload_->BatchSize();
+  if (shape_bucketing_ && (payload_batch_size == 0) &&
+      (queue_.PendingBatchCount() == 0) && !queue_.CursorEnd()) {
+    SelectShapeBucket();
+  }
   while (!queue_.CursorEnd()) {
     const auto batch_size = std::max(1U, queue_.RequestAtCursor()->BatchSize());
 
@@ -506,10 +1431,20 @@ DynamicBatchScheduler::GetDynamicBatch()
       }
 
       // There is a pending batch and it has a different shape then
-      // this request, so send the pending batch as it is.
+      // this request. With shape bucketing, bring the requests of the
+      // same shape that are queued behind forward and re-examine the
+      // cursor. Otherwise send the pending batch as it is.
       if (check_input &&
           !curr_payload_->MutableRequiredEqualInputs()->HasEqualInputs(
               queue_.RequestAtCursor())) {
+        if (shape_bucketing_ &&
+            queue_.PartitionAtCursor(
+                [this](const std::unique_ptr<InferenceRequest>& request) {
+                  return curr_payload_->MutableRequiredEqualInputs()
+                      ->HasEqualInputs(request);
+                })) {
+          continue;
+        }
         curr_payload_->MarkSaturated();
         send_now = true;
         break;
@@ -539,9 +1474,7 @@ DynamicBatchScheduler::GetDynamicBatch()
 
   // Obtain the age of the oldest pending request to compare with the maximum
   // batch queuing delay
-  uint64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
-                        std::chrono::steady_clock::now().time_since_epoch())
-                        .count();
+  uint64_t now_ns = SteadyClockNs();
   uint64_t delay_ns = now_ns - queue_.OldestEnqueueTime();
   bool delay_is_exceeded =
       (pending_batch_delay_ns_ != 0) && (delay_ns >= pending_batch_delay_ns_);
@@ -571,7 +1504,7 @@ DynamicBatchScheduler::GetDynamicBatch()
     return 0;
   }
 
-  if (delay_is_exceeded || (pending_batch_delay_ns_ == 0)) {
+  if (delay_is_exceeded || preempted || (pending_batch_delay_ns_ == 0)) {
     return 0;
   }
 
@@ -628,18 +1561,38 @@ void
 DynamicBatchScheduler::DelegateResponse(
     std::unique_ptr<InferenceRequest>& request)
 {
-  std::lock_guard<std::mutex> lock(completion_queue_mtx_);
-  completion_queue_.emplace_back();
-  auto queue_slot = &completion_queue_.back();
+  // All shards of a batcher share the completion queue of the model
+  // level scheduler so that the order is preserved across shards.
+  DynamicBatchScheduler* ordering = (root_ != nullptr) ? root_ : this;
+  std::lock_guard<std::mutex> lock(ordering->completion_queue_mtx_);
+  ordering->completion_queue_.emplace_back();
+  auto queue_slot = &ordering->completion_queue_.back();
   // Cache plumbing
   const std::string& key = request->CacheKey();
   const bool is_key_set = request->CacheKeyIsSet();
   const uint64_t lookup_end_ns = request->CacheLookupEndNs();
   const uint64_t lookup_start_ns = request->CacheLookupStartNs();
+  // The requests coalesced into this request are tracked by the model
+  // level scheduler.
+  const bool coalescing = request_coalescing_ && is_key_set;
+  const std::string coalescing_key =
+      coalescing ? CoalescingKey(*request) : "";
+  // The responses of a decoupled request are cached as one stream
+  std::shared_ptr<CacheStream> cache_stream;
+  if (response_cache_enabled_ && decoupled_) {
+    cache_stream = std::make_shared<CacheStream>();
+    cache_stream->entry_.reset(new CacheEntry());
+    cache_stream->entry_->SetCodec(cache_codec_);
+  }
 
   request->SetResponseDelegator(
-      [this, queue_slot, key, is_key_set, lookup_end_ns, lookup_start_ns](
+      [this, ordering, queue_slot, key, is_key_set, lookup_end_ns,
+       lookup_start_ns, coalescing, coalescing_key, cache_stream](
           std::unique_ptr<InferenceResponse>&& response, const uint32_t flags) {
+        if (coalescing &&
+            ((flags & TRITONSERVER_RESPONSE_COMPLETE_FINAL) != 0)) {
+          ordering->CompleteCoalescedRequests(coalescing_key, response.get());
+        }
         if (response_cache_enabled_) {
           // Logical error, the key should be set if caching is enabled
           // for this model
@@ -652,16 +1605,33 @@ DynamicBatchScheduler::DelegateResponse(
           auto cache = model_->Server()->CacheManager()->Cache();
 
 #ifdef TRITON_ENABLE_STATS
-          const uint64_t insert_start_ns = CaptureTimeNs();
+          const uint64_t insert_start_ns = SteadyClockNs();
 #endif  // TRITON_ENABLE_STATS
 
-          auto status = cache->Insert(response.get(), key);
+          // An asynchronous insert can't report ALREADY_EXISTS, it is
+          // accounted as a miss like any other lookup that missed.
+          Status status;
+          if (cache_stream != nullptr) {
+            status = CacheStreamResponse(
+                key, cache_stream.get(), response.get(), flags);
+          } else if (async_cache_insert_) {
+            status = cache->InsertAsync(
+                response.get(), key, cache_codec_, CacheComputeCostNs());
+          } else {
+            status = cache->Insert(
+                response.get(), key, cache_codec_, CacheComputeCostNs());
+          }
 
 #ifdef TRITON_ENABLE_STATS
-          const uint64_t insert_end_ns = CaptureTimeNs();
+          const uint64_t insert_end_ns = SteadyClockNs();
 #endif  // TRITON_ENABLE_STATS
 
+          // A response stream is only accounted once, when it completes
+          const bool completed =
+              (cache_stream == nullptr) ||
+              ((flags & TRITONSERVER_RESPONSE_COMPLETE_FINAL) != 0);
           bool cache_miss =
+              completed &&
               (status.StatusCode() != Status::Code::ALREADY_EXISTS);
           if (cache_miss) {
 #ifdef TRITON_ENABLE_STATS
@@ -687,11 +1657,28 @@ DynamicBatchScheduler::DelegateResponse(
         }
 
         if (preserve_ordering_) {
+          // If this is the oldest outstanding request and no other thread
+          // is releasing responses, the response is in order and can be
+          // sent directly. Otherwise it is parked in its slot and sent by
+          // the thread that is releasing responses.
+          bool send_now = false;
           {
-            std::lock_guard<std::mutex> lock(completion_queue_mtx_);
-            queue_slot->emplace_back(std::move(response), flags);
+            std::lock_guard<std::mutex> lock(ordering->completion_queue_mtx_);
+            if (!ordering->finalizing_ &&
+                (&ordering->completion_queue_.front() == queue_slot)) {
+              ordering->finalizing_ = true;
+              send_now = true;
+              if ((flags & TRITONSERVER_RESPONSE_COMPLETE_FINAL) != 0) {
+                ordering->completion_queue_.pop_front();
+              }
+            } else {
+              queue_slot->emplace_back(std::move(response), flags);
+            }
+          }
+          if (send_now) {
+            InferenceResponse::Send(std::move(response), flags);
+            ordering->FinalizeResponses();
           }
-          FinalizeResponses();
         } else {
           InferenceResponse::Send(std::move(response), flags);
         }
@@ -707,18 +1694,10 @@ DynamicBatchScheduler::CacheLookUp(
   auto cache = model_->Server()->CacheManager()->Cache();
   std::unique_ptr<InferenceResponse> local_response;
   request->ResponseFactory()->CreateResponse(&local_response);
-  // Hash request into cache key
-  std::string key = "";
-  if (!request->CacheKeyIsSet()) {
-    status = cache->Hash(*request, &key);
-    if (!status.IsOk()) {
-      LOG_ERROR << "Failed to hash request: " << status.Message();
-      return;
-    }
-    request->SetCacheKey(key);
-  } else {
-    key = request->CacheKey();
+  if (!SetCacheKey(request)) {
+    return;
   }
+  const std::string& key = request->CacheKey();
 
   // Lookup and capture timestamps
   {
@@ -738,35 +1717,198 @@ DynamicBatchScheduler::CacheLookUp(
 }
 
 void
-DynamicBatchScheduler::FinalizeResponses()
+DynamicBatchScheduler::CacheLookUp(
+    std::unique_ptr<InferenceRequest>& request,
+    std::vector<std::unique_ptr<InferenceResponse>>* cached_responses)
 {
-  // Need exclusive access of the function to ensure responses are sent
-  // in order
-  std::lock_guard<std::mutex> lock(finalize_mtx_);
-  // Finalize the completed payloads in-order as far as possible
-  std::deque<std::pair<std::unique_ptr<InferenceResponse>, const uint32_t>>
-      responses;
-  {
-    std::lock_guard<std::mutex> queue_lock(completion_queue_mtx_);
-    while (!completion_queue_.empty() && !completion_queue_.front().empty()) {
-      bool response_complete = false;
-      for (auto& response_pair : completion_queue_.front()) {
-        // Assuming FINAL flag is set only in the last response of the request
-        response_complete =
-            ((response_pair.second & TRITONSERVER_RESPONSE_COMPLETE_FINAL) !=
-             0);
-        responses.emplace_back(std::move(response_pair));
+  cached_responses->clear();
+  if (!SetCacheKey(request)) {
+    return;
+  }
+
+  auto cache = model_->Server()->CacheManager()->Cache();
+  request->CaptureCacheLookupStartNs();
+  Status status = cache->Lookup(
+      request->CacheKey(), request->ResponseFactory(), cached_responses);
+  request->CaptureCacheLookupEndNs();
+
+  if (status.IsOk() && !cached_responses->empty()) {
+#ifdef TRITON_ENABLE_STATS
+    request->ReportStatisticsCacheHit(reporter_.get());
+#endif  // TRITON_ENABLE_STATS
+  } else {
+    cached_responses->clear();
+  }
+}
+
+bool
+DynamicBatchScheduler::SetCacheKey(std::unique_ptr<InferenceRequest>& request)
+{
+  if (request->CacheKeyIsSet()) {
+    return true;
+  }
+
+  // Hash request into cache key
+  std::string key;
+  Status status = TritonCache::Hash(*request, &key);
+  if (!status.IsOk()) {
+    LOG_ERROR << "Failed to hash request: " << status.Message();
+    return false;
+  }
+  request->SetCacheKey(key);
+  return true;
+}
+
+Status
+DynamicBatchScheduler::CacheStreamResponse(
+    const std::string& key, CacheStream* stream, InferenceResponse* response,
+    const uint32_t flags)
+{
+  // The final flag may come with a "null" response that has nothing to
+  // cache. A stream with an error response is not cached.
+  if (!stream->failed_ && !response->IsNullResponse()) {
+    if (!response->ResponseStatus().IsOk()) {
+      stream->failed_ = true;
+    } else {
+      Status status = stream->entry_->AppendResponse(response);
+      if (!status.IsOk()) {
+        LOG_ERROR << "Failed to add response to the stream of key [" << key
+                  << "]: " << status.Message();
+        stream->failed_ = true;
       }
-      if (response_complete) {
-        completion_queue_.pop_front();
-      } else {
-        completion_queue_.front().clear();
+    }
+  }
+
+  if (((flags & TRITONSERVER_RESPONSE_COMPLETE_FINAL) == 0) ||
+      stream->failed_ || (stream->entry_->BufferCount() == 0)) {
+    return Status::Success;
+  }
+
+  stream->entry_->SetComputeCostNs(CacheComputeCostNs());
+  auto cache = model_->Server()->CacheManager()->Cache();
+  return cache->InsertEntry(
+      std::move(stream->entry_), key, async_cache_insert_);
+}
+
+uint64_t
+DynamicBatchScheduler::CacheComputeCostNs()
+{
+  // The model's average compute time per execution, the compute time of
+  // the individual request isn't known when its response is sent
+  uint64_t compute_cost_ns = 0;
+#ifdef TRITON_ENABLE_STATS
+  uint64_t execution_count = 0;
+  uint64_t compute_duration_ns = 0;
+  model_->MutableStatsAggregator()->ExecutionStats(
+      &execution_count, &compute_duration_ns);
+  if (execution_count > 0) {
+    compute_cost_ns = compute_duration_ns / execution_count;
+  }
+#endif  // TRITON_ENABLE_STATS
+  return compute_cost_ns;
+}
+
+void
+DynamicBatchScheduler::CacheLookUp(
+    std::vector<std::unique_ptr<InferenceRequest>>& requests,
+    std::vector<std::unique_ptr<InferenceResponse>>* cached_responses)
+{
+  auto cache = model_->Server()->CacheManager()->Cache();
+  cached_responses->clear();
+  cached_responses->resize(requests.size());
+
+  // Hash every request into its cache key, a request that can't be hashed
+  // is treated as a miss.
+  std::vector<std::unique_ptr<InferenceResponse>> local_responses(
+      requests.size());
+  std::vector<std::string> keys;
+  std::vector<InferenceResponse*> responses;
+  std::vector<size_t> lookup_indices;
+  for (size_t idx = 0; idx < requests.size(); ++idx) {
+    auto& request = requests[idx];
+    if (!request->CacheKeyIsSet()) {
+      std::string key = "";
+      auto status = cache->Hash(*request, &key);
+      if (!status.IsOk()) {
+        LOG_ERROR << "Failed to hash request: " << status.Message();
+        continue;
       }
+      request->SetCacheKey(key);
     }
+    request->ResponseFactory()->CreateResponse(&local_responses[idx]);
+    keys.emplace_back(request->CacheKey());
+    responses.emplace_back(local_responses[idx].get());
+    lookup_indices.emplace_back(idx);
   }
+  if (lookup_indices.empty()) {
+    return;
+  }
+
+  // Lookup and capture timestamps
+  for (const auto idx : lookup_indices) {
+    requests[idx]->CaptureCacheLookupStartNs();
+  }
+  std::vector<Status> statuses;
+  auto status = cache->Lookup(keys, responses, &statuses);
+  for (const auto idx : lookup_indices) {
+    requests[idx]->CaptureCacheLookupEndNs();
+  }
+  if (!status.IsOk()) {
+    LOG_ERROR << "Failed to lookup requests in response cache: "
+              << status.Message();
+    return;
+  }
+
+  for (size_t i = 0; i < lookup_indices.size(); ++i) {
+    const size_t idx = lookup_indices[i];
+    if (statuses[i].IsOk() && (local_responses[idx] != nullptr)) {
+      (*cached_responses)[idx] = std::move(local_responses[idx]);
+#ifdef TRITON_ENABLE_STATS
+      // Update model metrics/stats on cache hits
+      // Backends will update metrics as normal on cache misses
+      requests[idx]->ReportStatisticsCacheHit(reporter_.get());
+#endif  // TRITON_ENABLE_STATS
+    }
+  }
+}
 
-  for (auto& response : responses) {
-    InferenceResponse::Send(std::move(response.first), response.second);
+void
+DynamicBatchScheduler::FinalizeResponses()
+{
+  // Only the thread that set 'finalizing_' may call this function, which
+  // ensures responses are sent in order. Keep releasing the completed
+  // responses in-order as far as possible, responses parked while sending
+  // the previous ones are picked up by the next iteration.
+  while (true) {
+    std::deque<std::pair<std::unique_ptr<InferenceResponse>, const uint32_t>>
+        responses;
+    {
+      std::lock_guard<std::mutex> queue_lock(completion_queue_mtx_);
+      while (!completion_queue_.empty() && !completion_queue_.front().empty()) {
+        bool response_complete = false;
+        for (auto& response_pair : completion_queue_.front()) {
+          // Assuming FINAL flag is set only in the last response of the
+          // request
+          response_complete =
+              ((response_pair.second & TRITONSERVER_RESPONSE_COMPLETE_FINAL) !=
+               0);
+          responses.emplace_back(std::move(response_pair));
+        }
+        if (response_complete) {
+          completion_queue_.pop_front();
+        } else {
+          completion_queue_.front().clear();
+        }
+      }
+      if (responses.empty()) {
+        finalizing_ = false;
+        return;
+      }
+    }
+
+    for (auto& response : responses) {
+      InferenceResponse::Send(std::move(response.first), response.second);
+    }
   }
 }
 
@@ -34,9 +34,14 @@
 #include <queue>
 #include <set>
 #include <thread>
+#include <unordered_map>
 #include "backend_model.h"
 #include "backend_model_instance.h"
+#include "cache_codec.h"
+#include "cache_entry.h"
+#include "instrumented_mutex.h"
 #include "model_config.pb.h"
+#include "mpsc_ring.h"
 #include "rate_limiter.h"
 #include "scheduler.h"
 #include "scheduler_utils.h"
@@ -74,18 +79,41 @@ class DynamicBatchScheduler : public Scheduler {
   // \see Scheduler::Enqueue()
   Status Enqueue(std::unique_ptr<InferenceRequest>& request) override;
 
+  // \see Scheduler::EnqueueBatch()
+  void EnqueueBatch(
+      std::vector<std::unique_ptr<InferenceRequest>>& requests) override;
+
   // \see Scheduler::InflightInferenceCount()
   size_t InflightInferenceCount() override
   {
-    std::unique_lock<std::mutex> lock(mu_);
+    size_t count = 0;
+    for (auto& shard : shards_) {
+      count += shard->InflightInferenceCount();
+    }
+    std::unique_lock<std::mutex> lock = mu_.Acquire();
+    count += queue_.Size() + cache_lookup_window_.size();
+    if (enqueue_ring_ != nullptr) {
+      count += enqueue_ring_->Size();
+    }
     if (curr_payload_ != nullptr) {
-      return queue_.Size() + curr_payload_->RequestCount();
+      count += curr_payload_->RequestCount();
     }
-    return queue_.Size();
+    lock.unlock();
+    std::lock_guard<std::mutex> coalesce_lock(coalesce_mu_);
+    for (const auto& coalesced : coalesced_requests_) {
+      count += coalesced.second.size();
+    }
+    return count;
   }
 
   // \see Scheduler::Stop()
-  void Stop() override { stop_ = true; }
+  void Stop() override
+  {
+    stop_ = true;
+    for (auto& shard : shards_) {
+      shard->Stop();
+    }
+  }
 
   MetricModelReporter* MetricReporter() const { return reporter_.get(); }
 
@@ -101,13 +129,120 @@ class DynamicBatchScheduler : public Scheduler {
       const uint64_t priority_levels,
       const ModelQueuePolicyMap& queue_policy_map);
 
+  // Read the batcher options given as model config parameters.
+  Status InitBatcherParameters();
+  // Return the batcher shard that the next request should be enqueued
+  // to.
+  DynamicBatchScheduler* NextShard();
+  // Enqueue 'request' to the queue of this batcher shard.
+  Status EnqueueToBatcher(std::unique_ptr<InferenceRequest>& request);
+  // Enqueue 'requests' to the queue of this batcher shard under a single
+  // acquisition of 'mu_'. Takes ownership of all 'requests'.
+  void EnqueueBatchToBatcher(
+      std::vector<std::unique_ptr<InferenceRequest>>& requests);
+  // Record the start of the queueing of 'request' in its timestamps.
+  void CaptureEnqueueStartNs(std::unique_ptr<InferenceRequest>& request);
+  // Enqueue 'request' to the window of requests to be looked up in the
+  // response cache by the scheduler thread.
+  Status EnqueueForCacheLookUp(std::unique_ptr<InferenceRequest>& request);
+  // Look up the requests in 'cache_lookup_window_' in the response cache
+  // and move the misses into 'queue_'. 'mu_' must not be held when this
+  // function is called. Requests that can not be enqueued are returned in
+  // 'rejected' along with the error.
+  void CacheLookUpWindow(
+      std::vector<std::pair<std::unique_ptr<InferenceRequest>, Status>>*
+          rejected);
   void BatcherThread(const int nice);
   void NewPayload();
+  // Update 'pending_batch_delay_ns_' from 'delay_controller_' if an
+  // update is due.
+  void UpdateQueueDelay();
+  // Update the batch execution estimate of 'queue_' from the model
+  // statistics if an update is due. 'mu_' must be held when this
+  // function is called.
+  void UpdateExecutionEstimate();
+  // Move the requests of the largest input shape bucket to the front of
+  // the pending batch. 'mu_' must be held and the pending batch must be
+  // empty when this function is called.
+  void SelectShapeBucket();
+  // Move the requests pushed to 'enqueue_ring_' into 'queue_'. 'mu_'
+  // must be held when this function is called. Requests that can not
+  // be enqueued are returned in 'rejected' along with the error.
+  void DrainEnqueueRing(
+      std::vector<std::pair<std::unique_ptr<InferenceRequest>, Status>>*
+          rejected);
+  // Move part of the backlog of a sibling shard into 'queue_'. 'mu_'
+  // must be held when this function is called. Requests that can not
+  // be enqueued are returned in 'rejected' along with the error.
+  void StealRequests(
+      std::vector<std::pair<std::unique_ptr<InferenceRequest>, Status>>*
+          rejected);
   uint64_t GetDynamicBatch();
   void DelegateResponse(std::unique_ptr<InferenceRequest>& request);
   void CacheLookUp(
       std::unique_ptr<InferenceRequest>& request,
       std::unique_ptr<InferenceResponse>& cached_response);
+  // Look up all 'requests' with a single cache call. On return
+  // 'cached_responses' holds the cached response of each request, or
+  // nullptr on a miss.
+  void CacheLookUp(
+      std::vector<std::unique_ptr<InferenceRequest>>& requests,
+      std::vector<std::unique_ptr<InferenceResponse>>* cached_responses);
+  // Look up the response stream of a decoupled 'request'. On return
+  // 'cached_responses' holds the cached responses in order, or is empty
+  // on a miss.
+  void CacheLookUp(
+      std::unique_ptr<InferenceRequest>& request,
+      std::vector<std::unique_ptr<InferenceResponse>>* cached_responses);
+  // Send the response found in cache for 'request' and release the
+  // request.
+  void SendCachedResponse(
+      std::unique_ptr<InferenceRequest>& request,
+      std::unique_ptr<InferenceResponse>& cached_response);
+  // Replay the response stream found in cache for a decoupled 'request',
+  // sending the final flag with the last response, and release the
+  // request.
+  void SendCachedResponses(
+      std::unique_ptr<InferenceRequest>& request,
+      std::vector<std::unique_ptr<InferenceResponse>>& cached_responses);
+  // Hash 'request' into its cache key unless it is already set. Return
+  // false if the request can't be hashed.
+  bool SetCacheKey(std::unique_ptr<InferenceRequest>& request);
+  // The responses of a decoupled request accumulated until the final
+  // flag, when the whole stream is inserted into the cache.
+  struct CacheStream {
+    std::unique_ptr<CacheEntry> entry_;
+    // Set once a response of the stream can't be cached, e.g. an error
+    // response, in which case the stream isn't inserted.
+    bool failed_ = false;
+  };
+  // Add 'response' to 'stream' and insert the stream under 'key' if
+  // 'flags' has the final flag.
+  Status CacheStreamResponse(
+      const std::string& key, CacheStream* stream,
+      InferenceResponse* response, const uint32_t flags);
+  // Return the estimated cost of recomputing a response, passed to the
+  // cache as an eviction hint.
+  uint64_t CacheComputeCostNs();
+  // Attach 'request' to the in-flight request with identical inputs if
+  // there is one, in which case 'coalesced' returns true and the
+  // request has been moved from. Otherwise the request is registered as
+  // the original of its key.
+  void CoalesceRequest(
+      std::unique_ptr<InferenceRequest>& request, bool* coalesced);
+  // Return the key that identifies the requests that can be answered by
+  // the same response as 'request'.
+  static std::string CoalescingKey(const InferenceRequest& request);
+  // Set the response delegator of an original request so that its final
+  // response is also sent to the requests coalesced into it.
+  void DelegateCoalescedResponse(std::unique_ptr<InferenceRequest>& request);
+  // Send a copy of 'response' to the requests coalesced into the original
+  // request with 'key' and release them. The requests are executed on
+  // their own if the response can't be copied.
+  void CompleteCoalescedRequests(
+      const std::string& key, InferenceResponse* response);
+  // Send the responses parked in 'completion_queue_' in order. The
+  // caller must have set 'finalizing_', which is cleared on return.
   void FinalizeResponses();
 
   // Custom batching function calls
@@ -142,9 +277,41 @@ class DynamicBatchScheduler : public Scheduler {
   std::atomic<bool> scheduler_thread_exit_;
 
   // Mutex and condvar for signaling scheduler thread
-  std::mutex mu_;
+  InstrumentedMutex mu_;
   std::condition_variable cv_;
 
+  // If lock-free enqueue is enabled, requests are pushed into
+  // 'enqueue_ring_' without holding 'mu_' and the scheduler thread
+  // moves them into 'queue_' in bulk. nullptr if lock-free enqueue is
+  // disabled.
+  std::unique_ptr<MPSCRing<std::unique_ptr<InferenceRequest>>> enqueue_ring_;
+  // The total batch size pushed into 'enqueue_ring_' since the last
+  // time the ring was drained.
+  std::atomic<size_t> ring_batch_size_;
+  // Whether the scheduler thread is waiting on 'cv_' for new requests,
+  // producers only notify 'cv_' when this is set.
+  std::atomic<bool> batcher_parked_;
+  // The ring batch size at which a producer should wake the parked
+  // scheduler thread, zero to wake on every request.
+  std::atomic<size_t> ring_wake_batch_size_;
+  // Requests pushed to 'enqueue_ring_' with a priority level lower than
+  // this value preempt the pending batch and so always wake the parked
+  // scheduler thread. Zero if there is no pending batch to preempt.
+  std::atomic<uint64_t> ring_preempt_priority_level_;
+
+  // Additional batcher shards of the model, each with its own queue and
+  // scheduler thread. Only set for the model level scheduler, which is
+  // itself the first shard.
+  std::vector<std::unique_ptr<DynamicBatchScheduler>> shards_;
+  // The model level scheduler if this is an additional shard, nullptr
+  // otherwise.
+  DynamicBatchScheduler* root_;
+  // The other shards of the same model that this shard may steal
+  // requests from, empty if the batcher is not sharded.
+  std::vector<DynamicBatchScheduler*> siblings_;
+  // Round-robin counter used for distributing requests to shards.
+  std::atomic<size_t> next_shard_;
+
   std::shared_ptr<RateLimiter> rate_limiter_;
 
   std::shared_ptr<Payload> curr_payload_;
@@ -153,9 +320,16 @@ class DynamicBatchScheduler : public Scheduler {
   size_t max_batch_size_;
   size_t max_preferred_batch_size_;
   std::set<int32_t> preferred_batch_sizes_;
+  // The batch sizes that formed batches are padded to, nullptr if
+  // batches are not padded.
+  std::shared_ptr<const std::set<int32_t>> padded_batch_sizes_;
   uint64_t pending_batch_delay_ns_;
   size_t pending_batch_size_;
 
+  // Controller that adapts 'pending_batch_delay_ns_' to the observed
+  // traffic, nullptr if the queue delay is static.
+  std::unique_ptr<QueueDelayController> delay_controller_;
+
   size_t queued_batch_size_;
   size_t next_preferred_batch_size_;
 
@@ -171,6 +345,29 @@ class DynamicBatchScheduler : public Scheduler {
   // Store information on whether the model contains optional inputs.
   bool has_optional_input_;
 
+  // If true, requests with different input shapes are grouped into buckets
+  // and batches are formed from a single bucket instead of stopping at the
+  // first request with a different shape.
+  bool shape_bucketing_;
+
+  // If true, a request of higher priority than the pending batch causes
+  // the pending batch to be rebuilt and sent without waiting for the
+  // queue delay. 'pending_batch_preempted_' is set when that happens and
+  // cleared once the batch is rebuilt.
+  bool priority_preemption_;
+  bool pending_batch_preempted_;
+
+  // If true, requests that are expected to exceed their timeout before
+  // being executed are rejected on enqueue. The estimate is derived from
+  // the model execution statistics, the last observed counters are kept
+  // to compute the execution time since the previous update.
+  bool deadline_admission_;
+  uint64_t last_estimate_update_ns_;
+  uint64_t estimate_execution_count_;
+  uint64_t estimate_compute_duration_ns_;
+  double batch_exec_ns_;
+  size_t estimate_concurrency_;
+
   // If true the ordering of responses matches the order of requests
   // even when there are multiple scheduler threads.
   const bool preserve_ordering_;
@@ -178,15 +375,41 @@ class DynamicBatchScheduler : public Scheduler {
   // If true, the scheduler will try to retrieve responses from cache.
   bool response_cache_enabled_;
 
+  // If true, the cache lookups are done by the scheduler thread for all
+  // requests in 'cache_lookup_window_' at once instead of on enqueue.
+  bool batched_cache_lookup_;
+  std::vector<std::unique_ptr<InferenceRequest>> cache_lookup_window_;
+
+  // The codec used to compress responses inserted into the cache, and
+  // whether responses are inserted by the cache's background threads.
+  CacheCodec cache_codec_;
+  bool async_cache_insert_;
+
+  // If true, the model is decoupled and the whole response stream of a
+  // request is cached under its key.
+  bool decoupled_;
+
+  // If true, requests with identical inputs to a request that is still
+  // in flight are answered by the response of that request instead of
+  // being executed. Only the model level scheduler tracks the requests.
+  bool request_coalescing_;
+  std::unordered_map<
+      std::string, std::vector<std::unique_ptr<InferenceRequest>>>
+      coalesced_requests_;
+  std::mutex coalesce_mu_;
+
   // Per completion-id queues to store the ready responses
   std::deque<
       std::vector<std::pair<std::unique_ptr<InferenceResponse>, uint32_t>>>
       completion_queue_;
-  // Lock to protect the completion_queues_
+  // Lock to protect the completion_queues_ and 'finalizing_'
   std::mutex completion_queue_mtx_;
 
-  // Preserves the order in which responses are finalized
-  std::mutex finalize_mtx_;
+  // Whether a thread is currently sending responses from
+  // 'completion_queue_'. Only one thread sends at a time, which preserves
+  // the order in which responses are finalized without holding a lock
+  // while sending.
+  bool finalizing_;
 
   // Reporter for metrics, or nullptr if no metrics should be reported
   std::shared_ptr<MetricModelReporter> reporter_;
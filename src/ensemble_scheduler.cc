@@ -28,11 +28,18 @@
 
 #include "ensemble_scheduler.h"
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <mutex>
+#include <thread>
+#include "constants.h"
 #include "cuda_utils.h"
 #include "metrics.h"
 #include "model.h"
 #include "model_config_utils.h"
+#include "profiling.h"
 #include "server.h"
 #include "triton/common/logging.h"
 
@@ -41,9 +48,52 @@ namespace triton { namespace core {
 namespace {
 
 class EnsembleContext;
+struct Step;
+
+}  // namespace
+
+// EnsembleStepBatcher holds the ready steps of the ensemble requests for
+// a short delay so that the requests of the same step are sent to their
+// model as one batched request.
+class EnsembleStepBatcher {
+ public:
+  EnsembleStepBatcher(const uint64_t delay_us, const size_t step_count);
+  ~EnsembleStepBatcher();
+
+  // Add the ready 'step' to the steps waiting to be batched. The step
+  // must have its ensemble context set.
+  void Enqueue(std::unique_ptr<Step>&& step);
+
+ private:
+  struct PendingStep {
+    std::unique_ptr<Step> step_;
+    std::chrono::steady_clock::time_point enqueue_time_;
+  };
+
+  void BatcherThread();
+
+  const std::chrono::microseconds delay_;
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  bool exit_;
+
+  // The steps waiting to be batched and their total batch size, by the
+  // step index.
+  std::vector<std::deque<PendingStep>> pending_;
+  std::vector<size_t> pending_batch_size_;
+
+  std::thread thread_;
+};
+
+namespace {
 
 using IterationCount = size_t;
 
+// The ensemble tensors updated by a step, as pairs of the tensor index
+// and the iteration count of the update
+using UpdatedTensors = std::set<std::pair<size_t, IterationCount>>;
+
 // Request tracker is passed as 'userp' in RequestRelease function and used
 // to manage the lifecycle of the ensemble request
 class RequestTracker {
@@ -123,7 +173,8 @@ struct Step {
       size_t step_idx, const InferenceRequest::SequenceId& correlation_id,
       uint32_t flags)
       : correlation_id_(correlation_id), flags_(flags), response_flags_(0),
-        infer_status_(nullptr), step_idx_(step_idx)
+        infer_status_(nullptr), step_idx_(step_idx), batch_model_(nullptr),
+        ready_ns_(0), dispatch_ns_(0)
   {
   }
 
@@ -139,11 +190,50 @@ struct Step {
   std::unordered_map<
       int64_t, std::unordered_map<uintptr_t, std::shared_ptr<AllocatedMemory>>>
       gpu_output_map_;
-  std::set<std::pair<std::string, IterationCount>> updated_tensors_;
+  UpdatedTensors updated_tensors_;
   uint32_t response_flags_;
   TRITONSERVER_Error* infer_status_;
 
   size_t step_idx_;
+
+  // The model of the step if its request may be batched with the
+  // requests of the same step from other ensemble requests, nullptr if
+  // the request is sent on its own.
+  Model* batch_model_;
+
+  // Timestamps of the step inputs being ready and of the step request
+  // being sent.
+  uint64_t ready_ns_;
+  uint64_t dispatch_ns_;
+};
+
+// BatchedStep is used as 'userp' of the request that batches the
+// requests of the same step from several ensemble requests. It keeps
+// the steps until the batched response is split among them.
+struct BatchedStep {
+  // The step the batched outputs are allocated for, it belongs to the
+  // ensemble context of the first step but is never proceeded.
+  std::unique_ptr<Step> carrier_;
+  std::vector<std::unique_ptr<Step>> steps_;
+  std::vector<size_t> batch_sizes_;
+  size_t batch_size_;
+};
+
+// A slice of a batched step output, which keeps the output buffer alive
+// while the slice is referenced.
+class SlicedMemory : public MutableMemory {
+ public:
+  SlicedMemory(
+      const std::shared_ptr<AllocatedMemory>& buffer, char* base,
+      size_t byte_size, TRITONSERVER_MemoryType memory_type,
+      int64_t memory_type_id)
+      : MutableMemory(base, byte_size, memory_type, memory_type_id),
+        buffer_(buffer)
+  {
+  }
+
+ private:
+  std::shared_ptr<AllocatedMemory> buffer_;
 };
 
 struct TensorData {
@@ -223,8 +313,8 @@ class EnsembleContext {
   EnsembleContext(
       MetricModelReporter* metric_reporter,
       InferenceStatsAggregator* stats_aggregator, InferenceServer* is,
-      EnsembleInfo* info, std::unique_ptr<InferenceRequest>& request,
-      cudaStream_t stream);
+      EnsembleInfo* info, EnsembleStepBatcher* step_batcher,
+      std::unique_ptr<InferenceRequest>& request, cudaStream_t stream);
 
   // Perform transition on 'context' state given the information of
   // 'completed_step'
@@ -232,6 +322,11 @@ class EnsembleContext {
       const std::shared_ptr<EnsembleContext>& context,
       const std::unique_ptr<Step>& completed_step = nullptr);
 
+  // Send the requests of 'steps', which are the same step of different
+  // ensemble requests, to their model as one batched request. Steps
+  // that can't be batched with the first one are sent individually.
+  static void ScheduleBatchedSteps(std::vector<std::unique_ptr<Step>>&& steps);
+
  private:
   static TRITONSERVER_Error* ResponseAlloc(
       TRITONSERVER_ResponseAllocator* allocator, const char* tensor_name,
@@ -253,9 +348,14 @@ class EnsembleContext {
   static void ResponseComplete(
       TRITONSERVER_InferenceResponse* response, const uint32_t flags,
       void* userp);
+  static void BatchedRequestComplete(
+      TRITONSERVER_InferenceRequest* request, const uint32_t flags,
+      void* userp);
+  static void BatchedResponseComplete(
+      TRITONSERVER_InferenceResponse* response, const uint32_t flags,
+      void* userp);
 
   using StepList = std::vector<std::unique_ptr<Step>>;
-  using VersionMap = std::unordered_map<int64_t, std::shared_ptr<Model>>;
 
   // Helper function to reshape the given tensor according to the
   // config shape and batching info and its actual shape and batching info.
@@ -276,39 +376,77 @@ class EnsembleContext {
   static void ScheduleSteps(
       const std::shared_ptr<EnsembleContext>& context, StepList&& steps);
 
+  // Send the request of 'step' for execution. Return false and finish
+  // the ensemble request with the error if the request can't be sent.
+  static bool DispatchStep(
+      const std::shared_ptr<EnsembleContext>& context,
+      std::unique_ptr<Step>& step);
+
+  // Return true if the request of 'step' can be batched with the request
+  // of 'first_step'.
+  static bool CanBatchSteps(
+      const std::unique_ptr<Step>& first_step,
+      const std::unique_ptr<Step>& step);
+
+  // Create in 'request' the request that batches the requests of 'steps'.
+  // The inputs of the batched request reference the input data of the
+  // step requests.
+  static Status BatchStepRequests(
+      const StepList& steps, std::unique_ptr<InferenceRequest>* request);
+
   // Helper function that updates ensemble state given 'completed_step' and
   // returns the list of updated tensors in 'updated_tensors'
   Status UpdateEnsembleState(
       const std::unique_ptr<Step>& completed_step,
-      std::set<std::pair<std::string, IterationCount>>* updated_tensors);
+      UpdatedTensors* updated_tensors);
 
   // Helper function that returns a list of 'steps' that should be run under
   // current ensemble state. 'updated_tensors' is used so that we don't need to
   // iterate all the tensors to determine which step can be run.
-  Status GetNextSteps(
-      const std::set<std::pair<std::string, IterationCount>>& updated_tensors,
-      StepList* steps);
+  Status GetNextSteps(const UpdatedTensors& updated_tensors, StepList* steps);
 
   // Helper function that completes the response of the ensemble request
   Status FinishEnsemble(
       std::unique_ptr<InferenceResponse>&& response = nullptr);
 
+  // Helper function that reports the per-step timing of the completed
+  // ensemble request, with the share of each step on its critical path.
+  void ReportStepStats();
+
+  // Helper function that reports a copy of a tensor between GPUs in the
+  // trace of the ensemble request.
+  void ReportCopyPath(const CopyPath path);
+
   // Helper function that initialize the 'step' given the info at 'step_idx'.
   // The 'step' will have proper request / response provider for the model
   Status InitStep(
       const size_t step_idx, const IterationCount iteration_count,
       std::unique_ptr<Step>* step);
 
+  // Helper function that sends the outputs in 'response' of the streaming
+  // 'step' as a response of the ensemble request, with only the output
+  // names mapped to the ensemble output names.
+  Status StreamStepResponse(
+      const std::unique_ptr<Step>& step,
+      TRITONSERVER_InferenceResponse* response);
+
   // Helper function that set the output of the ensemble request if it is ready
   // and valid.
   Status CheckAndSetEnsembleOutput(
-      const std::set<std::pair<std::string, IterationCount>>& updated_tensors,
+      const UpdatedTensors& updated_tensors,
       std::unique_ptr<InferenceResponse>* response);
 
   InferenceServer* is_;
 
   EnsembleInfo* info_;
 
+  // The stats aggregator of the ensemble model.
+  InferenceStatsAggregator* stats_aggregator_;
+
+  // The batcher to send the batchable steps to, nullptr if the steps are
+  // always sent individually.
+  EnsembleStepBatcher* step_batcher_;
+
   // All EnsembleContext will use the same CUDA stream managed by
   // the ensemble scheduler
   cudaStream_t stream_;
@@ -320,14 +458,17 @@ class EnsembleContext {
   size_t inflight_step_counter_;
 
   // pointer that either points to 'pruned_tensor_to_step_' or to
-  // 'info_->tensor_to_step_' if all ensemble outputs are requested
-  std::unordered_map<std::string, std::set<size_t>>* tensor_to_step_;
+  // 'info_->tensor_consumers_' if all ensemble outputs are requested
+  const std::vector<std::vector<size_t>>* tensor_to_step_;
 
-  std::unordered_map<std::string, std::set<size_t>> pruned_tensor_to_step_;
-  std::unordered_map<std::string, TensorData> tensor_data_;
+  std::vector<std::vector<size_t>> pruned_tensor_to_step_;
+  // The data of the ensemble tensors, by tensor index
+  std::vector<TensorData> tensor_data_;
+  // The tensors of the requested ensemble outputs
+  std::vector<size_t> requested_output_tensors_;
 
-  // Handle to all models that may be used in the ensemble
-  std::unordered_map<ModelIdentifier, VersionMap> handles_;
+  // Handle to the model of each step, by the step index
+  std::vector<std::shared_ptr<Model>> step_models_;
 
   // Request specific information that obtained from ensemble request and
   // should be applied to all internal requests
@@ -341,6 +482,24 @@ class EnsembleContext {
   Status ensemble_status_;
   RequestTracker* request_tracker_;
 
+  // The timing of the completed executions of each step, by the step
+  // index, and the time the ensemble request computation started.
+  struct StepTiming {
+    StepTiming()
+        : execution_count_(0), wait_duration_ns_(0),
+          execution_duration_ns_(0), ready_ns_(0), complete_ns_(0)
+    {
+    }
+    uint64_t execution_count_;
+    uint64_t wait_duration_ns_;
+    uint64_t execution_duration_ns_;
+    // Of the last execution
+    uint64_t ready_ns_;
+    uint64_t complete_ns_;
+  };
+  std::vector<StepTiming> step_timings_;
+  uint64_t compute_start_ns_;
+
   // The allocator that will be used to allocate buffers for the
   // inference result tensors.
   std::unique_ptr<
@@ -352,13 +511,16 @@ class EnsembleContext {
 EnsembleContext::EnsembleContext(
     MetricModelReporter* metric_reporter,
     InferenceStatsAggregator* stats_aggregator, InferenceServer* is,
-    EnsembleInfo* info, std::unique_ptr<InferenceRequest>& request,
-    cudaStream_t stream)
-    : is_(is), info_(info), stream_(stream), inflight_step_counter_(0),
+    EnsembleInfo* info, EnsembleStepBatcher* step_batcher,
+    std::unique_ptr<InferenceRequest>& request, cudaStream_t stream)
+    : is_(is), info_(info), stats_aggregator_(stats_aggregator),
+      step_batcher_(step_batcher), stream_(stream), inflight_step_counter_(0),
+      step_timings_(info->steps_.size()),
       allocator_(nullptr, TRITONSERVER_ResponseAllocatorDelete)
 {
   uint64_t compute_start_ns = 0;
   INFER_STATS_SET_TIMESTAMP(compute_start_ns);
+  compute_start_ns_ = compute_start_ns;
   request_tracker_ = new RequestTracker(
       std::move(request), compute_start_ns, metric_reporter, stats_aggregator);
 
@@ -367,78 +529,95 @@ EnsembleContext::EnsembleContext(
   // Obtain model handles of all models in ensemble request such that
   // they have the same lifetime as the ensemble request to avoid unloading
   // while the ensemble is executing.
-  for (const auto& step_info : info_->steps_) {
-    auto it = handles_.find(step_info.model_id_);
-    if (it == handles_.end()) {
-      it = handles_.emplace(std::make_pair(step_info.model_id_, VersionMap()))
-               .first;
-    }
-    auto ver_it = it->second.find(step_info.model_version_);
-    if (ver_it == it->second.end()) {
-      std::shared_ptr<Model> model = nullptr;
+  step_models_.reserve(info_->steps_.size());
+  for (size_t step_idx = 0; step_idx < info_->steps_.size(); ++step_idx) {
+    const auto& step_info = info_->steps_[step_idx];
+    std::shared_ptr<Model> model = nullptr;
+    for (size_t prev_idx = 0; prev_idx < step_idx; ++prev_idx) {
+      const auto& prev_info = info_->steps_[prev_idx];
+      if ((prev_info.model_id_ == step_info.model_id_) &&
+          (prev_info.model_version_ == step_info.model_version_)) {
+        model = step_models_[prev_idx];
+        break;
+      }
+    }
+    if (model == nullptr) {
       ensemble_status_ =
           is_->GetModel(step_info.model_id_, step_info.model_version_, &model);
       if (!ensemble_status_.IsOk()) {
         break;
       }
-
-      it->second.emplace(std::make_pair(step_info.model_version_, model));
     }
+    step_models_.emplace_back(std::move(model));
   }
 
-  // Prune ensemble first if not all outputs are requested
-  std::set<std::string> ignored_tensor;
-  for (const auto& ensemble_output : info_->ensemble_output_shape_) {
-    ignored_tensor.insert(ensemble_output.first);
-  }
-  for (const auto& requested_output : lrequest->ImmutableRequestedOutputs()) {
-    ignored_tensor.erase(requested_output);
+  // Find the tensors of the requested outputs, the ensemble is pruned
+  // first if not all outputs are requested
+  const auto& requested_outputs = lrequest->ImmutableRequestedOutputs();
+  std::vector<size_t> ignored_tensors;
+  for (size_t tensor_idx = 0; tensor_idx < info_->tensor_names_.size();
+       ++tensor_idx) {
+    if (info_->tensor_output_shapes_[tensor_idx] == nullptr) {
+      continue;
+    }
+    if (requested_outputs.find(info_->tensor_names_[tensor_idx]) ==
+        requested_outputs.end()) {
+      ignored_tensors.push_back(tensor_idx);
+    } else {
+      requested_output_tensors_.push_back(tensor_idx);
+    }
   }
-  if (ignored_tensor.empty()) {
-    tensor_to_step_ = &(info_->tensor_to_step_);
+  if (ignored_tensors.empty()) {
+    tensor_to_step_ = &(info_->tensor_consumers_);
   } else {
-    pruned_tensor_to_step_ = info_->tensor_to_step_;
+    pruned_tensor_to_step_ = info_->tensor_consumers_;
     tensor_to_step_ = &pruned_tensor_to_step_;
     // Backward traversal
-    std::unordered_map<size_t, size_t> step_requested_output_count;
-    while (!ignored_tensor.empty()) {
-      std::set<std::string> new_ignored_tensor;
-      for (const auto& output : ignored_tensor) {
-        auto step_idx = info_->tensor_to_prev_step_[output];
-        auto& step = info_->steps_[step_idx];
-        auto it = step_requested_output_count.find(step_idx);
-        if (it == step_requested_output_count.end()) {
-          auto output_count = step.output_to_tensor_.size();
-          it =
-              step_requested_output_count.emplace(step_idx, output_count).first;
+    std::vector<size_t> step_requested_output_count(info_->steps_.size());
+    for (size_t step_idx = 0; step_idx < info_->steps_.size(); ++step_idx) {
+      step_requested_output_count[step_idx] =
+          info_->steps_[step_idx].output_tensors_.size();
+    }
+    while (!ignored_tensors.empty()) {
+      std::vector<size_t> new_ignored_tensors;
+      for (const auto output : ignored_tensors) {
+        const auto step_idx = info_->tensor_producers_[output];
+        // Ensemble inputs have no step to prune
+        if (step_idx == info_->steps_.size()) {
+          continue;
         }
         // If none of the outputs of the step is requested,
         // then the step can be pruned
-        if (--it->second == 0) {
-          for (const auto& input : step.input_to_tensor_) {
-            auto& step_set = pruned_tensor_to_step_[input.second];
-            step_set.erase(step_idx);
+        if (--step_requested_output_count[step_idx] == 0) {
+          for (const auto& input : info_->steps_[step_idx].input_tensors_) {
+            auto& steps = pruned_tensor_to_step_[input.second];
+            steps.erase(
+                std::remove(steps.begin(), steps.end(), step_idx),
+                steps.end());
             // If all steps depend on a tensor are pruned,
             // then the tensor can be ignored.
-            if (step_set.empty()) {
-              new_ignored_tensor.insert(input.second);
+            if (steps.empty()) {
+              new_ignored_tensors.push_back(input.second);
             }
           }
         }
       }
-      ignored_tensor.swap(new_ignored_tensor);
+      ignored_tensors.swap(new_ignored_tensors);
     }
   }
 
-  for (const auto& pair : *tensor_to_step_) {
-    const auto& requested_outputs = lrequest->ImmutableRequestedOutputs();
+  tensor_data_.reserve(tensor_to_step_->size());
+  for (size_t tensor_idx = 0; tensor_idx < tensor_to_step_->size();
+       ++tensor_idx) {
     // For requested outputs, add 1 to outgoing count as the ensemble itself
     // isn't counted as step.
-    if (requested_outputs.find(pair.first) != requested_outputs.end()) {
-      tensor_data_.emplace(pair.first, TensorData(pair.second.size() + 1));
-    } else {
-      tensor_data_.emplace(pair.first, TensorData(pair.second.size()));
+    size_t outgoing_steps_count = (*tensor_to_step_)[tensor_idx].size();
+    if (std::find(
+            requested_output_tensors_.begin(), requested_output_tensors_.end(),
+            tensor_idx) != requested_output_tensors_.end()) {
+      outgoing_steps_count++;
     }
+    tensor_data_.emplace_back(outgoing_steps_count);
   }
 
   if (ensemble_status_.IsOk()) {
@@ -450,9 +629,9 @@ EnsembleContext::EnsembleContext(
 
     for (const auto& pr : lrequest->ImmutableInputs()) {
       const InferenceRequest::Input* input = pr.second;
-      auto it = tensor_data_.find(input->Name());
-      if (it != tensor_data_.end()) {
-        auto& tensor_data = it->second;
+      auto it = info_->tensor_index_.find(input->Name());
+      if (it != info_->tensor_index_.end()) {
+        auto& tensor_data = tensor_data_[it->second];
         // Shape() represents reshaped value without batch dimension,
         // thus need to fill it if necessary.
         std::unique_ptr<InferenceRequest::Input> tensor;
@@ -482,11 +661,11 @@ EnsembleContext::EnsembleContext(
 
     // Iterate the ensemble optional inputs and add empty tensor data entry
     // if the input is not provided
-    for (const auto& name : info_->optional_inputs_) {
-      auto it = tensor_data_.find(name);
-      if ((it != tensor_data_.end()) && it->second.tensor_.empty()) {
-        it->second.AddTensor(nullptr);
-        it->second.batch_size_ = lrequest->BatchSize();
+    for (const auto tensor_idx : info_->optional_input_tensors_) {
+      auto& tensor_data = tensor_data_[tensor_idx];
+      if (tensor_data.tensor_.empty()) {
+        tensor_data.AddTensor(nullptr);
+        tensor_data.batch_size_ = lrequest->BatchSize();
       }
     }
   }
@@ -519,6 +698,17 @@ EnsembleContext::ResponseAlloc(
   *buffer = nullptr;
   *buffer_userp = nullptr;
 
+  // Allocate the output where its consumers run if it has been placed,
+  // the step model then copies the output there directly.
+  auto step = reinterpret_cast<Step*>(userp);
+  const auto& output_placement =
+      step->ctx_->info_->steps_[step->step_idx_].output_placement_;
+  auto placement_it = output_placement.find(tensor_name);
+  if (placement_it != output_placement.end()) {
+    preferred_memory_type = placement_it->second.first;
+    preferred_memory_type_id = placement_it->second.second;
+  }
+
   auto allocated_buffer = std::make_shared<AllocatedMemory>(
       byte_size, preferred_memory_type, preferred_memory_type_id);
 
@@ -527,7 +717,6 @@ EnsembleContext::ResponseAlloc(
   if ((mutable_buffer != nullptr) || (byte_size == 0)) {
     if (byte_size != 0) {
       *buffer = static_cast<void*>(mutable_buffer);
-      auto step = reinterpret_cast<Step*>(userp);
       std::lock_guard<std::mutex> lk(step->output_mtx_);
       if (*allocated_memory_type == TRITONSERVER_MEMORY_GPU) {
         step->gpu_output_map_[*allocated_memory_type_id].emplace(
@@ -592,6 +781,31 @@ EnsembleContext::ResponseComplete(
   auto step_ptr = std::unique_ptr<Step>(reinterpret_cast<Step*>(userp));
   step_ptr->response_flags_ = flags;
 
+  // The responses of the streaming step bypass the ensemble state, the
+  // step is only proceeded to track its completion.
+  const auto info = step_ptr->ctx_->info_;
+  if ((response != nullptr) && info->stream_final_step_ &&
+      (step_ptr->step_idx_ == info->stream_step_idx_)) {
+    auto err = TRITONSERVER_InferenceResponseError(response);
+    if (err == nullptr) {
+      auto& context = step_ptr->ctx_;
+      std::lock_guard<std::mutex> lock(context->mutex_);
+      if (context->ensemble_status_.IsOk()) {
+        Status status = context->StreamStepResponse(step_ptr, response);
+        if (!status.IsOk()) {
+          err = TRITONSERVER_ErrorNew(
+              StatusCodeToTritonCode(status.StatusCode()),
+              status.Message().c_str());
+        }
+      }
+    }
+    step_ptr->infer_status_ = err;
+    LOG_TRITONSERVER_ERROR(
+        TRITONSERVER_InferenceResponseDelete(response),
+        "deleting inference response");
+    response = nullptr;
+  }
+
   if (response != nullptr) {
     auto err = TRITONSERVER_InferenceResponseError(response);
     uint32_t count;
@@ -659,10 +873,13 @@ EnsembleContext::ResponseComplete(
     if (err == nullptr) {
       err = TRITONSERVER_InferenceResponseOutputCount(response, &count);
       if (err == nullptr) {
-        std::lock_guard<std::mutex> lock(step_ptr->ctx_->mutex_);
-        auto& output_to_tensor =
-            step_ptr->ctx_->info_->steps_[step_ptr->step_idx_]
-                .output_to_tensor_;
+        // The output tensors reference the step output buffers and are
+        // created without holding the context lock, which is only needed
+        // to make them visible to the downstream steps.
+        const auto& output_tensors =
+            info->steps_[step_ptr->step_idx_].output_tensors_;
+        std::vector<std::pair<size_t, std::unique_ptr<InferenceRequest::Input>>>
+            tensors;
         for (uint32_t idx = 0; idx < count; idx++) {
           const char* name;
           TRITONSERVER_DataType datatype;
@@ -677,12 +894,12 @@ EnsembleContext::ResponseComplete(
               response, idx, &name, &datatype, &shape, &dim_count, &base,
               &byte_size, &memory_type, &memory_type_id, &userp);
           if (err == nullptr) {
-            auto it = output_to_tensor.find(name);
-            if (it != output_to_tensor.end()) {
+            auto it = output_tensors.find(name);
+            if (it != output_tensors.end()) {
               std::unique_ptr<InferenceRequest::Input> tensor(
                   new InferenceRequest::Input(
-                      it->second, TritonToDataType(datatype), shape,
-                      dim_count));
+                      info->tensor_names_[it->second],
+                      TritonToDataType(datatype), shape, dim_count));
 
               if (byte_size != 0) {
                 std::lock_guard<std::mutex> output_lk(step_ptr->output_mtx_);
@@ -701,18 +918,7 @@ EnsembleContext::ResponseComplete(
                 }
               }
 
-              auto& tensor_data = step_ptr->ctx_->tensor_data_[it->second];
-              if (parameter_override) {
-                step_ptr->updated_tensors_.emplace(
-                    it->second, tensor_data.AddTensor(
-                                    std::move(tensor), correlation_id, flags));
-              } else {
-                step_ptr->updated_tensors_.emplace(
-                    it->second,
-                    tensor_data.AddTensor(
-                        std::move(tensor), step_ptr->correlation_id_,
-                        step_ptr->flags_));
-              }
+              tensors.emplace_back(it->second, std::move(tensor));
             } else {
               LOG_VERBOSE(1)
                   << "in ensemble, an internal response header specified "
@@ -724,6 +930,22 @@ EnsembleContext::ResponseComplete(
             break;
           }
         }
+
+        std::lock_guard<std::mutex> lock(step_ptr->ctx_->mutex_);
+        for (auto& tensor : tensors) {
+          auto& tensor_data = step_ptr->ctx_->tensor_data_[tensor.first];
+          if (parameter_override) {
+            step_ptr->updated_tensors_.emplace(
+                tensor.first, tensor_data.AddTensor(
+                                  std::move(tensor.second), correlation_id,
+                                  flags));
+          } else {
+            step_ptr->updated_tensors_.emplace(
+                tensor.first, tensor_data.AddTensor(
+                                  std::move(tensor.second),
+                                  step_ptr->correlation_id_, step_ptr->flags_));
+          }
+        }
       }
     }
 
@@ -742,6 +964,157 @@ EnsembleContext::ResponseComplete(
   }
 }
 
+void
+EnsembleContext::BatchedRequestComplete(
+    TRITONSERVER_InferenceRequest* request, const uint32_t flags, void* userp)
+{
+  if ((flags & TRITONSERVER_REQUEST_RELEASE_ALL) != 0) {
+    LOG_TRITONSERVER_ERROR(
+        TRITONSERVER_InferenceRequestDelete(request),
+        "deleting batched ensemble inference request");
+    auto step_requests =
+        reinterpret_cast<std::vector<std::unique_ptr<InferenceRequest>>*>(
+            userp);
+    for (auto& step_request : *step_requests) {
+      InferenceRequest::Release(
+          std::move(step_request), TRITONSERVER_REQUEST_RELEASE_ALL);
+    }
+    delete step_requests;
+  }
+}
+
+void
+EnsembleContext::BatchedResponseComplete(
+    TRITONSERVER_InferenceResponse* response, const uint32_t flags, void* userp)
+{
+  auto batched_step =
+      std::unique_ptr<BatchedStep>(reinterpret_cast<BatchedStep*>(userp));
+  auto& carrier = batched_step->carrier_;
+  auto& steps = batched_step->steps_;
+
+  // Split each output along the batch dimension, the slices reference
+  // the batched output buffer.
+  TRITONSERVER_Error* err = nullptr;
+  std::vector<
+      std::vector<std::pair<size_t, std::unique_ptr<InferenceRequest::Input>>>>
+      step_tensors(steps.size());
+  if (response != nullptr) {
+    err = TRITONSERVER_InferenceResponseError(response);
+    uint32_t count;
+    if (err == nullptr) {
+      err = TRITONSERVER_InferenceResponseOutputCount(response, &count);
+    }
+    if (err == nullptr) {
+      const auto info = carrier->ctx_->info_;
+      const auto& output_tensors =
+          info->steps_[carrier->step_idx_].output_tensors_;
+      for (uint32_t idx = 0; idx < count; idx++) {
+        const char* name;
+        TRITONSERVER_DataType datatype;
+        const int64_t* shape;
+        uint64_t dim_count;
+        const void* base;
+        size_t byte_size;
+        TRITONSERVER_MemoryType memory_type;
+        int64_t memory_type_id;
+        void* userp;
+        err = TRITONSERVER_InferenceResponseOutput(
+            response, idx, &name, &datatype, &shape, &dim_count, &base,
+            &byte_size, &memory_type, &memory_type_id, &userp);
+        if (err != nullptr) {
+          break;
+        }
+        auto it = output_tensors.find(name);
+        if (it == output_tensors.end()) {
+          LOG_VERBOSE(1) << "in ensemble, an internal response header "
+                            "specified output '"
+                         << name << "' that does not map to any ensemble "
+                                    "tensors";
+          continue;
+        }
+        if ((dim_count == 0) ||
+            (shape[0] != (int64_t)batched_step->batch_size_)) {
+          err = TRITONSERVER_ErrorNew(
+              TRITONSERVER_ERROR_INTERNAL,
+              (std::string("unexpected batch size for output '") + name +
+               "' of batched ensemble step")
+                  .c_str());
+          break;
+        }
+
+        std::shared_ptr<AllocatedMemory> buffer;
+        if (byte_size != 0) {
+          std::lock_guard<std::mutex> output_lk(carrier->output_mtx_);
+          auto& output_map = (memory_type == TRITONSERVER_MEMORY_GPU)
+                                 ? carrier->gpu_output_map_[memory_type_id]
+                                 : carrier->cpu_output_map_;
+          auto buffer_it =
+              output_map.find(reinterpret_cast<uintptr_t>(base));
+          if (buffer_it != output_map.end()) {
+            buffer = std::move(buffer_it->second);
+            output_map.erase(buffer_it);
+          }
+        }
+        if ((byte_size != 0) && (buffer == nullptr)) {
+          err = TRITONSERVER_ErrorNew(
+              TRITONSERVER_ERROR_INTERNAL,
+              (std::string("output '") + name +
+               "' of batched ensemble step was not allocated by the "
+               "ensemble")
+                  .c_str());
+          break;
+        }
+
+        std::vector<int64_t> step_shape(shape, shape + dim_count);
+        const size_t element_byte_size = byte_size / batched_step->batch_size_;
+        size_t offset = 0;
+        for (size_t sidx = 0; sidx < steps.size(); ++sidx) {
+          step_shape[0] = batched_step->batch_sizes_[sidx];
+          std::unique_ptr<InferenceRequest::Input> tensor(
+              new InferenceRequest::Input(
+                  info->tensor_names_[it->second], TritonToDataType(datatype),
+                  step_shape));
+          if (byte_size != 0) {
+            const size_t step_byte_size =
+                element_byte_size * batched_step->batch_sizes_[sidx];
+            tensor->SetData(std::make_shared<SlicedMemory>(
+                buffer, (char*)base + offset, step_byte_size, memory_type,
+                memory_type_id));
+            offset += step_byte_size;
+          }
+          step_tensors[sidx].emplace_back(it->second, std::move(tensor));
+        }
+      }
+    }
+    LOG_TRITONSERVER_ERROR(
+        TRITONSERVER_InferenceResponseDelete(response),
+        "deleting inference response");
+  }
+
+  for (size_t sidx = 0; sidx < steps.size(); ++sidx) {
+    auto& step = steps[sidx];
+    step->response_flags_ = flags;
+    if (err != nullptr) {
+      step->infer_status_ = TRITONSERVER_ErrorNew(
+          TRITONSERVER_ErrorCode(err), TRITONSERVER_ErrorMessage(err));
+    } else {
+      std::lock_guard<std::mutex> lock(step->ctx_->mutex_);
+      for (auto& tensor : step_tensors[sidx]) {
+        auto& tensor_data = step->ctx_->tensor_data_[tensor.first];
+        step->updated_tensors_.emplace(
+            tensor.first,
+            tensor_data.AddTensor(
+                std::move(tensor.second), step->correlation_id_,
+                step->flags_));
+      }
+    }
+    EnsembleContext::Proceed(step->ctx_, step);
+  }
+  if (err != nullptr) {
+    TRITONSERVER_ErrorDelete(err);
+  }
+}
+
 void
 EnsembleContext::Proceed(
     const std::shared_ptr<EnsembleContext>& context,
@@ -768,8 +1141,14 @@ EnsembleContext::PrepareSteps(
 
     if (ensemble_status_.IsOk()) {
       StepList res;
-      std::set<std::pair<std::string, IterationCount>> updated_tensors;
+      UpdatedTensors updated_tensors;
       ensemble_status_ = UpdateEnsembleState(completed_step, &updated_tensors);
+      // Don't schedule the remaining steps of a cancelled ensemble
+      if (ensemble_status_.IsOk() &&
+          request_tracker_->Request()->IsCancelled()) {
+        ensemble_status_ =
+            Status(Status::Code::UNAVAILABLE, "Request cancelled");
+      }
       if (ensemble_status_.IsOk()) {
         ensemble_status_ = GetNextSteps(updated_tensors, ready_steps);
       }
@@ -792,19 +1171,30 @@ EnsembleContext::PrepareSteps(
 Status
 EnsembleContext::UpdateEnsembleState(
     const std::unique_ptr<Step>& completed_step,
-    std::set<std::pair<std::string, IterationCount>>* updated_tensors)
+    UpdatedTensors* updated_tensors)
 {
   updated_tensors->clear();
   if (completed_step == nullptr) {
-    for (const auto& tensor_data : tensor_data_) {
-      if (!tensor_data.second.tensor_.empty()) {
-        updated_tensors->emplace(tensor_data.first, 0);
+    for (size_t tensor_idx = 0; tensor_idx < tensor_data_.size();
+         ++tensor_idx) {
+      if (!tensor_data_[tensor_idx].tensor_.empty()) {
+        updated_tensors->emplace(tensor_idx, 0);
       }
     }
   } else {
     if (completed_step->response_flags_ &
         TRITONSERVER_RESPONSE_COMPLETE_FINAL) {
       inflight_step_counter_--;
+#ifdef TRITON_ENABLE_STATS
+      auto& timing = step_timings_[completed_step->step_idx_];
+      INFER_STATS_SET_TIMESTAMP(timing.complete_ns_);
+      timing.execution_count_++;
+      timing.wait_duration_ns_ +=
+          completed_step->dispatch_ns_ - completed_step->ready_ns_;
+      timing.execution_duration_ns_ +=
+          timing.complete_ns_ - completed_step->dispatch_ns_;
+      timing.ready_ns_ = completed_step->ready_ns_;
+#endif  // TRITON_ENABLE_STATS
     }
     RETURN_IF_TRITONSERVER_ERROR(completed_step->infer_status_);
     updated_tensors->swap(completed_step->updated_tensors_);
@@ -814,8 +1204,7 @@ EnsembleContext::UpdateEnsembleState(
 
 Status
 EnsembleContext::GetNextSteps(
-    const std::set<std::pair<std::string, IterationCount>>& updated_tensors,
-    StepList* steps)
+    const UpdatedTensors& updated_tensors, StepList* steps)
 {
   steps->clear();
 
@@ -825,7 +1214,7 @@ EnsembleContext::GetNextSteps(
     const auto& step_idx = (*tensor_to_step_)[updated_tensor.first];
     for (const auto& idx : step_idx) {
       bool ready = true;
-      for (const auto& input_pair : info_->steps_[idx].input_to_tensor_) {
+      for (const auto& input_pair : info_->steps_[idx].input_tensors_) {
         auto& tensor = tensor_data_[input_pair.second].tensor_;
         if (tensor.empty()) {
           ready = false;
@@ -860,13 +1249,13 @@ EnsembleContext::InitStep(
     std::unique_ptr<Step>* step)
 {
   const auto& istep = info_->steps_[step_idx];
-  auto& version_map = handles_[istep.model_id_];
-  auto& model = version_map[istep.model_version_];
+  auto& model = step_models_[step_idx];
 
   const bool allow_batching = (model->Config().max_batch_size() > 0);
 
   auto irequest = std::unique_ptr<InferenceRequest>(
       new InferenceRequest(model, istep.model_version_));
+  irequest->SetEnsembleStep(true);
 
   // Store the pointers to tensors used so that we can prune them afterward.
   // Can't prune the tensor in the input loop below as it may be used by
@@ -878,7 +1267,8 @@ EnsembleContext::InitStep(
   auto correlation_id = correlation_id_;
   auto flags = flags_;
   bool parameter_set = false;
-  for (const auto& pair : istep.input_to_tensor_) {
+  bool host_policy_set = false;
+  for (const auto& pair : istep.input_tensors_) {
     auto& tensor_data = tensor_data_[pair.second];
     auto& tensor = tensor_data.tensor_[iteration_count];
 
@@ -902,6 +1292,7 @@ EnsembleContext::InitStep(
       for (const auto& host_policy_data : tensor.data_->HostPolicyData()) {
         RETURN_IF_ERROR(
             input->SetData(host_policy_data.first, host_policy_data.second));
+        host_policy_set = true;
       }
     }
 
@@ -930,17 +1321,42 @@ EnsembleContext::InitStep(
   }
 
   // Set requested outputs in request header
-  for (const auto& pair : istep.output_to_tensor_) {
+  for (const auto& pair : istep.output_tensors_) {
     irequest->AddOriginalRequestedOutput(pair.first);
   }
 
   step->reset(new Step(step_idx, correlation_id, flags));
+  INFER_STATS_SET_TIMESTAMP((*step)->ready_ns_);
+
+  // A step may be batched with the same step of other ensemble requests
+  // if its model returns exactly one response with batch-major outputs
+  // of a fixed size per batch element, and doesn't keep per request
+  // state.
+  if ((step_batcher_ != nullptr) && allow_batching && (flags == 0) &&
+      !host_policy_set &&
+      !model->Config().model_transaction_policy().decoupled() &&
+      !model->Config().has_sequence_batching() &&
+      !model->Config().response_cache().enable()) {
+    bool fixed_size_outputs = true;
+    for (const auto& output : model->Config().output()) {
+      if (output.data_type() == inference::DataType::TYPE_STRING) {
+        fixed_size_outputs = false;
+        break;
+      }
+    }
+    if (fixed_size_outputs) {
+      (*step)->batch_model_ = model.get();
+    }
+  }
 
   irequest->SetId(request_id_);
   irequest->SetCorrelationId(correlation_id);
   irequest->SetFlags(flags);
   irequest->SetPriority(priority_);
   irequest->SetTimeoutMicroseconds(timeout_);
+  // The ensemble request is released only after all its step requests,
+  // so a step follows the cancellation of the ensemble request.
+  irequest->FollowCancellation(*request_tracker_->Request());
 #ifdef TRITON_ENABLE_STATS
   irequest->SetSecondaryStatsAggregator(
       &request_tracker_->ContextStatsAggregator());
@@ -964,7 +1380,7 @@ EnsembleContext::InitStep(
 
   // Record the batch size of output in advance as
   // there is no other way to access it later on.
-  for (const auto& pair : istep.output_to_tensor_) {
+  for (const auto& pair : istep.output_tensors_) {
     auto& output_data_ = tensor_data_[pair.second];
     output_data_.batch_size_ = irequest->BatchSize();
   }
@@ -1058,6 +1474,11 @@ EnsembleContext::FinishEnsemble(std::unique_ptr<InferenceResponse>&& response)
 
   // Reach here when the ensemble execution comes to the end, 'ensemble_status_'
   // at this point is representative.
+#ifdef TRITON_ENABLE_STATS
+  if (ensemble_status_.IsOk()) {
+    ReportStepStats();
+  }
+#endif  // TRITON_ENABLE_STATS
   request_tracker_->SetStatus(ensemble_status_);
   if (request_tracker_->DecrementCounter()) {
     delete request_tracker_;
@@ -1066,9 +1487,178 @@ EnsembleContext::FinishEnsemble(std::unique_ptr<InferenceResponse>&& response)
   return ensemble_status_;
 }
 
+Status
+EnsembleContext::StreamStepResponse(
+    const std::unique_ptr<Step>& step, TRITONSERVER_InferenceResponse* response)
+{
+  uint32_t count;
+  RETURN_IF_TRITONSERVER_ERROR(
+      TRITONSERVER_InferenceResponseOutputCount(response, &count));
+  // A response that only completes the step has nothing to forward
+  if (count == 0) {
+    return Status::Success;
+  }
+
+  auto& lrequest = request_tracker_->Request();
+  const auto& output_tensors = info_->steps_[step->step_idx_].output_tensors_;
+
+  std::unique_ptr<InferenceResponse> ensemble_response;
+  RETURN_IF_ERROR(
+      lrequest->ResponseFactory()->CreateResponse(&ensemble_response));
+
+  bool cuda_async_copy = false;
+  for (uint32_t idx = 0; idx < count; idx++) {
+    const char* name;
+    TRITONSERVER_DataType datatype;
+    const int64_t* shape;
+    uint64_t dim_count;
+    const void* base;
+    size_t byte_size;
+    TRITONSERVER_MemoryType src_memory_type;
+    int64_t src_memory_type_id;
+    void* userp;
+    RETURN_IF_TRITONSERVER_ERROR(TRITONSERVER_InferenceResponseOutput(
+        response, idx, &name, &datatype, &shape, &dim_count, &base,
+        &byte_size, &src_memory_type, &src_memory_type_id, &userp));
+    auto it = output_tensors.find(name);
+    if ((it == output_tensors.end()) ||
+        (std::find(
+             requested_output_tensors_.begin(),
+             requested_output_tensors_.end(),
+             it->second) == requested_output_tensors_.end())) {
+      continue;
+    }
+    const auto& output_name = info_->tensor_names_[it->second];
+
+    auto output_shape = ReshapeTensorDims(
+        *info_->tensor_output_shapes_[it->second], (lrequest->BatchSize() != 0),
+        tensor_data_[it->second].batch_size_,
+        std::vector<int64_t>(shape, shape + dim_count));
+
+    InferenceResponse::Output* output;
+    RETURN_IF_ERROR(ensemble_response->AddOutput(
+        output_name, TritonToDataType(datatype), output_shape, &output));
+
+    // Use the memory type of the step output as preferred memory type
+    TRITONSERVER_MemoryType dst_memory_type = src_memory_type;
+    int64_t dst_memory_type_id = src_memory_type_id;
+    void* buffer;
+    RETURN_IF_ERROR(output->AllocateDataBuffer(
+        &buffer, byte_size, &dst_memory_type, &dst_memory_type_id));
+    if (byte_size == 0) {
+      continue;
+    } else if (buffer == nullptr) {
+      return Status(
+          Status::Code::INTERNAL,
+          "failed to allocate buffer for output '" + output_name + "'");
+    }
+
+    bool cuda_used = false;
+    CopyPath copy_path;
+    RETURN_IF_ERROR(CopyBuffer(
+        output_name, src_memory_type, src_memory_type_id, dst_memory_type,
+        dst_memory_type_id, byte_size, base, buffer, stream_, &cuda_used,
+        false /* copy_on_stream */, &copy_path));
+    cuda_async_copy |= cuda_used;
+    ReportCopyPath(copy_path);
+  }
+
+  if (cuda_async_copy) {
+#ifdef TRITON_ENABLE_GPU
+    cudaStreamSynchronize(stream_);
+#else
+    return Status(
+        Status::Code::INTERNAL,
+        "unexpected CUDA copy flag set while GPU is not supported");
+#endif  // TRITON_ENABLE_GPU
+  }
+
+  InferenceResponse::Send(std::move(ensemble_response), 0 /* flags */);
+  return Status::Success;
+}
+
+void
+EnsembleContext::ReportCopyPath(const CopyPath path)
+{
+  if (path == CopyPath::PEER) {
+    INFER_TRACE_ACTIVITY_NOW(
+        request_tracker_->Request()->Trace(), TRITONSERVER_TRACE_COPY_PEER);
+  } else if (path == CopyPath::STAGED) {
+    INFER_TRACE_ACTIVITY_NOW(
+        request_tracker_->Request()->Trace(), TRITONSERVER_TRACE_COPY_STAGED);
+  }
+}
+
+void
+EnsembleContext::ReportStepStats()
+{
+  // Walk the critical path back from the step that completed last. Each
+  // step on the path is attributed the duration between the completion
+  // of the producer it waited on last, or the start of the ensemble
+  // request, and its own completion.
+  const size_t step_count = step_timings_.size();
+  std::vector<uint64_t> critical_path_ns(step_count, 0);
+  std::vector<bool> visited(step_count, false);
+  size_t step_idx = step_count;
+  uint64_t last_complete_ns = 0;
+  for (size_t idx = 0; idx < step_count; ++idx) {
+    const auto& timing = step_timings_[idx];
+    if ((timing.execution_count_ != 0) &&
+        (timing.complete_ns_ >= last_complete_ns)) {
+      step_idx = idx;
+      last_complete_ns = timing.complete_ns_;
+    }
+  }
+  while ((step_idx < step_count) && !visited[step_idx]) {
+    visited[step_idx] = true;
+    const auto& timing = step_timings_[step_idx];
+    size_t prev_idx = step_count;
+    uint64_t prev_complete_ns = compute_start_ns_;
+    for (const auto& pair : info_->steps_[step_idx].input_tensors_) {
+      const size_t producer_idx = info_->tensor_producers_[pair.second];
+      if (producer_idx == step_count) {
+        continue;
+      }
+      const auto& prev_timing = step_timings_[producer_idx];
+      if ((prev_timing.execution_count_ != 0) &&
+          (prev_timing.complete_ns_ >= prev_complete_ns) &&
+          (prev_timing.complete_ns_ <= timing.ready_ns_)) {
+        prev_idx = producer_idx;
+        prev_complete_ns = prev_timing.complete_ns_;
+      }
+    }
+    if (timing.complete_ns_ > prev_complete_ns) {
+      critical_path_ns[step_idx] += timing.complete_ns_ - prev_complete_ns;
+    }
+    step_idx = prev_idx;
+  }
+
+  for (size_t idx = 0; idx < step_count; ++idx) {
+    const auto& timing = step_timings_[idx];
+    if (timing.execution_count_ == 0) {
+      continue;
+    }
+    if (stats_aggregator_ != nullptr) {
+      stats_aggregator_->UpdateEnsembleStepStats(
+          idx, timing.execution_count_, timing.wait_duration_ns_,
+          timing.execution_duration_ns_, critical_path_ns[idx]);
+    }
+#ifdef TRITON_ENABLE_METRICS
+    if (!info_->step_metrics_.empty()) {
+      auto& metrics = info_->step_metrics_[idx];
+      metrics.wait_duration_us_->Increment(timing.wait_duration_ns_ / 1000);
+      metrics.execution_duration_us_->Increment(
+          timing.execution_duration_ns_ / 1000);
+      metrics.critical_path_duration_us_->Increment(
+          critical_path_ns[idx] / 1000);
+    }
+#endif  // TRITON_ENABLE_METRICS
+  }
+}
+
 Status
 EnsembleContext::CheckAndSetEnsembleOutput(
-    const std::set<std::pair<std::string, IterationCount>>& updated_tensors,
+    const UpdatedTensors& updated_tensors,
     std::unique_ptr<InferenceResponse>* response)
 {
   IterationCount iteration_count = 0;
@@ -1076,16 +1666,16 @@ EnsembleContext::CheckAndSetEnsembleOutput(
   // have tensor of the same iteration count
   bool ready = false;
   auto& lrequest = request_tracker_->Request();
-  const auto& requested_outputs = lrequest->ImmutableRequestedOutputs();
   for (const auto& updated_tensor : updated_tensors) {
-    if (requested_outputs.find(updated_tensor.first) ==
-        requested_outputs.end()) {
+    if (std::find(
+            requested_output_tensors_.begin(), requested_output_tensors_.end(),
+            updated_tensor.first) == requested_output_tensors_.end()) {
       continue;
     }
 
     ready = true;
     iteration_count = updated_tensor.second;
-    for (const auto& output : requested_outputs) {
+    for (const auto output : requested_output_tensors_) {
       auto& tensor = tensor_data_[output].tensor_;
       if (tensor.empty()) {
         ready = false;
@@ -1114,21 +1704,19 @@ EnsembleContext::CheckAndSetEnsembleOutput(
 
   bool cuda_async_copy = false;
   std::map<TensorData*, size_t*> releasing_tensors;
-  for (const auto& output_pair : info_->ensemble_output_shape_) {
-    if (requested_outputs.find(output_pair.first) == requested_outputs.end()) {
-      continue;
-    }
+  for (const auto output_idx : requested_output_tensors_) {
+    const auto& output_name = info_->tensor_names_[output_idx];
     // Check if output is ready
-    auto& tensor_data = tensor_data_[output_pair.first];
+    auto& tensor_data = tensor_data_[output_idx];
     auto& tensor = tensor_data.tensor_[iteration_count];
 
     auto shape = ReshapeTensorDims(
-        output_pair.second, (lrequest->BatchSize() != 0),
+        *info_->tensor_output_shapes_[output_idx], (lrequest->BatchSize() != 0),
         tensor_data.batch_size_, tensor.data_->OriginalShape());
 
     InferenceResponse::Output* output;
     RETURN_IF_ERROR((*response)->AddOutput(
-        output_pair.first, tensor.data_->DType(), shape, &output));
+        output_name, tensor.data_->DType(), shape, &output));
 
     // Use the memory type of the memory block as preferred memory type
     TRITONSERVER_MemoryType dst_memory_type;
@@ -1147,29 +1735,26 @@ EnsembleContext::CheckAndSetEnsembleOutput(
     } else if (buffer == nullptr) {
       return Status(
           Status::Code::INTERNAL,
-          "failed to allocate buffer for output '" + output_pair.first + "'");
+          "failed to allocate buffer for output '" + output_name + "'");
     }
 
-    size_t content_offset = 0;
-    size_t content_idx = 0;
-    TRITONSERVER_MemoryType src_memory_type;
-    int64_t src_memory_type_id;
-
-    const char* content = tensor.data_->Data()->BufferAt(
-        content_idx, &content_size, &src_memory_type, &src_memory_type_id);
-    bool cuda_used = false;
-    while (content != nullptr) {
-      RETURN_IF_ERROR(CopyBuffer(
-          output_pair.first, src_memory_type, src_memory_type_id,
-          dst_memory_type, dst_memory_type_id, content_size, content,
-          ((char*)buffer) + content_offset, stream_, &cuda_used));
-      cuda_async_copy |= cuda_used;
-
-      content_offset += content_size;
-      content_idx++;
-      content = tensor.data_->Data()->BufferAt(
-          content_idx, &content_size, &src_memory_type, &src_memory_type_id);
+    // Gather the buffers of the tensor, adjacent buffers are moved by a
+    // single copy.
+    const auto& data = tensor.data_->Data();
+    std::vector<CopySegment> segments(data->BufferCount());
+    for (size_t idx = 0; idx < segments.size(); ++idx) {
+      auto& segment = segments[idx];
+      segment.base_ = data->BufferAt(
+          idx, &segment.byte_size_, &segment.memory_type_,
+          &segment.memory_type_id_);
     }
+    bool cuda_used = false;
+    CopyPath copy_path;
+    RETURN_IF_ERROR(GatherBuffers(
+        output_name, segments, dst_memory_type, dst_memory_type_id, buffer,
+        stream_, &cuda_used, &copy_path));
+    cuda_async_copy |= cuda_used;
+    ReportCopyPath(copy_path);
 
     releasing_tensors.emplace(&tensor_data, &tensor.remaining_reference_count_);
 
@@ -1240,21 +1825,11 @@ EnsembleContext::ScheduleSteps(
       }
     }
     if (should_schedule) {
-      // On a successful call to InferAsync(), the step will be released by
-      // the response callback. When the response callback is invoked, the
-      // step must not own (and release) the request as the request should be
-      // transferred and managed by Triton core. In the case of cache hit, the
-      // request hasn't been transferred and can cause double-free, so moving
-      // the request ownership out of step here to avoid that
-      std::unique_ptr<InferenceRequest> request = std::move(step->request_);
-      auto step_status = context->is_->InferAsync(request);
-      if (!step_status.IsOk()) {
-        std::lock_guard<std::mutex> lock(context->mutex_);
-        context->ensemble_status_ = step_status;
-        // The request is not sent to server properly, shouldn't expect its
-        // release function get called.
-        context->request_tracker_->DecrementCounter();
-        context->ensemble_status_ = context->FinishEnsemble();
+      if (step->batch_model_ != nullptr) {
+        context->step_batcher_->Enqueue(std::move(step));
+        continue;
+      }
+      if (!DispatchStep(context, step)) {
         break;
       }
     }
@@ -1262,21 +1837,307 @@ EnsembleContext::ScheduleSteps(
   }
 }
 
+bool
+EnsembleContext::DispatchStep(
+    const std::shared_ptr<EnsembleContext>& context,
+    std::unique_ptr<Step>& step)
+{
+  // On a successful call to InferAsync(), the step will be released by
+  // the response callback. When the response callback is invoked, the
+  // step must not own (and release) the request as the request should be
+  // transferred and managed by Triton core. In the case of cache hit, the
+  // request hasn't been transferred and can cause double-free, so moving
+  // the request ownership out of step here to avoid that
+  std::unique_ptr<InferenceRequest> request = std::move(step->request_);
+  INFER_STATS_SET_TIMESTAMP(step->dispatch_ns_);
+  auto step_status = context->is_->InferAsync(request);
+  if (!step_status.IsOk()) {
+    std::lock_guard<std::mutex> lock(context->mutex_);
+    context->ensemble_status_ = step_status;
+    // The request is not sent to server properly, shouldn't expect its
+    // release function get called.
+    context->request_tracker_->DecrementCounter();
+    context->ensemble_status_ = context->FinishEnsemble();
+    return false;
+  }
+  return true;
+}
+
+bool
+EnsembleContext::CanBatchSteps(
+    const std::unique_ptr<Step>& first_step, const std::unique_ptr<Step>& step)
+{
+  if (step->batch_model_ != first_step->batch_model_) {
+    return false;
+  }
+  const auto& first_inputs = first_step->request_->OriginalInputs();
+  const auto& inputs = step->request_->OriginalInputs();
+  if (inputs.size() != first_inputs.size()) {
+    return false;
+  }
+  for (const auto& pr : first_inputs) {
+    auto it = inputs.find(pr.first);
+    if ((it == inputs.end()) || (it->second.DType() != pr.second.DType())) {
+      return false;
+    }
+    // Only the batch dimension may differ
+    const auto& first_shape = pr.second.OriginalShape();
+    const auto& shape = it->second.OriginalShape();
+    if (first_shape.empty() || (shape.size() != first_shape.size()) ||
+        !std::equal(
+            first_shape.begin() + 1, first_shape.end(), shape.begin() + 1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Status
+EnsembleContext::BatchStepRequests(
+    const StepList& steps, std::unique_ptr<InferenceRequest>* request)
+{
+  const auto& first_request = steps.front()->request_;
+  request->reset(new InferenceRequest(
+      steps.front()->batch_model_, first_request->RequestedModelVersion()));
+  (*request)->SetEnsembleStep(true);
+
+  int64_t batch_size = 0;
+  for (const auto& step : steps) {
+    batch_size += step->request_->BatchSize();
+  }
+
+  for (const auto& pr : first_request->OriginalInputs()) {
+    std::vector<int64_t> shape(pr.second.OriginalShape());
+    shape[0] = batch_size;
+    InferenceRequest::Input* input;
+    RETURN_IF_ERROR((*request)->AddOriginalInput(
+        pr.first, pr.second.DType(), shape, &input));
+    for (const auto& step : steps) {
+      const auto& data = step->request_->OriginalInputs().at(pr.first).Data();
+      for (size_t idx = 0; idx < data->BufferCount(); ++idx) {
+        size_t byte_size;
+        TRITONSERVER_MemoryType memory_type;
+        int64_t memory_type_id;
+        const char* buffer =
+            data->BufferAt(idx, &byte_size, &memory_type, &memory_type_id);
+        RETURN_IF_ERROR(
+            input->AppendData(buffer, byte_size, memory_type, memory_type_id));
+      }
+    }
+  }
+
+  for (const auto& output : first_request->OriginalRequestedOutputs()) {
+    RETURN_IF_ERROR((*request)->AddOriginalRequestedOutput(output));
+  }
+
+  // The oldest step decides when the batched request must be executed
+  (*request)->SetPriority(first_request->Priority());
+  (*request)->SetTimeoutMicroseconds(first_request->TimeoutMicroseconds());
+  return Status::Success;
+}
+
+void
+EnsembleContext::ScheduleBatchedSteps(StepList&& steps)
+{
+  StepList batched_steps;
+  for (auto& step : steps) {
+    if (batched_steps.empty() || CanBatchSteps(batched_steps.front(), step)) {
+      batched_steps.emplace_back(std::move(step));
+    } else {
+      auto context = step->ctx_;
+      if (DispatchStep(context, step)) {
+        step.release();
+      }
+    }
+  }
+  if (batched_steps.size() == 1) {
+    auto context = batched_steps.front()->ctx_;
+    if (DispatchStep(context, batched_steps.front())) {
+      batched_steps.front().release();
+    }
+    return;
+  }
+
+  auto context = batched_steps.front()->ctx_;
+  std::unique_ptr<InferenceRequest> request;
+  Status status = BatchStepRequests(batched_steps, &request);
+
+  // The batched request references the input data of the step requests,
+  // which are released together with the batched request.
+  auto step_requests = new std::vector<std::unique_ptr<InferenceRequest>>();
+  std::unique_ptr<BatchedStep> batched_step(new BatchedStep());
+  batched_step->carrier_.reset(
+      new Step(
+          batched_steps.front()->step_idx_, InferenceRequest::SequenceId(),
+          0 /* flags */));
+  batched_step->carrier_->ctx_ = context;
+  batched_step->batch_size_ = 0;
+  for (auto& step : batched_steps) {
+    INFER_STATS_SET_TIMESTAMP(step->dispatch_ns_);
+    batched_step->batch_sizes_.push_back(step->request_->BatchSize());
+    batched_step->batch_size_ += step->request_->BatchSize();
+    step_requests->emplace_back(std::move(step->request_));
+  }
+  batched_step->steps_ = std::move(batched_steps);
+
+  if (status.IsOk()) {
+    request->SetResponseCallback(
+        reinterpret_cast<ResponseAllocator*>(context->allocator_.get()),
+        batched_step->carrier_.get(), BatchedResponseComplete,
+        batched_step.get());
+    request->SetReleaseCallback(BatchedRequestComplete, step_requests);
+    status = request->PrepareForInference();
+  }
+  if (status.IsOk()) {
+    status = context->is_->InferAsync(request);
+  }
+  if (status.IsOk()) {
+    batched_step.release();
+    return;
+  }
+
+  // The batched request is not sent, release the step requests in its
+  // place and fail the ensemble requests of the steps.
+  for (auto& step_request : *step_requests) {
+    InferenceRequest::Release(
+        std::move(step_request), TRITONSERVER_REQUEST_RELEASE_ALL);
+  }
+  delete step_requests;
+  for (auto& step : batched_step->steps_) {
+    std::lock_guard<std::mutex> lock(step->ctx_->mutex_);
+    step->ctx_->ensemble_status_ = status;
+    step->ctx_->ensemble_status_ = step->ctx_->FinishEnsemble();
+  }
+}
+
 }  // namespace
 
+EnsembleStepBatcher::EnsembleStepBatcher(
+    const uint64_t delay_us, const size_t step_count)
+    : delay_(delay_us), exit_(false), pending_(step_count),
+      pending_batch_size_(step_count, 0)
+{
+  thread_ = std::thread([this]() { BatcherThread(); });
+}
+
+EnsembleStepBatcher::~EnsembleStepBatcher()
+{
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    exit_ = true;
+  }
+  cv_.notify_one();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void
+EnsembleStepBatcher::Enqueue(std::unique_ptr<Step>&& step)
+{
+  const size_t step_idx = step->step_idx_;
+  const size_t max_batch_size = step->batch_model_->Config().max_batch_size();
+  bool notify = false;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto& queue = pending_[step_idx];
+    pending_batch_size_[step_idx] += step->request_->BatchSize();
+    queue.push_back({std::move(step), std::chrono::steady_clock::now()});
+    // Wake the batcher to set the flush time of the new oldest step, or
+    // to flush the steps that now fill the max batch size
+    notify = (queue.size() == 1) ||
+             (pending_batch_size_[step_idx] >= max_batch_size);
+  }
+  if (notify) {
+    cv_.notify_one();
+  }
+}
+
+void
+EnsembleStepBatcher::BatcherThread()
+{
+  std::unique_lock<std::mutex> lk(mu_);
+  while (true) {
+    const auto now = std::chrono::steady_clock::now();
+    auto next_flush = std::chrono::steady_clock::time_point::max();
+    std::vector<std::vector<std::unique_ptr<Step>>> batches;
+    for (size_t step_idx = 0; step_idx < pending_.size(); ++step_idx) {
+      auto& queue = pending_[step_idx];
+      while (!queue.empty()) {
+        const size_t max_batch_size =
+            queue.front().step_->batch_model_->Config().max_batch_size();
+        const auto flush_time = queue.front().enqueue_time_ + delay_;
+        if (!exit_ && (now < flush_time) &&
+            (pending_batch_size_[step_idx] < max_batch_size)) {
+          next_flush = std::min(next_flush, flush_time);
+          break;
+        }
+
+        // Batch the oldest steps up to the max batch size of the model
+        batches.emplace_back();
+        size_t batch_size = 0;
+        do {
+          batch_size += queue.front().step_->request_->BatchSize();
+          batches.back().emplace_back(std::move(queue.front().step_));
+          queue.pop_front();
+        } while (!queue.empty() &&
+                 ((batch_size + queue.front().step_->request_->BatchSize()) <=
+                  max_batch_size));
+        pending_batch_size_[step_idx] -= batch_size;
+      }
+    }
+
+    if (!batches.empty()) {
+      // Schedule without holding the lock as the completion of a step may
+      // enqueue the next steps from the same thread.
+      lk.unlock();
+      for (auto& batch : batches) {
+        EnsembleContext::ScheduleBatchedSteps(std::move(batch));
+      }
+      lk.lock();
+      continue;
+    }
+
+    if (exit_) {
+      break;
+    }
+    if (next_flush == std::chrono::steady_clock::time_point::max()) {
+      cv_.wait(lk);
+    } else {
+      cv_.wait_until(lk, next_flush);
+    }
+  }
+}
+
 Status
 EnsembleScheduler::Create(
     InferenceStatsAggregator* const stats_aggregator,
-    InferenceServer* const server, const inference::ModelConfig& config,
+    InferenceServer* const server, const int64_t version,
+    const inference::ModelConfig& config,
     std::unique_ptr<Scheduler>* scheduler)
 {
-  scheduler->reset(new EnsembleScheduler(stats_aggregator, server, config));
+  scheduler->reset(
+      new EnsembleScheduler(stats_aggregator, server, version, config));
   return Status::Success;
 }
 
 Status
 EnsembleScheduler::Enqueue(std::unique_ptr<InferenceRequest>& request)
 {
+  PROFILE_RANGE(range, "EnsembleScheduler Enqueue");
+
+  // Once stopped only the requests continuing an in-flight sequence are
+  // accepted, the composing models reject anything else anyway.
+  if (stop_ &&
+      (!request->CorrelationId().InSequence() ||
+       ((request->Flags() & TRITONSERVER_REQUEST_FLAG_SEQUENCE_START) != 0))) {
+    return Status(
+        Status::Code::UNAVAILABLE,
+        request->LogRequest() +
+            "Server is stopping, scheduler for model has stopped accepting new "
+            "inference requests");
+  }
+
   // Queue timer starts at the beginning of the queueing and
   // scheduling process
   request->CaptureQueueStartNs();
@@ -1292,17 +2153,18 @@ EnsembleScheduler::Enqueue(std::unique_ptr<InferenceRequest>& request)
   ++inflight_count_;
   request->AddInternalReleaseCallback([this]() { --inflight_count_; });
   std::shared_ptr<EnsembleContext> context(new EnsembleContext(
-      metric_reporter_.get(), stats_aggregator_, is_, info_.get(), request,
-      stream_));
+      metric_reporter_.get(), stats_aggregator_, is_, info_.get(),
+      step_batcher_.get(), request, stream_));
   EnsembleContext::Proceed(context);
   return Status::Success;
 }
 
 EnsembleScheduler::EnsembleScheduler(
     InferenceStatsAggregator* const stats_aggregator,
-    InferenceServer* const server, const inference::ModelConfig& config)
+    InferenceServer* const server, const int64_t version,
+    const inference::ModelConfig& config)
     : stats_aggregator_(stats_aggregator), is_(server), stream_(nullptr),
-      inflight_count_(0)
+      inflight_count_(0), stop_(false)
 {
 #ifdef TRITON_ENABLE_GPU
   // create CUDA stream
@@ -1376,10 +2238,220 @@ EnsembleScheduler::EnsembleScheduler(
       info_->tensor_to_prev_step_.emplace(pair.second, step_idx);
     }
   }
+
+  // Index the ensemble tensors to build the execution plan
+  for (const auto& pair : info_->tensor_to_step_) {
+    info_->tensor_index_.emplace(pair.first, info_->tensor_names_.size());
+    info_->tensor_names_.push_back(pair.first);
+  }
+  const size_t tensor_count = info_->tensor_names_.size();
+  info_->tensor_consumers_.resize(tensor_count);
+  info_->tensor_producers_.assign(tensor_count, info_->steps_.size());
+  info_->tensor_output_shapes_.assign(tensor_count, nullptr);
+  for (size_t tensor_idx = 0; tensor_idx < tensor_count; ++tensor_idx) {
+    const auto& name = info_->tensor_names_[tensor_idx];
+    const auto& consumers = info_->tensor_to_step_[name];
+    info_->tensor_consumers_[tensor_idx].assign(
+        consumers.begin(), consumers.end());
+    auto producer_it = info_->tensor_to_prev_step_.find(name);
+    if (producer_it != info_->tensor_to_prev_step_.end()) {
+      info_->tensor_producers_[tensor_idx] = producer_it->second;
+    }
+    auto shape_it = info_->ensemble_output_shape_.find(name);
+    if (shape_it != info_->ensemble_output_shape_.end()) {
+      info_->tensor_output_shapes_[tensor_idx] = &shape_it->second;
+    }
+    if (info_->optional_inputs_.find(name) != info_->optional_inputs_.end()) {
+      info_->optional_input_tensors_.push_back(tensor_idx);
+    }
+  }
+  for (auto& step_info : info_->steps_) {
+    for (const auto& pair : step_info.input_to_tensor_) {
+      step_info.input_tensors_.emplace_back(
+          pair.first, info_->tensor_index_[pair.second]);
+    }
+    for (const auto& pair : step_info.output_to_tensor_) {
+      step_info.output_tensors_.emplace(
+          pair.first, info_->tensor_index_[pair.second]);
+    }
+  }
+
+  PlaceIntermediateTensors(config);
+
+#ifdef TRITON_ENABLE_METRICS
+  if (Metrics::Enabled()) {
+    for (size_t step_idx = 0; step_idx < info_->steps_.size(); ++step_idx) {
+      const std::map<std::string, std::string> labels{
+          {kMetricsLabelModelName, config.name()},
+          {kMetricsLabelModelVersion, std::to_string(version)},
+          {"step", std::to_string(step_idx)},
+          {"step_model", info_->steps_[step_idx].model_id_.name_}};
+      info_->step_metrics_.push_back(
+          {&Metrics::FamilyEnsembleStepWaitDuration().Add(labels),
+           &Metrics::FamilyEnsembleStepExecutionDuration().Add(labels),
+           &Metrics::FamilyEnsembleStepCriticalPathDuration().Add(labels)});
+    }
+  }
+#endif  // TRITON_ENABLE_METRICS
+
+  // The responses of the step producing all the outputs of a decoupled
+  // ensemble may be streamed to the client as they are produced.
+  info_->stream_final_step_ = false;
+  info_->stream_step_idx_ = 0;
+  bool stream_final_step = false;
+  Status status = GetBoolModelParameter(
+      config, "TRITON_ENSEMBLE_STREAM_FINAL_STEP", false /* default_value */,
+      &stream_final_step);
+  if (!status.IsOk()) {
+    LOG_WARNING << "Failed to read final step streaming parameter of ensemble "
+                << config.name() << ": " << status.Message();
+  } else if (stream_final_step && info_->is_decoupled_) {
+    for (size_t step_idx = 0; step_idx < info_->steps_.size(); ++step_idx) {
+      const auto& output_to_tensor = info_->steps_[step_idx].output_to_tensor_;
+      if (output_to_tensor.size() != info_->ensemble_output_shape_.size()) {
+        continue;
+      }
+      bool streamable = true;
+      for (const auto& pair : output_to_tensor) {
+        if ((info_->ensemble_output_shape_.find(pair.second) ==
+             info_->ensemble_output_shape_.end()) ||
+            !info_->tensor_to_step_[pair.second].empty()) {
+          streamable = false;
+          break;
+        }
+      }
+      if (streamable) {
+        info_->stream_final_step_ = true;
+        info_->stream_step_idx_ = step_idx;
+        break;
+      }
+    }
+    if (!info_->stream_final_step_) {
+      LOG_WARNING << "Ensemble " << config.name()
+                  << " has no step that produces exactly the ensemble "
+                     "outputs, its responses are not streamed";
+    }
+  }
+
+  // Hold the ready steps for up to the delay so that the steps of the
+  // concurrent ensemble requests are batched, 0 disables the batching.
+  int64_t step_batch_delay_us = 0;
+  status = GetInt64ModelParameter(
+      config, "TRITON_ENSEMBLE_STEP_BATCH_DELAY_MICROSECONDS",
+      0 /* default_value */, &step_batch_delay_us);
+  if (!status.IsOk()) {
+    LOG_WARNING << "Failed to read step batch delay parameter of ensemble "
+                << config.name() << ": " << status.Message();
+  } else if (step_batch_delay_us > 0) {
+    step_batcher_.reset(
+        new EnsembleStepBatcher(step_batch_delay_us, info_->steps_.size()));
+  }
+}
+
+void
+EnsembleScheduler::PlaceIntermediateTensors(
+    const inference::ModelConfig& config)
+{
+  bool place_tensors = false;
+  Status status = GetBoolModelParameter(
+      config, "TRITON_ENSEMBLE_TENSOR_PLACEMENT", false /* default_value */,
+      &place_tensors);
+  if (!status.IsOk()) {
+    LOG_WARNING << "Failed to read tensor placement parameter of ensemble "
+                << config.name() << ": " << status.Message();
+    return;
+  }
+  if (!place_tensors) {
+    return;
+  }
+
+  // The memory where all instances of each step model run, if they run
+  // in the same memory. The composing models are loaded before the
+  // ensemble, a model reloaded later only makes the placement a less
+  // suitable allocation hint.
+  std::vector<std::pair<bool, std::pair<TRITONSERVER_MemoryType, int64_t>>>
+      step_memory;
+  for (const auto& step : info_->steps_) {
+    step_memory.emplace_back(
+        false, std::make_pair(TRITONSERVER_MEMORY_CPU, int64_t(0)));
+    std::shared_ptr<Model> model;
+    if (!is_->GetModel(step.model_id_, step.model_version_, &model).IsOk()) {
+      continue;
+    }
+    const auto& instance_groups = model->Config().instance_group();
+    bool placed = !instance_groups.empty();
+    std::pair<TRITONSERVER_MemoryType, int64_t> memory{
+        TRITONSERVER_MEMORY_CPU, -1};
+    for (const auto& group : instance_groups) {
+      std::pair<TRITONSERVER_MemoryType, int64_t> group_memory;
+      if ((group.kind() == inference::ModelInstanceGroup::KIND_GPU) &&
+          (group.gpus_size() == 1)) {
+        group_memory = std::make_pair(TRITONSERVER_MEMORY_GPU, group.gpus(0));
+      } else if (group.kind() == inference::ModelInstanceGroup::KIND_CPU) {
+        group_memory = std::make_pair(TRITONSERVER_MEMORY_CPU, int64_t(0));
+      } else {
+        placed = false;
+        break;
+      }
+      if ((memory.second != -1) && (memory != group_memory)) {
+        placed = false;
+        break;
+      }
+      memory = group_memory;
+    }
+    if (placed) {
+      step_memory.back() = std::make_pair(true, memory);
+    }
+  }
+
+  // Ensemble outputs go through the response allocator of the request
+  // and are left in the memory preferred by the producing model.
+  for (const auto& tensor : info_->tensor_to_prev_step_) {
+    if (info_->ensemble_output_shape_.find(tensor.first) !=
+        info_->ensemble_output_shape_.end()) {
+      continue;
+    }
+    const auto& consumers = info_->tensor_to_step_[tensor.first];
+    if (consumers.empty()) {
+      continue;
+    }
+    bool placed = true;
+    const auto& memory = step_memory[*consumers.begin()];
+    for (const auto step_idx : consumers) {
+      if (!step_memory[step_idx].first ||
+          (step_memory[step_idx].second != memory.second)) {
+        placed = false;
+        break;
+      }
+    }
+    if (!placed) {
+      continue;
+    }
+
+    auto& producer = info_->steps_[tensor.second];
+    for (const auto& output : producer.output_to_tensor_) {
+      if (output.second == tensor.first) {
+        producer.output_placement_.emplace(output.first, memory.second);
+        LOG_VERBOSE(1) << "Ensemble " << config.name() << " places tensor '"
+                       << tensor.first << "' in memory type "
+                       << memory.second.first << ", type id "
+                       << memory.second.second;
+      }
+    }
+  }
 }
 
 EnsembleScheduler::~EnsembleScheduler()
 {
+#ifdef TRITON_ENABLE_METRICS
+  for (auto& metrics : info_->step_metrics_) {
+    Metrics::FamilyEnsembleStepWaitDuration().Remove(metrics.wait_duration_us_);
+    Metrics::FamilyEnsembleStepExecutionDuration().Remove(
+        metrics.execution_duration_us_);
+    Metrics::FamilyEnsembleStepCriticalPathDuration().Remove(
+        metrics.critical_path_duration_us_);
+  }
+#endif  // TRITON_ENABLE_METRICS
 #ifdef TRITON_ENABLE_GPU
   if (stream_ != nullptr) {
     cudaError_t err = cudaStreamDestroy(stream_);
@@ -46,6 +46,7 @@ using cudaStream_t = void*;
 #endif  // TRITON_ENABLE_GPU
 
 class InferenceServer;
+class EnsembleStepBatcher;
 
 struct EnsembleInfo {
   struct StepInfo {
@@ -58,12 +59,26 @@ struct EnsembleInfo {
     int64_t model_version_;
     std::unordered_map<std::string, std::string> input_to_tensor_;
     std::unordered_map<std::string, std::string> output_to_tensor_;
+    // The same mappings by ensemble tensor index, see 'tensor_names_'.
+    std::vector<std::pair<std::string, size_t>> input_tensors_;
+    std::unordered_map<std::string, size_t> output_tensors_;
+    // The memory to allocate a step output in, by the output name, when
+    // all consumers of its ensemble tensor run in the same memory. Other
+    // outputs are allocated in the memory preferred by the step model.
+    std::unordered_map<std::string, std::pair<TRITONSERVER_MemoryType, int64_t>>
+        output_placement_;
   };
 
   std::string ensemble_name_;
 
   bool is_decoupled_;
 
+  // Whether the responses of 'stream_step_idx_' are sent directly as
+  // responses of the decoupled ensemble. Only possible when that step
+  // produces all ensemble outputs and nothing else.
+  bool stream_final_step_;
+  size_t stream_step_idx_;
+
   // the ensemble output (re)shape expected by the ensemble
   std::unordered_map<std::string, triton::common::DimsList>
       ensemble_output_shape_;
@@ -78,6 +93,32 @@ struct EnsembleInfo {
 
   // backward path, ensemble tensor to the step that provides its data
   std::unordered_map<std::string, size_t> tensor_to_prev_step_;
+
+  // The execution plan of the ensemble, built once from the maps above
+  // so that the ensemble requests track their tensors by index. The
+  // tensors are indexed in the order of 'tensor_names_'.
+  std::vector<std::string> tensor_names_;
+  std::unordered_map<std::string, size_t> tensor_index_;
+  // The steps consuming each tensor.
+  std::vector<std::vector<size_t>> tensor_consumers_;
+  // The step producing each tensor, 'steps_.size()' for the ensemble
+  // inputs.
+  std::vector<size_t> tensor_producers_;
+  // The (re)shape of each tensor that is an ensemble output, nullptr
+  // for the other tensors.
+  std::vector<const triton::common::DimsList*> tensor_output_shapes_;
+  std::vector<size_t> optional_input_tensors_;
+
+#ifdef TRITON_ENABLE_METRICS
+  // The per-step duration metrics, by the step index. Empty if metrics
+  // are disabled.
+  struct StepMetrics {
+    prometheus::Counter* wait_duration_us_;
+    prometheus::Counter* execution_duration_us_;
+    prometheus::Counter* critical_path_duration_us_;
+  };
+  std::vector<StepMetrics> step_metrics_;
+#endif  // TRITON_ENABLE_METRICS
 };
 
 // Scheduler that implements ensemble scheduling.
@@ -87,7 +128,8 @@ class EnsembleScheduler : public Scheduler {
   // to dispatch requests to models in ensemble internally.
   static Status Create(
       InferenceStatsAggregator* const stats_aggregator,
-      InferenceServer* const server, const inference::ModelConfig& config,
+      InferenceServer* const server, const int64_t version,
+      const inference::ModelConfig& config,
       std::unique_ptr<Scheduler>* scheduler);
 
   ~EnsembleScheduler();
@@ -99,12 +141,17 @@ class EnsembleScheduler : public Scheduler {
   size_t InflightInferenceCount() override { return inflight_count_; }
 
   // \see Scheduler::Stop()
-  void Stop() override {}
+  void Stop() override { stop_ = true; }
 
  private:
   EnsembleScheduler(
       InferenceStatsAggregator* const stats_aggregator,
-      InferenceServer* const server, const inference::ModelConfig& config);
+      InferenceServer* const server, const int64_t version,
+      const inference::ModelConfig& config);
+
+  // Place each intermediate tensor in the memory where the instances of
+  // the models consuming it run.
+  void PlaceIntermediateTensors(const inference::ModelConfig& config);
 
   std::shared_ptr<MetricModelReporter> metric_reporter_;
   InferenceStatsAggregator* const stats_aggregator_;
@@ -116,7 +163,14 @@ class EnsembleScheduler : public Scheduler {
   // The stream used for data transfer.
   cudaStream_t stream_;
 
+  // Collects the ready steps of concurrent ensemble requests so that
+  // they are sent to their model as one batched request, nullptr if the
+  // steps are sent individually.
+  std::unique_ptr<EnsembleStepBatcher> step_batcher_;
+
   std::atomic<size_t> inflight_count_;
+
+  bool stop_;
 };
 
 }}  // namespace triton::core
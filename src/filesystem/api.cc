@@ -532,6 +532,15 @@ GetDirectoryFiles(
   return Status::Success;
 }
 
+Status
+ListModificationTimes(
+    const std::string& path, std::map<std::string, int64_t>* mtimes)
+{
+  std::shared_ptr<FileSystem> fs;
+  RETURN_IF_ERROR(fsm_.GetFileSystem(path, fs));
+  return fs->ListModificationTimes(path, mtimes);
+}
+
 Status
 ReadTextFile(const std::string& path, std::string* contents)
 {
@@ -540,6 +549,24 @@ ReadTextFile(const std::string& path, std::string* contents)
   return fs->ReadTextFile(path, contents);
 }
 
+Status
+FileSize(const std::string& path, uint64_t* byte_size)
+{
+  std::shared_ptr<FileSystem> fs;
+  RETURN_IF_ERROR(fsm_.GetFileSystem(path, fs));
+  return fs->FileSize(path, byte_size);
+}
+
+Status
+ReadRange(
+    const std::string& path, const uint64_t offset, const uint64_t byte_size,
+    char* dst)
+{
+  std::shared_ptr<FileSystem> fs;
+  RETURN_IF_ERROR(fsm_.GetFileSystem(path, fs));
+  return fs->ReadRange(path, offset, byte_size, dst);
+}
+
 Status
 ReadTextProto(const std::string& path, google::protobuf::Message* msg)
 {
@@ -25,6 +25,7 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <map>
 #include <string>
 #include "../status.h"
 #include "google/protobuf/message.h"
@@ -127,6 +128,17 @@ Status GetDirectoryContents(
 Status GetDirectorySubdirs(
     const std::string& path, std::set<std::string>* subdirs);
 
+/// Get the modification times of everything under a directory. Cloud
+/// file systems do so with a single recursive listing instead of a request
+/// per file.
+/// \param path The directory path.
+/// \param mtimes Returns the modification time in nanoseconds of each file
+/// and sub-directory under 'path', keyed by its path relative to 'path'.
+/// A sub-directory without a modification time is reported as 0.
+/// \return Error status
+Status ListModificationTimes(
+    const std::string& path, std::map<std::string, int64_t>* mtimes);
+
 /// Get the files contained in a directory.
 /// \param path The directory.
 /// \param skip_hidden_files Ignores the hidden files in the directory.
@@ -142,6 +154,23 @@ Status GetDirectoryFiles(
 /// \return Error status
 Status ReadTextFile(const std::string& path, std::string* contents);
 
+/// Get the size of a file.
+/// \param path The path of the file.
+/// \param byte_size Returns the size of the file, in bytes.
+/// \return Error status
+Status FileSize(const std::string& path, uint64_t* byte_size);
+
+/// Read a range of a file without localizing it. Fails if the file has
+/// fewer than 'offset' + 'byte_size' bytes.
+/// \param path The path of the file.
+/// \param offset The offset of the range in the file.
+/// \param byte_size The size of the range.
+/// \param dst Returns the 'byte_size' bytes of the range.
+/// \return Error status
+Status ReadRange(
+    const std::string& path, const uint64_t offset, const uint64_t byte_size,
+    char* dst);
+
 /// Create an object representing a local copy of a path.
 /// \param path The path of the directory or file.
 /// \param localized Returns the LocalizedPath object
@@ -84,7 +84,14 @@ class ASFileSystem : public FileSystem {
       const std::string& path, std::set<std::string>* subdirs) override;
   Status GetDirectoryFiles(
       const std::string& path, std::set<std::string>* files) override;
+  Status ListModificationTimes(
+      const std::string& path,
+      std::map<std::string, int64_t>* mtimes) override;
   Status ReadTextFile(const std::string& path, std::string* contents) override;
+  Status FileSize(const std::string& path, uint64_t* byte_size) override;
+  Status ReadRange(
+      const std::string& path, const uint64_t offset,
+      const uint64_t byte_size, char* dst) override;
   Status LocalizePath(
       const std::string& path,
       std::shared_ptr<LocalizedPath>* localized) override;
@@ -336,6 +343,41 @@ ASFileSystem::IsDirectory(const std::string& path, bool* is_dir)
   return Status::Success;
 };
 
+Status
+ASFileSystem::ListModificationTimes(
+    const std::string& path, std::map<std::string, int64_t>* mtimes)
+{
+  std::string container, dir_path;
+  RETURN_IF_ERROR(ParsePath(path, &container, &dir_path));
+  const std::string full_dir = AppendSlash(dir_path);
+
+  auto container_client = client_->GetBlobContainerClient(container);
+  auto options = asb::ListBlobsOptions();
+  options.Prefix = full_dir;
+  try {
+    // Flat listing of every blob with the prefix
+    for (auto blobPage = container_client.ListBlobs(options);
+         blobPage.HasPage(); blobPage.MoveToNextPage()) {
+      for (const auto& blob_item : blobPage.Blobs) {
+        AddListedModificationTime(
+            full_dir, blob_item.Name,
+            std::chrono::time_point_cast<std::chrono::nanoseconds>(
+                blob_item.Details.LastModified)
+                .time_since_epoch()
+                .count(),
+            mtimes);
+      }
+    }
+  }
+  catch (as::StorageException& ex) {
+    return Status(
+        Status::Code::INTERNAL,
+        "Failed to get contents of directory " + dir_path + ":" + ex.what());
+  }
+
+  return Status::Success;
+}
+
 Status
 ASFileSystem::ReadTextFile(const std::string& path, std::string* contents)
 {
@@ -386,24 +428,82 @@ ASFileSystem::FileExists(const std::string& path, bool* exists)
   return Status::Success;
 }
 
+Status
+ASFileSystem::FileSize(const std::string& path, uint64_t* byte_size)
+{
+  std::string container, blob_path;
+  RETURN_IF_ERROR(ParsePath(path, &container, &blob_path));
+  try {
+    auto properties = client_->GetBlobContainerClient(container)
+                          .GetBlobClient(blob_path)
+                          .GetProperties()
+                          .Value;
+    *byte_size = properties.BlobSize;
+  }
+  catch (as::StorageException& ex) {
+    return Status(
+        Status::Code::INTERNAL,
+        "Failed to get properties of file at " + path + ":" + ex.what());
+  }
+  return Status::Success;
+}
+
+Status
+ASFileSystem::ReadRange(
+    const std::string& path, const uint64_t offset, const uint64_t byte_size,
+    char* dst)
+{
+  std::string container, blob_path;
+  RETURN_IF_ERROR(ParsePath(path, &container, &blob_path));
+  try {
+    asb::DownloadBlobToOptions options;
+    options.Range = Azure::Core::Http::HttpRange();
+    options.Range.Value().Offset = offset;
+    options.Range.Value().Length = byte_size;
+    client_->GetBlobContainerClient(container)
+        .GetBlobClient(blob_path)
+        .DownloadTo(reinterpret_cast<uint8_t*>(dst), byte_size, options);
+  }
+  catch (as::StorageException& ex) {
+    return Status(
+        Status::Code::INTERNAL,
+        "Failed to read file at " + path + ":" + ex.what());
+  }
+  return Status::Success;
+}
+
 Status
 ASFileSystem::DownloadFolder(
     const std::string& container, const std::string& path,
     const std::string& dest)
 {
   auto container_client = client_->GetBlobContainerClient(container);
+  // The SDK downloads a blob in ranges, in parallel
+  const DownloadOptions options;
+  asb::DownloadBlobToOptions download_options;
+  download_options.TransferOptions.InitialChunkSize = options.chunk_byte_size_;
+  download_options.TransferOptions.ChunkSize = options.chunk_byte_size_;
+  download_options.TransferOptions.Concurrency = options.parallelism_;
   auto func = [&](const std::vector<asb::Models::BlobItem>& blobs,
                   const std::vector<std::string>& blob_prefixes) {
     for (const auto& blob_item : blobs) {
       const auto& local_path = JoinPath({dest, BaseName(blob_item.Name)});
-      try {
-        container_client.GetBlobClient(blob_item.Name).DownloadTo(local_path);
-      }
-      catch (as::StorageException& ex) {
-        return Status(
-            Status::Code::INTERNAL,
-            "Failed to download file at " + blob_item.Name + ":" + ex.what());
-      }
+      auto download_fn = [&](const std::string& download_path) {
+        try {
+          container_client.GetBlobClient(blob_item.Name)
+              .DownloadTo(download_path, download_options);
+        }
+        catch (as::StorageException& ex) {
+          return Status(
+              Status::Code::INTERNAL,
+              "Failed to download file at " + blob_item.Name + ":" +
+                  ex.what());
+        }
+        return Status::Success;
+      };
+      RETURN_IF_ERROR(LocalizationCache::Instance()->Localize(
+          "as://" + container + "/" + blob_item.Name,
+          blob_item.Details.ETag.ToString(), local_path, download_fn));
     }
     for (const auto& directory_item : blob_prefixes) {
       const auto& local_path = JoinPath({dest, BaseName(directory_item)});
@@ -28,9 +28,20 @@
 #include "../api.h"
 
 #include <re2/re2.h>
+#include <algorithm>
+#include <atomic>
 #include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <set>
+#include <sstream>
+#include <thread>
+#include <tuple>
+#include <vector>
 
 #include "triton/common/logging.h"
 
@@ -46,7 +57,9 @@
 #include <io.h>
 #else
 #include <dirent.h>
+#include <sys/stat.h>
 #include <unistd.h>
+#include <utime.h>
 #endif
 
 #ifdef _WIN32
@@ -80,8 +93,14 @@ class FileSystem {
       const std::string& path, std::set<std::string>* subdirs) = 0;
   virtual Status GetDirectoryFiles(
       const std::string& path, std::set<std::string>* files) = 0;
+  virtual Status ListModificationTimes(
+      const std::string& path, std::map<std::string, int64_t>* mtimes) = 0;
   virtual Status ReadTextFile(
       const std::string& path, std::string* contents) = 0;
+  virtual Status FileSize(const std::string& path, uint64_t* byte_size) = 0;
+  virtual Status ReadRange(
+      const std::string& path, const uint64_t offset,
+      const uint64_t byte_size, char* dst) = 0;
   virtual Status LocalizePath(
       const std::string& path, std::shared_ptr<LocalizedPath>* localized) = 0;
   virtual Status WriteTextFile(
@@ -106,4 +125,368 @@ AppendSlash(const std::string& name)
   return (name + "/");
 }
 
+// Record in 'mtimes' the modification time of the object 'key' listed
+// under the directory prefix 'dir', keyed by its path relative to 'dir'.
+// The sub-directories implied by the key have no modification time.
+void
+AddListedModificationTime(
+    const std::string& dir, const std::string& key, const int64_t mtime_ns,
+    std::map<std::string, int64_t>* mtimes)
+{
+  if ((key.size() <= dir.size()) || (key.compare(0, dir.size(), dir) != 0)) {
+    return;
+  }
+  std::string relative = key.substr(dir.size());
+  // Empty directories are listed as a placeholder object ending in '/'
+  const bool is_dir = (relative.back() == '/');
+  if (is_dir) {
+    relative.pop_back();
+  }
+  if (relative.empty()) {
+    return;
+  }
+  for (size_t pos = relative.find('/'); pos != std::string::npos;
+       pos = relative.find('/', pos + 1)) {
+    mtimes->emplace(relative.substr(0, pos), 0);
+  }
+  if (is_dir) {
+    mtimes->emplace(relative, 0);
+  } else {
+    (*mtimes)[relative] = mtime_ns;
+  }
+}
+
+// Options of the ranged downloads of cloud storage objects, which are
+// read from the TRITON_CLOUD_DOWNLOAD_PARALLELISM and
+// TRITON_CLOUD_DOWNLOAD_CHUNK_SIZE (in bytes) environment variables.
+struct DownloadOptions {
+  DownloadOptions();
+
+  size_t parallelism_;
+  uint64_t chunk_byte_size_;
+};
+
+DownloadOptions::DownloadOptions()
+    : parallelism_(8), chunk_byte_size_(16 * 1024 * 1024)
+{
+  // Invalid and zero values keep the default
+  const auto from_env = [](const char* name, uint64_t value) -> uint64_t {
+    const char* str = std::getenv(name);
+    const uint64_t env_value =
+        (str != nullptr) ? std::strtoull(str, nullptr, 10) : 0;
+    return (env_value > 0) ? env_value : value;
+  };
+  parallelism_ = from_env("TRITON_CLOUD_DOWNLOAD_PARALLELISM", parallelism_);
+  chunk_byte_size_ =
+      from_env("TRITON_CLOUD_DOWNLOAD_CHUNK_SIZE", chunk_byte_size_);
+}
+
+// Read 'byte_size' bytes of an object, starting at 'offset', into 'dst'.
+using RangeReadFunc =
+    std::function<Status(uint64_t offset, uint64_t byte_size, char* dst)>;
+
+// Download the object of 'byte_size' bytes read by 'read_fn' to the
+// file at 'local_path'. The object is read in chunks by up to
+// 'options.parallelism_' threads, each of which writes its chunks
+// straight to their place in the file, so at most one chunk per thread
+// is held in memory.
+Status
+DownloadRanges(
+    const std::string& local_path, const uint64_t byte_size,
+    const DownloadOptions& options, const RangeReadFunc& read_fn)
+{
+  // Create the file with its final size so that the chunks can be
+  // written in any order
+  {
+    std::ofstream output_file(local_path.c_str(), std::ios::binary);
+    if (byte_size > 0) {
+      output_file.seekp(byte_size - 1);
+      output_file.put('\0');
+    }
+    if (!output_file) {
+      return Status(
+          Status::Code::INTERNAL, "Failed to create local file: " + local_path);
+    }
+  }
+  if (byte_size == 0) {
+    return Status::Success;
+  }
+
+  const uint64_t chunk_count =
+      (byte_size + options.chunk_byte_size_ - 1) / options.chunk_byte_size_;
+  std::atomic<uint64_t> next_chunk(0);
+  std::mutex mu;
+  Status status;
+  auto download_fn = [&]() {
+    std::fstream output_file(
+        local_path.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+    std::vector<char> buffer;
+    for (uint64_t chunk = next_chunk++; chunk < chunk_count;
+         chunk = next_chunk++) {
+      const uint64_t offset = chunk * options.chunk_byte_size_;
+      const uint64_t chunk_byte_size =
+          std::min(options.chunk_byte_size_, byte_size - offset);
+      buffer.resize(chunk_byte_size);
+      Status chunk_status = read_fn(offset, chunk_byte_size, buffer.data());
+      if (chunk_status.IsOk()) {
+        output_file.seekp(offset);
+        output_file.write(buffer.data(), chunk_byte_size);
+        if (!output_file) {
+          chunk_status = Status(
+              Status::Code::INTERNAL,
+              "Failed to write local file: " + local_path);
+        }
+      }
+      if (!chunk_status.IsOk()) {
+        std::lock_guard<std::mutex> lk(mu);
+        if (status.IsOk()) {
+          status = chunk_status;
+        }
+        // Skip the remaining chunks
+        next_chunk = chunk_count;
+        return;
+      }
+    }
+  };
+
+  const size_t thread_count =
+      std::min<uint64_t>(options.parallelism_, chunk_count);
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < thread_count; ++i) {
+    threads.emplace_back(download_fn);
+  }
+  download_fn();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return status;
+}
+
+//
+// LocalizationCache
+//
+// Persistent cache of the files downloaded from cloud storage, enabled
+// by setting TRITON_CLOUD_CACHE_DIR to a local directory. A file is
+// cached under a key derived from its remote path and its version tag,
+// the ETag or generation of the object, so a changed object is never
+// served from the cache while the versions a model rolls back to are.
+// Once the cache holds more than TRITON_CLOUD_CACHE_SIZE bytes (default
+// 100 GB) the least recently used files are evicted.
+//
+// The cached files are hard-linked into the localized directories when
+// possible, so they must not be modified by the backends. The entries
+// being localized are never evicted by this process, an entry evicted
+// by another process sharing the directory is downloaded again.
+//
+class LocalizationCache {
+ public:
+  // Write the content of the remote file to the given local path
+  using DownloadFunc = std::function<Status(const std::string& local_path)>;
+
+  static LocalizationCache* Instance();
+
+  // Place the content of the file at 'remote_path' with version tag
+  // 'version' at 'local_path', from the cache if it holds the file and
+  // by calling 'download_fn' otherwise. The cache is bypassed if it is
+  // disabled or 'version' is empty.
+  Status Localize(
+      const std::string& remote_path, const std::string& version,
+      const std::string& local_path, const DownloadFunc& download_fn);
+
+ private:
+  LocalizationCache();
+
+  std::string EntryPath(
+      const std::string& remote_path, const std::string& version) const;
+  // Localize from the entry at 'entry_path', which must be pinned
+  Status LocalizeEntry(
+      const std::string& remote_path, const std::string& version,
+      const std::string& entry_path, const std::string& local_path,
+      const DownloadFunc& download_fn);
+  // Evict the least recently used entries until the cache fits its size
+  void Evict();
+
+  std::string dir_;
+  uint64_t max_byte_size_;
+  std::atomic<uint64_t> next_tmp_id_;
+  std::mutex mu_;
+  // The number of localizations using each entry, Evict() skips them
+  std::map<std::string, size_t> pinned_;
+};
+
+LocalizationCache*
+LocalizationCache::Instance()
+{
+  static LocalizationCache cache;
+  return &cache;
+}
+
+LocalizationCache::LocalizationCache()
+    : max_byte_size_(100ULL * 1024 * 1024 * 1024), next_tmp_id_(0)
+{
+#ifndef _WIN32
+  const char* dir = std::getenv("TRITON_CLOUD_CACHE_DIR");
+  if ((dir == nullptr) || (*dir == '\0')) {
+    return;
+  }
+  if ((mkdir(dir, S_IRWXU) != 0) && (errno != EEXIST)) {
+    LOG_WARNING << "Failed to create cloud storage cache directory '" << dir
+                << "', the cache is disabled: " << strerror(errno);
+    return;
+  }
+  dir_ = dir;
+  const char* size = std::getenv("TRITON_CLOUD_CACHE_SIZE");
+  if ((size != nullptr) && (std::strtoull(size, nullptr, 10) > 0)) {
+    max_byte_size_ = std::strtoull(size, nullptr, 10);
+  }
+  LOG_VERBOSE(1) << "Caching cloud storage files in '" << dir_ << "', up to "
+                 << max_byte_size_ << " bytes";
+#endif  // !_WIN32
+}
+
+std::string
+LocalizationCache::EntryPath(
+    const std::string& remote_path, const std::string& version) const
+{
+  // Keep the file name for readability
+  std::stringstream ss;
+  ss << std::hex << std::hash<std::string>()(remote_path + '\n' + version)
+     << '-' << remote_path.substr(remote_path.find_last_of('/') + 1);
+  return JoinPath({dir_, ss.str()});
+}
+
+Status
+LocalizationCache::Localize(
+    const std::string& remote_path, const std::string& version,
+    const std::string& local_path, const DownloadFunc& download_fn)
+{
+  if (dir_.empty() || version.empty()) {
+    return download_fn(local_path);
+  }
+
+#ifndef _WIN32
+  const std::string entry_path = EntryPath(remote_path, version);
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    ++pinned_[entry_path];
+  }
+  Status status = LocalizeEntry(
+      remote_path, version, entry_path, local_path, download_fn);
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto it = pinned_.find(entry_path);
+    if (--it->second == 0) {
+      pinned_.erase(it);
+    }
+  }
+  if (status.IsOk()) {
+    Evict();
+  }
+  return status;
+#else
+  return download_fn(local_path);
+#endif  // !_WIN32
+}
+
+Status
+LocalizationCache::LocalizeEntry(
+    const std::string& remote_path, const std::string& version,
+    const std::string& entry_path, const std::string& local_path,
+    const DownloadFunc& download_fn)
+{
+#ifndef _WIN32
+  if (access(entry_path.c_str(), F_OK) == 0) {
+    // Mark the entry as recently used
+    utime(entry_path.c_str(), nullptr);
+  } else {
+    // Download next to the entry and move it in place once complete, so
+    // that a partial download is never used
+    const std::string tmp_path = entry_path + ".tmp." +
+                                 std::to_string(getpid()) + "." +
+                                 std::to_string(next_tmp_id_++);
+    Status status = download_fn(tmp_path);
+    if (!status.IsOk()) {
+      unlink(tmp_path.c_str());
+      return status;
+    }
+    if (rename(tmp_path.c_str(), entry_path.c_str()) != 0) {
+      unlink(tmp_path.c_str());
+      return Status(
+          Status::Code::INTERNAL,
+          "Failed to add " + remote_path + " to the cloud storage cache: " +
+              strerror(errno));
+    }
+    LOG_VERBOSE(1) << "Added " << remote_path << " (" << version
+                   << ") to the cloud storage cache";
+  }
+
+  // Prefer linking the entry, copy it if the cache is on another file
+  // system
+  if (link(entry_path.c_str(), local_path.c_str()) != 0) {
+    if (errno == ENOENT) {
+      LOG_VERBOSE(1) << remote_path << " was evicted from the cloud storage "
+                     << "cache by another process, downloading it again";
+      return download_fn(local_path);
+    }
+    std::ifstream src(entry_path.c_str(), std::ios::binary);
+    std::ofstream dst(local_path.c_str(), std::ios::binary);
+    dst << src.rdbuf();
+    if (!src || !dst) {
+      return Status(
+          Status::Code::INTERNAL, "Failed to copy " + remote_path +
+                                      " from the cloud storage cache to " +
+                                      local_path);
+    }
+  }
+#endif  // !_WIN32
+  return Status::Success;
+}
+
+void
+LocalizationCache::Evict()
+{
+#ifndef _WIN32
+  std::lock_guard<std::mutex> lk(mu_);
+  DIR* dir = opendir(dir_.c_str());
+  if (dir == nullptr) {
+    return;
+  }
+
+  // (last use, byte size, path) of the complete entries
+  std::vector<std::tuple<time_t, uint64_t, std::string>> entries;
+  uint64_t total_byte_size = 0;
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != nullptr) {
+    const std::string name = entry->d_name;
+    if ((name == ".") || (name == "..") ||
+        (name.find(".tmp.") != std::string::npos)) {
+      continue;
+    }
+    const std::string path = JoinPath({dir_, name});
+    struct stat st;
+    if ((stat(path.c_str(), &st) != 0) || !S_ISREG(st.st_mode)) {
+      continue;
+    }
+    entries.emplace_back(st.st_mtime, st.st_size, path);
+    total_byte_size += st.st_size;
+  }
+  closedir(dir);
+
+  std::sort(entries.begin(), entries.end());
+  for (const auto& e : entries) {
+    if (total_byte_size <= max_byte_size_) {
+      break;
+    }
+    if (pinned_.find(std::get<2>(e)) != pinned_.end()) {
+      continue;
+    }
+    if (unlink(std::get<2>(e).c_str()) == 0) {
+      total_byte_size -= std::get<1>(e);
+      LOG_VERBOSE(1) << "Evicted " << std::get<2>(e)
+                     << " from the cloud storage cache";
+    }
+  }
+#endif  // !_WIN32
+}
+
 }}  // namespace triton::core
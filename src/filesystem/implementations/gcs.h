@@ -73,7 +73,14 @@ class GCSFileSystem : public FileSystem {
       const std::string& path, std::set<std::string>* subdirs) override;
   Status GetDirectoryFiles(
       const std::string& path, std::set<std::string>* files) override;
+  Status ListModificationTimes(
+      const std::string& path,
+      std::map<std::string, int64_t>* mtimes) override;
   Status ReadTextFile(const std::string& path, std::string* contents) override;
+  Status FileSize(const std::string& path, uint64_t* byte_size) override;
+  Status ReadRange(
+      const std::string& path, const uint64_t offset,
+      const uint64_t byte_size, char* dst) override;
   Status LocalizePath(
       const std::string& path,
       std::shared_ptr<LocalizedPath>* localized) override;
@@ -329,6 +336,35 @@ GCSFileSystem::GetDirectoryFiles(
   return Status::Success;
 }
 
+Status
+GCSFileSystem::ListModificationTimes(
+    const std::string& path, std::map<std::string, int64_t>* mtimes)
+{
+  std::string bucket, dir_path;
+  RETURN_IF_ERROR(ParsePath(path, &bucket, &dir_path));
+  const std::string full_dir = AppendSlash(dir_path);
+
+  for (auto&& object_metadata :
+       client_->ListObjects(bucket, gcs::Prefix(full_dir))) {
+    if (!object_metadata) {
+      return Status(
+          Status::Code::INTERNAL, "Could not list contents of directory at " +
+                                      path + " : " +
+                                      object_metadata.status().message());
+    }
+
+    AddListedModificationTime(
+        full_dir, object_metadata->name(),
+        std::chrono::time_point_cast<std::chrono::nanoseconds>(
+            object_metadata->updated())
+            .time_since_epoch()
+            .count(),
+        mtimes);
+  }
+
+  return Status::Success;
+}
+
 Status
 GCSFileSystem::ReadTextFile(const std::string& path, std::string* contents)
 {
@@ -361,6 +397,49 @@ GCSFileSystem::ReadTextFile(const std::string& path, std::string* contents)
   return Status::Success;
 }
 
+Status
+GCSFileSystem::FileSize(const std::string& path, uint64_t* byte_size)
+{
+  std::string bucket, object;
+  RETURN_IF_ERROR(ParsePath(path, &bucket, &object));
+
+  google::cloud::StatusOr<gcs::ObjectMetadata> object_metadata =
+      client_->GetObjectMetadata(bucket, object);
+  if (!object_metadata) {
+    return Status(
+        Status::Code::INTERNAL, "Failed to get object at " + path + " : " +
+                                    object_metadata.status().message());
+  }
+
+  *byte_size = object_metadata->size();
+  return Status::Success;
+}
+
+Status
+GCSFileSystem::ReadRange(
+    const std::string& path, const uint64_t offset, const uint64_t byte_size,
+    char* dst)
+{
+  std::string bucket, object;
+  RETURN_IF_ERROR(ParsePath(path, &bucket, &object));
+
+  gcs::ObjectReadStream filestream = client_->ReadObject(
+      bucket, object, gcs::ReadRange(offset, offset + byte_size));
+  if (!filestream) {
+    return Status(
+        Status::Code::INTERNAL, "Failed to get object at " + path + " : " +
+                                    filestream.status().message());
+  }
+  filestream.read(dst, byte_size);
+  if ((uint64_t)filestream.gcount() != byte_size) {
+    return Status(
+        Status::Code::INTERNAL, "Failed to get object at " + path +
+                                    ": fewer bytes received than requested");
+  }
+
+  return Status::Success;
+}
+
 Status
 GCSFileSystem::LocalizePath(
     const std::string& path, std::shared_ptr<LocalizedPath>* localized)
@@ -392,6 +471,7 @@ GCSFileSystem::LocalizePath(
     contents.insert(JoinPath({path, *itr}));
   }
 
+  const DownloadOptions download_options;
   while (contents.size() != 0) {
     std::set<std::string> tmp_contents = contents;
     contents.clear();
@@ -430,22 +510,31 @@ GCSFileSystem::LocalizePath(
         std::string file_bucket, file_object;
         RETURN_IF_ERROR(ParsePath(gcs_fpath, &file_bucket, &file_object));
 
-        // Send a request to read the object
-        gcs::ObjectReadStream filestream =
-            client_->ReadObject(file_bucket, file_object);
-        if (!filestream) {
+        google::cloud::StatusOr<gcs::ObjectMetadata> object_metadata =
+            client_->GetObjectMetadata(file_bucket, file_object);
+        if (!object_metadata) {
           return Status(
               Status::Code::INTERNAL, "Failed to get object at " + *iter +
                                           " : " +
-                                          filestream.status().message());
+                                          object_metadata.status().message());
         }
 
+        // Download the object in ranges, in parallel
+        auto read_fn = [&](uint64_t offset, uint64_t byte_size,
+                           char* dst) -> Status {
+          return ReadRange(gcs_fpath, offset, byte_size, dst);
+        };
+
         std::string gcs_removed_path = (*iter).substr(path.size());
         std::string local_file_path =
             JoinPath({(*localized)->Path(), gcs_removed_path});
-        std::ofstream output_file(local_file_path.c_str(), std::ios::binary);
-        output_file << filestream.rdbuf();
-        output_file.close();
+        const uint64_t byte_size = object_metadata->size();
+        RETURN_IF_ERROR(LocalizationCache::Instance()->Localize(
+            gcs_fpath, std::to_string(object_metadata->generation()),
+            local_file_path, [&](const std::string& download_path) {
+              return DownloadRanges(
+                  download_path, byte_size, download_options, read_fn);
+            }));
       }
     }
   }
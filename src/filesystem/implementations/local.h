@@ -47,7 +47,14 @@ class LocalFileSystem : public FileSystem {
       const std::string& path, std::set<std::string>* subdirs) override;
   Status GetDirectoryFiles(
       const std::string& path, std::set<std::string>* files) override;
+  Status ListModificationTimes(
+      const std::string& path,
+      std::map<std::string, int64_t>* mtimes) override;
   Status ReadTextFile(const std::string& path, std::string* contents) override;
+  Status FileSize(const std::string& path, uint64_t* byte_size) override;
+  Status ReadRange(
+      const std::string& path, const uint64_t offset,
+      const uint64_t byte_size, char* dst) override;
   Status LocalizePath(
       const std::string& path,
       std::shared_ptr<LocalizedPath>* localized) override;
@@ -183,6 +190,32 @@ LocalFileSystem::GetDirectoryFiles(
   return Status::Success;
 }
 
+Status
+LocalFileSystem::ListModificationTimes(
+    const std::string& path, std::map<std::string, int64_t>* mtimes)
+{
+  std::set<std::string> contents;
+  RETURN_IF_ERROR(GetDirectoryContents(path, &contents));
+  for (const auto& child : contents) {
+    const auto full_path = JoinPath({path, child});
+    int64_t mtime_ns;
+    RETURN_IF_ERROR(FileModificationTime(full_path, &mtime_ns));
+    (*mtimes)[child] = mtime_ns;
+
+    bool is_dir;
+    RETURN_IF_ERROR(IsDirectory(full_path, &is_dir));
+    if (is_dir) {
+      std::map<std::string, int64_t> child_mtimes;
+      RETURN_IF_ERROR(ListModificationTimes(full_path, &child_mtimes));
+      for (const auto& entry : child_mtimes) {
+        (*mtimes)[JoinPath({child, entry.first})] = entry.second;
+      }
+    }
+  }
+
+  return Status::Success;
+}
+
 Status
 LocalFileSystem::ReadTextFile(const std::string& path, std::string* contents)
 {
@@ -202,6 +235,43 @@ LocalFileSystem::ReadTextFile(const std::string& path, std::string* contents)
   return Status::Success;
 }
 
+Status
+LocalFileSystem::FileSize(const std::string& path, uint64_t* byte_size)
+{
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    return Status(Status::Code::INTERNAL, "failed to stat file " + path);
+  }
+
+  *byte_size = st.st_size;
+  return Status::Success;
+}
+
+Status
+LocalFileSystem::ReadRange(
+    const std::string& path, const uint64_t offset, const uint64_t byte_size,
+    char* dst)
+{
+  std::ifstream in(path, std::ios::in | std::ios::binary);
+  if (!in) {
+    return Status(
+        Status::Code::INTERNAL,
+        "failed to open file for read " + path + ": " + strerror(errno));
+  }
+
+  in.seekg(offset);
+  in.read(dst, byte_size);
+  if ((uint64_t)in.gcount() != byte_size) {
+    return Status(
+        Status::Code::INTERNAL, "failed to read " +
+                                    std::to_string(byte_size) +
+                                    " bytes at offset " +
+                                    std::to_string(offset) + " of " + path);
+  }
+
+  return Status::Success;
+}
+
 Status
 LocalFileSystem::LocalizePath(
     const std::string& path, std::shared_ptr<LocalizedPath>* localized)
@@ -40,6 +40,7 @@
 #include <aws/s3/model/HeadBucketRequest.h>
 #include <aws/s3/model/HeadObjectRequest.h>
 #include <aws/s3/model/ListObjectsRequest.h>
+#include <aws/s3/model/ListObjectsV2Request.h>
 
 namespace triton { namespace core {
 
@@ -149,7 +150,14 @@ class S3FileSystem : public FileSystem {
       const std::string& path, std::set<std::string>* subdirs) override;
   Status GetDirectoryFiles(
       const std::string& path, std::set<std::string>* files) override;
+  Status ListModificationTimes(
+      const std::string& path,
+      std::map<std::string, int64_t>* mtimes) override;
   Status ReadTextFile(const std::string& path, std::string* contents) override;
+  Status FileSize(const std::string& path, uint64_t* byte_size) override;
+  Status ReadRange(
+      const std::string& path, const uint64_t offset,
+      const uint64_t byte_size, char* dst) override;
   Status LocalizePath(
       const std::string& path,
       std::shared_ptr<LocalizedPath>* localized) override;
@@ -575,6 +583,45 @@ S3FileSystem::GetDirectoryFiles(
   return Status::Success;
 }
 
+Status
+S3FileSystem::ListModificationTimes(
+    const std::string& path, std::map<std::string, int64_t>* mtimes)
+{
+  std::string bucket, dir_path;
+  RETURN_IF_ERROR(ParsePath(path, &bucket, &dir_path));
+  const std::string full_dir = AppendSlash(dir_path);
+
+  // List every object with the prefix, the listing is paginated
+  s3::Model::ListObjectsV2Request objects_request;
+  objects_request.SetBucket(bucket.c_str());
+  objects_request.SetPrefix(full_dir.c_str());
+  while (true) {
+    auto list_objects_outcome = client_->ListObjectsV2(objects_request);
+    if (!list_objects_outcome.IsSuccess()) {
+      return Status(
+          Status::Code::INTERNAL,
+          "Could not list contents of directory at " + path +
+              " due to exception: " +
+              list_objects_outcome.GetError().GetExceptionName() +
+              ", error message: " +
+              list_objects_outcome.GetError().GetMessage());
+    }
+
+    const auto& result = list_objects_outcome.GetResult();
+    for (const auto& s3_object : result.GetContents()) {
+      AddListedModificationTime(
+          full_dir, s3_object.GetKey().c_str(),
+          s3_object.GetLastModified().Millis() * NANOS_PER_MILLIS, mtimes);
+    }
+    if (!result.GetIsTruncated()) {
+      break;
+    }
+    objects_request.SetContinuationToken(result.GetNextContinuationToken());
+  }
+
+  return Status::Success;
+}
+
 Status
 S3FileSystem::ReadTextFile(const std::string& path, std::string* contents)
 {
@@ -615,6 +662,68 @@ S3FileSystem::ReadTextFile(const std::string& path, std::string* contents)
   return Status::Success;
 }
 
+Status
+S3FileSystem::FileSize(const std::string& path, uint64_t* byte_size)
+{
+  std::string bucket, object;
+  RETURN_IF_ERROR(ParsePath(path, &bucket, &object));
+
+  s3::Model::HeadObjectRequest head_request;
+  head_request.SetBucket(bucket.c_str());
+  head_request.SetKey(object.c_str());
+  auto head_object_outcome = client_->HeadObject(head_request);
+  if (!head_object_outcome.IsSuccess()) {
+    return Status(
+        Status::Code::INTERNAL,
+        "Failed to get object at " + path + " due to exception: " +
+            head_object_outcome.GetError().GetExceptionName() +
+            ", error message: " + head_object_outcome.GetError().GetMessage());
+  }
+
+  *byte_size = head_object_outcome.GetResult().GetContentLength();
+  return Status::Success;
+}
+
+Status
+S3FileSystem::ReadRange(
+    const std::string& path, const uint64_t offset, const uint64_t byte_size,
+    char* dst)
+{
+  if (byte_size == 0) {
+    return Status::Success;
+  }
+
+  std::string bucket, object;
+  RETURN_IF_ERROR(ParsePath(path, &bucket, &object));
+
+  s3::Model::GetObjectRequest object_request;
+  object_request.SetBucket(bucket.c_str());
+  object_request.SetKey(object.c_str());
+  object_request.SetRange(
+      ("bytes=" + std::to_string(offset) + "-" +
+       std::to_string(offset + byte_size - 1))
+          .c_str());
+
+  auto get_object_outcome = client_->GetObject(object_request);
+  if (!get_object_outcome.IsSuccess()) {
+    return Status(
+        Status::Code::INTERNAL,
+        "Failed to get object at " + path + " due to exception: " +
+            get_object_outcome.GetError().GetExceptionName() +
+            ", error message: " + get_object_outcome.GetError().GetMessage());
+  }
+  auto& retrieved_file = get_object_outcome.GetResultWithOwnership().GetBody();
+  retrieved_file.read(dst, byte_size);
+  if ((uint64_t)retrieved_file.gcount() != byte_size) {
+    return Status(
+        Status::Code::INTERNAL,
+        "Failed to get object at " + path +
+            ": fewer bytes received than requested");
+  }
+
+  return Status::Success;
+}
+
 Status
 S3FileSystem::LocalizePath(
     const std::string& path, std::shared_ptr<LocalizedPath>* localized)
@@ -670,6 +779,7 @@ S3FileSystem::LocalizePath(
   }
 
   // Download all specified contents and nested contents
+  const DownloadOptions download_options;
   while (contents.size() != 0) {
     std::set<std::string> tmp_contents = contents;
     contents.clear();
@@ -710,25 +820,32 @@ S3FileSystem::LocalizePath(
         std::string file_bucket, file_object;
         RETURN_IF_ERROR(ParsePath(s3_fpath, &file_bucket, &file_object));
 
-        s3::Model::GetObjectRequest object_request;
-        object_request.SetBucket(file_bucket.c_str());
-        object_request.SetKey(file_object.c_str());
-
-        auto get_object_outcome = client_->GetObject(object_request);
-        if (get_object_outcome.IsSuccess()) {
-          auto& retrieved_file =
-              get_object_outcome.GetResultWithOwnership().GetBody();
-          std::ofstream output_file(local_fpath.c_str(), std::ios::binary);
-          output_file << retrieved_file.rdbuf();
-          output_file.close();
-        } else {
+        s3::Model::HeadObjectRequest head_request;
+        head_request.SetBucket(file_bucket.c_str());
+        head_request.SetKey(file_object.c_str());
+        auto head_object_outcome = client_->HeadObject(head_request);
+        if (!head_object_outcome.IsSuccess()) {
           return Status(
               Status::Code::INTERNAL,
               "Failed to get object at " + s3_fpath + " due to exception: " +
-                  get_object_outcome.GetError().GetExceptionName() +
+                  head_object_outcome.GetError().GetExceptionName() +
                   ", error message: " +
-                  get_object_outcome.GetError().GetMessage());
+                  head_object_outcome.GetError().GetMessage());
         }
+
+        // Download the object in ranges, in parallel
+        auto read_fn = [&](uint64_t offset, uint64_t byte_size,
+                           char* dst) -> Status {
+          return ReadRange(s3_fpath, offset, byte_size, dst);
+        };
+        const uint64_t byte_size =
+            head_object_outcome.GetResult().GetContentLength();
+        RETURN_IF_ERROR(LocalizationCache::Instance()->Localize(
+            s3_fpath, head_object_outcome.GetResult().GetETag().c_str(),
+            local_fpath, [&](const std::string& download_path) {
+              return DownloadRanges(
+                  download_path, byte_size, download_options, read_fn);
+            }));
       }
     }
   }
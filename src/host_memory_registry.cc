@@ -0,0 +1,152 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "host_memory_registry.h"
+
+#include <sstream>
+#include "triton/common/logging.h"
+
+#ifdef TRITON_ENABLE_GPU
+#include <cuda_runtime_api.h>
+#endif  // TRITON_ENABLE_GPU
+
+namespace triton { namespace core {
+
+std::mutex HostMemoryRegistry::mu_;
+std::map<uintptr_t, HostMemoryRegistry::Registration>
+    HostMemoryRegistry::registrations_;
+std::atomic<size_t> HostMemoryRegistry::registration_count_(0);
+
+namespace {
+
+std::string
+PointerToString(const void* ptr)
+{
+  std::stringstream ss;
+  ss << ptr;
+  return ss.str();
+}
+
+}  // namespace
+
+Status
+HostMemoryRegistry::Register(void* base, size_t byte_size)
+{
+  if ((base == nullptr) || (byte_size == 0)) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "host memory to register must be a non-empty buffer");
+  }
+
+  std::lock_guard<std::mutex> lk(mu_);
+  const uintptr_t key = reinterpret_cast<uintptr_t>(base);
+  auto it = registrations_.find(key);
+  if (it != registrations_.end()) {
+    if (it->second.byte_size_ != byte_size) {
+      return Status(
+          Status::Code::ALREADY_EXISTS,
+          "host memory at '" + PointerToString(base) +
+              "' is already registered with byte size " +
+              std::to_string(it->second.byte_size_));
+    }
+    ++it->second.ref_count_;
+    return Status::Success;
+  }
+
+#ifdef TRITON_ENABLE_GPU
+  auto err = cudaHostRegister(base, byte_size, cudaHostRegisterPortable);
+  if (err != cudaSuccess) {
+    return Status(
+        Status::Code::INTERNAL, "failed to register host memory at '" +
+                                    PointerToString(base) +
+                                    "': " + cudaGetErrorString(err));
+  }
+#else
+  return Status(
+      Status::Code::UNSUPPORTED,
+      "host memory registration requires GPU support");
+#endif  // TRITON_ENABLE_GPU
+
+  registrations_.emplace(key, Registration{byte_size, 1});
+  registration_count_.store(registrations_.size());
+  LOG_VERBOSE(1) << "registered host memory at '" << base << "' with size "
+                 << byte_size;
+  return Status::Success;
+}
+
+Status
+HostMemoryRegistry::Unregister(void* base)
+{
+  std::lock_guard<std::mutex> lk(mu_);
+  auto it = registrations_.find(reinterpret_cast<uintptr_t>(base));
+  if (it == registrations_.end()) {
+    return Status(
+        Status::Code::NOT_FOUND,
+        "host memory at '" + PointerToString(base) + "' is not registered");
+  }
+  if (--it->second.ref_count_ != 0) {
+    return Status::Success;
+  }
+
+  registrations_.erase(it);
+  registration_count_.store(registrations_.size());
+#ifdef TRITON_ENABLE_GPU
+  auto err = cudaHostUnregister(base);
+  if (err != cudaSuccess) {
+    return Status(
+        Status::Code::INTERNAL, "failed to unregister host memory at '" +
+                                    PointerToString(base) +
+                                    "': " + cudaGetErrorString(err));
+  }
+#endif  // TRITON_ENABLE_GPU
+  LOG_VERBOSE(1) << "unregistered host memory at '" << base << "'";
+  return Status::Success;
+}
+
+TRITONSERVER_MemoryType
+HostMemoryRegistry::MemoryType(
+    const void* base, size_t byte_size, TRITONSERVER_MemoryType memory_type)
+{
+  if ((memory_type != TRITONSERVER_MEMORY_CPU) ||
+      (registration_count_.load(std::memory_order_relaxed) == 0)) {
+    return memory_type;
+  }
+
+  const uintptr_t start = reinterpret_cast<uintptr_t>(base);
+  std::lock_guard<std::mutex> lk(mu_);
+  // The registration with the highest base address not above 'base'
+  auto it = registrations_.upper_bound(start);
+  if (it == registrations_.begin()) {
+    return memory_type;
+  }
+  --it;
+  if ((start + byte_size) <= (it->first + it->second.byte_size_)) {
+    return TRITONSERVER_MEMORY_CPU_PINNED;
+  }
+  return memory_type;
+}
+
+}}  // namespace triton::core
@@ -0,0 +1,75 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include "status.h"
+#include "tritonserver_apis.h"
+
+namespace triton { namespace core {
+
+//
+// Long-lived host buffers, such as shared memory regions, that are
+// registered with the CUDA driver via cudaHostRegister. Input data that
+// lies within a registered buffer is reported to the backends as pinned
+// memory so that device copies DMA straight from it instead of being
+// staged through the pinned memory pool.
+//
+class HostMemoryRegistry {
+ public:
+  // Register ['base', 'base' + 'byte_size'). Registering a buffer that is
+  // already registered only adds a reference to the registration.
+  static Status Register(void* base, size_t byte_size);
+
+  // Drop a reference to the registration of the buffer at 'base'. The
+  // buffer is unregistered from the CUDA driver with the last reference,
+  // it must no longer be used as input data by then.
+  static Status Unregister(void* base);
+
+  // Return TRITONSERVER_MEMORY_CPU_PINNED if 'memory_type' is
+  // TRITONSERVER_MEMORY_CPU and ['base', 'base' + 'byte_size') lies
+  // within a registered buffer, return 'memory_type' otherwise.
+  static TRITONSERVER_MemoryType MemoryType(
+      const void* base, size_t byte_size, TRITONSERVER_MemoryType memory_type);
+
+ private:
+  struct Registration {
+    size_t byte_size_;
+    size_t ref_count_;
+  };
+
+  static std::mutex mu_;
+  // The registrations by base address
+  static std::map<uintptr_t, Registration> registrations_;
+  // The size of 'registrations_', so that lookups are free while nothing
+  // is registered.
+  static std::atomic<size_t> registration_count_;
+};
+
+}}  // namespace triton::core
@@ -27,10 +27,14 @@
 #include "infer_request.h"
 
 #include <algorithm>
+#include <cstring>
 #include <deque>
 
+#include "bytes_tensor.h"
+#include "host_memory_registry.h"
 #include "model.h"
 #include "model_config_utils.h"
+#include "profiling.h"
 #include "server.h"
 #include "triton/common/logging.h"
 #ifdef TRITON_ENABLE_TRACING
@@ -104,7 +108,9 @@ InferenceRequest::InferenceRequest(
     Model* model, const int64_t requested_model_version)
     : needs_normalization_(true), model_raw_(model),
       requested_model_version_(requested_model_version), flags_(0),
-      correlation_id_(0), batch_size_(0), timeout_us_(0), collect_stats_(true)
+      correlation_id_(0), batch_size_(0), timeout_us_(0),
+      arena_(std::make_shared<RequestArena>()),
+      original_inputs_(InputMap::allocator_type(arena_)), collect_stats_(true)
 {
   SetPriority(0);
 }
@@ -157,6 +163,11 @@ Status
 InferenceRequest::TraceInputTensors(
     TRITONSERVER_InferenceTraceActivity activity, const std::string& msg)
 {
+  // Avoid gathering the input data if it isn't reported
+  if ((trace_ == nullptr) || !trace_->TracesTensors()) {
+    return Status::Success;
+  }
+
   const auto& inputs = this->ImmutableInputs();
   TRITONSERVER_MemoryType dst_memory_type = TRITONSERVER_MEMORY_CPU;
   int64_t dst_memory_type_id = 0;
@@ -267,12 +278,31 @@ InferenceRequest::OutputBufferProperties(
     return Status(
         Status::Code::UNAVAILABLE,
         (LogRequest() + "Output properties are not available").c_str());
-  } else {
-    RETURN_IF_TRITONSERVER_ERROR(allocator->QueryFn()(
-        reinterpret_cast<TRITONSERVER_ResponseAllocator*>(
-            const_cast<ResponseAllocator*>(allocator)),
-        response_factory_->AllocatorUserp(), name, byte_size, memory_type,
-        memory_type_id));
+  }
+
+  // An unnamed query carries too little information to be reused
+  const bool cacheable = allocator->QueryStable() && (name != nullptr);
+  std::tuple<std::string, TRITONSERVER_MemoryType, int64_t> key;
+  if (cacheable) {
+    key = std::make_tuple(std::string(name), *memory_type, *memory_type_id);
+    std::lock_guard<std::mutex> lk(output_properties_mu_);
+    auto it = output_properties_.find(key);
+    if (it != output_properties_.end()) {
+      *memory_type = it->second.first;
+      *memory_type_id = it->second.second;
+      return Status::Success;
+    }
+  }
+
+  RETURN_IF_TRITONSERVER_ERROR(allocator->QueryFn()(
+      reinterpret_cast<TRITONSERVER_ResponseAllocator*>(
+          const_cast<ResponseAllocator*>(allocator)),
+      response_factory_->AllocatorUserp(), name, byte_size, memory_type,
+      memory_type_id));
+  if (cacheable) {
+    std::lock_guard<std::mutex> lk(output_properties_mu_);
+    output_properties_.emplace(
+        std::move(key), std::make_pair(*memory_type, *memory_type_id));
   }
   return Status::Success;
 }
@@ -283,6 +313,34 @@ InferenceRequest::Run(std::unique_ptr<InferenceRequest>& request)
   return request->model_raw_->Enqueue(request);
 }
 
+void
+InferenceRequest::RunBatch(
+    std::vector<std::unique_ptr<InferenceRequest>>& requests)
+{
+  // Keep the submission order within each model, a batch typically
+  // targets very few models.
+  using ModelRequests =
+      std::pair<Model*, std::vector<std::unique_ptr<InferenceRequest>>>;
+  std::vector<ModelRequests> model_requests;
+  for (auto& request : requests) {
+    Model* model = request->model_raw_;
+    auto it = std::find_if(
+        model_requests.begin(), model_requests.end(),
+        [model](const ModelRequests& entry) { return entry.first == model; });
+    if (it == model_requests.end()) {
+      model_requests.emplace_back(
+          model, std::vector<std::unique_ptr<InferenceRequest>>());
+      it = model_requests.end() - 1;
+    }
+    it->second.emplace_back(std::move(request));
+  }
+  requests.clear();
+
+  for (auto& entry : model_requests) {
+    entry.first->EnqueueBatch(entry.second);
+  }
+}
+
 void
 InferenceRequest::RespondIfError(
     std::unique_ptr<InferenceRequest>& request, const Status& status,
@@ -501,6 +559,7 @@ InferenceRequest::CopyAsNull(const InferenceRequest& from)
   for (auto& pr : lrequest->original_inputs_) {
     lrequest->inputs_.emplace(
         std::make_pair(pr.second.Name(), std::addressof(pr.second)));
+    lrequest->indexed_inputs_.push_back(std::addressof(pr.second));
   }
 
   return lrequest.release();
@@ -545,7 +604,7 @@ InferenceRequest::AddOriginalInput(
 {
   const auto& pr = original_inputs_.emplace(
       std::piecewise_construct, std::forward_as_tuple(name),
-      std::forward_as_tuple(name, datatype, shape, dim_count));
+      std::forward_as_tuple(name, datatype, shape, dim_count, arena_));
   if (!pr.second) {
     return Status(
         Status::Code::INVALID_ARG,
@@ -580,7 +639,7 @@ InferenceRequest::AddRawInput(
   }
   const auto& pr = original_inputs_.emplace(
       std::piecewise_construct, std::forward_as_tuple(name),
-      std::forward_as_tuple());
+      std::forward_as_tuple(arena_));
   if (!pr.second) {
     return Status(
         Status::Code::INVALID_ARG,
@@ -615,7 +674,13 @@ InferenceRequest::RemoveOriginalInput(const std::string& name)
 Status
 InferenceRequest::RemoveAllOriginalInputs()
 {
-  original_inputs_.clear();
+  // Release the buckets of the map too so that the arena can be rewound.
+  // If the data of an input is still referenced the arena is left to it.
+  original_inputs_ = InputMap(InputMap::allocator_type(arena_));
+  if (!arena_->Reset()) {
+    arena_ = std::make_shared<RequestArena>();
+    original_inputs_ = InputMap(InputMap::allocator_type(arena_));
+  }
   raw_input_name_.clear();
   needs_normalization_ = true;
   return Status::Success;
@@ -662,7 +727,12 @@ InferenceRequest::AddOverrideInput(
   // Add or replace this override in the inputs...
   const auto res = inputs_.emplace(std::make_pair(input->Name(), input.get()));
   if (!res.second) {
+    std::replace(
+        indexed_inputs_.begin(), indexed_inputs_.end(), res.first->second,
+        input.get());
     res.first->second = input.get();
+  } else {
+    indexed_inputs_.push_back(input.get());
   }
 
   LOG_VERBOSE(1) << LogRequest() << "added input override for " << input->Name()
@@ -721,9 +791,12 @@ InferenceRequest::RemoveAllOriginalRequestedOutputs()
 Status
 InferenceRequest::PrepareForInference()
 {
+  PROFILE_RANGE(range, "PrepareForInference");
+
   // Remove override inputs as those are added during any previous
   // inference execution.
   inputs_.clear();
+  indexed_inputs_.clear();
   override_inputs_.clear();
 
   // Renormalize if anything has changed in the inference request in a
@@ -736,10 +809,10 @@ InferenceRequest::PrepareForInference()
   // Initially show the actual inputs to be only the original
   // inputs. If overrides are added later they will be added to
   // 'inputs_'.
-  for (auto& pr : original_inputs_) {
-    inputs_.emplace(
-        std::make_pair(pr.second.Name(), std::addressof(pr.second)));
+  for (Input* input : config_ordered_inputs_) {
+    inputs_.emplace(std::make_pair(input->Name(), input));
   }
+  indexed_inputs_ = config_ordered_inputs_;
 
   // Clear the timestamps
   queue_start_ns_ = 0;
@@ -753,9 +826,63 @@ InferenceRequest::PrepareForInference()
   return Status::Success;
 }
 
+Status
+InferenceRequest::Reset()
+{
+  id_.clear();
+  flags_ = 0;
+  correlation_id_ = SequenceId(0);
+  SetPriority(0);
+  timeout_us_ = 0;
+  cache_key_.clear();
+  cache_key_is_set_ = false;
+
+  // Keep the inputs and the buckets of the maps, only the data is
+  // provided again for the next inference.
+  for (auto& pr : original_inputs_) {
+    RETURN_IF_ERROR(pr.second.RemoveAllData());
+  }
+  inputs_.clear();
+  indexed_inputs_.clear();
+  override_inputs_.clear();
+  // The raw input is normalized based on its data.
+  if (!raw_input_name_.empty()) {
+    needs_normalization_ = true;
+  }
+
+  release_fn_ = nullptr;
+  release_userp_ = nullptr;
+  release_callbacks_.clear();
+  response_delegator_ = nullptr;
+  response_factory_.reset();
+  parameters_.clear();
+  sequence_states_.reset();
+
+  queue_start_ns_ = 0;
+  cache_lookup_start_ns_ = 0;
+  cache_lookup_end_ns_ = 0;
+  cache_insertion_start_ns_ = 0;
+  cache_insertion_end_ns_ = 0;
+  batcher_start_ns_ = 0;
+  collect_stats_ = true;
+  cancelled_ = false;
+  cancel_parent_ = nullptr;
+#ifdef TRITON_ENABLE_STATS
+  request_start_ns_ = 0;
+  secondary_stats_aggregator_ = nullptr;
+#endif  // TRITON_ENABLE_STATS
+#ifdef TRITON_ENABLE_TRACING
+  trace_.reset();
+#endif  // TRITON_ENABLE_TRACING
+
+  return Status::Success;
+}
+
 Status
 InferenceRequest::Normalize()
 {
+  PROFILE_RANGE(range, "Normalize");
+
   const inference::ModelConfig& model_config = model_raw_->Config();
 
   // Fill metadata for raw input
@@ -873,6 +1000,29 @@ InferenceRequest::Normalize()
     }
   }
 
+  // Look up the plan of each input once. The plans are in the
+  // iteration order of 'original_inputs_'.
+  std::vector<const Model::InputPlan*> input_plans;
+  input_plans.reserve(original_inputs_.size());
+  for (const auto& pr : original_inputs_) {
+    const Model::InputPlan* plan;
+    RETURN_IF_ERROR(model_raw_->GetInputPlan(pr.second.Name(), &plan));
+    input_plans.push_back(plan);
+  }
+
+  // Place the inputs in the order of the model configuration, the
+  // number of inputs was checked against the configuration above.
+  config_ordered_inputs_.assign(model_config.input_size(), nullptr);
+  size_t input_idx = 0;
+  for (auto& pr : original_inputs_) {
+    config_ordered_inputs_[input_plans[input_idx++]->index_] = &pr.second;
+  }
+  config_ordered_inputs_.erase(
+      std::remove(
+          config_ordered_inputs_.begin(), config_ordered_inputs_.end(),
+          nullptr),
+      config_ordered_inputs_.end());
+
   // Determine the batch size and shape of each input.
   if (model_config.max_batch_size() == 0) {
     // Model does not support Triton-style batching so set as
@@ -888,14 +1038,14 @@ InferenceRequest::Normalize()
     // size. Adjust the shape of the input tensors to remove the batch
     // dimension.
     batch_size_ = 0;
+    size_t plan_idx = 0;
     for (auto& pr : original_inputs_) {
       auto& input = pr.second;
+      const Model::InputPlan* plan = input_plans[plan_idx++];
 
       // For a shape tensor, keep the tensor's shape as it is and mark
       // that the input is a shape tensor.
-      const inference::ModelInput* input_config;
-      RETURN_IF_ERROR(model_raw_->GetInput(input.Name(), &input_config));
-      if (input_config->is_shape_tensor()) {
+      if (plan->is_shape_tensor_) {
         *input.MutableShape() = input.OriginalShape();
         input.SetIsShapeTensor(true);
         continue;
@@ -936,34 +1086,34 @@ InferenceRequest::Normalize()
 
   // Verify that each input shape is valid for the model, make
   // adjustments for reshapes and find the total tensor size.
+  size_t plan_idx = 0;
   for (auto& pr : original_inputs_) {
-    const inference::ModelInput* input_config;
-    RETURN_IF_ERROR(model_raw_->GetInput(pr.second.Name(), &input_config));
+    const Model::InputPlan* plan = input_plans[plan_idx++];
 
     auto& input = pr.second;
     auto shape = input.MutableShape();
 
-    if (input.DType() != input_config->data_type()) {
+    if (input.DType() != plan->data_type_) {
       return Status(
           Status::Code::INVALID_ARG,
           LogRequest() + "inference input data-type is '" +
               std::string(
                   triton::common::DataTypeToProtocolString(input.DType())) +
               "', model expects '" +
-              std::string(triton::common::DataTypeToProtocolString(
-                  input_config->data_type())) +
+              std::string(
+                  triton::common::DataTypeToProtocolString(plan->data_type_)) +
               "' for '" + ModelName() + "'");
     }
 
     // Validate input shape
     {
       bool match_config = true;
-      const auto& config_dims = input_config->dims();
+      const auto& config_dims = plan->dims_;
       const auto& input_dims = *shape;
-      if (config_dims.size() != (int64_t)input_dims.size()) {
+      if (config_dims.size() != input_dims.size()) {
         match_config = false;
       } else {
-        for (int i = 0; i < config_dims.size(); ++i) {
+        for (size_t i = 0; i < config_dims.size(); ++i) {
           if (input_dims[i] == triton::common::WILDCARD_DIM) {
             return Status(
                 Status::Code::INVALID_ARG,
@@ -993,8 +1143,8 @@ InferenceRequest::Normalize()
               "See the model configuration docs for more info on "
               "max_batch_size.";
         }
-        for (int i = 0; i < input_config->dims_size(); ++i) {
-          full_dims.Add(input_config->dims(i));
+        for (const auto dim : plan->dims_) {
+          full_dims.Add(dim);
         }
         return Status(
             Status::Code::INVALID_ARG,
@@ -1010,16 +1160,16 @@ InferenceRequest::Normalize()
     // match the reshape. As reshape may have variable-size
     // dimensions, we need to record corresponding value so that we
     // can set the value correctly for reshape.
-    if (input_config->has_reshape()) {
+    if (plan->has_reshape_) {
       std::deque<int64_t> variable_size_values;
-      for (int64_t idx = 0; idx < input_config->dims_size(); idx++) {
-        if (input_config->dims(idx) == -1) {
+      for (size_t idx = 0; idx < plan->dims_.size(); idx++) {
+        if (plan->dims_[idx] == -1) {
           variable_size_values.push_back((*shape)[idx]);
         }
       }
 
       shape->clear();
-      for (const auto& dim : input_config->reshape().shape()) {
+      for (const auto& dim : plan->reshape_) {
         if (dim == -1) {
           shape->push_back(variable_size_values.front());
           variable_size_values.pop_front();
@@ -1159,7 +1309,8 @@ InferenceRequest::ReportStatisticsCacheHit(MetricModelReporter* metric_reporter)
 //
 InferenceRequest::Input::Input()
     : is_shape_tensor_(false), data_(new MemoryReference),
-      has_host_policy_specific_data_(false)
+      has_host_policy_specific_data_(false),
+      replicate_for_host_policy_(false)
 {
 }
 
@@ -1168,7 +1319,8 @@ InferenceRequest::Input::Input(
     const int64_t* shape, const uint64_t dim_count)
     : name_(name), datatype_(datatype),
       original_shape_(shape, shape + dim_count), is_shape_tensor_(false),
-      data_(new MemoryReference), has_host_policy_specific_data_(false)
+      data_(new MemoryReference), has_host_policy_specific_data_(false),
+      replicate_for_host_policy_(false)
 {
 }
 
@@ -1177,7 +1329,30 @@ InferenceRequest::Input::Input(
     const std::vector<int64_t>& shape)
     : name_(name), datatype_(datatype), original_shape_(shape),
       is_shape_tensor_(false), data_(new MemoryReference),
-      has_host_policy_specific_data_(false)
+      has_host_policy_specific_data_(false),
+      replicate_for_host_policy_(false)
+{
+}
+
+InferenceRequest::Input::Input(const std::shared_ptr<RequestArena>& arena)
+    : is_shape_tensor_(false),
+      data_(std::allocate_shared<MemoryReference>(
+          ArenaAllocator<MemoryReference>(arena))),
+      has_host_policy_specific_data_(false),
+      replicate_for_host_policy_(false)
+{
+}
+
+InferenceRequest::Input::Input(
+    const std::string& name, const inference::DataType datatype,
+    const int64_t* shape, const uint64_t dim_count,
+    const std::shared_ptr<RequestArena>& arena)
+    : name_(name), datatype_(datatype),
+      original_shape_(shape, shape + dim_count), is_shape_tensor_(false),
+      data_(std::allocate_shared<MemoryReference>(
+          ArenaAllocator<MemoryReference>(arena))),
+      has_host_policy_specific_data_(false),
+      replicate_for_host_policy_(false)
 {
 }
 
@@ -1201,13 +1376,67 @@ InferenceRequest::Input::SetIsShapeTensor(const bool is_shape_tensor)
 const std::shared_ptr<Memory>&
 InferenceRequest::Input::Data(const std::string& host_policy_name) const
 {
+  if (!replicate_for_host_policy_) {
+    auto device_data = host_policy_data_map_.find(host_policy_name);
+    if (device_data == host_policy_data_map_.end()) {
+      // Fall back on default data if there is no data that has been added
+      // for this host policy
+      return data_;
+    }
+    return device_data->second;
+  }
+
+  std::lock_guard<std::mutex> lk(host_policy_mu_);
   auto device_data = host_policy_data_map_.find(host_policy_name);
-  if (device_data == host_policy_data_map_.end()) {
-    // Fall back on default data if there is no data that has been added for
-    // this host policy
+  if (device_data != host_policy_data_map_.end()) {
+    return device_data->second;
+  }
+  std::shared_ptr<Memory> replica = CreateHostReplica();
+  if (replica == nullptr) {
     return data_;
   }
-  return device_data->second;
+  return host_policy_data_map_.emplace(host_policy_name, std::move(replica))
+      .first->second;
+}
+
+std::shared_ptr<Memory>
+InferenceRequest::Input::CreateHostReplica() const
+{
+  // Only data in host memory is replicated, the placement of device
+  // memory doesn't depend on the host policy.
+  const size_t byte_size = data_->TotalByteSize();
+  if (byte_size == 0) {
+    return nullptr;
+  }
+  for (size_t idx = 0; idx < data_->BufferCount(); ++idx) {
+    size_t buffer_byte_size;
+    TRITONSERVER_MemoryType memory_type;
+    int64_t memory_type_id;
+    data_->BufferAt(idx, &buffer_byte_size, &memory_type, &memory_type_id);
+    if (memory_type == TRITONSERVER_MEMORY_GPU) {
+      return nullptr;
+    }
+  }
+
+  // The pinned memory manager allocates from the pool of the NUMA node
+  // the calling thread is bound to, falling back to system memory that
+  // is first touched by the copy below.
+  auto replica = std::make_shared<AllocatedMemory>(
+      byte_size, TRITONSERVER_MEMORY_CPU_PINNED, 0 /* memory_type_id */);
+  char* dst = replica->MutableBuffer();
+  if (dst == nullptr) {
+    return nullptr;
+  }
+  for (size_t idx = 0; idx < data_->BufferCount(); ++idx) {
+    size_t buffer_byte_size;
+    TRITONSERVER_MemoryType memory_type;
+    int64_t memory_type_id;
+    const char* src =
+        data_->BufferAt(idx, &buffer_byte_size, &memory_type, &memory_type_id);
+    std::memcpy(dst, src, buffer_byte_size);
+    dst += buffer_byte_size;
+  }
+  return replica;
 }
 
 Status
@@ -1217,7 +1446,9 @@ InferenceRequest::Input::AppendData(
 {
   if (byte_size > 0) {
     std::static_pointer_cast<MemoryReference>(data_)->AddBuffer(
-        static_cast<const char*>(base), byte_size, memory_type, memory_type_id);
+        static_cast<const char*>(base), byte_size,
+        HostMemoryRegistry::MemoryType(base, byte_size, memory_type),
+        memory_type_id);
   }
 
   return Status::Success;
@@ -1228,12 +1459,68 @@ InferenceRequest::Input::AppendDataWithBufferAttributes(
     const void* base, BufferAttributes* buffer_attributes)
 {
   if (buffer_attributes->ByteSize() > 0) {
+    BufferAttributes attributes = *buffer_attributes;
+    attributes.SetMemoryType(HostMemoryRegistry::MemoryType(
+        base, attributes.ByteSize(), attributes.MemoryType()));
     std::static_pointer_cast<MemoryReference>(data_)->AddBuffer(
-        static_cast<const char*>(base), buffer_attributes);
+        static_cast<const char*>(base), &attributes);
   }
   return Status::Success;
 }
 
+Status
+InferenceRequest::Input::AppendDataFromCudaIpcHandle(
+    const void* cuda_ipc_handle, size_t byte_offset, size_t byte_size,
+    int64_t device_id)
+{
+  if (byte_size == 0) {
+    return Status::Success;
+  }
+
+  std::shared_ptr<CudaIpcCache::Mapping> mapping;
+  RETURN_IF_ERROR(CudaIpcCache::Open(cuda_ipc_handle, device_id, &mapping));
+  BufferAttributes attributes(
+      byte_size, TRITONSERVER_MEMORY_GPU, device_id,
+      static_cast<char*>(const_cast<void*>(cuda_ipc_handle)));
+  std::static_pointer_cast<MemoryReference>(data_)->AddBuffer(
+      mapping->Base() + byte_offset, &attributes);
+  ipc_mappings_.emplace_back(std::move(mapping));
+  return Status::Success;
+}
+
+Status
+InferenceRequest::Input::AppendDataFromBytesOffsets(
+    const char* data, const uint64_t* offsets, size_t element_count)
+{
+  if (datatype_ != inference::DataType::TYPE_STRING) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "input '" + name_ + "' of datatype " +
+            triton::common::DataTypeToProtocolString(datatype_) +
+            " can't be given in offsets+data form, only BYTES inputs can");
+  }
+  if (element_count == 0) {
+    return Status::Success;
+  }
+
+  // Validate the offsets before anything is allocated for them
+  size_t serialized_byte_size = 0;
+  RETURN_IF_ERROR(
+      SerializedBytesSize(offsets, element_count, &serialized_byte_size));
+  std::shared_ptr<AllocatedMemory> serialized =
+      std::make_shared<AllocatedMemory>(
+          serialized_byte_size, TRITONSERVER_MEMORY_CPU,
+          0 /* memory_type_id */);
+  TRITONSERVER_MemoryType memory_type;
+  int64_t memory_type_id;
+  char* buffer = serialized->MutableBuffer(&memory_type, &memory_type_id);
+  SerializeBytes(data, offsets, element_count, buffer);
+  RETURN_IF_ERROR(AppendData(
+      buffer, serialized->TotalByteSize(), memory_type, memory_type_id));
+  converted_data_.emplace_back(std::move(serialized));
+  return Status::Success;
+}
+
 Status
 InferenceRequest::Input::AppendDataWithHostPolicy(
     const void* base, size_t byte_size, TRITONSERVER_MemoryType memory_type,
@@ -1249,7 +1536,8 @@ InferenceRequest::Input::AppendDataWithHostPolicy(
   if (byte_size > 0) {
     std::static_pointer_cast<MemoryReference>(device_data->second)
         ->AddBuffer(
-            static_cast<const char*>(base), byte_size, memory_type,
+            static_cast<const char*>(base), byte_size,
+            HostMemoryRegistry::MemoryType(base, byte_size, memory_type),
             memory_type_id);
   }
 
@@ -1263,7 +1551,9 @@ InferenceRequest::Input::PrependData(
 {
   if (byte_size > 0) {
     std::static_pointer_cast<MemoryReference>(data_)->AddBufferFront(
-        static_cast<const char*>(base), byte_size, memory_type, memory_type_id);
+        static_cast<const char*>(base), byte_size,
+        HostMemoryRegistry::MemoryType(base, byte_size, memory_type),
+        memory_type_id);
   }
 
   return Status::Success;
@@ -1303,9 +1593,17 @@ InferenceRequest::Input::SetData(
 Status
 InferenceRequest::Input::RemoveAllData()
 {
-  data_ = std::make_shared<MemoryReference>();
+  // Reuse the memory reference if nothing else refers to it
+  MemoryReference* reference = dynamic_cast<MemoryReference*>(data_.get());
+  if ((reference != nullptr) && (data_.use_count() == 1)) {
+    reference->Clear();
+  } else {
+    data_ = std::make_shared<MemoryReference>();
+  }
   host_policy_data_map_.clear();
   has_host_policy_specific_data_ = false;
+  ipc_mappings_.clear();
+  converted_data_.clear();
   return Status::Success;
 }
 
@@ -1335,14 +1633,10 @@ InferenceRequest::Input::DataBufferForHostPolicy(
     TRITONSERVER_MemoryType* memory_type, int64_t* memory_type_id,
     const std::string& host_policy_name) const
 {
-  auto device_data = host_policy_data_map_.find(host_policy_name);
-  if (device_data == host_policy_data_map_.end()) {
-    // Return data buffer if there is no host-policy specific buffer available
-    *base = data_->BufferAt(idx, byte_size, memory_type, memory_type_id);
-  } else {
-    *base = device_data->second->BufferAt(
-        idx, byte_size, memory_type, memory_type_id);
-  }
+  // Returns the data buffer if there is no host-policy specific buffer
+  // available
+  *base = Data(host_policy_name)
+              ->BufferAt(idx, byte_size, memory_type, memory_type_id);
 
   return Status::Success;
 }
@@ -1351,11 +1645,7 @@ size_t
 InferenceRequest::Input::DataBufferCountForHostPolicy(
     const std::string& host_policy_name) const
 {
-  auto policy_data = host_policy_data_map_.find(host_policy_name);
-  if (policy_data != host_policy_data_map_.end()) {
-    return policy_data->second->BufferCount();
-  }
-  return data_->BufferCount();
+  return Data(host_policy_name)->BufferCount();
 }
 
 InferenceRequest::SequenceId::SequenceId()
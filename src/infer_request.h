@@ -25,15 +25,22 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <atomic>
 #include <functional>
+#include <map>
+#include <mutex>
 #include <string>
+#include <tuple>
 #include <unordered_map>
 #include <vector>
 #include "buffer_attributes.h"
+#include "clock.h"
+#include "cuda_ipc_cache.h"
 #include "infer_response.h"
 #include "infer_stats.h"
 #include "infer_trace.h"
 #include "memory.h"
+#include "request_arena.h"
 #include "response_allocator.h"
 #include "sequence_state.h"
 #include "status.h"
@@ -67,6 +74,13 @@ class InferenceRequest {
         const std::string& name, const inference::DataType datatype,
         const int64_t* shape, const uint64_t dim_count);
 
+    // Same as above but the data of the input is allocated from 'arena'
+    explicit Input(const std::shared_ptr<RequestArena>& arena);
+    Input(
+        const std::string& name, const inference::DataType datatype,
+        const int64_t* shape, const uint64_t dim_count,
+        const std::shared_ptr<RequestArena>& arena);
+
     // Set the name, data type and original shape of the input tensor.
     void SetMetadata(
         const std::string& name, const inference::DataType& dt,
@@ -110,6 +124,17 @@ class InferenceRequest {
       return has_host_policy_specific_data_;
     }
 
+    // Whether a replica of the data is created for a host policy the
+    // first time the data is read for a host policy that has no data
+    // of its own. The replica is allocated by the thread reading it,
+    // so it is placed on the NUMA node of that host policy, and is
+    // kept until the data of the input is removed.
+    bool ReplicateForHostPolicy() const { return replicate_for_host_policy_; }
+    void SetReplicateForHostPolicy(const bool replicate)
+    {
+      replicate_for_host_policy_ = replicate;
+    }
+
     // Whether or not the input is a tensorrt shape tensor
     bool IsShapeTensor() const { return is_shape_tensor_; }
 
@@ -119,7 +144,9 @@ class InferenceRequest {
     // The data for this input.
     const std::shared_ptr<Memory>& Data() const { return data_; }
 
-    // The data for this input for a specific device
+    // The data for this input for a specific device. Creates the
+    // replica of the data for 'host_policy_name' if requested by
+    // SetReplicateForHostPolicy().
     const std::shared_ptr<Memory>& Data(
         const std::string& host_policy_name) const;
 
@@ -151,6 +178,22 @@ class InferenceRequest {
     Status AppendDataWithBufferAttributes(
         const void* base, BufferAttributes* buffer_attributes);
 
+    // Append the 'byte_size' bytes at 'byte_offset' within the GPU
+    // allocation exported by the CUDA IPC memory handle
+    // 'cuda_ipc_handle' on device 'device_id'. The handle is opened
+    // through CudaIpcCache and the mapping is held until the data of the
+    // input is removed.
+    Status AppendDataFromCudaIpcHandle(
+        const void* cuda_ipc_handle, size_t byte_offset, size_t byte_size,
+        int64_t device_id);
+
+    // Append the 'element_count' elements of a BYTES input given in
+    // offsets+data form, see ContiguousBytes. The elements are converted
+    // into a buffer in the length-prefixed serialization owned by the
+    // input, so 'data' and 'offsets' need not outlive the call.
+    Status AppendDataFromBytesOffsets(
+        const char* data, const uint64_t* offsets, size_t element_count);
+
     // Prepend a new buffer of data to this input.
     Status PrependData(
         const void* base, size_t byte_size, TRITONSERVER_MemoryType memory_type,
@@ -219,12 +262,31 @@ class InferenceRequest {
     std::vector<int64_t> shape_with_batch_dim_;
     bool is_shape_tensor_;
     std::shared_ptr<Memory> data_;
+    // The opened CUDA IPC memory handles that 'data_' refers to
+    std::vector<std::shared_ptr<CudaIpcCache::Mapping>> ipc_mappings_;
+    // The serialized buffers converted from offsets+data form that
+    // 'data_' refers to
+    std::vector<std::shared_ptr<Memory>> converted_data_;
+
+    // Return a copy of 'data_' in host memory allocated by the calling
+    // thread, or nullptr if 'data_' can't be replicated.
+    std::shared_ptr<Memory> CreateHostReplica() const;
 
     bool has_host_policy_specific_data_;
+    bool replicate_for_host_policy_;
+    // Guards the insertion of replicas into 'host_policy_data_map_'
+    mutable std::mutex host_policy_mu_;
     // A map of host policy to input data memory
-    std::map<std::string, std::shared_ptr<Memory>> host_policy_data_map_;
+    mutable std::map<std::string, std::shared_ptr<Memory>>
+        host_policy_data_map_;
   };
 
+  // The original inputs of a request by name, allocated from the arena
+  // of the request.
+  using InputMap = std::unordered_map<
+      std::string, Input, std::hash<std::string>, std::equal_to<std::string>,
+      ArenaAllocator<std::pair<const std::string, Input>>>;
+
   // Sequence ID can be either a 64 bit integer or a string.
   // This class implements the SequenceId type
   class SequenceId {
@@ -276,6 +338,7 @@ class InferenceRequest {
   InferenceRequest(Model* model, const int64_t requested_model_version);
 
   const std::string& ModelName() const;
+  Model* ModelRaw() const { return model_raw_; }
   int64_t RequestedModelVersion() const { return requested_model_version_; }
   int64_t ActualModelVersion() const;
 
@@ -295,6 +358,36 @@ class InferenceRequest {
   uint32_t Flags() const { return flags_; }
   void SetFlags(uint32_t f) { flags_ = f; }
 
+  // Mark the request as cancelled. May be called from any thread while
+  // the request is in flight. A cancelled request that is still queued
+  // is rejected by the scheduler, or when its payload is about to be
+  // executed, and a backend executing it can stop early by polling
+  // IsCancelled().
+  void Cancel() { cancelled_ = true; }
+  bool IsCancelled() const
+  {
+    return cancelled_ ||
+           ((cancel_parent_ != nullptr) && cancel_parent_->IsCancelled());
+  }
+
+  // Make the request cancelled whenever 'parent' is, as for the step
+  // requests of an ensemble request. 'parent' must outlive the request.
+  void FollowCancellation(const InferenceRequest& parent)
+  {
+    cancel_parent_ = &parent;
+  }
+
+  // Whether the request was created by Triton to warm up a model
+  // instance.
+  bool IsWarmup() const { return warmup_; }
+  void SetWarmup(const bool warmup) { warmup_ = warmup; }
+
+  // Whether the request was created by an ensemble for one of its steps.
+  // The input bytes of a step request are already charged to the server
+  // by the ensemble request.
+  bool IsEnsembleStep() const { return ensemble_step_; }
+  void SetEnsembleStep(const bool step) { ensemble_step_ = step; }
+
   const SequenceId& CorrelationId() const { return correlation_id_; }
   void SetCorrelationId(const SequenceId& c) { correlation_id_ = c; }
 
@@ -324,15 +417,24 @@ class InferenceRequest {
 #ifdef TRITON_ENABLE_TRACING
   const std::shared_ptr<InferenceTraceProxy>& Trace() const { return trace_; }
   std::shared_ptr<InferenceTraceProxy>* MutableTrace() { return &trace_; }
+  // The responses only share the trace to report their output tensors,
+  // otherwise they hold it weakly to mark their failures and don't
+  // extend its lifetime.
   void SetTrace(const std::shared_ptr<InferenceTraceProxy>& trace)
   {
     trace_ = trace;
-    response_factory_->SetTrace(trace);
+    if ((trace != nullptr) && trace->TracesTensors()) {
+      response_factory_->SetTrace(trace);
+    } else {
+      response_factory_->ReleaseTrace();
+    }
+    response_factory_->SetFailureTrace(trace);
   }
   void ReleaseTrace()
   {
     trace_ = nullptr;
     response_factory_->ReleaseTrace();
+    response_factory_->SetFailureTrace(nullptr);
   }
 
   Status TraceInputTensors(
@@ -356,14 +458,8 @@ class InferenceRequest {
   // execution completes (and those modifications will apply to the
   // next inference execution).
   Status MutableOriginalInput(const std::string& name, Input** input);
-  std::unordered_map<std::string, Input>* MutableOriginalInputs()
-  {
-    return &original_inputs_;
-  }
-  const std::unordered_map<std::string, Input>& OriginalInputs() const
-  {
-    return original_inputs_;
-  }
+  InputMap* MutableOriginalInputs() { return &original_inputs_; }
+  const InputMap& OriginalInputs() const { return original_inputs_; }
 
   // The override inputs are the inputs added to the request after
   // inference execution has started (that is after
@@ -399,6 +495,14 @@ class InferenceRequest {
     return inputs_;
   }
 
+  // Get the same inputs as ImmutableInputs() by index. The original
+  // inputs come first in the order of the model configuration,
+  // followed by the inputs that only exist as overrides.
+  const std::vector<Input*>& ImmutableIndexedInputs() const
+  {
+    return indexed_inputs_;
+  }
+
   // The original requested outputs are the requested outputs added to
   // the request before the inference execution (that is before
   // TRITONSERVER_ServerInferAsync is called). Once execution has
@@ -483,6 +587,8 @@ class InferenceRequest {
     response_factory_.reset(new InferenceResponseFactory(
         model_shared_, id_, allocator, alloc_userp, response_fn, response_userp,
         response_delegator_));
+    std::lock_guard<std::mutex> lk(output_properties_mu_);
+    output_properties_.clear();
     return Status::Success;
   }
 
@@ -492,7 +598,9 @@ class InferenceRequest {
   // 'memory_type' and 'memory_type_id' are also used as input to provide types
   // preferred by the caller.
   // Status::Code::UNAVAILABLE will be returned if output properties are not
-  // available.
+  // available. If the allocator declared its query result stable, the
+  // result for a named output is reused for the same preferred types
+  // instead of querying the allocator again.
   Status OutputBufferProperties(
       const char* name, size_t* byte_size, TRITONSERVER_MemoryType* memory_type,
       int64_t* memory_type_id);
@@ -534,6 +642,14 @@ class InferenceRequest {
   // Prepare this request for inference.
   Status PrepareForInference();
 
+  // Clear the per-inference state of this request so that it can be
+  // reused for another inference. The original inputs are kept with
+  // their properties but without data, and the requested outputs are
+  // kept, so the normalization done for the previous inference is
+  // reused unless the inputs or outputs are changed. The release and
+  // response callbacks must be set again.
+  Status Reset();
+
   // Run this inference request using the model associated with the
   // request. If Status::Success is returned then the call has taken
   // ownership of the request object and so 'request' will be
@@ -541,6 +657,13 @@ class InferenceRequest {
   // ownership of 'request'.
   static Status Run(std::unique_ptr<InferenceRequest>& request);
 
+  // Run a batch of inference requests, the requests of the same model
+  // are handed to the model together. The call takes ownership of all
+  // 'requests', a request that can't be run is completed with an error
+  // response and released.
+  static void RunBatch(
+      std::vector<std::unique_ptr<InferenceRequest>>& requests);
+
   // Send an error response for this request. If 'status' is Success
   // then no response is sent and the request is not released (even if
   // 'release_request' is true). Because this is sending an error it
@@ -582,38 +705,38 @@ class InferenceRequest {
   uint64_t QueueStartNs() const { return queue_start_ns_; }
   uint64_t CaptureQueueStartNs()
   {
-    queue_start_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
-                          std::chrono::steady_clock::now().time_since_epoch())
-                          .count();
+    queue_start_ns_ = SteadyClockNs();
     return queue_start_ns_;
   }
 
+  // Record the start of the execution of the request in its response
+  // factory if the request asked for a latency breakdown.
+  void CaptureExecutionStartNs()
+  {
+    if (((flags_ & TRITONSERVER_REQUEST_FLAG_LATENCY_BREAKDOWN) != 0) &&
+        (response_factory_ != nullptr)) {
+      response_factory_->SetLatencyBreakdown(queue_start_ns_, SteadyClockNs());
+    }
+  }
+
   uint64_t CacheLookupStartNs() const { return cache_lookup_start_ns_; }
   uint64_t CaptureCacheLookupStartNs()
   {
-    cache_lookup_start_ns_ =
-        std::chrono::duration_cast<std::chrono::nanoseconds>(
-            std::chrono::steady_clock::now().time_since_epoch())
-            .count();
+    cache_lookup_start_ns_ = SteadyClockNs();
     return cache_lookup_start_ns_;
   }
 
   uint64_t CacheLookupEndNs() const { return cache_lookup_end_ns_; }
   uint64_t CaptureCacheLookupEndNs()
   {
-    cache_lookup_end_ns_ =
-        std::chrono::duration_cast<std::chrono::nanoseconds>(
-            std::chrono::steady_clock::now().time_since_epoch())
-            .count();
+    cache_lookup_end_ns_ = SteadyClockNs();
     return cache_lookup_end_ns_;
   }
 
   uint64_t BatcherStartNs() const { return batcher_start_ns_; }
   uint64_t CaptureBatcherStartNs()
   {
-    batcher_start_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
-                            std::chrono::steady_clock::now().time_since_epoch())
-                            .count();
+    batcher_start_ns_ = SteadyClockNs();
     return batcher_start_ns_;
   }
 
@@ -621,9 +744,7 @@ class InferenceRequest {
   uint64_t RequestStartNs() const { return request_start_ns_; }
   uint64_t CaptureRequestStartNs()
   {
-    request_start_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
-                            std::chrono::steady_clock::now().time_since_epoch())
-                            .count();
+    request_start_ns_ = SteadyClockNs();
     return request_start_ns_;
   }
 
@@ -698,9 +819,16 @@ class InferenceRequest {
   // and cache_key_ field is valid
   bool cache_key_is_set_ = false;
 
-  std::unordered_map<std::string, Input> original_inputs_;
+  // Backs the original inputs and their data, so that adding an input
+  // doesn't call malloc.
+  std::shared_ptr<RequestArena> arena_;
+  InputMap original_inputs_;
   std::unordered_map<std::string, std::shared_ptr<Input>> override_inputs_;
   std::unordered_map<std::string, Input*> inputs_;
+  std::vector<Input*> indexed_inputs_;
+  // The original inputs in the order of the model configuration, set
+  // by normalization.
+  std::vector<Input*> config_ordered_inputs_;
   std::set<std::string> original_requested_outputs_;
   std::string raw_input_name_;
   uint32_t raw_input_size_;
@@ -724,6 +852,15 @@ class InferenceRequest {
   // The response factory associated with this request.
   std::shared_ptr<InferenceResponseFactory> response_factory_;
 
+  // The allocator query results of OutputBufferProperties() by output
+  // name and caller preferred memory type and id, only kept if the
+  // allocator declared its query result stable.
+  std::mutex output_properties_mu_;
+  std::map<
+      std::tuple<std::string, TRITONSERVER_MemoryType, int64_t>,
+      std::pair<TRITONSERVER_MemoryType, int64_t>>
+      output_properties_;
+
   // Request timestamps. Queue start is needed for schedulers even
   // when statistics are not being collected.
   uint64_t queue_start_ns_;
@@ -746,6 +883,15 @@ class InferenceRequest {
   // Whether the stats of the request should be collected.
   bool collect_stats_;
 
+  // Whether the request has been cancelled.
+  std::atomic<bool> cancelled_{false};
+  // The request this request is part of, if any, see FollowCancellation().
+  const InferenceRequest* cancel_parent_{nullptr};
+
+  // Whether the request is a warmup request.
+  bool warmup_{false};
+  bool ensemble_step_{false};
+
   // The parameters of the request. Use a deque so that there is no
   // reallocation.
   std::deque<InferenceParameter> parameters_;
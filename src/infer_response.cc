@@ -26,35 +26,105 @@
 
 #include "infer_response.h"
 
+#include "classification.h"
+#include "clock.h"
+#include "cuda_utils.h"
 #include "model.h"
 #include "model_config_utils.h"
+#include "profiling.h"
 #include "server.h"
 #include "triton/common/logging.h"
 
 namespace triton { namespace core {
 
+//
+// InferenceResponsePool
+//
+std::unique_ptr<InferenceResponse>
+InferenceResponsePool::Take()
+{
+  std::lock_guard<std::mutex> lk(mu_);
+  if (responses_.empty()) {
+    return nullptr;
+  }
+  std::unique_ptr<InferenceResponse> response = std::move(responses_.back());
+  responses_.pop_back();
+  return response;
+}
+
+void
+InferenceResponsePool::Return(std::unique_ptr<InferenceResponse>&& response)
+{
+  std::lock_guard<std::mutex> lk(mu_);
+  if (responses_.size() < kMaxPooledCount) {
+    responses_.emplace_back(std::move(response));
+  }
+}
+
 //
 // InferenceResponseFactory
 //
+InferenceResponseFactory::InferenceResponseFactory(
+    const std::shared_ptr<Model>& model, const std::string& id,
+    const ResponseAllocator* allocator, void* alloc_userp,
+    TRITONSERVER_InferenceResponseCompleteFn_t response_fn,
+    void* response_userp,
+    const std::function<
+        void(std::unique_ptr<InferenceResponse>&&, const uint32_t)>& delegator)
+    : model_(model), id_(id), allocator_(allocator), alloc_userp_(alloc_userp),
+      response_fn_(response_fn), response_userp_(response_userp),
+      response_delegator_(delegator)
+{
+  if ((model_ != nullptr) &&
+      model_->Config().model_transaction_policy().decoupled()) {
+    pool_ = std::make_shared<InferenceResponsePool>();
+  }
+}
+
 Status
 InferenceResponseFactory::CreateResponse(
     std::unique_ptr<InferenceResponse>* response) const
 {
-  response->reset(new InferenceResponse(
-      model_, id_, allocator_, alloc_userp_, response_fn_, response_userp_,
-      response_delegator_));
+  PROFILE_RANGE(range, "CreateResponse");
+
+  if (pool_ != nullptr) {
+    *response = pool_->Take();
+  }
+  if (*response != nullptr) {
+    (*response)->Reuse(
+        model_, id_, allocator_, alloc_userp_, response_fn_, response_userp_,
+        response_delegator_, pool_);
+  } else {
+    response->reset(new InferenceResponse(
+        model_, id_, allocator_, alloc_userp_, response_fn_, response_userp_,
+        response_delegator_));
+    (*response)->pool_ = pool_;
+  }
+  (*response)->response_userp_owner_ = response_userp_owner_;
 #ifdef TRITON_ENABLE_TRACING
   (*response)->SetTrace(trace_);
+  (*response)->failure_trace_ = failure_trace_;
 #endif  // TRITON_ENABLE_TRACING
+  if (compute_start_ns_ != 0) {
+    if (queue_start_ns_ != 0) {
+      RETURN_IF_ERROR((*response)->AddParameter(
+          "triton_queue_ns",
+          static_cast<int64_t>(compute_start_ns_ - queue_start_ns_)));
+    }
+    (*response)->compute_start_ns_ = compute_start_ns_;
+  }
   return Status::Success;
 }
 
 Status
 InferenceResponseFactory::SendFlags(const uint32_t flags) const
 {
+  PROFILE_RANGE(range, "SendFlags");
+
   if (response_delegator_ != nullptr) {
     std::unique_ptr<InferenceResponse> response(
         new InferenceResponse(response_fn_, response_userp_));
+    response->response_userp_owner_ = response_userp_owner_;
     response_delegator_(std::move(response), flags);
   } else {
     void* userp = response_userp_;
@@ -75,7 +145,62 @@ InferenceResponse::InferenceResponse(
         void(std::unique_ptr<InferenceResponse>&&, const uint32_t)>& delegator)
     : model_(model), id_(id), allocator_(allocator), alloc_userp_(alloc_userp),
       response_fn_(response_fn), response_userp_(response_userp),
-      response_delegator_(delegator), null_response_(false)
+      response_delegator_(delegator), null_response_(false),
+      compute_start_ns_(0)
+{
+  StartAllocation();
+}
+
+InferenceResponse::InferenceResponse(
+    TRITONSERVER_InferenceResponseCompleteFn_t response_fn,
+    void* response_userp)
+    : response_fn_(response_fn), response_userp_(response_userp),
+      null_response_(true), compute_start_ns_(0)
+{
+}
+
+void
+InferenceResponse::Reuse(
+    const std::shared_ptr<Model>& model, const std::string& id,
+    const ResponseAllocator* allocator, void* alloc_userp,
+    TRITONSERVER_InferenceResponseCompleteFn_t response_fn,
+    void* response_userp,
+    const std::function<
+        void(std::unique_ptr<InferenceResponse>&&, const uint32_t)>& delegator,
+    const std::shared_ptr<InferenceResponsePool>& pool)
+{
+  model_ = model;
+  id_ = id;
+  allocator_ = allocator;
+  alloc_userp_ = alloc_userp;
+  response_fn_ = response_fn;
+  response_userp_ = response_userp;
+  response_delegator_ = delegator;
+  pool_ = pool;
+  StartAllocation();
+}
+
+void
+InferenceResponse::Clear()
+{
+  // Release the output buffers before the model, as in destruction
+  outputs_.clear();
+  classifications_.clear();
+  bytes_outputs_.clear();
+  parameters_.clear();
+  status_ = Status::Success;
+  model_.reset();
+  response_userp_owner_.reset();
+  response_delegator_ = nullptr;
+  compute_start_ns_ = 0;
+#ifdef TRITON_ENABLE_TRACING
+  trace_.reset();
+  failure_trace_.reset();
+#endif  // TRITON_ENABLE_TRACING
+}
+
+void
+InferenceResponse::StartAllocation()
 {
   // If the allocator has a start_fn then invoke it.
   TRITONSERVER_ResponseAllocatorStartFn_t start_fn = allocator_->StartFn();
@@ -89,12 +214,19 @@ InferenceResponse::InferenceResponse(
   }
 }
 
-InferenceResponse::InferenceResponse(
-    TRITONSERVER_InferenceResponseCompleteFn_t response_fn,
-    void* response_userp)
-    : response_fn_(response_fn), response_userp_(response_userp),
-      null_response_(true)
+void
+InferenceResponse::Delete(InferenceResponse* response)
 {
+  // The pool is released from the response so that the pooled responses
+  // don't keep it alive.
+  std::shared_ptr<InferenceResponsePool> pool = std::move(response->pool_);
+  if (pool == nullptr) {
+    delete response;
+    return;
+  }
+
+  response->Clear();
+  pool->Return(std::unique_ptr<InferenceResponse>(response));
 }
 
 const std::string&
@@ -198,13 +330,150 @@ InferenceResponse::ClassificationLabel(
   return Status::Success;
 }
 
+Status
+InferenceResponse::HostOutputBuffer(
+    const Output& output, const char* purpose, const void** base,
+    size_t* byte_size, std::unique_ptr<char[]>* staging) const
+{
+  TRITONSERVER_MemoryType memory_type;
+  int64_t memory_type_id;
+  void* userp;
+  RETURN_IF_ERROR(output.DataBuffer(
+      base, byte_size, &memory_type, &memory_type_id, &userp));
+  if ((*base == nullptr) && (*byte_size != 0)) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "output '" + output.Name() + "' has no data for " + purpose);
+  }
+
+  // Only the data of an output in GPU memory is copied, the result of
+  // the conversion is built on the host either way.
+  if (memory_type == TRITONSERVER_MEMORY_GPU) {
+    staging->reset(new char[*byte_size]);
+    bool cuda_used = false;
+    RETURN_IF_ERROR(CopyBuffer(
+        std::string(purpose) + " '" + output.Name() + "'", memory_type,
+        memory_type_id, TRITONSERVER_MEMORY_CPU, 0 /* dst_memory_type_id */,
+        *byte_size, *base, staging->get(), nullptr /* cuda_stream */,
+        &cuda_used));
+#ifdef TRITON_ENABLE_GPU
+    if (cuda_used) {
+      RETURN_IF_CUDA_ERR(
+          cudaStreamSynchronize(nullptr),
+          std::string("failed to copy output '") + output.Name() + "' for " +
+              purpose);
+    }
+#endif  // TRITON_ENABLE_GPU
+    *base = staging->get();
+  }
+
+  return Status::Success;
+}
+
+Status
+InferenceResponse::TopKClassifications(
+    const uint32_t index, const uint32_t class_count,
+    const Classifications** classifications)
+{
+  if (index >= outputs_.size()) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "out of bounds index " + std::to_string(index) +
+            std::string(": response has ") + std::to_string(outputs_.size()) +
+            " outputs");
+  }
+
+  const Output& output = outputs_[index];
+  const void* base;
+  size_t byte_size;
+  std::unique_ptr<char[]> staging;
+  RETURN_IF_ERROR(
+      HostOutputBuffer(output, "classification", &base, &byte_size, &staging));
+
+  const size_t element_byte_size =
+      triton::common::GetDataTypeByteSize(output.DType());
+  const size_t element_count =
+      (element_byte_size == 0) ? 0 : (byte_size / element_byte_size);
+
+  Classifications& result = classifications_[index];
+  RETURN_IF_ERROR(TopKClasses(
+      base, output.DType(), element_count, class_count, &result.indices_,
+      &result.scores_));
+
+  // Look the labels up once for the output rather than per class
+  static const std::vector<std::string> no_labels;
+  const std::vector<std::string>* labels = &no_labels;
+  if (model_ != nullptr) {
+    labels = &model_->GetLabelProvider()->GetLabels(output.Name());
+  }
+  result.labels_.clear();
+  for (const uint64_t class_index : result.indices_) {
+    result.labels_.push_back(
+        ((class_index < labels->size()) && !(*labels)[class_index].empty())
+            ? (*labels)[class_index].c_str()
+            : nullptr);
+  }
+
+  *classifications = &result;
+  return Status::Success;
+}
+
+Status
+InferenceResponse::ContiguousBytesOutput(
+    const uint32_t index, const ContiguousBytes** bytes)
+{
+  if (index >= outputs_.size()) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "out of bounds index " + std::to_string(index) +
+            std::string(": response has ") + std::to_string(outputs_.size()) +
+            " outputs");
+  }
+
+  const Output& output = outputs_[index];
+  if (output.DType() != inference::DataType::TYPE_STRING) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "output '" + output.Name() + "' of datatype " +
+            triton::common::DataTypeToProtocolString(output.DType()) +
+            " has no offsets+data form, only BYTES outputs have");
+  }
+
+  // A result computed by an earlier call is still valid, the output
+  // data doesn't change once the response is complete.
+  auto it = bytes_outputs_.find(index);
+  if (it == bytes_outputs_.end()) {
+    const void* base;
+    size_t byte_size;
+    std::unique_ptr<char[]> staging;
+    RETURN_IF_ERROR(HostOutputBuffer(
+        output, "offsets+data conversion", &base, &byte_size, &staging));
+    ContiguousBytes result;
+    RETURN_IF_ERROR(DeserializeBytes(
+        static_cast<const char*>(base), byte_size,
+        triton::common::GetElementCount(output.Shape()), &result));
+    it = bytes_outputs_.emplace(index, std::move(result)).first;
+  }
+
+  *bytes = &it->second;
+  return Status::Success;
+}
+
 Status
 InferenceResponse::Send(
     std::unique_ptr<InferenceResponse>&& response, const uint32_t flags)
 {
+  PROFILE_RANGE(range, "ResponseSend");
+
 #ifdef TRITON_ENABLE_TRACING
   response->TraceOutputTensors(
       TRITONSERVER_TRACE_TENSOR_BACKEND_OUTPUT, "InferenceResponse Send");
+  if (!response->status_.IsOk()) {
+    const auto trace = response->failure_trace_.lock();
+    if (trace != nullptr) {
+      trace->MarkFailed();
+    }
+  }
 #endif  // TRITON_ENABLE_TRACING
 
   if (response->response_delegator_ != nullptr) {
@@ -212,6 +481,16 @@ InferenceResponse::Send(
     ldelegator(std::move(response), flags);
     return Status::Success;
   }
+  if (response->compute_start_ns_ != 0) {
+    LOG_STATUS_ERROR(
+        response->AddParameter(
+            "triton_compute_ns",
+            static_cast<int64_t>(
+                SteadyClockNs() - response->compute_start_ns_)),
+        "failed to add the compute latency to the response");
+    response->compute_start_ns_ = 0;
+  }
+
   void* userp = response->response_userp_;
   if (response->null_response_) {
     response->response_fn_(nullptr /* response */, flags, userp);
@@ -238,6 +517,10 @@ Status
 InferenceResponse::TraceOutputTensors(
     TRITONSERVER_InferenceTraceActivity activity, const std::string& msg)
 {
+  if ((trace_ == nullptr) || !trace_->TracesTensors()) {
+    return Status::Success;
+  }
+
   const auto& outputs = this->Outputs();
   uint32_t output_count = outputs.size();
 
@@ -378,12 +661,50 @@ InferenceResponse::Output::AllocateDataBuffer(
   return Status::Success;
 }
 
+bool
+InferenceResponse::Output::CanBorrowDataBuffer() const
+{
+  return (allocator_ != nullptr) && allocator_->BorrowBuffers();
+}
+
+Status
+InferenceResponse::Output::BorrowDataBuffer(
+    void* buffer, const size_t buffer_byte_size,
+    const TRITONSERVER_MemoryType memory_type, const int64_t memory_type_id,
+    std::shared_ptr<void> owner)
+{
+  if (allocated_buffer_ != nullptr) {
+    return Status(
+        Status::Code::ALREADY_EXISTS,
+        "allocated buffer for output '" + name_ + "' already exists");
+  }
+  if (!CanBorrowDataBuffer()) {
+    return Status(
+        Status::Code::UNSUPPORTED,
+        "response allocator doesn't allow borrowed buffer for output '" +
+            name_ + "'");
+  }
+
+  allocated_buffer_ = buffer;
+  buffer_attributes_.SetByteSize(buffer_byte_size);
+  buffer_attributes_.SetMemoryType(memory_type);
+  buffer_attributes_.SetMemoryTypeId(memory_type_id);
+  allocated_userp_ = nullptr;
+  borrowed_owner_ = std::move(owner);
+
+  return Status::Success;
+}
+
 Status
 InferenceResponse::Output::ReleaseDataBuffer()
 {
   TRITONSERVER_Error* err = nullptr;
 
-  if (allocated_buffer_ != nullptr) {
+  if (borrowed_owner_ != nullptr) {
+    // The buffer isn't from the allocator, dropping the reference is
+    // all that is needed to release it.
+    borrowed_owner_.reset();
+  } else if (allocated_buffer_ != nullptr) {
     err = allocator_->ReleaseFn()(
         reinterpret_cast<TRITONSERVER_ResponseAllocator*>(
             const_cast<ResponseAllocator*>(allocator_)),
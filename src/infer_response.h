@@ -27,9 +27,13 @@
 
 #include <deque>
 #include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include "buffer_attributes.h"
+#include "bytes_tensor.h"
 #include "constants.h"
 #include "infer_parameter.h"
 #include "infer_trace.h"
@@ -42,6 +46,26 @@ namespace triton { namespace core {
 
 class Model;
 class InferenceResponse;
+
+//
+// Responses released by the client, kept to be reused by the factory
+// that created them.
+//
+class InferenceResponsePool {
+ public:
+  // Take a pooled response, or return nullptr if there is none.
+  std::unique_ptr<InferenceResponse> Take();
+
+  // Keep 'response' for reuse, or delete it if the pool is full.
+  void Return(std::unique_ptr<InferenceResponse>&& response);
+
+ private:
+  static constexpr size_t kMaxPooledCount = 8;
+
+  std::mutex mu_;
+  std::vector<std::unique_ptr<InferenceResponse>> responses_;
+};
+
 //
 // An inference response factory.
 //
@@ -55,12 +79,7 @@ class InferenceResponseFactory {
       TRITONSERVER_InferenceResponseCompleteFn_t response_fn,
       void* response_userp,
       const std::function<void(
-          std::unique_ptr<InferenceResponse>&&, const uint32_t)>& delegator)
-      : model_(model), id_(id), allocator_(allocator),
-        alloc_userp_(alloc_userp), response_fn_(response_fn),
-        response_userp_(response_userp), response_delegator_(delegator)
-  {
-  }
+          std::unique_ptr<InferenceResponse>&&, const uint32_t)>& delegator);
 
   const ResponseAllocator* Allocator() { return allocator_; }
   void* AllocatorUserp() { return alloc_userp_; }
@@ -73,12 +92,29 @@ class InferenceResponseFactory {
     return Status::Success;
   }
 
+  // Keep 'owner' alive, the object that the response user pointer
+  // points to, as long as this factory or any response created from it
+  // is live.
+  void SetResponseUserpOwner(const std::shared_ptr<void>& owner)
+  {
+    response_userp_owner_ = owner;
+  }
+
   // Create a new response.
   Status CreateResponse(std::unique_ptr<InferenceResponse>* response) const;
 
   // Send a "null" response with 'flags'.
   Status SendFlags(const uint32_t flags) const;
 
+  // Report the latency of the request in the parameters of the
+  // responses created from now on.
+  void SetLatencyBreakdown(
+      const uint64_t queue_start_ns, const uint64_t compute_start_ns)
+  {
+    queue_start_ns_ = queue_start_ns;
+    compute_start_ns_ = compute_start_ns;
+  }
+
 #ifdef TRITON_ENABLE_TRACING
   const std::shared_ptr<InferenceTraceProxy>& Trace() const { return trace_; }
   void SetTrace(const std::shared_ptr<InferenceTraceProxy>& trace)
@@ -86,6 +122,12 @@ class InferenceResponseFactory {
     trace_ = trace;
   }
   void ReleaseTrace() { trace_ = nullptr; }
+  // Report the failed responses to 'trace', which is set whether or not
+  // it traces tensors.
+  void SetFailureTrace(const std::shared_ptr<InferenceTraceProxy>& trace)
+  {
+    failure_trace_ = trace;
+  }
 #endif  // TRITON_ENABLE_TRACING
 
  private:
@@ -112,15 +154,29 @@ class InferenceResponseFactory {
   // The response callback function and user pointer.
   TRITONSERVER_InferenceResponseCompleteFn_t response_fn_;
   void* response_userp_;
+  // The owner of the object 'response_userp_' points to, if the core
+  // owns it.
+  std::shared_ptr<void> response_userp_owner_;
 
   // Delegator to be invoked on sending responses.
   std::function<void(std::unique_ptr<InferenceResponse>&&, const uint32_t)>
       response_delegator_;
 
+  // The responses released by the client. Only set for decoupled
+  // models, which send many responses per request.
+  std::shared_ptr<InferenceResponsePool> pool_;
+
+  // The timestamps reported in the responses of a request that asked
+  // for a latency breakdown, 'compute_start_ns_' is 0 otherwise.
+  uint64_t queue_start_ns_ = 0;
+  uint64_t compute_start_ns_ = 0;
 
 #ifdef TRITON_ENABLE_TRACING
   // Inference trace associated with this response.
   std::shared_ptr<InferenceTraceProxy> trace_;
+  // The trace of the request, passed on to the responses so that their
+  // failures are marked on it.
+  std::weak_ptr<InferenceTraceProxy> failure_trace_;
 #endif  // TRITON_ENABLE_TRACING
 };
 
@@ -193,9 +249,23 @@ class InferenceResponse {
         void** buffer, const size_t buffer_byte_size,
         TRITONSERVER_MemoryType* memory_type, int64_t* memory_type_id);
 
+    // Return true if the response allocator allows this output to
+    // reference a buffer it didn't allocate through BorrowDataBuffer().
+    bool CanBorrowDataBuffer() const;
+
+    // Use 'buffer' as this output tensor's data instead of allocating
+    // one. 'owner' keeps 'buffer' valid and is held until the buffer is
+    // released. The buffer is never passed to the allocator's release
+    // function. Fails if a buffer is already allocated or borrowing is
+    // not allowed by the response allocator.
+    Status BorrowDataBuffer(
+        void* buffer, const size_t buffer_byte_size,
+        const TRITONSERVER_MemoryType memory_type,
+        const int64_t memory_type_id, std::shared_ptr<void> owner);
+
     // Release the buffer that was previously allocated by
-    // AllocateDataBuffer(). Do nothing if AllocateDataBuffer() has
-    // not been called.
+    // AllocateDataBuffer() or borrowed by BorrowDataBuffer(). Do
+    // nothing if neither has been called.
     Status ReleaseDataBuffer();
 
    private:
@@ -217,6 +287,18 @@ class InferenceResponse {
     void* allocated_buffer_;
     BufferAttributes buffer_attributes_;
     void* allocated_userp_;
+
+    // Owner of 'allocated_buffer_' if it was borrowed rather than
+    // allocated by 'allocator_'.
+    std::shared_ptr<void> borrowed_owner_;
+  };
+
+  // The highest scoring classes of an output, highest score first.
+  // 'labels_' holds nullptr for the classes without a label.
+  struct Classifications {
+    std::vector<uint64_t> indices_;
+    std::vector<double> scores_;
+    std::vector<const char*> labels_;
   };
 
   // InferenceResponse
@@ -240,6 +322,8 @@ class InferenceResponse {
   const std::string& ModelName() const;
   int64_t ActualModelVersion() const;
   const Status& ResponseStatus() const { return status_; }
+  // Whether this is a "null" response that only carries flags
+  bool IsNullResponse() const { return null_response_; }
 
   // The response parameters.
   const std::deque<InferenceParameter>& Parameters() const
@@ -270,6 +354,22 @@ class InferenceResponse {
       const Output& output, const uint32_t class_index,
       const char** label) const;
 
+  // Select the 'class_count' highest scoring classes of the output at
+  // 'index' along with their labels. An output in GPU memory is copied
+  // to the host first. The result is owned by the response and stays
+  // valid until the response is deleted or the classifications of the
+  // same output are requested again.
+  Status TopKClassifications(
+      const uint32_t index, const uint32_t class_count,
+      const Classifications** classifications);
+
+  // Convert the BYTES output at 'index' into offsets+data form. An
+  // output in GPU memory is copied to the host first. The result is
+  // owned by the response and stays valid until the response is
+  // deleted.
+  Status ContiguousBytesOutput(
+      const uint32_t index, const ContiguousBytes** bytes);
+
   // Send the response with success status. Calling this function
   // releases ownership of the response object and gives it to the
   // callback function.
@@ -283,6 +383,10 @@ class InferenceResponse {
       std::unique_ptr<InferenceResponse>&& response, const uint32_t flags,
       const Status& status);
 
+  // Delete a response released by the client. A response created from
+  // a pool is returned to it instead.
+  static void Delete(InferenceResponse* response);
+
 #ifdef TRITON_ENABLE_TRACING
   const std::shared_ptr<InferenceTraceProxy>& Trace() const { return trace_; }
   void SetTrace(const std::shared_ptr<InferenceTraceProxy>& trace)
@@ -294,9 +398,35 @@ class InferenceResponse {
 
  private:
   DISALLOW_COPY_AND_ASSIGN(InferenceResponse);
+  friend class InferenceResponseFactory;
   friend std::ostream& operator<<(
       std::ostream& out, const InferenceResponse& response);
 
+  // Prepare a pooled response to be used again, as if it were created
+  // with the given values.
+  void Reuse(
+      const std::shared_ptr<Model>& model, const std::string& id,
+      const ResponseAllocator* allocator, void* alloc_userp,
+      TRITONSERVER_InferenceResponseCompleteFn_t response_fn,
+      void* response_userp,
+      const std::function<void(
+          std::unique_ptr<InferenceResponse>&&, const uint32_t)>& delegator,
+      const std::shared_ptr<InferenceResponsePool>& pool);
+
+  // Release the content of the response, keeping the capacity of its
+  // containers.
+  void Clear();
+
+  // Invoke the start function of the response allocator, if any.
+  void StartAllocation();
+
+  // Return in 'base' and 'byte_size' the data of 'output' in host
+  // memory, copying it into 'staging' if it is in GPU memory. 'purpose'
+  // describes the use of the data in errors.
+  Status HostOutputBuffer(
+      const Output& output, const char* purpose, const void** base,
+      size_t* byte_size, std::unique_ptr<char[]>* staging) const;
+
 #ifdef TRITON_ENABLE_TRACING
   Status TraceOutputTensors(
       TRITONSERVER_InferenceTraceActivity activity, const std::string& msg);
@@ -324,6 +454,12 @@ class InferenceResponse {
   // The result tensors. Use a deque so that there is no reallocation.
   std::deque<Output> outputs_;
 
+  // The classifications requested for each output, by output index.
+  std::map<uint32_t, Classifications> classifications_;
+
+  // The offsets+data form of BYTES outputs, by output index.
+  std::map<uint32_t, ContiguousBytes> bytes_outputs_;
+
   // The response allocator and user pointer.
   const ResponseAllocator* allocator_;
   void* alloc_userp_;
@@ -331,6 +467,9 @@ class InferenceResponse {
   // The response callback function and user pointer.
   TRITONSERVER_InferenceResponseCompleteFn_t response_fn_;
   void* response_userp_;
+  // Shares the ownership of the object 'response_userp_' points to with
+  // the factory, see InferenceResponseFactory::SetResponseUserpOwner().
+  std::shared_ptr<void> response_userp_owner_;
 
   // Delegator to be invoked on sending responses.
   std::function<void(std::unique_ptr<InferenceResponse>&&, const uint32_t)>
@@ -338,9 +477,20 @@ class InferenceResponse {
 
   bool null_response_;
 
+  // The start of the execution of the request if the response reports
+  // the compute latency when sent, 0 otherwise.
+  uint64_t compute_start_ns_;
+
+  // The pool that the response returns to when deleted, if any.
+  std::shared_ptr<InferenceResponsePool> pool_;
+
 #ifdef TRITON_ENABLE_TRACING
   // Inference trace associated with this response.
   std::shared_ptr<InferenceTraceProxy> trace_;
+  // The trace that a failure of the response marks, so that it is kept
+  // when tail sampled. Held weakly as the response must not extend the
+  // lifetime of a trace that only traces timestamps.
+  std::weak_ptr<InferenceTraceProxy> failure_trace_;
 #endif  // TRITON_ENABLE_TRACING
 };
 
@@ -27,6 +27,7 @@
 #include "infer_stats.h"
 
 #include <time.h>
+#include <algorithm>
 #include "metric_model_reporter.h"
 #include "metrics.h"
 #include "triton/common/logging.h"
@@ -35,19 +36,224 @@ namespace triton { namespace core {
 
 #ifdef TRITON_ENABLE_STATS
 
+namespace {
+
+// Assigns the threads to shards round robin
+std::atomic<size_t> next_thread_shard{0};
+
+// The lock statistics shared by the shards, looked up once since shards
+// are created for every ensemble request.
+LockStats*
+ShardLockStats()
+{
+  static LockStats* stats = LockStatsFor("InferenceStatsAggregator::mu_");
+  return stats;
+}
+
+}  // namespace
+
+constexpr size_t InferenceStatsAggregator::kShardCount;
+
+InferenceStatsAggregator::InferenceStatsAggregator()
+{
+  for (auto& shard : shards_) {
+    shard.store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+InferenceStatsAggregator::~InferenceStatsAggregator()
+{
+  for (auto& shard : shards_) {
+    delete shard.load(std::memory_order_relaxed);
+  }
+}
+
+InferenceStatsAggregator::Shard&
+InferenceStatsAggregator::LocalShard()
+{
+  thread_local const size_t thread_shard =
+      next_thread_shard.fetch_add(1, std::memory_order_relaxed) % kShardCount;
+  Shard* shard = shards_[thread_shard].load(std::memory_order_acquire);
+  if (shard == nullptr) {
+    Shard* created = new Shard(ShardLockStats());
+    if (shards_[thread_shard].compare_exchange_strong(
+            shard, created, std::memory_order_acq_rel)) {
+      shard = created;
+    } else {
+      delete created;
+    }
+  }
+  return *shard;
+}
+
+uint64_t
+InferenceStatsAggregator::UpdateCount() const
+{
+  uint64_t update_count = 0;
+  for (const auto& s : shards_) {
+    Shard* shard = s.load(std::memory_order_acquire);
+    if (shard != nullptr) {
+      std::lock_guard<InstrumentedMutex> lock(shard->mu_);
+      update_count += shard->update_count_;
+    }
+  }
+  return update_count;
+}
+
+uint64_t
+InferenceStatsAggregator::LastInferenceMs() const
+{
+  uint64_t last_inference_ms = 0;
+  for (const auto& s : shards_) {
+    Shard* shard = s.load(std::memory_order_acquire);
+    if (shard != nullptr) {
+      std::lock_guard<InstrumentedMutex> lock(shard->mu_);
+      last_inference_ms =
+          std::max(last_inference_ms, shard->last_inference_ms_);
+    }
+  }
+  return last_inference_ms;
+}
+
+uint64_t
+InferenceStatsAggregator::InferenceCount() const
+{
+  uint64_t inference_count = 0;
+  for (const auto& s : shards_) {
+    Shard* shard = s.load(std::memory_order_acquire);
+    if (shard != nullptr) {
+      std::lock_guard<InstrumentedMutex> lock(shard->mu_);
+      inference_count += shard->inference_count_;
+    }
+  }
+  return inference_count;
+}
+
+uint64_t
+InferenceStatsAggregator::ExecutionCount() const
+{
+  uint64_t execution_count = 0;
+  for (const auto& s : shards_) {
+    Shard* shard = s.load(std::memory_order_acquire);
+    if (shard != nullptr) {
+      std::lock_guard<InstrumentedMutex> lock(shard->mu_);
+      execution_count += shard->execution_count_;
+    }
+  }
+  return execution_count;
+}
+
+InferenceStatsAggregator::InferStats
+InferenceStatsAggregator::ImmutableInferStats() const
+{
+  InferStats infer_stats;
+  for (const auto& s : shards_) {
+    Shard* shard = s.load(std::memory_order_acquire);
+    if (shard == nullptr) {
+      continue;
+    }
+    std::lock_guard<InstrumentedMutex> lock(shard->mu_);
+    const auto& stats = shard->infer_stats_;
+    infer_stats.failure_count_ += stats.failure_count_;
+    infer_stats.failure_duration_ns_ += stats.failure_duration_ns_;
+    infer_stats.success_count_ += stats.success_count_;
+    infer_stats.request_duration_ns_ += stats.request_duration_ns_;
+    infer_stats.queue_duration_ns_ += stats.queue_duration_ns_;
+    infer_stats.compute_input_duration_ns_ += stats.compute_input_duration_ns_;
+    infer_stats.compute_infer_duration_ns_ += stats.compute_infer_duration_ns_;
+    infer_stats.compute_output_duration_ns_ +=
+        stats.compute_output_duration_ns_;
+    infer_stats.cache_hit_count_ += stats.cache_hit_count_;
+    infer_stats.cache_hit_duration_ns_ += stats.cache_hit_duration_ns_;
+    infer_stats.cache_miss_count_ += stats.cache_miss_count_;
+    infer_stats.cache_miss_duration_ns_ += stats.cache_miss_duration_ns_;
+  }
+  return infer_stats;
+}
+
+std::map<size_t, InferenceStatsAggregator::InferBatchStats>
+InferenceStatsAggregator::ImmutableInferBatchStats() const
+{
+  std::map<size_t, InferBatchStats> batch_stats;
+  for (const auto& s : shards_) {
+    Shard* shard = s.load(std::memory_order_acquire);
+    if (shard == nullptr) {
+      continue;
+    }
+    std::lock_guard<InstrumentedMutex> lock(shard->mu_);
+    for (size_t bs = 0; bs < shard->batch_stats_.size(); ++bs) {
+      const auto& stats = shard->batch_stats_[bs];
+      if (stats.count_ == 0) {
+        continue;
+      }
+      auto& merged = batch_stats[bs];
+      merged.count_ += stats.count_;
+      merged.compute_input_duration_ns_ += stats.compute_input_duration_ns_;
+      merged.compute_infer_duration_ns_ += stats.compute_infer_duration_ns_;
+      merged.compute_output_duration_ns_ += stats.compute_output_duration_ns_;
+    }
+  }
+  return batch_stats;
+}
+
+std::map<size_t, InferenceStatsAggregator::EnsembleStepStats>
+InferenceStatsAggregator::ImmutableEnsembleStepStats() const
+{
+  std::map<size_t, EnsembleStepStats> step_stats;
+  for (const auto& s : shards_) {
+    Shard* shard = s.load(std::memory_order_acquire);
+    if (shard == nullptr) {
+      continue;
+    }
+    std::lock_guard<InstrumentedMutex> lock(shard->mu_);
+    for (size_t idx = 0; idx < shard->ensemble_step_stats_.size(); ++idx) {
+      const auto& stats = shard->ensemble_step_stats_[idx];
+      if (stats.execution_count_ == 0) {
+        continue;
+      }
+      auto& merged = step_stats[idx];
+      merged.execution_count_ += stats.execution_count_;
+      merged.wait_duration_ns_ += stats.wait_duration_ns_;
+      merged.execution_duration_ns_ += stats.execution_duration_ns_;
+      merged.critical_path_count_ += stats.critical_path_count_;
+      merged.critical_path_duration_ns_ += stats.critical_path_duration_ns_;
+    }
+  }
+  return step_stats;
+}
+
+void
+InferenceStatsAggregator::ExecutionStats(
+    uint64_t* execution_count, uint64_t* compute_duration_ns) const
+{
+  *execution_count = 0;
+  *compute_duration_ns = 0;
+  for (const auto& s : shards_) {
+    Shard* shard = s.load(std::memory_order_acquire);
+    if (shard != nullptr) {
+      std::lock_guard<InstrumentedMutex> lock(shard->mu_);
+      *execution_count += shard->execution_count_;
+      *compute_duration_ns += shard->compute_duration_ns_;
+    }
+  }
+}
+
 void
 InferenceStatsAggregator::UpdateFailure(
     MetricModelReporter* metric_reporter, const uint64_t request_start_ns,
     const uint64_t request_end_ns)
 {
-  std::lock_guard<std::mutex> lock(mu_);
+  Shard& shard = LocalShard();
+  std::lock_guard<InstrumentedMutex> lock(shard.mu_);
+  ++shard.update_count_;
 
-  infer_stats_.failure_count_++;
-  infer_stats_.failure_duration_ns_ += (request_end_ns - request_start_ns);
+  shard.infer_stats_.failure_count_++;
+  shard.infer_stats_.failure_duration_ns_ +=
+      (request_end_ns - request_start_ns);
 
 #ifdef TRITON_ENABLE_METRICS
   if (metric_reporter != nullptr) {
-    metric_reporter->IncrementCounter("inf_failure", 1);
+    metric_reporter->IncrementCounter(MetricCounter::INF_FAILURE, 1);
   }
 #endif  // TRITON_ENABLE_METRICS
 }
@@ -84,46 +290,68 @@ InferenceStatsAggregator::UpdateSuccessWithDuration(
   const uint64_t request_duration_ns = request_end_ns - request_start_ns;
   const uint64_t queue_duration_ns = compute_start_ns - queue_start_ns;
 
-  std::lock_guard<std::mutex> lock(mu_);
+  Shard& shard = LocalShard();
+  std::lock_guard<InstrumentedMutex> lock(shard.mu_);
+  ++shard.update_count_;
 
-  inference_count_ += batch_size;
+  shard.inference_count_ += batch_size;
 
-  infer_stats_.success_count_++;
-  infer_stats_.request_duration_ns_ += request_duration_ns;
-  infer_stats_.queue_duration_ns_ += queue_duration_ns;
-  infer_stats_.compute_input_duration_ns_ += compute_input_duration_ns;
-  infer_stats_.compute_infer_duration_ns_ += compute_infer_duration_ns;
-  infer_stats_.compute_output_duration_ns_ += compute_output_duration_ns;
+  shard.infer_stats_.success_count_++;
+  shard.infer_stats_.request_duration_ns_ += request_duration_ns;
+  shard.infer_stats_.queue_duration_ns_ += queue_duration_ns;
+  shard.infer_stats_.compute_input_duration_ns_ += compute_input_duration_ns;
+  shard.infer_stats_.compute_infer_duration_ns_ += compute_infer_duration_ns;
+  shard.infer_stats_.compute_output_duration_ns_ += compute_output_duration_ns;
 
 #ifdef TRITON_ENABLE_METRICS
   if (metric_reporter != nullptr) {
-    metric_reporter->IncrementCounter("inf_success", 1);
-    metric_reporter->IncrementCounter("inf_count", batch_size);
+    metric_reporter->IncrementCounter(MetricCounter::INF_SUCCESS, 1);
+    metric_reporter->IncrementCounter(MetricCounter::INF_COUNT, batch_size);
     // Counter Latencies
     metric_reporter->IncrementCounter(
-        "request_duration", request_duration_ns / 1000);
+        MetricCounter::REQUEST_DURATION, request_duration_ns / 1000);
     metric_reporter->IncrementCounter(
-        "queue_duration", queue_duration_ns / 1000);
+        MetricCounter::QUEUE_DURATION, queue_duration_ns / 1000);
     metric_reporter->IncrementCounter(
-        "compute_input_duration", compute_input_duration_ns / 1000);
+        MetricCounter::COMPUTE_INPUT_DURATION,
+        compute_input_duration_ns / 1000);
     metric_reporter->IncrementCounter(
-        "compute_infer_duration", compute_infer_duration_ns / 1000);
+        MetricCounter::COMPUTE_INFER_DURATION,
+        compute_infer_duration_ns / 1000);
     metric_reporter->IncrementCounter(
-        "compute_output_duration", compute_output_duration_ns / 1000);
+        MetricCounter::COMPUTE_OUTPUT_DURATION,
+        compute_output_duration_ns / 1000);
     // Summary Latencies
     const auto& reporter_config = metric_reporter->Config();
     // FIXME [DLIS-4762]: request summary is disabled when cache is enabled.
     if (!reporter_config.cache_enabled_) {
       metric_reporter->ObserveSummary(
-          "request_duration", request_duration_ns / 1000);
+          MetricSummary::REQUEST_DURATION, request_duration_ns / 1000);
     }
-    metric_reporter->ObserveSummary("queue_duration", queue_duration_ns / 1000);
     metric_reporter->ObserveSummary(
-        "compute_input_duration", compute_input_duration_ns / 1000);
+        MetricSummary::QUEUE_DURATION, queue_duration_ns / 1000);
     metric_reporter->ObserveSummary(
-        "compute_infer_duration", compute_infer_duration_ns / 1000);
+        MetricSummary::COMPUTE_INPUT_DURATION,
+        compute_input_duration_ns / 1000);
     metric_reporter->ObserveSummary(
-        "compute_output_duration", compute_output_duration_ns / 1000);
+        MetricSummary::COMPUTE_INFER_DURATION,
+        compute_infer_duration_ns / 1000);
+    metric_reporter->ObserveSummary(
+        MetricSummary::COMPUTE_OUTPUT_DURATION,
+        compute_output_duration_ns / 1000);    // Histogram Latencies
+    metric_reporter->ObserveHistogram(
+        MetricHistogram::REQUEST_DURATION, request_duration_ns / 1000);
+    metric_reporter->ObserveHistogram(
+        MetricHistogram::QUEUE_DURATION, queue_duration_ns / 1000);
+    metric_reporter->ObserveHistogram(
+        MetricHistogram::COMPUTE_INPUT_DURATION,
+        compute_input_duration_ns / 1000);
+    metric_reporter->ObserveHistogram(
+        MetricHistogram::COMPUTE_INFER_DURATION,
+        compute_infer_duration_ns / 1000);
+    metric_reporter->ObserveHistogram(
+        MetricHistogram::COMPUTE_OUTPUT_DURATION,
+        compute_output_duration_ns / 1000);
   }
 #endif  // TRITON_ENABLE_METRICS
 }
@@ -141,33 +369,39 @@ InferenceStatsAggregator::UpdateSuccessCacheHit(
   const uint64_t request_duration_ns = request_end_ns - request_start_ns;
   const uint64_t queue_duration_ns = cache_lookup_start_ns - queue_start_ns;
 
-  std::lock_guard<std::mutex> lock(mu_);
+  Shard& shard = LocalShard();
+  std::lock_guard<InstrumentedMutex> lock(shard.mu_);
+  ++shard.update_count_;
 
-  infer_stats_.success_count_++;
-  infer_stats_.request_duration_ns_ += request_duration_ns;
-  infer_stats_.queue_duration_ns_ += queue_duration_ns;
-  infer_stats_.cache_hit_count_++;
-  infer_stats_.cache_hit_duration_ns_ += cache_hit_duration_ns;
+  shard.infer_stats_.success_count_++;
+  shard.infer_stats_.request_duration_ns_ += request_duration_ns;
+  shard.infer_stats_.queue_duration_ns_ += queue_duration_ns;
+  shard.infer_stats_.cache_hit_count_++;
+  shard.infer_stats_.cache_hit_duration_ns_ += cache_hit_duration_ns;
 
 #ifdef TRITON_ENABLE_METRICS
   if (metric_reporter != nullptr) {
     // inf_count not recorded on a cache hit
-    metric_reporter->IncrementCounter("inf_success", 1);
+    metric_reporter->IncrementCounter(MetricCounter::INF_SUCCESS, 1);
     // Counter Latencies
     metric_reporter->IncrementCounter(
-        "request_duration", request_duration_ns / 1000);
+        MetricCounter::REQUEST_DURATION, request_duration_ns / 1000);
     metric_reporter->IncrementCounter(
-        "queue_duration", queue_duration_ns / 1000);
-    metric_reporter->IncrementCounter("cache_hit_count", 1);
+        MetricCounter::QUEUE_DURATION, queue_duration_ns / 1000);
+    metric_reporter->IncrementCounter(MetricCounter::CACHE_HIT_COUNT, 1);
     metric_reporter->IncrementCounter(
-        "cache_hit_duration", cache_hit_duration_ns / 1000);
+        MetricCounter::CACHE_HIT_DURATION, cache_hit_duration_ns / 1000);
     // Summary Latencies
     // FIXME [DLIS-4762]: request summary is disabled when cache is enabled.
     // metric_reporter->ObserveSummary(
     //    "request_duration", request_duration_ns / 1000);
-    metric_reporter->ObserveSummary("queue_duration", queue_duration_ns / 1000);
     metric_reporter->ObserveSummary(
-        "cache_hit_duration", cache_hit_duration_ns / 1000);
+        MetricSummary::QUEUE_DURATION, queue_duration_ns / 1000);
+    metric_reporter->ObserveSummary(
+        MetricSummary::CACHE_HIT_DURATION, cache_hit_duration_ns / 1000);
+    // Histogram Latencies
+    metric_reporter->ObserveHistogram(
+        MetricHistogram::QUEUE_DURATION, queue_duration_ns / 1000);
   }
 #endif  // TRITON_ENABLE_METRICS
 }
@@ -180,11 +414,13 @@ void
 InferenceStatsAggregator::UpdateSuccessCacheMiss(
     MetricModelReporter* metric_reporter, const uint64_t cache_miss_duration_ns)
 {
-  std::lock_guard<std::mutex> lock(mu_);
+  Shard& shard = LocalShard();
+  std::lock_guard<InstrumentedMutex> lock(shard.mu_);
+  ++shard.update_count_;
 
-  infer_stats_.request_duration_ns_ += cache_miss_duration_ns;
-  infer_stats_.cache_miss_count_++;
-  infer_stats_.cache_miss_duration_ns_ += cache_miss_duration_ns;
+  shard.infer_stats_.request_duration_ns_ += cache_miss_duration_ns;
+  shard.infer_stats_.cache_miss_count_++;
+  shard.infer_stats_.cache_miss_duration_ns_ += cache_miss_duration_ns;
 
 #ifdef TRITON_ENABLE_METRICS
   if (metric_reporter != nullptr) {
@@ -193,10 +429,10 @@ InferenceStatsAggregator::UpdateSuccessCacheMiss(
     // cache lookup time was already included before the inference backend
     // was called
     metric_reporter->IncrementCounter(
-        "request_duration", cache_miss_duration_ns / 1000);
-    metric_reporter->IncrementCounter("cache_miss_count", 1);
+        MetricCounter::REQUEST_DURATION, cache_miss_duration_ns / 1000);
+    metric_reporter->IncrementCounter(MetricCounter::CACHE_MISS_COUNT, 1);
     metric_reporter->IncrementCounter(
-        "cache_miss_duration", cache_miss_duration_ns / 1000);
+        MetricCounter::CACHE_MISS_DURATION, cache_miss_duration_ns / 1000);
 
     // FIXME [DLIS-4762]: request summary is disabled when cache is enabled.
     //       Need to account for adding cache miss duration on top of
@@ -204,7 +440,7 @@ InferenceStatsAggregator::UpdateSuccessCacheMiss(
     // metric_reporter->ObserveSummary(
     //    "request_duration", cache_miss_duration_ns / 1000);
     metric_reporter->ObserveSummary(
-        "cache_miss_duration", cache_miss_duration_ns / 1000);
+        MetricSummary::CACHE_MISS_DURATION, cache_miss_duration_ns / 1000);
   }
 #endif  // TRITON_ENABLE_METRICS
 }
@@ -236,30 +472,58 @@ InferenceStatsAggregator::UpdateInferBatchStatsWithDuration(
           std::chrono::system_clock::now().time_since_epoch())
           .count();
 
-  std::lock_guard<std::mutex> lock(mu_);
+  Shard& shard = LocalShard();
+  std::lock_guard<InstrumentedMutex> lock(shard.mu_);
+  ++shard.update_count_;
 
-  if (inference_ms > last_inference_ms_) {
-    last_inference_ms_ = inference_ms;
+  if (inference_ms > shard.last_inference_ms_) {
+    shard.last_inference_ms_ = inference_ms;
   }
 
-  execution_count_++;
+  shard.execution_count_++;
+  shard.compute_duration_ns_ += compute_input_duration_ns +
+                                compute_infer_duration_ns +
+                                compute_output_duration_ns;
 
-  auto it = batch_stats_.find(batch_size);
-  if (it == batch_stats_.end()) {
-    it = batch_stats_.emplace(batch_size, InferBatchStats()).first;
+  if (batch_size >= shard.batch_stats_.size()) {
+    shard.batch_stats_.resize(batch_size + 1);
   }
-  it->second.count_++;
-  it->second.compute_input_duration_ns_ += compute_input_duration_ns;
-  it->second.compute_infer_duration_ns_ += compute_infer_duration_ns;
-  it->second.compute_output_duration_ns_ += compute_output_duration_ns;
+  auto& stats = shard.batch_stats_[batch_size];
+  stats.count_++;
+  stats.compute_input_duration_ns_ += compute_input_duration_ns;
+  stats.compute_infer_duration_ns_ += compute_infer_duration_ns;
+  stats.compute_output_duration_ns_ += compute_output_duration_ns;
 
 #ifdef TRITON_ENABLE_METRICS
   if (metric_reporter != nullptr) {
-    metric_reporter->IncrementCounter("inf_exec_count", 1);
+    metric_reporter->IncrementCounter(MetricCounter::INF_EXEC_COUNT, 1);
   }
 #endif  // TRITON_ENABLE_METRICS
 }
 
+void
+InferenceStatsAggregator::UpdateEnsembleStepStats(
+    const size_t step_idx, const uint64_t execution_count,
+    const uint64_t wait_duration_ns, const uint64_t execution_duration_ns,
+    const uint64_t critical_path_duration_ns)
+{
+  Shard& shard = LocalShard();
+  std::lock_guard<InstrumentedMutex> lock(shard.mu_);
+  ++shard.update_count_;
+
+  if (step_idx >= shard.ensemble_step_stats_.size()) {
+    shard.ensemble_step_stats_.resize(step_idx + 1);
+  }
+  auto& stats = shard.ensemble_step_stats_[step_idx];
+  stats.execution_count_ += execution_count;
+  stats.wait_duration_ns_ += wait_duration_ns;
+  stats.execution_duration_ns_ += execution_duration_ns;
+  if (critical_path_duration_ns != 0) {
+    stats.critical_path_count_++;
+    stats.critical_path_duration_ns_ += critical_path_duration_ns;
+  }
+}
+
 #endif  // TRITON_ENABLE_STATS
 
 }}  // namespace triton::core
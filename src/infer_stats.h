@@ -26,12 +26,15 @@
 #pragma once
 
 #include <time.h>
+#include <atomic>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <vector>
+#include "clock.h"
 #include "constants.h"
 #include "infer_response.h"
+#include "instrumented_mutex.h"
 #include "status.h"
 #include "tritonserver_apis.h"
 
@@ -88,20 +91,48 @@ class InferenceStatsAggregator {
     uint64_t compute_output_duration_ns_;
   };
 
-  // Create an aggregator for model statistics
-  InferenceStatsAggregator()
-      : last_inference_ms_(0), inference_count_(0), execution_count_(0)
-  {
-  }
+  // Statistics of one step of an ensemble. The critical path duration
+  // is the part of the ensemble request durations attributed to the
+  // step, when the step is on the longest dependency chain.
+  struct EnsembleStepStats {
+    EnsembleStepStats()
+        : execution_count_(0), wait_duration_ns_(0),
+          execution_duration_ns_(0), critical_path_count_(0),
+          critical_path_duration_ns_(0)
+    {
+    }
+    uint64_t execution_count_;
+    uint64_t wait_duration_ns_;
+    uint64_t execution_duration_ns_;
+    uint64_t critical_path_count_;
+    uint64_t critical_path_duration_ns_;
+  };
 
-  uint64_t LastInferenceMs() const { return last_inference_ms_; }
-  uint64_t InferenceCount() const { return inference_count_; }
-  uint64_t ExecutionCount() const { return execution_count_; }
-  const InferStats& ImmutableInferStats() const { return infer_stats_; }
-  const std::map<size_t, InferBatchStats>& ImmutableInferBatchStats() const
-  {
-    return batch_stats_;
-  }
+  // Create an aggregator for model statistics
+  InferenceStatsAggregator();
+  ~InferenceStatsAggregator();
+
+  InferenceStatsAggregator(const InferenceStatsAggregator&) = delete;
+  InferenceStatsAggregator& operator=(const InferenceStatsAggregator&) =
+      delete;
+
+  // Return the number of updates of the statistics, which tells the
+  // readers if the statistics changed since they last read them.
+  uint64_t UpdateCount() const;
+
+  // The accessors below aggregate the statistics of all the shards and
+  // may be called while the statistics are being updated.
+  uint64_t LastInferenceMs() const;
+  uint64_t InferenceCount() const;
+  uint64_t ExecutionCount() const;
+  InferStats ImmutableInferStats() const;
+  std::map<size_t, InferBatchStats> ImmutableInferBatchStats() const;
+  std::map<size_t, EnsembleStepStats> ImmutableEnsembleStepStats() const;
+
+  // Return the number of model executions and their cumulative compute
+  // duration, in nanoseconds.
+  void ExecutionStats(
+      uint64_t* execution_count, uint64_t* compute_duration_ns) const;
 
   // Add durations to Infer stats for a failed inference request.
   void UpdateFailure(
@@ -155,13 +186,46 @@ class InferenceStatsAggregator {
       const uint64_t compute_infer_duration_ns,
       const uint64_t compute_output_duration_ns);
 
+  // Add durations to the stats of ensemble step 'step_idx' for the
+  // 'execution_count' executions of the step in one ensemble request.
+  void UpdateEnsembleStepStats(
+      const size_t step_idx, const uint64_t execution_count,
+      const uint64_t wait_duration_ns, const uint64_t execution_duration_ns,
+      const uint64_t critical_path_duration_ns);
+
  private:
-  std::mutex mu_;
-  uint64_t last_inference_ms_;
-  uint64_t inference_count_;
-  uint64_t execution_count_;
-  InferStats infer_stats_;
-  std::map<size_t, InferBatchStats> batch_stats_;
+  // The updates from a thread go to the shard of the thread, so that the
+  // threads updating the statistics of the same model rarely share a
+  // lock or a cache line. The shards are only merged when read.
+  static constexpr size_t kShardCount = 16;
+
+  struct Shard {
+    explicit Shard(LockStats* lock_stats)
+        : mu_(lock_stats), update_count_(0),
+          last_inference_ms_(0), inference_count_(0), execution_count_(0),
+          compute_duration_ns_(0)
+    {
+    }
+    InstrumentedMutex mu_;
+    uint64_t update_count_;
+    uint64_t last_inference_ms_;
+    uint64_t inference_count_;
+    uint64_t execution_count_;
+    // The sum of the compute durations of 'batch_stats_'
+    uint64_t compute_duration_ns_;
+    InferStats infer_stats_;
+    // Indexed by batch size and step index respectively, the entries
+    // with a zero count were never updated
+    std::vector<InferBatchStats> batch_stats_;
+    std::vector<EnsembleStepStats> ensemble_step_stats_;
+  };
+
+  // Return the shard of the calling thread, creating it on first use.
+  // Aggregators are also created per ensemble request, which only ever
+  // allocate the shards of the few threads that update them.
+  Shard& LocalShard();
+
+  std::atomic<Shard*> shards_[kShardCount];
 #endif  // TRITON_ENABLE_STATS
 };
 
@@ -170,11 +234,9 @@ class InferenceStatsAggregator {
 // Macros to set infer stats.
 //
 #ifdef TRITON_ENABLE_STATS
-#define INFER_STATS_SET_TIMESTAMP(TS_NS)                             \
-  {                                                                  \
-    TS_NS = std::chrono::duration_cast<std::chrono::nanoseconds>(    \
-                std::chrono::steady_clock::now().time_since_epoch()) \
-                .count();                                            \
+#define INFER_STATS_SET_TIMESTAMP(TS_NS) \
+  {                                      \
+    TS_NS = SteadyClockNs();             \
   }
 #define INFER_STATS_DECL_TIMESTAMP(TS_NS) \
   uint64_t TS_NS;                         \
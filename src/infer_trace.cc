@@ -37,6 +37,9 @@ std::atomic<uint64_t> InferenceTrace::next_id_(1);
 InferenceTrace*
 InferenceTrace::SpawnChildTrace()
 {
+  if (collector_ != nullptr) {
+    return new InferenceTrace(level_, id_, collector_);
+  }
   InferenceTrace* trace = new InferenceTrace(
       level_, id_, activity_fn_, tensor_activity_fn_, release_fn_, userp_);
   return trace;
@@ -45,6 +48,23 @@ InferenceTrace::SpawnChildTrace()
 void
 InferenceTrace::Release()
 {
+  if (collector_ != nullptr) {
+    if (!buffered_.empty()) {
+      uint64_t start_ns = buffered_.front().timestamp_ns;
+      uint64_t end_ns = start_ns;
+      for (const auto& record : buffered_) {
+        start_ns = std::min(start_ns, record.timestamp_ns);
+        end_ns = std::max(end_ns, record.timestamp_ns);
+      }
+      if (collector_->KeepTrace(failed_.load(), end_ns - start_ns)) {
+        for (const auto& record : buffered_) {
+          collector_->Record(record);
+        }
+      }
+    }
+    delete this;
+    return;
+  }
   release_fn_(reinterpret_cast<TRITONSERVER_InferenceTrace*>(this), userp_);
 }
 
@@ -25,11 +25,14 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <algorithm>
 #include <atomic>
-#include <chrono>
 #include <memory>
+#include <vector>
+#include "clock.h"
 #include "constants.h"
 #include "status.h"
+#include "trace_collector.h"
 #include "tritonserver_apis.h"
 
 namespace triton { namespace core {
@@ -50,7 +53,20 @@ class InferenceTrace {
       TRITONSERVER_InferenceTraceReleaseFn_t release_fn, void* userp)
       : level_(level), id_(next_id_++), parent_id_(parent_id),
         activity_fn_(activity_fn), tensor_activity_fn_(tensor_activity_fn),
-        release_fn_(release_fn), userp_(userp)
+        release_fn_(release_fn), userp_(userp), collector_(nullptr),
+        failed_(false)
+  {
+  }
+
+  // A trace whose activity is recorded by 'collector' instead of being
+  // reported to a callback. The trace deletes itself on release.
+  InferenceTrace(
+      const TRITONSERVER_InferenceTraceLevel level, const uint64_t parent_id,
+      TraceCollector* collector)
+      : level_(level), id_(next_id_++), parent_id_(parent_id),
+        activity_fn_(nullptr), tensor_activity_fn_(nullptr),
+        release_fn_(nullptr), userp_(nullptr), collector_(collector),
+        model_version_(-1), collected_model_name_(""), failed_(false)
   {
   }
 
@@ -63,18 +79,47 @@ class InferenceTrace {
   int64_t ModelVersion() const { return model_version_; }
   const std::string& RequestId() const { return request_id_; }
 
-  void SetModelName(const std::string& n) { model_name_ = n; }
+  void SetModelName(const std::string& n)
+  {
+    model_name_ = n;
+    if (collector_ != nullptr) {
+      collected_model_name_ = collector_->InternName(n);
+    }
+  }
   void SetModelVersion(int64_t v) { model_version_ = v; }
   void SetRequestId(const std::string& request_id) { request_id_ = request_id; }
 
+  // Mark that the trace had a failed response, a tail sampled trace is
+  // then always kept.
+  void MarkFailed() { failed_.store(true, std::memory_order_relaxed); }
+
+  // Whether tensor activities are reported.
+  bool TracesTensors() const
+  {
+    return (level_ & TRITONSERVER_TRACE_LEVEL_TENSORS) > 0;
+  }
+
   // Report trace activity.
   void Report(
       const TRITONSERVER_InferenceTraceActivity activity, uint64_t timestamp_ns)
   {
     if ((level_ & TRITONSERVER_TRACE_LEVEL_TIMESTAMPS) > 0) {
-      activity_fn_(
-          reinterpret_cast<TRITONSERVER_InferenceTrace*>(this), activity,
-          timestamp_ns, userp_);
+      if (collector_ != nullptr) {
+        const TRITONSERVER_InferenceTraceRecord record{
+            id_, parent_id_, timestamp_ns, activity, model_version_,
+            collected_model_name_};
+        if (collector_->TailSampling()) {
+          // The activities of a trace are ordered by the hand-off of the
+          // request between threads, so the buffer needs no lock.
+          buffered_.push_back(record);
+        } else {
+          collector_->Record(record);
+        }
+      } else {
+        activity_fn_(
+            reinterpret_cast<TRITONSERVER_InferenceTrace*>(this), activity,
+            timestamp_ns, userp_);
+      }
     }
   }
 
@@ -82,10 +127,7 @@ class InferenceTrace {
   void ReportNow(const TRITONSERVER_InferenceTraceActivity activity)
   {
     if ((level_ & TRITONSERVER_TRACE_LEVEL_TIMESTAMPS) > 0) {
-      Report(
-          activity, std::chrono::duration_cast<std::chrono::nanoseconds>(
-                        std::chrono::steady_clock::now().time_since_epoch())
-                        .count());
+      Report(activity, SteadyClockNs());
     }
   }
 
@@ -116,10 +158,16 @@ class InferenceTrace {
   TRITONSERVER_InferenceTraceTensorActivityFn_t tensor_activity_fn_;
   TRITONSERVER_InferenceTraceReleaseFn_t release_fn_;
   void* userp_;
+  TraceCollector* collector_;
 
   std::string model_name_;
   int64_t model_version_;
   std::string request_id_;
+  // 'model_name_' as interned by 'collector_'
+  const char* collected_model_name_;
+  // The records held back until release when 'collector_' tail samples
+  std::vector<TRITONSERVER_InferenceTraceRecord> buffered_;
+  std::atomic<bool> failed_;
 
   // Maintain next id statically so that trace id is unique even
   // across traces
@@ -145,6 +193,8 @@ class InferenceTraceProxy {
   void SetModelName(const std::string& n) { trace_->SetModelName(n); }
   void SetRequestId(const std::string& n) { trace_->SetRequestId(n); }
   void SetModelVersion(int64_t v) { trace_->SetModelVersion(v); }
+  bool TracesTensors() const { return trace_->TracesTensors(); }
+  void MarkFailed() { trace_->MarkFailed(); }
 
   void Report(
       const TRITONSERVER_InferenceTraceActivity activity, uint64_t timestamp_ns)
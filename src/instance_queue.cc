@@ -26,12 +26,16 @@
 
 #include "instance_queue.h"
 
+#include "clock.h"
 #include "triton/common/logging.h"
 
 namespace triton { namespace core {
 
-InstanceQueue::InstanceQueue(size_t max_batch_size, uint64_t max_queue_delay_ns)
-    : max_batch_size_(max_batch_size), max_queue_delay_ns_(max_queue_delay_ns)
+InstanceQueue::InstanceQueue(
+    size_t max_batch_size, uint64_t max_queue_delay_ns,
+    bool merge_ready_payloads)
+    : max_batch_size_(max_batch_size), max_queue_delay_ns_(max_queue_delay_ns),
+      merge_ready_payloads_(merge_ready_payloads)
 {
 }
 
@@ -63,15 +67,16 @@ InstanceQueue::Dequeue(
   {
     std::lock_guard<std::mutex> exec_lock(*((*payload)->GetExecMutex()));
     (*payload)->SetState(Payload::State::EXECUTING);
-    if ((!payload_queue_.empty()) && (max_queue_delay_ns_ > 0) &&
+    if (merge_ready_payloads_ && (!payload_queue_.empty()) &&
+        (max_batch_size_ > 1) && (!(*payload)->IsSaturated())) {
+      MergeReadyPayloads(payload, merged_payloads);
+    } else if (
+        (!payload_queue_.empty()) && (max_queue_delay_ns_ > 0) &&
         (max_batch_size_ > 1) && (!(*payload)->IsSaturated())) {
       bool continue_merge;
       do {
         continue_merge = false;
-        uint64_t now_ns =
-            std::chrono::duration_cast<std::chrono::nanoseconds>(
-                std::chrono::steady_clock::now().time_since_epoch())
-                .count();
+        uint64_t now_ns = SteadyClockNs();
         size_t batch_size = (*payload)->BatchSize();
         if ((!payload_queue_.empty()) &&
             (!payload_queue_.front()->IsSaturated()) &&
@@ -96,4 +101,69 @@ InstanceQueue::Dequeue(
   }
 }
 
+void
+InstanceQueue::MergeReadyPayloads(
+    std::shared_ptr<Payload>* payload,
+    std::vector<std::shared_ptr<Payload>>* merged_payloads)
+{
+  // A payload that doesn't fit is skipped so that the smaller payloads
+  // behind it can still fill the batch, it stays at the front of the
+  // queue for the next dequeue.
+  size_t batch_size = (*payload)->BatchSize();
+  auto it = payload_queue_.begin();
+  while ((it != payload_queue_.end()) && (batch_size < max_batch_size_)) {
+    if ((*it)->IsSaturated() ||
+        ((*it)->GetOpType() != Payload::Operation::INFER_RUN)) {
+      ++it;
+      continue;
+    }
+    const size_t candidate_batch_size = (*it)->BatchSize();
+    if ((batch_size + candidate_batch_size) > max_batch_size_) {
+      ++it;
+      continue;
+    }
+
+    std::lock_guard<std::mutex> exec_lock(*((*it)->GetExecMutex()));
+    (*it)->SetState(Payload::State::EXECUTING);
+    const auto& status = (*payload)->MergePayload(*it);
+    if (status.IsOk()) {
+      batch_size += candidate_batch_size;
+      merged_payloads->push_back(*it);
+      it = payload_queue_.erase(it);
+    } else {
+      (*it)->SetState(Payload::State::SCHEDULED);
+      ++it;
+    }
+  }
+}
+
+bool
+InstanceQueue::Steal(std::shared_ptr<Payload>* payload)
+{
+  // Only inference payloads can be moved between instances, the other
+  // operations act on the instance itself. The newest payload is taken as
+  // it has waited the least on its instance.
+  for (auto it = payload_queue_.rbegin(); it != payload_queue_.rend(); ++it) {
+    if ((*it)->GetOpType() == Payload::Operation::INFER_RUN) {
+      *payload = *it;
+      payload_queue_.erase(std::next(it).base());
+      std::lock_guard<std::mutex> exec_lock(*((*payload)->GetExecMutex()));
+      (*payload)->SetState(Payload::State::EXECUTING);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool
+InstanceQueue::Stealable()
+{
+  for (const auto& payload : payload_queue_) {
+    if (payload->GetOpType() == Payload::Operation::INFER_RUN) {
+      return true;
+    }
+  }
+  return false;
+}
+
 }}  // namespace triton::core
@@ -36,7 +36,12 @@ namespace triton { namespace core {
 // model instance.
 class InstanceQueue {
  public:
-  explicit InstanceQueue(size_t max_batch_size, uint64_t max_queue_delay_ns);
+  // If 'merge_ready_payloads' is true, Dequeue() merges all queued
+  // payloads that fit into the dequeued payload, otherwise only the ones
+  // that have waited longer than 'max_queue_delay_ns'.
+  explicit InstanceQueue(
+      size_t max_batch_size, uint64_t max_queue_delay_ns,
+      bool merge_ready_payloads = false);
 
   size_t Size();
   bool Empty();
@@ -44,10 +49,22 @@ class InstanceQueue {
   void Dequeue(
       std::shared_ptr<Payload>* payload,
       std::vector<std::shared_ptr<Payload>>* merged_payloads);
+  // Remove the most recently enqueued payload that may be executed by
+  // another instance of the model. Return false if there is none.
+  bool Steal(std::shared_ptr<Payload>* payload);
+  // Whether or not the queue holds a payload that can be stolen.
+  bool Stealable();
 
  private:
+  // Merge the queued payloads that fit into 'payload' regardless of how
+  // long they have waited.
+  void MergeReadyPayloads(
+      std::shared_ptr<Payload>* payload,
+      std::vector<std::shared_ptr<Payload>>* merged_payloads);
+
   size_t max_batch_size_;
   uint64_t max_queue_delay_ns_;
+  bool merge_ready_payloads_;
 
   std::deque<std::shared_ptr<Payload>> payload_queue_;
   std::shared_ptr<Payload> staged_payload_;
@@ -0,0 +1,112 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "instrumented_mutex.h"
+
+#include <map>
+#include <memory>
+
+#include "clock.h"
+
+namespace triton { namespace core {
+
+namespace detail {
+std::atomic<bool> lock_profiling_enabled{false};
+}  // namespace detail
+
+namespace {
+
+// The statistics are shared by name and never freed, the set of names
+// is fixed by the code so it doesn't grow.
+class LockStatsRegistry {
+ public:
+  static LockStatsRegistry& Get()
+  {
+    static LockStatsRegistry* registry = new LockStatsRegistry();
+    return *registry;
+  }
+
+  LockStats* StatsFor(const std::string& name)
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto& stats = stats_[name];
+    if (stats == nullptr) {
+      stats.reset(new LockStats());
+    }
+    return stats.get();
+  }
+
+  void ForEach(
+      const std::function<void(const std::string&, const LockStats&)>& fn)
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    for (const auto& stats : stats_) {
+      fn(stats.first, *stats.second);
+    }
+  }
+
+ private:
+  std::mutex mu_;
+  std::map<std::string, std::unique_ptr<LockStats>> stats_;
+};
+
+}  // namespace
+
+void
+SetLockProfilingEnabled(bool enabled)
+{
+  detail::lock_profiling_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+LockStats*
+LockStatsFor(const std::string& name)
+{
+  return LockStatsRegistry::Get().StatsFor(name);
+}
+
+void
+ForEachLockStats(
+    const std::function<void(const std::string&, const LockStats&)>& fn)
+{
+  LockStatsRegistry::Get().ForEach(fn);
+}
+
+void
+InstrumentedMutex::LockProfiled()
+{
+  stats_->acquisition_count_.fetch_add(1, std::memory_order_relaxed);
+  if (mu_.try_lock()) {
+    return;
+  }
+
+  const uint64_t wait_start_ns = SteadyClockNs();
+  mu_.lock();
+  stats_->contention_count_.fetch_add(1, std::memory_order_relaxed);
+  stats_->wait_ns_.fetch_add(
+      SteadyClockNs() - wait_start_ns, std::memory_order_relaxed);
+}
+
+}}  // namespace triton::core
@@ -0,0 +1,131 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+
+namespace triton { namespace core {
+
+// Contention statistics of the mutexes sharing a name
+struct LockStats {
+  // The number of times the mutexes were locked
+  std::atomic<uint64_t> acquisition_count_{0};
+  // The number of acquisitions that had to wait for another holder
+  std::atomic<uint64_t> contention_count_{0};
+  // The cumulative time spent waiting by those acquisitions
+  std::atomic<uint64_t> wait_ns_{0};
+};
+
+namespace detail {
+extern std::atomic<bool> lock_profiling_enabled;
+}  // namespace detail
+
+// Are lock statistics recorded? Disabled by default. Can be changed at
+// any time, the statistics are not reset when disabled.
+inline bool
+LockProfilingEnabled()
+{
+  return detail::lock_profiling_enabled.load(std::memory_order_relaxed);
+}
+void SetLockProfilingEnabled(bool enabled);
+
+// Return the statistics of the mutexes named 'name'. The statistics
+// live for the duration of the process. Takes a global lock, so the
+// result should be kept rather than looked up again.
+LockStats* LockStatsFor(const std::string& name);
+
+// Call 'fn' with the name and statistics of every named mutex
+void ForEachLockStats(
+    const std::function<void(const std::string&, const LockStats&)>& fn);
+
+//
+// A mutex that records how often it is locked and how long the lockers
+// wait per name, while lock profiling is enabled. When disabled the cost
+// over std::mutex is a relaxed load of the enabled flag. Meets the
+// Lockable requirements, so it can be used with the standard lock
+// guards.
+//
+// Only acquisitions through InstrumentedMutex are recorded, condition
+// variable waits must start from the std::unique_lock returned by
+// Acquire(). Re-acquisitions on wakeup from a condition variable are not
+// recorded.
+//
+class InstrumentedMutex {
+ public:
+  explicit InstrumentedMutex(const std::string& name)
+      : stats_(LockStatsFor(name))
+  {
+  }
+
+  // Record to 'stats', which must outlive the mutex. Avoids the lookup
+  // of the statistics by name for mutexes that are created often.
+  explicit InstrumentedMutex(LockStats* stats) : stats_(stats) {}
+
+  InstrumentedMutex(const InstrumentedMutex&) = delete;
+  InstrumentedMutex& operator=(const InstrumentedMutex&) = delete;
+
+  void lock()
+  {
+    if (!LockProfilingEnabled()) {
+      mu_.lock();
+      return;
+    }
+    LockProfiled();
+  }
+
+  bool try_lock()
+  {
+    if (!mu_.try_lock()) {
+      return false;
+    }
+    if (LockProfilingEnabled()) {
+      stats_->acquisition_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  void unlock() { mu_.unlock(); }
+
+  // Lock and return the lock as a std::unique_lock over the underlying
+  // std::mutex, as needed to wait on a std::condition_variable.
+  std::unique_lock<std::mutex> Acquire()
+  {
+    lock();
+    return std::unique_lock<std::mutex>(mu_, std::adopt_lock);
+  }
+
+ private:
+  void LockProfiled();
+
+  std::mutex mu_;
+  LockStats* const stats_;
+};
+
+}}  // namespace triton::core
@@ -0,0 +1,154 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "json_writer.h"
+
+#include <cstdio>
+
+namespace triton { namespace core {
+
+void
+JsonWriter::Separate()
+{
+  if (after_key_) {
+    after_key_ = false;
+    return;
+  }
+  if (!has_value_.empty()) {
+    if (has_value_.back()) {
+      buffer_->push_back(',');
+    }
+    has_value_.back() = true;
+  }
+}
+
+void
+JsonWriter::Begin(char bracket)
+{
+  Separate();
+  buffer_->push_back(bracket);
+  has_value_.push_back(false);
+}
+
+void
+JsonWriter::End(char bracket)
+{
+  has_value_.pop_back();
+  buffer_->push_back(bracket);
+}
+
+void
+JsonWriter::Key(const char* key, size_t len)
+{
+  Separate();
+  AppendEscaped(key, len);
+  buffer_->push_back(':');
+  after_key_ = true;
+}
+
+void
+JsonWriter::String(const char* value, size_t len)
+{
+  Separate();
+  AppendEscaped(value, len);
+}
+
+void
+JsonWriter::Int(int64_t value)
+{
+  Separate();
+  buffer_->append(std::to_string(value));
+}
+
+void
+JsonWriter::UInt(uint64_t value)
+{
+  Separate();
+  buffer_->append(std::to_string(value));
+}
+
+void
+JsonWriter::Bool(bool value)
+{
+  Separate();
+  buffer_->append(value ? "true" : "false");
+}
+
+void
+JsonWriter::Raw(const std::string& json)
+{
+  Separate();
+  buffer_->append(json);
+}
+
+void
+JsonWriter::AppendEscaped(const char* value, size_t len)
+{
+  buffer_->push_back('"');
+  // Copy runs of characters that need no escaping at once
+  size_t run = 0;
+  for (size_t i = 0; i < len; ++i) {
+    const unsigned char c = value[i];
+    if ((c >= 0x20) && (c != '"') && (c != '\\')) {
+      continue;
+    }
+    buffer_->append(value + run, i - run);
+    run = i + 1;
+    switch (c) {
+      case '"':
+        buffer_->append("\\\"");
+        break;
+      case '\\':
+        buffer_->append("\\\\");
+        break;
+      case '\b':
+        buffer_->append("\\b");
+        break;
+      case '\f':
+        buffer_->append("\\f");
+        break;
+      case '\n':
+        buffer_->append("\\n");
+        break;
+      case '\r':
+        buffer_->append("\\r");
+        break;
+      case '\t':
+        buffer_->append("\\t");
+        break;
+      default: {
+        char escaped[7];
+        snprintf(escaped, sizeof(escaped), "\\u%04X", c);
+        buffer_->append(escaped);
+        break;
+      }
+    }
+  }
+  buffer_->append(value + run, len - run);
+  buffer_->push_back('"');
+}
+
+}}  // namespace triton::core
@@ -0,0 +1,85 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace triton { namespace core {
+
+//
+// Streaming JSON writer that appends directly to a caller-provided
+// string, for messages that would otherwise build a TritonJson document
+// only to serialize it. Strings are escaped the same way as TritonJson,
+// so the output is identical to writing the equivalent document.
+// Commas between members and elements are inserted automatically; the
+// caller is responsible for balancing the Begin/End calls and for
+// calling Key() before each member value of an object.
+//
+class JsonWriter {
+ public:
+  // Append to 'buffer', which must outlive the writer. Reusing the same
+  // buffer across messages reuses its capacity.
+  explicit JsonWriter(std::string* buffer) : buffer_(buffer) {}
+
+  void BeginObject() { Begin('{'); }
+  void EndObject() { End('}'); }
+  void BeginArray() { Begin('['); }
+  void EndArray() { End(']'); }
+
+  void Key(const char* key, size_t len);
+  void Key(const char* key) { Key(key, std::char_traits<char>::length(key)); }
+  void Key(const std::string& key) { Key(key.data(), key.size()); }
+
+  void String(const char* value, size_t len);
+  void String(const char* value)
+  {
+    String(value, std::char_traits<char>::length(value));
+  }
+  void String(const std::string& value) { String(value.data(), value.size()); }
+  void Int(int64_t value);
+  void UInt(uint64_t value);
+  void Bool(bool value);
+
+  // Append 'json', an already serialized JSON value, as the next value.
+  void Raw(const std::string& json);
+
+ private:
+  void Begin(char bracket);
+  void End(char bracket);
+  // Insert the separator needed before the next value, if any
+  void Separate();
+  void AppendEscaped(const char* value, size_t len);
+
+  std::string* buffer_;
+  // Whether each open object or array already has a member or element
+  std::vector<bool> has_value_;
+  // Set between a Key() and the value of the member
+  bool after_key_ = false;
+};
+
+}}  // namespace triton::core
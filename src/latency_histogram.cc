@@ -0,0 +1,130 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifdef TRITON_ENABLE_METRICS
+
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace triton { namespace core {
+
+LatencyHistogram::LatencyHistogram(const std::vector<double>& bucket_bounds)
+    : bounds_(bucket_bounds),
+      counts_(new std::atomic<uint64_t>[bucket_bounds.size() + 1]), sum_(0)
+{
+  for (size_t i = 0; i <= bounds_.size(); ++i) {
+    counts_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+void
+LatencyHistogram::Observe(double value)
+{
+  const size_t bucket =
+      std::lower_bound(bounds_.begin(), bounds_.end(), value) -
+      bounds_.begin();
+  counts_[bucket].fetch_add(1, std::memory_order_relaxed);
+  if (value > 0) {
+    sum_.fetch_add(static_cast<uint64_t>(value), std::memory_order_relaxed);
+  }
+}
+
+void
+LatencyHistogram::Collect(prometheus::ClientMetric::Histogram* histogram) const
+{
+  uint64_t cumulative_count = 0;
+  histogram->bucket.clear();
+  for (size_t i = 0; i <= bounds_.size(); ++i) {
+    cumulative_count += counts_[i].load(std::memory_order_relaxed);
+    prometheus::ClientMetric::Bucket bucket;
+    bucket.cumulative_count = cumulative_count;
+    bucket.upper_bound = (i < bounds_.size())
+                             ? bounds_[i]
+                             : std::numeric_limits<double>::infinity();
+    histogram->bucket.push_back(bucket);
+  }
+  histogram->sample_count = cumulative_count;
+  histogram->sample_sum = sum_.load(std::memory_order_relaxed);
+}
+
+LatencyHistogramFamily::LatencyHistogramFamily(
+    const std::string& name, const std::string& help)
+    : name_(name), help_(help)
+{
+}
+
+LatencyHistogram*
+LatencyHistogramFamily::Add(
+    const std::map<std::string, std::string>& labels,
+    const std::vector<double>& bucket_bounds)
+{
+  std::lock_guard<std::mutex> lk(mu_);
+  histograms_.emplace_back(
+      labels, std::unique_ptr<LatencyHistogram>(
+                  new LatencyHistogram(bucket_bounds)));
+  return histograms_.back().second.get();
+}
+
+void
+LatencyHistogramFamily::Remove(LatencyHistogram* histogram)
+{
+  std::lock_guard<std::mutex> lk(mu_);
+  for (auto it = histograms_.begin(); it != histograms_.end(); ++it) {
+    if (it->second.get() == histogram) {
+      histograms_.erase(it);
+      break;
+    }
+  }
+}
+
+std::vector<prometheus::MetricFamily>
+LatencyHistogramFamily::Collect() const
+{
+  prometheus::MetricFamily family;
+  family.name = name_;
+  family.help = help_;
+  family.type = prometheus::MetricType::Histogram;
+
+  std::lock_guard<std::mutex> lk(mu_);
+  for (const auto& histogram : histograms_) {
+    prometheus::ClientMetric metric;
+    for (const auto& label : histogram.first) {
+      prometheus::ClientMetric::Label client_label;
+      client_label.name = label.first;
+      client_label.value = label.second;
+      metric.label.push_back(client_label);
+    }
+    histogram.second->Collect(&metric.histogram);
+    family.metric.push_back(std::move(metric));
+  }
+  return {family};
+}
+
+}}  // namespace triton::core
+
+#endif  // TRITON_ENABLE_METRICS
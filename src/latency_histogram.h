@@ -0,0 +1,96 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#ifdef TRITON_ENABLE_METRICS
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "prometheus/collectable.h"
+#include "prometheus/metric_family.h"
+
+namespace triton { namespace core {
+
+//
+// A histogram with fixed bucket bounds. An observation is an atomic
+// increment of its bucket and of the sum, so that the histogram can be
+// updated from many threads without a lock, unlike prometheus::Summary
+// and prometheus::Histogram.
+//
+class LatencyHistogram {
+ public:
+  // 'bucket_bounds' are the inclusive upper bounds of the buckets in
+  // ascending order, an implicit +Inf bucket follows the last one.
+  explicit LatencyHistogram(const std::vector<double>& bucket_bounds);
+
+  void Observe(double value);
+
+  // Fill 'histogram' with the cumulative bucket counts, count and sum.
+  void Collect(prometheus::ClientMetric::Histogram* histogram) const;
+
+ private:
+  const std::vector<double> bounds_;
+  std::unique_ptr<std::atomic<uint64_t>[]> counts_;
+  // The observed values are integral durations, so the sum is kept as an
+  // integer that can be added to atomically
+  std::atomic<uint64_t> sum_;
+};
+
+//
+// A family of LatencyHistogram distinguished by labels. The family is
+// not part of the prometheus registry, Metrics adds it to the collected
+// metrics when serializing them.
+//
+class LatencyHistogramFamily : public prometheus::Collectable {
+ public:
+  LatencyHistogramFamily(const std::string& name, const std::string& help);
+
+  LatencyHistogram* Add(
+      const std::map<std::string, std::string>& labels,
+      const std::vector<double>& bucket_bounds);
+  void Remove(LatencyHistogram* histogram);
+
+  std::vector<prometheus::MetricFamily> Collect() const override;
+
+ private:
+  const std::string name_;
+  const std::string help_;
+  // Guards the membership of the family, not the observations
+  mutable std::mutex mu_;
+  std::vector<std::pair<
+      std::map<std::string, std::string>, std::unique_ptr<LatencyHistogram>>>
+      histograms_;
+};
+
+}}  // namespace triton::core
+
+#endif  // TRITON_ENABLE_METRICS
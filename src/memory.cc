@@ -26,6 +26,8 @@
 
 #include "memory.h"
 
+#include <utility>
+
 #include "pinned_memory_manager.h"
 #include "triton/common/logging.h"
 
@@ -46,28 +48,30 @@ MemoryReference::BufferAt(
     size_t idx, size_t* byte_size, TRITONSERVER_MemoryType* memory_type,
     int64_t* memory_type_id) const
 {
-  if (idx >= buffer_.size()) {
+  if (idx >= buffer_count_) {
     *byte_size = 0;
     *memory_type = TRITONSERVER_MEMORY_CPU;
     *memory_type_id = 0;
     return nullptr;
   }
-  *memory_type = buffer_[idx].buffer_attributes_.MemoryType();
-  *memory_type_id = buffer_[idx].buffer_attributes_.MemoryTypeId();
-  *byte_size = buffer_[idx].buffer_attributes_.ByteSize();
-  return buffer_[idx].buffer_;
+  const Block& block = BlockAt(idx);
+  *memory_type = block.buffer_attributes_.MemoryType();
+  *memory_type_id = block.buffer_attributes_.MemoryTypeId();
+  *byte_size = block.buffer_attributes_.ByteSize();
+  return block.buffer_;
 }
 
 const char*
 MemoryReference::BufferAt(size_t idx, BufferAttributes** buffer_attributes)
 {
-  if (idx >= buffer_.size()) {
+  if (idx >= buffer_count_) {
     *buffer_attributes = nullptr;
     return nullptr;
   }
 
-  *buffer_attributes = &(buffer_[idx].buffer_attributes_);
-  return buffer_[idx].buffer_;
+  Block& block = BlockAt(idx);
+  *buffer_attributes = &(block.buffer_attributes_);
+  return block.buffer_;
 }
 
 size_t
@@ -76,9 +80,8 @@ MemoryReference::AddBuffer(
     int64_t memory_type_id)
 {
   total_byte_size_ += byte_size;
-  buffer_count_++;
-  buffer_.emplace_back(buffer, byte_size, memory_type, memory_type_id);
-  return buffer_.size() - 1;
+  AppendBlock(Block(buffer, byte_size, memory_type, memory_type_id));
+  return buffer_count_ - 1;
 }
 
 size_t
@@ -86,9 +89,8 @@ MemoryReference::AddBuffer(
     const char* buffer, BufferAttributes* buffer_attributes)
 {
   total_byte_size_ += buffer_attributes->ByteSize();
-  buffer_count_++;
-  buffer_.emplace_back(buffer, buffer_attributes);
-  return buffer_.size() - 1;
+  AppendBlock(Block(buffer, buffer_attributes));
+  return buffer_count_ - 1;
 }
 
 size_t
@@ -97,10 +99,33 @@ MemoryReference::AddBufferFront(
     int64_t memory_type_id)
 {
   total_byte_size_ += byte_size;
+  // Shift the existing blocks back by one, the last one is displaced
+  // into 'block' and appended.
+  Block block(buffer, byte_size, memory_type, memory_type_id);
+  for (size_t idx = 0; idx < buffer_count_; ++idx) {
+    std::swap(block, BlockAt(idx));
+  }
+  AppendBlock(block);
+  return buffer_count_ - 1;
+}
+
+void
+MemoryReference::Clear()
+{
+  overflow_blocks_.clear();
+  total_byte_size_ = 0;
+  buffer_count_ = 0;
+}
+
+void
+MemoryReference::AppendBlock(const Block& block)
+{
+  if (buffer_count_ < kInlineBlockCount) {
+    inline_blocks_[buffer_count_] = block;
+  } else {
+    overflow_blocks_.push_back(block);
+  }
   buffer_count_++;
-  buffer_.emplace(
-      buffer_.begin(), buffer, byte_size, memory_type, memory_type_id);
-  return buffer_.size() - 1;
 }
 
 //
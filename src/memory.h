@@ -96,8 +96,16 @@ class MemoryReference : public Memory {
       const char* buffer, size_t byte_size, TRITONSERVER_MemoryType memory_type,
       int64_t memory_type_id);
 
+  // Remove all the buffers, keeping the storage of the blocks
+  void Clear();
+
  private:
+  // The number of blocks stored inline to avoid allocating for the
+  // common case of an input made of one or a few buffers.
+  static constexpr size_t kInlineBlockCount = 2;
+
   struct Block {
+    Block() : buffer_(nullptr) {}
     Block(
         const char* buffer, size_t byte_size,
         TRITONSERVER_MemoryType memory_type, int64_t memory_type_id)
@@ -113,7 +121,24 @@ class MemoryReference : public Memory {
     const char* buffer_;
     BufferAttributes buffer_attributes_;
   };
-  std::vector<Block> buffer_;
+
+  Block& BlockAt(size_t idx)
+  {
+    return (idx < kInlineBlockCount)
+               ? inline_blocks_[idx]
+               : overflow_blocks_[idx - kInlineBlockCount];
+  }
+  const Block& BlockAt(size_t idx) const
+  {
+    return (idx < kInlineBlockCount)
+               ? inline_blocks_[idx]
+               : overflow_blocks_[idx - kInlineBlockCount];
+  }
+  // Add 'block' after the existing blocks
+  void AppendBlock(const Block& block);
+
+  Block inline_blocks_[kInlineBlockCount];
+  std::vector<Block> overflow_blocks_;
 };
 
 //
@@ -28,6 +28,8 @@
 
 #ifdef TRITON_ENABLE_METRICS
 
+#include <algorithm>
+
 #include "constants.h"
 #include "triton/common/logging.h"
 
@@ -36,6 +38,18 @@ constexpr char GLOBAL_CONFIG_GROUP[] = "";
 
 namespace triton { namespace core {
 
+namespace {
+
+// The position of 'metric' in the metric arrays of the reporter
+template <typename MetricEnum>
+constexpr size_t
+Index(const MetricEnum metric)
+{
+  return static_cast<size_t>(metric);
+}
+
+}  // namespace
+
 //
 // MetricReporterConfig
 //
@@ -56,6 +70,22 @@ MetricReporterConfig::ParseConfig(bool response_cache_enabled)
       latency_summaries_enabled_ = true;
     }
 
+    if (pair.first == "histogram_latencies" && pair.second == "true") {
+      latency_histograms_enabled_ = true;
+    }
+
+    if (pair.first == "batch_histograms" && pair.second == "true") {
+      batch_histograms_enabled_ = true;
+    }
+
+    // ex: histogram_buckets="100,1000,10000,100000"
+    if (pair.first == "histogram_buckets") {
+      const auto& buckets = ParseBuckets(pair.second);
+      if (!buckets.empty()) {
+        histogram_buckets_ = buckets;
+      }
+    }
+
     // ex: summary_quantiles="0.5:0.05 0.9:0.01 0.99:0.001"
     if (pair.first == "summary_quantiles") {
       const auto& quantiles = ParseQuantiles(pair.second);
@@ -98,6 +128,31 @@ MetricReporterConfig::ParseQuantiles(std::string options)
   return qpairs;
 }
 
+std::vector<double>
+MetricReporterConfig::ParseBuckets(const std::string& options)
+{
+  std::vector<double> buckets;
+  std::stringstream ss(options);
+  std::string bound;
+  while (std::getline(ss, bound, ',')) {
+    try {
+      buckets.push_back(std::stod(bound));
+    }
+    catch (const std::exception& e) {
+      LOG_ERROR << "Invalid histogram bucket: [" << bound
+                << "]. Error: " << e.what();
+      return {};
+    }
+    if ((buckets.size() > 1) &&
+        (buckets.back() <= buckets[buckets.size() - 2])) {
+      LOG_ERROR << "Invalid histogram buckets: [" << options
+                << "]. Bounds must be in ascending order";
+      return {};
+    }
+  }
+  return buckets;
+}
+
 //
 // MetricModelReporter
 //
@@ -152,24 +207,34 @@ MetricModelReporter::MetricModelReporter(
   // Initialize families and metrics
   InitializeCounters(labels);
   InitializeSummaries(labels);
+  InitializeHistograms(labels);
+  InitializeGauges(labels);
 }
 
 MetricModelReporter::~MetricModelReporter()
 {
   // Cleanup metrics for each family
-  for (auto& iter : counter_families_) {
-    const auto& name = iter.first;
-    auto family_ptr = iter.second;
-    if (family_ptr) {
-      family_ptr->Remove(counters_[name]);
+  for (size_t i = 0; i < counter_families_.size(); ++i) {
+    if (counter_families_[i] != nullptr) {
+      counter_families_[i]->Remove(counters_[i]);
+    }
+  }
+
+  for (size_t i = 0; i < summary_families_.size(); ++i) {
+    if (summary_families_[i] != nullptr) {
+      summary_families_[i]->Remove(summaries_[i]);
     }
   }
 
-  for (auto& iter : summary_families_) {
-    const auto& name = iter.first;
-    auto family_ptr = iter.second;
-    if (family_ptr) {
-      family_ptr->Remove(summaries_[name]);
+  for (size_t i = 0; i < histogram_families_.size(); ++i) {
+    if (histogram_families_[i] != nullptr) {
+      histogram_families_[i]->Remove(histograms_[i]);
+    }
+  }
+
+  for (size_t i = 0; i < gauge_families_.size(); ++i) {
+    if (gauge_families_[i] != nullptr) {
+      gauge_families_[i]->Remove(gauges_[i]);
     }
   }
 }
@@ -179,43 +244,47 @@ MetricModelReporter::InitializeCounters(
     const std::map<std::string, std::string>& labels)
 {
   // Always setup these counters, regardless of config
-  counter_families_["inf_success"] = &Metrics::FamilyInferenceSuccess();
-  counter_families_["inf_failure"] = &Metrics::FamilyInferenceFailure();
-  counter_families_["inf_count"] = &Metrics::FamilyInferenceCount();
-  counter_families_["inf_exec_count"] =
+  counter_families_[Index(MetricCounter::INF_SUCCESS)] =
+      &Metrics::FamilyInferenceSuccess();
+  counter_families_[Index(MetricCounter::INF_FAILURE)] =
+      &Metrics::FamilyInferenceFailure();
+  counter_families_[Index(MetricCounter::INF_COUNT)] =
+      &Metrics::FamilyInferenceCount();
+  counter_families_[Index(MetricCounter::INF_EXEC_COUNT)] =
       &Metrics::FamilyInferenceExecutionCount();
 
   // Latency metrics will be initialized based on config
   if (config_.latency_counters_enabled_) {
     // Request
-    counter_families_["request_duration"] =
+    counter_families_[Index(MetricCounter::REQUEST_DURATION)] =
         &Metrics::FamilyInferenceRequestDuration();
-    counter_families_["queue_duration"] =
+    counter_families_[Index(MetricCounter::QUEUE_DURATION)] =
         &Metrics::FamilyInferenceQueueDuration();
     // Compute
-    counter_families_["compute_input_duration"] =
+    counter_families_[Index(MetricCounter::COMPUTE_INPUT_DURATION)] =
         &Metrics::FamilyInferenceComputeInputDuration();
-    counter_families_["compute_infer_duration"] =
+    counter_families_[Index(MetricCounter::COMPUTE_INFER_DURATION)] =
         &Metrics::FamilyInferenceComputeInferDuration();
-    counter_families_["compute_output_duration"] =
+    counter_families_[Index(MetricCounter::COMPUTE_OUTPUT_DURATION)] =
         &Metrics::FamilyInferenceComputeOutputDuration();
     // Only create cache metrics if cache is enabled to reduce metric output
     if (config_.cache_enabled_) {
-      counter_families_["cache_hit_count"] = &Metrics::FamilyCacheHitCount();
-      counter_families_["cache_miss_count"] = &Metrics::FamilyCacheMissCount();
-      counter_families_["cache_hit_duration"] =
+      counter_families_[Index(MetricCounter::CACHE_HIT_COUNT)] =
+          &Metrics::FamilyCacheHitCount();
+      counter_families_[Index(MetricCounter::CACHE_MISS_COUNT)] =
+          &Metrics::FamilyCacheMissCount();
+      counter_families_[Index(MetricCounter::CACHE_HIT_DURATION)] =
           &Metrics::FamilyCacheHitDuration();
-      counter_families_["cache_miss_duration"] =
+      counter_families_[Index(MetricCounter::CACHE_MISS_DURATION)] =
           &Metrics::FamilyCacheMissDuration();
     }
   }
 
   // Create metrics for each family
-  for (auto& iter : counter_families_) {
-    const auto& name = iter.first;
-    auto family_ptr = iter.second;
-    if (family_ptr) {
-      counters_[name] = CreateMetric<prometheus::Counter>(*family_ptr, labels);
+  for (size_t i = 0; i < counter_families_.size(); ++i) {
+    if (counter_families_[i] != nullptr) {
+      counters_[i] =
+          CreateMetric<prometheus::Counter>(*counter_families_[i], labels);
     }
   }
 }
@@ -230,35 +299,118 @@ MetricModelReporter::InitializeSummaries(
     if (!config_.cache_enabled_) {
       // FIXME: request_duration summary is currently disabled when cache is
       // enabled to avoid publishing misleading metrics.
-      summary_families_["request_duration"] =
+      summary_families_[Index(MetricSummary::REQUEST_DURATION)] =
           &Metrics::FamilyInferenceRequestSummary();
     }
-    summary_families_["queue_duration"] =
+    summary_families_[Index(MetricSummary::QUEUE_DURATION)] =
         &Metrics::FamilyInferenceQueueSummary();
     // Compute
-    summary_families_["compute_input_duration"] =
+    summary_families_[Index(MetricSummary::COMPUTE_INPUT_DURATION)] =
         &Metrics::FamilyInferenceComputeInputSummary();
-    summary_families_["compute_infer_duration"] =
+    summary_families_[Index(MetricSummary::COMPUTE_INFER_DURATION)] =
         &Metrics::FamilyInferenceComputeInferSummary();
-    summary_families_["compute_output_duration"] =
+    summary_families_[Index(MetricSummary::COMPUTE_OUTPUT_DURATION)] =
         &Metrics::FamilyInferenceComputeOutputSummary();
     // Only create cache metrics if cache is enabled to reduce metric output
     if (config_.cache_enabled_) {
       // Note that counts and sums are included in summaries
-      summary_families_["cache_hit_duration"] =
+      summary_families_[Index(MetricSummary::CACHE_HIT_DURATION)] =
           &Metrics::FamilyCacheHitSummary();
-      summary_families_["cache_miss_duration"] =
+      summary_families_[Index(MetricSummary::CACHE_MISS_DURATION)] =
           &Metrics::FamilyCacheMissSummary();
     }
   }
 
   // Create metrics for each family
-  for (auto& iter : summary_families_) {
-    const auto& name = iter.first;
-    auto family_ptr = iter.second;
-    if (family_ptr) {
-      summaries_[name] = CreateMetric<prometheus::Summary>(
-          *family_ptr, labels, config_.quantiles_);
+  for (size_t i = 0; i < summary_families_.size(); ++i) {
+    if (summary_families_[i] != nullptr) {
+      summaries_[i] = CreateMetric<prometheus::Summary>(
+          *summary_families_[i], labels, config_.quantiles_);
+    }
+  }
+}
+
+void
+MetricModelReporter::InitializeHistograms(
+    const std::map<std::string, std::string>& labels)
+{
+  // Latency metrics will be initialized based on config
+  if (config_.latency_histograms_enabled_) {
+    // Request
+    if (!config_.cache_enabled_) {
+      // Like the request_duration summary, the histogram is not published
+      // when cache is enabled as the cache insertion time is added later.
+      histogram_families_[Index(MetricHistogram::REQUEST_DURATION)] =
+          &Metrics::FamilyInferenceRequestHistogram();
+    }
+    histogram_families_[Index(MetricHistogram::QUEUE_DURATION)] =
+        &Metrics::FamilyInferenceQueueHistogram();
+    // Compute
+    histogram_families_[Index(MetricHistogram::COMPUTE_INPUT_DURATION)] =
+        &Metrics::FamilyInferenceComputeInputHistogram();
+    histogram_families_[Index(MetricHistogram::COMPUTE_INFER_DURATION)] =
+        &Metrics::FamilyInferenceComputeInferHistogram();
+    histogram_families_[Index(MetricHistogram::COMPUTE_OUTPUT_DURATION)] =
+        &Metrics::FamilyInferenceComputeOutputHistogram();
+  }
+
+  // Batch metrics will be initialized based on config
+  if (config_.batch_histograms_enabled_) {
+    histogram_families_[Index(MetricHistogram::BATCH_SIZE)] =
+        &Metrics::FamilyBatchSizeHistogram();
+    histogram_families_[Index(MetricHistogram::BATCH_QUEUE_DEPTH)] =
+        &Metrics::FamilyBatchQueueDepthHistogram();
+    histogram_families_[Index(MetricHistogram::BATCH_FILL_PERCENT)] =
+        &Metrics::FamilyBatchFillPercentHistogram();
+  }
+
+  // Create metrics for each family
+  const std::vector<double> fill_percent_buckets = {10, 20, 30, 40, 50,
+                                                    60, 70, 80, 90, 100};
+  for (size_t i = 0; i < histogram_families_.size(); ++i) {
+    if (histogram_families_[i] == nullptr) {
+      continue;
+    }
+    if ((i == Index(MetricHistogram::BATCH_SIZE)) ||
+        (i == Index(MetricHistogram::BATCH_QUEUE_DEPTH))) {
+      histograms_[i] =
+          histogram_families_[i]->Add(labels, config_.batch_size_buckets_);
+    } else if (i == Index(MetricHistogram::BATCH_FILL_PERCENT)) {
+      histograms_[i] =
+          histogram_families_[i]->Add(labels, fill_percent_buckets);
+    } else {
+      histograms_[i] =
+          histogram_families_[i]->Add(labels, config_.histogram_buckets_);
+    }
+  }
+}
+
+void
+MetricModelReporter::ObserveBatch(
+    size_t batch_size, size_t queue_depth, size_t max_batch_size)
+{
+  ObserveHistogram(MetricHistogram::BATCH_SIZE, batch_size);
+  ObserveHistogram(MetricHistogram::BATCH_QUEUE_DEPTH, queue_depth);
+  if (max_batch_size > 0) {
+    // Reported in percent as the histogram sums are integral
+    ObserveHistogram(
+        MetricHistogram::BATCH_FILL_PERCENT,
+        (100 * std::min(batch_size, max_batch_size)) / max_batch_size);
+  }
+}
+
+void
+MetricModelReporter::InitializeGauges(
+    const std::map<std::string, std::string>& labels)
+{
+  // Always setup these gauges, regardless of config
+  gauge_families_[Index(MetricGauge::BATCHER_QUEUE_DELAY)] =
+      &Metrics::FamilyBatcherQueueDelay();
+
+  // Create metrics for each family
+  for (size_t i = 0; i < gauge_families_.size(); ++i) {
+    if (gauge_families_[i] != nullptr) {
+      gauges_[i] = CreateMetric<prometheus::Gauge>(*gauge_families_[i], labels);
     }
   }
 }
@@ -304,48 +456,6 @@ MetricModelReporter::Config()
   return config_;
 }
 
-void
-MetricModelReporter::IncrementCounter(const std::string& name, double value)
-{
-  if (!config_.latency_counters_enabled_) {
-    return;
-  }
-
-  auto iter = counters_.find(name);
-  if (iter == counters_.end()) {
-    // No counter metric exists with this name
-    return;
-  }
-
-  auto counter = iter->second;
-  if (!counter) {
-    // Counter is uninitialized/nullptr
-    return;
-  }
-  counter->Increment(value);
-}
-
-void
-MetricModelReporter::ObserveSummary(const std::string& name, double value)
-{
-  if (!config_.latency_summaries_enabled_) {
-    return;
-  }
-
-  auto iter = summaries_.find(name);
-  if (iter == summaries_.end()) {
-    // No summary metric exists with this name
-    return;
-  }
-
-  auto summary = iter->second;
-  if (!summary) {
-    // Summary is uninitialized/nullptr
-    return;
-  }
-  summary->Observe(value);
-}
-
 }}  // namespace triton::core
 
 #endif  // TRITON_ENABLE_METRICS
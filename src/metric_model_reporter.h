@@ -25,6 +25,9 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <array>
+#include <vector>
+
 #include "status.h"
 #include "triton/common/model_config.h"
 
@@ -45,11 +48,26 @@ struct MetricReporterConfig {
   // Parses pairs of quantiles "quantile1:error1, quantile2:error2, ..."
   // and overwrites quantiles_ field if successful.
   prometheus::Summary::Quantiles ParseQuantiles(std::string options);
+  // Parses ascending bucket bounds "bound1, bound2, ..." and returns an
+  // empty vector if they are invalid.
+  std::vector<double> ParseBuckets(const std::string& options);
 
   // Create and use Counters for per-model latency related metrics
   bool latency_counters_enabled_ = true;
   // Create and use Summaries for per-model latency related metrics
   bool latency_summaries_enabled_ = false;
+  // Create and use lock-free Histograms for per-model latency related
+  // metrics, a cheaper alternative to summaries that can be aggregated
+  bool latency_histograms_enabled_ = false;
+  // The upper bounds of the histogram buckets, in microseconds
+  std::vector<double> histogram_buckets_ = {
+      100,   250,   500,    1000,   2500,   5000,   10000,
+      25000, 50000, 100000, 250000, 500000, 1000000};
+  // Create and use Histograms of the batches formed by the batchers
+  bool batch_histograms_enabled_ = false;
+  // The upper bounds of the batch size and queue depth buckets
+  std::vector<double> batch_size_buckets_ = {1,  2,   4,   8,   16,  32,
+                                             64, 128, 256, 512, 1024};
   // Quantiles used for any summary metrics. Each pair of values represents
   // { quantile, error }. For example, {0.90, 0.01} means to compute the
   // 90th percentile with 1% error on either side, so the approximate 90th
@@ -63,6 +81,54 @@ struct MetricReporterConfig {
 #endif  // TRITON_ENABLE_METRICS
 };
 
+#ifdef TRITON_ENABLE_METRICS
+//
+// The per-model metrics, resolved to their metric objects when the
+// reporter is created so that updating a metric is a plain array index.
+//
+enum class MetricCounter {
+  INF_SUCCESS,
+  INF_FAILURE,
+  INF_COUNT,
+  INF_EXEC_COUNT,
+  REQUEST_DURATION,
+  QUEUE_DURATION,
+  COMPUTE_INPUT_DURATION,
+  COMPUTE_INFER_DURATION,
+  COMPUTE_OUTPUT_DURATION,
+  CACHE_HIT_COUNT,
+  CACHE_MISS_COUNT,
+  CACHE_HIT_DURATION,
+  CACHE_MISS_DURATION,
+  COUNT
+};
+
+enum class MetricSummary {
+  REQUEST_DURATION,
+  QUEUE_DURATION,
+  COMPUTE_INPUT_DURATION,
+  COMPUTE_INFER_DURATION,
+  COMPUTE_OUTPUT_DURATION,
+  CACHE_HIT_DURATION,
+  CACHE_MISS_DURATION,
+  COUNT
+};
+
+enum class MetricHistogram {
+  REQUEST_DURATION,
+  QUEUE_DURATION,
+  COMPUTE_INPUT_DURATION,
+  COMPUTE_INFER_DURATION,
+  COMPUTE_OUTPUT_DURATION,
+  BATCH_SIZE,
+  BATCH_QUEUE_DEPTH,
+  BATCH_FILL_PERCENT,
+  COUNT
+};
+
+enum class MetricGauge { BATCHER_QUEUE_DELAY, COUNT };
+#endif  // TRITON_ENABLE_METRICS
+
 //
 // Interface for a metric reporter for a given version of a model.
 //
@@ -79,10 +145,48 @@ class MetricModelReporter {
 
   // Get this reporter's config
   const MetricReporterConfig& Config();
-  // Lookup counter metric by name, and increment it by value if it exists.
-  void IncrementCounter(const std::string& name, double value);
-  // Lookup summary metric by name, and observe the value if it exists.
-  void ObserveSummary(const std::string& name, double value);
+  // Increment the counter metric by value if it exists.
+  void IncrementCounter(const MetricCounter metric, double value)
+  {
+    if (!config_.latency_counters_enabled_) {
+      return;
+    }
+    auto counter = counters_[static_cast<size_t>(metric)];
+    if (counter != nullptr) {
+      counter->Increment(value);
+    }
+  }
+  // Observe the value with the summary metric if it exists.
+  void ObserveSummary(const MetricSummary metric, double value)
+  {
+    if (!config_.latency_summaries_enabled_) {
+      return;
+    }
+    auto summary = summaries_[static_cast<size_t>(metric)];
+    if (summary != nullptr) {
+      summary->Observe(value);
+    }
+  }
+  // Observe the value with the histogram metric if it exists.
+  void ObserveHistogram(const MetricHistogram metric, double value)
+  {
+    auto histogram = histograms_[static_cast<size_t>(metric)];
+    if (histogram != nullptr) {
+      histogram->Observe(value);
+    }
+  }
+  // Observe a batch of 'batch_size' formed while 'queue_depth' requests
+  // were pending, with the batch histograms if they exist.
+  void ObserveBatch(
+      size_t batch_size, size_t queue_depth, size_t max_batch_size);
+  // Set the gauge metric to value if it exists.
+  void SetGauge(const MetricGauge metric, double value)
+  {
+    auto gauge = gauges_[static_cast<size_t>(metric)];
+    if (gauge != nullptr) {
+      gauge->Set(value);
+    }
+  }
 
  private:
   MetricModelReporter(
@@ -102,16 +206,37 @@ class MetricModelReporter {
 
   void InitializeCounters(const std::map<std::string, std::string>& labels);
   void InitializeSummaries(const std::map<std::string, std::string>& labels);
-
-  // Metric Families
-  std::unordered_map<std::string, prometheus::Family<prometheus::Counter>*>
-      counter_families_;
-  std::unordered_map<std::string, prometheus::Family<prometheus::Summary>*>
-      summary_families_;
+  void InitializeHistograms(
+      const std::map<std::string, std::string>& labels);
+  void InitializeGauges(const std::map<std::string, std::string>& labels);
+
+  // Metric Families, nullptr for the metrics that are not enabled
+  std::array<
+      prometheus::Family<prometheus::Counter>*,
+      static_cast<size_t>(MetricCounter::COUNT)>
+      counter_families_{};
+  std::array<
+      prometheus::Family<prometheus::Summary>*,
+      static_cast<size_t>(MetricSummary::COUNT)>
+      summary_families_{};
+  std::array<
+      LatencyHistogramFamily*, static_cast<size_t>(MetricHistogram::COUNT)>
+      histogram_families_{};
+  std::array<
+      prometheus::Family<prometheus::Gauge>*,
+      static_cast<size_t>(MetricGauge::COUNT)>
+      gauge_families_{};
 
   // Metrics
-  std::unordered_map<std::string, prometheus::Counter*> counters_;
-  std::unordered_map<std::string, prometheus::Summary*> summaries_;
+  std::array<prometheus::Counter*, static_cast<size_t>(MetricCounter::COUNT)>
+      counters_{};
+  std::array<prometheus::Summary*, static_cast<size_t>(MetricSummary::COUNT)>
+      summaries_{};
+  std::array<
+      LatencyHistogram*, static_cast<size_t>(MetricHistogram::COUNT)>
+      histograms_{};
+  std::array<prometheus::Gauge*, static_cast<size_t>(MetricGauge::COUNT)>
+      gauges_{};
 
   // Config
   MetricReporterConfig config_;
@@ -29,8 +29,11 @@
 
 #include "metrics.h"
 
+#include <algorithm>
+#include <string>
 #include <thread>
 #include "constants.h"
+#include "instrumented_mutex.h"
 #include "prometheus/detail/utils.h"
 #include "triton/common/logging.h"
 
@@ -122,6 +125,73 @@ Metrics::Metrics()
                     "microseconds")
               .Register(*registry_)),
 
+      // Per-step ensemble metric families
+      ensemble_step_wait_duration_us_family_(
+          prometheus::BuildCounter()
+              .Name("nv_ensemble_step_wait_duration_us")
+              .Help("Cumulative duration ensemble steps wait between their "
+                    "inputs being ready and their request being sent, in "
+                    "microseconds")
+              .Register(*registry_)),
+      ensemble_step_execution_duration_us_family_(
+          prometheus::BuildCounter()
+              .Name("nv_ensemble_step_execution_duration_us")
+              .Help("Cumulative duration between ensemble step requests "
+                    "being sent and completing, in microseconds")
+              .Register(*registry_)),
+      ensemble_step_critical_path_duration_us_family_(
+          prometheus::BuildCounter()
+              .Name("nv_ensemble_step_critical_path_duration_us")
+              .Help("Cumulative duration of ensemble requests spent on the "
+                    "critical path through each step, in microseconds")
+              .Register(*registry_)),
+      pinned_memory_fallback_count_family_(
+          prometheus::BuildCounter()
+              .Name("nv_pinned_memory_fallback_count")
+              .Help("Number of pinned memory allocations served from "
+                    "non-pinned system memory")
+              .Register(*registry_)),
+      pinned_memory_fallback_bytes_family_(
+          prometheus::BuildCounter()
+              .Name("nv_pinned_memory_fallback_bytes")
+              .Help("Cumulative byte size of pinned memory allocations served "
+                    "from non-pinned system memory")
+              .Register(*registry_)),
+      pinned_memory_allocation_count_family_(
+          prometheus::BuildCounter()
+              .Name("nv_pinned_memory_allocation_count")
+              .Help("Number of allocations served from the pinned memory "
+                    "pool")
+              .Register(*registry_)),
+      cuda_memory_allocation_count_family_(
+          prometheus::BuildCounter()
+              .Name("nv_cuda_memory_allocation_count")
+              .Help("Number of allocations served from the CUDA memory pool")
+              .Register(*registry_)),
+      cuda_memory_allocation_failure_count_family_(
+          prometheus::BuildCounter()
+              .Name("nv_cuda_memory_allocation_failure_count")
+              .Help("Number of allocations that the CUDA memory pool failed "
+                    "to serve")
+              .Register(*registry_)),
+      lock_acquisition_count_family_(
+          prometheus::BuildCounter()
+              .Name("nv_lock_acquisition_count")
+              .Help("Number of acquisitions of the named core mutexes")
+              .Register(*registry_)),
+      lock_contention_count_family_(
+          prometheus::BuildCounter()
+              .Name("nv_lock_contention_count")
+              .Help("Number of acquisitions of the named core mutexes that "
+                    "waited for another holder")
+              .Register(*registry_)),
+      lock_wait_duration_us_family_(
+          prometheus::BuildCounter()
+              .Name("nv_lock_wait_duration_us")
+              .Help("Cumulative time spent waiting to acquire the named core "
+                    "mutexes, in microseconds")
+              .Register(*registry_)),
+
       // Summaries
       inf_request_summary_us_family_(
           prometheus::BuildSummary()
@@ -168,6 +238,78 @@ Metrics::Metrics()
                     "microseconds.")
               .Register(*registry_)),
 
+      // Histograms
+      inf_request_histogram_us_family_(
+          "nv_inference_request_histogram_us",
+          "Histogram of inference request duration in microseconds "
+          "(includes cached requests)"),
+      inf_queue_histogram_us_family_(
+          "nv_inference_queue_histogram_us",
+          "Histogram of inference queuing duration in microseconds "
+          "(includes cached requests)"),
+      inf_compute_input_histogram_us_family_(
+          "nv_inference_compute_input_histogram_us",
+          "Histogram of compute input duration in microseconds (does not "
+          "include cached requests)"),
+      inf_compute_infer_histogram_us_family_(
+          "nv_inference_compute_infer_histogram_us",
+          "Histogram of compute inference duration in microseconds (does "
+          "not include cached requests)"),
+      inf_compute_output_histogram_us_family_(
+          "nv_inference_compute_output_histogram_us",
+          "Histogram of compute output duration in microseconds (does not "
+          "include cached requests)"),
+      batch_size_histogram_family_(
+          "nv_inference_batch_size_histogram",
+          "Histogram of the batch sizes formed by the batcher"),
+      batch_queue_depth_histogram_family_(
+          "nv_inference_batch_queue_depth_histogram",
+          "Histogram of the number of pending requests when the batcher "
+          "forms a batch"),
+      batch_fill_percent_histogram_family_(
+          "nv_inference_batch_fill_percent_histogram",
+          "Histogram of the batch sizes formed by the batcher, in percent "
+          "of the maximum batch size"),
+
+      // Gauges
+      batcher_queue_delay_us_family_(
+          prometheus::BuildGauge()
+              .Name("nv_inference_batcher_queue_delay_us")
+              .Help("Maximum queue delay currently used by the dynamic "
+                    "batcher, in microseconds")
+              .Register(*registry_)),
+      pinned_memory_pool_bytes_family_(
+          prometheus::BuildGauge()
+              .Name("nv_pinned_memory_pool_bytes")
+              .Help("Pinned memory pool size, in bytes")
+              .Register(*registry_)),
+      pinned_memory_pool_used_bytes_family_(
+          prometheus::BuildGauge()
+              .Name("nv_pinned_memory_pool_used_bytes")
+              .Help("Pinned memory pool used memory, in bytes")
+              .Register(*registry_)),
+      pinned_memory_pool_free_bytes_family_(
+          prometheus::BuildGauge()
+              .Name("nv_pinned_memory_pool_free_bytes")
+              .Help("Pinned memory pool free memory, in bytes")
+              .Register(*registry_)),
+      pinned_memory_pool_largest_free_bytes_family_(
+          prometheus::BuildGauge()
+              .Name("nv_pinned_memory_pool_largest_free_bytes")
+              .Help("Largest allocation the pinned memory pool can serve "
+                    "without growing, in bytes")
+              .Register(*registry_)),
+      cuda_memory_pool_used_bytes_family_(
+          prometheus::BuildGauge()
+              .Name("nv_cuda_memory_pool_used_bytes")
+              .Help("CUDA memory pool used memory, in bytes")
+              .Register(*registry_)),
+      cuda_memory_pool_free_bytes_family_(
+          prometheus::BuildGauge()
+              .Name("nv_cuda_memory_pool_free_bytes")
+              .Help("CUDA memory pool free memory, in bytes")
+              .Register(*registry_)),
+
 #ifdef TRITON_ENABLE_METRICS_GPU
       gpu_utilization_family_(prometheus::BuildGauge()
                                   .Name("nv_gpu_utilization")
@@ -212,8 +354,10 @@ Metrics::Metrics()
                                   .Register(*registry_)),
 #endif  // TRITON_ENABLE_METRICS_CPU
 
-      metrics_enabled_(false), gpu_metrics_enabled_(false),
-      cpu_metrics_enabled_(false), metrics_interval_ms_(2000)
+      poll_thread_exit_(false), metrics_enabled_(false),
+      gpu_metrics_enabled_(false), cpu_metrics_enabled_(false),
+      lock_metrics_enabled_(false), metrics_interval_ms_(2000),
+      next_collect_callback_id_(0)
 {
 }
 
@@ -227,10 +371,16 @@ Metrics::HashLabels(const std::map<std::string, std::string>& labels)
 
 Metrics::~Metrics()
 {
-  // Signal the poll thread to exit and then wait for it...
-  if (poll_thread_ != nullptr) {
-    poll_thread_exit_.store(true);
-    poll_thread_->join();
+  // Signal the poll threads to exit and then wait for them...
+  if (!poll_threads_.empty()) {
+    {
+      std::lock_guard<std::mutex> lk(poll_mtx_);
+      poll_thread_exit_ = true;
+    }
+    poll_cv_.notify_all();
+    for (auto& poll_thread : poll_threads_) {
+      poll_thread->join();
+    }
 #ifdef TRITON_ENABLE_METRICS_GPU
     if (dcgm_metadata_.dcgm_initialized_) {
       dcgmReturn_t derr;
@@ -274,6 +424,22 @@ Metrics::SetConfigMap(MetricsConfigMap cfg)
   singleton->config_ = cfg;
 }
 
+bool
+Metrics::ConfigFlag(const std::string& key)
+{
+  auto singleton = GetSingleton();
+  const auto global_config = singleton->config_.find("");
+  if (global_config == singleton->config_.end()) {
+    return false;
+  }
+  for (const auto& pair : global_config->second) {
+    if (pair.first == key) {
+      return pair.second == "true";
+    }
+  }
+  return false;
+}
+
 bool
 Metrics::Enabled()
 {
@@ -319,6 +485,59 @@ Metrics::EnableCpuMetrics()
   singleton->cpu_metrics_enabled_ = true;
 }
 
+void
+Metrics::EnableLockMetrics()
+{
+  auto singleton = GetSingleton();
+  {
+    std::lock_guard<std::mutex> lock(singleton->metrics_enabling_);
+    if (singleton->lock_metrics_enabled_) {
+      return;
+    }
+    singleton->lock_metrics_enabled_ = true;
+  }
+
+  SetLockProfilingEnabled(true);
+  AddCollectCallback([singleton]() { singleton->CollectLockMetrics(); });
+}
+
+void
+Metrics::CollectLockMetrics()
+{
+  ForEachLockStats([this](const std::string& name, const LockStats& stats) {
+    auto it = lock_metrics_.find(name);
+    if (it == lock_metrics_.end()) {
+      const std::map<std::string, std::string> labels{{"lock", name}};
+      it = lock_metrics_
+               .emplace(
+                   name,
+                   LockMetric{
+                       &lock_acquisition_count_family_.Add(labels),
+                       &lock_contention_count_family_.Add(labels),
+                       &lock_wait_duration_us_family_.Add(labels), 0, 0, 0})
+               .first;
+    }
+
+    // The statistics only grow, the counters are advanced by the
+    // difference since the last collection.
+    LockMetric& metric = it->second;
+    const uint64_t acquisition_count =
+        stats.acquisition_count_.load(std::memory_order_relaxed);
+    const uint64_t contention_count =
+        stats.contention_count_.load(std::memory_order_relaxed);
+    const uint64_t wait_ns = stats.wait_ns_.load(std::memory_order_relaxed);
+    metric.acquisition_count_->Increment(
+        acquisition_count - metric.last_acquisition_count_);
+    metric.contention_count_->Increment(
+        contention_count - metric.last_contention_count_);
+    metric.wait_duration_us_->Increment(
+        (wait_ns - metric.last_wait_ns_) / 1000.0);
+    metric.last_acquisition_count_ = acquisition_count;
+    metric.last_contention_count_ = contention_count;
+    metric.last_wait_ns_ = wait_ns;
+  });
+}
+
 void
 Metrics::SetMetricsInterval(uint64_t metrics_interval_ms)
 {
@@ -353,33 +572,68 @@ Metrics::StartPollingThread()
                    "poll for them.";
     return false;
   }
-  poll_thread_exit_.store(false);
-
-  // Start a separate thread for polling metrics at specified interval
-  poll_thread_.reset(new std::thread([this] {
-    // Thread will update metrics indefinitely until exit flag set
-    while (!poll_thread_exit_.load()) {
-      // Sleep for metric interval
-      std::this_thread::sleep_for(
-          std::chrono::milliseconds(metrics_interval_ms_ / 2));
 
+  // Each source is polled by its own thread at its own interval, so a
+  // slow DCGM query doesn't delay the CPU metrics and vice versa.
 #ifdef TRITON_ENABLE_METRICS_GPU
-      // Poll DCGM GPU metrics
-      if (gpu_metrics_enabled_ &&
-          dcgm_metadata_.available_cuda_gpu_ids_.size() > 0) {
-        PollDcgmMetrics();
-      }
+  if (gpu_metrics_enabled_ &&
+      dcgm_metadata_.available_cuda_gpu_ids_.size() > 0) {
+    StartPoller(PollingInterval("gpu"), [this] { PollDcgmMetrics(); });
+  }
 #endif  // TRITON_ENABLE_METRICS_GPU
 
 #ifdef TRITON_ENABLE_METRICS_CPU
-      if (cpu_metrics_enabled_) {
-        PollCpuMetrics();
-      }
+  if (cpu_metrics_enabled_) {
+    StartPoller(PollingInterval("cpu"), [this] { PollCpuMetrics(); });
+  }
 #endif  // TRITON_ENABLE_METRICS_CPU
+
+  return !poll_threads_.empty();
+}
+
+void
+Metrics::StartPoller(uint64_t interval_ms, std::function<void()> poll)
+{
+  // Poll twice per interval
+  const auto period =
+      std::chrono::milliseconds(std::max<uint64_t>(1, interval_ms / 2));
+  poll_threads_.emplace_back(new std::thread([this, period, poll] {
+    // Thread will update metrics indefinitely until exit flag set
+    std::unique_lock<std::mutex> lk(poll_mtx_);
+    while (!poll_cv_.wait_for(
+        lk, period, [this] { return poll_thread_exit_; })) {
+      lk.unlock();
+      poll();
+      lk.lock();
     }
   }));
+}
 
-  return true;
+uint64_t
+Metrics::PollingInterval(const std::string& source) const
+{
+  uint64_t interval_ms = metrics_interval_ms_;
+  const auto global_config = config_.find("");
+  if (global_config == config_.end()) {
+    return interval_ms;
+  }
+
+  // ex: gpu_metrics_interval_ms="5000"
+  const std::string key = source + "_metrics_interval_ms";
+  for (const auto& pair : global_config->second) {
+    if (pair.first != key) {
+      continue;
+    }
+    try {
+      interval_ms = std::stoull(pair.second);
+    }
+    catch (const std::exception& e) {
+      LOG_WARNING << "Invalid value '" << pair.second << "' for metrics "
+                  << "config '" << key << "', using " << interval_ms
+                  << " ms: " << e.what();
+    }
+  }
+  return interval_ms;
 }
 
 #ifdef TRITON_ENABLE_METRICS_CPU
@@ -537,6 +791,11 @@ Metrics::PollDcgmMetrics()
   }
 
   dcgmUpdateAllFields(dcgm_metadata_.dcgm_handle_, 1 /* wait for update*/);
+
+  // Query the fields of all GPUs at once, the values are returned for
+  // each entity in turn in the order of 'fields_'.
+  std::vector<unsigned int> didxs;
+  std::vector<dcgmGroupEntityPair_t> entities;
   for (unsigned int didx = 0;
        didx < dcgm_metadata_.available_cuda_gpu_ids_.size(); ++didx) {
     uint32_t cuda_id = dcgm_metadata_.available_cuda_gpu_ids_[didx];
@@ -544,11 +803,28 @@ Metrics::PollDcgmMetrics()
       LOG_WARNING << "Cannot find DCGM id for CUDA id " << cuda_id;
       continue;
     }
-    uint32_t dcgm_id = dcgm_metadata_.cuda_ids_to_dcgm_ids_.at(cuda_id);
-    dcgmFieldValue_v1 field_values[dcgm_metadata_.field_count_];
-    dcgmReturn_t dcgmerr = dcgmGetLatestValuesForFields(
-        dcgm_metadata_.dcgm_handle_, dcgm_id, dcgm_metadata_.fields_.data(),
-        dcgm_metadata_.field_count_, field_values);
+    dcgmGroupEntityPair_t entity;
+    entity.entityGroupId = DCGM_FE_GPU;
+    entity.entityId = dcgm_metadata_.cuda_ids_to_dcgm_ids_.at(cuda_id);
+    didxs.push_back(didx);
+    entities.push_back(entity);
+  }
+  if (entities.empty()) {
+    return true;
+  }
+
+  std::vector<dcgmFieldValue_v2> all_field_values(
+      entities.size() * dcgm_metadata_.field_count_);
+  dcgmReturn_t dcgmerr = dcgmEntitiesGetLatestValues(
+      dcgm_metadata_.dcgm_handle_, entities.data(), entities.size(),
+      dcgm_metadata_.fields_.data(), dcgm_metadata_.field_count_,
+      0 /* flags */, all_field_values.data());
+
+  for (size_t eidx = 0; eidx < entities.size(); ++eidx) {
+    const unsigned int didx = didxs[eidx];
+    const uint32_t cuda_id = dcgm_metadata_.available_cuda_gpu_ids_[didx];
+    const dcgmFieldValue_v2* field_values =
+        &all_field_values[eidx * dcgm_metadata_.field_count_];
 
     if (dcgmerr != DCGM_ST_OK) {
       dcgm_metadata_.power_limit_fail_cnt_[didx]++;
@@ -868,7 +1144,7 @@ Metrics::InitializeDcgmMetrics()
 
   dcgmerr = dcgmWatchFields(
       dcgm_metadata_.dcgm_handle_, dcgm_metadata_.groupId_, fieldGroupId,
-      metrics_interval_ms_ * 1000 /*update period, usec*/,
+      PollingInterval("gpu") * 1000 /*update period, usec*/,
       5.0 /*maxKeepAge, sec*/, 5 /*maxKeepSamples*/);
   if (dcgmerr != DCGM_ST_OK) {
     LOG_WARNING << "Cannot start watching fields: " << errorString(dcgmerr);
@@ -963,8 +1239,45 @@ const std::string
 Metrics::SerializedMetrics()
 {
   auto singleton = Metrics::GetSingleton();
-  return singleton->serializer_->Serialize(
-      singleton->registry_.get()->Collect());
+  {
+    std::lock_guard<std::mutex> lk(singleton->collect_callbacks_mtx_);
+    for (const auto& callback : singleton->collect_callbacks_) {
+      callback.second();
+    }
+  }
+  auto families = singleton->registry_.get()->Collect();
+  for (const LatencyHistogramFamily* histogram_family :
+       {&singleton->inf_request_histogram_us_family_,
+        &singleton->inf_queue_histogram_us_family_,
+        &singleton->inf_compute_input_histogram_us_family_,
+        &singleton->inf_compute_infer_histogram_us_family_,
+        &singleton->inf_compute_output_histogram_us_family_,
+        &singleton->batch_size_histogram_family_,
+        &singleton->batch_queue_depth_histogram_family_,
+        &singleton->batch_fill_percent_histogram_family_}) {
+    for (auto& family : histogram_family->Collect()) {
+      families.emplace_back(std::move(family));
+    }
+  }
+  return singleton->serializer_->Serialize(families);
+}
+
+uint64_t
+Metrics::AddCollectCallback(std::function<void()> callback)
+{
+  auto singleton = Metrics::GetSingleton();
+  std::lock_guard<std::mutex> lk(singleton->collect_callbacks_mtx_);
+  const uint64_t id = singleton->next_collect_callback_id_++;
+  singleton->collect_callbacks_.emplace(id, std::move(callback));
+  return id;
+}
+
+void
+Metrics::RemoveCollectCallback(uint64_t id)
+{
+  auto singleton = Metrics::GetSingleton();
+  std::lock_guard<std::mutex> lk(singleton->collect_callbacks_mtx_);
+  singleton->collect_callbacks_.erase(id);
 }
 
 Metrics*
@@ -29,9 +29,13 @@
 #ifdef TRITON_ENABLE_METRICS
 
 #include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
 #include <mutex>
 #include <thread>
 #include "cache_manager.h"
+#include "latency_histogram.h"
 #include "prometheus/counter.h"
 #include "prometheus/gauge.h"
 #include "prometheus/registry.h"
@@ -121,6 +125,10 @@ class Metrics {
   // Enable reporting of CPU metrics
   static void EnableCpuMetrics();
 
+  // Enable recording and reporting of the contention of the
+  // instrumented mutexes, \see InstrumentedMutex
+  static void EnableLockMetrics();
+
   // Start a thread for polling enabled metrics if any
   static void StartPollingThreadSingleton();
 
@@ -133,12 +141,24 @@ class Metrics {
   // Get the config for Metrics
   static const MetricsConfigMap& ConfigMap();
 
+  // Return true if the global config sets 'key' to "true"
+  static bool ConfigFlag(const std::string& key);
+
   // Get the prometheus registry
   static std::shared_ptr<prometheus::Registry> GetRegistry();
 
   // Get serialized metrics
   static const std::string SerializedMetrics();
 
+  // Register 'callback' to be called each time the metrics are
+  // serialized, to update the metrics that are too costly to keep up to
+  // date on every change. Return the id to remove the callback with.
+  static uint64_t AddCollectCallback(std::function<void()> callback);
+
+  // Remove the callback registered as 'id'. The callback is not running
+  // and won't be called again once this returns.
+  static void RemoveCollectCallback(uint64_t id);
+
   // Get the UUID for a CUDA device. Return true and initialize 'uuid'
   // if a UUID is found, return false if a UUID cannot be returned.
   static bool UUIDForCudaDevice(int cuda_device, std::string* uuid);
@@ -221,6 +241,55 @@ class Metrics {
     return GetSingleton()->cache_miss_duration_us_model_family_;
   }
 
+  // Metric families of cumulative ensemble step durations, in
+  // microseconds. The critical path duration is the part of the
+  // ensemble request duration spent waiting on the step.
+  static prometheus::Family<prometheus::Counter>&
+  FamilyEnsembleStepWaitDuration()
+  {
+    return GetSingleton()->ensemble_step_wait_duration_us_family_;
+  }
+  static prometheus::Family<prometheus::Counter>&
+  FamilyEnsembleStepExecutionDuration()
+  {
+    return GetSingleton()->ensemble_step_execution_duration_us_family_;
+  }
+  static prometheus::Family<prometheus::Counter>&
+  FamilyEnsembleStepCriticalPathDuration()
+  {
+    return GetSingleton()->ensemble_step_critical_path_duration_us_family_;
+  }
+
+  // Metric families of pinned memory allocations that were served from
+  // non-pinned system memory, per NUMA node
+  static prometheus::Family<prometheus::Counter>&
+  FamilyPinnedMemoryFallbackCount()
+  {
+    return GetSingleton()->pinned_memory_fallback_count_family_;
+  }
+  static prometheus::Family<prometheus::Counter>&
+  FamilyPinnedMemoryFallbackBytes()
+  {
+    return GetSingleton()->pinned_memory_fallback_bytes_family_;
+  }
+  static prometheus::Family<prometheus::Counter>&
+  FamilyPinnedMemoryAllocationCount()
+  {
+    return GetSingleton()->pinned_memory_allocation_count_family_;
+  }
+
+  // Metric families of the CUDA memory pools, per GPU
+  static prometheus::Family<prometheus::Counter>&
+  FamilyCudaMemoryAllocationCount()
+  {
+    return GetSingleton()->cuda_memory_allocation_count_family_;
+  }
+  static prometheus::Family<prometheus::Counter>&
+  FamilyCudaMemoryAllocationFailureCount()
+  {
+    return GetSingleton()->cuda_memory_allocation_failure_count_family_;
+  }
+
   // Summaries
   static prometheus::Family<prometheus::Summary>&
   FamilyInferenceRequestSummary()
@@ -255,6 +324,73 @@ class Metrics {
     return GetSingleton()->cache_miss_summary_us_model_family_;
   }
 
+  // Histograms
+  static LatencyHistogramFamily& FamilyInferenceRequestHistogram()
+  {
+    return GetSingleton()->inf_request_histogram_us_family_;
+  }
+  static LatencyHistogramFamily& FamilyInferenceQueueHistogram()
+  {
+    return GetSingleton()->inf_queue_histogram_us_family_;
+  }
+  static LatencyHistogramFamily& FamilyInferenceComputeInputHistogram()
+  {
+    return GetSingleton()->inf_compute_input_histogram_us_family_;
+  }
+  static LatencyHistogramFamily& FamilyInferenceComputeInferHistogram()
+  {
+    return GetSingleton()->inf_compute_infer_histogram_us_family_;
+  }
+  static LatencyHistogramFamily& FamilyInferenceComputeOutputHistogram()
+  {
+    return GetSingleton()->inf_compute_output_histogram_us_family_;
+  }
+  static LatencyHistogramFamily& FamilyBatchSizeHistogram()
+  {
+    return GetSingleton()->batch_size_histogram_family_;
+  }
+  static LatencyHistogramFamily& FamilyBatchQueueDepthHistogram()
+  {
+    return GetSingleton()->batch_queue_depth_histogram_family_;
+  }
+  static LatencyHistogramFamily& FamilyBatchFillPercentHistogram()
+  {
+    return GetSingleton()->batch_fill_percent_histogram_family_;
+  }
+
+  // Gauges
+  static prometheus::Family<prometheus::Gauge>& FamilyBatcherQueueDelay()
+  {
+    return GetSingleton()->batcher_queue_delay_us_family_;
+  }
+  static prometheus::Family<prometheus::Gauge>& FamilyPinnedMemoryPoolBytes()
+  {
+    return GetSingleton()->pinned_memory_pool_bytes_family_;
+  }
+  static prometheus::Family<prometheus::Gauge>&
+  FamilyPinnedMemoryPoolUsedBytes()
+  {
+    return GetSingleton()->pinned_memory_pool_used_bytes_family_;
+  }
+  static prometheus::Family<prometheus::Gauge>&
+  FamilyPinnedMemoryPoolFreeBytes()
+  {
+    return GetSingleton()->pinned_memory_pool_free_bytes_family_;
+  }
+  static prometheus::Family<prometheus::Gauge>&
+  FamilyPinnedMemoryPoolLargestFreeBytes()
+  {
+    return GetSingleton()->pinned_memory_pool_largest_free_bytes_family_;
+  }
+  static prometheus::Family<prometheus::Gauge>& FamilyCudaMemoryPoolUsedBytes()
+  {
+    return GetSingleton()->cuda_memory_pool_used_bytes_family_;
+  }
+  static prometheus::Family<prometheus::Gauge>& FamilyCudaMemoryPoolFreeBytes()
+  {
+    return GetSingleton()->cuda_memory_pool_free_bytes_family_;
+  }
+
  private:
   Metrics();
   virtual ~Metrics();
@@ -262,6 +398,12 @@ class Metrics {
   bool InitializeDcgmMetrics();
   bool InitializeCpuMetrics();
   bool StartPollingThread();
+  // Start a thread that calls 'poll' every 'interval_ms' until the
+  // pollers are stopped
+  void StartPoller(uint64_t interval_ms, std::function<void()> poll);
+  // Return the polling interval of 'source' given by the
+  // "<source>_metrics_interval_ms" config, or 'metrics_interval_ms_'
+  uint64_t PollingInterval(const std::string& source) const;
   bool PollDcgmMetrics();
   bool PollCpuMetrics();
 
@@ -294,6 +436,24 @@ class Metrics {
   prometheus::Family<prometheus::Counter>& cache_num_misses_model_family_;
   prometheus::Family<prometheus::Counter>& cache_miss_duration_us_model_family_;
 
+  // Per-step ensemble metrics
+  prometheus::Family<prometheus::Counter>&
+      ensemble_step_wait_duration_us_family_;
+  prometheus::Family<prometheus::Counter>&
+      ensemble_step_execution_duration_us_family_;
+  prometheus::Family<prometheus::Counter>&
+      ensemble_step_critical_path_duration_us_family_;
+  prometheus::Family<prometheus::Counter>& pinned_memory_fallback_count_family_;
+  prometheus::Family<prometheus::Counter>& pinned_memory_fallback_bytes_family_;
+  prometheus::Family<prometheus::Counter>&
+      pinned_memory_allocation_count_family_;
+  prometheus::Family<prometheus::Counter>& cuda_memory_allocation_count_family_;
+  prometheus::Family<prometheus::Counter>&
+      cuda_memory_allocation_failure_count_family_;
+  prometheus::Family<prometheus::Counter>& lock_acquisition_count_family_;
+  prometheus::Family<prometheus::Counter>& lock_contention_count_family_;
+  prometheus::Family<prometheus::Counter>& lock_wait_duration_us_family_;
+
   // Summaries
   prometheus::Family<prometheus::Summary>& inf_request_summary_us_family_;
   prometheus::Family<prometheus::Summary>& inf_queue_summary_us_family_;
@@ -304,6 +464,26 @@ class Metrics {
   prometheus::Family<prometheus::Summary>& cache_hit_summary_us_model_family_;
   prometheus::Family<prometheus::Summary>& cache_miss_summary_us_model_family_;
 
+  // Histograms, collected outside of 'registry_'
+  LatencyHistogramFamily inf_request_histogram_us_family_;
+  LatencyHistogramFamily inf_queue_histogram_us_family_;
+  LatencyHistogramFamily inf_compute_input_histogram_us_family_;
+  LatencyHistogramFamily inf_compute_infer_histogram_us_family_;
+  LatencyHistogramFamily inf_compute_output_histogram_us_family_;
+  LatencyHistogramFamily batch_size_histogram_family_;
+  LatencyHistogramFamily batch_queue_depth_histogram_family_;
+  LatencyHistogramFamily batch_fill_percent_histogram_family_;
+
+  // Gauges
+  prometheus::Family<prometheus::Gauge>& batcher_queue_delay_us_family_;
+  prometheus::Family<prometheus::Gauge>& pinned_memory_pool_bytes_family_;
+  prometheus::Family<prometheus::Gauge>& pinned_memory_pool_used_bytes_family_;
+  prometheus::Family<prometheus::Gauge>& pinned_memory_pool_free_bytes_family_;
+  prometheus::Family<prometheus::Gauge>&
+      pinned_memory_pool_largest_free_bytes_family_;
+  prometheus::Family<prometheus::Gauge>& cuda_memory_pool_used_bytes_family_;
+  prometheus::Family<prometheus::Gauge>& cuda_memory_pool_free_bytes_family_;
+
 #ifdef TRITON_ENABLE_METRICS_GPU
   prometheus::Family<prometheus::Gauge>& gpu_utilization_family_;
   prometheus::Family<prometheus::Gauge>& gpu_memory_total_family_;
@@ -340,17 +520,43 @@ class Metrics {
   CpuInfo last_cpu_info_;
 #endif  // TRITON_ENABLE_METRICS_CPU
 
-  // Thread for polling cache/gpu metrics periodically
-  std::unique_ptr<std::thread> poll_thread_;
-  std::atomic<bool> poll_thread_exit_;
+  // One thread per polled metric source (CPU, GPU) so that a slow
+  // source doesn't delay the others. Scrapes only read the values the
+  // pollers last stored.
+  std::vector<std::unique_ptr<std::thread>> poll_threads_;
+  std::mutex poll_mtx_;
+  std::condition_variable poll_cv_;
+  bool poll_thread_exit_;
   bool metrics_enabled_;
   bool gpu_metrics_enabled_;
   bool cpu_metrics_enabled_;
+  bool lock_metrics_enabled_;
   bool poll_thread_started_;
   std::mutex metrics_enabling_;
   std::mutex poll_thread_starting_;
   uint64_t metrics_interval_ms_;
   MetricsConfigMap config_;
+
+  // Guards 'collect_callbacks_' and is held while they run
+  std::mutex collect_callbacks_mtx_;
+  std::map<uint64_t, std::function<void()>> collect_callbacks_;
+  uint64_t next_collect_callback_id_;
+
+  // Update the lock metrics from the lock statistics, called when the
+  // metrics are collected.
+  void CollectLockMetrics();
+
+  // The counters of a named lock and the statistics they last reported,
+  // only accessed by CollectLockMetrics().
+  struct LockMetric {
+    prometheus::Counter* acquisition_count_;
+    prometheus::Counter* contention_count_;
+    prometheus::Counter* wait_duration_us_;
+    uint64_t last_acquisition_count_;
+    uint64_t last_contention_count_;
+    uint64_t last_wait_ns_;
+  };
+  std::map<std::string, LockMetric> lock_metrics_;
 };
 
 }}  // namespace triton::core
@@ -51,6 +51,20 @@ Model::GetInput(
   return Status::Success;
 }
 
+Status
+Model::GetInputPlan(const std::string& name, const InputPlan** plan) const
+{
+  const auto itr = input_plan_map_.find(name);
+  if (itr == input_plan_map_.end()) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "unexpected inference input '" + name + "' for model '" + Name() + "'");
+  }
+
+  *plan = &itr->second;
+  return Status::Success;
+}
+
 Status
 Model::GetOutput(
     const std::string& name, const inference::ModelOutput** output) const
@@ -71,10 +85,39 @@ Model::SetModelConfig(const inference::ModelConfig& config)
 {
   config_ = config;
   set_model_config_ = true;
+  ClearSerialized();
 
   return Status::Success;
 }
 
+bool
+Model::LookUpSerialized(
+    const std::string& key, const uint64_t stamp, std::string* json) const
+{
+  std::lock_guard<std::mutex> lock(serialized_mu_);
+  const auto it = serialized_.find(key);
+  if ((it == serialized_.end()) || (it->second.first != stamp)) {
+    return false;
+  }
+  *json = it->second.second;
+  return true;
+}
+
+void
+Model::CacheSerialized(
+    const std::string& key, const uint64_t stamp, const std::string& json)
+{
+  std::lock_guard<std::mutex> lock(serialized_mu_);
+  serialized_[key] = std::make_pair(stamp, json);
+}
+
+void
+Model::ClearSerialized()
+{
+  std::lock_guard<std::mutex> lock(serialized_mu_);
+  serialized_.clear();
+}
+
 Status
 Model::SetScheduler(std::unique_ptr<Scheduler> scheduler)
 {
@@ -105,6 +148,15 @@ Model::Init(const bool is_config_provided)
     if (!io.optional()) {
       ++required_input_count_;
     }
+
+    InputPlan& plan = input_plan_map_[io.name()];
+    plan.index_ = input_plan_map_.size() - 1;
+    plan.data_type_ = io.data_type();
+    plan.dims_.assign(io.dims().begin(), io.dims().end());
+    plan.is_shape_tensor_ = io.is_shape_tensor();
+    plan.has_reshape_ = io.has_reshape();
+    plan.reshape_.assign(
+        io.reshape().shape().begin(), io.reshape().shape().end());
   }
 
   // Initialize the output map and label provider for each output
@@ -126,11 +178,31 @@ Model::Init(const bool is_config_provided)
     // For ensemble, allow any priority level to pass through
     default_priority_level_ = 0;
     max_priority_level_ = UINT64_MAX;
+  } else if (config_.has_sequence_batching()) {
+    // The sequence batcher orders its backlog by the priority of the
+    // first request of each sequence, so let any level pass through.
+    default_priority_level_ = 0;
+    max_priority_level_ = UINT64_MAX;
   } else {
     default_priority_level_ = 0;
     max_priority_level_ = 0;
   }
 
+  int64_t max_queued_input_bytes = 0;
+  RETURN_IF_ERROR(GetInt64ModelParameter(
+      config_, "TRITON_MAX_QUEUED_INPUT_BYTES", 0 /* default_value */,
+      &max_queued_input_bytes));
+  if (max_queued_input_bytes < 0) {
+    return Status(
+        Status::Code::INVALID_ARG,
+        "TRITON_MAX_QUEUED_INPUT_BYTES must not be negative for model '" +
+            Name() + "'");
+  }
+  if (max_queued_input_bytes > 0) {
+    queued_input_budget_ =
+        std::make_shared<ByteBudget>(max_queued_input_bytes);
+  }
+
   return Status::Success;
 }
 
@@ -25,7 +25,9 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <atomic>
 #include <boost/core/span.hpp>
+#include "byte_budget.h"
 #include "infer_stats.h"
 #include "label_provider.h"
 #include "model_config.pb.h"
@@ -120,7 +122,7 @@ class Model {
       const int64_t version, const inference::ModelConfig& config)
       : config_(config), min_compute_capability_(min_compute_capability),
         version_(version), required_input_count_(0), model_dir_(model_dir),
-        set_model_config_(false)
+        set_model_config_(false), last_use_ns_(0)
   {
   }
   virtual ~Model() {}
@@ -134,6 +136,9 @@ class Model {
   // Get the configuration of model being served.
   const inference::ModelConfig& Config() const { return config_; }
 
+  // Get the path to the model directory in the repository.
+  const std::string& ModelDir() const { return model_dir_; }
+
   // Get the number of required inputs
   size_t RequiredInputCount() const { return required_input_count_; }
 
@@ -193,6 +198,22 @@ class Model {
   Status GetOutput(
       const std::string& name, const inference::ModelOutput** output) const;
 
+  // The properties of an input that are checked when normalizing an
+  // inference request, extracted from the model configuration once so
+  // that requests don't walk the protobuf.
+  struct InputPlan {
+    // The position of the input in the model configuration
+    size_t index_;
+    inference::DataType data_type_;
+    std::vector<int64_t> dims_;
+    bool is_shape_tensor_;
+    bool has_reshape_;
+    std::vector<int64_t> reshape_;
+  };
+
+  // Get the normalization plan for a named input.
+  Status GetInputPlan(const std::string& name, const InputPlan** plan) const;
+
   // Get a label provider for the model.
   const std::shared_ptr<LabelProvider>& GetLabelProvider() const
   {
@@ -211,6 +232,13 @@ class Model {
     return scheduler_->Enqueue(request);
   }
 
+  // Enqueue a batch of requests for execution. The model takes
+  // ownership of all 'requests'. \see Scheduler::EnqueueBatch()
+  void EnqueueBatch(std::vector<std::unique_ptr<InferenceRequest>>& requests)
+  {
+    scheduler_->EnqueueBatch(requests);
+  }
+
   // Return the number of in-flight inferences.
   size_t InflightInferenceCount()
   {
@@ -220,10 +248,39 @@ class Model {
   // Stop processing future requests unless they are considered as in-flight.
   void Stop() { scheduler_->Stop(); }
 
+  // The steady clock time of the last use of the model, recorded by the
+  // on-demand model loader to find the idle models.
+  uint64_t LastUseNs() const
+  {
+    return last_use_ns_.load(std::memory_order_relaxed);
+  }
+  void SetLastUseNs(const uint64_t ns)
+  {
+    last_use_ns_.store(ns, std::memory_order_relaxed);
+  }
+
   uint64_t DefaultPriorityLevel() const { return default_priority_level_; }
 
   uint64_t MaxPriorityLevel() const { return max_priority_level_; }
 
+  // The budget for the input bytes of the requests queued to the model,
+  // set by the "TRITON_MAX_QUEUED_INPUT_BYTES" model parameter. nullptr
+  // if the input bytes are not limited.
+  const std::shared_ptr<ByteBudget>& QueuedInputBudget() const
+  {
+    return queued_input_budget_;
+  }
+
+  // Look up the serialized document cached for the model under 'key'.
+  // Return false if there is none or if it was cached with a 'stamp'
+  // other than the given one. The documents are dropped when the model
+  // config changes, a document that also depends on other state must
+  // be stamped with a version of that state.
+  bool LookUpSerialized(
+      const std::string& key, const uint64_t stamp, std::string* json) const;
+  void CacheSerialized(
+      const std::string& key, const uint64_t stamp, const std::string& json);
+
  protected:
   virtual std::map<TRITONSERVER_MemoryType, std::map<int64_t, size_t>>
   AccumulatedInstanceMemoryUsage() const
@@ -234,6 +291,10 @@ class Model {
   // Set the configuration of the model being served.
   Status SetModelConfig(const inference::ModelConfig& config);
 
+  // Drop the serialized documents cached for the model. Must be called
+  // whenever 'config_' is changed.
+  void ClearSerialized();
+
   // Explicitly set the scheduler to use for inference requests to the
   // model. The scheduler can only be set once for a model.
   Status SetScheduler(std::unique_ptr<Scheduler> scheduler);
@@ -266,6 +327,9 @@ class Model {
   // Map from input name to the model configuration for that input.
   std::unordered_map<std::string, inference::ModelInput> input_map_;
 
+  // Map from input name to the normalization plan for that input.
+  std::unordered_map<std::string, InputPlan> input_plan_map_;
+
   // Map from output name to the model configuration for that output.
   std::unordered_map<std::string, inference::ModelOutput> output_map_;
 
@@ -280,6 +344,17 @@ class Model {
 
   // Whether or not model config has been set.
   bool set_model_config_;
+
+  std::atomic<uint64_t> last_use_ns_;
+
+  // Shared with the queued requests, which may be released after the
+  // model.
+  std::shared_ptr<ByteBudget> queued_input_budget_;
+
+  // The serialized documents cached for the model, with their stamps.
+  std::unordered_map<std::string, std::pair<uint64_t, std::string>>
+      serialized_;
+  mutable std::mutex serialized_mu_;
 };
 
 }}  // namespace triton::core
@@ -0,0 +1,160 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "model_config_cache.h"
+
+#include <google/protobuf/text_format.h>
+
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include "filesystem/api.h"
+#include "stream_hash.h"
+#include "triton/common/logging.h"
+
+namespace triton { namespace core {
+
+namespace {
+
+// An entry is the key followed by the binary config
+constexpr size_t kKeyByteSize = sizeof(uint64_t);
+
+}  // namespace
+
+Status
+ModelConfigCache::Create(
+    const std::string& dir, const std::string& server_version,
+    const double min_compute_capability, const bool autofill,
+    std::unique_ptr<ModelConfigCache>* cache)
+{
+  bool exists = false;
+  RETURN_IF_ERROR(FileExists(dir, &exists));
+  if (!exists) {
+    RETURN_IF_ERROR(MakeDirectory(dir, true /* recursive */));
+  }
+  cache->reset(new ModelConfigCache(
+      dir, server_version, min_compute_capability, autofill));
+  return Status::Success;
+}
+
+std::string
+ModelConfigCache::EntryPath(const std::string& name) const
+{
+  // Model names may contain characters that are not valid in a path
+  StreamHash64 hash;
+  hash.Update(name);
+  std::stringstream file_name;
+  file_name << std::hex << std::setw(16) << std::setfill('0')
+            << hash.Digest() << ".pb";
+  return JoinPath({dir_, file_name.str()});
+}
+
+Status
+ModelConfigCache::Read(
+    const std::string& name, const std::string& config_path,
+    const std::string& model_path, inference::ModelConfig* config,
+    bool* cached, uint64_t* key)
+{
+  *cached = false;
+  std::string source;
+  RETURN_IF_ERROR(ReadTextFile(config_path, &source));
+
+  // Auto-fill looks at the files of the model directory, so their names
+  // and modification times are part of the key along with the source.
+  std::map<std::string, int64_t> mtimes;
+  RETURN_IF_ERROR(ListModificationTimes(model_path, &mtimes));
+  StreamHash64 hash;
+  hash.Update(name);
+  hash.Update(model_path);
+  hash.Update(source);
+  for (const auto& mtime : mtimes) {
+    hash.Update(mtime.first);
+    hash.Update(mtime.second);
+  }
+  hash.Update(server_version_);
+  hash.Update(&min_compute_capability_, sizeof(min_compute_capability_));
+  hash.Update(static_cast<uint64_t>(autofill_));
+  *key = hash.Digest();
+
+  const std::string entry_path = EntryPath(name);
+  bool entry_exists = false;
+  std::string entry;
+  if (FileExists(entry_path, &entry_exists).IsOk() && entry_exists &&
+      ReadTextFile(entry_path, &entry).IsOk() &&
+      (entry.size() >= kKeyByteSize)) {
+    uint64_t entry_key = 0;
+    std::memcpy(&entry_key, entry.data(), kKeyByteSize);
+    if ((entry_key == *key) &&
+        config->ParseFromArray(
+            entry.data() + kKeyByteSize, entry.size() - kKeyByteSize)) {
+      LOG_VERBOSE(1) << "Using cached normalized config for model '" << name
+                     << "'";
+      *cached = true;
+      return Status::Success;
+    }
+  }
+
+  config->Clear();
+  if (!google::protobuf::TextFormat::ParseFromString(source, config)) {
+    return Status(
+        Status::Code::INTERNAL,
+        "failed to read text proto from " + config_path);
+  }
+  return Status::Success;
+}
+
+void
+ModelConfigCache::Insert(
+    const std::string& name, const uint64_t key,
+    const inference::ModelConfig& config)
+{
+  std::string entry(kKeyByteSize, '\0');
+  std::memcpy(&entry[0], &key, kKeyByteSize);
+  if (!config.AppendToString(&entry)) {
+    LOG_WARNING << "failed to serialize the config of model '" << name
+                << "' for the config cache";
+    return;
+  }
+
+  // Written to a temporary file first, so that a concurrent or
+  // interrupted write never leaves a truncated entry.
+  const std::string entry_path = EntryPath(name);
+  const std::string temp_path = entry_path + ".tmp";
+  Status status = WriteBinaryFile(temp_path, entry.data(), entry.size());
+  if (status.IsOk() &&
+      (std::rename(temp_path.c_str(), entry_path.c_str()) != 0)) {
+    status = Status(
+        Status::Code::INTERNAL, "failed to rename '" + temp_path + "'");
+  }
+  if (!status.IsOk()) {
+    LOG_WARNING << "failed to store the config of model '" << name
+                << "' in the config cache: " << status.Message();
+  }
+}
+
+}}  // namespace triton::core
@@ -0,0 +1,90 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <memory>
+#include <string>
+#include "model_config.pb.h"
+#include "status.h"
+
+namespace triton { namespace core {
+
+//
+// Persistent store of the normalized and validated model configs, so
+// that a restarted server doesn't parse, auto-fill and validate the
+// configs that haven't changed. Each entry is keyed by a hash of the
+// source config, the files of the model directory, the server version
+// and the settings that affect normalization. A changed input is a
+// miss, and the entry is replaced once the config is normalized again.
+//
+class ModelConfigCache {
+ public:
+  // Create a cache storing its entries in the local directory 'dir',
+  // which is created if missing. 'min_compute_capability' and
+  // 'autofill' are the settings the configs are normalized and
+  // validated with.
+  static Status Create(
+      const std::string& dir, const std::string& server_version,
+      const double min_compute_capability, const bool autofill,
+      std::unique_ptr<ModelConfigCache>* cache);
+
+  // Read the config of the model named 'name' from 'config_path' in the
+  // model directory 'model_path'. If an entry for the same inputs
+  // exists, set 'config' to the stored normalized config and 'cached'
+  // to true. Otherwise set 'config' to the parsed source config,
+  // 'cached' to false and 'key' to the key to Insert() the config with
+  // once it is normalized and validated.
+  Status Read(
+      const std::string& name, const std::string& config_path,
+      const std::string& model_path, inference::ModelConfig* config,
+      bool* cached, uint64_t* key);
+
+  // Store 'config' as the normalized and validated config of the model
+  // 'name' for 'key'. Failures are only logged, as the model doesn't
+  // depend on the entry.
+  void Insert(
+      const std::string& name, const uint64_t key,
+      const inference::ModelConfig& config);
+
+ private:
+  ModelConfigCache(
+      const std::string& dir, const std::string& server_version,
+      const double min_compute_capability, const bool autofill)
+      : dir_(dir), server_version_(server_version),
+        min_compute_capability_(min_compute_capability), autofill_(autofill)
+  {
+  }
+
+  // The path of the entry of the model 'name'
+  std::string EntryPath(const std::string& name) const;
+
+  const std::string dir_;
+  const std::string server_version_;
+  const double min_compute_capability_;
+  const bool autofill_;
+};
+
+}}  // namespace triton::core
@@ -28,6 +28,7 @@
 
 #include <google/protobuf/util/json_util.h>
 #include <google/protobuf/util/message_differencer.h>
+#include <algorithm>
 #include <deque>
 #include <mutex>
 #include <set>
@@ -1512,16 +1513,6 @@ ValidateModelConfig(
   }
 #endif  // TRITON_ENABLE_ENSEMBLE
 
-  // FIXME: DLIS-3916 - Response Cache does not yet support decoupled models
-  if (config.model_transaction_policy().decoupled() &&
-      config.response_cache().enable()) {
-    return Status(
-        Status::Code::INVALID_ARG,
-        "Response Cache does not currently support model " + config.name() +
-            " with 'decoupled' transaction policy. Please disable the response"
-            " cache.");
-  }
-
   return Status::Success;
 }
 
@@ -1639,6 +1630,46 @@ ValidateInstanceGroup(
       }
     }
   }
+
+#ifdef TRITON_ENABLE_GPU
+  // A GPU instance spanning several GPUs also uses the GPUs following
+  // its device, they must exist and not be used by the span of another
+  // device.
+  int64_t gpu_span = 1;
+  RETURN_IF_ERROR(GetInt64ModelParameter(
+      config, "TRITON_INSTANCE_GPU_SPAN", 1 /* default_value */, &gpu_span));
+  if (gpu_span > 1) {
+    std::set<int> span_starts;
+    for (const auto& group : config.instance_group()) {
+      if (group.kind() == inference::ModelInstanceGroup::KIND_GPU) {
+        span_starts.insert(group.gpus().begin(), group.gpus().end());
+      }
+    }
+    int previous_start = -1;
+    for (const int start : span_starts) {
+      for (int64_t offset = 1; offset < gpu_span; ++offset) {
+        if (supported_gpus.find(start + offset) == supported_gpus.end()) {
+          return Status(
+              Status::Code::INVALID_ARG,
+              "model " + config.name() + " places an instance on gpu " +
+                  std::to_string(start) + " that spans " +
+                  std::to_string(gpu_span) + " GPUs but gpu " +
+                  std::to_string(start + offset) +
+                  " is invalid or unsupported");
+        }
+      }
+      if ((previous_start >= 0) && ((start - previous_start) < gpu_span)) {
+        return Status(
+            Status::Code::INVALID_ARG,
+            "model " + config.name() + " places instances on gpus " +
+                std::to_string(previous_start) + " and " +
+                std::to_string(start) + " whose spans of " +
+                std::to_string(gpu_span) + " GPUs overlap");
+      }
+      previous_start = start;
+    }
+  }
+#endif  // TRITON_ENABLE_GPU
   return Status::Success;
 }
 
@@ -1759,6 +1790,124 @@ ParseLongLongParameter(
   return Status::Success;
 }
 
+Status
+GetBoolModelParameter(
+    const inference::ModelConfig& config, const std::string& key,
+    const bool default_value, bool* value)
+{
+  const auto itr = config.parameters().find(key);
+  if (itr == config.parameters().end()) {
+    *value = default_value;
+    return Status::Success;
+  }
+
+  return ParseBoolParameter(key, itr->second.string_value(), value);
+}
+
+Status
+GetInt64ModelParameter(
+    const inference::ModelConfig& config, const std::string& key,
+    const int64_t default_value, int64_t* value)
+{
+  const auto itr = config.parameters().find(key);
+  if (itr == config.parameters().end()) {
+    *value = default_value;
+    return Status::Success;
+  }
+
+  return ParseLongLongParameter(key, itr->second.string_value(), value);
+}
+
+Status
+GetStringModelParameter(
+    const inference::ModelConfig& config, const std::string& key,
+    const std::string& default_value, std::string* value)
+{
+  const auto itr = config.parameters().find(key);
+  if (itr == config.parameters().end()) {
+    *value = default_value;
+  } else {
+    *value = itr->second.string_value();
+  }
+  return Status::Success;
+}
+
+void
+GetExpectedDeviceByteSize(
+    const std::string& model_path, const int64_t version,
+    const inference::ModelConfig& config, const double min_compute_capability,
+    const bool include_host, std::map<int, uint64_t>* device_bytes)
+{
+  device_bytes->clear();
+
+  // The number of instances on each device. A GPU group without devices
+  // spans all of them if the configuration is not normalized yet.
+  std::map<int, uint64_t> instance_cnts;
+  for (const auto& group : config.instance_group()) {
+    if ((group.kind() != inference::ModelInstanceGroup::KIND_GPU) &&
+        (group.kind() != inference::ModelInstanceGroup::KIND_AUTO)) {
+      if (include_host) {
+        instance_cnts[-1] += std::max(1, group.count());
+      }
+      continue;
+    }
+    std::set<int> gpus(group.gpus().begin(), group.gpus().end());
+#ifdef TRITON_ENABLE_GPU
+    if (gpus.empty() &&
+        (group.kind() == inference::ModelInstanceGroup::KIND_GPU)) {
+      GetSupportedGPUs(&gpus, min_compute_capability);
+    }
+#endif  // TRITON_ENABLE_GPU
+    for (const int gpu : gpus) {
+      instance_cnts[gpu] += std::max(1, group.count());
+    }
+  }
+  if (instance_cnts.empty()) {
+    return;
+  }
+
+  int64_t instance_mb = -1;
+  Status status = GetInt64ModelParameter(
+      config, "TRITON_LOAD_GPU_MEMORY_MB", -1 /* default_value */,
+      &instance_mb);
+  uint64_t instance_bytes = 0;
+  if (status.IsOk() && (instance_mb >= 0)) {
+    instance_bytes = static_cast<uint64_t>(instance_mb) * 1024 * 1024;
+  } else {
+    // Sizing a cloud model would take a request per file
+    FileSystemType type;
+    if (GetFileSystemType(model_path, &type).IsOk() &&
+        (type == FileSystemType::LOCAL)) {
+      std::deque<std::string> dirs{
+          JoinPath({model_path, std::to_string(version)})};
+      while (!dirs.empty()) {
+        std::set<std::string> contents;
+        if (!GetDirectoryContents(dirs.front(), &contents).IsOk()) {
+          contents.clear();
+        }
+        for (const auto& child : contents) {
+          const auto full_path = JoinPath({dirs.front(), child});
+          bool is_dir = false;
+          uint64_t byte_size = 0;
+          if (IsDirectory(full_path, &is_dir).IsOk() && is_dir) {
+            dirs.emplace_back(full_path);
+          } else if (FileSize(full_path, &byte_size).IsOk()) {
+            instance_bytes += byte_size;
+          }
+        }
+        dirs.pop_front();
+      }
+    }
+  }
+  if (instance_bytes == 0) {
+    return;
+  }
+
+  for (const auto& instance_cnt : instance_cnts) {
+    (*device_bytes)[instance_cnt.first] = instance_cnt.second * instance_bytes;
+  }
+}
+
 Status
 GetProfileIndex(const std::string& profile_name, int* profile_index)
 {
@@ -25,6 +25,8 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <map>
+
 #include "filesystem/api.h"
 #include "model_config.pb.h"
 #include "status.h"
@@ -226,6 +228,58 @@ Status ParseBoolParameter(
 Status ParseLongLongParameter(
     const std::string& key, const std::string& value, int64_t* parsed_value);
 
+/// Get the boolean value of the model configuration parameter 'key'.
+/// \param config The model configuration.
+/// \param key The name of the parameter.
+/// \param default_value The value to return if the parameter is not set.
+/// \param value Returns the value of the parameter.
+/// \return The error status. A non-OK status indicates the parameter is
+/// set but its value can not be parsed.
+Status GetBoolModelParameter(
+    const inference::ModelConfig& config, const std::string& key,
+    const bool default_value, bool* value);
+
+/// Get the integral value of the model configuration parameter 'key'.
+/// \param config The model configuration.
+/// \param key The name of the parameter.
+/// \param default_value The value to return if the parameter is not set.
+/// \param value Returns the value of the parameter.
+/// \return The error status. A non-OK status indicates the parameter is
+/// set but its value can not be parsed.
+Status GetInt64ModelParameter(
+    const inference::ModelConfig& config, const std::string& key,
+    const int64_t default_value, int64_t* value);
+
+/// Get the string value of the model configuration parameter 'key'.
+/// \param config The model configuration.
+/// \param key The name of the parameter.
+/// \param default_value The value to return if the parameter is not set.
+/// \param value Returns the value of the parameter.
+/// \return The error status.
+Status GetStringModelParameter(
+    const inference::ModelConfig& config, const std::string& key,
+    const std::string& default_value, std::string* value);
+
+/// Get the expected memory usage of the instances of 'version' of a
+/// model, by device id. An instance is expected to use the
+/// TRITON_LOAD_GPU_MEMORY_MB model configuration parameter or else the
+/// size of the version directory of a local model. The instances of a
+/// KIND_GPU or KIND_AUTO group count on each of the group's GPUs, on all
+/// the supported GPUs for a KIND_GPU group without GPUs. The other
+/// instances count on device -1 if 'include_host' is true.
+/// \param model_path The path to the model directory.
+/// \param version The version of the model.
+/// \param config The model configuration, normalized or not.
+/// \param min_compute_capability The minimum supported CUDA compute
+/// capability.
+/// \param include_host Whether to count the instances not on a GPU.
+/// \param device_bytes Returns the expected usage by device id, empty
+/// if it is unknown.
+void GetExpectedDeviceByteSize(
+    const std::string& model_path, const int64_t version,
+    const inference::ModelConfig& config, const double min_compute_capability,
+    const bool include_host, std::map<int, uint64_t>* device_bytes);
+
 /// Obtain the 'profile_index' of the 'profile_name'.
 /// \param profile_name The name of the profile.
 /// \param profile_index Return the index of the profile.
@@ -27,18 +27,27 @@
 
 #include "model_lifecycle.h"
 
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+
 #include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <deque>
 #include <future>
 #include <stdexcept>
 #include <thread>
+#include "backend_config.h"
 #include "constants.h"
+#include "cuda_utils.h"
 #include "filesystem/api.h"
 #include "model.h"
 #include "model_config_utils.h"
 #include "repo_agent.h"
+#include "stream_hash.h"
 #include "triton/common/logging.h"
 #include "triton/common/thread_pool.h"
+#include "triton/common/triton_json.h"
 
 #include "backend_model.h"
 #ifdef TRITON_ENABLE_ENSEMBLE
@@ -48,6 +57,18 @@
 
 namespace triton { namespace core {
 
+namespace {
+
+uint64_t
+SteadyNowNs()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
 const std::string&
 ModelReadyStateString(ModelReadyState state)
 {
@@ -259,6 +280,76 @@ ModelLifeCycle::InflightStatus()
   return inflight_status;
 }
 
+const std::set<std::tuple<ModelIdentifier, int64_t, size_t>>
+ModelLifeCycle::UnloadDrainedModels()
+{
+  LOG_VERBOSE(2) << "UnloadDrainedModels()";
+  std::lock_guard<std::mutex> map_lock(map_mtx_);
+  std::set<std::tuple<ModelIdentifier, int64_t, size_t>> inflight_status;
+  std::vector<std::tuple<const ModelIdentifier*, int64_t, ModelInfo*>>
+      drained;
+  bool ensemble_inflight = false;
+  for (auto& model_version : map_) {
+    for (auto& version_model : model_version.second) {
+      ModelInfo* model_info = version_model.second.get();
+      if (model_info == nullptr) {
+        continue;
+      }
+      std::lock_guard<std::mutex> lock(model_info->mtx_);
+      if ((model_info->state_ != ModelReadyState::READY) ||
+          (model_info->model_ == nullptr)) {
+        continue;
+      }
+      const auto cnt = model_info->model_->InflightInferenceCount();
+      if (cnt != 0) {
+        inflight_status.emplace(model_version.first, version_model.first, cnt);
+        ensemble_inflight |= model_info->is_ensemble_;
+      } else {
+        drained.emplace_back(
+            &model_version.first, version_model.first, model_info);
+      }
+    }
+  }
+
+  const uint64_t now_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count();
+  for (const auto& version_info : drained) {
+    ModelInfo* model_info = std::get<2>(version_info);
+    std::lock_guard<std::mutex> lock(model_info->mtx_);
+    if ((ensemble_inflight && !model_info->is_ensemble_) ||
+        (model_info->state_ != ModelReadyState::READY)) {
+      continue;
+    }
+
+    // Same as AsyncUnload() for a single version, except that the
+    // repository agents are notified on the load pool so that one slow
+    // agent doesn't hold up the unload of the other models.
+    LOG_INFO << "Model '" << *std::get<0>(version_info) << "' (version "
+             << std::get<1>(version_info) << ") has no in-flight inferences, "
+             << "unloading";
+    model_info->last_update_ns_ = now_ns;
+    std::shared_ptr<TritonRepoAgentModelList> agent_model_list =
+        model_info->agent_model_list_;
+    model_info->Release();
+    if (agent_model_list != nullptr) {
+      RunOnLoadPool([agent_model_list]() {
+        // Only log the error because the model is unloaded regardless
+        auto status =
+            agent_model_list->InvokeAgentModels(TRITONREPOAGENT_ACTION_UNLOAD);
+        if (!status.IsOk()) {
+          LOG_ERROR
+              << "Agent model returns error on TRITONREPOAGENT_ACTION_UNLOAD: "
+              << status.AsString();
+        }
+      });
+    }
+  }
+
+  return inflight_status;
+}
+
 const ModelStateMap
 ModelLifeCycle::ModelStates()
 {
@@ -363,6 +454,19 @@ ModelLifeCycle::GetModel(
           Status::Code::NOT_FOUND,
           "'" + model_id.str() + "' has no available versions");
     }
+
+    // A newer version is taking over from the old one
+    auto sit = swaps_.find(model_id);
+    if ((sit != swaps_.end()) && (latest > sit->second.old_version_) &&
+        RouteToOldVersion(&sit->second, SteadyNowNs())) {
+      auto oit = mit->second.find(sit->second.old_version_);
+      if (oit != mit->second.end()) {
+        std::lock_guard<std::mutex> lock(oit->second->mtx_);
+        if (oit->second->state_ == ModelReadyState::READY) {
+          *model = oit->second->model_;
+        }
+      }
+    }
   } else {
     std::lock_guard<std::mutex> lock(vit->second->mtx_);
     if (vit->second->state_ == ModelReadyState::READY) {
@@ -454,6 +558,8 @@ ModelLifeCycle::AsyncLoad(
           .count();
   std::shared_ptr<LoadTracker> load_tracker(
       new LoadTracker(versions.size(), now_ns));
+  int64_t priority = 0;
+  LoadDemand(model_path, -1, model_config, &priority, nullptr);
   for (const auto& version : versions) {
     std::unique_ptr<ModelInfo> linfo(
         new ModelInfo(model_path, model_config, now_ns));
@@ -488,13 +594,14 @@ ModelLifeCycle::AsyncLoad(
           // Update the model
           model_info = serving_model.get();
           model_info->last_update_ns_ = now_ns;
-          load_pool_->Enqueue([this, model_id, version, model_info,
-                               model_config, OnComplete, load_tracker]() {
-            UpdateModelConfig(model_id, version, model_info, model_config);
-            OnLoadComplete(
-                model_id, version, model_info, true /* is_update */, OnComplete,
-                load_tracker);
-          });
+          EnqueueLoad(PendingLoad{
+              priority, {}, [this, model_id, version, model_info,
+                             model_config, OnComplete, load_tracker]() {
+                UpdateModelConfig(model_id, version, model_info, model_config);
+                OnLoadComplete(
+                    model_id, version, model_info, true /* is_update */,
+                    OnComplete, load_tracker);
+              }});
           continue;  // move to the next version
         }
         // A full model load is required.
@@ -516,15 +623,145 @@ ModelLifeCycle::AsyncLoad(
     }
 
     // Load model asynchronously via thread pool
-    load_pool_->Enqueue([this, model_id, version, model_info, OnComplete,
-                         load_tracker, is_config_provided]() {
-      CreateModel(model_id, version, model_info, is_config_provided);
-      OnLoadComplete(
-          model_id, version, model_info, false /* is_update */, OnComplete,
-          load_tracker);
-    });
+    std::map<int, uint64_t> device_bytes;
+    LoadDemand(model_path, version, model_config, nullptr, &device_bytes);
+    EnqueueLoad(PendingLoad{
+        priority, std::move(device_bytes),
+        [this, model_id, version, model_info, OnComplete, load_tracker,
+         is_config_provided]() {
+          CreateModel(model_id, version, model_info, is_config_provided);
+          OnLoadComplete(
+              model_id, version, model_info, false /* is_update */, OnComplete,
+              load_tracker);
+        }});
+  }
+
+  return Status::Success;
+}
+
+Status
+ModelLifeCycle::ReadCheckpoint(
+    const std::string& path, std::set<std::string>* model_names)
+{
+  model_names->clear();
+  checkpoint_enabled_ = true;
+
+  bool exists = false;
+  RETURN_IF_ERROR(FileExists(path, &exists));
+  if (!exists) {
+    return Status::Success;
+  }
+  std::string contents;
+  RETURN_IF_ERROR(ReadTextFile(path, &contents));
+
+  triton::common::TritonJson::Value checkpoint;
+  RETURN_IF_ERROR(checkpoint.Parse(contents));
+  triton::common::TritonJson::Value versions;
+  RETURN_IF_ERROR(checkpoint.MemberAsArray("versions", &versions));
+
+  std::lock_guard<std::mutex> lock(checkpoint_mtx_);
+  checkpoint_contents_ = contents;
+  for (size_t i = 0; i < versions.ArraySize(); ++i) {
+    triton::common::TritonJson::Value entry;
+    RETURN_IF_ERROR(versions.IndexAsObject(i, &entry));
+    std::string model_namespace, name;
+    int64_t version = 0;
+    uint64_t fingerprint = 0;
+    RETURN_IF_ERROR(entry.MemberAsString("namespace", &model_namespace));
+    RETURN_IF_ERROR(entry.MemberAsString("name", &name));
+    RETURN_IF_ERROR(entry.MemberAsInt("version", &version));
+    RETURN_IF_ERROR(entry.MemberAsUInt("fingerprint", &fingerprint));
+    restored_versions_[std::make_pair(
+        ModelIdentifier(model_namespace, name), version)] = fingerprint;
+    model_names->emplace(name);
+  }
+
+  LOG_INFO << "Read checkpoint '" << path << "' of " << versions.ArraySize()
+           << " model versions";
+  return Status::Success;
+}
+
+Status
+ModelLifeCycle::WriteCheckpoint(const std::string& path)
+{
+  triton::common::TritonJson::Value checkpoint(
+      triton::common::TritonJson::ValueType::OBJECT);
+  triton::common::TritonJson::Value versions(
+      checkpoint, triton::common::TritonJson::ValueType::ARRAY);
+  {
+    std::lock_guard<std::mutex> map_lock(map_mtx_);
+    for (auto& model_version : map_) {
+      for (auto& version_model : model_version.second) {
+        std::lock_guard<std::mutex> lock(version_model.second->mtx_);
+        if ((version_model.second->state_ != ModelReadyState::READY) ||
+            (version_model.second->fingerprint_ == 0)) {
+          continue;
+        }
+        triton::common::TritonJson::Value entry(
+            checkpoint, triton::common::TritonJson::ValueType::OBJECT);
+        RETURN_IF_ERROR(entry.AddString(
+            "namespace", model_version.first.namespace_));
+        RETURN_IF_ERROR(entry.AddString("name", model_version.first.name_));
+        RETURN_IF_ERROR(entry.AddInt("version", version_model.first));
+        RETURN_IF_ERROR(entry.AddUInt(
+            "fingerprint", version_model.second->fingerprint_));
+        RETURN_IF_ERROR(versions.Append(std::move(entry)));
+      }
+    }
+  }
+  RETURN_IF_ERROR(checkpoint.Add("versions", std::move(versions)));
+
+  triton::common::TritonJson::WriteBuffer buffer;
+  RETURN_IF_ERROR(checkpoint.Write(&buffer));
+
+  std::lock_guard<std::mutex> lock(checkpoint_mtx_);
+  if (buffer.Contents() == checkpoint_contents_) {
+    return Status::Success;
+  }
+
+  // Replace the checkpoint at once, a restart may happen at any time
+  const std::string temp_path = path + ".tmp";
+  RETURN_IF_ERROR(WriteTextFile(temp_path, buffer.Contents()));
+  if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+    return Status(
+        Status::Code::INTERNAL, "failed to rename '" + temp_path + "'");
   }
+  checkpoint_contents_ = buffer.Contents();
+  return Status::Success;
+}
 
+Status
+ModelLifeCycle::Fingerprint(
+    const ModelIdentifier& model_id, const int64_t version,
+    const ModelInfo& model_info, uint64_t* fingerprint)
+{
+  // Map fields are serialized in an unspecified order otherwise
+  std::string config;
+  {
+    google::protobuf::io::StringOutputStream output(&config);
+    google::protobuf::io::CodedOutputStream coded(&output);
+    coded.SetSerializationDeterministic(true);
+    if (!model_info.model_config_.SerializeToCodedStream(&coded)) {
+      return Status(
+          Status::Code::INTERNAL,
+          "failed to serialize the config of '" + model_id.str() + "'");
+    }
+  }
+  std::map<std::string, int64_t> mtimes;
+  RETURN_IF_ERROR(ListModificationTimes(model_info.model_path_, &mtimes));
+
+  StreamHash64 hash;
+  hash.Update(model_id.str());
+  hash.Update(&version, sizeof(version));
+  hash.Update(model_info.model_path_);
+  hash.Update(config);
+  for (const auto& mtime : mtimes) {
+    hash.Update(mtime.first);
+    hash.Update(mtime.second);
+  }
+  hash.Update(server_->Version());
+  // 0 marks a version without fingerprint
+  *fingerprint = std::max<uint64_t>(1, hash.Digest());
   return Status::Success;
 }
 
@@ -536,6 +773,27 @@ ModelLifeCycle::CreateModel(
   LOG_VERBOSE(2) << "CreateModel() '" << model_id << "' version " << version;
   const auto& model_config = model_info->model_config_;
 
+  // A version recorded by the checkpoint is only warmed up again if it
+  // changed since. That is checked once, a later reload warms it up.
+  uint64_t fingerprint = 0;
+  bool skip_warmup = false;
+  if (checkpoint_enabled_) {
+    Status fingerprint_status =
+        Fingerprint(model_id, version, *model_info, &fingerprint);
+    if (!fingerprint_status.IsOk()) {
+      LOG_WARNING << "failed to fingerprint '" << model_id << "' version "
+                  << version << ", it is not checkpointed: "
+                  << fingerprint_status.Message();
+      fingerprint = 0;
+    }
+    std::lock_guard<std::mutex> lock(checkpoint_mtx_);
+    auto it = restored_versions_.find(std::make_pair(model_id, version));
+    if (it != restored_versions_.end()) {
+      skip_warmup = (fingerprint != 0) && (it->second == fingerprint);
+      restored_versions_.erase(it);
+    }
+  }
+
   // Create model
   Status status;
   std::unique_ptr<Model> is;
@@ -546,7 +804,7 @@ ModelLifeCycle::CreateModel(
     std::unique_ptr<TritonModel> model;
     status = TritonModel::Create(
         server_, model_info->model_path_, cmdline_config_map_, host_policy_map_,
-        version, model_config, is_config_provided, &model);
+        version, model_config, is_config_provided, skip_warmup, &model);
     is.reset(model.release());
   } else {
 #ifdef TRITON_ENABLE_ENSEMBLE
@@ -600,6 +858,7 @@ ModelLifeCycle::CreateModel(
     // is destroyed, and we want agent model to be valid for receiving
     // UNLOAD_COMPLETE signal (see ~TritonRepoAgentModelList for detail)
     auto agent_model_list = model_info->agent_model_list_;
+    model_info->fingerprint_ = fingerprint;
     model_info->model_.reset(
         is.release(), ModelDeleter([this, model_id, version, model_info,
                                     agent_model_list]() mutable {
@@ -752,8 +1011,41 @@ ModelLifeCycle::OnLoadFinal(
     }
     LOG_INFO << "failed to load '" << model_id << "'";
   } else {
+    // Check if the latest version that is replaced should keep serving
+    // while the traffic shifts to the new latest version
+    int64_t ramp_ms = 0;
+    Status status = GetInt64ModelParameter(
+        model_info->model_config_, "TRITON_VERSION_SWAP_RAMP_MS",
+        0 /* default_value */, &ramp_ms);
+    if (!status.IsOk()) {
+      LOG_ERROR << "failed to get the version swap ramp of '" << model_id
+                << "': " << status.AsString();
+      ramp_ms = 0;
+    }
+    int64_t old_latest = -1;
+    uint64_t old_update_ns = 0;
+    int64_t new_latest = -1;
+    for (const auto& loaded : load_tracker->load_set_) {
+      new_latest = std::max(new_latest, loaded.first);
+    }
+    for (auto& version_info : it->second) {
+      auto& mi = version_info.second;
+      std::lock_guard<std::mutex> info_lk(mi->mtx_);
+      if (mi->last_update_ns_ >= load_tracker->last_update_ns_) {
+        new_latest = std::max(new_latest, version_info.first);
+      } else if (mi->state_ == ModelReadyState::READY) {
+        old_latest = version_info.first;
+        old_update_ns = mi->last_update_ns_;
+      }
+    }
+    const bool swap =
+        (ramp_ms > 0) && (old_latest != -1) && (old_latest < new_latest);
+
     // Unload any previous loaded versions that are still available
     for (auto& version_info : it->second) {
+      if (swap && (version_info.first == old_latest)) {
+        continue;
+      }
       auto& mi = version_info.second;
       std::lock_guard<std::mutex> info_lk(mi->mtx_);
       if (mi->state_ == ModelReadyState::READY &&
@@ -803,6 +1095,21 @@ ModelLifeCycle::OnLoadFinal(
         }
       }
     }
+    if (swap) {
+      LOG_INFO << "shifting traffic of '" << model_id << "' from version "
+               << old_latest << " to version " << new_latest << " over "
+               << ramp_ms << " ms";
+      swaps_[model_id] = VersionSwap{
+          old_latest, old_update_ns, SteadyNowNs(),
+          static_cast<uint64_t>(ramp_ms) * 1000 * 1000, 0};
+      if (!swap_thread_.joinable()) {
+        swap_thread_ = std::thread([this]() { SwapThread(); });
+      }
+      swap_cv_.notify_all();
+    } else {
+      // The version of an ongoing swap has been unloaded above
+      swaps_.erase(model_id);
+    }
     if (model_info->agent_model_list_) {
       auto status = model_info->agent_model_list_->InvokeAgentModels(
           TRITONREPOAGENT_ACTION_LOAD_COMPLETE);
@@ -823,4 +1130,183 @@ ModelLifeCycle::OnLoadFinal(
   }
 }
 
+bool
+ModelLifeCycle::RouteToOldVersion(VersionSwap* swap, const uint64_t now_ns)
+{
+  const uint64_t elapsed_ns = now_ns - swap->start_ns_;
+  if (elapsed_ns >= swap->ramp_ns_) {
+    return false;
+  }
+
+  // The share of the new version grows linearly over the ramp. Request 'i'
+  // goes to the new version if it moves floor(i * share) up, which spreads
+  // the requests of both versions evenly.
+  const double share = static_cast<double>(elapsed_ns) / swap->ramp_ns_;
+  const uint64_t i = swap->request_cnt_++;
+  return std::floor((i + 1) * share) == std::floor(i * share);
+}
+
+void
+ModelLifeCycle::SwapThread()
+{
+  std::unique_lock<std::mutex> lk(map_mtx_);
+  while (!swap_exit_) {
+    const uint64_t now_ns = SteadyNowNs();
+    uint64_t wait_ns = 0;
+    for (auto sit = swaps_.begin(); sit != swaps_.end();) {
+      const auto& swap = sit->second;
+      const uint64_t end_ns = swap.start_ns_ + swap.ramp_ns_;
+      if (end_ns > now_ns) {
+        wait_ns = (wait_ns == 0) ? (end_ns - now_ns)
+                                 : std::min(wait_ns, end_ns - now_ns);
+        ++sit;
+        continue;
+      }
+
+      // Unload the old version unless it has changed during the ramp, the
+      // in-flight requests keep the model alive until they complete.
+      auto mit = map_.find(sit->first);
+      if (mit != map_.end()) {
+        auto vit = mit->second.find(swap.old_version_);
+        if (vit != mit->second.end()) {
+          auto& mi = vit->second;
+          std::lock_guard<std::mutex> info_lk(mi->mtx_);
+          if ((mi->state_ == ModelReadyState::READY) &&
+              (mi->last_update_ns_ == swap.old_update_ns_)) {
+            if (mi->agent_model_list_ != nullptr) {
+              auto status = mi->agent_model_list_->InvokeAgentModels(
+                  TRITONREPOAGENT_ACTION_UNLOAD);
+              if (!status.IsOk()) {
+                LOG_ERROR << "Agent model returns error on "
+                             "TRITONREPOAGENT_ACTION_UNLOAD: "
+                          << status.AsString();
+              }
+            }
+            LOG_INFO << "traffic of '" << sit->first
+                     << "' shifted, unloading version " << swap.old_version_;
+            mi->Release();
+          }
+        }
+      }
+      sit = swaps_.erase(sit);
+    }
+
+    if (wait_ns == 0) {
+      swap_cv_.wait(lk);
+    } else {
+      swap_cv_.wait_for(lk, std::chrono::nanoseconds(wait_ns));
+    }
+  }
+}
+
+void
+ModelLifeCycle::LoadDemand(
+    const std::string& model_path, const int64_t version,
+    const inference::ModelConfig& model_config, int64_t* priority,
+    std::map<int, uint64_t>* device_bytes)
+{
+  if (priority != nullptr) {
+    Status status = GetInt64ModelParameter(
+        model_config, "TRITON_LOAD_PRIORITY", 0 /* default_value */, priority);
+    if (!status.IsOk()) {
+      LOG_ERROR << "failed to get the load priority of '"
+                << model_config.name() << "': " << status.AsString();
+      *priority = 0;
+    }
+  }
+  if (device_bytes == nullptr) {
+    return;
+  }
+
+  GetExpectedDeviceByteSize(
+      model_path, version, model_config, min_compute_capability_,
+      false /* include_host */, device_bytes);
+}
+
+void
+ModelLifeCycle::EnqueueLoad(PendingLoad&& load)
+{
+  {
+    std::lock_guard<std::mutex> lk(load_queue_mtx_);
+    pending_loads_.emplace_back(std::move(load));
+  }
+  // Wake the load threads that wait for memory, the new load may fit
+  load_queue_cv_.notify_all();
+  load_pool_->Enqueue([this]() { RunNextLoad(); });
+}
+
+void
+ModelLifeCycle::RunNextLoad()
+{
+  std::unique_lock<std::mutex> lk(load_queue_mtx_);
+  auto next = pending_loads_.end();
+  load_queue_cv_.wait(lk, [this, &next]() {
+    // The first of the pending loads with the highest priority that fit
+    next = pending_loads_.end();
+    for (auto it = pending_loads_.begin(); it != pending_loads_.end(); ++it) {
+      if (((next == pending_loads_.end()) ||
+           (it->priority_ > next->priority_)) &&
+          LoadFits(*it)) {
+        next = it;
+      }
+    }
+    return (next != pending_loads_.end()) || pending_loads_.empty();
+  });
+  if (next == pending_loads_.end()) {
+    return;
+  }
+
+  PendingLoad load = std::move(*next);
+  pending_loads_.erase(next);
+  for (const auto& device : load.device_bytes_) {
+    auto& running = running_loads_[device.first];
+    running.first += device.second;
+    ++running.second;
+  }
+  lk.unlock();
+
+  load.task_();
+
+  lk.lock();
+  for (const auto& device : load.device_bytes_) {
+    auto& running = running_loads_[device.first];
+    running.first -= device.second;
+    if (--running.second == 0) {
+      running_loads_.erase(device.first);
+    }
+  }
+  lk.unlock();
+  load_queue_cv_.notify_all();
+}
+
+bool
+ModelLifeCycle::LoadFits(const PendingLoad& load)
+{
+  for (const auto& device : load.device_bytes_) {
+    // Any load may start on a device without running loads, so that a
+    // load that is expected to exceed the limit still gets to run (and
+    // be rejected by the limit check of the backend model if it does)
+    const auto rit = running_loads_.find(device.first);
+    if (rit == running_loads_.end()) {
+      continue;
+    }
+    size_t free = 0, total = 0;
+    double memory_limit = 1.0;
+    if (!GetDeviceMemoryInfo(device.first, &free, &total).IsOk() ||
+        (total == 0) ||
+        !BackendConfigurationModelLoadGpuFraction(
+             cmdline_config_map_, device.first, &memory_limit)
+             .IsOk()) {
+      continue;
+    }
+    // The memory of the running loads is counted in full even though part
+    // of it is in use already, erring on the side of serializing the loads
+    const uint64_t used = total - free;
+    if ((used + rit->second.first + device.second) > (total * memory_limit)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 }}  // namespace triton::core
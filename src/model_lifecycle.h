@@ -26,10 +26,13 @@
 //
 #pragma once
 
+#include <condition_variable>
 #include <functional>
 #include <iostream>
+#include <list>
 #include <map>
 #include <mutex>
+#include <thread>
 #include "infer_parameter.h"
 #include "model.h"
 #include "model_config.pb.h"
@@ -168,6 +171,15 @@ class ModelLifeCycle {
 
   ~ModelLifeCycle()
   {
+    if (swap_thread_.joinable()) {
+      {
+        std::lock_guard<std::mutex> lk(map_mtx_);
+        swap_exit_ = true;
+      }
+      swap_cv_.notify_all();
+      swap_thread_.join();
+    }
+
     // Explicitly clean up thread pool first to clean up any pending callbacks
     // that may modify model lifecycle members
     load_pool_.reset();
@@ -218,6 +230,40 @@ class ModelLifeCycle {
   // that don't have in-flight inferences will not be included.
   const std::set<std::tuple<ModelIdentifier, int64_t, size_t>> InflightStatus();
 
+  // Unload the model versions that are stopped and have no in-flight
+  // inference left and return the in-flight inference count of the
+  // others, as InflightStatus() does. The versions are released, and so
+  // destroyed, concurrently. No version of a non-ensemble model is
+  // unloaded while an ensemble still has in-flight inferences that may
+  // depend on it. Calls to other models from outside of an ensemble, as
+  // BLS models make, are not tracked, so this must not be used when a
+  // model may make them.
+  const std::set<std::tuple<ModelIdentifier, int64_t, size_t>>
+  UnloadDrainedModels();
+
+  // Enable checkpoints and read the checkpoint written to 'path' by an
+  // earlier run. Return the names of the models it records, so that they
+  // can be loaded again. A version that is loaded again unchanged skips
+  // its warm-up, the earlier run warmed it up successfully. A missing
+  // checkpoint is not an error. Must be called before any model is
+  // loaded.
+  Status ReadCheckpoint(
+      const std::string& path, std::set<std::string>* model_names);
+
+  // Record the model versions that are ready to the local file 'path'.
+  // The file is left untouched if the recorded versions didn't change.
+  Status WriteCheckpoint(const std::string& path);
+
+  // Run 'task' on the thread pool that loads the models. The task must not
+  // wait for a model load.
+  void RunOnLoadPool(std::function<void()>&& task)
+  {
+    load_pool_->Enqueue(std::move(task));
+  }
+
+  // The number of threads of the load pool
+  unsigned int LoadThreadCount() const { return load_thread_count_; }
+
  private:
   struct ModelInfo {
     ModelInfo(
@@ -259,6 +305,10 @@ class ModelLifeCycle {
     // flyweight
     std::shared_ptr<TritonRepoAgentModelList> agent_model_list_;
     std::shared_ptr<Model> model_;
+
+    // Identifies the loaded version across runs if checkpoints are
+    // enabled, 0 otherwise.
+    uint64_t fingerprint_ = 0;
   };
 
   struct LoadTracker {
@@ -285,12 +335,18 @@ class ModelLifeCycle {
       : server_(server),
         min_compute_capability_(options.min_compute_capability_),
         cmdline_config_map_(options.backend_cmdline_config_map_),
-        host_policy_map_(options.host_policy_map_)
+        host_policy_map_(options.host_policy_map_),
+        load_thread_count_(std::max(1u, options.model_load_thread_count_))
   {
-    load_pool_.reset(new triton::common::ThreadPool(
-        std::max(1u, options.model_load_thread_count_)));
+    load_pool_.reset(new triton::common::ThreadPool(load_thread_count_));
   }
 
+  // Compute the fingerprint of version 'version' of 'model_id' from its
+  // normalized config and the files of its model directory.
+  Status Fingerprint(
+      const ModelIdentifier& model_id, const int64_t version,
+      const ModelInfo& model_info, uint64_t* fingerprint);
+
   // Create a new model, the 'model_id' can either be a new or existing model.
   void CreateModel(
       const ModelIdentifier& model_id, const int64_t version,
@@ -316,7 +372,53 @@ class ModelLifeCycle {
       std::shared_ptr<LoadTracker> load_tracker);
 
 
-  // Mutex for 'map_' and 'background_models_'
+  // A load or update of a model version waiting for a load thread. The
+  // pending loads with higher priority start first, and a load only starts
+  // if the GPU memory it is expected to use fits the model load limit of
+  // its devices next to the running loads.
+  struct PendingLoad {
+    int64_t priority_;
+    // The expected GPU memory usage in bytes, by device id
+    std::map<int, uint64_t> device_bytes_;
+    std::function<void()> task_;
+  };
+  // Get the load priority and the expected GPU memory usage of 'version'
+  // of a model, from the TRITON_LOAD_PRIORITY and TRITON_LOAD_GPU_MEMORY_MB
+  // (per instance) model configuration parameters. Without the latter the
+  // size of the version directory of a local model is the estimate.
+  // Either output may be nullptr to skip it.
+  void LoadDemand(
+      const std::string& model_path, const int64_t version,
+      const inference::ModelConfig& model_config, int64_t* priority,
+      std::map<int, uint64_t>* device_bytes);
+  // Queue a load to run on the load pool.
+  void EnqueueLoad(PendingLoad&& load);
+  // Run the next pending load that can start, once per EnqueueLoad().
+  void RunNextLoad();
+  // Return whether 'load' fits on its devices next to the running loads.
+  // 'load_queue_mtx_' must be held.
+  bool LoadFits(const PendingLoad& load);
+
+  // A gradual shift of the latest-version traffic of a model from the
+  // latest version that a load replaces to the newly loaded latest
+  // version, over the TRITON_VERSION_SWAP_RAMP_MS of the model
+  // configuration. The replaced version stays loaded until the end of the
+  // ramp.
+  struct VersionSwap {
+    int64_t old_version_;
+    // To recognize that the old version was changed since
+    uint64_t old_update_ns_;
+    uint64_t start_ns_;
+    uint64_t ramp_ns_;
+    uint64_t request_cnt_;
+  };
+  // Return whether a latest-version request should still go to the old
+  // version of 'swap'. 'map_mtx_' must be held.
+  static bool RouteToOldVersion(VersionSwap* swap, const uint64_t now_ns);
+  // Unload the replaced versions at the end of their ramps.
+  void SwapThread();
+
+  // Mutex for 'map_', 'background_models_' and 'swaps_'
   std::mutex map_mtx_;
 
   using VersionMap = std::map<int64_t, std::unique_ptr<ModelInfo>>;
@@ -324,14 +426,37 @@ class ModelLifeCycle {
   ModelMap map_;
   // Models that are being loaded / unloaded in background
   std::map<uintptr_t, std::unique_ptr<ModelInfo>> background_models_;
+  // The ongoing version swaps
+  std::map<ModelIdentifier, VersionSwap> swaps_;
+  std::condition_variable swap_cv_;
+  bool swap_exit_ = false;
+  std::thread swap_thread_;
 
   InferenceServer* server_;
   const double min_compute_capability_;
   const triton::common::BackendCmdlineConfigMap cmdline_config_map_;
   const triton::common::HostPolicyCmdlineConfigMap host_policy_map_;
 
+  const unsigned int load_thread_count_;
+  // The loads waiting for a load thread, in the order they were queued
+  std::mutex load_queue_mtx_;
+  std::condition_variable load_queue_cv_;
+  std::list<PendingLoad> pending_loads_;
+  // The expected GPU memory usage of the running loads and their number,
+  // by device id
+  std::map<int, std::pair<uint64_t, size_t>> running_loads_;
   // Fixed-size thread pool to load models at specified concurrency
   std::unique_ptr<triton::common::ThreadPool> load_pool_;
+
+  // Whether the fingerprints of the loaded versions are computed
+  bool checkpoint_enabled_ = false;
+  // The fingerprints of the versions recorded by the checkpoint of the
+  // earlier run that haven't been loaded again yet
+  std::mutex checkpoint_mtx_;
+  std::map<std::pair<ModelIdentifier, int64_t>, uint64_t> restored_versions_;
+  // The contents of the checkpoint file, it is only rewritten when they
+  // change
+  std::string checkpoint_contents_;
 };
 
 }}  // namespace triton::core
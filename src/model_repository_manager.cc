@@ -28,8 +28,10 @@
 #include "model_repository_manager.h"
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
 #include <deque>
-#include <future>
 #include <stdexcept>
 #include <thread>
 #include "backend_model.h"
@@ -320,21 +322,64 @@ GetDetailedModifiedTime(const std::string& model_dir_path)
 
   return mtime;
 }
-// Return true if any file in the 'model_dir_path' has been modified more
-// recently than 'last_ns', which represents last modified time for
-// '<config.pbtxt, model files>'. Update the 'last_ns' to the most-recent
-// modified time.
+// Return true if 'new_ns', the current modified time for
+// '<config.pbtxt, model files>' of a model directory, is more recent than
+// 'last_ns', which represents last modified time. Update the 'last_ns' to
+// the most-recent modified time.
 bool
 IsModified(
-    const std::string& model_dir_path, std::pair<int64_t, int64_t>* last_ns)
+    std::pair<int64_t, int64_t> new_ns, std::pair<int64_t, int64_t>* last_ns)
 {
-  auto new_ns = GetDetailedModifiedTime(model_dir_path);
   bool modified = std::max(new_ns.first, new_ns.second) >
                   std::max(last_ns->first, last_ns->second);
   last_ns->swap(new_ns);
   return modified;
 }
 
+// Call 'fn' with each index in [0, 'count') on the model load threads and
+// the calling thread, and return once all the calls have completed. The
+// calling thread takes part so that the calls still make progress while
+// the load threads are busy loading models.
+void
+ParallelFor(
+    ModelLifeCycle* life_cycle, const size_t count,
+    const std::function<void(size_t)>& fn)
+{
+  struct State {
+    std::atomic<size_t> next_{0};
+    std::mutex mu_;
+    std::condition_variable cv_;
+    size_t completed_ = 0;
+  };
+  auto state = std::make_shared<State>();
+  // A load thread that only starts after all indices are claimed must not
+  // touch anything but 'state', 'fn' may be gone by then.
+  auto run = [state, count, &fn]() {
+    size_t completed = 0;
+    for (size_t idx = state->next_++; idx < count; idx = state->next_++) {
+      fn(idx);
+      ++completed;
+    }
+    if (completed > 0) {
+      std::lock_guard<std::mutex> lk(state->mu_);
+      state->completed_ += completed;
+      if (state->completed_ == count) {
+        state->cv_.notify_all();
+      }
+    }
+  };
+
+  const size_t helper_count =
+      std::min<size_t>(life_cycle->LoadThreadCount(), count) - 1;
+  for (size_t i = 0; (count > 0) && (i < helper_count); ++i) {
+    life_cycle->RunOnLoadPool(run);
+  }
+  run();
+
+  std::unique_lock<std::mutex> lk(state->mu_);
+  state->cv_.wait(lk, [&state, count]() { return state->completed_ >= count; });
+}
+
 }  // namespace
 
 ModelRepositoryManager::ModelRepositoryManager(
@@ -402,6 +447,60 @@ ModelRepositoryManager::Create(
           enable_model_namespacing, std::move(life_cycle)));
   *model_repository_manager = std::move(local_manager);
 
+  // Incremental poll mode, only the model directories that changed since
+  // the previous poll are walked.
+  const char* incremental_poll = std::getenv("TRITON_INCREMENTAL_MODEL_POLL");
+  if (polling_enabled && (incremental_poll != nullptr) &&
+      (std::string(incremental_poll) != "0")) {
+    for (const auto& path : repository_paths) {
+      std::unique_ptr<RepositoryWatcher> watcher;
+      Status status =
+          RepositoryWatcher::Create(path, GetDetailedModifiedTime, &watcher);
+      if (!status.IsOk()) {
+        LOG_WARNING << "failed to watch model repository '" << path
+                    << "', the repository is fully polled: "
+                    << status.Message();
+      } else if (watcher != nullptr) {
+        (*model_repository_manager)
+            ->repository_watchers_.emplace(path, std::move(watcher));
+      }
+    }
+  }
+
+  // Normalized model configs are reused across restarts if a cache
+  // directory is given.
+  const char* config_cache_dir = std::getenv("TRITON_MODEL_CONFIG_CACHE_DIR");
+  if ((config_cache_dir != nullptr) && (config_cache_dir[0] != '\0')) {
+    Status status = ModelConfigCache::Create(
+        config_cache_dir, server_version,
+        life_cycle_options.min_compute_capability_, !strict_model_config,
+        &(*model_repository_manager)->config_cache_);
+    if (!status.IsOk()) {
+      LOG_WARNING << "failed to create the model config cache in '"
+                  << config_cache_dir << "', configs are not cached: "
+                  << status.Message();
+    }
+  }
+
+  // The models loaded by the previous run are recorded to a checkpoint
+  // if a checkpoint file is given. In explicit model control mode they
+  // are loaded again after the startup models, in any mode the versions
+  // that didn't change skip their warm-up.
+  std::set<std::string> restored_models;
+  const char* checkpoint_path = std::getenv("TRITON_MODEL_CHECKPOINT");
+  if ((checkpoint_path != nullptr) && (checkpoint_path[0] != '\0')) {
+    Status status = (*model_repository_manager)
+                        ->model_life_cycle_->ReadCheckpoint(
+                            checkpoint_path, &restored_models);
+    if (!status.IsOk()) {
+      LOG_WARNING << "failed to read the model checkpoint '"
+                  << checkpoint_path << "', no model is restored: "
+                  << status.Message();
+      restored_models.clear();
+    }
+    (*model_repository_manager)->checkpoint_path_ = checkpoint_path;
+  }
+
   // Support loading all models on startup in explicit model control mode with
   // special startup_model name "*". This does not imply support for pattern
   // matching in model names.
@@ -459,6 +558,29 @@ ModelRepositoryManager::Create(
     }
   }
 
+  // The restored models are loaded on a best-effort basis, the checkpoint
+  // may record models that were since removed from the repository or no
+  // longer load. Each is loaded on its own so that such a model doesn't
+  // prevent the others from being restored.
+  if (model_control_enabled && !load_all_models_on_startup) {
+    for (const auto& model_name : restored_models) {
+      if (startup_models.find(model_name) != startup_models.end()) {
+        continue;
+      }
+      std::unordered_map<std::string, std::vector<const InferenceParameter*>>
+          models{{model_name, {}}};
+      bool restored_model_polled = true;
+      Status status =
+          (*model_repository_manager)
+              ->LoadUnloadModels(
+                  models, ActionType::LOAD, false, &restored_model_polled);
+      if (!status.IsOk()) {
+        LOG_WARNING << "failed to restore model '" << model_name
+                    << "' from the model checkpoint: " << status.Message();
+      }
+    }
+  }
+
   return Status::Success;
 }
 
@@ -479,6 +601,19 @@ ModelRepositoryManager::PollAndUpdateInternal(bool* all_models_polled)
   // Serialize all operations that change model state
   std::lock_guard<std::mutex> lock(mu_);
 
+  // Catch up with the changes since the previous poll
+  for (auto it = repository_watchers_.begin();
+       it != repository_watchers_.end();) {
+    Status status = it->second->Refresh();
+    if (!status.IsOk()) {
+      LOG_WARNING << "stop watching model repository '" << it->first
+                  << "', the repository is fully polled: " << status.Message();
+      it = repository_watchers_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
   std::set<ModelIdentifier> added, deleted, modified, unmodified;
 
   // We don't modify 'infos_' in place to minimize how long we need to
@@ -519,6 +654,7 @@ ModelRepositoryManager::PollAndUpdateInternal(bool* all_models_polled)
 
   // model loading / unloading error will be printed but ignored
   LoadModelByDependency(&dependency_graph_, &infos_);
+  WriteCheckpoint();
 
   return Status::Success;
 }
@@ -543,17 +679,25 @@ ModelRepositoryManager::LoadModelByDependency(
   //  - Reflect the lifecycle change result to the dependency graph so that the
   //    downstream nodes may be ready for lifecycle changes.
   // Repeat until no more changes can be made.
+  // The loads run as a DAG: a model starts loading as soon as the last of
+  // its dependencies finished, not once the whole previous iteration did.
   std::map<ModelIdentifier, Status> res;
   struct ModelState {
     ModelState(DependencyNode* node) : node_(node), status_(Status::Success) {}
     DependencyNode* node_;
     Status status_;
-    std::promise<void> ready_;
   };
+  std::vector<std::unique_ptr<ModelState>> model_states;
+  // The models whose loads completed, filled by the load threads
+  std::mutex completed_mu;
+  std::condition_variable completed_cv;
+  std::vector<ModelState*> completed;
+  size_t in_flight_cnt = 0;
+
   NodeSet loaded_models;
   auto set_pair = ModelsToLoadUnload(loaded_models, res, dependency_graph);
   // Loop until all model are loaded / unloaded
-  while ((!set_pair.first.empty()) || (!set_pair.second.empty())) {
+  while (true) {
     loaded_models.clear();
     // Unload invalid models first
     for (auto& invalid_model : set_pair.second) {
@@ -563,30 +707,55 @@ ModelRepositoryManager::LoadModelByDependency(
       invalid_model->loaded_versions_ = std::set<int64_t>();
       loaded_models.emplace(invalid_model);
     }
-    // load valid models and wait for load results
-    std::vector<std::unique_ptr<ModelState>> model_states;
+    // Start the loads of the valid models, the dependents of a model are
+    // not ready until its load completes
     for (auto& valid_model : set_pair.first) {
       model_states.emplace_back(new ModelState(valid_model));
       auto model_state = model_states.back().get();
+      valid_model->in_flight_ = true;
+      ++in_flight_cnt;
       const auto itr = infos->Find(valid_model->model_id_);
       auto status = model_life_cycle_->AsyncLoad(
           valid_model->model_id_, itr->second->model_path_,
           valid_model->model_config_, itr->second->is_config_provided_,
           itr->second->mtime_nsec_.second > itr->second->prev_mtime_ns_.second,
-          itr->second->agent_model_list_, [model_state](Status load_status) {
+          itr->second->agent_model_list_,
+          [model_state, &completed_mu, &completed_cv,
+           &completed](Status load_status) {
             model_state->status_ = load_status;
-            model_state->ready_.set_value();
+            {
+              std::lock_guard<std::mutex> lk(completed_mu);
+              completed.push_back(model_state);
+            }
+            completed_cv.notify_one();
           });
       if (!status.IsOk()) {
         model_state->status_ = status;
-        model_state->ready_.set_value();
         LOG_ERROR << "failed to load model '" << valid_model->model_id_.str()
                   << "': " << status.Message();
+        std::lock_guard<std::mutex> lk(completed_mu);
+        completed.push_back(model_state);
       }
-      loaded_models.emplace(valid_model);
     }
-    for (auto& model_state : model_states) {
-      model_state->ready_.get_future().wait();
+    // The unloaded invalid models may have made dependents ready
+    if (!loaded_models.empty()) {
+      set_pair = ModelsToLoadUnload(loaded_models, res, dependency_graph);
+      continue;
+    }
+    if (in_flight_cnt == 0) {
+      break;
+    }
+
+    // Wait for at least one load to complete and take all of them
+    std::vector<ModelState*> done;
+    {
+      std::unique_lock<std::mutex> lk(completed_mu);
+      completed_cv.wait(lk, [&completed]() { return !completed.empty(); });
+      done.swap(completed);
+    }
+    for (auto model_state : done) {
+      --in_flight_cnt;
+      model_state->node_->in_flight_ = false;
       res[model_state->node_->model_id_] = model_state->status_;
       const auto version_state =
           model_life_cycle_->VersionStates(model_state->node_->model_id_);
@@ -603,6 +772,7 @@ ModelRepositoryManager::LoadModelByDependency(
         auto& model_info = infos->Find(model_state->node_->model_id_)->second;
         model_info->mtime_nsec_ = model_info->prev_mtime_ns_;
       }
+      loaded_models.emplace(model_state->node_);
     }
     set_pair = ModelsToLoadUnload(loaded_models, res, dependency_graph);
   }
@@ -824,6 +994,7 @@ ModelRepositoryManager::LoadUnloadModels(
   // Write updated info back to this object after model load/unload.
   infos_.Writeback(new_infos, affected_models);
   dependency_graph_.Writeback(new_dependency_graph, affected_models);
+  WriteCheckpoint();
 
   // Check the load status of the requested models.
   if (type == ActionType::LOAD) {
@@ -854,6 +1025,19 @@ ModelRepositoryManager::LoadUnloadModels(
   return Status::Success;
 }
 
+void
+ModelRepositoryManager::WriteCheckpoint()
+{
+  if (checkpoint_path_.empty()) {
+    return;
+  }
+  Status status = model_life_cycle_->WriteCheckpoint(checkpoint_path_);
+  if (!status.IsOk()) {
+    LOG_WARNING << "failed to write the model checkpoint '"
+                << checkpoint_path_ << "': " << status.Message();
+  }
+}
+
 Status
 ModelRepositoryManager::PollModels(
     const std::unordered_map<
@@ -965,6 +1149,12 @@ ModelRepositoryManager::InflightStatus()
   return model_life_cycle_->InflightStatus();
 }
 
+const std::set<std::tuple<ModelIdentifier, int64_t, size_t>>
+ModelRepositoryManager::UnloadDrainedModels()
+{
+  return model_life_cycle_->UnloadDrainedModels();
+}
+
 const ModelStateMap
 ModelRepositoryManager::LiveModelStates(bool strict_readiness)
 {
@@ -1266,17 +1456,32 @@ ModelRepositoryManager::Poll(
   }
 
   // Poll each of the models. If error happens during polling the model,
-  // its state will fallback to the state before the polling.
-  for (const auto& pair : model_to_path) {
-    std::unique_ptr<ModelInfo> model_info;
+  // its state will fallback to the state before the polling. Reading and
+  // normalizing the model configurations is where the time goes, it is
+  // done in parallel and the results are classified in order afterwards.
+  std::vector<std::map<ModelIdentifier, std::string>::const_iterator> polled;
+  for (auto it = model_to_path.cbegin(); it != model_to_path.cend(); ++it) {
+    polled.emplace_back(it);
+  }
+  std::vector<std::unique_ptr<ModelInfo>> model_infos(polled.size());
+  std::vector<Status> statuses(polled.size());
+  ParallelFor(model_life_cycle_.get(), polled.size(), [&](size_t idx) {
+    const auto& pair = *polled[idx];
     // Load with parameters will be appiled to all models with the same
     // name (namespace can be different), unless namespace is specified
     // in the future.
     const auto& mit = models.find(pair.first.name_);
     static std::vector<const InferenceParameter*> empty_params;
-    auto status = InitializeModelInfo(
+    statuses[idx] = InitializeModelInfo(
         pair.first, pair.second,
-        ((mit == models.end()) ? empty_params : mit->second), &model_info);
+        ((mit == models.end()) ? empty_params : mit->second),
+        &model_infos[idx]);
+  });
+
+  for (size_t idx = 0; idx < polled.size(); ++idx) {
+    const auto& pair = *polled[idx];
+    auto& model_info = model_infos[idx];
+    const auto& status = statuses[idx];
 
     const auto& iitr = infos_.Find(pair.first);
     const bool invalid_add = (!status.IsOk()) && (iitr == infos_.end());
@@ -1325,6 +1530,18 @@ ModelRepositoryManager::ModelDirectoryOverride(
   return false;
 }
 
+std::pair<int64_t, int64_t>
+ModelRepositoryManager::ModelModifiedTimes(const std::string& model_dir_path)
+{
+  const std::string model_name = BaseName(model_dir_path);
+  for (const auto& watcher : repository_watchers_) {
+    if (JoinPath({watcher.first, model_name}) == model_dir_path) {
+      return watcher.second->ModelModifiedTimes(model_name);
+    }
+  }
+  return GetDetailedModifiedTime(model_dir_path);
+}
+
 Status
 ModelRepositoryManager::InitializeModelInfo(
     const ModelIdentifier& model_id, const std::string& path,
@@ -1376,13 +1593,13 @@ ModelRepositoryManager::InitializeModelInfo(
     linfo->agent_model_list_->AddAgentModel(std::move(localize_agent_model));
   } else {
     if (iitr == infos_.end()) {
-      linfo->mtime_nsec_ = GetDetailedModifiedTime(linfo->model_path_);
+      linfo->mtime_nsec_ = ModelModifiedTimes(linfo->model_path_);
     } else {
       // Check the current timestamps to determine if model actually has been
       // modified
       linfo->mtime_nsec_ = linfo->prev_mtime_ns_;
-      unmodified =
-          !IsModified(std::string(linfo->model_path_), &linfo->mtime_nsec_);
+      unmodified = !IsModified(
+          ModelModifiedTimes(linfo->model_path_), &linfo->mtime_nsec_);
     }
   }
 
@@ -1427,6 +1644,9 @@ ModelRepositoryManager::InitializeModelInfo(
   // Create the associated repo agent models when a model is to be loaded,
   // this must be done before normalizing model config as agents might
   // redirect to use the model config at a different location
+  bool config_cached = false;
+  bool config_cacheable = false;
+  uint64_t config_cache_key = 0;
   if (!parsed_config) {
     const auto config_path = JoinPath({linfo->model_path_, kModelConfigPbTxt});
     bool model_config_exists = false;
@@ -1434,6 +1654,12 @@ ModelRepositoryManager::InitializeModelInfo(
     // model config can be missing if auto fill is set
     if (autofill_ && !model_config_exists) {
       linfo->model_config_.Clear();
+    } else if (config_cache_ != nullptr) {
+      RETURN_IF_ERROR(config_cache_->Read(
+          model_id.str(), config_path, linfo->model_path_,
+          &linfo->model_config_, &config_cached, &config_cache_key));
+      config_cacheable = true;
+      parsed_config = true;
     } else {
       RETURN_IF_ERROR(ReadTextProto(config_path, &linfo->model_config_));
       parsed_config = true;
@@ -1450,6 +1676,10 @@ ModelRepositoryManager::InitializeModelInfo(
           &artifact_type, &location));
       auto latest_path = std::string(location);
       linfo->model_path_ = latest_path;
+      // The agent may change the model files behind the config, so the
+      // config is normalized every time.
+      config_cached = false;
+      config_cacheable = false;
       // [TODO] should try to read the config again at the latest location?
     }
   }
@@ -1460,19 +1690,26 @@ ModelRepositoryManager::InitializeModelInfo(
   // Repo agent / config overwrite may provide different configs than
   // the one in storage.
 
-  // Try to automatically generate missing parts of the model
-  // configuration (autofill) that don't require model detail
-  RETURN_IF_ERROR(GetNormalizedModelConfig(
-      model_id.name_, linfo->model_path_, min_compute_capability_,
-      &linfo->model_config_));
-
-  // Note that the model inputs and outputs are not validated until
-  // the model model is intialized as they may not be auto-completed
-  // until model is intialized.
-  RETURN_IF_ERROR(
-      ValidateModelConfig(linfo->model_config_, min_compute_capability_));
-  if (!autofill_) {
-    RETURN_IF_ERROR(ValidateModelIOConfig(linfo->model_config_));
+  // A cached config was normalized and validated when it was stored
+  if (!config_cached) {
+    // Try to automatically generate missing parts of the model
+    // configuration (autofill) that don't require model detail
+    RETURN_IF_ERROR(GetNormalizedModelConfig(
+        model_id.name_, linfo->model_path_, min_compute_capability_,
+        &linfo->model_config_));
+
+    // Note that the model inputs and outputs are not validated until
+    // the model model is intialized as they may not be auto-completed
+    // until model is intialized.
+    RETURN_IF_ERROR(
+        ValidateModelConfig(linfo->model_config_, min_compute_capability_));
+    if (!autofill_) {
+      RETURN_IF_ERROR(ValidateModelIOConfig(linfo->model_config_));
+    }
+    if (config_cacheable) {
+      config_cache_->Insert(
+          model_id.str(), config_cache_key, linfo->model_config_);
+    }
   }
 
   // If the model is mapped, update its config name based on the
@@ -1644,7 +1881,7 @@ ModelRepositoryManager::CheckNode(
   // it should not be loaded
   if (node->status_.IsOk()) {
     for (auto& upstream : node->upstreams_) {
-      if (!upstream.first->checked_) {
+      if (!upstream.first->checked_ || upstream.first->in_flight_) {
         node_ready = false;
         break;
       }
@@ -32,8 +32,10 @@
 #include <mutex>
 #include <set>
 #include "infer_parameter.h"
+#include "model_config_cache.h"
 #include "model_config.pb.h"
 #include "model_lifecycle.h"
+#include "repository_watcher.h"
 #include "status.h"
 #include "triton/common/model_config.h"
 
@@ -159,7 +161,7 @@ class ModelRepositoryManager {
   struct DependencyNode {
     DependencyNode(const ModelIdentifier& model_id)
         : status_(Status::Success), model_id_(model_id), checked_(false),
-          connected_(false), is_locked_(false),
+          connected_(false), in_flight_(false), is_locked_(false),
           retry_notify_cv_(new std::condition_variable())
     {
     }
@@ -200,6 +202,9 @@ class ModelRepositoryManager {
 
     // Lifecycle info
     std::set<int64_t> loaded_versions_;
+    // Whether the model is being loaded by LoadModelByDependency(), its
+    // downstreams are not ready until the load completes
+    bool in_flight_;
 
     // Loading/Unloading info
     // when locked, there is another thread loading/unloading model(s) that
@@ -429,6 +434,13 @@ class ModelRepositoryManager {
   /// if it doesn't have in-flight inferences.
   const std::set<std::tuple<ModelIdentifier, int64_t, size_t>> InflightStatus();
 
+  /// Unload the versions of the stopped models that have no in-flight
+  /// inferences left.
+  /// \return the in-flight inferences of the remaining versions, in the
+  /// same form as InflightStatus().
+  const std::set<std::tuple<ModelIdentifier, int64_t, size_t>>
+  UnloadDrainedModels();
+
   /// \param strict_readiness If true, only models that have at least one
   /// ready version will be considered as live. Otherwise, the models that
   /// have loading / unloading versions will also be live.
@@ -513,6 +525,10 @@ class ModelRepositoryManager {
       const ActionType type, const bool unload_dependents,
       bool* all_models_polled, bool* no_parallel_conflict = nullptr);
 
+  /// Record the loaded models to 'checkpoint_path_' if checkpoints are
+  /// enabled. Failures are only logged.
+  void WriteCheckpoint();
+
   /// Helper function for LoadUnloadModels() to find the set of added, deleted,
   /// modified and unmodified models. Also update the provided model infos.
   /// This function will not update the model info held by this object, it is
@@ -552,6 +568,7 @@ class ModelRepositoryManager {
       bool* all_models_polled);
 
   /// Helper function for Poll() to initialize ModelInfo for the model.
+  /// Called for different models concurrently.
   /// \param model_id The identifier of the model.
   /// \param path The model path. Empty path means the model is provided via
   /// 'params'
@@ -564,9 +581,9 @@ class ModelRepositoryManager {
       const std::vector<const InferenceParameter*>& params,
       std::unique_ptr<ModelInfo>* info);
 
-  /// Load models based on the dependency graph. The function will iteratively
-  /// load models that all the models they depend on has been loaded, and unload
-  /// models if their dependencies are no longer satisfied.
+  /// Load models based on the dependency graph. The function starts the load
+  /// of a model as soon as all the models it depends on have been loaded, and
+  /// unloads models if their dependencies are no longer satisfied.
   /// \param dependency_graph The dependency graph.
   /// \param infos Model infos to be updated along the load.
   /// \return The status of the model loads.
@@ -599,6 +616,11 @@ class ModelRepositoryManager {
   bool ModelDirectoryOverride(
       const std::vector<const InferenceParameter*>& model_params);
 
+  /// Get the modification times of '<config.pbtxt, model files>' of a
+  /// model directory, from the watcher of its repository if it has one.
+  std::pair<int64_t, int64_t> ModelModifiedTimes(
+      const std::string& model_dir_path);
+
   const bool autofill_;
   const bool polling_enabled_;
   const bool model_control_enabled_;
@@ -643,6 +665,18 @@ class ModelRepositoryManager {
   // (https://github.com/triton-inference-server/server/issues/3802)
   ModelInfoMap infos_;
   std::set<std::string> repository_paths_;
+  // The watchers of the repositories in incremental poll mode, keyed by
+  // repository path. A repository without a watcher is walked on each poll.
+  std::map<std::string, std::unique_ptr<RepositoryWatcher>>
+      repository_watchers_;
+
+  // The store of normalized model configs reused across restarts,
+  // nullptr if disabled.
+  std::unique_ptr<ModelConfigCache> config_cache_;
+
+  // The file recording the loaded models for the next run, empty if
+  // checkpoints are disabled.
+  std::string checkpoint_path_;
   // Mappings from (overridden) model names to a pair of their repository and
   // absolute path
   // [DLIS-4596] key should be updated to contain namespace to work with enabled
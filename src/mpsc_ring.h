@@ -0,0 +1,136 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace triton { namespace core {
+
+//
+// Bounded multi-producer / single-consumer ring. Any number of threads
+// may call TryPush() concurrently, but only one thread at a time may
+// call TryPop(). The ring never blocks, a full ring is reported to the
+// producer so that it can fall back to a slower path.
+//
+template <typename T>
+class MPSCRing {
+ public:
+  // Create a ring that holds at least 'capacity' items. The actual
+  // capacity is rounded up to the next power of two.
+  explicit MPSCRing(size_t capacity) : head_(0), tail_(0)
+  {
+    size_t actual = 2;
+    while (actual < capacity) {
+      actual <<= 1;
+    }
+    mask_ = actual - 1;
+    slots_.reset(new Slot[actual]);
+    for (size_t i = 0; i < actual; ++i) {
+      slots_[i].seq_.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MPSCRing(const MPSCRing&) = delete;
+  MPSCRing& operator=(const MPSCRing&) = delete;
+
+  // Push 'item' into the ring. Return true and move from 'item' on
+  // success. Return false and leave 'item' untouched if the ring is
+  // full.
+  bool TryPush(T& item)
+  {
+    Slot* slot;
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    while (true) {
+      slot = &slots_[pos & mask_];
+      const size_t seq = slot->seq_.load(std::memory_order_acquire);
+      const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(
+                pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+
+    slot->value_ = std::move(item);
+    slot->seq_.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Pop the oldest item in the ring into 'item'. Return false if there
+  // is no item ready to be consumed. Must only be called from the
+  // single consumer thread.
+  bool TryPop(T* item)
+  {
+    const size_t pos = head_.load(std::memory_order_relaxed);
+    Slot* slot = &slots_[pos & mask_];
+    if (slot->seq_.load(std::memory_order_acquire) != (pos + 1)) {
+      return false;
+    }
+
+    *item = std::move(slot->value_);
+    slot->seq_.store(pos + mask_ + 1, std::memory_order_release);
+    head_.store(pos + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // Return the approximate number of items in the ring. The value may
+  // be stale by the time it is returned if producers are active.
+  size_t Size() const
+  {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    return (tail > head) ? (tail - head) : 0;
+  }
+
+  bool Empty() const { return Size() == 0; }
+
+  size_t Capacity() const { return mask_ + 1; }
+
+ private:
+  struct Slot {
+    std::atomic<size_t> seq_;
+    T value_;
+  };
+
+  std::unique_ptr<Slot[]> slots_;
+  size_t mask_;
+
+  // Consumer and producer positions are padded onto separate cache
+  // lines so that producers do not invalidate the consumer's line.
+  std::atomic<size_t> head_;
+  char pad_[64 - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> tail_;
+};
+
+}}  // namespace triton::core
@@ -28,6 +28,7 @@
 #ifndef _WIN32
 #include <numa.h>
 #include <numaif.h>
+#include <sched.h>
 #endif
 #include "triton/common/logging.h"
 
@@ -72,12 +73,39 @@ SetNumaConfigOnThread(
   return Status::Success;
 }
 
+Status
+SetNumaConfigOnBatcherThread(
+    const triton::common::HostPolicyCmdlineConfig& host_policy)
+{
+  return Status::Success;
+}
+
 Status
 SetNumaMemoryPolicy(const triton::common::HostPolicyCmdlineConfig& host_policy)
 {
   return Status::Success;
 }
 
+Status
+GetNumaNodeOfHostPolicy(
+    const triton::common::HostPolicyCmdlineConfig& host_policy, int* node_id)
+{
+  *node_id = -1;
+  return Status::Success;
+}
+
+int
+NumaNodeOfAddress(const void* addr)
+{
+  return -1;
+}
+
+int
+NumaNodeOfCurrentThread()
+{
+  return -1;
+}
+
 Status
 GetNumaMemoryPolicyNodeMask(unsigned long* node_mask)
 {
@@ -99,6 +127,55 @@ SetNumaThreadAffinity(
   return Status::Success;
 }
 #else
+namespace {
+
+// Parse the 'cpu-cores' format, a comma separated list of
+// '<lower_cpu_core_id>-<upper_cpu_core_id>' ranges, into 'cpus'.
+Status
+ParseCpuCores(const std::string& cpu_str, std::vector<int>* cpus)
+{
+  auto delim_cpus = cpu_str.find(",");
+  int current_pos = 0;
+  while (true) {
+    auto delim_range = cpu_str.find("-", current_pos);
+    if (delim_range == std::string::npos) {
+      return Status(
+          Status::Code::INVALID_ARG,
+          std::string("host policy setting 'cpu-cores' format is "
+                      "'<lower_cpu_core_id>-<upper_cpu_core_id>'. Got ") +
+              cpu_str.substr(
+                  current_pos, ((delim_cpus == std::string::npos)
+                                    ? (cpu_str.length() + 1)
+                                    : delim_cpus) -
+                                   current_pos));
+    }
+    int lower, upper;
+    RETURN_IF_ERROR(ParseIntOption(
+        "Parsing 'cpu-cores' value",
+        cpu_str.substr(current_pos, delim_range - current_pos), &lower));
+    RETURN_IF_ERROR(ParseIntOption(
+        "Parsing 'cpu-cores' value",
+        (delim_cpus == std::string::npos)
+            ? cpu_str.substr(delim_range + 1)
+            : cpu_str.substr(
+                  delim_range + 1, delim_cpus - (delim_range + 1)),
+        &upper));
+    for (; lower <= upper; ++lower) {
+      cpus->push_back(lower);
+    }
+    // break if the processed range is the last specified range
+    if (delim_cpus != std::string::npos) {
+      current_pos = delim_cpus + 1;
+      delim_cpus = cpu_str.find(",", current_pos);
+    } else {
+      break;
+    }
+  }
+  return Status::Success;
+}
+
+}  // namespace
+
 // Use variable to make sure no NUMA related function is actually called
 // if Triton is not running with NUMA awareness. i.e. Extra docker permission
 // is needed to call the NUMA functions and this ensures backward compatibility.
@@ -118,14 +195,83 @@ SetNumaConfigOnThread(
 }
 
 Status
-SetNumaMemoryPolicy(const triton::common::HostPolicyCmdlineConfig& host_policy)
+SetNumaConfigOnBatcherThread(
+    const triton::common::HostPolicyCmdlineConfig& host_policy)
+{
+  const auto it = host_policy.find("batcher-cpu-cores");
+  if (it == host_policy.end()) {
+    return Status::Success;
+  }
+
+  // The batcher thread uses the same memory policy as the backend threads
+  // of the policy, only the CPUs differ.
+  triton::common::HostPolicyCmdlineConfig batcher_policy(host_policy);
+  batcher_policy["cpu-cores"] = it->second;
+  return SetNumaConfigOnThread(batcher_policy);
+}
+
+Status
+GetNumaNodeOfHostPolicy(
+    const triton::common::HostPolicyCmdlineConfig& host_policy, int* node_id)
 {
+  *node_id = -1;
   const auto it = host_policy.find("numa-node");
-  if (it != host_policy.end()) {
-    int node_id;
+  if (it == host_policy.end()) {
+    return Status::Success;
+  }
+
+  if (it->second == "auto") {
+    // Bind to the node of the CPUs the thread is pinned to
+    const auto cpu_it = host_policy.find("cpu-cores");
+    if (cpu_it == host_policy.end()) {
+      return Status(
+          Status::Code::INVALID_ARG,
+          "host policy setting 'numa-node' can only be 'auto' if "
+          "'cpu-cores' is specified");
+    }
+    std::vector<int> cpus;
+    RETURN_IF_ERROR(ParseCpuCores(cpu_it->second, &cpus));
+    *node_id = cpus.empty() ? -1 : numa_node_of_cpu(cpus.front());
+    if (*node_id < 0) {
+      return Status(
+          Status::Code::INTERNAL,
+          std::string("Unable to find NUMA node of 'cpu-cores' ") +
+              cpu_it->second);
+    }
+  } else {
     RETURN_IF_ERROR(
-        ParseIntOption("Parsing 'numa-node' value", it->second, &node_id));
-    LOG_VERBOSE(1) << "Thread is binding to NUMA node " << it->second
+        ParseIntOption("Parsing 'numa-node' value", it->second, node_id));
+  }
+  return Status::Success;
+}
+
+int
+NumaNodeOfAddress(const void* addr)
+{
+  int node_id = -1;
+  if (get_mempolicy(
+          &node_id, nullptr, 0, const_cast<void*>(addr),
+          MPOL_F_NODE | MPOL_F_ADDR) != 0) {
+    return -1;
+  }
+  return node_id;
+}
+
+int
+NumaNodeOfCurrentThread()
+{
+  const int cpu = sched_getcpu();
+  return (cpu < 0) ? -1 : numa_node_of_cpu(cpu);
+}
+
+Status
+SetNumaMemoryPolicy(const triton::common::HostPolicyCmdlineConfig& host_policy)
+{
+  int node_id;
+  RETURN_IF_ERROR(GetNumaNodeOfHostPolicy(host_policy, &node_id));
+  if (node_id >= 0) {
+    LOG_VERBOSE(1) << "Thread is binding to NUMA node "
+                   << host_policy.at("numa-node")
                    << ". Max NUMA node count: " << (numa_max_node() + 1);
     numa_set = true;
     unsigned long node_mask = 1UL << node_id;
@@ -172,48 +318,8 @@ SetNumaThreadAffinity(
 {
   const auto it = host_policy.find("cpu-cores");
   if (it != host_policy.end()) {
-    // Parse CPUs
     std::vector<int> cpus;
-    {
-      const auto& cpu_str = it->second;
-      auto delim_cpus = cpu_str.find(",");
-      int current_pos = 0;
-      while (true) {
-        auto delim_range = cpu_str.find("-", current_pos);
-        if (delim_range == std::string::npos) {
-          return Status(
-              Status::Code::INVALID_ARG,
-              std::string("host policy setting 'cpu-cores' format is "
-                          "'<lower_cpu_core_id>-<upper_cpu_core_id>'. Got ") +
-                  cpu_str.substr(
-                      current_pos, ((delim_cpus == std::string::npos)
-                                        ? (cpu_str.length() + 1)
-                                        : delim_cpus) -
-                                       current_pos));
-        }
-        int lower, upper;
-        RETURN_IF_ERROR(ParseIntOption(
-            "Parsing 'cpu-cores' value",
-            cpu_str.substr(current_pos, delim_range - current_pos), &lower));
-        RETURN_IF_ERROR(ParseIntOption(
-            "Parsing 'cpu-cores' value",
-            (delim_cpus == std::string::npos)
-                ? cpu_str.substr(delim_range + 1)
-                : cpu_str.substr(
-                      delim_range + 1, delim_cpus - (delim_range + 1)),
-            &upper));
-        for (; lower <= upper; ++lower) {
-          cpus.push_back(lower);
-        }
-        // break if the processed range is the last specified range
-        if (delim_cpus != std::string::npos) {
-          current_pos = delim_cpus + 1;
-          delim_cpus = cpu_str.find(",", current_pos);
-        } else {
-          break;
-        }
-      }
-    }
+    RETURN_IF_ERROR(ParseCpuCores(it->second, &cpus));
 
     LOG_VERBOSE(1) << "Thread is binding to one of the CPUs: "
                    << VectorToString(cpus);
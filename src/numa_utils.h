@@ -38,10 +38,31 @@ namespace triton { namespace core {
 Status SetNumaConfigOnThread(
     const triton::common::HostPolicyCmdlineConfig& host_policy);
 
-// Restrict the memory allocation to specific NUMA node.
+// Helper function to set memory policy and thread affinity on the current
+// thread if it is a batcher thread. The thread is pinned to the
+// 'batcher-cpu-cores' of the host policy, nothing is set if they are not
+// specified.
+Status SetNumaConfigOnBatcherThread(
+    const triton::common::HostPolicyCmdlineConfig& host_policy);
+
+// Restrict the memory allocation to specific NUMA node. If the node is
+// 'auto' the node of the first CPU in 'cpu-cores' is used.
 Status SetNumaMemoryPolicy(
     const triton::common::HostPolicyCmdlineConfig& host_policy);
 
+// Return in 'node_id' the NUMA node that the threads of 'host_policy'
+// are bound to, or -1 if the policy doesn't set 'numa-node'.
+Status GetNumaNodeOfHostPolicy(
+    const triton::common::HostPolicyCmdlineConfig& host_policy, int* node_id);
+
+// Return the NUMA node of the memory at 'addr', or -1 if it can't be
+// determined.
+int NumaNodeOfAddress(const void* addr);
+
+// Return the NUMA node of the CPU the calling thread runs on, or -1 if
+// it can't be determined.
+int NumaNodeOfCurrentThread();
+
 // Retrieve the node mask used to set memory policy for the current thread
 Status GetNumaMemoryPolicyNodeMask(unsigned long* node_mask);
 
@@ -0,0 +1,298 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "on_demand_model_loader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <vector>
+
+#include "clock.h"
+#include "model.h"
+#include "model_config_utils.h"
+#include "model_repository_manager.h"
+#include "triton/common/logging.h"
+
+namespace triton { namespace core {
+
+namespace {
+
+// The longest time between two checks for idle models
+constexpr uint64_t kMaxEvictIntervalNs = 1000ULL * 1000 * 1000;
+
+}  // namespace
+
+OnDemandModelLoader::OnDemandModelLoader(
+    ModelRepositoryManager* model_repository_manager,
+    const uint64_t idle_timeout_sec, const uint64_t byte_size_budget)
+    : model_repository_manager_(model_repository_manager),
+      idle_timeout_ns_(idle_timeout_sec * 1000 * 1000 * 1000),
+      byte_size_budget_(byte_size_budget), exit_(false), loaded_byte_size_(0)
+{
+  if ((idle_timeout_ns_ != 0) || (byte_size_budget_ != 0)) {
+    evict_thread_ = std::thread([this]() { EvictThread(); });
+  }
+}
+
+OnDemandModelLoader::~OnDemandModelLoader()
+{
+  Stop();
+}
+
+void
+OnDemandModelLoader::Stop()
+{
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    exit_ = true;
+  }
+  cv_.notify_all();
+  if (evict_thread_.joinable()) {
+    evict_thread_.join();
+  }
+}
+
+Status
+OnDemandModelLoader::GetModel(
+    const std::string& model_name, const int64_t model_version,
+    std::shared_ptr<Model>* model)
+{
+  Status status =
+      model_repository_manager_->GetModel(model_name, model_version, model);
+  if (status.IsOk()) {
+    Touch(model->get());
+    return status;
+  }
+
+  std::shared_ptr<Entry> entry;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto& slot = entries_[model_name];
+    if (slot == nullptr) {
+      slot = std::make_shared<Entry>();
+    }
+    entry = slot;
+  }
+
+  std::lock_guard<std::mutex> load_lk(entry->load_mu_);
+  // Another request may have loaded the model in the meantime
+  status =
+      model_repository_manager_->GetModel(model_name, model_version, model);
+  if (!status.IsOk()) {
+    LOG_VERBOSE(1) << "loading '" << model_name << "' on demand";
+    status = model_repository_manager_->LoadUnloadModel(
+        {{model_name, {}}}, ActionType::LOAD, false /* unload_dependents */);
+    if (status.IsOk()) {
+      status = model_repository_manager_->GetModel(
+          model_name, model_version, model);
+    }
+    if (!status.IsOk()) {
+      std::lock_guard<std::mutex> lk(mu_);
+      auto it = entries_.find(model_name);
+      if ((it != entries_.end()) && (it->second == entry) &&
+          !entry->loaded_) {
+        entries_.erase(it);
+      }
+      return status;
+    }
+
+    const uint64_t byte_size = ModelByteSize(**model);
+    bool over_budget = false;
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      // The entry may have been dropped after a failed load while waiting.
+      // The use is recorded before the entry is seen as loaded by the
+      // evict thread, which would take the model as idle otherwise.
+      Touch(model->get());
+      entry->model_ = *model;
+      // A model loaded explicitly meanwhile is not managed on demand.
+      if (!entry->forgotten_) {
+        entries_[model_name] = entry;
+        if (!entry->loaded_) {
+          entry->loaded_ = true;
+          entry->byte_size_ = byte_size;
+          loaded_byte_size_ += byte_size;
+        }
+      }
+      over_budget =
+          (byte_size_budget_ != 0) && (loaded_byte_size_ > byte_size_budget_);
+    }
+    if (over_budget) {
+      cv_.notify_all();
+    }
+  } else {
+    Touch(model->get());
+  }
+  return Status::Success;
+}
+
+void
+OnDemandModelLoader::Touch(Model* model)
+{
+  model->SetLastUseNs(SteadyClockNs());
+}
+
+void
+OnDemandModelLoader::ForgetModel(const std::string& model_name)
+{
+  std::shared_ptr<Entry> entry;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto it = entries_.find(model_name);
+    if (it == entries_.end()) {
+      return;
+    }
+    entry = it->second;
+    entries_.erase(it);
+    entry->forgotten_ = true;
+    if (entry->loaded_) {
+      entry->loaded_ = false;
+      loaded_byte_size_ -= entry->byte_size_;
+    }
+  }
+  LOG_VERBOSE(1) << "'" << model_name << "' is no longer managed on demand";
+  std::lock_guard<std::mutex> load_lk(entry->load_mu_);
+}
+
+uint64_t
+OnDemandModelLoader::ModelByteSize(const Model& model)
+{
+  // The configuration of a loaded model is normalized, its GPU groups
+  // list their GPUs so the compute capability is not used
+  std::map<int, uint64_t> device_bytes;
+  GetExpectedDeviceByteSize(
+      model.ModelDir(), model.Version(), model.Config(),
+      0 /* min_compute_capability */, true /* include_host */,
+      &device_bytes);
+  uint64_t byte_size = 0;
+  for (const auto& bytes : device_bytes) {
+    byte_size += bytes.second;
+  }
+  return byte_size;
+}
+
+void
+OnDemandModelLoader::EvictThread()
+{
+  const uint64_t interval_ns =
+      (idle_timeout_ns_ == 0) ? kMaxEvictIntervalNs
+                              : std::min(idle_timeout_ns_ / 2,
+                                         kMaxEvictIntervalNs);
+  std::unique_lock<std::mutex> lk(mu_);
+  while (!exit_) {
+    cv_.wait_for(lk, std::chrono::nanoseconds(interval_ns));
+    if (exit_) {
+      break;
+    }
+
+    // Unload the idle models, then the least recently used ones until
+    // the rest fits the budget
+    const uint64_t now_ns = SteadyClockNs();
+    std::vector<std::pair<uint64_t, std::string>> lru;
+    std::vector<std::pair<std::string, std::shared_ptr<Entry>>> victims;
+    for (const auto& entry : entries_) {
+      if (!entry.second->loaded_) {
+        continue;
+      }
+      // A model reloaded since it was loaded on demand is a new object,
+      // its use is recorded there. Its idle time starts now if it wasn't
+      // used yet.
+      std::shared_ptr<Model> model = entry.second->model_.lock();
+      if ((model == nullptr) &&
+          model_repository_manager_
+              ->GetModel(entry.first, -1 /* model_version */, &model)
+              .IsOk()) {
+        entry.second->model_ = model;
+        if (model->LastUseNs() == 0) {
+          Touch(model.get());
+        }
+      }
+      const uint64_t last_use_ns =
+          (model == nullptr) ? 0 : model->LastUseNs();
+      if ((idle_timeout_ns_ != 0) && (now_ns > last_use_ns) &&
+          ((now_ns - last_use_ns) >= idle_timeout_ns_)) {
+        victims.emplace_back(entry.first, entry.second);
+      } else {
+        lru.emplace_back(last_use_ns, entry.first);
+      }
+    }
+    uint64_t remaining_byte_size = loaded_byte_size_;
+    for (const auto& victim : victims) {
+      remaining_byte_size -= victim.second->byte_size_;
+    }
+    if ((byte_size_budget_ != 0) && (remaining_byte_size > byte_size_budget_)) {
+      std::sort(lru.begin(), lru.end());
+      for (const auto& candidate : lru) {
+        if (remaining_byte_size <= byte_size_budget_) {
+          break;
+        }
+        const auto& entry = entries_[candidate.second];
+        remaining_byte_size -= entry->byte_size_;
+        victims.emplace_back(candidate.second, entry);
+      }
+    }
+    if (victims.empty()) {
+      continue;
+    }
+
+    // The entries stay until unloaded, so that a request for a model
+    // being unloaded waits and loads it again afterwards
+    for (const auto& victim : victims) {
+      victim.second->loaded_ = false;
+      loaded_byte_size_ -= victim.second->byte_size_;
+    }
+    lk.unlock();
+    for (const auto& victim : victims) {
+      std::lock_guard<std::mutex> load_lk(victim.second->load_mu_);
+      {
+        std::lock_guard<std::mutex> forget_lk(mu_);
+        if (victim.second->forgotten_) {
+          continue;
+        }
+      }
+      LOG_VERBOSE(1) << "unloading '" << victim.first
+                     << "' loaded on demand";
+      Status status = model_repository_manager_->LoadUnloadModel(
+          {{victim.first, {}}}, ActionType::UNLOAD,
+          false /* unload_dependents */);
+      if (!status.IsOk()) {
+        LOG_ERROR << "failed to unload '" << victim.first
+                  << "': " << status.Message();
+      }
+    }
+    lk.lock();
+    for (const auto& victim : victims) {
+      auto it = entries_.find(victim.first);
+      if ((it != entries_.end()) && (it->second == victim.second) &&
+          !victim.second->loaded_) {
+        entries_.erase(it);
+      }
+    }
+  }
+}
+
+}}  // namespace triton::core
@@ -0,0 +1,117 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "status.h"
+
+namespace triton { namespace core {
+
+class Model;
+class ModelRepositoryManager;
+
+//
+// Loads models of the repository when they are first requested and
+// unloads them again once they have not been used for the idle timeout,
+// or in least-recently-used order once the expected memory of the
+// models loaded this way exceeds the budget. Only the models loaded
+// on demand are ever unloaded, the models loaded explicitly stay.
+//
+class OnDemandModelLoader {
+ public:
+  // A zero 'idle_timeout_sec' or 'byte_size_budget' disables unloading
+  // on idle or on the budget respectively.
+  OnDemandModelLoader(
+      ModelRepositoryManager* model_repository_manager,
+      const uint64_t idle_timeout_sec, const uint64_t byte_size_budget);
+  ~OnDemandModelLoader();
+
+  OnDemandModelLoader(const OnDemandModelLoader&) = delete;
+  OnDemandModelLoader& operator=(const OnDemandModelLoader&) = delete;
+
+  // Return the requested model, loading it first if it is not available.
+  // The calling thread waits for the load, concurrent requests for the
+  // same model wait for the same load.
+  Status GetModel(
+      const std::string& model_name, const int64_t model_version,
+      std::shared_ptr<Model>* model);
+
+  // Record a use of 'model', which postpones its idle unload. Doesn't
+  // lock, it is called for every inference request.
+  void Touch(Model* model);
+
+  // Stop managing 'model_name', which is being loaded or unloaded
+  // explicitly, so that it stays as the client sets it. Waits for a
+  // load or unload on demand of the model in progress.
+  void ForgetModel(const std::string& model_name);
+
+  // Stop unloading models. Called when the server is exiting.
+  void Stop();
+
+ private:
+  struct Entry {
+    Entry() : loaded_(false), forgotten_(false), byte_size_(0) {}
+    // Serializes the load and the unload of the model
+    std::mutex load_mu_;
+    // Whether the model is loaded on demand and counted in the budget.
+    // Guarded by 'mu_', as are the other members.
+    bool loaded_;
+    // Whether the model was loaded or unloaded explicitly, which ends the
+    // management of the model on demand
+    bool forgotten_;
+    uint64_t byte_size_;
+    // The model loaded, which records its last use. Not owned so that
+    // the model is destroyed once unloaded.
+    std::weak_ptr<Model> model_;
+  };
+
+  // Return the expected memory usage of 'model' over all its instances,
+  // see GetExpectedDeviceByteSize().
+  static uint64_t ModelByteSize(const Model& model);
+
+  void EvictThread();
+
+  ModelRepositoryManager* const model_repository_manager_;
+  const uint64_t idle_timeout_ns_;
+  const uint64_t byte_size_budget_;
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  bool exit_;
+  std::unordered_map<std::string, std::shared_ptr<Entry>> entries_;
+  // The sum of the byte sizes of the loaded entries
+  uint64_t loaded_byte_size_;
+  std::thread evict_thread_;
+};
+
+}}  // namespace triton::core
@@ -26,6 +26,11 @@
 
 #include "payload.h"
 
+#include <algorithm>
+#include <limits>
+
+#include "backend_model.h"
+
 namespace triton { namespace core {
 
 Payload::Payload()
@@ -89,10 +94,17 @@ Payload::Reset(const Operation op_type, TritonModelInstance* instance)
   release_callbacks_.clear();
   instance_ = instance;
   state_ = State::UNINITIALIZED;
-  status_.reset(new std::promise<Status>());
-  required_equal_inputs_ = RequiredEqualInputs();
+  // Inference payloads are never waited on, so only the other operations
+  // pay for the allocation of the promise.
+  if (op_type == Operation::INFER_RUN) {
+    status_.reset();
+  } else {
+    status_.reset(new std::promise<Status>());
+  }
+  required_equal_inputs_.Reset();
   batcher_start_ns_ = 0;
   saturated_ = false;
+  padded_batch_sizes_.reset();
   user_pointer_ = nullptr;
 }
 
@@ -105,9 +117,10 @@ Payload::Release()
   release_callbacks_.clear();
   instance_ = nullptr;
   state_ = State::RELEASED;
-  required_equal_inputs_ = RequiredEqualInputs();
+  required_equal_inputs_.Reset();
   batcher_start_ns_ = 0;
   saturated_ = false;
+  padded_batch_sizes_.reset();
   user_pointer_ = nullptr;
 }
 
@@ -121,6 +134,18 @@ Payload::BatchSize()
   return batch_size;
 }
 
+uint64_t
+Payload::Priority()
+{
+  uint64_t priority = std::numeric_limits<uint64_t>::max();
+  for (const auto& request : requests_) {
+    if (request->Priority() != 0) {
+      priority = std::min(priority, request->Priority());
+    }
+  }
+  return priority;
+}
+
 void
 Payload::ReserveRequests(size_t size)
 {
@@ -170,6 +195,10 @@ Payload::SetState(Payload::State state)
 Status
 Payload::Wait()
 {
+  if (status_ == nullptr) {
+    return Status(
+        Status::Code::INTERNAL, "Inference payloads can not be waited on");
+  }
   return status_->get_future().get();
 }
 
@@ -191,6 +220,79 @@ Payload::OnRelease()
   release_callbacks_.clear();
 }
 
+void
+Payload::PadBatch()
+{
+  if ((padded_batch_sizes_ == nullptr) || requests_.empty()) {
+    return;
+  }
+
+  const size_t batch_size = BatchSize();
+  const auto it = padded_batch_sizes_->lower_bound(batch_size);
+  if ((it == padded_batch_sizes_->end()) || ((size_t)*it == batch_size)) {
+    return;
+  }
+
+  // The padding rows are null requests copied from the request with the
+  // smallest batch size, so the padding can only be added if it is a
+  // multiple of that batch size.
+  size_t template_idx = 0;
+  for (size_t idx = 1; idx < requests_.size(); ++idx) {
+    if (requests_[idx]->BatchSize() < requests_[template_idx]->BatchSize()) {
+      template_idx = idx;
+    }
+  }
+  const size_t template_batch_size = requests_[template_idx]->BatchSize();
+  const size_t padding = *it - batch_size;
+  if ((template_batch_size == 0) || ((padding % template_batch_size) != 0)) {
+    return;
+  }
+
+  const size_t null_count = padding / template_batch_size;
+  requests_.reserve(requests_.size() + null_count);
+  for (size_t idx = 0; idx < null_count; ++idx) {
+    requests_.emplace_back(
+        InferenceRequest::CopyAsNull(*requests_[template_idx]));
+  }
+}
+
+bool
+Payload::RejectCancelledRequests()
+{
+  if (instance_->Model()->Config().has_sequence_batching()) {
+    return true;
+  }
+
+  static const Status cancelled_status(
+      Status::Code::UNAVAILABLE, "Request cancelled");
+  auto keep = requests_.begin();
+  for (auto it = requests_.begin(); it != requests_.end(); ++it) {
+    if ((*it)->IsCancelled()) {
+      InferenceRequest::RespondIfError(
+          *it, cancelled_status, true /* release_requests */);
+    } else {
+      if (keep != it) {
+        *keep = std::move(*it);
+      }
+      ++keep;
+    }
+  }
+  requests_.erase(keep, requests_.end());
+  return !requests_.empty();
+}
+
+void
+Payload::Prepare()
+{
+  if (op_type_ == Operation::INFER_RUN) {
+    // Padding again in Execute() is a no-op
+    if (RejectCancelledRequests()) {
+      PadBatch();
+      instance_->Prefetch(requests_);
+    }
+  }
+}
+
 void
 Payload::Execute(bool* should_exit)
 {
@@ -199,6 +301,13 @@ Payload::Execute(bool* should_exit)
   Status status;
   switch (op_type_) {
     case Operation::INFER_RUN:
+      // The requests may be cancelled while the payload waits for an
+      // instance, whichever scheduler queued it.
+      if (!RejectCancelledRequests()) {
+        OnCallback_();
+        break;
+      }
+      PadBatch();
       instance_->Schedule(std::move(requests_), OnCallback_);
       break;
     case Operation::INIT:
@@ -211,7 +320,27 @@ Payload::Execute(bool* should_exit)
       *should_exit = true;
   }
 
-  status_->set_value(status);
+  if (status_ != nullptr) {
+    status_->set_value(status);
+  }
+}
+
+void
+Payload::ExecuteAsync(std::function<void()>&& OnComplete)
+{
+  if (!RejectCancelledRequests()) {
+    OnCallback_();
+    OnComplete();
+    return;
+  }
+  PadBatch();
+  std::function<void()> on_callback = OnCallback_;
+  std::function<void()> on_complete = std::move(OnComplete);
+  instance_->ScheduleAsync(
+      std::move(requests_), [on_callback, on_complete]() {
+        on_callback();
+        on_complete();
+      });
 }
 
 }}  // namespace triton::core
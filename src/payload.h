@@ -30,6 +30,7 @@
 #include <memory>
 #include <mutex>
 #include <queue>
+#include <set>
 #include <vector>
 
 #include "backend_model_instance.h"
@@ -58,6 +59,10 @@ class Payload {
   std::mutex* GetExecMutex() { return exec_mu_.get(); }
   size_t RequestCount() { return requests_.size(); }
   size_t BatchSize();
+  // Return the highest priority, i.e. the smallest non-zero priority
+  // value, of the requests in the payload. Return the maximum value if
+  // none of the requests has a priority.
+  uint64_t Priority();
   void ReserveRequests(size_t size);
   void AddRequest(std::unique_ptr<InferenceRequest> request);
   std::vector<std::unique_ptr<InferenceRequest>>& Requests()
@@ -73,6 +78,13 @@ class Payload {
   TritonModelInstance* GetInstance() { return instance_; }
   void MarkSaturated();
   bool IsSaturated() { return saturated_; }
+  // Set the batch sizes that the payload is padded to when executed, or
+  // nullptr to execute the payload without padding.
+  void SetPaddedBatchSizes(
+      const std::shared_ptr<const std::set<int32_t>>& batch_sizes)
+  {
+    padded_batch_sizes_ = batch_sizes;
+  }
   RequiredEqualInputs* MutableRequiredEqualInputs()
   {
     return &required_equal_inputs_;
@@ -81,11 +93,28 @@ class Payload {
 
   State GetState() { return state_; }
   void SetState(State state);
+  // Do the part of the execution that doesn't need the instance to be
+  // idle, so that it can overlap with the execution of the previous
+  // payload of the instance.
+  void Prepare();
   void Execute(bool* should_exit);
+  // Start the execution of an INFER_RUN payload on a backend that
+  // executes asynchronously. 'OnComplete' is called after the callback
+  // of the payload once the backend completes the execution.
+  void ExecuteAsync(std::function<void()>&& OnComplete);
   Status Wait();
   void Release();
 
  private:
+  // Pad the requests with null requests up to the smallest batch size in
+  // 'padded_batch_sizes_' that fits.
+  void PadBatch();
+  // Complete the cancelled requests with an error instead of executing
+  // them. Return false if no request is left to execute. The requests of
+  // a sequence batched model are always executed, dropping one would
+  // leave its sequence without the controls of the request.
+  bool RejectCancelledRequests();
+
   Operation op_type_;
   std::vector<std::unique_ptr<InferenceRequest>> requests_;
   std::function<void()> OnCallback_;
@@ -99,6 +128,10 @@ class Payload {
 
   bool saturated_;
 
+  // The batch sizes that the payload is padded to, nullptr if padding is
+  // disabled.
+  std::shared_ptr<const std::set<int32_t>> padded_batch_sizes_;
+
   // Pointer for use with user-supplied batching strategy.
   void* user_pointer_ = nullptr;
 };
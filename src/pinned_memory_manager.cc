@@ -27,10 +27,15 @@
 
 #include "pinned_memory_manager.h"
 
+#include <algorithm>
 #include <sstream>
 #include "numa_utils.h"
 #include "triton/common/logging.h"
 
+#ifdef TRITON_ENABLE_METRICS
+#include "metrics.h"
+#endif  // TRITON_ENABLE_METRICS
+
 #ifdef TRITON_ENABLE_GPU
 #include <cuda_runtime_api.h>
 #endif  // TRITON_ENABLE_GPU
@@ -47,32 +52,43 @@ PointerToString(void* ptr)
   return ss.str();
 }
 
-Status
-ParseIntOption(const std::string& msg, const std::string& arg, int* value)
+// The part of a pinned memory pool that is served by the slab allocator,
+// a quarter of the pool rounded down to whole slabs.
+uint64_t
+SlabRegionByteSize(uint64_t pool_byte_size)
 {
-  try {
-    *value = std::stoi(arg);
-  }
-  catch (const std::invalid_argument& ia) {
-    return Status(
-        Status::Code::INVALID_ARG,
-        msg + ": Can't parse '" + arg + "' to integer");
-  }
-  return Status::Success;
+  const uint64_t region_byte_size = pool_byte_size / 4;
+  return region_byte_size - (region_byte_size % SlabAllocator::kSlabByteSize);
 }
 
+// The room reserved in an added segment for the bookkeeping of the
+// memory managed by boost.
+constexpr uint64_t kSegmentOverheadByteSize = 64 << 10;
+
 }  // namespace
 
 std::unique_ptr<PinnedMemoryManager> PinnedMemoryManager::instance_;
 uint64_t PinnedMemoryManager::pinned_memory_byte_size_;
 
 PinnedMemoryManager::PinnedMemory::PinnedMemory(
-    void* pinned_memory_buffer, uint64_t size)
-    : pinned_memory_buffer_(pinned_memory_buffer)
+    void* pinned_memory_buffer, uint64_t size, NodePool* node_pool,
+    bool enable_slab)
+    : pinned_memory_buffer_(pinned_memory_buffer),
+      byte_size_((pinned_memory_buffer != nullptr) ? size : 0),
+      node_pool_(node_pool), allocation_count_(0)
 {
   if (pinned_memory_buffer_ != nullptr) {
+    // The slab region is at the start of the pool, ahead of the memory
+    // managed by boost.
+    const uint64_t slab_byte_size = enable_slab ? SlabRegionByteSize(size) : 0;
+    if (slab_byte_size != 0) {
+      slab_allocator_.reset(
+          new SlabAllocator(pinned_memory_buffer_, slab_byte_size));
+    }
     managed_pinned_memory_ = boost::interprocess::managed_external_buffer(
-        boost::interprocess::create_only_t{}, pinned_memory_buffer_, size);
+        boost::interprocess::create_only_t{},
+        static_cast<char*>(pinned_memory_buffer_) + slab_byte_size,
+        size - slab_byte_size);
   }
 }
 
@@ -86,8 +102,72 @@ PinnedMemoryManager::PinnedMemory::~PinnedMemory()
 #endif  // TRITON_ENABLE_GPU
 }
 
+void*
+PinnedMemoryManager::PinnedMemory::Allocate(uint64_t size)
+{
+  if (pinned_memory_buffer_ == nullptr) {
+    return nullptr;
+  }
+
+  void* ptr = managed_pinned_memory_.allocate(size, std::nothrow_t{});
+  if (ptr != nullptr) {
+    ++allocation_count_;
+  }
+  return ptr;
+}
+
+void
+PinnedMemoryManager::PinnedMemory::Deallocate(void* ptr)
+{
+  managed_pinned_memory_.deallocate(ptr);
+  if (--allocation_count_ == 0) {
+    idle_since_ = std::chrono::steady_clock::now();
+  }
+}
+
+uint64_t
+PinnedMemoryManager::PinnedMemory::LargestFreeByteSize()
+{
+  if (pinned_memory_buffer_ == nullptr) {
+    return 0;
+  }
+
+  // boost doesn't expose its free blocks, so find the largest size that
+  // can be allocated by bisection.
+  uint64_t lower = 0;
+  uint64_t upper = managed_pinned_memory_.get_free_memory();
+  while (lower < upper) {
+    const uint64_t size = lower + ((upper - lower + 1) / 2);
+    void* ptr = managed_pinned_memory_.allocate(size, std::nothrow_t{});
+    if (ptr != nullptr) {
+      managed_pinned_memory_.deallocate(ptr);
+      lower = size;
+    } else {
+      upper = size - 1;
+    }
+  }
+  return lower;
+}
+
+PinnedMemoryManager::PinnedMemoryManager(const Options& options)
+    : pool_byte_size_(options.pinned_memory_pool_byte_size_),
+      max_pool_byte_size_(std::max(
+          options.pinned_memory_pool_max_byte_size_,
+          options.pinned_memory_pool_byte_size_)),
+      growth_byte_size_(options.pinned_memory_pool_growth_byte_size_),
+      idle_timeout_(options.pinned_memory_pool_idle_timeout_ms_),
+      info_mtx_("PinnedMemoryManager::info_mtx_")
+{
+}
+
 PinnedMemoryManager::~PinnedMemoryManager()
 {
+#ifdef TRITON_ENABLE_METRICS
+  if (has_collect_callback_) {
+    Metrics::RemoveCollectCallback(collect_callback_id_);
+  }
+#endif  // TRITON_ENABLE_METRICS
+
   // Clean up
   for (const auto& memory_info : memory_info_) {
     const auto& is_pinned = memory_info.second.first;
@@ -98,34 +178,249 @@ PinnedMemoryManager::~PinnedMemoryManager()
 }
 
 void
-PinnedMemoryManager::AddPinnedMemoryBuffer(
-    const std::shared_ptr<PinnedMemory>& pinned_memory_buffer,
-    unsigned long node_mask)
+PinnedMemoryManager::AddNodePool(
+    void* buffer, unsigned long node_mask,
+    const triton::common::HostPolicyCmdlineConfig& host_policy)
 {
-  pinned_memory_buffers_[node_mask] = pinned_memory_buffer;
+  std::unique_ptr<NodePool> node_pool(new NodePool(node_mask, host_policy));
+  node_pool->pool_.reset(
+      new PinnedMemory(buffer, pool_byte_size_, node_pool.get()));
+  node_pool->byte_size_ = node_pool->pool_->byte_size_;
+#ifdef TRITON_ENABLE_METRICS
+  if (Metrics::Enabled()) {
+    const std::map<std::string, std::string> labels{
+        {"numa_node_mask", std::to_string(node_mask)}};
+    node_pool->fallback_count_ =
+        &Metrics::FamilyPinnedMemoryFallbackCount().Add(labels);
+    node_pool->fallback_bytes_ =
+        &Metrics::FamilyPinnedMemoryFallbackBytes().Add(labels);
+    node_pool->allocation_count_ =
+        &Metrics::FamilyPinnedMemoryAllocationCount().Add(labels);
+    node_pool->pool_bytes_ =
+        &Metrics::FamilyPinnedMemoryPoolBytes().Add(labels);
+    node_pool->pool_bytes_->Set(node_pool->byte_size_);
+    node_pool->used_bytes_ =
+        &Metrics::FamilyPinnedMemoryPoolUsedBytes().Add(labels);
+    node_pool->free_bytes_ =
+        &Metrics::FamilyPinnedMemoryPoolFreeBytes().Add(labels);
+    node_pool->largest_free_bytes_ =
+        &Metrics::FamilyPinnedMemoryPoolLargestFreeBytes().Add(labels);
+  }
+#endif  // TRITON_ENABLE_METRICS
+  pinned_memory_buffers_[node_mask] = std::move(node_pool);
+}
+
+#ifdef TRITON_ENABLE_METRICS
+void
+PinnedMemoryManager::CollectMetrics()
+{
+  for (const auto& it : pinned_memory_buffers_) {
+    NodePool* node_pool = it.second.get();
+    if (node_pool->used_bytes_ == nullptr) {
+      continue;
+    }
+
+    // The blocks of the slab region count as used once their slab is
+    // carved, whether or not they are handed out.
+    uint64_t byte_size = 0;
+    uint64_t free_byte_size = 0;
+    uint64_t largest_free_byte_size = 0;
+    const auto& slab_allocator = node_pool->pool_->slab_allocator_;
+    if (slab_allocator != nullptr) {
+      byte_size += slab_allocator->ByteSize();
+      free_byte_size += slab_allocator->UncarvedByteSize();
+    }
+    std::lock_guard<std::mutex> lk(node_pool->segments_mtx_);
+    std::vector<PinnedMemory*> segments{node_pool->pool_.get()};
+    for (const auto& segment : node_pool->segments_) {
+      segments.push_back(segment.get());
+    }
+    for (PinnedMemory* segment : segments) {
+      if (segment->pinned_memory_buffer_ == nullptr) {
+        continue;
+      }
+      std::lock_guard<std::mutex> buffer_lk(segment->buffer_mtx_);
+      byte_size += segment->managed_pinned_memory_.get_size();
+      free_byte_size += segment->managed_pinned_memory_.get_free_memory();
+      largest_free_byte_size =
+          std::max(largest_free_byte_size, segment->LargestFreeByteSize());
+    }
+    node_pool->used_bytes_->Set(byte_size - free_byte_size);
+    node_pool->free_bytes_->Set(free_byte_size);
+    node_pool->largest_free_bytes_->Set(largest_free_byte_size);
+  }
+}
+#endif  // TRITON_ENABLE_METRICS
+
+Status
+PinnedMemoryManager::AllocSegment(
+    void** ptr, uint64_t size, NodePool* node_pool, PinnedMemory** segment)
+{
+  PinnedMemory* pool = node_pool->pool_.get();
+  {
+    std::lock_guard<std::mutex> lk(pool->buffer_mtx_);
+    *ptr = pool->Allocate(size);
+  }
+  if (*ptr != nullptr) {
+    *segment = pool;
+    return Status::Success;
+  }
+  if (max_pool_byte_size_ <= pool_byte_size_) {
+    return Status(
+        Status::Code::INTERNAL,
+        (pool->pinned_memory_buffer_ == nullptr)
+            ? "failed to allocate pinned system memory: no pinned memory pool"
+            : "failed to allocate pinned system memory");
+  }
+
+  std::lock_guard<std::mutex> lk(node_pool->segments_mtx_);
+  for (auto& candidate : node_pool->segments_) {
+    std::lock_guard<std::mutex> buffer_lk(candidate->buffer_mtx_);
+    *ptr = candidate->Allocate(size);
+    if (*ptr != nullptr) {
+      *segment = candidate.get();
+      return Status::Success;
+    }
+  }
+
+  // Grow the pool by a segment that fits at least the allocation
+  const uint64_t segment_byte_size =
+      std::max(growth_byte_size_, size + kSegmentOverheadByteSize);
+  if ((node_pool->byte_size_ + segment_byte_size) > max_pool_byte_size_) {
+    return Status(
+        Status::Code::INTERNAL,
+        "failed to allocate pinned system memory: pinned memory pool "
+        "reached its maximum byte size " +
+            std::to_string(max_pool_byte_size_));
+  }
+
+  void* buffer = nullptr;
+#ifdef TRITON_ENABLE_GPU
+  // The segment must be on the node of the pool, which the calling
+  // thread may not be bound to.
+  bool set_policy = false;
+  if (!node_pool->host_policy_.empty()) {
+    unsigned long node_mask;
+    if ((!GetNumaMemoryPolicyNodeMask(&node_mask).IsOk()) ||
+        (node_mask != node_pool->node_mask_)) {
+      RETURN_IF_ERROR(SetNumaMemoryPolicy(node_pool->host_policy_));
+      set_policy = true;
+    }
+  }
+  auto err = cudaHostAlloc(&buffer, segment_byte_size, cudaHostAllocPortable);
+  if (set_policy) {
+    ResetNumaMemoryPolicy();
+  }
+  if (err != cudaSuccess) {
+    return Status(
+        Status::Code::INTERNAL, "failed to grow pinned memory pool: " +
+                                    std::string(cudaGetErrorString(err)));
+  }
+#endif  // TRITON_ENABLE_GPU
+  if (buffer == nullptr) {
+    return Status(
+        Status::Code::INTERNAL, "failed to allocate pinned system memory");
+  }
+
+  std::unique_ptr<PinnedMemory> added;
+  try {
+    added.reset(new PinnedMemory(
+        buffer, segment_byte_size, node_pool, false /* enable_slab */));
+  }
+  catch (const std::exception& ex) {
+#ifdef TRITON_ENABLE_GPU
+    cudaFreeHost(buffer);
+#endif  // TRITON_ENABLE_GPU
+    return Status(
+        Status::Code::INTERNAL,
+        "failed to grow pinned memory pool: " + std::string(ex.what()));
+  }
+  {
+    std::lock_guard<std::mutex> buffer_lk(added->buffer_mtx_);
+    *ptr = added->Allocate(size);
+  }
+  if (*ptr == nullptr) {
+    return Status(
+        Status::Code::INTERNAL, "failed to allocate pinned system memory");
+  }
+
+  node_pool->byte_size_ += segment_byte_size;
+  LOG_VERBOSE(1) << "pinned memory pool of NUMA node mask "
+                 << node_pool->node_mask_ << " grown by " << segment_byte_size
+                 << " to " << node_pool->byte_size_;
+  *segment = added.get();
+  node_pool->segments_.emplace_back(std::move(added));
+  node_pool->segment_count_.store(node_pool->segments_.size());
+#ifdef TRITON_ENABLE_METRICS
+  if (node_pool->pool_bytes_ != nullptr) {
+    node_pool->pool_bytes_->Set(node_pool->byte_size_);
+  }
+#endif  // TRITON_ENABLE_METRICS
+  return Status::Success;
+}
+
+void
+PinnedMemoryManager::ReleaseIdleSegments(NodePool* node_pool)
+{
+  const auto now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lk(node_pool->segments_mtx_);
+  auto& segments = node_pool->segments_;
+  for (auto it = segments.begin(); it != segments.end();) {
+    bool idle;
+    {
+      std::lock_guard<std::mutex> buffer_lk((*it)->buffer_mtx_);
+      idle = ((*it)->allocation_count_ == 0) &&
+             ((now - (*it)->idle_since_) >= idle_timeout_);
+    }
+    if (idle) {
+      node_pool->byte_size_ -= (*it)->byte_size_;
+      LOG_VERBOSE(1) << "pinned memory pool of NUMA node mask "
+                     << node_pool->node_mask_ << " shrunk by "
+                     << (*it)->byte_size_ << " to " << node_pool->byte_size_;
+      it = segments.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  node_pool->segment_count_.store(segments.size());
+#ifdef TRITON_ENABLE_METRICS
+  if (node_pool->pool_bytes_ != nullptr) {
+    node_pool->pool_bytes_->Set(node_pool->byte_size_);
+  }
+#endif  // TRITON_ENABLE_METRICS
 }
 
 Status
 PinnedMemoryManager::AllocInternal(
     void** ptr, uint64_t size, TRITONSERVER_MemoryType* allocated_type,
-    bool allow_nonpinned_fallback, PinnedMemory* pinned_memory_buffer)
+    bool allow_nonpinned_fallback, NodePool* node_pool)
 {
-  auto status = Status::Success;
-  if (pinned_memory_buffer->pinned_memory_buffer_ != nullptr) {
-    std::lock_guard<std::mutex> lk(pinned_memory_buffer->buffer_mtx_);
-    *ptr = pinned_memory_buffer->managed_pinned_memory_.allocate(
-        size, std::nothrow_t{});
-    *allocated_type = TRITONSERVER_MEMORY_CPU_PINNED;
-    if (*ptr == nullptr) {
-      status = Status(
-          Status::Code::INTERNAL, "failed to allocate pinned system memory");
+  // Blocks of the slab allocator are identified by their address so they
+  // are not tracked in 'memory_info_'.
+  PinnedMemory* pinned_memory_buffer = node_pool->pool_.get();
+  if (pinned_memory_buffer->slab_allocator_ != nullptr) {
+    *ptr = pinned_memory_buffer->slab_allocator_->Allocate(size);
+    if (*ptr != nullptr) {
+      *allocated_type = TRITONSERVER_MEMORY_CPU_PINNED;
+#ifdef TRITON_ENABLE_METRICS
+      if (node_pool->allocation_count_ != nullptr) {
+        node_pool->allocation_count_->Increment();
+      }
+#endif  // TRITON_ENABLE_METRICS
+      LOG_VERBOSE(1) << "pinned memory slab allocation: "
+                     << "size " << size << ", addr " << *ptr;
+      return Status::Success;
     }
-  } else {
-    status = Status(
-        Status::Code::INTERNAL,
-        "failed to allocate pinned system memory: no pinned memory pool");
   }
 
+  auto status = AllocSegment(ptr, size, node_pool, &pinned_memory_buffer);
+  *allocated_type = TRITONSERVER_MEMORY_CPU_PINNED;
+#ifdef TRITON_ENABLE_METRICS
+  if (status.IsOk() && (node_pool->allocation_count_ != nullptr)) {
+    node_pool->allocation_count_->Increment();
+  }
+#endif  // TRITON_ENABLE_METRICS
+
   bool is_pinned = true;
   if ((!status.IsOk()) && allow_nonpinned_fallback) {
     static bool warning_logged = false;
@@ -143,12 +438,18 @@ PinnedMemoryManager::AllocInternal(
           "failed to allocate non-pinned system memory");
     } else {
       status = Status::Success;
+#ifdef TRITON_ENABLE_METRICS
+      if (node_pool->fallback_count_ != nullptr) {
+        node_pool->fallback_count_->Increment();
+        node_pool->fallback_bytes_->Increment(size);
+      }
+#endif  // TRITON_ENABLE_METRICS
     }
   }
 
   // keep track of allocated buffer or clean up
   {
-    std::lock_guard<std::mutex> lk(info_mtx_);
+    std::lock_guard<InstrumentedMutex> lk(info_mtx_);
     if (status.IsOk()) {
       auto res = memory_info_.emplace(
           *ptr, std::make_pair(is_pinned, pinned_memory_buffer));
@@ -167,7 +468,7 @@ PinnedMemoryManager::AllocInternal(
   if ((!status.IsOk()) && (*ptr != nullptr)) {
     if (is_pinned) {
       std::lock_guard<std::mutex> lk(pinned_memory_buffer->buffer_mtx_);
-      pinned_memory_buffer->managed_pinned_memory_.deallocate(*ptr);
+      pinned_memory_buffer->Deallocate(*ptr);
     } else {
       free(*ptr);
     }
@@ -179,10 +480,18 @@ PinnedMemoryManager::AllocInternal(
 Status
 PinnedMemoryManager::FreeInternal(void* ptr)
 {
+  for (const auto& it : pinned_memory_buffers_) {
+    const auto& slab_allocator = it.second->pool_->slab_allocator_;
+    if ((slab_allocator != nullptr) && slab_allocator->Deallocate(ptr)) {
+      LOG_VERBOSE(1) << "pinned memory slab deallocation: " << "addr " << ptr;
+      return Status::Success;
+    }
+  }
+
   bool is_pinned = true;
   PinnedMemory* pinned_memory_buffer = nullptr;
   {
-    std::lock_guard<std::mutex> lk(info_mtx_);
+    std::lock_guard<InstrumentedMutex> lk(info_mtx_);
     auto it = memory_info_.find(ptr);
     if (it != memory_info_.end()) {
       is_pinned = it->second.first;
@@ -200,8 +509,15 @@ PinnedMemoryManager::FreeInternal(void* ptr)
   }
 
   if (is_pinned) {
-    std::lock_guard<std::mutex> lk(pinned_memory_buffer->buffer_mtx_);
-    pinned_memory_buffer->managed_pinned_memory_.deallocate(ptr);
+    // The segment may be released once the lock is dropped
+    NodePool* node_pool = pinned_memory_buffer->node_pool_;
+    {
+      std::lock_guard<std::mutex> lk(pinned_memory_buffer->buffer_mtx_);
+      pinned_memory_buffer->Deallocate(ptr);
+    }
+    if (node_pool->segment_count_.load() != 0) {
+      ReleaseIdleSegments(node_pool);
+    }
   } else {
     free(ptr);
   }
@@ -225,7 +541,7 @@ PinnedMemoryManager::Create(const Options& options)
     return Status::Success;
   }
 
-  instance_.reset(new PinnedMemoryManager());
+  instance_.reset(new PinnedMemoryManager(options));
   if (options.host_policy_map_.empty()) {
     void* buffer = nullptr;
 #ifdef TRITON_ENABLE_GPU
@@ -245,10 +561,7 @@ PinnedMemoryManager::Create(const Options& options)
     }
 #endif  // TRITON_ENABLE_GPU
     try {
-      instance_->AddPinnedMemoryBuffer(
-          std::shared_ptr<PinnedMemory>(
-              new PinnedMemory(buffer, options.pinned_memory_pool_byte_size_)),
-          0);
+      instance_->AddNodePool(buffer, 0, {});
     }
     catch (const std::exception& ex) {
       return Status(
@@ -260,13 +573,16 @@ PinnedMemoryManager::Create(const Options& options)
     // and all associated devices should request memory from the shared manager
     std::map<int32_t, std::string> numa_map;
     for (const auto& host_policy : options.host_policy_map_) {
-      const auto numa_it = host_policy.second.find("numa-node");
-      if (numa_it != host_policy.second.end()) {
-        int32_t numa_id;
-        if (ParseIntOption("Parsing NUMA node", numa_it->second, &numa_id)
-                .IsOk()) {
-          numa_map.emplace(numa_id, host_policy.first);
-        }
+      // Resolved as for the threads of the policy, so that "auto" binds
+      // the pool to the node of the policy's CPUs.
+      int numa_id = -1;
+      auto status = GetNumaNodeOfHostPolicy(host_policy.second, &numa_id);
+      if (!status.IsOk()) {
+        LOG_WARNING << "Unable to bind the pinned memory pool to the NUMA "
+                       "node of host policy '"
+                    << host_policy.first << "': " << status.AsString();
+      } else if (numa_id >= 0) {
+        numa_map.emplace(numa_id, host_policy.first);
       }
     }
     for (const auto& node_policy : numa_map) {
@@ -304,10 +620,8 @@ PinnedMemoryManager::Create(const Options& options)
 #endif  // TRITON_ENABLE_GPU
       ResetNumaMemoryPolicy();
       try {
-        instance_->AddPinnedMemoryBuffer(
-            std::shared_ptr<PinnedMemory>(new PinnedMemory(
-                buffer, options.pinned_memory_pool_byte_size_)),
-            node_mask);
+        instance_->AddNodePool(
+            buffer, node_mask, options.host_policy_map_.at(node_policy.second));
       }
       catch (const std::exception& ex) {
         return Status(
@@ -320,10 +634,7 @@ PinnedMemoryManager::Create(const Options& options)
     // will be on normal system memory
     if (instance_->pinned_memory_buffers_.empty()) {
       try {
-        instance_->AddPinnedMemoryBuffer(
-            std::shared_ptr<PinnedMemory>(new PinnedMemory(
-                nullptr, options.pinned_memory_pool_byte_size_)),
-            0);
+        instance_->AddNodePool(nullptr, 0, {});
       }
       catch (const std::exception& ex) {
         return Status(
@@ -333,7 +644,21 @@ PinnedMemoryManager::Create(const Options& options)
       }
     }
   }
+  if (instance_->max_pool_byte_size_ > instance_->pool_byte_size_) {
+    LOG_INFO << "Pinned memory pool may grow up to "
+             << instance_->max_pool_byte_size_ << " per NUMA node";
+  }
   pinned_memory_byte_size_ = options.pinned_memory_pool_byte_size_;
+#ifdef TRITON_ENABLE_METRICS
+  // The node pools are only added above, so the callback doesn't race
+  // with their creation.
+  if (Metrics::Enabled()) {
+    PinnedMemoryManager* manager = instance_.get();
+    manager->collect_callback_id_ =
+        Metrics::AddCollectCallback([manager]() { manager->CollectMetrics(); });
+    manager->has_collect_callback_ = true;
+  }
+#endif  // TRITON_ENABLE_METRICS
   return Status::Success;
 }
 
@@ -347,21 +672,19 @@ PinnedMemoryManager::Alloc(
         Status::Code::UNAVAILABLE, "PinnedMemoryManager has not been created");
   }
 
-  auto pinned_memory_buffer =
-      instance_->pinned_memory_buffers_.begin()->second.get();
+  auto node_pool = instance_->pinned_memory_buffers_.begin()->second.get();
   if (instance_->pinned_memory_buffers_.size() > 1) {
     unsigned long node_mask;
     if (GetNumaMemoryPolicyNodeMask(&node_mask).IsOk()) {
       auto it = instance_->pinned_memory_buffers_.find(node_mask);
       if (it != instance_->pinned_memory_buffers_.end()) {
-        pinned_memory_buffer = it->second.get();
+        node_pool = it->second.get();
       }
     }
   }
 
   return instance_->AllocInternal(
-      ptr, size, allocated_type, allow_nonpinned_fallback,
-      pinned_memory_buffer);
+      ptr, size, allocated_type, allow_nonpinned_fallback, node_pool);
 }
 
 Status
@@ -26,13 +26,23 @@
 //
 #pragma once
 
+#include <atomic>
 #include <boost/interprocess/managed_external_buffer.hpp>
+#include <chrono>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <vector>
+#include "instrumented_mutex.h"
+#include "slab_allocator.h"
 #include "status.h"
 #include "triton/common/model_config.h"
 
+#ifdef TRITON_ENABLE_METRICS
+#include "prometheus/counter.h"
+#include "prometheus/gauge.h"
+#endif  // TRITON_ENABLE_METRICS
+
 namespace triton { namespace core {
 
 // This is a singleton class responsible for maintaining pinned memory pool
@@ -45,11 +55,22 @@ class PinnedMemoryManager {
     Options(
         uint64_t b = 0,
         const triton::common::HostPolicyCmdlineConfigMap& host_policy_map = {})
-        : pinned_memory_pool_byte_size_(b), host_policy_map_(host_policy_map)
+        : pinned_memory_pool_byte_size_(b),
+          pinned_memory_pool_max_byte_size_(0),
+          pinned_memory_pool_growth_byte_size_(64 << 20),
+          pinned_memory_pool_idle_timeout_ms_(30000),
+          host_policy_map_(host_policy_map)
     {
     }
 
     uint64_t pinned_memory_pool_byte_size_;
+    // The byte size up to which the pool of each NUMA node may grow. The
+    // pool doesn't grow if this isn't larger than the pool byte size.
+    uint64_t pinned_memory_pool_max_byte_size_;
+    // The byte size of the segments added to a pool while it grows
+    uint64_t pinned_memory_pool_growth_byte_size_;
+    // How long an added segment stays unused before it is released
+    uint64_t pinned_memory_pool_idle_timeout_ms_;
     triton::common::HostPolicyCmdlineConfigMap host_policy_map_;
   };
 
@@ -77,31 +98,116 @@ class PinnedMemoryManager {
   static Status Free(void* ptr);
 
  private:
+  class NodePool;
+
+  // A pinned memory segment. Small allocations are served by the slab
+  // allocator, if the segment has one, without locking or tracking while
+  // it has free blocks of their size class. The rest of the segment is
+  // managed by 'managed_pinned_memory_'.
   class PinnedMemory {
    public:
-    PinnedMemory(void* pinned_memory_buffer, uint64_t size);
+    PinnedMemory(
+        void* pinned_memory_buffer, uint64_t size, NodePool* node_pool,
+        bool enable_slab = true);
     ~PinnedMemory();
+
+    // Allocate / deallocate from 'managed_pinned_memory_', 'buffer_mtx_'
+    // must be held.
+    void* Allocate(uint64_t size);
+    void Deallocate(void* ptr);
+    // Return the byte size of the largest allocation that
+    // 'managed_pinned_memory_' can serve, 'buffer_mtx_' must be held.
+    uint64_t LargestFreeByteSize();
+
     void* pinned_memory_buffer_;
+    const uint64_t byte_size_;
+    NodePool* const node_pool_;
+    std::unique_ptr<SlabAllocator> slab_allocator_;
     std::mutex buffer_mtx_;
     boost::interprocess::managed_external_buffer managed_pinned_memory_;
+    // The number of outstanding allocations from 'managed_pinned_memory_'
+    // and the time it last dropped to zero.
+    size_t allocation_count_;
+    std::chrono::steady_clock::time_point idle_since_;
+  };
+
+  // The pinned memory of a NUMA node. The pool created at startup is
+  // extended by the segments in 'segments_' while it is exhausted, and
+  // segments that stay unused are released again.
+  class NodePool {
+   public:
+    NodePool(
+        unsigned long node_mask,
+        const triton::common::HostPolicyCmdlineConfig& host_policy)
+        : node_mask_(node_mask), host_policy_(host_policy),
+          segment_count_(0), byte_size_(0)
+    {
+    }
+
+    const unsigned long node_mask_;
+    // The policy to allocate memory on the node, empty if none is needed
+    const triton::common::HostPolicyCmdlineConfig host_policy_;
+    std::unique_ptr<PinnedMemory> pool_;
+
+    // Guards 'segments_' and 'byte_size_'. Must be acquired before the
+    // 'buffer_mtx_' of any segment.
+    std::mutex segments_mtx_;
+    std::vector<std::unique_ptr<PinnedMemory>> segments_;
+    // The size of 'segments_', read without holding 'segments_mtx_'
+    std::atomic<size_t> segment_count_;
+    // The pinned byte size of the pool and its segments
+    uint64_t byte_size_;
+
+#ifdef TRITON_ENABLE_METRICS
+    prometheus::Counter* fallback_count_ = nullptr;
+    prometheus::Counter* fallback_bytes_ = nullptr;
+    prometheus::Counter* allocation_count_ = nullptr;
+    prometheus::Gauge* pool_bytes_ = nullptr;
+    prometheus::Gauge* used_bytes_ = nullptr;
+    prometheus::Gauge* free_bytes_ = nullptr;
+    prometheus::Gauge* largest_free_bytes_ = nullptr;
+#endif  // TRITON_ENABLE_METRICS
   };
 
-  PinnedMemoryManager() = default;
+  PinnedMemoryManager(const Options& options);
 
   Status AllocInternal(
       void** ptr, uint64_t size, TRITONSERVER_MemoryType* allocated_type,
-      bool allow_nonpinned_fallback, PinnedMemory* pinned_memory_buffer);
+      bool allow_nonpinned_fallback, NodePool* node_pool);
   Status FreeInternal(void* ptr);
-  void AddPinnedMemoryBuffer(
-      const std::shared_ptr<PinnedMemory>& pinned_memory_buffer,
-      unsigned long node_mask);
+  // Allocate from the segments of 'node_pool', adding a segment if none
+  // has room and the pool may still grow. Return the segment allocated
+  // from in 'segment'.
+  Status AllocSegment(
+      void** ptr, uint64_t size, NodePool* node_pool, PinnedMemory** segment);
+  // Release the segments of 'node_pool' that have been unused for longer
+  // than the idle timeout.
+  void ReleaseIdleSegments(NodePool* node_pool);
+  void AddNodePool(
+      void* buffer, unsigned long node_mask,
+      const triton::common::HostPolicyCmdlineConfig& host_policy);
+#ifdef TRITON_ENABLE_METRICS
+  // Update the usage metrics of the node pools, called when the metrics
+  // are collected.
+  void CollectMetrics();
+#endif  // TRITON_ENABLE_METRICS
 
   static std::unique_ptr<PinnedMemoryManager> instance_;
   static uint64_t pinned_memory_byte_size_;
 
-  std::mutex info_mtx_;
+  const uint64_t pool_byte_size_;
+  const uint64_t max_pool_byte_size_;
+  const uint64_t growth_byte_size_;
+  const std::chrono::milliseconds idle_timeout_;
+
+  InstrumentedMutex info_mtx_;
   std::map<void*, std::pair<bool, PinnedMemory*>> memory_info_;
-  std::map<unsigned long, std::shared_ptr<PinnedMemory>> pinned_memory_buffers_;
+  std::map<unsigned long, std::unique_ptr<NodePool>> pinned_memory_buffers_;
+
+#ifdef TRITON_ENABLE_METRICS
+  bool has_collect_callback_ = false;
+  uint64_t collect_callback_id_ = 0;
+#endif  // TRITON_ENABLE_METRICS
 };
 
 }}  // namespace triton::core
@@ -0,0 +1,94 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <string>
+
+#ifdef TRITON_ENABLE_NVTX
+#include <nvtx3/nvToolsExt.h>
+#endif  // TRITON_ENABLE_NVTX
+
+#ifdef TRITON_ENABLE_USDT
+#include <sys/sdt.h>
+#endif  // TRITON_ENABLE_USDT
+
+namespace triton { namespace core {
+
+// Are the profiling ranges emitted? Enabled by default. Can be changed
+// at any time, a range that is open when profiling is disabled is still
+// closed.
+bool ProfilingEnabled();
+void SetProfilingEnabled(bool enabled);
+
+#if defined(TRITON_ENABLE_NVTX) || defined(TRITON_ENABLE_USDT)
+//
+// Marks a stage of the request lifecycle for the lifetime of the
+// object, as an NVTX range and as a pair of 'triton:range_begin' and
+// 'triton:range_end' USDT probes, for whichever is enabled in the
+// build. Nothing is emitted while profiling is disabled.
+//
+class ProfileRange {
+ public:
+  explicit ProfileRange(const char* label) : active_(ProfilingEnabled())
+  {
+    if (active_) {
+#ifdef TRITON_ENABLE_NVTX
+      nvtxRangePushA(label);
+#endif  // TRITON_ENABLE_NVTX
+#ifdef TRITON_ENABLE_USDT
+      DTRACE_PROBE1(triton, range_begin, label);
+#endif  // TRITON_ENABLE_USDT
+    }
+  }
+  explicit ProfileRange(const std::string& label) : ProfileRange(label.c_str())
+  {
+  }
+
+  ProfileRange(const ProfileRange&) = delete;
+  ProfileRange& operator=(const ProfileRange&) = delete;
+
+  ~ProfileRange()
+  {
+    if (active_) {
+#ifdef TRITON_ENABLE_USDT
+      DTRACE_PROBE(triton, range_end);
+#endif  // TRITON_ENABLE_USDT
+#ifdef TRITON_ENABLE_NVTX
+      nvtxRangePop();
+#endif  // TRITON_ENABLE_NVTX
+    }
+  }
+
+ private:
+  const bool active_;
+};
+
+#define PROFILE_RANGE(V, LABEL) triton::core::ProfileRange V(LABEL)
+#else
+#define PROFILE_RANGE(V, LABEL)
+#endif  // TRITON_ENABLE_NVTX || TRITON_ENABLE_USDT
+
+}}  // namespace triton::core
@@ -26,12 +26,63 @@
 
 #include "rate_limiter.h"
 
+#include <algorithm>
+#include <chrono>
 #include <limits>
+#include <set>
+#include "clock.h"
+#include "cuda_utils.h"
+#include "model_config_utils.h"
+#include "numa_utils.h"
+#include "profiling.h"
 #include "triton/common/logging.h"
 
 namespace triton { namespace core {
 
 constexpr size_t MAX_PAYLOAD_BUCKET_COUNT = 1000;
+// Number of payloads moved at once from the return ring to the payload
+// cache of a thread.
+constexpr size_t PAYLOAD_CACHE_REFILL_COUNT = 16;
+
+// Number of staged instances that can be handed to the allocating thread
+// without taking a lock.
+constexpr size_t STAGING_RING_CAPACITY = 1024;
+// Number of recent execution times the straggler threshold is computed
+// from, the minimum number required before detecting stragglers and the
+// number recorded between updates of the threshold.
+constexpr size_t STRAGGLER_WINDOW_SIZE = 256;
+constexpr size_t STRAGGLER_MIN_SAMPLES = 32;
+constexpr size_t STRAGGLER_UPDATE_INTERVAL = 16;
+// Interval at which waiting instances check for stragglers.
+constexpr uint64_t STRAGGLER_CHECK_INTERVAL_US = 1000;
+
+namespace {
+
+// Identifies the rate limiter owning the payload cache of a thread, ids
+// are never reused so a new rate limiter can't adopt the cache of a
+// destroyed one at the same address.
+std::atomic<uint64_t> next_rate_limiter_id(1);
+
+// Released payloads kept by a thread for the rate limiter 'owner_id_'.
+// They count in the pooled payloads of the owner, 'owner_count_' outlives
+// the owner so that the payloads dropped with the cache are uncounted.
+struct PayloadCache {
+  ~PayloadCache() { Drop(); }
+
+  void Drop()
+  {
+    if (owner_count_ != nullptr) {
+      owner_count_->fetch_sub(payloads_.size());
+    }
+    payloads_.clear();
+  }
+
+  uint64_t owner_id_ = 0;
+  std::shared_ptr<std::atomic<size_t>> owner_count_;
+  std::vector<std::shared_ptr<Payload>> payloads_;
+};
+
+}  // namespace
 
 //=========================================================================
 //  Core Implementation
@@ -39,12 +90,12 @@ constexpr size_t MAX_PAYLOAD_BUCKET_COUNT = 1000;
 
 Status
 RateLimiter::Create(
-    const bool ignore_resources_and_priority,
+    const bool ignore_resources_and_priority, const bool enforce_time_budget,
     const RateLimiter::ResourceMap& resource_map,
     std::unique_ptr<RateLimiter>* rate_limiter)
 {
-  std::unique_ptr<RateLimiter> local_rate_limiter(
-      new RateLimiter(ignore_resources_and_priority, resource_map));
+  std::unique_ptr<RateLimiter> local_rate_limiter(new RateLimiter(
+      ignore_resources_and_priority, enforce_time_budget, resource_map));
   *rate_limiter = std::move(local_rate_limiter);
 
   return Status::Success;
@@ -55,6 +106,16 @@ RateLimiter::RegisterModelInstance(
     TritonModelInstance* triton_model_instance,
     const RateLimiterConfig& rate_limiter_config)
 {
+  // Execution is gated on device memory if the model provides an estimate
+  // of the memory used per batch item.
+  int64_t memory_per_batch_item = 0;
+  if (!ignore_resources_and_priority_) {
+    RETURN_IF_ERROR(GetInt64ModelParameter(
+        triton_model_instance->Model()->Config(),
+        "TRITON_RATE_LIMITER_MEMORY_BYTES_PER_BATCH_ITEM",
+        0 /* default_value */, &memory_per_batch_item));
+  }
+
   {
     std::lock_guard<std::mutex> lk1(model_ctx_mtx_);
     std::lock_guard<std::mutex> lk2(model_instance_ctx_mtx_);
@@ -69,6 +130,9 @@ RateLimiter::RegisterModelInstance(
             triton_model_instance, &model_context, rate_limiter_config,
             [this](ModelInstanceContext* instance) { OnStage(instance); },
             [this](ModelInstanceContext* instance) { OnRelease(instance); })));
+
+    pair_it.first->second->SetMemoryPerBatchItem(
+        std::max((int64_t)0, memory_per_batch_item));
     model_context.AddAvailableInstance(pair_it.first->second.get());
     model_context.AddSpecificRequestQueue(pair_it.first->second.get());
 
@@ -85,6 +149,27 @@ RateLimiter::RegisterModelInstance(
         return status;
       }
     }
+
+    if (enforce_time_budget_) {
+      // The budget is shared by all instances of the model, a model
+      // without a budget is not limited.
+      int64_t budget_us = 0;
+      RETURN_IF_ERROR(GetInt64ModelParameter(
+          triton_model_instance->Model()->Config(),
+          "TRITON_RATE_LIMITER_GPU_TIME_BUDGET_US", 0 /* default_value */,
+          &budget_us));
+      if (budget_us < 0) {
+        return Status(
+            Status::Code::INVALID_ARG,
+            "TRITON_RATE_LIMITER_GPU_TIME_BUDGET_US must not be negative for "
+            "model " +
+                triton_model_instance->Model()->Name());
+      }
+      if (budget_us > 0) {
+        resource_manager_->SetTimeBudget(
+            triton_model_instance->Model(), budget_us * 1000);
+      }
+    }
   }
 
   InitializePayloadQueues(triton_model_instance);
@@ -108,6 +193,7 @@ RateLimiter::UnregisterModelInstance(TritonModelInstance* triton_model_instance)
       resource_manager_->RemoveModelInstance(i_it->second.get());
     }
     model_context.RemoveInstance(i_it->second.get());
+    RemoveStagedInstances({i_it->second.get()});
     model_instances.erase(i_it);
   }
 
@@ -125,6 +211,11 @@ RateLimiter::UnregisterModelInstance(TritonModelInstance* triton_model_instance)
       if (s_it != p_it->second->specific_queues_.end()) {
         p_it->second->specific_queues_.erase(s_it);
       }
+      std::lock_guard<std::mutex> lk(p_it->second->mu_);
+      p_it->second->exec_start_ns_.erase(triton_model_instance);
+      SetNumaIdle(p_it->second.get(), {triton_model_instance}, false);
+      p_it->second->instance_numa_nodes_.erase(triton_model_instance);
+      UpdateNumaRouting(p_it->second.get());
     }
   }
 
@@ -141,16 +232,23 @@ RateLimiter::UnregisterModel(const TritonModel* model)
     auto& model_context = model_contexts_[model];
 
     model_context.RequestRemoval();
+    std::vector<const ModelInstanceContext*> instances;
     for (const auto& instance : model_instance_ctxs_[model]) {
       if (!ignore_resources_and_priority_) {
         resource_manager_->RemoveModelInstance(instance.second.get());
       }
+      instances.push_back(instance.second.get());
     }
+    RemoveStagedInstances(instances);
 
     model_instance_ctxs_.erase(model);
     model_contexts_.erase(model);
   }
 
+  if (enforce_time_budget_) {
+    resource_manager_->RemoveTimeBudget(model);
+  }
+
   if (!ignore_resources_and_priority_) {
     RETURN_IF_ERROR(resource_manager_->UpdateResourceLimits());
   }
@@ -186,6 +284,8 @@ Status
 RateLimiter::EnqueuePayload(
     const TritonModel* model, std::shared_ptr<Payload> payload)
 {
+  PROFILE_RANGE(range, "RateLimiter Enqueue");
+
   auto pinstance = payload->GetInstance();
   PayloadQueue* payload_queue = nullptr;
   {
@@ -195,10 +295,26 @@ RateLimiter::EnqueuePayload(
     }
     payload_queue = payload_queues_[model].get();
   }
+  // Only looked up before taking the lock, the routing is rechecked
+  // under it.
+  const int numa_node =
+      (ignore_resources_and_priority_ && (pinstance == nullptr) &&
+       payload_queue->numa_routing_)
+          ? PayloadNumaNode(payload)
+          : -1;
   {
     std::lock_guard<std::mutex> lk(payload_queue->mu_);
     payload->SetState(Payload::State::REQUESTED);
     if (ignore_resources_and_priority_) {
+      if ((numa_node >= 0) && payload_queue->numa_routing_) {
+        auto it = payload_queue->idle_numa_instances_.find(numa_node);
+        if ((it != payload_queue->idle_numa_instances_.end()) &&
+            !it->second.empty()) {
+          pinstance = it->second.back();
+          it->second.pop_back();
+          payload->SetInstance(pinstance);
+        }
+      }
       SchedulePayload(pinstance, payload_queue, payload);
     }
   }
@@ -223,7 +339,9 @@ RateLimiter::EnqueuePayload(
         payload_queue->cv_.notify_all();
       }
     };
-    DeferPayloadSchedule(sched_func, model, payload->GetInstance());
+    DeferPayloadSchedule(
+        sched_func, payload->BatchSize(), payload->Priority(), model,
+        payload->GetInstance());
   }
   return Status::Success;
 }
@@ -233,6 +351,8 @@ RateLimiter::DequeuePayload(
     std::deque<TritonModelInstance*>& instances,
     std::shared_ptr<Payload>* payload)
 {
+  PROFILE_RANGE(range, "RateLimiter Dequeue");
+
   payload->reset();
   PayloadQueue* payload_queue = nullptr;
   {
@@ -244,9 +364,15 @@ RateLimiter::DequeuePayload(
   }
   std::vector<std::shared_ptr<Payload>> merged_payloads;
   size_t instance_index = std::numeric_limits<std::size_t>::max();
+  InstanceQueue* victim = nullptr;
   {
     std::unique_lock<std::mutex> lk(payload_queue->mu_);
-    payload_queue->cv_.wait(lk, [&instances, &instance_index, payload_queue]() {
+    const bool detect_stragglers = (payload_queue->straggler_percentile_ > 0);
+    if (detect_stragglers) {
+      RecordExecutionTimes(payload_queue, instances);
+    }
+    auto ready = [this, &instances, &instance_index, &victim, payload_queue,
+                  detect_stragglers]() {
       bool empty = payload_queue->queue_->Empty();
       if (empty) {
         instance_index = 0;
@@ -259,22 +385,62 @@ RateLimiter::DequeuePayload(
           }
         }
       }
+      if (empty && detect_stragglers) {
+        victim = FindStragglerQueue(payload_queue, instances, &instance_index);
+        empty = (victim == nullptr);
+      }
       return !empty;
-    });
-    if (instance_index < instances.size()) {
+    };
+    if (payload_queue->numa_routing_) {
+      SetNumaIdle(payload_queue, instances, true);
+    }
+    if (detect_stragglers) {
+      // A busy instance becomes a straggler without any notification, so
+      // while payloads wait on busy instances the waiting instances wake
+      // up periodically to look for one. Otherwise there is nothing to
+      // take over until a payload is enqueued, which notifies them.
+      while (!ready()) {
+        if (PayloadsWaitOnBusyInstances(payload_queue)) {
+          payload_queue->cv_.wait_for(
+              lk, std::chrono::microseconds(STRAGGLER_CHECK_INTERVAL_US));
+        } else {
+          payload_queue->cv_.wait(lk);
+        }
+      }
+    } else {
+      payload_queue->cv_.wait(lk, ready);
+    }
+    if (payload_queue->numa_routing_) {
+      SetNumaIdle(payload_queue, instances, false);
+    }
+    TritonModelInstance* executing_instance = instances.front();
+    if (victim != nullptr) {
+      // The payload of the straggler is executed by the idle instance
+      // instead of the instance it was scheduled on.
+      victim->Steal(payload);
+      executing_instance = instances[instance_index];
+      (*payload)->SetInstance(executing_instance);
+    } else if (instance_index < instances.size()) {
       TritonModelInstance* instance = instances[instance_index];
       if (!payload_queue->specific_queues_[instance]->Empty()) {
         payload_queue->specific_queues_[instance]->Dequeue(
             payload, &merged_payloads);
       }
+      executing_instance = instance;
     } else {
       payload_queue->queue_->Dequeue(payload, &merged_payloads);
     }
+    if (detect_stragglers &&
+        ((*payload)->GetOpType() == Payload::Operation::INFER_RUN)) {
+      payload_queue->exec_start_ns_[executing_instance] = SteadyClockNs();
+    }
   }
   for (auto& merge_payload : merged_payloads) {
     PayloadRelease(merge_payload);
   }
   (*payload)->Callback();
+  // A payload taken from a straggler already has the idle instance set,
+  // the instance is removed from the idle instances below.
   if ((*payload)->GetInstance() == nullptr) {
     (*payload)->SetInstance(instances.front());
     instances.pop_front();
@@ -290,7 +456,29 @@ RateLimiter::GetPayload(
   std::shared_ptr<Payload> payload;
 
   if (max_payload_bucket_count_ > 0) {
-    std::lock_guard<std::mutex> lock(payload_mu_);
+    // Each thread keeps a few released payloads so that most payloads are
+    // acquired without a lock. The cache belongs to the rate limiter the
+    // thread last acquired payloads from, it is dropped when the thread
+    // moves to another one so the payloads stay within the bound of
+    // their rate limiter.
+    thread_local PayloadCache payload_cache;
+    if (payload_cache.owner_id_ != id_) {
+      payload_cache.Drop();
+      payload_cache.owner_id_ = id_;
+      payload_cache.owner_count_ = pooled_payload_count_;
+    }
+    if (payload_cache.payloads_.empty()) {
+      RefillPayloadCache(&payload_cache.payloads_);
+    }
+    if (!payload_cache.payloads_.empty()) {
+      payload = std::move(payload_cache.payloads_.back());
+      payload_cache.payloads_.pop_back();
+      pooled_payload_count_->fetch_sub(1);
+    }
+  }
+
+  if ((payload.get() == nullptr) && (max_payload_bucket_count_ > 0)) {
+    std::lock_guard<InstrumentedMutex> lock(payload_mu_);
 
     if (!payload_bucket_.empty()) {
       payload = payload_bucket_.back();
@@ -304,6 +492,9 @@ RateLimiter::GetPayload(
         payloads_in_use_.pop_front();
       }
     }
+    if (payload.get() != nullptr) {
+      pooled_payload_count_->fetch_sub(1);
+    }
   }
 
   if (payload.get() == nullptr) {
@@ -332,30 +523,147 @@ RateLimiter::PayloadRelease(std::shared_ptr<Payload>& payload)
 
   payload->OnRelease();
   if (max_payload_bucket_count_ > 0) {
-    std::lock_guard<std::mutex> lock(payload_mu_);
-
-    if (payloads_in_use_.size() + payload_bucket_.size() <
-        max_payload_bucket_count_) {
-      // Release iff the payload shared_ptr is uniquely held.
-      if (payload.use_count() == 1) {
-        payload->Release();
-        payload_bucket_.push_back(std::move(payload));
+    // The payloads in the ring, the thread caches, the bucket and in use
+    // all count toward the bound.
+    if (pooled_payload_count_->fetch_add(1) >= max_payload_bucket_count_) {
+      pooled_payload_count_->fetch_sub(1);
+      return;
+    }
+
+    // Release iff the payload shared_ptr is uniquely held. A released
+    // payload is returned through the ring without taking the lock if
+    // the ring has room.
+    if (payload.use_count() == 1) {
+      payload->Release();
+      if (payload_return_ring_.TryPush(payload)) {
         return;
-      } else {
-        payloads_in_use_.push_back(std::move(payload));
       }
+      std::lock_guard<InstrumentedMutex> lock(payload_mu_);
+      payload_bucket_.push_back(std::move(payload));
+    } else {
+      std::lock_guard<InstrumentedMutex> lock(payload_mu_);
+      payloads_in_use_.push_back(std::move(payload));
     }
   }
 }
 
 RateLimiter::RateLimiter(
-    const bool ignore_resources_and_priority, const ResourceMap& resource_map)
+    const bool ignore_resources_and_priority, const bool enforce_time_budget,
+    const ResourceMap& resource_map)
     : ignore_resources_and_priority_(ignore_resources_and_priority),
+      enforce_time_budget_(
+          enforce_time_budget && !ignore_resources_and_priority),
+      staging_ring_(STAGING_RING_CAPACITY), allocation_requests_(0),
+      payload_mu_("RateLimiter::payload_mu_"),
+      payload_return_ring_(MAX_PAYLOAD_BUCKET_COUNT),
+      id_(next_rate_limiter_id.fetch_add(1)),
+      pooled_payload_count_(std::make_shared<std::atomic<size_t>>(0)),
       max_payload_bucket_count_(MAX_PAYLOAD_BUCKET_COUNT)
 {
   ResourceManager::Create(resource_map, &resource_manager_);
 }
 
+InstanceQueue*
+RateLimiter::FindStragglerQueue(
+    PayloadQueue* payload_queue,
+    const std::deque<TritonModelInstance*>& instances, size_t* instance_index)
+{
+  if (payload_queue->straggler_threshold_ns_ == 0) {
+    return nullptr;
+  }
+  const uint64_t now_ns = SteadyClockNs();
+  for (const auto& busy : payload_queue->exec_start_ns_) {
+    if ((now_ns - busy.second) <= payload_queue->straggler_threshold_ns_) {
+      continue;
+    }
+    auto it = payload_queue->specific_queues_.find(busy.first);
+    if ((it == payload_queue->specific_queues_.end()) ||
+        !it->second->Stealable()) {
+      continue;
+    }
+    // The payload may move to another device, a slow device is a common
+    // reason for the instance to straggle.
+    for (size_t idx = 0; idx < instances.size(); ++idx) {
+      if (instances[idx]->Kind() == busy.first->Kind()) {
+        *instance_index = idx;
+        return it->second.get();
+      }
+    }
+  }
+  return nullptr;
+}
+
+bool
+RateLimiter::PayloadsWaitOnBusyInstances(PayloadQueue* payload_queue)
+{
+  for (const auto& busy : payload_queue->exec_start_ns_) {
+    auto it = payload_queue->specific_queues_.find(busy.first);
+    if ((it != payload_queue->specific_queues_.end()) &&
+        it->second->Stealable()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void
+RateLimiter::RecordExecutionTimes(
+    PayloadQueue* payload_queue,
+    const std::deque<TritonModelInstance*>& instances)
+{
+  const uint64_t now_ns = SteadyClockNs();
+  size_t recorded = 0;
+  for (const auto instance : instances) {
+    auto it = payload_queue->exec_start_ns_.find(instance);
+    if (it == payload_queue->exec_start_ns_.end()) {
+      continue;
+    }
+    auto& durations = payload_queue->exec_durations_ns_;
+    if (durations.size() < STRAGGLER_WINDOW_SIZE) {
+      durations.push_back(now_ns - it->second);
+    } else {
+      durations[payload_queue->next_exec_duration_idx_] = now_ns - it->second;
+      payload_queue->next_exec_duration_idx_ =
+          (payload_queue->next_exec_duration_idx_ + 1) % STRAGGLER_WINDOW_SIZE;
+    }
+    payload_queue->exec_start_ns_.erase(it);
+    recorded++;
+  }
+
+  // Recompute the threshold every few executions instead of on each one.
+  payload_queue->exec_durations_since_update_ += recorded;
+  const auto& durations = payload_queue->exec_durations_ns_;
+  if ((recorded == 0) || (durations.size() < STRAGGLER_MIN_SAMPLES) ||
+      ((payload_queue->exec_durations_since_update_ <
+        STRAGGLER_UPDATE_INTERVAL) &&
+       (payload_queue->straggler_threshold_ns_ != 0))) {
+    return;
+  }
+  payload_queue->exec_durations_since_update_ = 0;
+  std::vector<uint64_t> sorted(durations);
+  auto nth = sorted.begin() +
+             ((sorted.size() - 1) * payload_queue->straggler_percentile_) / 100;
+  std::nth_element(sorted.begin(), nth, sorted.end());
+  payload_queue->straggler_threshold_ns_ = *nth;
+}
+
+void
+RateLimiter::RefillPayloadCache(
+    std::vector<std::shared_ptr<Payload>>* payload_cache)
+{
+  // The ring has a single consumer, a thread that finds another thread
+  // refilling falls back to the payload bucket.
+  std::unique_lock<std::mutex> lk(payload_return_mu_, std::try_to_lock);
+  if (!lk.owns_lock()) {
+    return;
+  }
+  std::shared_ptr<Payload> payload;
+  while ((payload_cache->size() < PAYLOAD_CACHE_REFILL_COUNT) &&
+         payload_return_ring_.TryPop(&payload)) {
+    payload_cache->emplace_back(std::move(payload));
+  }
+}
+
 void
 RateLimiter::InitializePayloadQueues(const TritonModelInstance* instance)
 {
@@ -379,10 +687,52 @@ RateLimiter::InitializePayloadQueues(const TritonModelInstance* instance)
   {
     std::lock_guard<std::mutex> lk(payload_queues_mu_);
     if (payload_queues_.find(instance->Model()) == payload_queues_.end()) {
-      payload_queues_.emplace(
+      // When an instance frees up the payloads waiting for it can be
+      // merged into one execution. The payloads of the sequence batcher
+      // hold the batch slots of the sequences so they are not merged.
+      bool merge_ready_payloads = false;
+      auto status = GetBoolModelParameter(
+          config, "TRITON_INSTANCE_QUEUE_MERGE_READY_PAYLOADS",
+          false /* default_value */, &merge_ready_payloads);
+      if (!status.IsOk()) {
+        LOG_WARNING << "Failed to read payload merging parameter of model "
+                    << config.name() << ": " << status.Message();
+        merge_ready_payloads = false;
+      }
+      merge_ready_payloads &= !config.has_sequence_batching();
+      auto pr = payload_queues_.emplace(
           instance->Model(),
           new PayloadQueue(
-              config.max_batch_size(), max_queue_delay_microseconds * 1000));
+              config.max_batch_size(), max_queue_delay_microseconds * 1000,
+              merge_ready_payloads));
+      // With straggler detection the payloads waiting on an instance
+      // whose execution takes longer than the given percentile of the
+      // recent execution times are moved to idle instances. This is not
+      // a hedge, the payload the straggler executes is not duplicated.
+      int64_t straggler_percentile = 0;
+      status = GetInt64ModelParameter(
+          config, "TRITON_RATE_LIMITER_STRAGGLER_PERCENTILE",
+          0 /* default_value */, &straggler_percentile);
+      if (!status.IsOk() || (straggler_percentile < 0) ||
+          (straggler_percentile > 100)) {
+        LOG_WARNING << "Invalid straggler percentile for model "
+                    << config.name() << ", straggler detection is disabled";
+        straggler_percentile = 0;
+      }
+      if ((straggler_percentile > 0) &&
+          (!ignore_resources_and_priority_ || config.has_sequence_batching())) {
+        LOG_WARNING << "Straggler detection is not supported with rate "
+                       "limiting or sequence batching, disabling for model "
+                    << config.name();
+        straggler_percentile = 0;
+      }
+      if (straggler_percentile > 0) {
+        LOG_INFO << "Straggler detection for model " << config.name()
+                 << " moves the payloads waiting on a straggling instance "
+                    "to idle instances, the payloads waiting in the shared "
+                    "queue and the executing payloads are not moved";
+      }
+      pr.first->second->straggler_percentile_ = straggler_percentile;
     }
     payload_queue = payload_queues_[instance->Model()].get();
   }
@@ -391,13 +741,32 @@ RateLimiter::InitializePayloadQueues(const TritonModelInstance* instance)
     payload_queue->specific_queues_.emplace(
         instance,
         new InstanceQueue(
-            config.max_batch_size(), max_queue_delay_microseconds * 1000));
+            config.max_batch_size(), max_queue_delay_microseconds * 1000,
+            payload_queue->merge_ready_payloads_));
+  }
+
+  // Payloads are only routed by NUMA node if the instances pick their
+  // payloads themselves, with rate limiting the resources decide.
+  int numa_node = -1;
+  if (ignore_resources_and_priority_) {
+    auto status = GetNumaNodeOfHostPolicy(instance->HostPolicy(), &numa_node);
+    if (!status.IsOk()) {
+      LOG_WARNING << "Failed to find the NUMA node of instance "
+                  << instance->Name() << ": " << status.Message();
+      numa_node = -1;
+    }
+  }
+  if (numa_node >= 0) {
+    std::lock_guard<std::mutex> lk(payload_queue->mu_);
+    payload_queue->instance_numa_nodes_[instance] = numa_node;
+    UpdateNumaRouting(payload_queue);
   }
 }
 
 Status
 RateLimiter::DeferPayloadSchedule(
-    const StandardScheduleFunc& OnSchedule, const TritonModel* model,
+    const StandardScheduleFunc& OnSchedule, const size_t batch_size,
+    const uint64_t priority, const TritonModel* model,
     TritonModelInstance* triton_model_instance)
 {
   std::lock_guard<std::mutex> lk(model_ctx_mtx_);
@@ -416,12 +785,72 @@ RateLimiter::DeferPayloadSchedule(
         "removed");
   }
 
-  itr->second.EnqueueModelInstanceRequest(OnSchedule, triton_model_instance);
+  itr->second.EnqueueModelInstanceRequest(
+      ScheduleRequest{OnSchedule, batch_size, priority},
+      triton_model_instance);
   itr->second.StageInstanceIfAvailable(triton_model_instance);
 
   return Status::Success;
 }
 
+int
+RateLimiter::PayloadNumaNode(const std::shared_ptr<Payload>& payload)
+{
+  auto& requests = payload->Requests();
+  if (!requests.empty()) {
+    for (const auto& input : requests.front()->ImmutableInputs()) {
+      const void* base;
+      size_t byte_size;
+      TRITONSERVER_MemoryType memory_type = TRITONSERVER_MEMORY_CPU;
+      int64_t memory_type_id = 0;
+      if (!input.second->DataBuffer(
+                0, &base, &byte_size, &memory_type, &memory_type_id)
+               .IsOk() ||
+          (base == nullptr) || (byte_size == 0) ||
+          (memory_type == TRITONSERVER_MEMORY_GPU)) {
+        continue;
+      }
+      const int numa_node = NumaNodeOfAddress(base);
+      if (numa_node >= 0) {
+        return numa_node;
+      }
+    }
+  }
+  return NumaNodeOfCurrentThread();
+}
+
+void
+RateLimiter::UpdateNumaRouting(PayloadQueue* payload_queue)
+{
+  std::set<int> nodes;
+  for (const auto& instance_node : payload_queue->instance_numa_nodes_) {
+    nodes.insert(instance_node.second);
+  }
+  payload_queue->numa_routing_ = (nodes.size() > 1);
+}
+
+void
+RateLimiter::SetNumaIdle(
+    PayloadQueue* payload_queue,
+    const std::deque<TritonModelInstance*>& instances, const bool idle)
+{
+  for (const auto instance : instances) {
+    auto node_it = payload_queue->instance_numa_nodes_.find(instance);
+    if (node_it == payload_queue->instance_numa_nodes_.end()) {
+      continue;
+    }
+    auto& idle_instances =
+        payload_queue->idle_numa_instances_[node_it->second];
+    auto it =
+        std::find(idle_instances.begin(), idle_instances.end(), instance);
+    if (idle && (it == idle_instances.end())) {
+      idle_instances.push_back(instance);
+    } else if (!idle && (it != idle_instances.end())) {
+      idle_instances.erase(it);
+    }
+  }
+}
+
 void
 RateLimiter::SchedulePayload(
     TritonModelInstance* tmi, PayloadQueue* payload_queue,
@@ -438,9 +867,11 @@ RateLimiter::SchedulePayload(
 void
 RateLimiter::OnStage(ModelInstanceContext* instance)
 {
-  {
-    std::lock_guard<std::recursive_mutex> lk(staged_instances_mtx_);
-    staged_instances_.push(instance);
+  // The staged instance is handed to whichever thread is allocating, the
+  // lock is only taken if the ring is full.
+  if (!staging_ring_.TryPush(instance)) {
+    std::lock_guard<std::mutex> lk(staging_overflow_mtx_);
+    staging_overflow_.push_back(instance);
   }
   AttemptAllocation();
 }
@@ -463,14 +894,77 @@ RateLimiter::OnRelease(ModelInstanceContext* instance)
 void
 RateLimiter::AttemptAllocation()
 {
-  std::lock_guard<std::recursive_mutex> lk(staged_instances_mtx_);
-  if (!staged_instances_.empty()) {
-    ModelInstanceContext* instance = staged_instances_.top();
-    if (resource_manager_->AllocateResources(instance)) {
+  // Only one thread allocates at a time. A thread that finds another
+  // thread allocating records its attempt and returns, the allocating
+  // thread makes another pass for every attempt recorded meanwhile. So
+  // 'staged_instances_' is only accessed by the allocating thread.
+  size_t attempts = allocation_requests_.fetch_add(1);
+  if (attempts != 0) {
+    return;
+  }
+  attempts = 1;
+  do {
+    std::lock_guard<std::mutex> lk(allocation_mtx_);
+    CollectStagedInstances();
+
+    // The instances of the models over their time budget are held back
+    // until the next attempt, after the higher priority instances have
+    // been considered.
+    std::vector<ModelInstanceContext*> over_budget;
+    while (!staged_instances_.empty()) {
+      ModelInstanceContext* instance = staged_instances_.top();
+      if (enforce_time_budget_ &&
+          !resource_manager_->TimeBudgetAllows(instance)) {
+        staged_instances_.pop();
+        over_budget.push_back(instance);
+        continue;
+      }
+      if (!resource_manager_->AllocateResources(instance)) {
+        break;
+      }
       staged_instances_.pop();
       instance->Allocate();
     }
+    for (auto& instance : over_budget) {
+      staged_instances_.push(instance);
+    }
+    attempts = allocation_requests_.fetch_sub(attempts) - attempts;
+  } while (attempts != 0);
+}
+
+void
+RateLimiter::CollectStagedInstances()
+{
+  ModelInstanceContext* staged;
+  while (staging_ring_.TryPop(&staged)) {
+    staged_instances_.push(staged);
   }
+  std::lock_guard<std::mutex> lk(staging_overflow_mtx_);
+  for (auto& overflow : staging_overflow_) {
+    staged_instances_.push(overflow);
+  }
+  staging_overflow_.clear();
+}
+
+void
+RateLimiter::RemoveStagedInstances(
+    const std::vector<const ModelInstanceContext*>& instances)
+{
+  // The instances are staged while holding 'model_ctx_mtx_', so all
+  // stagings of 'instances' have already been passed to the allocating
+  // thread and are collected here.
+  std::lock_guard<std::mutex> lk(allocation_mtx_);
+  CollectStagedInstances();
+  PriorityQueue remaining;
+  while (!staged_instances_.empty()) {
+    ModelInstanceContext* instance = staged_instances_.top();
+    if (std::find(instances.begin(), instances.end(), instance) ==
+        instances.end()) {
+      remaining.push(instance);
+    }
+    staged_instances_.pop();
+  }
+  staged_instances_.swap(remaining);
 }
 
 //=========================================================================
@@ -479,17 +973,16 @@ RateLimiter::AttemptAllocation()
 
 Status
 RateLimiter::ModelContext::EnqueueModelInstanceRequest(
-    const StandardScheduleFunc& OnSchedule,
-    TritonModelInstance* triton_model_instance)
+    ScheduleRequest&& request, TritonModelInstance* triton_model_instance)
 {
-  std::lock_guard<std::recursive_mutex> lk(sched_request_queue_mtx_);
+  std::lock_guard<std::mutex> lk(mtx_);
 
   if (triton_model_instance == nullptr) {
-    generic_sched_request_queue_.push(OnSchedule);
+    PushRequest(&generic_sched_request_queue_, std::move(request));
   } else {
     auto it = specific_sched_request_queues_.find(triton_model_instance);
     if (it != specific_sched_request_queues_.end()) {
-      it->second.push(OnSchedule);
+      PushRequest(&it->second, std::move(request));
     } else {
       return Status(
           Status::Code::INTERNAL,
@@ -500,12 +993,26 @@ RateLimiter::ModelContext::EnqueueModelInstanceRequest(
   return Status::Success;
 }
 
+void
+RateLimiter::ModelContext::PushRequest(
+    ScheduleRequestQueue* queue, ScheduleRequest&& request)
+{
+  // Most requests share the same priority, so search from the back.
+  auto it = queue->end();
+  while ((it != queue->begin()) &&
+         (std::prev(it)->priority_ > request.priority_)) {
+    --it;
+  }
+  queue->insert(it, std::move(request));
+}
+
 void
 RateLimiter::ModelContext::AddAvailableInstance(ModelInstanceContext* instance)
 {
-  std::lock_guard<std::recursive_mutex> lk(avbl_instances_mtx_);
-  avbl_instances_.push(instance);
+  // Mark the instance available before it can be popped for staging.
   instance->MarkAvailable();
+  std::lock_guard<std::mutex> lk(mtx_);
+  avbl_instances_.push(instance);
 }
 
 
@@ -513,8 +1020,37 @@ void
 RateLimiter::ModelContext::StageInstanceIfAvailable(
     TritonModelInstance* req_instance)
 {
-  std::lock_guard<std::recursive_mutex> lk1(sched_request_queue_mtx_);
-  std::lock_guard<std::recursive_mutex> lk2(avbl_instances_mtx_);
+  // The instances are staged after releasing the lock, staging may
+  // allocate the instance and schedule the payload which must not be
+  // done while holding the lock.
+  std::vector<std::pair<ModelInstanceContext*, ScheduleRequest>> staging;
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    PopSchedulableInstances(req_instance, &staging);
+  }
+  for (auto& instance : staging) {
+    instance.first->Stage(std::move(instance.second));
+  }
+}
+
+void
+RateLimiter::ModelContext::AllocateInstanceIfAvailable()
+{
+  std::vector<std::pair<ModelInstanceContext*, ScheduleRequest>> allocating;
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    PopSchedulableInstances(nullptr /* req_instance */, &allocating);
+  }
+  for (auto& instance : allocating) {
+    instance.first->DirectAllocate(std::move(instance.second.OnSchedule_));
+  }
+}
+
+void
+RateLimiter::ModelContext::PopSchedulableInstances(
+    TritonModelInstance* req_instance,
+    std::vector<std::pair<ModelInstanceContext*, ScheduleRequest>>* instances)
+{
   PriorityQueue backup_queue;
 
   while (!avbl_instances_.empty()) {
@@ -527,55 +1063,19 @@ RateLimiter::ModelContext::StageInstanceIfAvailable(
       avbl_instances_.pop();
       continue;
     }
-    if (!specific_sched_request_queues_[instance->RawInstance()].empty()) {
+    auto& specific_queue =
+        specific_sched_request_queues_[instance->RawInstance()];
+    if (!specific_queue.empty()) {
       // Prioritize the specific requests for the available model
       // instance highest priority.
-      const StandardScheduleFunc func =
-          specific_sched_request_queues_[instance->RawInstance()].front();
-      specific_sched_request_queues_[instance->RawInstance()].pop();
-      instance->Stage(func);
+      instances->emplace_back(instance, std::move(specific_queue.front()));
+      specific_queue.pop_front();
     } else if (!generic_sched_request_queue_.empty()) {
       // If request is for generic model instance then use the
       // instance with the highest priority.
-      const StandardScheduleFunc func = generic_sched_request_queue_.front();
-      generic_sched_request_queue_.pop();
-      instance->Stage(func);
-    } else {
-      // If there are requests for a specific model instance then backup
-      // the model instance and keep searching through the available
-      // model instances. The prioritization will be taken care of in the
-      // staging priority queue.
-      backup_queue.push(instance);
-    }
-    avbl_instances_.pop();
-  }
-  // Restore the backup queue
-  if (!backup_queue.empty()) {
-    avbl_instances_.swap(backup_queue);
-  }
-}
-
-void
-RateLimiter::ModelContext::AllocateInstanceIfAvailable()
-{
-  std::lock_guard<std::recursive_mutex> lk1(sched_request_queue_mtx_);
-  std::lock_guard<std::recursive_mutex> lk2(avbl_instances_mtx_);
-  PriorityQueue backup_queue;
-  while (!avbl_instances_.empty()) {
-    ModelInstanceContext* instance = avbl_instances_.top();
-    if (!specific_sched_request_queues_[instance->RawInstance()].empty()) {
-      // Prioritize the specific requests for the available model
-      // instance highest priority.
-      const StandardScheduleFunc func =
-          specific_sched_request_queues_[instance->RawInstance()].front();
-      specific_sched_request_queues_[instance->RawInstance()].pop();
-      instance->DirectAllocate(func);
-    } else if (!generic_sched_request_queue_.empty()) {
-      // If request is for generic model instance then use the
-      // instance with the highest priority.
-      const StandardScheduleFunc func = generic_sched_request_queue_.front();
-      generic_sched_request_queue_.pop();
-      instance->DirectAllocate(func);
+      instances->emplace_back(
+          instance, std::move(generic_sched_request_queue_.front()));
+      generic_sched_request_queue_.pop_front();
     } else {
       // If there are requests for a specific model instance then backup
       // the model instance and keep searching through the available
@@ -595,7 +1095,7 @@ void
 RateLimiter::ModelContext::AddSpecificRequestQueue(
     ModelInstanceContext* instance)
 {
-  std::lock_guard<std::recursive_mutex> lk(sched_request_queue_mtx_);
+  std::lock_guard<std::mutex> lk(mtx_);
   specific_sched_request_queues_[instance->RawInstance()];
 }
 
@@ -603,7 +1103,7 @@ bool
 RateLimiter::ModelContext::ContainsPendingRequests(
     ModelInstanceContext* instance)
 {
-  std::lock_guard<std::recursive_mutex> lk(sched_request_queue_mtx_);
+  std::lock_guard<std::mutex> lk(mtx_);
   return (generic_sched_request_queue_.size() != 0) ||
          (specific_sched_request_queues_[instance->RawInstance()].size() != 0);
 }
@@ -611,8 +1111,7 @@ RateLimiter::ModelContext::ContainsPendingRequests(
 void
 RateLimiter::ModelContext::RemoveInstance(ModelInstanceContext* instance)
 {
-  std::lock_guard<std::recursive_mutex> lk1(sched_request_queue_mtx_);
-  std::lock_guard<std::recursive_mutex> lk2(avbl_instances_mtx_);
+  std::lock_guard<std::mutex> lk(mtx_);
 
   PriorityQueue new_avbl_instances;
   while (!avbl_instances_.empty()) {
@@ -641,32 +1140,33 @@ RateLimiter::ModelInstanceContext::ModelInstanceContext(
     : triton_model_instance_(triton_model_instance),
       model_context_(model_context), rate_limiter_config_(rate_limiter_config),
       OnStage_(OnStage), OnRelease_(OnRelease), exec_count_(0),
-      state_(AVAILABLE), removal_in_progress_(false)
+      state_(AVAILABLE), removal_in_progress_(false), staged_batch_size_(0),
+      staged_priority_(std::numeric_limits<uint64_t>::max()),
+      memory_per_batch_item_(0)
 {
 }
 
 void
 RateLimiter::ModelInstanceContext::MarkAvailable()
 {
-  std::lock_guard<std::mutex> lk(state_mtx_);
-  state_ = AVAILABLE;
+  staged_priority_ = std::numeric_limits<uint64_t>::max();
+  state_.store(AVAILABLE);
 }
 
 Status
-RateLimiter::ModelInstanceContext::Stage(StandardScheduleFunc OnSchedule)
+RateLimiter::ModelInstanceContext::Stage(ScheduleRequest&& request)
 {
-  {
-    std::lock_guard<std::mutex> lk(state_mtx_);
-
-    if (state_ != AVAILABLE) {
-      return Status(
-          Status::Code::INTERNAL,
-          "Can not stage a model instance that is not yet available");
-    }
-
-    state_ = STAGED;
-    OnSchedule_ = OnSchedule;
+  State expected = AVAILABLE;
+  if (!state_.compare_exchange_strong(expected, STAGED)) {
+    return Status(
+        Status::Code::INTERNAL,
+        "Can not stage a model instance that is not yet available");
   }
+  // Only the staging thread owns the instance until it is handed to
+  // OnStage_, which publishes 'OnSchedule_' to the allocating thread.
+  OnSchedule_ = std::move(request.OnSchedule_);
+  staged_batch_size_ = request.batch_size_;
+  staged_priority_ = request.priority_;
 
   OnStage_(this);
 
@@ -676,16 +1176,11 @@ RateLimiter::ModelInstanceContext::Stage(StandardScheduleFunc OnSchedule)
 Status
 RateLimiter::ModelInstanceContext::Allocate()
 {
-  {
-    std::lock_guard<std::mutex> lk(state_mtx_);
-
-    if (state_ != STAGED) {
-      return Status(
-          Status::Code::INTERNAL,
-          "Can not allocate a model instance that is not yet staged");
-    }
-
-    state_ = ALLOCATED;
+  State expected = STAGED;
+  if (!state_.compare_exchange_strong(expected, ALLOCATED)) {
+    return Status(
+        Status::Code::INTERNAL,
+        "Can not allocate a model instance that is not yet staged");
   }
 
   OnSchedule_(this);
@@ -697,16 +1192,11 @@ Status
 RateLimiter::ModelInstanceContext::DirectAllocate(
     StandardScheduleFunc OnSchedule)
 {
-  {
-    std::lock_guard<std::mutex> lk(state_mtx_);
-
-    if (state_ != AVAILABLE) {
-      return Status(
-          Status::Code::INTERNAL,
-          "Can not allocate a model instance that is not yet available");
-    }
-
-    state_ = ALLOCATED;
+  State expected = AVAILABLE;
+  if (!state_.compare_exchange_strong(expected, ALLOCATED)) {
+    return Status(
+        Status::Code::INTERNAL,
+        "Can not allocate a model instance that is not yet available");
   }
 
   OnSchedule(this);
@@ -734,14 +1224,12 @@ RateLimiter::ModelInstanceContext::ScaledPriority()
 
 void
 RateLimiter::ModelInstanceContext::RequestRemoval() {
-  std::unique_lock<std::mutex> lk(state_mtx_);
-  removal_in_progress_ = true;
+  removal_in_progress_.store(true);
 }
 
 bool
 RateLimiter::ModelInstanceContext::IsRemovalInProgress() {
-  std::unique_lock<std::mutex> lk(state_mtx_);
-  return removal_in_progress_;
+  return removal_in_progress_.load();
 }
 
 
@@ -771,8 +1259,10 @@ RateLimiter::ResourceManager::AddModelInstance(
       (pr.first->second[GLOBAL_RESOURCE_KEY])[resource.name()] =
           resource.count();
     } else {
-      (pr.first->second[instance->RawInstance()->DeviceId()])[resource.name()] =
-          resource.count();
+      // An instance spanning several devices needs the resource on each
+      for (const int32_t device_id : instance->RawInstance()->DeviceIds()) {
+        (pr.first->second[device_id])[resource.name()] = resource.count();
+      }
     }
   }
 }
@@ -935,6 +1425,9 @@ RateLimiter::ResourceManager::AllocateResources(
   if (itr == model_resources_.end()) {
     return false;
   } else {
+    if (!AllocateMemory(instance)) {
+      return false;
+    }
     // First pass to verify if resources are available
     {
       std::lock_guard<std::mutex> lk3(max_resources_mtx_);
@@ -954,6 +1447,7 @@ RateLimiter::ResourceManager::AllocateResources(
           }
           if ((allocated_ritr->second + ritr.second) >
               (max_resources_[ditr.first])[ritr.first]) {
+            ReleaseMemory(instance);
             return false;
           }
         }
@@ -968,6 +1462,17 @@ RateLimiter::ResourceManager::AllocateResources(
     }
   }
 
+  {
+    std::lock_guard<std::mutex> lk(time_budgets_mtx_);
+    if (!time_budgets_.empty()) {
+      allocation_start_ns_[instance] = SteadyClockNs();
+      for (const int32_t device_id : instance->RawInstance()->DeviceIds()) {
+        device_allocations_[std::make_pair(
+            instance->RawInstance()->Kind(), device_id)]++;
+      }
+    }
+  }
+
   return true;
 }
 
@@ -988,11 +1493,184 @@ RateLimiter::ResourceManager::ReleaseResources(
         (allocated_resources_[ditr.first])[ritr.first] -= ritr.second;
       }
     }
+    ReleaseMemory(instance);
+  }
+
+  {
+    std::lock_guard<std::mutex> lk(time_budgets_mtx_);
+    auto start_itr = allocation_start_ns_.find(instance);
+    if (start_itr != allocation_start_ns_.end()) {
+      const uint64_t now_ns = SteadyClockNs();
+      auto budget_itr = time_budgets_.find(instance->RawInstance()->Model());
+      if (budget_itr != time_budgets_.end()) {
+        budget_itr->second.available_ns_ -=
+            (now_ns > start_itr->second) ? (now_ns - start_itr->second) : 0;
+      }
+      allocation_start_ns_.erase(start_itr);
+      for (const int32_t device_id : instance->RawInstance()->DeviceIds()) {
+        auto device_itr = device_allocations_.find(
+            std::make_pair(instance->RawInstance()->Kind(), device_id));
+        if ((device_itr != device_allocations_.end()) &&
+            (device_itr->second > 0)) {
+          device_itr->second--;
+        }
+      }
+    }
   }
 
   return Status::Success;
 }
 
+size_t
+RateLimiter::ResourceManager::DeviceMemory(const int32_t device_id)
+{
+  auto ditr = device_memory_.find(device_id);
+  if (ditr == device_memory_.end()) {
+    size_t device_memory = 0;
+    for (const int key : {(int)device_id, (int)PER_DEVICE_RESOURCE_KEY}) {
+      auto eitr = explicit_max_resources_.find(key);
+      if (eitr != explicit_max_resources_.end()) {
+        auto ritr = eitr->second.find(DEVICE_MEMORY_RESOURCE);
+        if (ritr != eitr->second.end()) {
+          device_memory = ritr->second;
+          break;
+        }
+      }
+    }
+    if (device_memory == 0) {
+      size_t free_memory;
+      auto status =
+          GetDeviceMemoryInfo(device_id, &free_memory, &device_memory);
+      if (!status.IsOk()) {
+        LOG_WARNING << "Device memory is not limited for device " << device_id
+                    << ": " << status.Message();
+      }
+    }
+    ditr = device_memory_.emplace(device_id, device_memory).first;
+  }
+  return ditr->second;
+}
+
+bool
+RateLimiter::ResourceManager::AllocateMemory(
+    const ModelInstanceContext* instance)
+{
+  const TritonModelInstance* raw_instance = instance->RawInstance();
+  if ((instance->MemoryPerBatchItem() == 0) ||
+      (raw_instance->Kind() != TRITONSERVER_INSTANCEGROUPKIND_GPU)) {
+    return true;
+  }
+  const size_t required = instance->MemoryPerBatchItem() *
+                          std::max((size_t)1, instance->StagedBatchSize());
+
+  // The memory reported by the instances is held for their lifetime, the
+  // rest is shared by the executions. An execution is always allowed on an
+  // idle device so that an estimate larger than the device can't block it.
+  // An instance spanning several devices reserves the memory on each of
+  // them and must fit on all of them.
+  std::lock_guard<std::mutex> lk(memory_mtx_);
+  for (const int32_t device_id : raw_instance->DeviceIds()) {
+    const size_t device_memory = DeviceMemory(device_id);
+    const size_t reserved = reserved_memory_[device_id];
+    if ((device_memory == 0) || (reserved == 0)) {
+      continue;
+    }
+    size_t resident = 0;
+    for (const auto& mitr : model_resources_) {
+      const auto usage = mitr.first->RawInstance()->MemoryUsage();
+      auto uitr = usage.find(TRITONSERVER_MEMORY_GPU);
+      if (uitr != usage.end()) {
+        auto mid_itr = uitr->second.find(device_id);
+        if (mid_itr != uitr->second.end()) {
+          resident += mid_itr->second;
+        }
+      }
+    }
+    if ((resident + reserved + required) > device_memory) {
+      return false;
+    }
+  }
+  for (const int32_t device_id : raw_instance->DeviceIds()) {
+    reserved_memory_[device_id] += required;
+  }
+  instance_memory_[instance] = required;
+  return true;
+}
+
+void
+RateLimiter::ResourceManager::ReleaseMemory(
+    const ModelInstanceContext* instance)
+{
+  std::lock_guard<std::mutex> lk(memory_mtx_);
+  auto itr = instance_memory_.find(instance);
+  if (itr != instance_memory_.end()) {
+    for (const int32_t device_id : instance->RawInstance()->DeviceIds()) {
+      reserved_memory_[device_id] -= itr->second;
+    }
+    instance_memory_.erase(itr);
+  }
+}
+
+void
+RateLimiter::ResourceManager::SetTimeBudget(
+    const TritonModel* model, uint64_t budget_ns)
+{
+  std::lock_guard<std::mutex> lk(time_budgets_mtx_);
+  auto res = time_budgets_.emplace(
+      model, TimeBudget{budget_ns, (double)budget_ns, SteadyClockNs()});
+  if (!res.second) {
+    // Every instance of the model registers the budget, only the first
+    // one refills it.
+    auto& time_budget = res.first->second;
+    time_budget.budget_ns_ = budget_ns;
+    time_budget.available_ns_ =
+        std::min(time_budget.available_ns_, (double)budget_ns);
+  }
+}
+
+void
+RateLimiter::ResourceManager::RemoveTimeBudget(const TritonModel* model)
+{
+  std::lock_guard<std::mutex> lk(time_budgets_mtx_);
+  time_budgets_.erase(model);
+}
+
+bool
+RateLimiter::ResourceManager::TimeBudgetAllows(
+    const ModelInstanceContext* instance)
+{
+  std::lock_guard<std::mutex> lk(time_budgets_mtx_);
+  auto budget_itr = time_budgets_.find(instance->RawInstance()->Model());
+  if (budget_itr == time_budgets_.end()) {
+    return true;
+  }
+
+  auto& time_budget = budget_itr->second;
+  const uint64_t now_ns = SteadyClockNs();
+  if (now_ns > time_budget.last_refill_ns_) {
+    time_budget.available_ns_ = std::min(
+        (double)time_budget.budget_ns_,
+        time_budget.available_ns_ +
+            (now_ns - time_budget.last_refill_ns_) *
+                (time_budget.budget_ns_ / 1e9));
+    time_budget.last_refill_ns_ = now_ns;
+  }
+  if (time_budget.available_ns_ > 0) {
+    return true;
+  }
+
+  // An instance spanning several devices borrows only if all are idle
+  for (const int32_t device_id : instance->RawInstance()->DeviceIds()) {
+    auto device_itr = device_allocations_.find(
+        std::make_pair(instance->RawInstance()->Kind(), device_id));
+    if ((device_itr != device_allocations_.end()) &&
+        (device_itr->second != 0)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 RateLimiter::ResourceManager::ResourceManager(const ResourceMap& resource_map)
     : explicit_max_resources_(resource_map)
 {
@@ -25,7 +25,9 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <mutex>
 #include <queue>
@@ -34,7 +36,9 @@
 #include "backend_model.h"
 #include "backend_model_instance.h"
 #include "instance_queue.h"
+#include "instrumented_mutex.h"
 #include "model_config.pb.h"
+#include "mpsc_ring.h"
 #include "payload.h"
 #include "status.h"
 
@@ -45,6 +49,11 @@ class RateLimiter {
  public:
   using RateLimiterConfig = inference::ModelRateLimiter;
   using ResourceMap = std::map<int, std::map<std::string, size_t>>;
+  // Name of the built-in per-device resource holding the device memory
+  // available for execution, in bytes. It may be set explicitly in the
+  // resource map, otherwise the total memory of the device is used.
+  static constexpr const char* DEVICE_MEMORY_RESOURCE =
+      "TRITON_DEVICE_MEMORY_BYTES";
   enum RESOURCE_KIND_KEY {
     // Key for holding global resources
     GLOBAL_RESOURCE_KEY = -2,
@@ -64,11 +73,15 @@ class RateLimiter {
   /// \param ignore_resources_and_priority Whether or not to ignore resource
   /// constraints and cross-model priority. An available instance is directly
   /// allocated when true.
+  /// \param enforce_time_budget Whether or not to limit the models to their
+  /// execution time budget. Ignored if 'ignore_resources_and_priority' is
+  /// true.
   /// \param resource_map The map to the available resource count provided
   /// explicitly.
   /// \return Status object indicating success or failure.
   static Status Create(
-      const bool ignore_resources_and_priority, const ResourceMap& resource_map,
+      const bool ignore_resources_and_priority, const bool enforce_time_budget,
+      const ResourceMap& resource_map,
       std::unique_ptr<RateLimiter>* rate_limiter);
 
   /// Registers the model instance with the rate limiter.
@@ -137,6 +150,16 @@ class RateLimiter {
   using StandardScheduleFunc = std::function<void(ModelInstanceContext*)>;
   using StandardStageFunc = std::function<void(ModelInstanceContext*)>;
 
+  // Pending request for a model instance to schedule a payload on, along
+  // with the batch size and the priority of the payload. A smaller
+  // priority value is a higher priority.
+  struct ScheduleRequest {
+    StandardScheduleFunc OnSchedule_;
+    size_t batch_size_;
+    uint64_t priority_;
+  };
+  using ScheduleRequestQueue = std::deque<ScheduleRequest>;
+
   // Holds the state of the model instance.
   class ModelInstanceContext {
    public:
@@ -159,11 +182,22 @@ class RateLimiter {
     }
     void MarkAvailable();
     double ScaledPriority();
-    Status Stage(StandardScheduleFunc OnSchedule);
+    Status Stage(ScheduleRequest&& request);
     Status Allocate();
     Status DirectAllocate(StandardScheduleFunc OnSchedule);
     void RequestRemoval();
     bool IsRemovalInProgress();
+    // Estimated device memory used per batch item while executing, 0 if
+    // the execution memory is not limited.
+    void SetMemoryPerBatchItem(size_t byte_size)
+    {
+      memory_per_batch_item_ = byte_size;
+    }
+    size_t MemoryPerBatchItem() const { return memory_per_batch_item_; }
+    // Priority of the payload the instance is staged for, the lowest
+    // priority if the instance is not staged.
+    uint64_t StagedPriority() const { return staged_priority_; }
+    size_t StagedBatchSize() const { return staged_batch_size_; }
 
     TritonModelInstance* triton_model_instance_;
     ModelContext* model_context_;
@@ -172,17 +206,25 @@ class RateLimiter {
     StandardReleaseFunc OnRelease_;
     std::atomic<uint64_t> exec_count_;
 
-    State state_;
-    bool removal_in_progress_;
-    std::mutex state_mtx_;
+    std::atomic<State> state_;
+    std::atomic<bool> removal_in_progress_;
 
     StandardScheduleFunc OnSchedule_;
+    // Batch size of the payload the instance is staged for
+    size_t staged_batch_size_;
+    uint64_t staged_priority_;
+    size_t memory_per_batch_item_;
   };
 
   class ScaledPriorityComparator {
    public:
     bool operator()(ModelInstanceContext* a, ModelInstanceContext* b)
     {
+      // Instances staged for payloads of a higher request priority are
+      // allocated first, the instance priority breaks the ties.
+      if (a->StagedPriority() != b->StagedPriority()) {
+        return a->StagedPriority() > b->StagedPriority();
+      }
       return a->ScaledPriority() > b->ScaledPriority();
     }
   };
@@ -199,7 +241,7 @@ class RateLimiter {
     // Enqueue request for obtaining a model instance for scheduling
     // a inference payload execution.
     Status EnqueueModelInstanceRequest(
-        const StandardScheduleFunc& OnSchedule,
+        ScheduleRequest&& request,
         TritonModelInstance* triton_model_instance);
     // Marks the given instance of the model as available and ready
     // to be staged.
@@ -225,17 +267,30 @@ class RateLimiter {
     bool IsRemovalInProgress() { return removal_in_progress_; }
 
    private:
-    bool removal_in_progress_;
-
-    // Queue holding pending scheduling request
-    std::queue<StandardScheduleFunc> generic_sched_request_queue_;
-    std::map<const TritonModelInstance*, std::queue<StandardScheduleFunc>>
+    // Insert 'request' behind the requests of the same or higher priority.
+    static void PushRequest(
+        ScheduleRequestQueue* queue, ScheduleRequest&& request);
+    // Pop the available instances that have a pending scheduling request
+    // along with the request, 'mtx_' must be held. If 'req_instance' is
+    // not nullptr only that instance is considered.
+    void PopSchedulableInstances(
+        TritonModelInstance* req_instance,
+        std::vector<std::pair<ModelInstanceContext*, ScheduleRequest>>*
+            instances);
+
+    std::atomic<bool> removal_in_progress_;
+
+    // Queue holding pending scheduling request, ordered by priority
+    ScheduleRequestQueue generic_sched_request_queue_;
+    std::map<const TritonModelInstance*, ScheduleRequestQueue>
         specific_sched_request_queues_;
-    std::recursive_mutex sched_request_queue_mtx_;
 
     // The set of instances that are available at the moment
     PriorityQueue avbl_instances_;
-    std::recursive_mutex avbl_instances_mtx_;
+
+    // Lock to protect the scheduling requests and the available instances.
+    // The instances are never staged or allocated while holding the lock.
+    std::mutex mtx_;
   };
 
   // Manages and keep track of resource allocation to the model instances.
@@ -257,11 +312,32 @@ class RateLimiter {
     // Releases resources held by the given model instance back to
     // the available pool.
     Status ReleaseResources(const ModelInstanceContext* instance);
+    // Sets the execution time budget of the model, in nanoseconds of
+    // execution per second. The time an instance of the model is
+    // allocated is charged to the budget on release. The budget is
+    // initialized by the first instance of the model, setting it again
+    // keeps the time already used.
+    void SetTimeBudget(const TritonModel* model, uint64_t budget_ns);
+    // Removes the execution time budget of the model.
+    void RemoveTimeBudget(const TritonModel* model);
+    // Returns false if the model of the given instance has used its time
+    // budget and another instance is allocated on one of its devices. The
+    // time of idle devices is lent to a model over its budget.
+    bool TimeBudgetAllows(const ModelInstanceContext* instance);
 
    private:
     ResourceManager(const ResourceMap& resource_map);
     Status ValidateMaxResources();
     Status ParseAndValidateExplicitResources();
+    // Returns the device memory available for execution on 'device_id',
+    // 0 if it is not limited. 'memory_mtx_' must be held.
+    size_t DeviceMemory(const int32_t device_id);
+    // Reserve the device memory the instance is estimated to use while
+    // executing its staged payload. Returns false if the memory is not
+    // available. 'model_resources_mtx_' must be held.
+    bool AllocateMemory(const ModelInstanceContext* instance);
+    // Returns the memory reserved for the instance.
+    void ReleaseMemory(const ModelInstanceContext* instance);
 
     ResourceMap explicit_max_resources_;
 
@@ -273,10 +349,34 @@ class RateLimiter {
 
     ResourceMap allocated_resources_;
     std::mutex allocated_resources_mtx_;
+
+    // Token bucket holding the execution time, in nanoseconds, that a
+    // model may use. It refills at 'budget_ns_' per second up to one
+    // second worth of budget and may go negative.
+    struct TimeBudget {
+      uint64_t budget_ns_;
+      double available_ns_;
+      uint64_t last_refill_ns_;
+    };
+    std::map<const TritonModel*, TimeBudget> time_budgets_;
+    // Allocation time of the allocated instances and the number of
+    // allocated instances per device.
+    std::map<const ModelInstanceContext*, uint64_t> allocation_start_ns_;
+    std::map<std::pair<TRITONSERVER_InstanceGroupKind, int32_t>, size_t>
+        device_allocations_;
+    std::mutex time_budgets_mtx_;
+
+    // Device memory available for execution, the memory reserved for the
+    // executing instances per device and the memory reserved for each
+    // executing instance.
+    std::map<int32_t, size_t> device_memory_;
+    std::map<int32_t, size_t> reserved_memory_;
+    std::map<const ModelInstanceContext*, size_t> instance_memory_;
+    std::mutex memory_mtx_;
   };
 
   RateLimiter(
-      const bool ignore_resources_and_priority,
+      const bool ignore_resources_and_priority, const bool enforce_time_budget,
       const ResourceMap& resource_map);
 
   // Initializes payload queues for the given model instance. The queue
@@ -287,7 +387,8 @@ class RateLimiter {
   // Note that OnSchedule function should only schedule(enqueued in payload
   // queue) the payload and not execute it.
   Status DeferPayloadSchedule(
-      const StandardScheduleFunc& OnSchedule, const TritonModel* model,
+      const StandardScheduleFunc& OnSchedule, const size_t batch_size,
+      const uint64_t priority, const TritonModel* model,
       TritonModelInstance* instance = nullptr);
   // Callback function to stage the instance.
   void OnStage(ModelInstanceContext* instance_ptr);
@@ -297,12 +398,53 @@ class RateLimiter {
   // Attempt allocating the resources for the staged instance with
   // highest priority.
   void AttemptAllocation();
+  // Move the instances passed to the allocating thread into
+  // 'staged_instances_'. 'allocation_mtx_' must be held.
+  void CollectStagedInstances();
+  // Drop the staged 'instances' before their contexts are destroyed.
+  // 'model_ctx_mtx_' must be held so that they can't be staged again.
+  void RemoveStagedInstances(
+      const std::vector<const ModelInstanceContext*>& instances);
+  // Return the queue of an instance whose execution has exceeded the
+  // straggler threshold of the model and that holds a payload which one of
+  // the idle 'instances' can take over, or nullptr if there is none.
+  // 'instance_index' returns the index of the idle instance. The lock of
+  // 'payload_queue' must be held.
+  InstanceQueue* FindStragglerQueue(
+      PayloadQueue* payload_queue,
+      const std::deque<TritonModelInstance*>& instances,
+      size_t* instance_index);
+  // Whether an instance that is executing a payload also has inference
+  // payloads waiting on it. The lock of 'payload_queue' must be held.
+  bool PayloadsWaitOnBusyInstances(PayloadQueue* payload_queue);
+  // Record the execution time of the payloads that the idle 'instances'
+  // have finished and update the straggler threshold. The lock of
+  // 'payload_queue' must be held.
+  void RecordExecutionTimes(
+      PayloadQueue* payload_queue,
+      const std::deque<TritonModelInstance*>& instances);
+  // Move released payloads from 'payload_return_ring_' to 'payload_cache'
+  // unless another thread is doing so.
+  void RefillPayloadCache(std::vector<std::shared_ptr<Payload>>* payload_cache);
+  // Return the NUMA node of the first input of 'payload' in host memory,
+  // or of the calling thread if there is none. -1 if unknown.
+  static int PayloadNumaNode(const std::shared_ptr<Payload>& payload);
+  // Enable the NUMA routing of 'payload_queue' if its instances span
+  // several NUMA nodes. The lock of 'payload_queue' must be held.
+  static void UpdateNumaRouting(PayloadQueue* payload_queue);
+  // Add the 'instances' bound to a NUMA node to the idle instances of
+  // their node if 'idle', remove them otherwise. The lock of
+  // 'payload_queue' must be held.
+  static void SetNumaIdle(
+      PayloadQueue* payload_queue,
+      const std::deque<TritonModelInstance*>& instances, const bool idle);
   // Schedules the payload for execution on model instance.
   void SchedulePayload(
       TritonModelInstance* tmi, PayloadQueue* payload_queue,
       const std::shared_ptr<Payload>& payload);
 
   bool ignore_resources_and_priority_;
+  bool enforce_time_budget_;
 
   // Instance context for the models
   std::map<
@@ -316,16 +458,39 @@ class RateLimiter {
   std::map<const TritonModel*, ModelContext> model_contexts_;
   std::mutex model_ctx_mtx_;
 
-  // Holds the model instances that have been staged
+  // Holds the model instances that have been staged, only accessed by
+  // the thread that is allocating, see AttemptAllocation(), or by the
+  // thread removing instances. The staged instances are passed to the
+  // allocating thread through 'staging_ring_', or 'staging_overflow_' if
+  // the ring is full. 'allocation_mtx_' is held by both threads, it is
+  // only contended while instances are removed.
   PriorityQueue staged_instances_;
-  std::recursive_mutex staged_instances_mtx_;
+  std::mutex allocation_mtx_;
+  MPSCRing<ModelInstanceContext*> staging_ring_;
+  std::vector<ModelInstanceContext*> staging_overflow_;
+  std::mutex staging_overflow_mtx_;
+  // Number of allocation attempts not yet handled by the allocating
+  // thread, non-zero while a thread is allocating.
+  std::atomic<size_t> allocation_requests_;
 
   // Manager to keep track of the resource allocations
   std::unique_ptr<ResourceManager> resource_manager_;
   std::mutex resource_manager_mtx_;
 
   // Mutex to serialize Payload [de]allocation
-  std::mutex payload_mu_;
+  InstrumentedMutex payload_mu_;
+
+  // Released payloads that were returned without taking 'payload_mu_'.
+  // They are moved in batches to the payload cache of the thread that
+  // acquires payloads, 'payload_return_mu_' serializes the consumers.
+  MPSCRing<std::shared_ptr<Payload>> payload_return_ring_;
+  std::mutex payload_return_mu_;
+  // Unique id of the rate limiter, the payload cache of a thread is only
+  // used by the rate limiter with its owner id.
+  const uint64_t id_;
+  // The number of payloads kept for reuse, wherever they are kept. Shared
+  // with the thread caches, which may outlive the rate limiter.
+  std::shared_ptr<std::atomic<size_t>> pooled_payload_count_;
 
   // Mutex to serialize Payload Queues deallocation
   std::mutex payload_queues_mu_;
@@ -337,13 +502,46 @@ class RateLimiter {
   std::deque<std::shared_ptr<Payload>> payloads_in_use_;
 
   struct PayloadQueue {
-    explicit PayloadQueue(size_t max_batch_size, uint64_t max_queue_delay_ns)
+    explicit PayloadQueue(
+        size_t max_batch_size, uint64_t max_queue_delay_ns,
+        bool merge_ready_payloads)
+        : merge_ready_payloads_(merge_ready_payloads), straggler_percentile_(0),
+          next_exec_duration_idx_(0), exec_durations_since_update_(0),
+          straggler_threshold_ns_(0), numa_routing_(false)
     {
-      queue_.reset(new InstanceQueue(max_batch_size, max_queue_delay_ns));
+      queue_.reset(new InstanceQueue(
+          max_batch_size, max_queue_delay_ns, merge_ready_payloads));
     }
     std::unique_ptr<InstanceQueue> queue_;
     std::map<const TritonModelInstance*, std::unique_ptr<InstanceQueue>>
         specific_queues_;
+    // Whether the instance queues merge all ready payloads on dequeue
+    bool merge_ready_payloads_;
+    // Percentile of the recent execution times above which an executing
+    // instance is a straggler whose waiting payloads are moved to idle
+    // instances, 0 if stragglers are not detected. Only the payloads in
+    // 'specific_queues_' wait on an instance, the shared queue is served
+    // by whichever instance is idle. The payload a straggler executes is
+    // left to it, it is neither duplicated nor cancelled.
+    uint32_t straggler_percentile_;
+    // Start time of the payload being executed by each busy instance
+    std::map<const TritonModelInstance*, uint64_t> exec_start_ns_;
+    // Recent execution times, 'next_exec_duration_idx_' is the slot the
+    // next one is recorded in once the window is full.
+    std::vector<uint64_t> exec_durations_ns_;
+    size_t next_exec_duration_idx_;
+    size_t exec_durations_since_update_;
+    // Execution time above which an instance is a straggler, 0 until
+    // enough execution times are recorded.
+    uint64_t straggler_threshold_ns_;
+    // The NUMA node of each instance whose host policy binds it to one.
+    // If the instances span several nodes, a payload not bound to an
+    // instance goes to an idle instance on the node of its input memory
+    // and only falls back to the shared queue if there is none.
+    std::map<const TritonModelInstance*, int> instance_numa_nodes_;
+    std::atomic<bool> numa_routing_;
+    // The instances waiting for a payload, by NUMA node
+    std::map<int, std::vector<TritonModelInstance*>> idle_numa_instances_;
     std::mutex mu_;
     std::condition_variable cv_;
   };
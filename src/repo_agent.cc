@@ -26,7 +26,10 @@
 
 #include "repo_agent.h"
 
+#include <algorithm>
+#include <condition_variable>
 #include <string>
+#include <thread>
 #include "filesystem/api.h"
 #include "shared_library.h"
 #include "triton/common/logging.h"
@@ -444,6 +447,89 @@ TritonRepoAgentManager::AgentState(
   return Status::Success;
 }
 
+Status
+TritonRepoAgentManager::VisitFiles(
+    const std::string& location,
+    const std::function<Status(const std::string& path)>& visit)
+{
+  auto& singleton_manager = Singleton();
+  triton::common::ThreadPool* pool;
+  {
+    std::lock_guard<std::mutex> lock(singleton_manager.mu_);
+    if (singleton_manager.visit_pool_ == nullptr) {
+      singleton_manager.visit_pool_.reset(new triton::common::ThreadPool(
+          std::max(1u, std::thread::hardware_concurrency())));
+    }
+    pool = singleton_manager.visit_pool_.get();
+  }
+
+  // The caller waits for all the visits it enqueued, so the state can
+  // live on its stack.
+  std::mutex mu;
+  std::condition_variable cv;
+  size_t pending = 0;
+  Status status;
+
+  std::vector<std::string> dirs{location};
+  while (!dirs.empty()) {
+    const std::string dir = std::move(dirs.back());
+    dirs.pop_back();
+    std::set<std::string> contents;
+    Status list_status = GetDirectoryContents(dir, &contents);
+    for (const auto& name : contents) {
+      const std::string path = JoinPath({dir, name});
+      bool is_dir = false;
+      list_status = IsDirectory(path, &is_dir);
+      if (!list_status.IsOk()) {
+        break;
+      }
+      if (is_dir) {
+        dirs.push_back(path);
+        continue;
+      }
+
+      {
+        std::lock_guard<std::mutex> lk(mu);
+        if (!status.IsOk()) {
+          break;
+        }
+        ++pending;
+      }
+      pool->Enqueue([&mu, &cv, &pending, &status, &visit, path]() {
+        bool skip;
+        {
+          std::lock_guard<std::mutex> lk(mu);
+          skip = !status.IsOk();
+        }
+        Status visit_status = skip ? Status::Success : visit(path);
+        std::lock_guard<std::mutex> lk(mu);
+        if (status.IsOk() && !visit_status.IsOk()) {
+          status = visit_status;
+        }
+        if (--pending == 0) {
+          cv.notify_all();
+        }
+      });
+    }
+
+    if (!list_status.IsOk()) {
+      std::lock_guard<std::mutex> lk(mu);
+      if (status.IsOk()) {
+        status = list_status;
+      }
+      break;
+    }
+    std::lock_guard<std::mutex> lk(mu);
+    if (!status.IsOk()) {
+      break;
+    }
+  }
+
+  std::unique_lock<std::mutex> lk(mu);
+  cv.wait(lk, [&pending]() { return pending == 0; });
+  return status;
+}
+
 extern "C" {
 
 TRITONAPI_DECLSPEC TRITONSERVER_Error*
@@ -485,6 +571,28 @@ TRITONREPOAGENT_ModelRepositoryLocationRelease(
   return nullptr;  // success
 }
 
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONREPOAGENT_ModelRepositoryVisitFiles(
+    TRITONREPOAGENT_Agent* agent, TRITONREPOAGENT_AgentModel* model,
+    const char* location, TRITONREPOAGENT_ModelFileVisitFn_t visit_fn,
+    void* userp)
+{
+  if (location == nullptr) {
+    TRITONREPOAGENT_ArtifactType artifact_type;
+    TritonRepoAgentModel* tam = reinterpret_cast<TritonRepoAgentModel*>(model);
+    RETURN_TRITONSERVER_ERROR_IF_ERROR(
+        tam->Location(&artifact_type, &location));
+  }
+
+  RETURN_TRITONSERVER_ERROR_IF_ERROR(TritonRepoAgentManager::VisitFiles(
+      location, [agent, model, visit_fn, userp](const std::string& path) {
+        RETURN_IF_TRITONSERVER_ERROR(
+            visit_fn(agent, model, path.c_str(), userp));
+        return Status::Success;
+      }));
+  return nullptr;  // success
+}
+
 TRITONAPI_DECLSPEC TRITONSERVER_Error*
 TRITONREPOAGENT_ModelRepositoryUpdate(
     TRITONREPOAGENT_Agent* agent, TRITONREPOAGENT_AgentModel* model,
@@ -27,12 +27,14 @@
 
 #include "tritonserver_apis.h"
 
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <unordered_map>
 #include <vector>
 #include "constants.h"
 #include "model_config_utils.h"
+#include "triton/common/thread_pool.h"
 
 namespace triton { namespace core {
 
@@ -168,6 +170,16 @@ class TritonRepoAgentManager {
       std::unique_ptr<std::unordered_map<std::string, std::string>>*
           agent_state);
 
+  // Call 'visit' with the path of every file under the directory
+  // 'location', recursively. The calls run on a thread pool shared by
+  // all agents and start while the directory is still being listed, so
+  // 'visit' must be thread-safe and must not call VisitFiles() itself.
+  // Return the first error of the listing or of a call, the remaining
+  // files are not visited once an error occurred.
+  static Status VisitFiles(
+      const std::string& location,
+      const std::function<Status(const std::string& path)>& visit);
+
  private:
   DISALLOW_COPY_AND_ASSIGN(TritonRepoAgentManager);
 
@@ -177,6 +189,8 @@ class TritonRepoAgentManager {
   std::mutex mu_;
   std::string global_search_path_;
   std::unordered_map<std::string, std::weak_ptr<TritonRepoAgent>> agent_map_;
+  // Runs the file visits of VisitFiles(), created on first use
+  std::unique_ptr<triton::common::ThreadPool> visit_pool_;
 };
 
 }}  // namespace triton::core
@@ -0,0 +1,317 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "repository_watcher.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include "constants.h"
+#include "filesystem/api.h"
+#include "triton/common/logging.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif  // __linux__
+
+namespace triton { namespace core {
+
+namespace {
+
+// Return the model directory that the repository relative 'path' is in
+std::string
+ModelOf(const std::string& path)
+{
+  return path.substr(0, path.find('/'));
+}
+
+//
+// Watcher that lists the whole repository with one recursive listing per
+// poll, instead of a listing and a metadata request per file and
+// directory of every model.
+//
+class ListingWatcher : public RepositoryWatcher {
+ public:
+  ListingWatcher(const std::string& repository_path, WalkFunc walk_fn)
+      : RepositoryWatcher(repository_path, std::move(walk_fn)), listed_(false)
+  {
+  }
+
+  Status Refresh() override
+  {
+    models_.clear();
+    std::map<std::string, int64_t> mtimes;
+    Status status = ListModificationTimes(repository_path_, &mtimes);
+    listed_ = status.IsOk();
+    if (!listed_) {
+      // Not fatal, the model directories are walked for this poll
+      LOG_ERROR << "failed to list model repository '" << repository_path_
+                << "': " << status.Message();
+      return Status::Success;
+    }
+
+    // Fold the listing into '<config.pbtxt, model files>' of each model
+    // directory, the model directory itself counts as a model file.
+    for (const auto& entry : mtimes) {
+      const std::string model = ModelOf(entry.first);
+      auto& times = models_.emplace(model, ModifiedTimes(0, 0)).first->second;
+      if (entry.first == (model + "/" + kModelConfigPbTxt)) {
+        times.first = entry.second;
+      } else {
+        times.second = std::max(times.second, entry.second);
+      }
+    }
+    return Status::Success;
+  }
+
+  ModifiedTimes ModelModifiedTimes(const std::string& model_name) override
+  {
+    if (listed_) {
+      const auto it = models_.find(model_name);
+      if (it != models_.end()) {
+        return it->second;
+      }
+    }
+    return walk_fn_(JoinPath({repository_path_, model_name}));
+  }
+
+ private:
+  bool listed_;
+  std::unordered_map<std::string, ModifiedTimes> models_;
+};
+
+#ifdef __linux__
+//
+// Watcher that subscribes to inotify events of every directory of a local
+// repository. Only the model directories that had an event since their
+// last walk are walked again.
+//
+class InotifyWatcher : public RepositoryWatcher {
+ public:
+  InotifyWatcher(const std::string& repository_path, WalkFunc walk_fn)
+      : RepositoryWatcher(repository_path, std::move(walk_fn)), fd_(-1)
+  {
+  }
+
+  ~InotifyWatcher()
+  {
+    if (fd_ != -1) {
+      close(fd_);
+    }
+  }
+
+  Status Init()
+  {
+    if (fd_ != -1) {
+      close(fd_);
+    }
+    watch_dirs_.clear();
+    models_.clear();
+    fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd_ == -1) {
+      return Status(
+          Status::Code::INTERNAL,
+          "failed to initialize inotify: " + std::string(strerror(errno)));
+    }
+    return AddWatches("");
+  }
+
+  Status Refresh() override
+  {
+    alignas(struct inotify_event) char buffer[16 * 1024];
+    bool overflow = false;
+    while (true) {
+      const ssize_t len = read(fd_, buffer, sizeof(buffer));
+      if (len == -1) {
+        if (errno == EINTR) {
+          continue;
+        }
+        if (errno == EAGAIN) {
+          break;
+        }
+        return Status(
+            Status::Code::INTERNAL, "failed to read inotify events for '" +
+                                        repository_path_ +
+                                        "': " + strerror(errno));
+      }
+
+      for (ssize_t offset = 0; offset < len;) {
+        const auto event =
+            reinterpret_cast<const struct inotify_event*>(buffer + offset);
+        offset += sizeof(struct inotify_event) + event->len;
+        if ((event->mask & IN_Q_OVERFLOW) != 0) {
+          overflow = true;
+        } else if ((event->mask & IN_IGNORED) != 0) {
+          watch_dirs_.erase(event->wd);
+        } else {
+          RETURN_IF_ERROR(HandleEvent(*event));
+        }
+      }
+    }
+
+    // Events are lost, start over from a fresh walk of every directory
+    if (overflow) {
+      LOG_VERBOSE(1) << "inotify event queue overflowed for '"
+                     << repository_path_ << "', re-watching the repository";
+      RETURN_IF_ERROR(Init());
+    }
+    return Status::Success;
+  }
+
+  ModifiedTimes ModelModifiedTimes(const std::string& model_name) override
+  {
+    {
+      std::lock_guard<std::mutex> lk(models_mu_);
+      const auto it = models_.find(model_name);
+      if (it != models_.end()) {
+        return it->second;
+      }
+    }
+    const auto times = walk_fn_(JoinPath({repository_path_, model_name}));
+    std::lock_guard<std::mutex> lk(models_mu_);
+    models_[model_name] = times;
+    return times;
+  }
+
+ private:
+  static constexpr uint32_t kEventMask =
+      IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_DELETE_SELF |
+      IN_MODIFY | IN_MOVE_SELF | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+
+  Status HandleEvent(const struct inotify_event& event)
+  {
+    const auto it = watch_dirs_.find(event.wd);
+    if (it == watch_dirs_.end()) {
+      return Status::Success;
+    }
+    std::string path = it->second;
+    if (event.len > 0) {
+      path = path.empty() ? event.name : (path + "/" + event.name);
+    }
+
+    // An event on the repository directory itself invalidates everything
+    if (path.empty()) {
+      models_.clear();
+      return Status::Success;
+    }
+    models_.erase(ModelOf(path));
+
+    if ((event.mask & IN_ISDIR) != 0) {
+      if ((event.mask & IN_MOVED_FROM) != 0) {
+        RemoveWatches(path);
+      } else if ((event.mask & (IN_CREATE | IN_MOVED_TO)) != 0) {
+        RETURN_IF_ERROR(AddWatches(path));
+      }
+    }
+    return Status::Success;
+  }
+
+  // Watch the repository relative directory 'path' and its sub-directories
+  Status AddWatches(const std::string& path)
+  {
+    const std::string full_path =
+        path.empty() ? repository_path_ : JoinPath({repository_path_, path});
+    const int wd = inotify_add_watch(fd_, full_path.c_str(), kEventMask);
+    if (wd == -1) {
+      // The directory may be removed before it is watched
+      if ((errno == ENOENT) || (errno == ENOTDIR)) {
+        return Status::Success;
+      }
+      return Status(
+          Status::Code::INTERNAL,
+          "failed to watch '" + full_path + "': " + strerror(errno));
+    }
+    watch_dirs_[wd] = path;
+
+    // Same as above, the directory may be removed while being listed
+    std::set<std::string> subdirs;
+    if (!GetDirectorySubdirs(full_path, &subdirs).IsOk()) {
+      return Status::Success;
+    }
+    for (const auto& subdir : subdirs) {
+      const std::string subdir_path =
+          path.empty() ? subdir : (path + "/" + subdir);
+      RETURN_IF_ERROR(AddWatches(subdir_path));
+    }
+    return Status::Success;
+  }
+
+  // Stop watching the moved away directory 'path' and its sub-directories,
+  // their events would be reported under the stale path otherwise.
+  void RemoveWatches(const std::string& path)
+  {
+    const std::string prefix = path + "/";
+    for (auto it = watch_dirs_.begin(); it != watch_dirs_.end();) {
+      const std::string& dir = it->second;
+      if ((dir == path) || (dir.compare(0, prefix.size(), prefix) == 0)) {
+        inotify_rm_watch(fd_, it->first);
+        it = watch_dirs_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  int fd_;
+  // The repository relative path of each watched directory
+  std::unordered_map<int, std::string> watch_dirs_;
+  // The modification times of the model directories that had no event
+  // since they were last walked
+  std::mutex models_mu_;
+  std::unordered_map<std::string, ModifiedTimes> models_;
+};
+#endif  // __linux__
+
+}  // namespace
+
+Status
+RepositoryWatcher::Create(
+    const std::string& repository_path, WalkFunc walk_fn,
+    std::unique_ptr<RepositoryWatcher>* watcher)
+{
+  watcher->reset();
+  FileSystemType type;
+  RETURN_IF_ERROR(GetFileSystemType(repository_path, &type));
+  if (type != FileSystemType::LOCAL) {
+    watcher->reset(new ListingWatcher(repository_path, std::move(walk_fn)));
+    return Status::Success;
+  }
+
+#ifdef __linux__
+  std::unique_ptr<InotifyWatcher> local_watcher(
+      new InotifyWatcher(repository_path, std::move(walk_fn)));
+  RETURN_IF_ERROR(local_watcher->Init());
+  *watcher = std::move(local_watcher);
+#endif  // __linux__
+  return Status::Success;
+}
+
+}}  // namespace triton::core
@@ -0,0 +1,80 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include "status.h"
+
+namespace triton { namespace core {
+
+//
+// Keeps the modification times of the model directories of a model
+// repository across polls, so that a poll only examines the model
+// directories that changed instead of walking all of them.
+//
+class RepositoryWatcher {
+ public:
+  // The modification times of '<config.pbtxt, model files>' of a model
+  // directory.
+  using ModifiedTimes = std::pair<int64_t, int64_t>;
+  // Walk a model directory for its modification times
+  using WalkFunc = std::function<ModifiedTimes(const std::string& path)>;
+
+  // Create the watcher of 'repository_path'. A local repository is
+  // watched for change notifications, a cloud repository is listed once
+  // per poll. 'watcher' is set to nullptr if the repository can't be
+  // watched and every model directory must be walked.
+  static Status Create(
+      const std::string& repository_path, WalkFunc walk_fn,
+      std::unique_ptr<RepositoryWatcher>* watcher);
+
+  virtual ~RepositoryWatcher() = default;
+
+  // Catch up with the changes in the repository, called at the start of
+  // each poll. An error means that the watcher lost track of the
+  // repository and must not be used anymore.
+  virtual Status Refresh() = 0;
+
+  // Return the modification times of the model directory 'model_name' of
+  // the repository, the same as 'walk_fn' would. May be called for
+  // different models concurrently, but not concurrently with Refresh().
+  virtual ModifiedTimes ModelModifiedTimes(const std::string& model_name) = 0;
+
+ protected:
+  RepositoryWatcher(const std::string& repository_path, WalkFunc walk_fn)
+      : repository_path_(repository_path), walk_fn_(std::move(walk_fn))
+  {
+  }
+
+  const std::string repository_path_;
+  const WalkFunc walk_fn_;
+};
+
+}}  // namespace triton::core
@@ -0,0 +1,156 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace triton { namespace core {
+
+//
+// Bump allocator for the internal structures of an inference request.
+// Memory is carved from chunks that are only returned when the arena is
+// destroyed, or rewound by Reset() once every allocation has been
+// deallocated. Allocations must be made by one thread at a time, the
+// deallocations may come from any thread.
+//
+class RequestArena {
+ public:
+  static constexpr size_t kChunkByteSize = 4 << 10;
+
+  RequestArena() : cursor_(0), end_(0), live_count_(0) {}
+
+  RequestArena(const RequestArena&) = delete;
+  RequestArena& operator=(const RequestArena&) = delete;
+
+  // Return 'byte_size' bytes aligned to 'alignment', which must be a
+  // power of two no larger than the alignment of 'new'.
+  void* Allocate(size_t byte_size, size_t alignment)
+  {
+    uintptr_t start = (cursor_ + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    if ((cursor_ == 0) || ((start + byte_size) > end_)) {
+      AddChunk(byte_size);
+      start = cursor_;
+    }
+    cursor_ = start + byte_size;
+    live_count_.fetch_add(1, std::memory_order_relaxed);
+    return reinterpret_cast<void*>(start);
+  }
+
+  // Mark an allocation as dead. Its memory is reclaimed by Reset() or
+  // the destruction of the arena.
+  void Deallocate() { live_count_.fetch_sub(1, std::memory_order_release); }
+
+  // Rewind the arena to its first chunk if no allocation is live.
+  // Return false and leave the arena untouched otherwise.
+  bool Reset()
+  {
+    if (live_count_.load(std::memory_order_acquire) != 0) {
+      return false;
+    }
+    if (!chunks_.empty()) {
+      chunks_.resize(1);
+      cursor_ = reinterpret_cast<uintptr_t>(chunks_[0].buffer_.get());
+      end_ = cursor_ + chunks_[0].byte_size_;
+    }
+    return true;
+  }
+
+ private:
+  struct Chunk {
+    std::unique_ptr<char[]> buffer_;
+    size_t byte_size_;
+  };
+
+  void AddChunk(size_t min_byte_size)
+  {
+    const size_t byte_size =
+        (min_byte_size > kChunkByteSize) ? min_byte_size : kChunkByteSize;
+    chunks_.emplace_back(Chunk{std::unique_ptr<char[]>(new char[byte_size]),
+                               byte_size});
+    cursor_ = reinterpret_cast<uintptr_t>(chunks_.back().buffer_.get());
+    end_ = cursor_ + byte_size;
+  }
+
+  std::vector<Chunk> chunks_;
+  uintptr_t cursor_;
+  uintptr_t end_;
+  std::atomic<size_t> live_count_;
+};
+
+//
+// Standard allocator over a RequestArena. The allocator shares the
+// ownership of the arena so that objects allocated from it, such as the
+// data of an input, may outlive the request.
+//
+template <typename T>
+class ArenaAllocator {
+ public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  explicit ArenaAllocator(const std::shared_ptr<RequestArena>& arena)
+      : arena_(arena)
+  {
+  }
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.Arena())
+  {
+  }
+
+  T* allocate(size_t n)
+  {
+    return static_cast<T*>(arena_->Allocate(n * sizeof(T), alignof(T)));
+  }
+  void deallocate(T*, size_t) { arena_->Deallocate(); }
+
+  const std::shared_ptr<RequestArena>& Arena() const { return arena_; }
+
+ private:
+  std::shared_ptr<RequestArena> arena_;
+};
+
+template <typename T, typename U>
+bool
+operator==(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs)
+{
+  return lhs.Arena() == rhs.Arena();
+}
+
+template <typename T, typename U>
+bool
+operator!=(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs)
+{
+  return !(lhs == rhs);
+}
+
+}}  // namespace triton::core
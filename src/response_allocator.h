@@ -39,7 +39,8 @@ class ResponseAllocator {
       TRITONSERVER_ResponseAllocatorReleaseFn_t release_fn,
       TRITONSERVER_ResponseAllocatorStartFn_t start_fn)
       : alloc_fn_(alloc_fn), buffer_attributes_fn_(nullptr), query_fn_(nullptr),
-        release_fn_(release_fn), start_fn_(start_fn)
+        release_fn_(release_fn), start_fn_(start_fn), borrow_buffers_(false),
+        query_stable_(false)
   {
   }
 
@@ -54,6 +55,10 @@ class ResponseAllocator {
     buffer_attributes_fn_ = buffer_attributes_fn;
   }
 
+  void SetBorrowBuffers(const bool enable) { borrow_buffers_ = enable; }
+
+  void SetQueryStable(const bool stable) { query_stable_ = stable; }
+
   TRITONSERVER_ResponseAllocatorAllocFn_t AllocFn() const { return alloc_fn_; }
   TRITONSERVER_ResponseAllocatorBufferAttributesFn_t BufferAttributesFn() const
   {
@@ -65,6 +70,8 @@ class ResponseAllocator {
     return release_fn_;
   }
   TRITONSERVER_ResponseAllocatorStartFn_t StartFn() const { return start_fn_; }
+  bool BorrowBuffers() const { return borrow_buffers_; }
+  bool QueryStable() const { return query_stable_; }
 
  private:
   TRITONSERVER_ResponseAllocatorAllocFn_t alloc_fn_;
@@ -72,6 +79,14 @@ class ResponseAllocator {
   TRITONSERVER_ResponseAllocatorQueryFn_t query_fn_;
   TRITONSERVER_ResponseAllocatorReleaseFn_t release_fn_;
   TRITONSERVER_ResponseAllocatorStartFn_t start_fn_;
+
+  // Whether outputs may reference buffers owned by Triton rather than
+  // buffers allocated with 'alloc_fn_'.
+  bool borrow_buffers_;
+
+  // Whether 'query_fn_' returns the same result for the same output and
+  // caller preference for the whole lifetime of a request.
+  bool query_stable_;
 };
 
 }}  // namespace triton::core
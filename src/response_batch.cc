@@ -0,0 +1,188 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "response_batch.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <thread>
+
+namespace triton { namespace core {
+
+namespace {
+
+//
+// Flushes the batches whose window has elapsed, from a single thread
+// shared by all batches.
+//
+class ResponseBatchFlusher {
+ public:
+  static ResponseBatchFlusher& Singleton()
+  {
+    static ResponseBatchFlusher flusher;
+    return flusher;
+  }
+
+  ~ResponseBatchFlusher()
+  {
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      exit_ = true;
+    }
+    cv_.notify_one();
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+  void Schedule(
+      const std::shared_ptr<ResponseBatch>& batch, const uint64_t delay_us)
+  {
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::microseconds(delay_us);
+    bool earliest = false;
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      if (!thread_.joinable()) {
+        thread_ = std::thread([this] { Run(); });
+      }
+      earliest = queue_.empty() || (deadline < queue_.begin()->first);
+      queue_.emplace(deadline, batch);
+    }
+    if (earliest) {
+      cv_.notify_one();
+    }
+  }
+
+ private:
+  ResponseBatchFlusher() : exit_(false) {}
+
+  void Run()
+  {
+    std::unique_lock<std::mutex> lk(mu_);
+    while (!exit_) {
+      if (queue_.empty()) {
+        cv_.wait(lk);
+        continue;
+      }
+      const auto deadline = queue_.begin()->first;
+      if (std::chrono::steady_clock::now() < deadline) {
+        cv_.wait_until(lk, deadline);
+        continue;
+      }
+      std::shared_ptr<ResponseBatch> batch =
+          std::move(queue_.begin()->second);
+      queue_.erase(queue_.begin());
+      lk.unlock();
+      batch->Flush();
+      batch.reset();
+      lk.lock();
+    }
+  }
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  bool exit_;
+  std::multimap<
+      std::chrono::steady_clock::time_point, std::shared_ptr<ResponseBatch>>
+      queue_;
+  std::thread thread_;
+};
+
+}  // namespace
+
+std::shared_ptr<ResponseBatch>
+ResponseBatch::Create(
+    TRITONSERVER_InferenceResponseBatchCompleteFn_t batch_fn, void* userp,
+    const uint64_t window_us)
+{
+  return std::shared_ptr<ResponseBatch>(
+      new ResponseBatch(batch_fn, userp, window_us));
+}
+
+void
+ResponseBatch::Complete(
+    TRITONSERVER_InferenceResponse* response, const uint32_t flags,
+    void* userp)
+{
+  reinterpret_cast<ResponseBatch*>(userp)->Add(response, flags);
+}
+
+void
+ResponseBatch::Add(
+    TRITONSERVER_InferenceResponse* response, const uint32_t flags)
+{
+  const bool is_final = ((flags & TRITONSERVER_RESPONSE_COMPLETE_FINAL) != 0);
+  bool schedule = false;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (response != nullptr) {
+      pending_.push_back(response);
+    }
+    if (!is_final && (window_us_ > 0) && !flush_scheduled_) {
+      flush_scheduled_ = true;
+      schedule = true;
+    }
+  }
+
+  if (is_final || (window_us_ == 0)) {
+    std::lock_guard<std::mutex> lk(delivery_mu_);
+    Deliver(flags);
+  } else if (schedule) {
+    ResponseBatchFlusher::Singleton().Schedule(shared_from_this(), window_us_);
+  }
+}
+
+void
+ResponseBatch::Flush()
+{
+  std::lock_guard<std::mutex> lk(delivery_mu_);
+  {
+    std::lock_guard<std::mutex> plk(mu_);
+    flush_scheduled_ = false;
+    if (pending_.empty()) {
+      return;
+    }
+  }
+  Deliver(0 /* flags */);
+}
+
+void
+ResponseBatch::Deliver(const uint32_t flags)
+{
+  // The client deleting the last responses from 'batch_fn_' may drop
+  // the last reference to the batch otherwise
+  std::shared_ptr<ResponseBatch> self = shared_from_this();
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    delivering_.swap(pending_);
+  }
+  batch_fn_(delivering_.data(), delivering_.size(), flags, userp_);
+  delivering_.clear();
+}
+
+}}  // namespace triton::core
@@ -0,0 +1,84 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "tritonserver_apis.h"
+
+namespace triton { namespace core {
+
+//
+// Coalesces the responses of a request that are produced close in
+// time so that they are delivered by a single client callback. The
+// batch is owned by the response factory of the request and by the
+// responses created from it, so it is released with the request and
+// its last response whether or not the final flag is ever delivered.
+//
+class ResponseBatch : public std::enable_shared_from_this<ResponseBatch> {
+ public:
+  // Create a batch delivering to 'batch_fn', the batch is the user
+  // pointer to be passed to Complete().
+  static std::shared_ptr<ResponseBatch> Create(
+      TRITONSERVER_InferenceResponseBatchCompleteFn_t batch_fn, void* userp,
+      const uint64_t window_us);
+
+  // The response callback of a request using a batch as user pointer.
+  static void Complete(
+      TRITONSERVER_InferenceResponse* response, const uint32_t flags,
+      void* userp);
+
+  // Deliver the responses waiting in the batch, if any.
+  void Flush();
+
+ private:
+  ResponseBatch(
+      TRITONSERVER_InferenceResponseBatchCompleteFn_t batch_fn, void* userp,
+      const uint64_t window_us)
+      : batch_fn_(batch_fn), userp_(userp), window_us_(window_us),
+        flush_scheduled_(false)
+  {
+  }
+
+  void Add(TRITONSERVER_InferenceResponse* response, const uint32_t flags);
+  // Deliver the waiting responses with 'flags', 'delivery_mu_' must be
+  // held so that batches are delivered in order.
+  void Deliver(const uint32_t flags);
+
+  const TRITONSERVER_InferenceResponseBatchCompleteFn_t batch_fn_;
+  void* const userp_;
+  const uint64_t window_us_;
+
+  std::mutex delivery_mu_;
+  std::mutex mu_;
+  std::vector<TRITONSERVER_InferenceResponse*> pending_;
+  std::vector<TRITONSERVER_InferenceResponse*> delivering_;
+  bool flush_scheduled_;
+};
+
+}}  // namespace triton::core
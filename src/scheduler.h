@@ -69,6 +69,23 @@ class Scheduler {
   // caller still retains ownership of 'request'.
   virtual Status Enqueue(std::unique_ptr<InferenceRequest>& request) = 0;
 
+  // Enqueue a batch of requests with the scheduler. The scheduler takes
+  // ownership of all 'requests', a request that can't be enqueued is
+  // completed with an error response and released. The default
+  // enqueues the requests one by one.
+  virtual void EnqueueBatch(
+      std::vector<std::unique_ptr<InferenceRequest>>& requests)
+  {
+    for (auto& request : requests) {
+      Status status = Enqueue(request);
+      if (!status.IsOk()) {
+        InferenceRequest::RespondIfError(
+            request, status, true /* release_requests */);
+      }
+    }
+    requests.clear();
+  }
+
   // Return the number of in-flight inferences tracked by the scheduler.
   virtual size_t InflightInferenceCount() = 0;
 
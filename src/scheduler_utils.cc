@@ -27,6 +27,7 @@
 #include "scheduler_utils.h"
 
 #include <cassert>
+#include "clock.h"
 #include "constants.h"
 #include "triton/common/logging.h"
 
@@ -127,8 +128,106 @@ RequiredEqualInputs::HasEqualInputs(
   return true;
 }
 
+size_t
+InputShapeSignature(
+    const std::unique_ptr<InferenceRequest>& request,
+    const std::unordered_map<std::string, bool>& enforce_equal_shape_tensors)
+{
+  // The inputs are not iterated in a deterministic order so the per-input
+  // hashes are combined with a commutative operation.
+  size_t signature = std::hash<size_t>()(request->ImmutableInputs().size());
+  for (const auto& pr : request->ImmutableInputs()) {
+    if (enforce_equal_shape_tensors.find(pr.first) ==
+        enforce_equal_shape_tensors.end()) {
+      continue;
+    }
+    size_t input_hash = std::hash<std::string>()(pr.first);
+    for (const auto dim : pr.second->Shape()) {
+      input_hash ^= std::hash<int64_t>()(dim) + 0x9e3779b9 +
+                    (input_hash << 6) + (input_hash >> 2);
+    }
+    signature += input_hash;
+  }
+
+  return signature;
+}
+
+QueueDelayController::QueueDelayController(
+    const uint64_t target_latency_ns, const uint64_t max_delay_ns,
+    const uint64_t initial_delay_ns, const size_t target_batch_size)
+    : target_latency_ns_(target_latency_ns), max_delay_ns_(max_delay_ns),
+      target_batch_size_(target_batch_size), arrival_count_(0),
+      last_update_ns_(0), last_execution_count_(0),
+      last_compute_duration_ns_(0), arrival_rate_(0), compute_ns_(0),
+      delay_ns_(std::min(initial_delay_ns, max_delay_ns))
+{
+}
+
+void
+QueueDelayController::Update(
+    const uint64_t now_ns, const uint64_t execution_count,
+    const uint64_t compute_duration_ns)
+{
+  // Smoothing factor applied to new observations
+  constexpr double alpha = 0.25;
+
+  const uint64_t arrivals = arrival_count_.exchange(0);
+  if (last_update_ns_ == 0) {
+    // First call only establishes the baseline of the measurements.
+    last_update_ns_ = now_ns;
+    last_execution_count_ = execution_count;
+    last_compute_duration_ns_ = compute_duration_ns;
+    return;
+  }
+
+  const double window_s = (now_ns - last_update_ns_) / 1e9;
+  const double rate = arrivals / window_s;
+  arrival_rate_ = (arrival_rate_ == 0) ? rate
+                                       : (1 - alpha) * arrival_rate_ +
+                                             alpha * rate;
+
+  if (execution_count > last_execution_count_) {
+    const double compute_ns =
+        (double)(compute_duration_ns - last_compute_duration_ns_) /
+        (execution_count - last_execution_count_);
+    compute_ns_ = (compute_ns_ == 0)
+                      ? compute_ns
+                      : (1 - alpha) * compute_ns_ + alpha * compute_ns;
+  }
+
+  last_update_ns_ = now_ns;
+  last_execution_count_ = execution_count;
+  last_compute_duration_ns_ = compute_duration_ns;
+
+  // In the worst case a request waits for the execution that is already
+  // in flight on the instance before its own batch executes, so budget
+  // two compute times out of the target latency. These are mean compute
+  // times, not a percentile, see the class comment.
+  const double budget_ns =
+      std::max(0.0, (double)target_latency_ns_ - 2 * compute_ns_);
+
+  // The time needed for the arrivals to fill the rest of the batch.
+  double fill_ns = 0;
+  if ((target_batch_size_ > 1) && (arrival_rate_ > 0)) {
+    fill_ns = (target_batch_size_ - 1) / arrival_rate_ * 1e9;
+  }
+
+  double desired_ns =
+      std::min(std::min(fill_ns, budget_ns), (double)max_delay_ns_);
+
+  // Don't hold the batch if not even one more request is expected to
+  // arrive during the delay, e.g. when the traffic is low.
+  if ((arrival_rate_ * desired_ns / 1e9) < 1.0) {
+    desired_ns = 0;
+  }
+
+  delay_ns_ = (uint64_t)((1 - alpha) * delay_ns_ + alpha * desired_ns);
+}
+
 Status
-PriorityQueue::PolicyQueue::Enqueue(std::unique_ptr<InferenceRequest>& request)
+PriorityQueue::PolicyQueue::Enqueue(
+    std::unique_ptr<InferenceRequest>& request,
+    const uint64_t estimated_wait_ns)
 {
   if ((max_queue_size_ != 0) && (Size() >= max_queue_size_)) {
     return Status(
@@ -136,20 +235,26 @@ PriorityQueue::PolicyQueue::Enqueue(std::unique_ptr<InferenceRequest>& request)
         request->LogRequest() + "Exceeds maximum queue size");
   }
 
-  queue_.emplace_back(std::move(request));
   auto timeout_us = default_timeout_us_;
   if (allow_timeout_override_) {
-    auto override_timeout_us = queue_.back()->TimeoutMicroseconds();
+    auto override_timeout_us = request->TimeoutMicroseconds();
     if (override_timeout_us != 0 && override_timeout_us < timeout_us) {
       timeout_us = override_timeout_us;
     }
   }
+
+  // Don't queue work that is already known to miss its deadline, the
+  // request would only be rejected later after occupying the queue.
+  if ((timeout_us != 0) && (estimated_wait_ns > (timeout_us * 1000)) &&
+      (timeout_action_ == inference::ModelQueuePolicy::REJECT)) {
+    return Status(
+        Status::Code::UNAVAILABLE,
+        request->LogRequest() + "Request is expected to exceed its timeout");
+  }
+
+  queue_.emplace_back(std::move(request));
   if (timeout_us != 0) {
-    timeout_timestamp_ns_.emplace_back(
-        std::chrono::duration_cast<std::chrono::nanoseconds>(
-            std::chrono::steady_clock::now().time_since_epoch())
-            .count() +
-        timeout_us * 1000);
+    timeout_timestamp_ns_.emplace_back(SteadyClockNs() + timeout_us * 1000);
   } else {
     timeout_timestamp_ns_.emplace_back(0);
   }
@@ -176,16 +281,18 @@ bool
 PriorityQueue::PolicyQueue::ApplyPolicy(
     size_t idx, size_t* rejected_count, size_t* rejected_batch_size)
 {
-  uint64_t now_nanoseconds =
-      std::chrono::duration_cast<std::chrono::nanoseconds>(
-          std::chrono::steady_clock::now().time_since_epoch())
-          .count();
+  uint64_t now_nanoseconds = SteadyClockNs();
   if (idx < queue_.size()) {
     size_t curr_idx = idx;
     while (curr_idx < queue_.size()) {
-      if ((timeout_timestamp_ns_[curr_idx] != 0) &&
-          (now_nanoseconds > timeout_timestamp_ns_[curr_idx])) {
-        if (timeout_action_ == inference::ModelQueuePolicy::DELAY) {
+      // A cancelled request is always rejected, delaying it would only
+      // hold it in the queue longer. A request cancelled once it is in
+      // the delayed queue is rejected when its payload is executed.
+      const bool cancelled = queue_[curr_idx]->IsCancelled();
+      if (cancelled || ((timeout_timestamp_ns_[curr_idx] != 0) &&
+                        (now_nanoseconds > timeout_timestamp_ns_[curr_idx]))) {
+        if (!cancelled &&
+            (timeout_action_ == inference::ModelQueuePolicy::DELAY)) {
           delayed_queue_.emplace_back(std::move(queue_[curr_idx]));
         } else {
           rejected_queue_.emplace_back(std::move(queue_[curr_idx]));
@@ -220,6 +327,39 @@ PriorityQueue::PolicyQueue::ApplyPolicy(
   return ((idx - queue_.size()) < delayed_queue_.size());
 }
 
+bool
+PriorityQueue::PolicyQueue::Partition(
+    size_t idx,
+    const std::function<bool(const std::unique_ptr<InferenceRequest>&)>& pred)
+{
+  // Matching requests are compacted in place, any slot before 'read' has
+  // either been written or moved into 'unmatched' so it can be reused.
+  std::vector<std::pair<std::unique_ptr<InferenceRequest>, uint64_t>>
+      unmatched;
+  size_t write = idx;
+  for (size_t read = idx; read < queue_.size(); ++read) {
+    if (pred(queue_[read])) {
+      if (write != read) {
+        queue_[write] = std::move(queue_[read]);
+        timeout_timestamp_ns_[write] = timeout_timestamp_ns_[read];
+      }
+      ++write;
+    } else {
+      unmatched.emplace_back(
+          std::move(queue_[read]), timeout_timestamp_ns_[read]);
+    }
+  }
+
+  const bool found = (write != idx);
+  for (auto& pr : unmatched) {
+    queue_[write] = std::move(pr.first);
+    timeout_timestamp_ns_[write] = pr.second;
+    ++write;
+  }
+
+  return found;
+}
+
 void
 PriorityQueue::PolicyQueue::ReleaseRejectedQueue(
     std::deque<std::unique_ptr<InferenceRequest>>* requests)
@@ -255,7 +395,8 @@ PriorityQueue::PolicyQueue::ReadyForErasure()
 }
 
 PriorityQueue::PriorityQueue()
-    : size_(0), front_priority_level_(0), default_policy_()
+    : size_(0), front_priority_level_(0), default_policy_(),
+      batch_exec_ns_(0), estimate_batch_size_(1), estimate_concurrency_(1)
 {
   queues_.emplace(0, PolicyQueue(default_policy_, true));
   front_priority_level_ = queues_.begin()->first;
@@ -265,7 +406,8 @@ PriorityQueue::PriorityQueue()
 PriorityQueue::PriorityQueue(
     const inference::ModelQueuePolicy& default_queue_policy,
     uint64_t priority_levels, const ModelQueuePolicyMap queue_policy_map)
-    : size_(0), default_policy_(default_queue_policy)
+    : size_(0), default_policy_(default_queue_policy), batch_exec_ns_(0),
+      estimate_batch_size_(1), estimate_concurrency_(1)
 {
   // Permanently instantiate PolicyQueue with keep_instantiate=true
   // to prevent them from being erased & created during scheduling
@@ -291,7 +433,24 @@ PriorityQueue::Enqueue(
   // Get corresponding PolicyQueue if it exists, otherwise insert it
   // via emplace with the default policy
   auto it = queues_.insert(std::make_pair(priority_level, default_policy_));
-  auto status = it.first->second.Enqueue(request);
+
+  // Estimate how long the request waits for the requests that are ahead
+  // of it, including the batch that it will be part of.
+  uint64_t estimated_wait_ns = 0;
+  if (batch_exec_ns_ != 0) {
+    size_t ahead_count = 0;
+    for (auto qit = queues_.begin(); qit != queues_.end(); ++qit) {
+      if (qit->first > priority_level) {
+        break;
+      }
+      ahead_count += qit->second.Size();
+    }
+    const size_t batch_count =
+        (ahead_count / estimate_batch_size_ / estimate_concurrency_) + 1;
+    estimated_wait_ns = batch_count * batch_exec_ns_;
+  }
+
+  auto status = it.first->second.Enqueue(request, estimated_wait_ns);
   if (status.IsOk()) {
     size_++;
     front_priority_level_ = std::min(front_priority_level_, priority_level);
@@ -299,10 +458,7 @@ PriorityQueue::Enqueue(
     // within the pending batch. At the same priority level the request is
     // guaranteed to be after pending batch if the batch hasn't reached
     // delayed queue.
-    if (pending_cursor_.valid_ &&
-        ((priority_level < pending_cursor_.curr_it_->first) ||
-         ((priority_level == pending_cursor_.curr_it_->first) &&
-          (pending_cursor_.at_delayed_queue_)))) {
+    if (PrecedesCursor(priority_level)) {
       pending_cursor_.valid_ = false;
     }
   }
@@ -361,13 +517,41 @@ bool
 PriorityQueue::IsCursorValid()
 {
   if (pending_cursor_.valid_) {
-    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
-               std::chrono::steady_clock::now().time_since_epoch())
-               .count() < pending_cursor_.pending_batch_closest_timeout_ns_;
+    return SteadyClockNs() < pending_cursor_.pending_batch_closest_timeout_ns_;
   }
   return false;
 }
 
+bool
+PriorityQueue::PartitionAtCursor(
+    const std::function<bool(const std::unique_ptr<InferenceRequest>&)>& pred)
+{
+  if (CursorEnd()) {
+    return false;
+  }
+
+  auto& policy_queue = pending_cursor_.curr_it_->second;
+  if (pending_cursor_.queue_idx_ < policy_queue.UnexpiredSize()) {
+    policy_queue.Partition(pending_cursor_.queue_idx_, pred);
+  }
+  return pred(RequestAtCursor());
+}
+
+void
+PriorityQueue::ForEachAtCursorLevel(
+    const std::function<void(const std::unique_ptr<InferenceRequest>&)>& fn)
+{
+  if (CursorEnd()) {
+    return;
+  }
+
+  auto& policy_queue = pending_cursor_.curr_it_->second;
+  for (size_t idx = pending_cursor_.queue_idx_;
+       idx < policy_queue.UnexpiredSize(); ++idx) {
+    fn(policy_queue.At(idx));
+  }
+}
+
 PriorityQueue::Cursor::Cursor(PriorityQueues::iterator start_it)
     : curr_it_(start_it), queue_idx_(0), at_delayed_queue_(false),
       pending_batch_closest_timeout_ns_(0),
@@ -25,8 +25,12 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <deque>
+#include <limits>
 #include <unordered_map>
+#include "constants.h"
 #include "scheduler.h"
 
 namespace triton { namespace core {
@@ -40,6 +44,13 @@ struct RequiredEqualInputs {
       const bool has_optional_input);
   bool HasEqualInputs(const std::unique_ptr<InferenceRequest>& request);
   bool Initialized() { return init_; };
+  // Return to the uninitialized state, keeping the allocated storage.
+  void Reset()
+  {
+    init_ = false;
+    has_optional_input_ = false;
+    required_inputs_.clear();
+  }
 
  private:
   bool init_;
@@ -53,6 +64,74 @@ struct RequiredEqualInputs {
       required_inputs_;
 };
 
+// Return a signature of the shapes of the inputs of 'request' that are
+// listed in 'enforce_equal_shape_tensors'. Requests that can be batched
+// together have the same signature, but requests with the same signature
+// are not guaranteed to be batchable (e.g. the content of shape tensors is
+// not part of the signature).
+size_t InputShapeSignature(
+    const std::unique_ptr<InferenceRequest>& request,
+    const std::unordered_map<std::string, bool>& enforce_equal_shape_tensors);
+
+//
+// QueueDelayController
+//
+// Adjusts the maximum queue delay of a dynamic batcher online. The delay
+// is chosen to be long enough for the observed arrival rate to fill the
+// target batch size, but short enough for the request to still meet the
+// target latency given the observed compute time of the model.
+//
+// The target latency is not a percentile objective. Only the cumulative
+// compute duration and execution count of the model are sampled, so the
+// controller budgets twice the smoothed mean compute time, for the
+// execution in flight and the request's own. Tail latencies exceed the
+// target when the compute time varies widely, a target meant as a p99
+// should leave headroom for that.
+//
+class QueueDelayController {
+ public:
+  QueueDelayController(
+      const uint64_t target_latency_ns, const uint64_t max_delay_ns,
+      const uint64_t initial_delay_ns, const size_t target_batch_size);
+
+  // Record that 'count' requests have arrived. Thread-safe.
+  void RecordArrival(const size_t count) { arrival_count_ += count; }
+
+  // Return true if enough time has passed since the last update for
+  // Update() to be called again.
+  bool UpdateDue(const uint64_t now_ns) const
+  {
+    return (now_ns - last_update_ns_) >=
+           DYNAMIC_BATCHER_DELAY_UPDATE_INTERVAL_NS;
+  }
+
+  // Recompute the delay given the cumulative 'execution_count' and
+  // 'compute_duration_ns' of the model at 'now_ns'.
+  void Update(
+      const uint64_t now_ns, const uint64_t execution_count,
+      const uint64_t compute_duration_ns);
+
+  // Return the current queue delay, in nanoseconds.
+  uint64_t DelayNs() const { return delay_ns_; }
+
+ private:
+  const uint64_t target_latency_ns_;
+  const uint64_t max_delay_ns_;
+  const size_t target_batch_size_;
+
+  std::atomic<uint64_t> arrival_count_;
+  uint64_t last_update_ns_;
+  uint64_t last_execution_count_;
+  uint64_t last_compute_duration_ns_;
+
+  // Smoothed arrival rate, in requests per second, and compute time per
+  // execution, in nanoseconds.
+  double arrival_rate_;
+  double compute_ns_;
+
+  uint64_t delay_ns_;
+};
+
 //
 // PriorityQueue
 //
@@ -83,6 +162,20 @@ class PriorityQueue {
   // Dequeue the request at the front of the queue.
   Status Dequeue(std::unique_ptr<InferenceRequest>* request);
 
+  // Set the estimated time to execute a batch of up to 'batch_size'
+  // requests, with 'concurrency' batches executing at the same time. If
+  // set, Enqueue() rejects a request with a timeout when the backlog that
+  // is ahead of it is expected to take longer than the timeout. A
+  // 'batch_exec_ns' of 0 disables the estimation.
+  void SetBatchExecutionEstimate(
+      const uint64_t batch_exec_ns, const size_t batch_size,
+      const size_t concurrency)
+  {
+    batch_exec_ns_ = batch_exec_ns;
+    estimate_batch_size_ = std::max((size_t)1, batch_size);
+    estimate_concurrency_ = std::max((size_t)1, concurrency);
+  }
+
   // Retrieve the requests that are rejected based on the queue policies.
   void ReleaseRejectedRequests(
       std::shared_ptr<
@@ -132,6 +225,26 @@ class PriorityQueue {
   // batch is unchanged.
   bool IsCursorValid();
 
+  // Whether a request enqueued at 'priority_level' would be placed within
+  // the pending batch, in which case Enqueue() invalidates the cursor and
+  // the pending batch must be rebuilt to consider the request.
+  bool PrecedesCursor(const uint64_t priority_level)
+  {
+    return pending_cursor_.valid_ &&
+           ((priority_level < pending_cursor_.curr_it_->first) ||
+            ((priority_level == pending_cursor_.curr_it_->first) &&
+             pending_cursor_.at_delayed_queue_));
+  }
+
+  // Return the priority level that the cursor is at, or the maximum
+  // level if the cursor is past the last priority level.
+  uint64_t CursorPriorityLevel()
+  {
+    return (pending_cursor_.curr_it_ == queues_.end())
+               ? std::numeric_limits<uint64_t>::max()
+               : pending_cursor_.curr_it_->first;
+  }
+
   // Return the oldest queued time of requests in pending batch.
   uint64_t OldestEnqueueTime()
   {
@@ -147,6 +260,22 @@ class PriorityQueue {
   // Return the number of requests in pending batch.
   size_t PendingBatchCount() { return pending_cursor_.pending_batch_count_; }
 
+  // Reorder the unexpired requests that are at or after the cursor in the
+  // cursor's priority level so that the requests satisfying 'pred' are
+  // placed, in their original order, before the ones that don't. Requests
+  // are never moved across priority levels and the pending batch is not
+  // changed. Return whether the request at the cursor satisfies 'pred'
+  // after reordering.
+  bool PartitionAtCursor(
+      const std::function<bool(const std::unique_ptr<InferenceRequest>&)>&
+          pred);
+
+  // Invoke 'fn' on each of the unexpired requests that are at or after
+  // the cursor in the cursor's priority level.
+  void ForEachAtCursorLevel(
+      const std::function<void(const std::unique_ptr<InferenceRequest>&)>&
+          fn);
+
  private:
   class PolicyQueue {
    public:
@@ -175,8 +304,12 @@ class PriorityQueue {
     // Status::Success is returned then the queue has taken ownership
     // of the request object and so 'request' will be nullptr. If
     // non-success is returned then the caller still retains ownership
-    // of 'request'.
-    Status Enqueue(std::unique_ptr<InferenceRequest>& request);
+    // of 'request'. If 'estimated_wait_ns' is non-zero and the timeout
+    // action is REJECT, a request whose timeout is shorter than the
+    // estimated wait is rejected instead of being enqueued.
+    Status Enqueue(
+        std::unique_ptr<InferenceRequest>& request,
+        const uint64_t estimated_wait_ns = 0);
 
     // Dequeue the request at the front of the queue.
     Status Dequeue(std::unique_ptr<InferenceRequest>* request);
@@ -191,6 +324,14 @@ class PriorityQueue {
     bool ApplyPolicy(
         size_t idx, size_t* rejected_count, size_t* rejected_batch_size);
 
+    // Stable-partition the unexpired requests starting at 'idx' so that
+    // the ones satisfying 'pred' come first. Return true if any request
+    // satisfies 'pred'.
+    bool Partition(
+        size_t idx,
+        const std::function<bool(const std::unique_ptr<InferenceRequest>&)>&
+            pred);
+
     // Return the rejected requests held by the queue.
     void ReleaseRejectedQueue(
         std::deque<std::unique_ptr<InferenceRequest>>* requests);
@@ -257,6 +398,12 @@ class PriorityQueue {
   uint64_t front_priority_level_;
   inference::ModelQueuePolicy default_policy_;
 
+  // Estimate used by the deadline-aware admission on Enqueue(), see
+  // SetBatchExecutionEstimate().
+  uint64_t batch_exec_ns_;
+  size_t estimate_batch_size_;
+  size_t estimate_concurrency_;
+
   Cursor pending_cursor_;
   Cursor current_mark_;
 };
@@ -32,9 +32,12 @@
 #include <unistd.h>
 #endif
 #include <algorithm>
+#include <iterator>
+#include "clock.h"
 #include "constants.h"
 #include "dynamic_batch_scheduler.h"
 #include "model_config_utils.h"
+#include "profiling.h"
 #include "server.h"
 #include "triton/common/logging.h"
 
@@ -51,6 +54,26 @@ Now()
       .count();
 }
 
+// Return in 'key' the value of the 'sequence_affinity_key' parameter of
+// 'irequest', or an empty string if the request does not have one.
+void
+SequenceAffinityKey(const InferenceRequest& irequest, std::string* key)
+{
+  key->clear();
+  for (const auto& param : irequest.Parameters()) {
+    if (param.Name() != "sequence_affinity_key") {
+      continue;
+    }
+    if (param.Type() == TRITONSERVER_PARAMETER_STRING) {
+      *key = reinterpret_cast<const char*>(param.ValuePointer());
+    } else if (param.Type() == TRITONSERVER_PARAMETER_INT) {
+      *key = std::to_string(
+          *reinterpret_cast<const int64_t*>(param.ValuePointer()));
+    }
+    break;
+  }
+}
+
 }  // namespace
 
 Status
@@ -79,8 +102,36 @@ SequenceBatchScheduler::Create(
   sched->max_sequence_idle_microseconds_ =
       config.sequence_batching().max_sequence_idle_microseconds();
 
+  // A sequence idle for this long gives up its sequence slot when there
+  // are sequences waiting in the backlog. Its implicit state is kept in
+  // pinned host memory until the sequence gets a slot again.
+  int64_t suspend_idle_us = 0;
+  RETURN_IF_ERROR(GetInt64ModelParameter(
+      config, "TRITON_SEQUENCE_BATCHER_STATE_SPILL_IDLE_MICROSECONDS",
+      0 /* default_value */, &suspend_idle_us));
+  sched->suspend_idle_microseconds_ = std::max<int64_t>(0, suspend_idle_us);
+
+  // Under overload, keep at most this many sequences in the backlog by
+  // rejecting the lowest priority ones.
+  int64_t max_backlog_sequences = 0;
+  RETURN_IF_ERROR(GetInt64ModelParameter(
+      config, "TRITON_SEQUENCE_BATCHER_MAX_BACKLOG_SEQUENCES",
+      0 /* default_value */, &max_backlog_sequences));
+  sched->max_backlog_sequences_ = std::max<int64_t>(0, max_backlog_sequences);
+
   sched->max_batch_size_ = config.max_batch_size();
 
+#ifdef TRITON_ENABLE_METRICS
+  // The Oldest batchers report their batches through their dynamic
+  // batcher instead.
+  if (Metrics::Enabled() && !config.sequence_batching().has_oldest()) {
+    MetricModelReporter::Create(
+        model->Name(), model->Version(), METRIC_REPORTER_ID_RESPONSE_CACHE,
+        false /* response_cache_enabled */, config.metric_tags(),
+        &sched->reporter_);
+  }
+#endif  // TRITON_ENABLE_METRICS
+
   // Implicit States
   auto& states = config.sequence_batching().state();
 
@@ -162,7 +213,7 @@ SequenceBatchScheduler::Create(
       // All sequence slots in the batcher are initially ready for a
       // new sequence.
       for (size_t b = 0; b < seq_slot_cnt; ++b) {
-        sched->ready_batcher_seq_slots_.push(
+        sched->AddReadySequenceSlot(
             SequenceBatchScheduler::BatcherSequenceSlot(index, b));
       }
     }
@@ -525,6 +576,8 @@ SequenceBatchScheduler::CreateBooleanControlTensors(
 Status
 SequenceBatchScheduler::Enqueue(std::unique_ptr<InferenceRequest>& irequest)
 {
+  PROFILE_RANGE(range, "SequenceBatcher Enqueue");
+
   // Queue timer starts at the beginning of the queueing and
   // scheduling process
   irequest->CaptureQueueStartNs();
@@ -574,19 +627,48 @@ SequenceBatchScheduler::Enqueue(std::unique_ptr<InferenceRequest>& irequest)
         "inference requests");
   }
 
+  uint64_t now_us = Now<std::chrono::microseconds>();
+  SequenceShard& shard = Shard(correlation_id);
+
+  // A request continuing a sequence that has a sequence slot is enqueued
+  // while only holding the lock of the shard of the sequence.
+  if (!seq_start) {
+    std::unique_lock<std::mutex> shard_lock(shard.mu_);
+    auto sb_itr = shard.sequence_to_batcherseqslot_map_.find(correlation_id);
+    if (sb_itr != shard.sequence_to_batcherseqslot_map_.end()) {
+      RecordRequestTimestamp(&shard, correlation_id, now_us);
+      const size_t batcher_idx = sb_itr->second.batcher_idx_;
+      const uint32_t seq_slot = sb_itr->second.seq_slot_;
+      if (seq_end) {
+        shard.sequence_to_batcherseqslot_map_.erase(sb_itr);
+      }
+      shard_lock.unlock();
+
+      LOG_VERBOSE(1) << "Enqueuing CORRID " << correlation_id
+                     << " into batcher " << batcher_idx << ", sequence slot "
+                     << seq_slot << ": " << irequest->ModelName();
+
+      batchers_[batcher_idx]->Enqueue(seq_slot, correlation_id, irequest);
+      return Status::Success;
+    }
+  }
+
   bool wake_reaper_thread = false;
   std::unique_lock<std::mutex> lock(mu_);
+  std::unique_lock<std::mutex> shard_lock(shard.mu_);
 
-  auto sb_itr = sequence_to_batcherseqslot_map_.find(correlation_id);
-  auto bl_itr = sequence_to_backlog_map_.find(correlation_id);
+  auto& sequence_to_batcherseqslot_map = shard.sequence_to_batcherseqslot_map_;
+  auto& sequence_to_backlog_map = shard.sequence_to_backlog_map_;
+  auto sb_itr = sequence_to_batcherseqslot_map.find(correlation_id);
+  auto bl_itr = sequence_to_backlog_map.find(correlation_id);
 
   // If this request is not starting a new sequence its correlation ID
   // should already be known with a target in either a sequence slot
   // or in the backlog. If it doesn't then the sequence wasn't started
   // correctly or there has been a correlation ID conflict. In either
   // case fail this request.
-  if (!seq_start && (sb_itr == sequence_to_batcherseqslot_map_.end()) &&
-      (bl_itr == sequence_to_backlog_map_.end())) {
+  if (!seq_start && (sb_itr == sequence_to_batcherseqslot_map.end()) &&
+      (bl_itr == sequence_to_backlog_map.end())) {
     std::string correlation_id_str{""};
     if (correlation_id.Type() ==
         InferenceRequest::SequenceId::DataType::STRING) {
@@ -609,8 +691,7 @@ SequenceBatchScheduler::Enqueue(std::unique_ptr<InferenceRequest>& irequest)
   // max_sequence_idle_microseconds value is not exceed for any
   // sequence, and if it is it will release the sequence slot (if any)
   // allocated to that sequence.
-  uint64_t now_us = Now<std::chrono::microseconds>();
-  correlation_id_timestamps_[correlation_id] = now_us;
+  RecordRequestTimestamp(&shard, correlation_id, now_us);
 
   // If this request starts a new sequence but the correlation ID
   // already has an in-progress sequence then that previous sequence
@@ -620,8 +701,8 @@ SequenceBatchScheduler::Enqueue(std::unique_ptr<InferenceRequest>& irequest)
   // starts... as long as it has a single end. The previous sequence
   // that was not correctly ended will have its existing requests
   // handled and then the new sequence will start.
-  if (seq_start && ((sb_itr != sequence_to_batcherseqslot_map_.end()) ||
-                    (bl_itr != sequence_to_backlog_map_.end()))) {
+  if (seq_start && ((sb_itr != sequence_to_batcherseqslot_map.end()) ||
+                    (bl_itr != sequence_to_backlog_map.end()))) {
     LOG_WARNING
         << "sequence " << correlation_id << " for model '"
         << irequest->ModelName()
@@ -630,11 +711,11 @@ SequenceBatchScheduler::Enqueue(std::unique_ptr<InferenceRequest>& irequest)
   }
 
   // This request already has an assigned slot...
-  if (sb_itr != sequence_to_batcherseqslot_map_.end()) {
+  if (sb_itr != sequence_to_batcherseqslot_map.end()) {
     target = &sb_itr->second;
   }
   // This request already has a queue in the backlog...
-  else if (bl_itr != sequence_to_backlog_map_.end()) {
+  else if (bl_itr != sequence_to_backlog_map.end()) {
     LOG_VERBOSE(1) << "Enqueuing CORRID " << correlation_id
                    << " into existing backlog: " << irequest->ModelName();
 
@@ -650,12 +731,18 @@ SequenceBatchScheduler::Enqueue(std::unique_ptr<InferenceRequest>& irequest)
     }
     backlog->queue_->emplace_back(std::move(irequest));
 
+    // A suspended sequence waits for a slot again once it has a request.
+    const bool resumed = !backlog->queued_ && backlog->state_ready_;
+    if (resumed) {
+      PushBacklogQueue(backlog);
+    }
+
     // If the sequence is ending then forget correlation ID
     // connection to this backlog queue. If another sequence starts
     // with the same correlation ID it will be collected in another
     // backlog queue.
     if (seq_end) {
-      sequence_to_backlog_map_.erase(bl_itr);
+      sequence_to_backlog_map.erase(bl_itr);
     }
 
     // Waking up reaper so it received latest timeout to be waited for,
@@ -663,15 +750,24 @@ SequenceBatchScheduler::Enqueue(std::unique_ptr<InferenceRequest>& irequest)
     if (wake_reaper_thread) {
       reaper_cv_.notify_all();
     }
+
+    if (resumed) {
+      std::vector<std::shared_ptr<BacklogQueue>> shed;
+      shard_lock.unlock();
+      ShedBacklogQueues(&shed);
+      lock.unlock();
+      RejectShedBacklogQueues(shed);
+    }
     return Status::Success;
   }
   // This request does not have an assigned backlog or sequence
   // slot. By the above checks it must be starting. If there is a free
   // sequence slot available then assign this sequence to that slot...
   else if (!ready_batcher_seq_slots_.empty()) {
-    target = &sequence_to_batcherseqslot_map_[correlation_id];
-    *target = ready_batcher_seq_slots_.top();
-    ready_batcher_seq_slots_.pop();
+    std::string affinity_key;
+    SequenceAffinityKey(*irequest, &affinity_key);
+    target = &sequence_to_batcherseqslot_map[correlation_id];
+    *target = TakeReadySequenceSlot(affinity_key);
   }
   // Last option is to assign this request to the backlog...
   else {
@@ -686,10 +782,10 @@ SequenceBatchScheduler::Enqueue(std::unique_ptr<InferenceRequest>& irequest)
         wake_reaper_thread = true;
       }
     }
-    backlog_queues_.push_back(backlog);
     backlog->queue_->emplace_back(std::move(irequest));
+    PushBacklogQueue(backlog);
     if (!seq_end) {
-      sequence_to_backlog_map_[correlation_id] = std::move(backlog);
+      sequence_to_backlog_map[correlation_id] = std::move(backlog);
     }
 
     // Waking up reaper so it received latest timeout to be waited for,
@@ -697,6 +793,12 @@ SequenceBatchScheduler::Enqueue(std::unique_ptr<InferenceRequest>& irequest)
     if (wake_reaper_thread) {
       reaper_cv_.notify_all();
     }
+
+    std::vector<std::shared_ptr<BacklogQueue>> shed;
+    shard_lock.unlock();
+    ShedBacklogQueues(&shed);
+    lock.unlock();
+    RejectShedBacklogQueues(shed);
     return Status::Success;
   }
 
@@ -709,11 +811,12 @@ SequenceBatchScheduler::Enqueue(std::unique_ptr<InferenceRequest>& irequest)
   // slot. If the sequence is ending then stop tracking the
   // correlation.
   if (seq_end) {
-    sequence_to_batcherseqslot_map_.erase(correlation_id);
+    sequence_to_batcherseqslot_map.erase(correlation_id);
   }
 
   // Enqueue request into batcher and sequence slot.  Don't hold the
   // lock while enqueuing in a specific batcher.
+  shard_lock.unlock();
   lock.unlock();
 
   LOG_VERBOSE(1) << "Enqueuing CORRID " << correlation_id << " into batcher "
@@ -724,18 +827,193 @@ SequenceBatchScheduler::Enqueue(std::unique_ptr<InferenceRequest>& irequest)
   return Status::Success;
 }
 
+void
+SequenceBatchScheduler::AddReadySequenceSlot(const BatcherSequenceSlot& slot)
+{
+  ready_batcher_seq_slots_.insert(slot);
+  if (batcher_ready_seq_slots_.size() <= slot.batcher_idx_) {
+    batcher_ready_seq_slots_.resize(slot.batcher_idx_ + 1);
+  }
+  batcher_ready_seq_slots_[slot.batcher_idx_].insert(slot.seq_slot_);
+}
+
+SequenceBatchScheduler::BatcherSequenceSlot
+SequenceBatchScheduler::TakeReadySequenceSlot(const std::string& affinity_key)
+{
+  auto ab_itr = affinity_key.empty() ? affinity_batchers_.end()
+                                     : affinity_batchers_.find(affinity_key);
+
+  // Take the lowest ready slot of the preferred batcher, or the lowest
+  // ready slot if the batcher has none.
+  BatcherSequenceSlot slot = *ready_batcher_seq_slots_.begin();
+  if (ab_itr != affinity_batchers_.end()) {
+    const auto& preferred = batcher_ready_seq_slots_[ab_itr->second];
+    if (!preferred.empty()) {
+      slot = BatcherSequenceSlot(ab_itr->second, *preferred.begin());
+    }
+  }
+  ready_batcher_seq_slots_.erase(slot);
+  batcher_ready_seq_slots_[slot.batcher_idx_].erase(slot.seq_slot_);
+
+  if (ab_itr != affinity_batchers_.end()) {
+    ab_itr->second = slot.batcher_idx_;
+  } else if (!affinity_key.empty()) {
+    if (affinity_batchers_.size() >= MAX_AFFINITY_KEYS) {
+      affinity_batchers_.erase(affinity_batchers_.begin());
+    }
+    affinity_batchers_.emplace(affinity_key, slot.batcher_idx_);
+  }
+  return slot;
+}
+
+void
+SequenceBatchScheduler::RecordRequestTimestamp(
+    SequenceShard* shard, const InferenceRequest::SequenceId& correlation_id,
+    const uint64_t now_us)
+{
+  auto ts_itr = shard->correlation_id_timestamps_.find(correlation_id);
+  if (ts_itr != shard->correlation_id_timestamps_.end()) {
+    ts_itr->second.last_us_ = now_us;
+  } else {
+    const uint64_t deadline_us = now_us + FirstIdleMicroseconds();
+    shard->correlation_id_timestamps_.emplace(
+        correlation_id, IdleTimestamp{now_us, deadline_us});
+    shard->idle_deadlines_.push(IdleDeadline{deadline_us, correlation_id});
+  }
+}
+
+void
+SequenceBatchScheduler::PushBacklogQueue(
+    const std::shared_ptr<BacklogQueue>& backlog)
+{
+  // Priority 0 means the request has no priority, serve it after all
+  // the sequences that have one.
+  const uint64_t priority = backlog->queue_->front()->Priority();
+  backlog->priority_ = (priority == 0) ? UINT64_MAX : priority;
+  backlog->queued_ = true;
+
+  // Most queues share the same priority so search from the back.
+  auto it = backlog_queues_.end();
+  while ((it != backlog_queues_.begin()) &&
+         ((*std::prev(it))->priority_ > backlog->priority_)) {
+    --it;
+  }
+  backlog_queues_.insert(it, backlog);
+}
+
+void
+SequenceBatchScheduler::ShedBacklogQueues(
+    std::vector<std::shared_ptr<BacklogQueue>>* shed)
+{
+  if (max_backlog_sequences_ == 0) {
+    return;
+  }
+
+  while (backlog_queues_.size() > max_backlog_sequences_) {
+    std::shared_ptr<BacklogQueue> backlog = std::move(backlog_queues_.back());
+    backlog_queues_.pop_back();
+
+    // Later requests of the sequence are rejected as the sequence is no
+    // longer known.
+    const auto& correlation_id = backlog->queue_->front()->CorrelationId();
+    LOG_VERBOSE(1) << "Shedding backlogged CORRID " << correlation_id
+                   << " of priority " << backlog->priority_;
+    SequenceShard& shard = Shard(correlation_id);
+    {
+      std::lock_guard<std::mutex> shard_lock(shard.mu_);
+      const auto& mit = shard.sequence_to_backlog_map_.find(correlation_id);
+      if ((mit != shard.sequence_to_backlog_map_.end()) &&
+          (mit->second == backlog)) {
+        shard.sequence_to_backlog_map_.erase(mit);
+      }
+    }
+    shed->emplace_back(std::move(backlog));
+  }
+}
+
+void
+SequenceBatchScheduler::RejectShedBacklogQueues(
+    const std::vector<std::shared_ptr<BacklogQueue>>& shed)
+{
+  static Status rejected_status = Status(
+      Status::Code::UNAVAILABLE,
+      "sequence was removed from the backlog of the overloaded sequence "
+      "batcher");
+  for (const auto& backlog : shed) {
+    for (auto& req : *backlog->queue_) {
+      InferenceRequest::RespondIfError(req, rejected_status, true);
+    }
+  }
+}
+
+void
+SequenceBatchScheduler::SuspendSequence(
+    SequenceShard* shard, const InferenceRequest::SequenceId& correlation_id,
+    BatcherSequenceSlotMap* force_end_sequences)
+{
+  auto sb_itr = shard->sequence_to_batcherseqslot_map_.find(correlation_id);
+  if (sb_itr == shard->sequence_to_batcherseqslot_map_.end()) {
+    return;
+  }
+
+  LOG_VERBOSE(1) << "Reaper: suspending idle CORRID " << correlation_id
+                 << " in batcher " << sb_itr->second.batcher_idx_ << ", slot "
+                 << sb_itr->second.seq_slot_;
+
+  // Later requests of the sequence are collected in a backlog queue that
+  // only waits for a slot once the released slot has handed over the
+  // state of the sequence.
+  auto backlog = std::make_shared<BacklogQueue>();
+  backlog->queued_ = false;
+  backlog->state_ready_ = false;
+  shard->sequence_to_backlog_map_[correlation_id] = backlog;
+  suspended_slots_[std::make_pair(
+      sb_itr->second.batcher_idx_, sb_itr->second.seq_slot_)] =
+      std::move(backlog);
+
+  (*force_end_sequences)[correlation_id] = sb_itr->second;
+  shard->sequence_to_batcherseqslot_map_.erase(sb_itr);
+}
+
 InferenceRequest::SequenceId
 SequenceBatchScheduler::ReleaseSequenceSlot(
     const BatcherSequenceSlot& batcher_seq_slot,
-    std::deque<std::unique_ptr<InferenceRequest>>* requests)
+    std::deque<std::unique_ptr<InferenceRequest>>* requests,
+    std::shared_ptr<SequenceStates>* sequence_states)
 {
   std::unique_lock<std::mutex> lock(mu_);
 
+  // If the sequence leaving the slot is suspended then hand its state
+  // over to its backlog queue, which can now wait for a slot.
+  auto ss_itr = suspended_slots_.find(std::make_pair(
+      batcher_seq_slot.batcher_idx_, batcher_seq_slot.seq_slot_));
+  if (ss_itr != suspended_slots_.end()) {
+    auto& suspended = ss_itr->second;
+    if (*sequence_states != nullptr) {
+      Status status = (*sequence_states)->SpillToHost();
+      if (!status.IsOk()) {
+        LOG_ERROR << "failed to spill the state of the sequence suspended "
+                     "in batcher "
+                  << batcher_seq_slot.batcher_idx_ << ", slot "
+                  << batcher_seq_slot.seq_slot_ << ": " << status.Message();
+      }
+      suspended->suspended_states_ = std::move(*sequence_states);
+    }
+    suspended->state_ready_ = true;
+    if (!suspended->queue_->empty() && !suspended->queued_) {
+      PushBacklogQueue(suspended);
+    }
+    suspended_slots_.erase(ss_itr);
+  }
+
   // If there is a backlogged sequence and it is requested, return it
   // so that it can use the newly available sequence slot.
   if (!backlog_queues_.empty()) {
     auto& backlog = backlog_queues_.front()->queue_;
     *requests = std::move(*backlog);
+    if (backlog_queues_.front()->suspended_states_ != nullptr) {
+      *sequence_states = std::move(backlog_queues_.front()->suspended_states_);
+    }
     backlog_queues_.pop_front();
     if (!requests->empty()) {  // should never be empty...
       const auto& irequest = requests->back();
@@ -750,19 +1028,23 @@ SequenceBatchScheduler::ReleaseSequenceSlot(
       const bool seq_end =
           ((irequest->Flags() & TRITONSERVER_REQUEST_FLAG_SEQUENCE_END) != 0);
       if (!seq_end) {
+        SequenceShard& shard = Shard(correlation_id);
+        std::lock_guard<std::mutex> shard_lock(shard.mu_);
+
         // Since the correlation ID is being actively collected in the
         // backlog, there should not be any in-flight sequences with
         // that same correlation ID that have an assigned slot.
-        if (sequence_to_batcherseqslot_map_.find(correlation_id) !=
-            sequence_to_batcherseqslot_map_.end()) {
+        if (shard.sequence_to_batcherseqslot_map_.find(correlation_id) !=
+            shard.sequence_to_batcherseqslot_map_.end()) {
           LOG_ERROR << irequest->LogRequest() << "internal: backlog sequence "
                     << correlation_id
                     << " conflicts with in-flight sequence for model '"
                     << irequest->ModelName() << "'";
         }
 
-        sequence_to_backlog_map_.erase(correlation_id);
-        sequence_to_batcherseqslot_map_[correlation_id] = batcher_seq_slot;
+        shard.sequence_to_backlog_map_.erase(correlation_id);
+        shard.sequence_to_batcherseqslot_map_[correlation_id] =
+            batcher_seq_slot;
       }
 
       LOG_VERBOSE(1) << irequest->LogRequest() << "CORRID " << correlation_id
@@ -777,7 +1059,7 @@ SequenceBatchScheduler::ReleaseSequenceSlot(
   LOG_VERBOSE(1) << "Freeing slot in batcher " << batcher_seq_slot.batcher_idx_
                  << ", slot " << batcher_seq_slot.seq_slot_;
 
-  ready_batcher_seq_slots_.push(batcher_seq_slot);
+  AddReadySequenceSlot(batcher_seq_slot);
   return InferenceRequest::SequenceId();
 }
 
@@ -830,7 +1112,7 @@ SequenceBatchScheduler::ReaperThread(const int nice)
   const uint64_t backlog_idle_wait_microseconds = 50 * 1000;
 
   uint64_t idle_timestamp =
-      Now<std::chrono::microseconds>() + max_sequence_idle_microseconds_;
+      Now<std::chrono::microseconds>() + FirstIdleMicroseconds();
   timeout_timestamp_ = std::numeric_limits<uint64_t>::max();
 
   while (!reaper_thread_exit_) {
@@ -838,58 +1120,119 @@ SequenceBatchScheduler::ReaperThread(const int nice)
 
     // Reap idle assigned sequence
     if (now_us >= idle_timestamp) {
-      uint64_t wait_microseconds = max_sequence_idle_microseconds_;
       BatcherSequenceSlotMap force_end_sequences;
-      {
-        std::unique_lock<std::mutex> lock(mu_);
-        for (auto cid_itr = correlation_id_timestamps_.cbegin();
-             cid_itr != correlation_id_timestamps_.cend();) {
-          int64_t remaining_microseconds =
-              (int64_t)max_sequence_idle_microseconds_ -
-              (now_us - cid_itr->second);
-          if (remaining_microseconds > 0) {
-            wait_microseconds = std::min(
-                wait_microseconds, (uint64_t)remaining_microseconds + 1);
-            ++cid_itr;
+      // Wake up for the earliest deadline. Without any, the deadline of a
+      // new correlation ID is at least the idle time from now.
+      idle_timestamp = now_us + FirstIdleMicroseconds();
+
+      // Suspending a sequence updates the backlog so 'mu_' must be held
+      // while visiting the shards.
+      std::unique_lock<std::mutex> lock(mu_, std::defer_lock);
+      if (suspend_idle_microseconds_ != 0) {
+        lock.lock();
+      }
+      for (auto& shard : sequence_shards_) {
+        std::unique_lock<std::mutex> shard_lock(shard.mu_);
+        auto& idle_deadlines = shard.idle_deadlines_;
+        auto& correlation_id_timestamps = shard.correlation_id_timestamps_;
+        while (!idle_deadlines.empty() &&
+               (idle_deadlines.top().deadline_us_ <= now_us)) {
+          const IdleDeadline deadline = idle_deadlines.top();
+          idle_deadlines.pop();
+          auto cid_itr =
+              correlation_id_timestamps.find(deadline.correlation_id_);
+          if ((cid_itr == correlation_id_timestamps.end()) ||
+              (cid_itr->second.deadline_us_ != deadline.deadline_us_)) {
             continue;
           }
 
           const InferenceRequest::SequenceId& idle_correlation_id =
               cid_itr->first;
+
+          // The sequence received a request since the deadline was set,
+          // or the deadline was for suspending the sequence. Move the
+          // deadline to the next check of the sequence.
+          const uint64_t idle_deadline_us =
+              cid_itr->second.last_us_ + max_sequence_idle_microseconds_;
+          if (idle_deadline_us > now_us) {
+            uint64_t next_deadline_us = idle_deadline_us;
+            if (suspend_idle_microseconds_ != 0) {
+              const uint64_t suspend_deadline_us =
+                  cid_itr->second.last_us_ + suspend_idle_microseconds_;
+              // Only suspend as many sequences as are needed to give
+              // every backlogged sequence a slot, otherwise check again
+              // later in case a sequence is backlogged by then.
+              if (suspend_deadline_us > now_us) {
+                next_deadline_us = suspend_deadline_us;
+              } else if (backlog_queues_.size() > suspended_slots_.size()) {
+                SuspendSequence(
+                    &shard, idle_correlation_id, &force_end_sequences);
+              } else if (
+                  shard.sequence_to_batcherseqslot_map_.find(
+                      idle_correlation_id) !=
+                  shard.sequence_to_batcherseqslot_map_.end()) {
+                next_deadline_us = std::min(
+                    idle_deadline_us,
+                    now_us + backlog_idle_wait_microseconds);
+              }
+            }
+            cid_itr->second.deadline_us_ = next_deadline_us;
+            idle_deadlines.push(
+                IdleDeadline{next_deadline_us, deadline.correlation_id_});
+            continue;
+          }
+
           LOG_VERBOSE(1) << "Reaper: CORRID " << idle_correlation_id
                          << ": max sequence idle exceeded";
 
           auto idle_sb_itr =
-              sequence_to_batcherseqslot_map_.find(idle_correlation_id);
+              shard.sequence_to_batcherseqslot_map_.find(idle_correlation_id);
 
           // If the idle correlation ID has an assigned sequence slot,
           // then release that assignment so it becomes available for
           // another sequence. Release is done by enqueuing and must be
           // done outside the lock, so just collect needed info here.
-          if (idle_sb_itr != sequence_to_batcherseqslot_map_.end()) {
+          if (idle_sb_itr != shard.sequence_to_batcherseqslot_map_.end()) {
             force_end_sequences[idle_correlation_id] = idle_sb_itr->second;
 
-            sequence_to_batcherseqslot_map_.erase(idle_correlation_id);
-            cid_itr = correlation_id_timestamps_.erase(cid_itr);
+            shard.sequence_to_batcherseqslot_map_.erase(idle_sb_itr);
+            correlation_id_timestamps.erase(cid_itr);
           } else {
             // If the idle correlation ID is in the backlog, then just
             // need to increase the timeout so that we revisit it again in
             // the future to check if it is assigned to a sequence slot.
             auto idle_bl_itr =
-                sequence_to_backlog_map_.find(idle_correlation_id);
-            if (idle_bl_itr != sequence_to_backlog_map_.end()) {
+                shard.sequence_to_backlog_map_.find(idle_correlation_id);
+            if ((idle_bl_itr != shard.sequence_to_backlog_map_.end()) &&
+                !idle_bl_itr->second->queued_) {
+              // A suspended sequence without requests has no slot to
+              // release, just forget the sequence.
+              LOG_VERBOSE(1) << "Reaper: ending suspended CORRID "
+                             << idle_correlation_id;
+              shard.sequence_to_backlog_map_.erase(idle_bl_itr);
+              correlation_id_timestamps.erase(cid_itr);
+            } else if (idle_bl_itr != shard.sequence_to_backlog_map_.end()) {
               LOG_VERBOSE(1)
                   << "Reaper: found idle CORRID " << idle_correlation_id;
-              wait_microseconds =
-                  std::min(wait_microseconds, backlog_idle_wait_microseconds);
-              ++cid_itr;
+              cid_itr->second.deadline_us_ =
+                  now_us + backlog_idle_wait_microseconds;
+              idle_deadlines.push(IdleDeadline{
+                  cid_itr->second.deadline_us_, deadline.correlation_id_});
             } else {
               LOG_VERBOSE(1) << "Reaper: ignoring stale idle CORRID "
                              << idle_correlation_id;
-              cid_itr = correlation_id_timestamps_.erase(cid_itr);
+              correlation_id_timestamps.erase(cid_itr);
             }
           }
         }
+        if (!idle_deadlines.empty()) {
+          idle_timestamp =
+              std::min(idle_timestamp, idle_deadlines.top().deadline_us_);
+        }
+      }
+
+      if (lock.owns_lock()) {
+        lock.unlock();
       }
 
       // Enqueue force-ends outside of the lock.
@@ -911,8 +1254,6 @@ SequenceBatchScheduler::ReaperThread(const int nice)
             seq_slot, idle_correlation_id, null_request);
       }
 
-      // Update timestamp for next idle check
-      idle_timestamp = now_us + wait_microseconds;
     }
 
     // Reap timed out backlog sequence
@@ -938,10 +1279,13 @@ SequenceBatchScheduler::ReaperThread(const int nice)
             // Need to double check on 'sequence_to_backlog_map_', it may
             // be tracking a new sequence with the same ID which may not be
             // timing out.
-            const auto& mit = sequence_to_backlog_map_.find(correlation_id);
-            if ((mit != sequence_to_backlog_map_.end()) &&
+            SequenceShard& shard = Shard(correlation_id);
+            std::lock_guard<std::mutex> shard_lock(shard.mu_);
+            const auto& mit =
+                shard.sequence_to_backlog_map_.find(correlation_id);
+            if ((mit != shard.sequence_to_backlog_map_.end()) &&
                 (mit->second->expiration_timestamp_ <= now_us)) {
-              sequence_to_backlog_map_.erase(mit);
+              shard.sequence_to_backlog_map_.erase(mit);
             }
 
             it = backlog_queues_.erase(it);
@@ -997,7 +1341,7 @@ SequenceBatch::SequenceBatch(
       startend_input_overrides_(startend_input_overrides),
       continue_input_overrides_(continue_input_overrides),
       notready_input_overrides_(notready_input_overrides),
-      sequence_states_(seq_slot_cnt)
+      seq_slot_corrid_overrides_(seq_slot_cnt), sequence_states_(seq_slot_cnt)
 {
 }
 
@@ -1083,8 +1427,18 @@ SequenceBatch::SetControlTensors(
     irequest->AddOverrideInput(control);
   }
 
-  // Set correlation ID control tensor if requested by the model.
+  // Set correlation ID control tensor if requested by the model. Requests
+  // of the same sequence share the override created for the sequence.
+  // Null requests share their own override so that padding a slot doesn't
+  // replace the override of the sequence in the slot.
   if (seq_slot_corrid_override_ != nullptr) {
+    auto& slot_override = not_ready ? null_corrid_override_
+                                    : seq_slot_corrid_overrides_[seq_slot];
+    if ((slot_override.second != nullptr) && (slot_override.first == corrid)) {
+      irequest->AddOverrideInput(slot_override.second);
+      return;
+    }
+
     auto& seq_corr_id = seq_slot_corrid_override_;
     size_t size_p = triton::common::GetDataTypeByteSize(seq_corr_id->DType());
     if (seq_corr_id->DType() == inference::DataType::TYPE_STRING) {
@@ -1132,6 +1486,8 @@ SequenceBatch::SetControlTensors(
       const char* corrid_ptr = reinterpret_cast<const char*>(&correlation_id);
       memcpy(corrid_p_ptr, corrid_ptr, size_p);
     }
+    slot_override.first = corrid;
+    slot_override.second = override;
     irequest->AddOverrideInput(override);
   }
 }
@@ -1154,13 +1510,50 @@ SequenceBatch::UpdateImplicitState(
       sequence_states.reset(new SequenceStates);
       sequence_states->Initialize(
           base_->StateOutputConfigMap(), base_->MaxBatchSize(),
-          base_->InitialState());
+          base_->InitialState(),
+          resident_state_buffers_.empty() ? nullptr
+                                          : &resident_state_buffers_[seq_slot]);
     }
 
     irequest->SetSequenceStates(sequence_states);
   }
 }
 
+void
+SequenceBatch::InitializeResidentStateBuffers(
+    const TritonModelInstance* model_instance)
+{
+  if (base_->StateOutputConfigMap().empty()) {
+    return;
+  }
+
+  // The buffers are only reused once the previous sequence in the slot
+  // has executed its last request, which both strategies guarantee as
+  // they execute at most one request of a slot at a time.
+  const auto& config = model_instance->Model()->Config();
+  bool resident_state = false;
+  Status status = GetBoolModelParameter(
+      config, "TRITON_SEQUENCE_BATCHER_RESIDENT_STATE",
+      false /* default_value */, &resident_state);
+  if (!status.IsOk()) {
+    LOG_WARNING << "Failed to read resident state parameter of model "
+                << config.name() << ": " << status.Message();
+    return;
+  }
+  if (!resident_state) {
+    return;
+  }
+
+  const bool on_gpu =
+      (model_instance->Kind() == TRITONSERVER_INSTANCEGROUPKIND_GPU);
+  resident_state_buffers_.resize(seq_slot_cnt_);
+  for (auto& buffers : resident_state_buffers_) {
+    buffers.memory_type_ =
+        on_gpu ? TRITONSERVER_MEMORY_GPU : TRITONSERVER_MEMORY_CPU_PINNED;
+    buffers.memory_type_id_ = on_gpu ? model_instance->DeviceId() : 0;
+  }
+}
+
 DirectSequenceBatch::DirectSequenceBatch(
     SequenceBatchScheduler* base, const uint32_t batcher_idx,
     const size_t seq_slot_cnt, TritonModelInstance* model_instance,
@@ -1200,6 +1593,19 @@ DirectSequenceBatch::DirectSequenceBatch(
       config.sequence_batching().direct().minimum_slot_utilization();
   pending_batch_delay_ns_ =
       config.sequence_batching().direct().max_queue_delay_microseconds() * 1000;
+  InitializeResidentStateBuffers(model_instance_);
+
+  // With continuous batching the model must identify the sequences by
+  // their correlation ID or implicit state rather than by batch index.
+  continuous_batching_ = false;
+  Status status = GetBoolModelParameter(
+      config, "TRITON_SEQUENCE_BATCHER_CONTINUOUS_BATCHING",
+      false /* default_value */, &continuous_batching_);
+  if (!status.IsOk()) {
+    LOG_WARNING << "Failed to read continuous batching parameter of model "
+                << config.name() << ": " << status.Message();
+    continuous_batching_ = false;
+  }
 
   // Create a scheduler thread associated with 'batcher_idx' that
   // executes the queued requests.
@@ -1304,7 +1710,12 @@ DirectSequenceBatch::BatcherThread(const int nice)
   const bool check_input =
       !enforce_equal_shape_tensors_.empty() || has_optional_input_;
   while (!scheduler_thread_exit_) {
+    PROFILE_RANGE(range, "SequenceBatcher");
     uint64_t wait_microseconds = default_wait_microseconds;
+#ifdef TRITON_ENABLE_METRICS
+    // The number of pending requests when the batch is formed
+    size_t queue_depth = 0;
+#endif  // TRITON_ENABLE_METRICS
 
     // Wait till execution of the last enqueued payload is
     // complete.
@@ -1366,13 +1777,17 @@ DirectSequenceBatch::BatcherThread(const int nice)
               SequenceBatchScheduler::BatcherSequenceSlot batcher_seq_slot(
                   batcher_idx_, seq_slot);
               seq_slot_correlation_ids_[seq_slot] =
-                  base_->ReleaseSequenceSlot(batcher_seq_slot, &queue);
+                  base_->ReleaseSequenceSlot(
+                      batcher_seq_slot, &queue, &sequence_states_[seq_slot]);
             }
           }
 
           // Need to check queue again for contents since if released
           // above it may now be empty...
           if (!queue.empty()) {
+#ifdef TRITON_ENABLE_METRICS
+            queue_depth += queue.size();
+#endif  // TRITON_ENABLE_METRICS
             // For NULL requests need an InferenceRequest that can be
             // batched but has controls set to "not ready". Any
             // request can serve this purpose so grab a copy of the
@@ -1416,7 +1831,7 @@ DirectSequenceBatch::BatcherThread(const int nice)
             // batch, execute now if queuing delay is exceeded or the batch
             // size is large enough. Otherwise create a timer to wakeup a
             // thread to check again at the maximum allowed delay.
-            uint64_t now_ns = Now<std::chrono::nanoseconds>();
+            uint64_t now_ns = SteadyClockNs();
             uint64_t current_batch_delay_ns =
                 (now_ns - earliest_enqueue_time_ns);
             if ((current_batch_delay_ns > pending_batch_delay_ns_) ||
@@ -1468,6 +1883,12 @@ DirectSequenceBatch::BatcherThread(const int nice)
             }
           }
 
+          // With continuous batching the slot is left out of this batch
+          // and its request, if any, waits for the next one.
+          if (use_null_request && continuous_batching_) {
+            continue;
+          }
+
           // Use null-request if necessary otherwise use the next
           // request in the queue...
           if (use_null_request) {
@@ -1540,8 +1961,8 @@ DirectSequenceBatch::BatcherThread(const int nice)
 
             SequenceBatchScheduler::BatcherSequenceSlot batcher_seq_slot(
                 batcher_idx_, seq_slot);
-            seq_slot_correlation_ids_[seq_slot] =
-                base_->ReleaseSequenceSlot(batcher_seq_slot, &queue);
+            seq_slot_correlation_ids_[seq_slot] = base_->ReleaseSequenceSlot(
+                batcher_seq_slot, &queue, &sequence_states_[seq_slot]);
           }
         }
       }
@@ -1564,6 +1985,12 @@ DirectSequenceBatch::BatcherThread(const int nice)
     }
 
     if (curr_payload_->GetState() == Payload::State::READY) {
+#ifdef TRITON_ENABLE_METRICS
+      if (base_->MetricReporter() != nullptr) {
+        base_->MetricReporter()->ObserveBatch(
+            curr_payload_->BatchSize(), queue_depth, max_batch_size_);
+      }
+#endif  // TRITON_ENABLE_METRICS
       // Add callback to signal the execution completion
       exec_complete_ = false;
       auto callback = [this]() {
@@ -1618,6 +2045,7 @@ OldestSequenceBatch::OldestSequenceBatch(
     *is_initialized = false;
     return;
   }
+  InitializeResidentStateBuffers(model_instance);
 
   // Create a dynamic batcher use to batch together sequences for
   // inference.
@@ -1732,7 +2160,8 @@ OldestSequenceBatch::CompleteAndNext(const uint32_t seq_slot)
       SequenceBatchScheduler::BatcherSequenceSlot batcher_seq_slot(
           batcher_idx_, seq_slot);
       const InferenceRequest::SequenceId& released_cid =
-          base_->ReleaseSequenceSlot(batcher_seq_slot, &queue);
+          base_->ReleaseSequenceSlot(
+              batcher_seq_slot, &queue, &sequence_states_[seq_slot]);
 
       if (released_cid.InSequence()) {
         LOG_VERBOSE(1) << "Enqueued new sequence containing " << queue.size()
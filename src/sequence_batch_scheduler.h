@@ -25,13 +25,16 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <condition_variable>
 #include <deque>
 #include <future>
 #include <limits>
+#include <map>
 #include <mutex>
 #include <queue>
+#include <set>
 #include <thread>
 #include <unordered_map>
 #include "backend_model.h"
@@ -70,8 +73,12 @@ class SequenceBatchScheduler : public Scheduler {
   // \see Scheduler::InflightInferenceCount()
   size_t InflightInferenceCount() override
   {
-    std::unique_lock<std::mutex> lock(mu_);
-    return sequence_to_batcherseqslot_map_.size();
+    size_t count = 0;
+    for (auto& shard : sequence_shards_) {
+      std::lock_guard<std::mutex> lock(shard.mu_);
+      count += shard.sequence_to_batcherseqslot_map_.size();
+    }
+    return count;
   }
 
   // \see Scheduler::Stop()
@@ -88,10 +95,14 @@ class SequenceBatchScheduler : public Scheduler {
   };
 
   // Fill a sequence slot with a sequence from the backlog or show
-  // that the sequence slot is no longer being used.
+  // that the sequence slot is no longer being used. 'sequence_states'
+  // holds the implicit state of the sequence leaving the slot, which is
+  // kept if the sequence is only suspended, and returns the state of a
+  // resumed sequence taking the slot.
   InferenceRequest::SequenceId ReleaseSequenceSlot(
       const BatcherSequenceSlot& seq_slot,
-      std::deque<std::unique_ptr<InferenceRequest>>* requests);
+      std::deque<std::unique_ptr<InferenceRequest>>* requests,
+      std::shared_ptr<SequenceStates>* sequence_states);
 
   // For debugging/testing, batcher reports how many waiting requests
   // and returns true if the batcher should continue waiting.
@@ -106,6 +117,9 @@ class SequenceBatchScheduler : public Scheduler {
   }
 
   size_t MaxBatchSize() { return max_batch_size_; }
+  // The reporter of the batches formed by the Direct batchers, nullptr
+  // if metrics are disabled or the batchers use the Oldest strategy.
+  MetricModelReporter* MetricReporter() const { return reporter_.get(); }
   const std::unordered_map<std::string, SequenceStates::InitialStateData>&
   InitialState()
   {
@@ -131,13 +145,33 @@ class SequenceBatchScheduler : public Scheduler {
     bool operator()(
         const BatcherSequenceSlot& a, const BatcherSequenceSlot& b) const
     {
-      return a.seq_slot_ > b.seq_slot_;
+      return (a.seq_slot_ < b.seq_slot_) ||
+             ((a.seq_slot_ == b.seq_slot_) &&
+              (a.batcher_idx_ < b.batcher_idx_));
+    }
+  };
+
+  // The time, in microseconds, at which the reaper checks whether the
+  // sequence of a correlation ID has been idle for too long.
+  struct IdleDeadline {
+    uint64_t deadline_us_;
+    InferenceRequest::SequenceId correlation_id_;
+  };
+  struct IdleDeadlineCompare {
+    bool operator()(const IdleDeadline& a, const IdleDeadline& b) const
+    {
+      return a.deadline_us_ > b.deadline_us_;
     }
   };
 
   // The max_sequence_idle_microseconds value for this scheduler.
   uint64_t max_sequence_idle_microseconds_;
 
+  // The idle time after which a sequence gives up its sequence slot to
+  // the backlog while keeping its implicit state in host memory, 0 if
+  // idle sequences keep their slot.
+  uint64_t suspend_idle_microseconds_;
+
   bool stop_;
 
   // Mutex
@@ -158,7 +192,6 @@ class SequenceBatchScheduler : public Scheduler {
   // assigned to that correlation ID.
   using BatcherSequenceSlotMap =
       std::unordered_map<InferenceRequest::SequenceId, BatcherSequenceSlot>;
-  BatcherSequenceSlotMap sequence_to_batcherseqslot_map_;
 
   // The ordered backlog of sequences waiting for a free sequence slot.
   // The backlog queue keep track of the closest expiration timestamp among
@@ -170,28 +203,133 @@ class SequenceBatchScheduler : public Scheduler {
     uint64_t expiration_timestamp_{std::numeric_limits<uint64_t>::max()};
     std::shared_ptr<std::deque<std::unique_ptr<InferenceRequest>>> queue_{
         std::make_shared<std::deque<std::unique_ptr<InferenceRequest>>>()};
+    // Whether the queue is in 'backlog_queues_'. The queue of a suspended
+    // sequence only waits for a slot once it has a request and its state
+    // has been handed over by the slot it left.
+    bool queued_{true};
+    bool state_ready_{true};
+    // The implicit state of a suspended sequence.
+    std::shared_ptr<SequenceStates> suspended_states_;
+    // The priority of the first request in the queue when it started
+    // waiting for a slot, a lower value is a higher priority.
+    uint64_t priority_{0};
   };
+  // Ordered from highest to lowest priority, in arrival order for
+  // queues of the same priority.
   std::deque<std::shared_ptr<BacklogQueue>> backlog_queues_;
 
+  // The maximum number of sequences waiting in the backlog, 0 if not
+  // limited. Beyond it the lowest priority sequences are rejected.
+  size_t max_backlog_sequences_;
+
+  // Insert 'backlog' into 'backlog_queues_' by the priority of its first
+  // request. The lock of 'mu_' must be held.
+  void PushBacklogQueue(const std::shared_ptr<BacklogQueue>& backlog);
+
+  // Remove the lowest priority backlog queues beyond
+  // 'max_backlog_sequences_' into 'shed'. The lock of 'mu_' must be held
+  // and no shard lock may be held.
+  void ShedBacklogQueues(std::vector<std::shared_ptr<BacklogQueue>>* shed);
+
+  // Reject the requests of the 'shed' backlog queues. Must be called
+  // without holding any lock.
+  static void RejectShedBacklogQueues(
+      const std::vector<std::shared_ptr<BacklogQueue>>& shed);
+
+  // The backlog queues of the suspended sequences that have not yet
+  // handed over their state, by the batcher and sequence slot they left.
+  std::map<std::pair<size_t, uint32_t>, std::shared_ptr<BacklogQueue>>
+      suspended_slots_;
+
   // Map from a request's correlation ID to the backlog queue
   // collecting requests for that correlation ID.
   using BacklogMap = std::unordered_map<
       InferenceRequest::SequenceId, std::shared_ptr<BacklogQueue>>;
-  BacklogMap sequence_to_backlog_map_;
 
   // The batcher/sequence-slot locations ready to accept a new
   // sequence. Ordered from lowest sequence-slot-number to highest so
   // that all batchers grow at the same rate and attempt to remain as
-  // small as possible.
-  std::priority_queue<
-      BatcherSequenceSlot, std::vector<BatcherSequenceSlot>,
-      BatcherSequenceSlotCompare>
+  // small as possible. 'batcher_ready_seq_slots_' holds the same slots
+  // by batcher, so the lowest ready slot of a batcher is found without
+  // passing over the slots of the other batchers.
+  std::set<BatcherSequenceSlot, BatcherSequenceSlotCompare>
       ready_batcher_seq_slots_;
+  std::vector<std::set<uint32_t>> batcher_ready_seq_slots_;
+
+  // Add 'slot' to the ready sequence slots. The lock of 'mu_' must be
+  // held once the scheduler is running.
+  void AddReadySequenceSlot(const BatcherSequenceSlot& slot);
+
+  // Take a ready sequence slot, preferring a slot of the batcher that
+  // last served 'affinity_key' if the key is not empty. The lock of
+  // 'mu_' must be held.
+  BatcherSequenceSlot TakeReadySequenceSlot(const std::string& affinity_key);
+
+  // The batcher that last started a sequence for each affinity key
+  // given by the 'sequence_affinity_key' request parameter. Requests of
+  // different sequences that share a key prefer the same model instance
+  // so that backend-side caches of the key can be reused.
+  static constexpr size_t MAX_AFFINITY_KEYS = 64 * 1024;
+  std::unordered_map<std::string, size_t> affinity_batchers_;
 
   // For each correlation ID the most recently seen timestamp, in
-  // microseconds, for a request using that correlation ID.
-  std::unordered_map<InferenceRequest::SequenceId, uint64_t>
-      correlation_id_timestamps_;
+  // microseconds, for a request using that correlation ID, and the
+  // deadline of its entry in 'idle_deadlines_'.
+  struct IdleTimestamp {
+    uint64_t last_us_;
+    uint64_t deadline_us_;
+  };
+
+  // The state of the sequences whose correlation ID hashes to the shard.
+  // A request of a sequence that already has a sequence slot only takes
+  // the lock of its shard, requests that may need a sequence slot or the
+  // backlog also take 'mu_', which must be acquired first.
+  struct SequenceShard {
+    std::mutex mu_;
+    BatcherSequenceSlotMap sequence_to_batcherseqslot_map_;
+    BacklogMap sequence_to_backlog_map_;
+    std::unordered_map<InferenceRequest::SequenceId, IdleTimestamp>
+        correlation_id_timestamps_;
+
+    // One deadline for each correlation ID in
+    // 'correlation_id_timestamps_', earliest first. A request only updates
+    // the timestamp of its correlation ID, the deadline is moved when the
+    // reaper reaches it, so the reaper only visits the correlation IDs
+    // that may have expired. An entry whose deadline does not match the
+    // one recorded for the correlation ID is stale and is discarded.
+    std::priority_queue<
+        IdleDeadline, std::vector<IdleDeadline>, IdleDeadlineCompare>
+        idle_deadlines_;
+  };
+  static constexpr size_t SEQUENCE_SHARD_COUNT = 64;
+  std::array<SequenceShard, SEQUENCE_SHARD_COUNT> sequence_shards_;
+
+  SequenceShard& Shard(const InferenceRequest::SequenceId& correlation_id)
+  {
+    return sequence_shards_
+        [std::hash<InferenceRequest::SequenceId>{}(correlation_id) %
+         SEQUENCE_SHARD_COUNT];
+  }
+  // Record the timestamp of a request of 'correlation_id', the lock of
+  // 'shard' must be held.
+  void RecordRequestTimestamp(
+      SequenceShard* shard, const InferenceRequest::SequenceId& correlation_id,
+      const uint64_t now_us);
+  // Give the sequence slot of idle 'correlation_id' to the backlog and
+  // collect the slot to be force-ended in 'force_end_sequences'. The
+  // locks of 'mu_' and 'shard' must be held.
+  void SuspendSequence(
+      SequenceShard* shard, const InferenceRequest::SequenceId& correlation_id,
+      BatcherSequenceSlotMap* force_end_sequences);
+  // The idle time after which the reaper first checks a sequence.
+  uint64_t FirstIdleMicroseconds() const
+  {
+    return (suspend_idle_microseconds_ == 0)
+               ? max_sequence_idle_microseconds_
+               : std::min(
+                     suspend_idle_microseconds_,
+                     max_sequence_idle_microseconds_);
+  }
 
   // Used for debugging/testing.
   size_t backlog_delay_cnt_;
@@ -202,6 +340,8 @@ class SequenceBatchScheduler : public Scheduler {
       state_output_config_map_;
   size_t max_batch_size_;
 
+  std::shared_ptr<MetricModelReporter> reporter_;
+
   // Initial state used for implicit state.
   std::unordered_map<std::string, SequenceStates::InitialStateData>
       initial_state_;
@@ -247,6 +387,11 @@ class SequenceBatch {
   void UpdateImplicitState(
       std::unique_ptr<InferenceRequest>& irequest, const int32_t seq_slot);
 
+  // Preallocate the implicit state buffers of the sequence slots in the
+  // memory of 'model_instance' if the model requests it.
+  void InitializeResidentStateBuffers(
+      const TritonModelInstance* model_instance);
+
   // The controlling scheduler.
   SequenceBatchScheduler* const base_;
 
@@ -284,8 +429,24 @@ class SequenceBatch {
   // CONTROL_SEQUENCE_CORRID control.
   std::shared_ptr<InferenceRequest::Input> seq_slot_corrid_override_;
 
+  // For each sequence slot the correlation ID override of the sequence
+  // in the slot. The override is immutable once created and shared by
+  // all requests of the sequence, so it is only created when the slot
+  // gets a new correlation ID.
+  std::vector<std::pair<
+      InferenceRequest::SequenceId, std::shared_ptr<InferenceRequest::Input>>>
+      seq_slot_corrid_overrides_;
+  // The correlation ID override of the null requests, shared by all slots
+  std::pair<
+      InferenceRequest::SequenceId, std::shared_ptr<InferenceRequest::Input>>
+      null_corrid_override_;
+
   // For each sequence slot store the optional state i/o tensors.
   std::vector<std::shared_ptr<SequenceStates>> sequence_states_;
+
+  // For each sequence slot the buffers that hold its implicit state, empty
+  // if the states are allocated for each sequence.
+  std::vector<SequenceStates::ResidentStateBuffers> resident_state_buffers_;
 };
 
 // Scheduler that implements the Direct sequence scheduling strategy
@@ -357,6 +518,11 @@ class DirectSequenceBatch : public SequenceBatch {
   size_t max_batch_size_;
   float minimum_slot_utilization_;
   uint64_t pending_batch_delay_ns_;
+
+  // Whether each batch is formed only from the slots that have a pending
+  // request, instead of padding the slots without one with null requests
+  // so that every request stays at the batch index of its slot.
+  bool continuous_batching_;
 };
 
 // Scheduler that implements the oldest-first sequence scheduling
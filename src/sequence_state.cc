@@ -26,6 +26,7 @@
 
 #include "sequence_state.h"
 
+#include "cuda_utils.h"
 #include "memory.h"
 #include "triton/common/logging.h"
 
@@ -96,7 +97,8 @@ SequenceStates::Initialize(
         std::string, const inference::ModelSequenceBatching_State&>&
         state_output_config_map,
     const size_t max_batch_size,
-    const std::unordered_map<std::string, InitialStateData>& initial_state)
+    const std::unordered_map<std::string, InitialStateData>& initial_state,
+    ResidentStateBuffers* resident_buffers)
 {
   input_states_.clear();
   output_states_.clear();
@@ -118,9 +120,30 @@ SequenceStates::Initialize(
       }
     }
 
+    // Only the states with a fixed size can live in the resident buffers,
+    // the size of the state of a sequence never changes.
+    bool resident = (resident_buffers != nullptr) &&
+                    (state_config.data_type() !=
+                     inference::DataType::TYPE_STRING);
+    for (const auto dim : state_config.dims()) {
+      resident &= (dim != -1);
+    }
+    const size_t resident_size =
+        resident ? triton::common::GetByteSize(state_config.data_type(), dims)
+                 : 0;
+
     std::shared_ptr<AllocatedMemory> data;
+    std::shared_ptr<AllocatedMemory> output_data;
     auto initial_state_it = initial_state.find(state_config.input_name());
-    if (initial_state_it != initial_state.end()) {
+    if (resident && (initial_state_it != initial_state.end()) &&
+        (initial_state_it->second.data_->TotalByteSize() != resident_size)) {
+      resident = false;
+    }
+    if (resident) {
+      RETURN_IF_ERROR(ResidentStateData(
+          state_config, resident_size, initial_state, resident_buffers, &data,
+          &output_data));
+    } else if (initial_state_it != initial_state.end()) {
       data = std::make_shared<AllocatedMemory>(
           initial_state_it->second.data_->TotalByteSize(),
           TRITONSERVER_MEMORY_CPU, 0);
@@ -184,11 +207,78 @@ SequenceStates::Initialize(
 
       continue;
     }
+
+    // Hand the other resident buffer to the output state so that the
+    // backend writes the next state into it and the update only swaps
+    // the buffers.
+    if (output_data != nullptr) {
+      output_pair.first->second.reset(new SequenceState(
+          state_config.output_name(), state.second.data_type(), dims));
+      RETURN_IF_ERROR(output_pair.first->second->SetData(output_data));
+    }
   }
 
   return Status::Success;
 }
 
+Status
+SequenceStates::ResidentStateData(
+    const inference::ModelSequenceBatching_State& state_config,
+    const size_t state_size,
+    const std::unordered_map<std::string, InitialStateData>& initial_state,
+    ResidentStateBuffers* resident_buffers,
+    std::shared_ptr<AllocatedMemory>* input_data,
+    std::shared_ptr<AllocatedMemory>* output_data)
+{
+  TRITONSERVER_MemoryType memory_type;
+  int64_t memory_type_id;
+
+  auto& buffers = resident_buffers->buffers_[state_config.input_name()];
+  auto& initial_data =
+      resident_buffers->initial_data_[state_config.input_name()];
+  if ((buffers[0] == nullptr) || (buffers[0]->TotalByteSize() != state_size)) {
+    for (auto& buffer : buffers) {
+      buffer = std::make_shared<AllocatedMemory>(
+          state_size, resident_buffers->memory_type_,
+          resident_buffers->memory_type_id_);
+    }
+    initial_data = std::make_shared<AllocatedMemory>(
+        state_size, TRITONSERVER_MEMORY_CPU, 0);
+    char* buffer = initial_data->MutableBuffer(&memory_type, &memory_type_id);
+    auto initial_state_it = initial_state.find(state_config.input_name());
+    if (initial_state_it != initial_state.end()) {
+      memcpy(
+          buffer,
+          initial_state_it->second.data_->MutableBuffer(
+              &memory_type, &memory_type_id),
+          state_size);
+    } else {
+      memset(buffer, 0, state_size);
+    }
+  }
+
+  // The previous sequence in the slot may have left the buffers swapped,
+  // either one can be used as the input.
+  const char* initial_buffer =
+      initial_data->MutableBuffer(&memory_type, &memory_type_id);
+  char* dst_buffer = buffers[0]->MutableBuffer(&memory_type, &memory_type_id);
+  bool cuda_used = false;
+  RETURN_IF_ERROR(CopyBuffer(
+      "sequence state '" + state_config.input_name() + "'",
+      TRITONSERVER_MEMORY_CPU, 0 /* src_memory_type_id */, memory_type,
+      memory_type_id, state_size, initial_buffer,
+      dst_buffer, nullptr /* cuda_stream */, &cuda_used));
+#ifdef TRITON_ENABLE_GPU
+  if (cuda_used) {
+    cudaStreamSynchronize(nullptr);
+  }
+#endif  // TRITON_ENABLE_GPU
+
+  *input_data = buffers[0];
+  *output_data = buffers[1];
+  return Status::Success;
+}
+
 Status
 SequenceStates::OutputState(
     const std::string& name, const inference::DataType datatype,
@@ -287,6 +377,57 @@ SequenceStates::OutputState(
   return OutputState(name, datatype, shape.data(), shape.size(), output_state);
 }
 
+Status
+SequenceStates::SpillToHost()
+{
+  // Host states are copied as well since they may be the resident
+  // buffers of the sequence slot that is given to another sequence.
+  for (auto& input_state : input_states_) {
+    auto& state = input_state.second;
+    const size_t byte_size = state->Data()->TotalByteSize();
+    if (byte_size == 0) {
+      continue;
+    }
+
+    TRITONSERVER_MemoryType memory_type;
+    int64_t memory_type_id;
+    const std::shared_ptr<MutableMemory>& memory =
+        reinterpret_cast<const std::shared_ptr<MutableMemory>&>(
+            state->Data());
+    const char* src_buffer =
+        memory->MutableBuffer(&memory_type, &memory_type_id);
+
+    TRITONSERVER_MemoryType host_memory_type;
+    int64_t host_memory_type_id;
+    std::shared_ptr<AllocatedMemory> host_memory =
+        std::make_shared<AllocatedMemory>(
+            byte_size, TRITONSERVER_MEMORY_CPU_PINNED, 0);
+    char* dst_buffer =
+        host_memory->MutableBuffer(&host_memory_type, &host_memory_type_id);
+    bool cuda_used = false;
+    RETURN_IF_ERROR(CopyBuffer(
+        "spill sequence state '" + state->Name() + "'", memory_type,
+        memory_type_id, host_memory_type, host_memory_type_id, byte_size,
+        src_buffer, dst_buffer, nullptr /* cuda_stream */, &cuda_used));
+#ifdef TRITON_ENABLE_GPU
+    if (cuda_used) {
+      cudaStreamSynchronize(nullptr);
+    }
+#endif  // TRITON_ENABLE_GPU
+
+    RETURN_IF_ERROR(state->RemoveAllData());
+    RETURN_IF_ERROR(state->SetData(host_memory));
+  }
+
+  // The output state buffers only receive the state of the next step and
+  // are allocated again by the backend.
+  for (auto& output_state : output_states_) {
+    output_state.second.reset();
+  }
+
+  return Status::Success;
+}
+
 std::shared_ptr<SequenceStates>
 SequenceStates::CopyAsNull(const std::shared_ptr<SequenceStates>& from)
 {
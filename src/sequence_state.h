@@ -24,6 +24,7 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <array>
 #include <functional>
 #include <map>
 #include <memory>
@@ -112,15 +113,32 @@ class SequenceStates {
     std::shared_ptr<MutableMemory> data_;
   };
 
+  // Buffers preallocated for the states of a sequence slot, reused by
+  // every sequence assigned to the slot. Each state has a pair of
+  // buffers, the output state of a step is written into one while the
+  // other holds the input state, and the update swaps them.
+  struct ResidentStateBuffers {
+    TRITONSERVER_MemoryType memory_type_;
+    int64_t memory_type_id_;
+    // The buffer pair of each state, by state input name.
+    std::map<std::string, std::array<std::shared_ptr<AllocatedMemory>, 2>>
+        buffers_;
+    // The content of each state at the start of a sequence, in host memory.
+    std::map<std::string, std::shared_ptr<AllocatedMemory>> initial_data_;
+  };
+
   // Initialize the state tensors according to the state model configuration.
   // Will use a default value of 1 for the variable dimensions in the state
-  // tensor configuration.
+  // tensor configuration. If 'resident_buffers' is provided the states
+  // without variable dimensions use the buffers of the sequence slot
+  // instead of newly allocated ones.
   Status Initialize(
       const std::unordered_map<
           std::string, const inference::ModelSequenceBatching_State&>&
           state_output_config_map,
       const size_t max_batch_size,
-      const std::unordered_map<std::string, InitialStateData>& initial_state);
+      const std::unordered_map<std::string, InitialStateData>& initial_state,
+      ResidentStateBuffers* resident_buffers = nullptr);
 
   // Get a buffer holding the output state.
   Status OutputState(
@@ -131,6 +149,12 @@ class SequenceStates {
       const std::string& name, const inference::DataType datatype,
       const std::vector<int64_t>& shape, SequenceState** output_state);
 
+  // Move the input states into pinned host memory owned by these states
+  // and release the output state buffers, so that an inactive sequence
+  // holds no device or sequence slot memory. The backend reads the
+  // states from host memory on the next request of the sequence.
+  Status SpillToHost();
+
   // Create a copy of the 'from' sequence states for NULL requests.
   static std::shared_ptr<SequenceStates> CopyAsNull(
       const std::shared_ptr<SequenceStates>& from);
@@ -159,6 +183,16 @@ class SequenceStates {
   bool IsNullRequest() { return is_null_request_; }
 
  private:
+  // Get the resident buffers for the state, with the input buffer holding
+  // the content of the state at the start of a sequence.
+  static Status ResidentStateData(
+      const inference::ModelSequenceBatching_State& state_config,
+      const size_t state_size,
+      const std::unordered_map<std::string, InitialStateData>& initial_state,
+      ResidentStateBuffers* resident_buffers,
+      std::shared_ptr<AllocatedMemory>* input_data,
+      std::shared_ptr<AllocatedMemory>* output_data);
+
   std::map<std::string, std::unique_ptr<SequenceState>> input_states_;
   std::map<std::string, std::unique_ptr<SequenceState>> output_states_;
   std::shared_ptr<SequenceStates> null_sequence_states_;
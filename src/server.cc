@@ -29,13 +29,19 @@
 #include <stdint.h>
 #include <time.h>
 #include <algorithm>
+#include <chrono>
 #include <csignal>
+#include <cstdlib>
 #include <iostream>
 #include <memory>
+#include <thread>
 #include <utility>
 #include <vector>
+#include "backend_config.h"
 #include "backend_manager.h"
+#include "backend_model.h"
 #include "constants.h"
+#include "cuda_ipc_cache.h"
 #include "cuda_utils.h"
 #include "model.h"
 #include "model_config.pb.h"
@@ -71,6 +77,95 @@ class ScopedAtomicIncrement {
   std::atomic<uint64_t>& counter_;
 };
 
+// The input bytes of an accepted request, held in the queued input
+// budgets until the request is released. Releasing more than once has
+// no effect, so a rejected request can give its bytes back right away.
+class QueuedInputReservation {
+ public:
+  QueuedInputReservation(
+      const std::shared_ptr<ByteBudget>& server_budget,
+      const std::shared_ptr<ByteBudget>& model_budget,
+      const uint64_t byte_size)
+      : server_budget_(server_budget), model_budget_(model_budget),
+        byte_size_(byte_size), released_(false)
+  {
+  }
+
+  ~QueuedInputReservation() { Release(); }
+
+  void Release()
+  {
+    if (released_.exchange(true)) {
+      return;
+    }
+    if (server_budget_ != nullptr) {
+      server_budget_->Release(byte_size_);
+    }
+    if (model_budget_ != nullptr) {
+      model_budget_->Release(byte_size_);
+    }
+  }
+
+ private:
+  const std::shared_ptr<ByteBudget> server_budget_;
+  const std::shared_ptr<ByteBudget> model_budget_;
+  const uint64_t byte_size_;
+  std::atomic<bool> released_;
+};
+
+// Reserve the input bytes of 'request' in 'server_queued_budget' and in the
+// budget of its model, if any. Return UNAVAILABLE if they don't fit.
+// The reservation is released when the request is released. The
+// requests of ensemble steps are only charged to their model, the
+// server budget already holds the inputs of the ensemble request.
+Status
+ReserveQueuedInputBytes(
+    const std::shared_ptr<ByteBudget>& server_queued_budget,
+    InferenceRequest* request,
+    std::shared_ptr<QueuedInputReservation>* reservation)
+{
+  const std::shared_ptr<ByteBudget> server_budget =
+      request->IsEnsembleStep() ? nullptr : server_queued_budget;
+  const auto& model_budget = request->ModelRaw()->QueuedInputBudget();
+  if ((server_budget == nullptr) && (model_budget == nullptr)) {
+    return Status::Success;
+  }
+
+  uint64_t byte_size = 0;
+  for (const auto& pr : request->OriginalInputs()) {
+    if (pr.second.Data() != nullptr) {
+      byte_size += pr.second.Data()->TotalByteSize();
+    }
+  }
+  if ((server_budget != nullptr) && !server_budget->TryReserve(byte_size)) {
+    return Status(
+        Status::Code::UNAVAILABLE,
+        request->LogRequest() + "input byte size " +
+            std::to_string(byte_size) +
+            " exceeds the queued input budget of the server, " +
+            std::to_string(server_budget->Used()) + " of " +
+            std::to_string(server_budget->Limit()) + " bytes are in use");
+  }
+  if ((model_budget != nullptr) && !model_budget->TryReserve(byte_size)) {
+    if (server_budget != nullptr) {
+      server_budget->Release(byte_size);
+    }
+    return Status(
+        Status::Code::UNAVAILABLE,
+        request->LogRequest() + "input byte size " +
+            std::to_string(byte_size) +
+            " exceeds the queued input budget of model '" +
+            request->ModelName() + "', " +
+            std::to_string(model_budget->Used()) + " of " +
+            std::to_string(model_budget->Limit()) + " bytes are in use");
+  }
+
+  reservation->reset(
+      new QueuedInputReservation(server_budget, model_budget, byte_size));
+  std::shared_ptr<QueuedInputReservation> held = *reservation;
+  return request->AddInternalReleaseCallback([held]() { held->Release(); });
+}
+
 }  // namespace
 
 //
@@ -103,9 +198,15 @@ InferenceServer::InferenceServer()
   strict_readiness_ = true;
   exit_timeout_secs_ = 30;
   pinned_memory_pool_size_ = 1 << 28;
+  pinned_memory_pool_max_size_ = 0;
+  cuda_memory_pool_async_ = false;
+  cuda_memory_pool_growth_ = true;
   buffer_manager_thread_count_ = 0;
   model_load_thread_count_ = 4;
   enable_model_namespacing_ = false;
+  model_load_on_demand_ = false;
+  model_idle_unload_timeout_sec_ = 0;
+  model_load_on_demand_byte_size_ = 0;
 
 #ifdef TRITON_ENABLE_GPU
   min_supported_compute_capability_ = TRITON_MIN_COMPUTE_CAPABILITY;
@@ -156,25 +257,37 @@ InferenceServer::Init()
     return status;
   }
 
-  // Only a single global cache is supported at this time.
-  if (cache_config_map_.size() > 1) {
-    ready_state_ = ServerReadyState::SERVER_FAILED_TO_INITIALIZE;
-    return Status(
-        Status::Code::INVALID_ARG,
-        "found multiple cache configurations, but only a single cache is "
-        "currently supported");
-  }
-
-  // Initialize each cache with its respective config
-  for (const auto& iter : cache_config_map_) {
-    const auto& name = iter.first;
-    const auto& config = iter.second;
+  // Only a single global cache is supported at this time, unless a
+  // tiered cache configuration stacks two caches into one.
+  const auto tiered_config = cache_config_map_.find(kTieredCacheName);
+  if (tiered_config != cache_config_map_.end()) {
     std::shared_ptr<TritonCache> cache;
-    status = cache_manager_->CreateCache(name, config, &cache);
+    status = cache_manager_->CreateTieredCache(
+        tiered_config->second, cache_config_map_, &cache);
     if (!status.IsOk()) {
       ready_state_ = ServerReadyState::SERVER_FAILED_TO_INITIALIZE;
       return status;
     }
+  } else {
+    if (cache_config_map_.size() > 1) {
+      ready_state_ = ServerReadyState::SERVER_FAILED_TO_INITIALIZE;
+      return Status(
+          Status::Code::INVALID_ARG,
+          "found multiple cache configurations, but only a single cache is "
+          "currently supported");
+    }
+
+    // Initialize each cache with its respective config
+    for (const auto& iter : cache_config_map_) {
+      const auto& name = iter.first;
+      const auto& config = iter.second;
+      std::shared_ptr<TritonCache> cache;
+      status = cache_manager_->CreateCache(name, config, &cache);
+      if (!status.IsOk()) {
+        ready_state_ = ServerReadyState::SERVER_FAILED_TO_INITIALIZE;
+        return status;
+      }
+    }
   }
 
   if (buffer_manager_thread_count_ > 0) {
@@ -189,10 +302,11 @@ InferenceServer::Init()
   std::unique_ptr<RateLimiter> local_rate_limiter;
   bool ignore_resources_and_priority =
       (rate_limit_mode_ == RateLimitMode::RL_OFF);
+  bool enforce_time_budget = (rate_limit_mode_ == RateLimitMode::RL_GPU_TIME);
 
   status = RateLimiter::Create(
-      ignore_resources_and_priority, rate_limit_resource_map_,
-      &local_rate_limiter);
+      ignore_resources_and_priority, enforce_time_budget,
+      rate_limit_resource_map_, &local_rate_limiter);
   rate_limiter_ = std::move(local_rate_limiter);
   if (!status.IsOk()) {
     ready_state_ = ServerReadyState::SERVER_FAILED_TO_INITIALIZE;
@@ -200,6 +314,7 @@ InferenceServer::Init()
   }
 
   PinnedMemoryManager::Options options(pinned_memory_pool_size_);
+  options.pinned_memory_pool_max_byte_size_ = pinned_memory_pool_max_size_;
   status = PinnedMemoryManager::Create(options);
   if (!status.IsOk()) {
     ready_state_ = ServerReadyState::SERVER_FAILED_TO_INITIALIZE;
@@ -221,7 +336,11 @@ InferenceServer::Init()
   }
 
   CudaMemoryManager::Options cuda_options(
-      min_supported_compute_capability_, cuda_memory_pool_size_);
+      min_supported_compute_capability_, cuda_memory_pool_size_,
+      cuda_memory_pool_async_ ? CudaMemoryManager::PoolType::ASYNC
+                              : CudaMemoryManager::PoolType::CNMEM);
+  cuda_options.allow_growth_ = cuda_memory_pool_growth_;
+  cuda_options.release_threshold_ = cuda_memory_pool_release_threshold_;
   status = CudaMemoryManager::Create(cuda_options);
   // If CUDA memory manager can't be created, just log error as the
   // server can still function properly
@@ -236,6 +355,29 @@ InferenceServer::Init()
     LOG_WARNING << status.Message();
   }
 
+  // Load and initialize the configured backends concurrently with the
+  // repository polling below. A model of a backend that is still being
+  // preloaded waits for the preload instead of initializing it again.
+  std::vector<std::string> preload_backends;
+  status = BackendConfigurationPreloadBackends(
+      backend_cmdline_config_map_, &preload_backends);
+  if (!status.IsOk()) {
+    ready_state_ = ServerReadyState::SERVER_FAILED_TO_INITIALIZE;
+    return status;
+  }
+  std::vector<std::thread> preload_threads;
+  for (const auto& backend_name : preload_backends) {
+    preload_threads.emplace_back([this, backend_name]() {
+      LOG_VERBOSE(1) << "preloading backend '" << backend_name << "'";
+      Status preload_status = TritonModel::PreloadBackend(
+          this, backend_name, backend_cmdline_config_map_);
+      if (!preload_status.IsOk()) {
+        LOG_WARNING << "failed to preload backend '" << backend_name
+                    << "': " << preload_status.Message();
+      }
+    });
+  }
+
   // Create the model manager for the repository. Unless model control
   // is disabled, all models are eagerly loaded when the manager is created.
   bool polling_enabled = (model_control_mode_ == ModelControlMode::MODE_POLL);
@@ -249,6 +391,19 @@ InferenceServer::Init()
       strict_model_config_, polling_enabled, model_control_enabled,
       life_cycle_options, enable_model_namespacing_,
       &model_repository_manager_);
+  for (auto& preload_thread : preload_threads) {
+    preload_thread.join();
+  }
+  if ((model_repository_manager_ != nullptr) && model_load_on_demand_) {
+    if (model_control_enabled) {
+      on_demand_model_loader_.reset(new OnDemandModelLoader(
+          model_repository_manager_.get(), model_idle_unload_timeout_sec_,
+          model_load_on_demand_byte_size_));
+    } else {
+      LOG_WARNING << "on-demand model loading requires explicit model "
+                     "control mode, ignoring it";
+    }
+  }
   if (!status.IsOk()) {
     if (model_repository_manager_ == nullptr) {
       ready_state_ = ServerReadyState::SERVER_FAILED_TO_INITIALIZE;
@@ -271,6 +426,7 @@ InferenceServer::~InferenceServer()
 {
   PinnedMemoryManager::Reset();
 #ifdef TRITON_ENABLE_GPU
+  CudaIpcCache::CloseIdle();
   CudaMemoryManager::Reset();
 #endif  // TRITON_ENABLE_GPU
 }
@@ -284,6 +440,10 @@ InferenceServer::Stop(const bool force)
 
   ready_state_ = ServerReadyState::SERVER_EXITING;
 
+  if (on_demand_model_loader_ != nullptr) {
+    on_demand_model_loader_->Stop();
+  }
+
   if (model_repository_manager_ == nullptr) {
     LOG_INFO << "No server context available. Exiting immediately.";
     return Status::Success;
@@ -297,20 +457,50 @@ InferenceServer::Stop(const bool force)
   }
 
   // Wait for all in-flight non-inference requests to complete and all
-  // loaded models to unload, or for the exit timeout to expire.
-  uint32_t exit_timeout_iters = exit_timeout_secs_;
+  // loaded models to unload, or for the exit timeout to expire. The
+  // state is polled more often than it is reported so that the shutdown
+  // isn't rounded up to whole seconds.
+  //
+  // Optionally each model is unloaded as soon as its own in-flight
+  // inferences completed, so that it doesn't wait for the slowest model
+  // to drain. This is only safe if no model calls other models outside
+  // of an ensemble, a BLS model may call a model that is already
+  // unloaded, so it must be enabled explicitly.
+  const char* unload_drained = std::getenv("TRITON_UNLOAD_DRAINED_MODELS");
+  const bool unload_drained_models = (unload_drained != nullptr) &&
+                                     (std::string(unload_drained) != "0");
+  const auto poll_interval = std::chrono::milliseconds(50);
+  const auto report_interval = std::chrono::seconds(1);
+  const auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::seconds(exit_timeout_secs_);
+  auto next_report = std::chrono::steady_clock::now();
   bool unloading_model = false;
   while (true) {
+    const auto now = std::chrono::steady_clock::now();
+    const bool report = (now >= next_report);
+    if (report) {
+      next_report = now + report_interval;
+    }
+    const int64_t exit_timeout_iters =
+        std::chrono::duration_cast<std::chrono::seconds>(deadline - now)
+            .count();
+
     if (!unloading_model) {
-      // Check if all in-flight inference requests / sequences are completed
-      const auto& inflight_status = model_repository_manager_->InflightStatus();
-      LOG_INFO << "Timeout " << exit_timeout_iters << ": Found "
-               << inflight_status.size()
-               << " model versions that have in-flight inferences";
-      for (const auto& inflight : inflight_status) {
-        LOG_INFO << "Model '" << std::get<0>(inflight) << "' "
-                 << "(version " << std::get<1>(inflight) << ") has "
-                 << std::get<2>(inflight) << " in-flight inferences";
+      // Check if all in-flight inference requests / sequences are
+      // completed, unloading the drained models if enabled
+      const auto& inflight_status =
+          unload_drained_models
+              ? model_repository_manager_->UnloadDrainedModels()
+              : model_repository_manager_->InflightStatus();
+      if (report) {
+        LOG_INFO << "Timeout " << exit_timeout_iters << ": Found "
+                 << inflight_status.size()
+                 << " model versions that have in-flight inferences";
+        for (const auto& inflight : inflight_status) {
+          LOG_INFO << "Model '" << std::get<0>(inflight) << "' "
+                   << "(version " << std::get<1>(inflight) << ") has "
+                   << std::get<2>(inflight) << " in-flight inferences";
+        }
       }
 
       if (inflight_status.size() == 0) {
@@ -320,21 +510,24 @@ InferenceServer::Stop(const bool force)
           LOG_ERROR << status.Message();
         } else {
           LOG_INFO << "All models are stopped, unloading models";
+          next_report = now;
           continue;
         }
       }
     } else {
       const auto& live_models = model_repository_manager_->LiveModelStates();
 
-      LOG_INFO << "Timeout " << exit_timeout_iters << ": Found "
-               << live_models.size() << " live models and "
-               << inflight_request_counter_
-               << " in-flight non-inference requests";
-      if (LOG_VERBOSE_IS_ON(1)) {
-        for (const auto& m : live_models) {
-          for (const auto& v : m.second) {
-            LOG_VERBOSE(1) << m.first << " v" << v.first << ": "
-                           << ModelReadyStateString(v.second.first);
+      if (report) {
+        LOG_INFO << "Timeout " << exit_timeout_iters << ": Found "
+                 << live_models.size() << " live models and "
+                 << inflight_request_counter_
+                 << " in-flight non-inference requests";
+        if (LOG_VERBOSE_IS_ON(1)) {
+          for (const auto& m : live_models) {
+            for (const auto& v : m.second) {
+              LOG_VERBOSE(1) << m.first << " v" << v.first << ": "
+                             << ModelReadyStateString(v.second.first);
+            }
           }
         }
       }
@@ -343,12 +536,11 @@ InferenceServer::Stop(const bool force)
         return Status::Success;
       }
     }
-    if (exit_timeout_iters <= 0) {
+    if (now >= deadline) {
       break;
     }
 
-    exit_timeout_iters--;
-    std::this_thread::sleep_for(std::chrono::seconds(1));
+    std::this_thread::sleep_for(poll_interval);
   }
 
   return Status(
@@ -526,6 +718,10 @@ InferenceServer::InferAsync(std::unique_ptr<InferenceRequest>& request)
     return Status(Status::Code::UNAVAILABLE, "Server not ready");
   }
 
+  std::shared_ptr<QueuedInputReservation> reservation;
+  RETURN_IF_ERROR(ReserveQueuedInputBytes(
+      queued_input_budget_, request.get(), &reservation));
+
 #ifdef TRITON_ENABLE_STATS
   request->CaptureRequestStartNs();
   INFER_TRACE_ACTIVITY(
@@ -533,7 +729,75 @@ InferenceServer::InferAsync(std::unique_ptr<InferenceRequest>& request)
       request->RequestStartNs());
 #endif  // TRITON_ENABLE_STATS
 
-  return InferenceRequest::Run(request);
+  if (on_demand_model_loader_ != nullptr) {
+    on_demand_model_loader_->Touch(request->ModelRaw());
+  }
+
+  Status status = InferenceRequest::Run(request);
+  // The caller keeps a request that is not run
+  if (!status.IsOk() && (reservation != nullptr)) {
+    reservation->Release();
+  }
+  return status;
+}
+
+Status
+InferenceServer::InferAsyncBatch(
+    std::vector<std::unique_ptr<InferenceRequest>>& requests)
+{
+  if ((ready_state_ != ServerReadyState::SERVER_READY) &&
+      (ready_state_ != ServerReadyState::SERVER_EXITING)) {
+    return Status(Status::Code::UNAVAILABLE, "Server not ready");
+  }
+
+  std::vector<std::shared_ptr<QueuedInputReservation>> reservations;
+  for (auto& request : requests) {
+    std::shared_ptr<QueuedInputReservation> reservation;
+    Status status = ReserveQueuedInputBytes(
+        queued_input_budget_, request.get(), &reservation);
+    if (!status.IsOk()) {
+      for (auto& reserved : reservations) {
+        reserved->Release();
+      }
+      return status;
+    }
+    if (reservation != nullptr) {
+      reservations.emplace_back(std::move(reservation));
+    }
+  }
+
+#ifdef TRITON_ENABLE_STATS
+  for (auto& request : requests) {
+    request->CaptureRequestStartNs();
+    INFER_TRACE_ACTIVITY(
+        request->Trace(), TRITONSERVER_TRACE_REQUEST_START,
+        request->RequestStartNs());
+  }
+#endif  // TRITON_ENABLE_STATS
+
+  if (on_demand_model_loader_ != nullptr) {
+    for (const auto& request : requests) {
+      on_demand_model_loader_->Touch(request->ModelRaw());
+    }
+  }
+
+  InferenceRequest::RunBatch(requests);
+  return Status::Success;
+}
+
+Status
+InferenceServer::GetInferenceModel(
+    const std::string& model_name, const int64_t model_version,
+    std::shared_ptr<Model>* model)
+{
+  // Models are not loaded on demand once the server is exiting
+  if ((on_demand_model_loader_ == nullptr) ||
+      (ready_state_ != ServerReadyState::SERVER_READY)) {
+    return GetModel(model_name, model_version, model);
+  }
+
+  ScopedAtomicIncrement inflight(inflight_request_counter_);
+  return on_demand_model_loader_->GetModel(model_name, model_version, model);
 }
 
 Status
@@ -547,6 +811,13 @@ InferenceServer::LoadModel(
 
   ScopedAtomicIncrement inflight(inflight_request_counter_);
 
+  // A model loaded explicitly is never unloaded on demand
+  if (on_demand_model_loader_ != nullptr) {
+    for (const auto& model : models) {
+      on_demand_model_loader_->ForgetModel(model.first);
+    }
+  }
+
   auto action_type = ActionType::LOAD;
   return model_repository_manager_->LoadUnloadModel(
       models, action_type, false /* unload_dependents */);
@@ -562,6 +833,10 @@ InferenceServer::UnloadModel(
 
   ScopedAtomicIncrement inflight(inflight_request_counter_);
 
+  if (on_demand_model_loader_ != nullptr) {
+    on_demand_model_loader_->ForgetModel(model_name);
+  }
+
   auto action_type = ActionType::UNLOAD;
   return model_repository_manager_->LoadUnloadModel(
       {{model_name, {}}}, action_type, unload_dependents);
@@ -34,10 +34,12 @@
 #include <vector>
 
 #include "backend_manager.h"
+#include "byte_budget.h"
 #include "cache_manager.h"
 #include "infer_parameter.h"
 #include "model_config.pb.h"
 #include "model_repository_manager.h"
+#include "on_demand_model_loader.h"
 #include "rate_limiter.h"
 #include "status.h"
 #include "triton/common/model_config.h"
@@ -52,7 +54,7 @@ class InferenceRequest;
 
 enum class ModelControlMode { MODE_NONE, MODE_POLL, MODE_EXPLICIT };
 
-enum class RateLimitMode { RL_EXEC_COUNT, RL_OFF };
+enum class RateLimitMode { RL_EXEC_COUNT, RL_OFF, RL_GPU_TIME };
 
 // Readiness status for the inference server.
 enum class ServerReadyState {
@@ -120,9 +122,20 @@ class InferenceServer {
   // Inference. If Status::Success is returned then this function has
   // taken ownership of the request object and so 'request' will be
   // nullptr. If non-success is returned then the caller still retains
-  // ownership of 'request'.
+  // ownership of 'request'. UNAVAILABLE is returned if the inputs of
+  // the request don't fit in the queued input budget of the server or
+  // of the model.
   Status InferAsync(std::unique_ptr<InferenceRequest>& request);
 
+  // Run a batch of inference requests. If Status::Success is returned
+  // then the server has taken ownership of all 'requests', a request
+  // that can't be run is completed with an error response. If
+  // non-success is returned the caller retains ownership of 'requests'.
+  // The batch is rejected as a whole if its inputs don't fit in the
+  // queued input budgets.
+  Status InferAsyncBatch(
+      std::vector<std::unique_ptr<InferenceRequest>>& requests);
+
   // Load the corresponding model. Reload the model if it has been loaded.
   Status LoadModel(
       const std::unordered_map<
@@ -168,6 +181,25 @@ class InferenceServer {
   ModelControlMode GetModelControlMode() const { return model_control_mode_; }
   void SetModelControlMode(ModelControlMode m) { model_control_mode_ = m; }
 
+  // Get / set whether models are loaded when first requested, and the
+  // idle timeout and memory budget after which models loaded on demand
+  // are unloaded. Only used with MODE_EXPLICIT.
+  bool ModelLoadOnDemand() const { return model_load_on_demand_; }
+  void SetModelLoadOnDemand(bool e) { model_load_on_demand_ = e; }
+  void SetModelIdleUnload(uint64_t timeout_sec, uint64_t byte_size_budget)
+  {
+    model_idle_unload_timeout_sec_ = timeout_sec;
+    model_load_on_demand_byte_size_ = byte_size_budget;
+  }
+
+  // Set the budget for the input bytes of all requests accepted by
+  // InferAsync() and not yet released. Zero disables the limit.
+  void SetMaxQueuedInputByteSize(uint64_t byte_size)
+  {
+    queued_input_budget_ =
+        (byte_size > 0) ? std::make_shared<ByteBudget>(byte_size) : nullptr;
+  }
+
   // Get / set the startup models
   const std::set<std::string>& StartupModels() const { return startup_models_; }
   void SetStartupModels(const std::set<std::string>& m) { startup_models_ = m; }
@@ -197,6 +229,17 @@ class InferenceServer {
     pinned_memory_pool_size_ = std::max((int64_t)0, s);
   }
 
+  // Get / set the byte size up to which the pinned memory pool may grow,
+  // 0 if it may not grow.
+  uint64_t PinnedMemoryPoolMaxByteSize() const
+  {
+    return pinned_memory_pool_max_size_;
+  }
+  void SetPinnedMemoryPoolMaxByteSize(uint64_t s)
+  {
+    pinned_memory_pool_max_size_ = s;
+  }
+
   // Get / set whether response cache will be enabled server-wide.
   // NOTE: Models still need caching enabled in individual model configs.
   bool ResponseCacheEnabled()
@@ -220,6 +263,21 @@ class InferenceServer {
     cuda_memory_pool_size_ = s;
   }
 
+  // Get / set whether the CUDA memory pools are stream-ordered, and
+  // their release threshold and growth.
+  bool CudaMemoryPoolAsync() const { return cuda_memory_pool_async_; }
+  void SetCudaMemoryPoolAsync(bool e) { cuda_memory_pool_async_ = e; }
+  const std::map<int, uint64_t>& CudaMemoryPoolReleaseThreshold() const
+  {
+    return cuda_memory_pool_release_threshold_;
+  }
+  void SetCudaMemoryPoolReleaseThreshold(const std::map<int, uint64_t>& s)
+  {
+    cuda_memory_pool_release_threshold_ = s;
+  }
+  bool CudaMemoryPoolGrowth() const { return cuda_memory_pool_growth_; }
+  void SetCudaMemoryPoolGrowth(bool e) { cuda_memory_pool_growth_ = e; }
+
   // Get / set the minimum support CUDA compute capability.
   double MinSupportedComputeCapability() const
   {
@@ -265,6 +323,12 @@ class InferenceServer {
 
   void SetRepoAgentDir(const std::string& d) { repoagent_dir_ = d; }
 
+  // Return the requested model object to run inference on. If on-demand
+  // loading is enabled a model that is not loaded is loaded first.
+  Status GetInferenceModel(
+      const std::string& model_name, const int64_t model_version,
+      std::shared_ptr<Model>* model);
+
   // Return the requested model object.
   Status GetModel(
       const std::string& model_name, const int64_t model_version,
@@ -323,11 +387,18 @@ class InferenceServer {
   uint32_t buffer_manager_thread_count_;
   uint32_t model_load_thread_count_;
   bool enable_model_namespacing_;
+  bool model_load_on_demand_;
+  uint64_t model_idle_unload_timeout_sec_;
+  uint64_t model_load_on_demand_byte_size_;
   uint64_t pinned_memory_pool_size_;
+  uint64_t pinned_memory_pool_max_size_;
   bool response_cache_enabled_;
   CacheConfigMap cache_config_map_;
   std::string cache_dir_;
   std::map<int, uint64_t> cuda_memory_pool_size_;
+  bool cuda_memory_pool_async_;
+  std::map<int, uint64_t> cuda_memory_pool_release_threshold_;
+  bool cuda_memory_pool_growth_;
   double min_supported_compute_capability_;
   triton::common::BackendCmdlineConfigMap backend_cmdline_config_map_;
   triton::common::HostPolicyCmdlineConfigMap host_policy_map_;
@@ -344,8 +415,14 @@ class InferenceServer {
   // requests but that is determined by model shared_ptr).
   std::atomic<uint64_t> inflight_request_counter_;
 
+  // Shared with the accepted requests, which may be released after the
+  // server.
+  std::shared_ptr<ByteBudget> queued_input_budget_;
+
   std::shared_ptr<RateLimiter> rate_limiter_;
   std::unique_ptr<ModelRepositoryManager> model_repository_manager_;
+  // Must be destroyed before 'model_repository_manager_'
+  std::unique_ptr<OnDemandModelLoader> on_demand_model_loader_;
   std::shared_ptr<TritonBackendManager> backend_manager_;
   std::shared_ptr<TritonCacheManager> cache_manager_;
 };
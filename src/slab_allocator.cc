@@ -0,0 +1,180 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "slab_allocator.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace triton { namespace core {
+
+namespace {
+
+// Identifies an allocator in the thread caches, an address could be
+// reused by a later allocator.
+std::atomic<uint64_t> next_allocator_id{1};
+
+}  // namespace
+
+SlabAllocator::SlabAllocator(void* base, size_t byte_size)
+    : id_(next_allocator_id.fetch_add(1)), base_(static_cast<uint8_t*>(base)),
+      slab_count_(byte_size / kSlabByteSize), next_slab_(0),
+      slab_classes_(new uint8_t[byte_size / kSlabByteSize]),
+      classes_(std::make_shared<Classes>())
+{
+  std::memset(slab_classes_.get(), kUnassigned, slab_count_);
+}
+
+size_t
+SlabAllocator::ClassOf(size_t byte_size)
+{
+  size_t size_class = 0;
+  while ((size_class < kClassCount) &&
+         (BlockByteSize(size_class) < byte_size)) {
+    ++size_class;
+  }
+  return size_class;
+}
+
+size_t
+SlabAllocator::BatchCount(size_t size_class)
+{
+  return std::max<size_t>(1, kBatchByteSize / BlockByteSize(size_class));
+}
+
+SlabAllocator::ThreadCache&
+SlabAllocator::LocalCache() const
+{
+  thread_local ThreadCache cache;
+  if (cache.owner_id_ != id_) {
+    cache.Rebind(this);
+  }
+  return cache;
+}
+
+SlabAllocator::ThreadCache::~ThreadCache()
+{
+  Rebind(nullptr);
+}
+
+void
+SlabAllocator::ThreadCache::Rebind(const SlabAllocator* owner)
+{
+  // The blocks of an allocator that no longer exists are simply dropped
+  auto classes = owner_.lock();
+  for (size_t size_class = 0; size_class < kClassCount; ++size_class) {
+    auto& blocks = blocks_[size_class];
+    if (classes != nullptr) {
+      Release(classes.get(), size_class, &blocks, blocks.size());
+    }
+    blocks.clear();
+  }
+
+  owner_id_ = (owner != nullptr) ? owner->id_ : 0;
+  owner_ = (owner != nullptr) ? owner->classes_ : nullptr;
+}
+
+void*
+SlabAllocator::Allocate(size_t byte_size)
+{
+  const size_t size_class = ClassOf(byte_size);
+  if ((size_class >= kClassCount) || (slab_count_ == 0)) {
+    return nullptr;
+  }
+
+  auto& blocks = LocalCache().blocks_[size_class];
+  if (blocks.empty() && !Refill(size_class, &blocks)) {
+    return nullptr;
+  }
+  void* ptr = blocks.back();
+  blocks.pop_back();
+  return ptr;
+}
+
+bool
+SlabAllocator::Deallocate(void* ptr)
+{
+  uint8_t* const block = static_cast<uint8_t*>(ptr);
+  if ((block < base_) || (block >= (base_ + ByteSize()))) {
+    return false;
+  }
+
+  const size_t size_class = slab_classes_[(block - base_) / kSlabByteSize];
+  auto& blocks = LocalCache().blocks_[size_class];
+  blocks.push_back(ptr);
+  const size_t batch_count = BatchCount(size_class);
+  if (blocks.size() > (2 * batch_count)) {
+    Release(classes_.get(), size_class, &blocks, batch_count);
+  }
+  return true;
+}
+
+bool
+SlabAllocator::Refill(size_t size_class, std::vector<void*>* blocks)
+{
+  auto& free_list = classes_->free_lists_[size_class];
+  std::lock_guard<std::mutex> lk(free_list.mu_);
+  if (free_list.blocks_.empty()) {
+    const size_t slab = next_slab_.fetch_add(1);
+    if (slab >= slab_count_) {
+      return false;
+    }
+    slab_classes_[slab] = size_class;
+    const size_t block_byte_size = BlockByteSize(size_class);
+    uint8_t* const slab_base = base_ + (slab * kSlabByteSize);
+    for (size_t offset = 0; offset < kSlabByteSize;
+         offset += block_byte_size) {
+      free_list.blocks_.push_back(slab_base + offset);
+    }
+  }
+
+  const size_t count =
+      std::min(BatchCount(size_class), free_list.blocks_.size());
+  blocks->insert(
+      blocks->end(), free_list.blocks_.end() - count, free_list.blocks_.end());
+  free_list.blocks_.resize(free_list.blocks_.size() - count);
+  return true;
+}
+
+void
+SlabAllocator::Release(
+    Classes* classes, size_t size_class, std::vector<void*>* blocks,
+    size_t count)
+{
+  if (count == 0) {
+    return;
+  }
+
+  auto& free_list = classes->free_lists_[size_class];
+  {
+    std::lock_guard<std::mutex> lk(free_list.mu_);
+    free_list.blocks_.insert(
+        free_list.blocks_.end(), blocks->begin(), blocks->begin() + count);
+  }
+  blocks->erase(blocks->begin(), blocks->begin() + count);
+}
+
+}}  // namespace triton::core
@@ -0,0 +1,132 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace triton { namespace core {
+
+//
+// Size-class allocator over a caller-provided memory region. The region
+// is split into fixed-size slabs that are assigned to a size class on
+// first use and split into blocks of that class. Each thread keeps a
+// small cache of free blocks per class, so most allocations and frees
+// don't take a lock. The blocks of a slab are never returned to other
+// classes, which keeps the owner of a block computable from its address.
+//
+class SlabAllocator {
+ public:
+  static constexpr size_t kMinBlockByteSize = 1 << 10;
+  static constexpr size_t kMaxBlockByteSize = 1 << 20;
+  static constexpr size_t kSlabByteSize = 4 << 20;
+
+  // Manage the whole slabs that fit into ['base', 'base' + 'byte_size').
+  // The region must outlive the allocator.
+  SlabAllocator(void* base, size_t byte_size);
+
+  SlabAllocator(const SlabAllocator&) = delete;
+  SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+  // Return a block of at least 'byte_size' bytes, or nullptr if there is
+  // no size class for 'byte_size' or no free block of its class is left.
+  void* Allocate(size_t byte_size);
+
+  // Free 'ptr' if it was allocated from this allocator. Return false
+  // without doing anything otherwise.
+  bool Deallocate(void* ptr);
+
+  // The byte size of the managed region.
+  size_t ByteSize() const { return slab_count_ * kSlabByteSize; }
+
+  // The byte size of the slabs not yet carved into blocks of a class.
+  size_t UncarvedByteSize() const
+  {
+    const size_t next_slab = next_slab_.load(std::memory_order_relaxed);
+    return (next_slab < slab_count_) ? (slab_count_ - next_slab) * kSlabByteSize
+                                     : 0;
+  }
+
+ private:
+  static constexpr size_t kClassCount = 11;
+  static constexpr uint8_t kUnassigned = 0xFF;
+  // The number of bytes moved between a thread cache and a class free
+  // list at once. A thread caches at most twice as much per class.
+  static constexpr size_t kBatchByteSize = 256 << 10;
+
+  // State shared with the thread caches, which flush their blocks back
+  // on thread exit if the allocator still exists.
+  struct Classes {
+    struct FreeList {
+      std::mutex mu_;
+      std::vector<void*> blocks_;
+    };
+    std::array<FreeList, kClassCount> free_lists_;
+  };
+
+  struct ThreadCache {
+    ~ThreadCache();
+    // Return the blocks of the current owner and bind to 'owner'
+    void Rebind(const SlabAllocator* owner);
+
+    uint64_t owner_id_ = 0;
+    std::weak_ptr<Classes> owner_;
+    std::array<std::vector<void*>, kClassCount> blocks_;
+  };
+
+  static size_t ClassOf(size_t byte_size);
+  static size_t BlockByteSize(size_t size_class)
+  {
+    return kMinBlockByteSize << size_class;
+  }
+  static size_t BatchCount(size_t size_class);
+  // Return the cache of the calling thread, bound to this allocator
+  ThreadCache& LocalCache() const;
+  // Move a batch of free blocks of 'size_class' into 'blocks', carving a
+  // new slab if the class has none. Return false if none is left.
+  bool Refill(size_t size_class, std::vector<void*>* blocks);
+  // Move the oldest 'count' blocks of 'blocks' to the class free list
+  static void Release(
+      Classes* classes, size_t size_class, std::vector<void*>* blocks,
+      size_t count);
+
+  const uint64_t id_;
+  uint8_t* const base_;
+  const size_t slab_count_;
+  std::atomic<size_t> next_slab_;
+  // The size class of each slab, kUnassigned until the slab is carved.
+  // Written under the free list lock of the class before any block of
+  // the slab is handed out.
+  std::unique_ptr<uint8_t[]> slab_classes_;
+  std::shared_ptr<Classes> classes_;
+};
+
+}}  // namespace triton::core
@@ -0,0 +1,198 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace triton { namespace core {
+
+//
+// Streaming 64-bit hash over a sequence of byte ranges. The algorithm
+// follows XXH64: input is consumed in 32-byte stripes by four
+// independent accumulator lanes, so the inner loop has no cross-lane
+// dependency and is bound by memory bandwidth rather than by a
+// per-byte multiply chain. Update() may be called any number of times
+// and the digest only depends on the concatenation of the bytes, not on
+// how they were split across calls.
+//
+class StreamHash64 {
+ public:
+  explicit StreamHash64(uint64_t seed = 0)
+      : seed_(seed), buffer_size_(0), total_size_(0)
+  {
+    lanes_[0] = seed + kPrime1 + kPrime2;
+    lanes_[1] = seed + kPrime2;
+    lanes_[2] = seed;
+    lanes_[3] = seed - kPrime1;
+  }
+
+  // Add 'size' bytes starting at 'data' to the hash.
+  void Update(const void* data, size_t size)
+  {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    total_size_ += size;
+
+    if ((buffer_size_ + size) < kStripeSize) {
+      if (size > 0) {
+        std::memcpy(buffer_ + buffer_size_, p, size);
+        buffer_size_ += size;
+      }
+      return;
+    }
+
+    // Complete the partially filled stripe left by a previous call.
+    if (buffer_size_ > 0) {
+      const size_t fill = kStripeSize - buffer_size_;
+      std::memcpy(buffer_ + buffer_size_, p, fill);
+      ConsumeStripe(buffer_);
+      p += fill;
+      size -= fill;
+      buffer_size_ = 0;
+    }
+
+    while (size >= kStripeSize) {
+      ConsumeStripe(p);
+      p += kStripeSize;
+      size -= kStripeSize;
+    }
+
+    if (size > 0) {
+      std::memcpy(buffer_, p, size);
+      buffer_size_ = size;
+    }
+  }
+
+  // Add a string to the hash. The length is hashed ahead of the
+  // characters so that consecutive strings can't alias each other.
+  void Update(const std::string& str)
+  {
+    Update(static_cast<uint64_t>(str.size()));
+    Update(str.data(), str.size());
+  }
+
+  void Update(const uint64_t value) { Update(&value, sizeof(value)); }
+  void Update(const int64_t value) { Update(&value, sizeof(value)); }
+
+  // Return the hash of all bytes added so far. The state is not
+  // modified so more bytes may be added afterwards.
+  uint64_t Digest() const
+  {
+    uint64_t h;
+    if (total_size_ >= kStripeSize) {
+      h = RotateLeft(lanes_[0], 1) + RotateLeft(lanes_[1], 7) +
+          RotateLeft(lanes_[2], 12) + RotateLeft(lanes_[3], 18);
+      for (size_t i = 0; i < 4; ++i) {
+        h ^= Round(0, lanes_[i]);
+        h = h * kPrime1 + kPrime4;
+      }
+    } else {
+      h = seed_ + kPrime5;
+    }
+    h += total_size_;
+
+    const uint8_t* p = buffer_;
+    size_t remaining = buffer_size_;
+    while (remaining >= 8) {
+      h ^= Round(0, Read64(p));
+      h = RotateLeft(h, 27) * kPrime1 + kPrime4;
+      p += 8;
+      remaining -= 8;
+    }
+    if (remaining >= 4) {
+      h ^= static_cast<uint64_t>(Read32(p)) * kPrime1;
+      h = RotateLeft(h, 23) * kPrime2 + kPrime3;
+      p += 4;
+      remaining -= 4;
+    }
+    while (remaining > 0) {
+      h ^= static_cast<uint64_t>(*p) * kPrime5;
+      h = RotateLeft(h, 11) * kPrime1;
+      ++p;
+      --remaining;
+    }
+
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+    return h;
+  }
+
+ private:
+  static constexpr size_t kStripeSize = 32;
+  static constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+  static constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+  static constexpr uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+  static constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+  static constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+  static uint64_t RotateLeft(const uint64_t v, const int r)
+  {
+    return (v << r) | (v >> (64 - r));
+  }
+
+  static uint64_t Round(uint64_t acc, const uint64_t input)
+  {
+    acc += input * kPrime2;
+    acc = RotateLeft(acc, 31);
+    return acc * kPrime1;
+  }
+
+  // Unaligned reads, memcpy is lowered to a single load.
+  static uint64_t Read64(const uint8_t* p)
+  {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  static uint32_t Read32(const uint8_t* p)
+  {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  void ConsumeStripe(const uint8_t* p)
+  {
+    lanes_[0] = Round(lanes_[0], Read64(p));
+    lanes_[1] = Round(lanes_[1], Read64(p + 8));
+    lanes_[2] = Round(lanes_[2], Read64(p + 16));
+    lanes_[3] = Round(lanes_[3], Read64(p + 24));
+  }
+
+  const uint64_t seed_;
+  uint64_t lanes_[4];
+  uint8_t buffer_[kStripeSize];
+  size_t buffer_size_;
+  uint64_t total_size_;
+};
+
+}}  // namespace triton::core
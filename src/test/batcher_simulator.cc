@@ -0,0 +1,567 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Deterministic discrete-event simulation of the dynamic batcher and
+// the rate limiter, used to tune the batching configuration of a model
+// offline. Requests arrive as a seeded Poisson process, batches are
+// formed with the rules of DynamicBatchScheduler::GetDynamicBatch() on
+// a virtual clock and executed on the model instances for the time
+// given by a per-batch-size cost model. The predicted throughput,
+// batch size and latency percentiles are printed for every combination
+// of the swept values.
+//
+//   batcher_simulator [--<option> <value>]...
+//
+// Options, those marked with * take a comma-separated list of values to
+// sweep over:
+//   --requests N                 requests to simulate (10000)
+//   --rate R                     mean arrival rate in requests/s (1000)
+//   --seed S                     seed of the arrival process (1)
+//   --request-batch-size B       batch size of each request (1)
+//   --high-priority-fraction F   fraction of priority 1 requests, the
+//                                others have priority 2 (0)
+//   --max-batch-size B *         max_batch_size of the model (8)
+//   --preferred-batch-sizes L    preferred_batch_size list, defaults to
+//                                the max batch size like the model
+//                                config normalization
+//   --max-queue-delay-us D *     max_queue_delay_microseconds (0)
+//   --instances N *              model instance count (1)
+//   --resource-count C *         count of the rate limiter resource
+//                                available, 0 disables rate limiting (0)
+//   --instance-resource-count C  resource count each instance needs (1)
+//   --cost L                     execution time of a batch as a list of
+//                                <batch_size>:<us>, interpolated
+//                                linearly between the given sizes
+//                                (1:1000)
+
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <queue>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Request {
+  uint64_t arrival_ns_;
+  size_t batch_size_;
+  uint32_t priority_;
+};
+
+struct Workload {
+  size_t request_count_ = 10000;
+  double rate_ = 1000;
+  uint64_t seed_ = 1;
+  size_t request_batch_size_ = 1;
+  double high_priority_fraction_ = 0;
+};
+
+struct SchedulingConfig {
+  size_t max_batch_size_;
+  std::set<size_t> preferred_batch_sizes_;
+  uint64_t max_queue_delay_ns_;
+  size_t instance_count_;
+  size_t resource_count_;
+  size_t instance_resource_count_;
+};
+
+// Execution time of a batch, interpolated linearly between the
+// measured batch sizes and extrapolated from the last two beyond them.
+class CostModel {
+ public:
+  bool Parse(const std::string& spec)
+  {
+    std::istringstream in(spec);
+    std::string point;
+    while (std::getline(in, point, ',')) {
+      const size_t sep = point.find(':');
+      if (sep == std::string::npos) {
+        return false;
+      }
+      const size_t batch_size = std::strtoull(point.c_str(), nullptr, 10);
+      const double us = std::atof(point.c_str() + sep + 1);
+      if ((batch_size == 0) || (us < 0)) {
+        return false;
+      }
+      points_[batch_size] = us * 1000;
+    }
+    return !points_.empty();
+  }
+
+  uint64_t BatchNs(const size_t batch_size) const
+  {
+    if (points_.size() == 1) {
+      return points_.begin()->second;
+    }
+    auto hi = points_.lower_bound(batch_size);
+    if (hi == points_.end()) {
+      --hi;
+    } else if (hi->first == batch_size) {
+      return hi->second;
+    }
+    if (hi == points_.begin()) {
+      ++hi;
+    }
+    auto lo = std::prev(hi);
+    const double slope =
+        (hi->second - lo->second) / double(hi->first - lo->first);
+    const double ns = lo->second + slope * (double(batch_size) - lo->first);
+    return (ns > 0) ? uint64_t(ns) : 0;
+  }
+
+ private:
+  std::map<size_t, double> points_;
+};
+
+std::vector<Request>
+GenerateArrivals(const Workload& workload)
+{
+  std::mt19937_64 rng(workload.seed_);
+  std::exponential_distribution<double> interval_s(workload.rate_);
+  std::bernoulli_distribution high_priority(workload.high_priority_fraction_);
+  std::vector<Request> requests;
+  requests.reserve(workload.request_count_);
+  double now_s = 0;
+  for (size_t idx = 0; idx < workload.request_count_; ++idx) {
+    now_s += interval_s(rng);
+    requests.push_back(Request{
+        uint64_t(now_s * 1e9), workload.request_batch_size_,
+        high_priority(rng) ? 1u : 2u});
+  }
+  return requests;
+}
+
+struct Result {
+  double throughput_ = 0;
+  double avg_batch_size_ = 0;
+  double utilization_ = 0;
+  uint64_t p50_ns_ = 0;
+  uint64_t p90_ns_ = 0;
+  uint64_t p99_ns_ = 0;
+  uint64_t high_priority_p99_ns_ = 0;
+};
+
+//
+// One simulation run of a scheduling configuration
+//
+class Simulation {
+ public:
+  Simulation(
+      const SchedulingConfig& config, const CostModel& cost,
+      const std::vector<Request>& requests)
+      : config_(config), cost_(cost), requests_(requests),
+        free_resources_(config.resource_count_),
+        instance_free_(config.instance_count_, true)
+  {
+    max_preferred_batch_size_ = 0;
+    for (const auto size : config_.preferred_batch_sizes_) {
+      max_preferred_batch_size_ = std::max(max_preferred_batch_size_, size);
+    }
+  }
+
+  Result Run()
+  {
+    size_t next_arrival = 0;
+    uint64_t now_ns = 0;
+    while ((next_arrival < requests_.size()) || !executions_.empty() ||
+           QueueSize() != 0) {
+      uint64_t next_ns = std::numeric_limits<uint64_t>::max();
+      if (next_arrival < requests_.size()) {
+        next_ns = requests_[next_arrival].arrival_ns_;
+      }
+      if (!executions_.empty()) {
+        next_ns = std::min(next_ns, executions_.top().end_ns_);
+      }
+      if (wake_ns_ != 0) {
+        next_ns = std::min(next_ns, wake_ns_);
+      }
+      now_ns = std::max(now_ns, next_ns);
+      wake_ns_ = 0;
+
+      while (!executions_.empty() && (executions_.top().end_ns_ <= now_ns)) {
+        Complete(executions_.top());
+        executions_.pop();
+      }
+      while ((next_arrival < requests_.size()) &&
+             (requests_[next_arrival].arrival_ns_ <= now_ns)) {
+        queues_[requests_[next_arrival].priority_].push_back(next_arrival);
+        ++next_arrival;
+      }
+      Schedule(now_ns);
+    }
+    return Summarize(now_ns);
+  }
+
+ private:
+  struct Execution {
+    uint64_t end_ns_;
+    size_t instance_;
+    std::vector<size_t> requests_;
+    bool operator>(const Execution& rhs) const
+    {
+      return end_ns_ > rhs.end_ns_;
+    }
+  };
+
+  size_t QueueSize() const
+  {
+    size_t size = 0;
+    for (const auto& queue : queues_) {
+      size += queue.second.size();
+    }
+    return size;
+  }
+
+  // Return a free instance that the rate limiter would allow to run, or
+  // the instance count if there is none.
+  size_t AvailableInstance() const
+  {
+    if ((config_.resource_count_ != 0) &&
+        (free_resources_ < config_.instance_resource_count_)) {
+      return config_.instance_count_;
+    }
+    for (size_t idx = 0; idx < config_.instance_count_; ++idx) {
+      if (instance_free_[idx]) {
+        return idx;
+      }
+    }
+    return config_.instance_count_;
+  }
+
+  // Dispatch batches while an instance is available, the dynamic
+  // batcher only forms a batch once the rate limiter has a slot for it.
+  void Schedule(const uint64_t now_ns)
+  {
+    while (QueueSize() != 0) {
+      const size_t instance = AvailableInstance();
+      if (instance == config_.instance_count_) {
+        return;
+      }
+      size_t request_count = 0;
+      const uint64_t wait_ns = FormBatch(now_ns, &request_count);
+      if (request_count == 0) {
+        wake_ns_ = now_ns + wait_ns;
+        return;
+      }
+      Dispatch(now_ns, instance, request_count);
+    }
+  }
+
+  // Examine the queued requests in priority order the way
+  // GetDynamicBatch() examines them from the cursor. Set
+  // 'request_count' to the number of requests to execute now, or return
+  // the time to wait for the queue delay to expire if the batch should
+  // not be sent yet.
+  uint64_t FormBatch(const uint64_t now_ns, size_t* request_count)
+  {
+    size_t pending_batch_size = 0;
+    size_t pending_count = 0;
+    size_t best_preferred_batch_size = 0;
+    size_t best_count = 0;
+    bool send_now = false;
+    uint64_t oldest_ns = std::numeric_limits<uint64_t>::max();
+    for (const auto& queue : queues_) {
+      for (const size_t idx : queue.second) {
+        const size_t batch_size =
+            std::max<size_t>(1, requests_[idx].batch_size_);
+        if (pending_batch_size != 0) {
+          if (((pending_batch_size + batch_size) > max_preferred_batch_size_) &&
+              (best_preferred_batch_size == 0)) {
+            best_preferred_batch_size = pending_batch_size;
+            best_count = pending_count;
+          }
+          if ((pending_batch_size + batch_size) > config_.max_batch_size_) {
+            send_now = true;
+            break;
+          }
+        }
+        pending_batch_size += batch_size;
+        ++pending_count;
+        oldest_ns = std::min(oldest_ns, requests_[idx].arrival_ns_);
+        if (config_.preferred_batch_sizes_.find(pending_batch_size) !=
+            config_.preferred_batch_sizes_.end()) {
+          best_preferred_batch_size = pending_batch_size;
+          best_count = pending_count;
+        }
+      }
+      if (send_now) {
+        break;
+      }
+    }
+
+    const uint64_t delay_ns = now_ns - oldest_ns;
+    const bool delay_is_exceeded = (config_.max_queue_delay_ns_ != 0) &&
+                                   (delay_ns >= config_.max_queue_delay_ns_);
+    *request_count = 0;
+    if ((best_preferred_batch_size != 0) && !delay_is_exceeded) {
+      *request_count = best_count;
+    } else if (
+        send_now || (pending_batch_size >= max_preferred_batch_size_) ||
+        delay_is_exceeded || (config_.max_queue_delay_ns_ == 0)) {
+      *request_count = pending_count;
+    }
+    return (*request_count != 0) ? 0
+                                 : (config_.max_queue_delay_ns_ - delay_ns);
+  }
+
+  void Dispatch(
+      const uint64_t now_ns, const size_t instance, size_t request_count)
+  {
+    Execution execution;
+    execution.instance_ = instance;
+    size_t batch_size = 0;
+    for (auto& queue : queues_) {
+      while ((request_count != 0) && !queue.second.empty()) {
+        const size_t idx = queue.second.front();
+        queue.second.pop_front();
+        execution.requests_.push_back(idx);
+        batch_size += std::max<size_t>(1, requests_[idx].batch_size_);
+        --request_count;
+      }
+    }
+    const uint64_t exec_ns = cost_.BatchNs(batch_size);
+    execution.end_ns_ = now_ns + exec_ns;
+    instance_free_[instance] = false;
+    if (config_.resource_count_ != 0) {
+      free_resources_ -= config_.instance_resource_count_;
+    }
+    busy_ns_ += exec_ns;
+    ++batch_count_;
+    executed_batch_size_ += batch_size;
+    executions_.push(std::move(execution));
+  }
+
+  void Complete(const Execution& execution)
+  {
+    instance_free_[execution.instance_] = true;
+    if (config_.resource_count_ != 0) {
+      free_resources_ += config_.instance_resource_count_;
+    }
+    for (const size_t idx : execution.requests_) {
+      const uint64_t latency_ns =
+          execution.end_ns_ - requests_[idx].arrival_ns_;
+      latencies_ns_.push_back(latency_ns);
+      if (requests_[idx].priority_ == 1) {
+        high_priority_latencies_ns_.push_back(latency_ns);
+      }
+    }
+  }
+
+  static uint64_t Percentile(std::vector<uint64_t>* values, const size_t p)
+  {
+    if (values->empty()) {
+      return 0;
+    }
+    const size_t idx = std::min(values->size() - 1, (values->size() * p) / 100);
+    std::nth_element(values->begin(), values->begin() + idx, values->end());
+    return (*values)[idx];
+  }
+
+  Result Summarize(const uint64_t end_ns)
+  {
+    Result result;
+    if (end_ns != 0) {
+      result.throughput_ = latencies_ns_.size() / (end_ns / 1e9);
+      result.utilization_ =
+          double(busy_ns_) / (double(end_ns) * config_.instance_count_);
+    }
+    if (batch_count_ != 0) {
+      result.avg_batch_size_ = double(executed_batch_size_) / batch_count_;
+    }
+    result.p50_ns_ = Percentile(&latencies_ns_, 50);
+    result.p90_ns_ = Percentile(&latencies_ns_, 90);
+    result.p99_ns_ = Percentile(&latencies_ns_, 99);
+    result.high_priority_p99_ns_ = Percentile(&high_priority_latencies_ns_, 99);
+    return result;
+  }
+
+  const SchedulingConfig& config_;
+  const CostModel& cost_;
+  const std::vector<Request>& requests_;
+  size_t max_preferred_batch_size_;
+
+  // Queued requests by priority level, lower levels are served first
+  std::map<uint32_t, std::deque<size_t>> queues_;
+  std::priority_queue<
+      Execution, std::vector<Execution>, std::greater<Execution>>
+      executions_;
+  size_t free_resources_;
+  std::vector<bool> instance_free_;
+  // Time the batcher wakes up to revisit the pending batch, 0 if none
+  uint64_t wake_ns_ = 0;
+
+  uint64_t busy_ns_ = 0;
+  size_t batch_count_ = 0;
+  size_t executed_batch_size_ = 0;
+  std::vector<uint64_t> latencies_ns_;
+  std::vector<uint64_t> high_priority_latencies_ns_;
+};
+
+bool
+ParseList(const std::string& spec, std::vector<size_t>* values)
+{
+  values->clear();
+  std::istringstream in(spec);
+  std::string value;
+  while (std::getline(in, value, ',')) {
+    char* end = nullptr;
+    values->push_back(std::strtoull(value.c_str(), &end, 10));
+    if (value.empty() || (*end != '\0')) {
+      return false;
+    }
+  }
+  return !values->empty();
+}
+
+void
+Usage(const char* program)
+{
+  std::cerr << "usage: " << program << " [--<option> <value>]..., see the"
+            << " comment at the top of batcher_simulator.cc" << std::endl;
+}
+
+}  // namespace
+
+int
+main(int argc, char** argv)
+{
+  Workload workload;
+  std::vector<size_t> max_batch_sizes{8};
+  std::vector<size_t> preferred_batch_sizes;
+  std::vector<size_t> max_queue_delays_us{0};
+  std::vector<size_t> instance_counts{1};
+  std::vector<size_t> resource_counts{0};
+  size_t instance_resource_count = 1;
+  CostModel cost;
+  std::string cost_spec = "1:1000";
+
+  for (int idx = 1; idx < argc; idx += 2) {
+    const std::string arg = argv[idx];
+    if ((idx + 1) >= argc) {
+      Usage(argv[0]);
+      return 1;
+    }
+    const std::string value = argv[idx + 1];
+    bool valid = true;
+    if (arg == "--requests") {
+      workload.request_count_ = std::strtoull(value.c_str(), nullptr, 10);
+    } else if (arg == "--rate") {
+      workload.rate_ = std::atof(value.c_str());
+      valid = (workload.rate_ > 0);
+    } else if (arg == "--seed") {
+      workload.seed_ = std::strtoull(value.c_str(), nullptr, 10);
+    } else if (arg == "--request-batch-size") {
+      workload.request_batch_size_ = std::strtoull(value.c_str(), nullptr, 10);
+    } else if (arg == "--high-priority-fraction") {
+      workload.high_priority_fraction_ = std::atof(value.c_str());
+      valid = (workload.high_priority_fraction_ >= 0) &&
+              (workload.high_priority_fraction_ <= 1);
+    } else if (arg == "--max-batch-size") {
+      valid = ParseList(value, &max_batch_sizes);
+    } else if (arg == "--preferred-batch-sizes") {
+      valid = ParseList(value, &preferred_batch_sizes);
+    } else if (arg == "--max-queue-delay-us") {
+      valid = ParseList(value, &max_queue_delays_us);
+    } else if (arg == "--instances") {
+      valid = ParseList(value, &instance_counts);
+    } else if (arg == "--resource-count") {
+      valid = ParseList(value, &resource_counts);
+    } else if (arg == "--instance-resource-count") {
+      instance_resource_count = std::strtoull(value.c_str(), nullptr, 10);
+    } else if (arg == "--cost") {
+      cost_spec = value;
+    } else {
+      valid = false;
+    }
+    if (!valid) {
+      std::cerr << "error: invalid value '" << value << "' for " << arg
+                << std::endl;
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+  if (!cost.Parse(cost_spec)) {
+    std::cerr << "error: invalid cost model '" << cost_spec << "'"
+              << std::endl;
+    return 1;
+  }
+
+  const std::vector<Request> requests = GenerateArrivals(workload);
+  std::cout << std::setw(8) << "max_bs" << std::setw(10) << "delay_us"
+            << std::setw(10) << "instances" << std::setw(10) << "resources"
+            << std::setw(12) << "infer/s" << std::setw(10) << "avg_bs"
+            << std::setw(8) << "util" << std::setw(12) << "p50_us"
+            << std::setw(12) << "p90_us" << std::setw(12) << "p99_us"
+            << std::setw(12) << "p99_hi_us" << std::endl;
+  for (const size_t max_batch_size : max_batch_sizes) {
+    for (const size_t max_queue_delay_us : max_queue_delays_us) {
+      for (const size_t instance_count : instance_counts) {
+        for (const size_t resource_count : resource_counts) {
+          SchedulingConfig config{
+              max_batch_size,
+              std::set<size_t>(
+                  preferred_batch_sizes.begin(), preferred_batch_sizes.end()),
+              max_queue_delay_us * 1000,
+              std::max<size_t>(1, instance_count),
+              resource_count,
+              instance_resource_count};
+          if (config.preferred_batch_sizes_.empty()) {
+            config.preferred_batch_sizes_.insert(max_batch_size);
+          }
+          if ((resource_count != 0) &&
+              (resource_count < instance_resource_count)) {
+            std::cerr << "error: resource count " << resource_count
+                      << " can't run any instance" << std::endl;
+            return 1;
+          }
+
+          const Result result = Simulation(config, cost, requests).Run();
+          std::cout << std::fixed << std::setprecision(1) << std::setw(8)
+                    << max_batch_size << std::setw(10) << max_queue_delay_us
+                    << std::setw(10) << config.instance_count_
+                    << std::setw(10) << resource_count << std::setw(12)
+                    << result.throughput_ << std::setw(10)
+                    << result.avg_batch_size_ << std::setprecision(2)
+                    << std::setw(8) << result.utilization_
+                    << std::setprecision(1) << std::setw(12)
+                    << result.p50_ns_ / 1e3 << std::setw(12)
+                    << result.p90_ns_ / 1e3 << std::setw(12)
+                    << result.p99_ns_ / 1e3 << std::setw(12)
+                    << result.high_priority_p99_ns_ / 1e3 << std::endl;
+        }
+      }
+    }
+  }
+  return 0;
+}
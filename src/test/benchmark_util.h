@@ -0,0 +1,233 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+// Helpers shared by the benchmarks and the tests using the null
+// backend: error reporting, timing, latency percentiles and a server
+// over a temporary model repository. Everything is inline so that a
+// benchmark only links what it uses, the memory benchmark is built from
+// the core sources without the server library.
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "triton/core/tritonserver.h"
+
+namespace triton { namespace core { namespace test {
+
+// Report and consume 'err', return true if there was no error
+inline bool
+Check(TRITONSERVER_Error* err, const std::string& msg)
+{
+  if (err == nullptr) {
+    return true;
+  }
+  std::cerr << "error: " << msg << ": " << TRITONSERVER_ErrorCodeString(err)
+            << " - " << TRITONSERVER_ErrorMessage(err) << std::endl;
+  TRITONSERVER_ErrorDelete(err);
+  return false;
+}
+
+inline uint64_t
+NowNs()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+//
+// Latency samples of one thread
+//
+class LatencySamples {
+ public:
+  void Add(uint64_t ns) { samples_.push_back(ns); }
+  size_t Size() const { return samples_.size(); }
+
+  // Return the 'p'th percentile of the samples, or 0 if there are
+  // none. The samples are reordered.
+  uint64_t Percentile(const size_t p)
+  {
+    if (samples_.empty()) {
+      return 0;
+    }
+    const size_t idx =
+        std::min(samples_.size() - 1, (samples_.size() * p) / 100);
+    std::nth_element(samples_.begin(), samples_.begin() + idx, samples_.end());
+    return samples_[idx];
+  }
+
+  // Report the p99 latency of the thread as the "p99_ns" counter of the
+  // Google Benchmark 'state', averaged over the threads of the run. A
+  // template so that the header doesn't depend on Google Benchmark.
+  template <typename State>
+  void Report(State& state)
+  {
+    using Counter = typename decltype(state.counters)::mapped_type;
+    if (!samples_.empty()) {
+      state.counters["p99_ns"] = Counter(Percentile(99), Counter::kAvgThreads);
+    }
+  }
+
+ private:
+  std::vector<uint64_t> samples_;
+};
+
+//
+// Model repository written to a temporary directory, removed with the
+// object.
+//
+class ModelRepository {
+ public:
+  ~ModelRepository()
+  {
+    for (auto it = files_.rbegin(); it != files_.rend(); ++it) {
+      unlink(it->c_str());
+    }
+    for (auto it = dirs_.rbegin(); it != dirs_.rend(); ++it) {
+      rmdir(it->c_str());
+    }
+  }
+
+  // Create the empty repository in a new directory named after
+  // 'prefix'. Return false on error.
+  bool Create(const std::string& prefix)
+  {
+    std::string root = "/tmp/" + prefix + "_XXXXXX";
+    if (mkdtemp(&root[0]) == nullptr) {
+      return false;
+    }
+    root_ = root;
+    dirs_.push_back(root_);
+    return true;
+  }
+
+  // Add version 1 of model 'name' with the configuration 'config',
+  // without the name. Return false on error.
+  bool AddModel(const std::string& name, const std::string& config)
+  {
+    const std::string model_dir = root_ + "/" + name;
+    const std::string version_dir = model_dir + "/1";
+    if (mkdir(model_dir.c_str(), 0755) != 0) {
+      return false;
+    }
+    dirs_.push_back(model_dir);
+    if (mkdir(version_dir.c_str(), 0755) != 0) {
+      return false;
+    }
+    dirs_.push_back(version_dir);
+
+    const std::string config_path = model_dir + "/config.pbtxt";
+    std::ofstream out(config_path);
+    files_.push_back(config_path);
+    out << "name: \"" << name << "\"\n" << config;
+    return out.good();
+  }
+
+  const std::string& Root() const { return root_; }
+
+ private:
+  std::string root_;
+  std::vector<std::string> dirs_;
+  std::vector<std::string> files_;
+};
+
+// Response allocator functions returning CPU buffers from malloc
+inline TRITONSERVER_Error*
+ResponseAlloc(
+    TRITONSERVER_ResponseAllocator* allocator, const char* tensor_name,
+    size_t byte_size, TRITONSERVER_MemoryType memory_type,
+    int64_t memory_type_id, void* userp, void** buffer, void** buffer_userp,
+    TRITONSERVER_MemoryType* actual_memory_type,
+    int64_t* actual_memory_type_id)
+{
+  *buffer = (byte_size == 0) ? nullptr : std::malloc(byte_size);
+  *buffer_userp = nullptr;
+  *actual_memory_type = TRITONSERVER_MEMORY_CPU;
+  *actual_memory_type_id = 0;
+  return nullptr;  // success
+}
+
+inline TRITONSERVER_Error*
+ResponseRelease(
+    TRITONSERVER_ResponseAllocator* allocator, void* buffer,
+    void* buffer_userp, size_t byte_size, TRITONSERVER_MemoryType memory_type,
+    int64_t memory_type_id)
+{
+  std::free(buffer);
+  return nullptr;  // success
+}
+
+// Create 'server' over 'repository' and 'allocator' of the outputs.
+// The backends are looked up in the directory given by the
+// TRITON_NULL_BACKEND_DIR environment variable, or in 'backend_dir' if
+// it is not set. 'configure' sets the options specific to the caller
+// and returns false on error. Return false on error.
+inline bool
+StartServer(
+    const ModelRepository& repository, const char* backend_dir,
+    const std::function<bool(TRITONSERVER_ServerOptions*)>& configure,
+    TRITONSERVER_Server** server, TRITONSERVER_ResponseAllocator** allocator)
+{
+  const char* env_backend_dir = std::getenv("TRITON_NULL_BACKEND_DIR");
+  if (env_backend_dir != nullptr) {
+    backend_dir = env_backend_dir;
+  }
+
+  TRITONSERVER_ServerOptions* options = nullptr;
+  if (!Check(TRITONSERVER_ServerOptionsNew(&options), "creating options")) {
+    return false;
+  }
+  const bool created =
+      Check(
+          TRITONSERVER_ServerOptionsSetModelRepositoryPath(
+              options, repository.Root().c_str()),
+          "setting model repository path") &&
+      Check(
+          TRITONSERVER_ServerOptionsSetBackendDirectory(options, backend_dir),
+          "setting backend directory") &&
+      Check(
+          TRITONSERVER_ServerOptionsSetLogInfo(options, false),
+          "disabling info logging") &&
+      configure(options) &&
+      Check(TRITONSERVER_ServerNew(server, options), "creating server");
+  Check(TRITONSERVER_ServerOptionsDelete(options), "deleting options");
+  return created && Check(
+                        TRITONSERVER_ResponseAllocatorNew(
+                            allocator, ResponseAlloc, ResponseRelease,
+                            nullptr /* start_fn */),
+                        "creating response allocator");
+}
+
+}}}  // namespace triton::core::test
@@ -0,0 +1,208 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+#include "bytes_tensor.h"
+
+namespace tc = triton::core;
+
+namespace {
+
+// The contiguous form of 'elements'
+tc::ContiguousBytes
+Contiguous(const std::vector<std::string>& elements)
+{
+  tc::ContiguousBytes bytes;
+  bytes.offsets_.push_back(0);
+  for (const auto& element : elements) {
+    bytes.data_.insert(bytes.data_.end(), element.begin(), element.end());
+    bytes.offsets_.push_back(bytes.data_.size());
+  }
+  return bytes;
+}
+
+// The length-prefixed serialization of 'elements'
+std::string
+Serialized(const std::vector<std::string>& elements)
+{
+  std::string serialized;
+  for (const auto& element : elements) {
+    const uint32_t length = element.size();
+    serialized.append(
+        reinterpret_cast<const char*>(&length), sizeof(uint32_t));
+    serialized.append(element);
+  }
+  return serialized;
+}
+
+TEST(BytesTensorTest, RoundTrip)
+{
+  const std::vector<std::vector<std::string>> cases{
+      {},
+      {""},
+      {"a"},
+      {"", "", ""},
+      {"first", "", "third element", std::string("nul\0in", 6)},
+      {std::string(1000, 'x'), "y"}};
+  for (const auto& elements : cases) {
+    const tc::ContiguousBytes bytes = Contiguous(elements);
+    size_t byte_size = 0;
+    ASSERT_TRUE(
+        tc::SerializedBytesSize(
+            bytes.offsets_.data(), elements.size(), &byte_size)
+            .IsOk());
+    ASSERT_EQ(byte_size, Serialized(elements).size());
+
+    std::string serialized(byte_size, '\0');
+    tc::SerializeBytes(
+        bytes.data_.data(), bytes.offsets_.data(), elements.size(),
+        &serialized[0]);
+    EXPECT_EQ(serialized, Serialized(elements));
+
+    tc::ContiguousBytes deserialized;
+    ASSERT_TRUE(tc::DeserializeBytes(
+                    serialized.data(), serialized.size(), elements.size(),
+                    &deserialized)
+                    .IsOk());
+    EXPECT_EQ(deserialized.offsets_, bytes.offsets_);
+    EXPECT_EQ(deserialized.data_, bytes.data_);
+  }
+}
+
+TEST(BytesTensorTest, OffsetsNotStartingAtZero)
+{
+  // The elements may be a window of a larger data buffer
+  const std::string data = "skipped|ab|cde";
+  const std::vector<uint64_t> offsets{8, 10, 11, 14};
+  size_t byte_size = 0;
+  ASSERT_TRUE(tc::SerializedBytesSize(offsets.data(), 3, &byte_size).IsOk());
+  const std::string expected = Serialized({"ab", "|", "cde"});
+  ASSERT_EQ(byte_size, expected.size());
+
+  std::string serialized(byte_size, '\0');
+  tc::SerializeBytes(data.data(), offsets.data(), 3, &serialized[0]);
+  EXPECT_EQ(serialized, expected);
+}
+
+TEST(BytesTensorTest, DecreasingOffsets)
+{
+  const std::vector<uint64_t> offsets{0, 4, 2, 6};
+  size_t byte_size = 0;
+  const tc::Status status =
+      tc::SerializedBytesSize(offsets.data(), 3, &byte_size);
+  EXPECT_EQ(status.StatusCode(), tc::Status::Code::INVALID_ARG);
+  EXPECT_EQ(byte_size, 0u);
+}
+
+TEST(BytesTensorTest, ElementTooLarge)
+{
+  // Only the offsets are read, the data is never touched
+  const uint64_t too_large =
+      static_cast<uint64_t>(std::numeric_limits<uint32_t>::max()) + 1;
+  const std::vector<uint64_t> offsets{0, 1, 1 + too_large};
+  size_t byte_size = 0;
+  const tc::Status status =
+      tc::SerializedBytesSize(offsets.data(), 2, &byte_size);
+  EXPECT_EQ(status.StatusCode(), tc::Status::Code::INVALID_ARG);
+  EXPECT_EQ(byte_size, 0u);
+
+  // The largest element that fits the 4-byte length is accepted
+  const std::vector<uint64_t> largest{0, too_large - 1};
+  EXPECT_TRUE(tc::SerializedBytesSize(largest.data(), 1, &byte_size).IsOk());
+  EXPECT_EQ(byte_size, sizeof(uint32_t) + too_large - 1);
+}
+
+TEST(BytesTensorTest, TruncatedLength)
+{
+  // The second element lacks part of its length
+  std::string serialized = Serialized({"abc", "de"});
+  serialized.resize(serialized.size() - 4);
+  tc::ContiguousBytes bytes;
+  EXPECT_FALSE(
+      tc::DeserializeBytes(serialized.data(), serialized.size(), 2, &bytes)
+          .IsOk());
+}
+
+TEST(BytesTensorTest, LengthBeyondBuffer)
+{
+  std::string serialized = Serialized({"abc"});
+  const uint32_t length = 1000;
+  std::memcpy(&serialized[0], &length, sizeof(uint32_t));
+  tc::ContiguousBytes bytes;
+  EXPECT_FALSE(
+      tc::DeserializeBytes(serialized.data(), serialized.size(), 1, &bytes)
+          .IsOk());
+
+  // A length that leaves no room for the lengths of the later elements
+  serialized = Serialized({"abc", ""});
+  const uint32_t swallowing = 5;
+  std::memcpy(&serialized[0], &swallowing, sizeof(uint32_t));
+  EXPECT_FALSE(
+      tc::DeserializeBytes(serialized.data(), serialized.size(), 2, &bytes)
+          .IsOk());
+
+  // The largest length, must not wrap around the buffer bounds
+  serialized = Serialized({"abc"});
+  const uint32_t largest = std::numeric_limits<uint32_t>::max();
+  std::memcpy(&serialized[0], &largest, sizeof(uint32_t));
+  EXPECT_FALSE(
+      tc::DeserializeBytes(serialized.data(), serialized.size(), 1, &bytes)
+          .IsOk());
+}
+
+TEST(BytesTensorTest, ElementCountMismatch)
+{
+  const std::string serialized = Serialized({"abc", "de"});
+  tc::ContiguousBytes bytes;
+  // Fewer elements than serialized leaves bytes over
+  EXPECT_FALSE(
+      tc::DeserializeBytes(serialized.data(), serialized.size(), 1, &bytes)
+          .IsOk());
+  // More elements than serialized runs out of lengths
+  EXPECT_FALSE(
+      tc::DeserializeBytes(serialized.data(), serialized.size(), 3, &bytes)
+          .IsOk());
+  // Too small to hold the lengths of all the elements
+  EXPECT_FALSE(tc::DeserializeBytes(serialized.data(), 4, 2, &bytes).IsOk());
+  EXPECT_FALSE(tc::DeserializeBytes(serialized.data(), 0, 1, &bytes).IsOk());
+  // No elements in no bytes
+  EXPECT_TRUE(tc::DeserializeBytes(serialized.data(), 0, 0, &bytes).IsOk());
+}
+
+}  // namespace
+
+int
+main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,284 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+#include "json_writer.h"
+
+#define TRITONJSON_STATUSTYPE bool
+#define TRITONJSON_STATUSRETURN(M) return false
+#define TRITONJSON_STATUSSUCCESS true
+#include "triton/common/triton_json.h"
+
+namespace tc = triton::core;
+using triton::common::TritonJson;
+
+namespace {
+
+// Strings that exercise every escape of TritonJson
+const std::vector<std::string> kStrings{
+    "",
+    "plain",
+    "quote \" and backslash \\ and slash /",
+    "\b\f\n\r\t",
+    std::string("nul \0 and \x01 \x1f \x7f", 15),
+    "utf-8 \xc3\xa9\xe2\x82\xac",
+};
+
+std::string
+WriteDocument(TritonJson::Value& value)
+{
+  TritonJson::WriteBuffer buffer;
+  EXPECT_TRUE(value.Write(&buffer));
+  return buffer.Contents();
+}
+
+struct DurationStat {
+  const char* name_;
+  uint64_t count_;
+  uint64_t ns_;
+};
+
+struct ModelStatistics {
+  std::string name_;
+  int64_t version_;
+  uint64_t last_inference_;
+  std::vector<DurationStat> inference_stats_;
+  std::vector<std::pair<uint64_t, std::vector<DurationStat>>> batch_stats_;
+  std::vector<std::pair<std::string, int64_t>> memory_usage_;
+};
+
+// The layout of the statistics of TRITONSERVER_ServerModelStatistics
+std::string
+StatisticsWithWriter(const ModelStatistics& stats)
+{
+  std::string json;
+  tc::JsonWriter writer(&json);
+  auto write_durations = [&writer](const std::vector<DurationStat>& stats) {
+    for (const auto& stat : stats) {
+      writer.Key(stat.name_);
+      writer.BeginObject();
+      writer.Key("count");
+      writer.UInt(stat.count_);
+      writer.Key("ns");
+      writer.UInt(stat.ns_);
+      writer.EndObject();
+    }
+  };
+
+  writer.BeginObject();
+  writer.Key("name");
+  writer.String(stats.name_);
+  writer.Key("version");
+  writer.String(std::to_string(stats.version_));
+  writer.Key("last_inference");
+  writer.UInt(stats.last_inference_);
+  writer.Key("inference_stats");
+  writer.BeginObject();
+  write_durations(stats.inference_stats_);
+  writer.EndObject();
+  writer.Key("batch_stats");
+  writer.BeginArray();
+  for (const auto& batch : stats.batch_stats_) {
+    writer.BeginObject();
+    writer.Key("batch_size");
+    writer.UInt(batch.first);
+    write_durations(batch.second);
+    writer.EndObject();
+  }
+  writer.EndArray();
+  writer.Key("memory_usage");
+  writer.BeginArray();
+  for (const auto& usage : stats.memory_usage_) {
+    writer.BeginObject();
+    writer.Key("type");
+    writer.String(usage.first);
+    writer.Key("id");
+    writer.Int(usage.second);
+    writer.EndObject();
+  }
+  writer.EndArray();
+  writer.EndObject();
+  return json;
+}
+
+std::string
+StatisticsWithDocument(const ModelStatistics& stats)
+{
+  TritonJson::Value model_stat(TritonJson::ValueType::OBJECT);
+  auto add_durations = [&model_stat](
+                           TritonJson::Value& parent,
+                           const std::vector<DurationStat>& stats) {
+    for (const auto& stat : stats) {
+      TritonJson::Value dstat(model_stat, TritonJson::ValueType::OBJECT);
+      EXPECT_TRUE(dstat.AddUInt("count", stat.count_));
+      EXPECT_TRUE(dstat.AddUInt("ns", stat.ns_));
+      EXPECT_TRUE(parent.Add(stat.name_, std::move(dstat)));
+    }
+  };
+
+  EXPECT_TRUE(model_stat.AddString("name", stats.name_));
+  EXPECT_TRUE(model_stat.AddString("version", std::to_string(stats.version_)));
+  EXPECT_TRUE(model_stat.AddUInt("last_inference", stats.last_inference_));
+  TritonJson::Value inference_stats(
+      model_stat, TritonJson::ValueType::OBJECT);
+  add_durations(inference_stats, stats.inference_stats_);
+  EXPECT_TRUE(model_stat.Add("inference_stats", std::move(inference_stats)));
+  TritonJson::Value batch_stats(model_stat, TritonJson::ValueType::ARRAY);
+  for (const auto& batch : stats.batch_stats_) {
+    TritonJson::Value batch_stat(model_stat, TritonJson::ValueType::OBJECT);
+    EXPECT_TRUE(batch_stat.AddUInt("batch_size", batch.first));
+    add_durations(batch_stat, batch.second);
+    EXPECT_TRUE(batch_stats.Append(std::move(batch_stat)));
+  }
+  EXPECT_TRUE(model_stat.Add("batch_stats", std::move(batch_stats)));
+  TritonJson::Value memory_usage(model_stat, TritonJson::ValueType::ARRAY);
+  for (const auto& usage : stats.memory_usage_) {
+    TritonJson::Value usage_json(model_stat, TritonJson::ValueType::OBJECT);
+    EXPECT_TRUE(usage_json.AddString("type", usage.first));
+    EXPECT_TRUE(usage_json.AddInt("id", usage.second));
+    EXPECT_TRUE(memory_usage.Append(std::move(usage_json)));
+  }
+  EXPECT_TRUE(model_stat.Add("memory_usage", std::move(memory_usage)));
+  return WriteDocument(model_stat);
+}
+
+struct IndexEntry {
+  std::string name_;
+  bool name_only_;
+  int64_t version_;
+  std::string state_;
+  std::string reason_;
+};
+
+// The layout of the index of TRITONSERVER_ServerModelIndex
+std::string
+IndexWithWriter(const std::vector<IndexEntry>& index)
+{
+  std::string json;
+  tc::JsonWriter writer(&json);
+  writer.BeginArray();
+  for (const auto& in : index) {
+    writer.BeginObject();
+    writer.Key("name");
+    writer.String(in.name_);
+    if (!in.name_only_) {
+      if (in.version_ >= 0) {
+        writer.Key("version");
+        writer.String(std::to_string(in.version_));
+      }
+      writer.Key("state");
+      writer.String(in.state_);
+      if (!in.reason_.empty()) {
+        writer.Key("reason");
+        writer.String(in.reason_);
+      }
+    }
+    writer.EndObject();
+  }
+  writer.EndArray();
+  return json;
+}
+
+std::string
+IndexWithDocument(const std::vector<IndexEntry>& index)
+{
+  TritonJson::Value index_json(TritonJson::ValueType::ARRAY);
+  for (const auto& in : index) {
+    TritonJson::Value model_index(index_json, TritonJson::ValueType::OBJECT);
+    EXPECT_TRUE(model_index.AddString("name", in.name_));
+    if (!in.name_only_) {
+      if (in.version_ >= 0) {
+        EXPECT_TRUE(
+            model_index.AddString("version", std::to_string(in.version_)));
+      }
+      EXPECT_TRUE(model_index.AddString("state", in.state_));
+      if (!in.reason_.empty()) {
+        EXPECT_TRUE(model_index.AddString("reason", in.reason_));
+      }
+    }
+    EXPECT_TRUE(index_json.Append(std::move(model_index)));
+  }
+  return WriteDocument(index_json);
+}
+
+TEST(JsonWriterTest, StatisticsMatchDocument)
+{
+  const std::vector<DurationStat> durations{
+      {"success", 3, 300}, {"fail", 0, 0}, {"queue", 3, 120}};
+  for (const auto& name : kStrings) {
+    ModelStatistics stats{
+        name,
+        7,
+        std::numeric_limits<uint64_t>::max(),
+        durations,
+        {{1, {{"compute_infer", 2, 20}}}, {8, {{"compute_infer", 1, 40}}}},
+        {{"CPU", 0}, {name, std::numeric_limits<int64_t>::min()}}};
+    EXPECT_EQ(StatisticsWithWriter(stats), StatisticsWithDocument(stats));
+  }
+
+  // Empty objects and arrays
+  ModelStatistics empty{"empty", 1, 0, {}, {}, {}};
+  EXPECT_EQ(StatisticsWithWriter(empty), StatisticsWithDocument(empty));
+}
+
+TEST(JsonWriterTest, IndexMatchesDocument)
+{
+  std::vector<IndexEntry> index;
+  EXPECT_EQ(IndexWithWriter(index), IndexWithDocument(index));
+
+  for (const auto& name : kStrings) {
+    index.push_back({name, true, 1, "READY", ""});
+    index.push_back({name, false, 1, "READY", ""});
+    index.push_back({name, false, -1, "UNAVAILABLE", name});
+  }
+  EXPECT_EQ(IndexWithWriter(index), IndexWithDocument(index));
+}
+
+TEST(JsonWriterTest, AppendsToBuffer)
+{
+  std::string json("prefix");
+  tc::JsonWriter writer(&json);
+  writer.BeginArray();
+  writer.Raw("{\"a\":1}");
+  writer.Bool(true);
+  writer.EndArray();
+  EXPECT_EQ(json, "prefix[{\"a\":1},true]");
+}
+
+}  // namespace
+
+int
+main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
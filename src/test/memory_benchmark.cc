@@ -0,0 +1,343 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Microbenchmarks of the memory subsystem: the pinned and CUDA memory
+// managers and CopyBuffer across memory types. Besides the throughput,
+// each allocator benchmark reports the p99 latency of a single
+// operation, averaged over the threads.
+
+#include <cuda_runtime_api.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "benchmark/benchmark.h"
+#include "benchmark_util.h"
+#include "cuda_memory_manager.h"
+#include "cuda_utils.h"
+#include "pinned_memory_manager.h"
+
+namespace tc = triton::core;
+
+namespace {
+
+using tc::test::LatencySamples;
+using tc::test::NowNs;
+
+constexpr uint64_t kPinnedPoolByteSize = 256 << 20;
+constexpr uint64_t kCudaPoolByteSize = 256 << 20;
+
+// Wrappers to expose Reset() for releasing the pools before exit
+class BenchmarkPinnedMemoryManager : public tc::PinnedMemoryManager {
+ public:
+  static void Reset() { PinnedMemoryManager::Reset(); }
+};
+
+class BenchmarkCudaMemoryManager : public tc::CudaMemoryManager {
+ public:
+  static void Reset() { CudaMemoryManager::Reset(); }
+};
+
+// Allocation sizes log-uniformly distributed over [1 KB, 4 MB], most
+// buffers of inference requests are small but a few are large.
+class SizeDistribution {
+ public:
+  explicit SizeDistribution(const int seed) : rng_(seed), log_size_(10, 22) {}
+  uint64_t Next() { return uint64_t(1) << log_size_(rng_); }
+
+ private:
+  std::mt19937 rng_;
+  std::uniform_int_distribution<int> log_size_;
+};
+
+//
+// PinnedMemoryManager
+//
+void
+BM_PinnedAllocFree(benchmark::State& state)
+{
+  const uint64_t byte_size = state.range(0);
+  LatencySamples latencies;
+  for (auto _ : state) {
+    void* ptr = nullptr;
+    TRITONSERVER_MemoryType allocated_type;
+    const uint64_t start_ns = NowNs();
+    auto status = tc::PinnedMemoryManager::Alloc(
+        &ptr, byte_size, &allocated_type, true /* allow_nonpinned_fallback */);
+    if (status.IsOk()) {
+      status = tc::PinnedMemoryManager::Free(ptr);
+    }
+    latencies.Add(NowNs() - start_ns);
+    if (!status.IsOk()) {
+      state.SkipWithError(status.AsString().c_str());
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  latencies.Report(state);
+}
+BENCHMARK(BM_PinnedAllocFree)
+    ->RangeMultiplier(8)
+    ->Range(1 << 10, 64 << 20)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+
+// Keep a window of live allocations of mixed sizes, freeing a random
+// one for each new allocation.
+void
+BM_PinnedMixed(benchmark::State& state)
+{
+  SizeDistribution sizes(state.thread_index());
+  std::mt19937 rng(state.thread_index());
+  std::vector<void*> live(state.range(0), nullptr);
+  LatencySamples latencies;
+  for (auto _ : state) {
+    void*& ptr = live[rng() % live.size()];
+    TRITONSERVER_MemoryType allocated_type;
+    const uint64_t start_ns = NowNs();
+    auto status = tc::Status::Success;
+    if (ptr != nullptr) {
+      status = tc::PinnedMemoryManager::Free(ptr);
+      ptr = nullptr;
+    }
+    if (status.IsOk()) {
+      status = tc::PinnedMemoryManager::Alloc(
+          &ptr, sizes.Next(), &allocated_type,
+          true /* allow_nonpinned_fallback */);
+    }
+    latencies.Add(NowNs() - start_ns);
+    if (!status.IsOk()) {
+      state.SkipWithError(status.AsString().c_str());
+      break;
+    }
+  }
+  for (void* ptr : live) {
+    if (ptr != nullptr) {
+      tc::PinnedMemoryManager::Free(ptr);
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  latencies.Report(state);
+}
+BENCHMARK(BM_PinnedMixed)->Arg(16)->ThreadRange(1, 16)->UseRealTime();
+
+//
+// CudaMemoryManager
+//
+void
+BM_CudaAllocFree(benchmark::State& state)
+{
+  const uint64_t byte_size = state.range(0);
+  LatencySamples latencies;
+  for (auto _ : state) {
+    void* ptr = nullptr;
+    const uint64_t start_ns = NowNs();
+    auto status = tc::CudaMemoryManager::Alloc(&ptr, byte_size, 0);
+    if (status.IsOk()) {
+      status = tc::CudaMemoryManager::Free(ptr, 0);
+    }
+    latencies.Add(NowNs() - start_ns);
+    if (!status.IsOk()) {
+      state.SkipWithError(status.AsString().c_str());
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  latencies.Report(state);
+}
+BENCHMARK(BM_CudaAllocFree)
+    ->RangeMultiplier(8)
+    ->Range(1 << 10, 64 << 20)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+
+void
+BM_CudaMixed(benchmark::State& state)
+{
+  SizeDistribution sizes(state.thread_index());
+  std::mt19937 rng(state.thread_index());
+  std::vector<void*> live(state.range(0), nullptr);
+  LatencySamples latencies;
+  for (auto _ : state) {
+    void*& ptr = live[rng() % live.size()];
+    const uint64_t start_ns = NowNs();
+    auto status = tc::Status::Success;
+    if (ptr != nullptr) {
+      status = tc::CudaMemoryManager::Free(ptr, 0);
+      ptr = nullptr;
+    }
+    if (status.IsOk()) {
+      status = tc::CudaMemoryManager::Alloc(&ptr, sizes.Next(), 0);
+    }
+    latencies.Add(NowNs() - start_ns);
+    if (!status.IsOk()) {
+      state.SkipWithError(status.AsString().c_str());
+      break;
+    }
+  }
+  for (void* ptr : live) {
+    if (ptr != nullptr) {
+      tc::CudaMemoryManager::Free(ptr, 0);
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  latencies.Report(state);
+}
+BENCHMARK(BM_CudaMixed)->Arg(16)->ThreadRange(1, 16)->UseRealTime();
+
+//
+// CopyBuffer
+//
+void*
+AllocBuffer(TRITONSERVER_MemoryType memory_type, size_t byte_size)
+{
+  void* ptr = nullptr;
+  switch (memory_type) {
+    case TRITONSERVER_MEMORY_CPU:
+      ptr = std::malloc(byte_size);
+      break;
+    case TRITONSERVER_MEMORY_CPU_PINNED:
+      if (cudaHostAlloc(&ptr, byte_size, cudaHostAllocPortable) !=
+          cudaSuccess) {
+        ptr = nullptr;
+      }
+      break;
+    case TRITONSERVER_MEMORY_GPU:
+      if (cudaMalloc(&ptr, byte_size) != cudaSuccess) {
+        ptr = nullptr;
+      }
+      break;
+  }
+  return ptr;
+}
+
+void
+FreeBuffer(TRITONSERVER_MemoryType memory_type, void* ptr)
+{
+  switch (memory_type) {
+    case TRITONSERVER_MEMORY_CPU:
+      std::free(ptr);
+      break;
+    case TRITONSERVER_MEMORY_CPU_PINNED:
+      cudaFreeHost(ptr);
+      break;
+    case TRITONSERVER_MEMORY_GPU:
+      cudaFree(ptr);
+      break;
+  }
+}
+
+// Arguments are the source and destination memory types and the byte
+// size. The copies that use CUDA are waited for in each iteration.
+void
+BM_CopyBuffer(benchmark::State& state)
+{
+  const auto src_type = TRITONSERVER_MemoryType(state.range(0));
+  const auto dst_type = TRITONSERVER_MemoryType(state.range(1));
+  const size_t byte_size = state.range(2);
+  state.SetLabel(
+      std::string(TRITONSERVER_MemoryTypeString(src_type)) + "->" +
+      TRITONSERVER_MemoryTypeString(dst_type));
+
+  cudaStream_t stream = nullptr;
+  void* src = AllocBuffer(src_type, byte_size);
+  void* dst = AllocBuffer(dst_type, byte_size);
+  if ((src == nullptr) || (dst == nullptr) ||
+      (cudaStreamCreate(&stream) != cudaSuccess)) {
+    state.SkipWithError("failed to allocate the buffers");
+  }
+
+  for (auto _ : state) {
+    bool cuda_used = false;
+    auto status = tc::CopyBuffer(
+        "benchmark", src_type, 0, dst_type, 0, byte_size, src, dst, stream,
+        &cuda_used);
+    if (status.IsOk() && cuda_used &&
+        (cudaStreamSynchronize(stream) != cudaSuccess)) {
+      status = tc::Status(tc::Status::Code::INTERNAL, "failed to sync");
+    }
+    if (!status.IsOk()) {
+      state.SkipWithError(status.AsString().c_str());
+      break;
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * byte_size);
+
+  if (stream != nullptr) {
+    cudaStreamDestroy(stream);
+  }
+  if (src != nullptr) {
+    FreeBuffer(src_type, src);
+  }
+  if (dst != nullptr) {
+    FreeBuffer(dst_type, dst);
+  }
+}
+
+void
+CopyBufferArgs(benchmark::internal::Benchmark* b)
+{
+  const std::vector<TRITONSERVER_MemoryType> types{
+      TRITONSERVER_MEMORY_CPU, TRITONSERVER_MEMORY_CPU_PINNED,
+      TRITONSERVER_MEMORY_GPU};
+  for (const auto src_type : types) {
+    for (const auto dst_type : types) {
+      for (int64_t byte_size = 4 << 10; byte_size <= (64 << 20);
+           byte_size *= 16) {
+        b->Args({src_type, dst_type, byte_size});
+      }
+    }
+  }
+}
+BENCHMARK(BM_CopyBuffer)->Apply(CopyBufferArgs)->UseRealTime();
+
+}  // namespace
+
+int
+main(int argc, char** argv)
+{
+  benchmark::Initialize(&argc, argv);
+
+  auto status = tc::PinnedMemoryManager::Create(
+      tc::PinnedMemoryManager::Options(kPinnedPoolByteSize));
+  if (status.IsOk()) {
+    status = tc::CudaMemoryManager::Create(tc::CudaMemoryManager::Options(
+        6.0 /* min_supported_compute_capability */,
+        {{0, kCudaPoolByteSize}}));
+  }
+  if (!status.IsOk()) {
+    std::cerr << "error: failed to create the memory managers: "
+              << status.AsString() << std::endl;
+    return 1;
+  }
+
+  benchmark::RunSpecifiedBenchmarks();
+
+  BenchmarkCudaMemoryManager::Reset();
+  BenchmarkPinnedMemoryManager::Reset();
+  return 0;
+}
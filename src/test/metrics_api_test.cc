@@ -26,11 +26,15 @@
 
 #ifdef TRITON_ENABLE_METRICS
 
+#include <chrono>
 #include <iostream>
+#include <mutex>
 #include <thread>
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "instrumented_mutex.h"
 #include "metric_family.h"
+#include "metrics.h"
 #include "triton/common/logging.h"
 #include "triton/core/tritonserver.h"
 
@@ -662,6 +666,40 @@ TEST_F(MetricsApiTest, TestChildMetricTracking)
   FAIL_TEST_IF_ERR(TRITONSERVER_MetricFamilyDelete(family), "delete family");
 }
 
+TEST_F(MetricsApiTest, TestLockContentionMetrics)
+{
+  tc::Metrics::EnableLockMetrics();
+  tc::InstrumentedMutex mu("MetricsApiTest::mu_");
+  const tc::LockStats* stats = tc::LockStatsFor("MetricsApiTest::mu_");
+
+  // The second locker has to wait for the first one to unlock
+  std::thread waiter;
+  {
+    std::lock_guard<tc::InstrumentedMutex> lock(mu);
+    waiter = std::thread([&mu]() {
+      std::lock_guard<tc::InstrumentedMutex> lock(mu);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  waiter.join();
+  {
+    std::unique_lock<tc::InstrumentedMutex> lock(mu, std::try_to_lock);
+    ASSERT_TRUE(lock.owns_lock());
+  }
+
+  EXPECT_EQ(stats->acquisition_count_.load(), 3u);
+  EXPECT_EQ(stats->contention_count_.load(), 1u);
+  EXPECT_GT(stats->wait_ns_.load(), 0u);
+
+  std::string metrics_str;
+  GetMetrics(server_, &metrics_str);
+  const std::string labels = "{lock=\"MetricsApiTest::mu_\"}";
+  EXPECT_THAT(
+      metrics_str, HasSubstr("nv_lock_acquisition_count" + labels + " 3"));
+  EXPECT_THAT(
+      metrics_str, HasSubstr("nv_lock_contention_count" + labels + " 1"));
+}
+
 }  // namespace
 
 int
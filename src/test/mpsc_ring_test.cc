@@ -0,0 +1,132 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "mpsc_ring.h"
+
+namespace tc = triton::core;
+
+namespace {
+
+TEST(MPSCRingTest, CapacityRoundedUp)
+{
+  tc::MPSCRing<int> ring(5);
+  EXPECT_EQ(ring.Capacity(), 8u);
+  EXPECT_TRUE(ring.Empty());
+}
+
+TEST(MPSCRingTest, PushPopInOrder)
+{
+  tc::MPSCRing<int> ring(4);
+  for (int i = 0; i < 4; ++i) {
+    int value = i;
+    ASSERT_TRUE(ring.TryPush(value));
+  }
+  EXPECT_EQ(ring.Size(), 4u);
+
+  int extra = 4;
+  EXPECT_FALSE(ring.TryPush(extra)) << "Expect push to fail on full ring";
+
+  for (int i = 0; i < 4; ++i) {
+    int value = -1;
+    ASSERT_TRUE(ring.TryPop(&value));
+    EXPECT_EQ(value, i);
+  }
+  int value = -1;
+  EXPECT_FALSE(ring.TryPop(&value)) << "Expect pop to fail on empty ring";
+  EXPECT_TRUE(ring.Empty());
+}
+
+TEST(MPSCRingTest, MoveOnlyItem)
+{
+  tc::MPSCRing<std::unique_ptr<int>> ring(2);
+  std::unique_ptr<int> item(new int(7));
+  ASSERT_TRUE(ring.TryPush(item));
+  EXPECT_EQ(item, nullptr) << "Expect item to be moved on successful push";
+
+  std::unique_ptr<int> other(new int(8));
+  ASSERT_TRUE(ring.TryPush(other));
+  std::unique_ptr<int> rejected(new int(9));
+  ASSERT_FALSE(ring.TryPush(rejected));
+  ASSERT_NE(rejected, nullptr) << "Expect item to be kept on failed push";
+
+  std::unique_ptr<int> popped;
+  ASSERT_TRUE(ring.TryPop(&popped));
+  EXPECT_EQ(*popped, 7);
+}
+
+TEST(MPSCRingTest, MultipleProducers)
+{
+  const size_t producer_count = 4;
+  const size_t items_per_producer = 10000;
+  tc::MPSCRing<size_t> ring(64);
+
+  std::vector<std::thread> producers;
+  for (size_t p = 0; p < producer_count; ++p) {
+    producers.emplace_back([&ring, p, items_per_producer]() {
+      for (size_t i = 0; i < items_per_producer; ++i) {
+        size_t value = p * items_per_producer + i;
+        while (!ring.TryPush(value)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  // Items from the same producer must be observed in push order.
+  std::vector<size_t> next(producer_count, 0);
+  size_t consumed = 0;
+  while (consumed < producer_count * items_per_producer) {
+    size_t value;
+    if (ring.TryPop(&value)) {
+      const size_t p = value / items_per_producer;
+      ASSERT_LT(p, producer_count);
+      EXPECT_EQ(value % items_per_producer, next[p]);
+      next[p]++;
+      consumed++;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  EXPECT_TRUE(ring.Empty());
+}
+
+}  // namespace
+
+int
+main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,277 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// A backend that does no work, used to measure the overhead of the
+// core. Each requested output is returned with the shape, datatype and
+// contents of the first input. The contents are zero-filled if the
+// input is not in CPU memory.
+//
+// The "execute_delay_us" model config parameter makes each execution
+// sleep for that many microseconds before responding, to stand in for
+// the compute time of a real model.
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include "triton/core/tritonbackend.h"
+
+#define TRITONJSON_STATUSTYPE TRITONSERVER_Error*
+#define TRITONJSON_STATUSRETURN(M) \
+  return TRITONSERVER_ErrorNew(TRITONSERVER_ERROR_INTERNAL, (M).c_str())
+#define TRITONJSON_STATUSSUCCESS nullptr
+#include "triton/common/triton_json.h"
+
+namespace {
+
+struct ModelState {
+  uint64_t execute_delay_us_ = 0;
+};
+
+// Read the parameters of 'model' into 'state'
+TRITONSERVER_Error*
+ParseModelConfig(TRITONBACKEND_Model* model, ModelState* state)
+{
+  TRITONSERVER_Message* message = nullptr;
+  TRITONSERVER_Error* err =
+      TRITONBACKEND_ModelConfig(model, 1 /* config_version */, &message);
+  if (err != nullptr) {
+    return err;
+  }
+  const char* buffer = nullptr;
+  size_t byte_size = 0;
+  triton::common::TritonJson::Value config;
+  err = TRITONSERVER_MessageSerializeToJson(message, &buffer, &byte_size);
+  if (err == nullptr) {
+    err = config.Parse(buffer, byte_size);
+  }
+  TRITONSERVER_MessageDelete(message);
+  if (err != nullptr) {
+    return err;
+  }
+
+  triton::common::TritonJson::Value parameters;
+  triton::common::TritonJson::Value delay;
+  std::string delay_us;
+  if (config.Find("parameters", &parameters) &&
+      parameters.Find("execute_delay_us", &delay)) {
+    err = delay.MemberAsString("string_value", &delay_us);
+    if (err != nullptr) {
+      return err;
+    }
+    try {
+      state->execute_delay_us_ = std::stoull(delay_us);
+    }
+    catch (const std::exception& ex) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          ("invalid execute_delay_us '" + delay_us + "'").c_str());
+    }
+  }
+  return nullptr;  // success
+}
+
+// Copy the contents of 'input' into 'buffer' of 'byte_size' bytes, or
+// zero-fill it if the contents are not all in CPU memory.
+TRITONSERVER_Error*
+CopyInput(
+    TRITONBACKEND_Input* input, const uint32_t buffer_count, void* buffer,
+    const uint64_t byte_size)
+{
+  char* dst = reinterpret_cast<char*>(buffer);
+  uint64_t offset = 0;
+  for (uint32_t idx = 0; idx < buffer_count; ++idx) {
+    const void* src = nullptr;
+    uint64_t src_byte_size = 0;
+    TRITONSERVER_MemoryType memory_type = TRITONSERVER_MEMORY_CPU;
+    int64_t memory_type_id = 0;
+    TRITONSERVER_Error* err = TRITONBACKEND_InputBuffer(
+        input, idx, &src, &src_byte_size, &memory_type, &memory_type_id);
+    if (err != nullptr) {
+      return err;
+    }
+    if ((memory_type == TRITONSERVER_MEMORY_GPU) ||
+        ((offset + src_byte_size) > byte_size)) {
+      std::memset(dst, 0, byte_size);
+      return nullptr;  // success
+    }
+    std::memcpy(dst + offset, src, src_byte_size);
+    offset += src_byte_size;
+  }
+  std::memset(dst + offset, 0, byte_size - offset);
+  return nullptr;  // success
+}
+
+uint64_t
+NowNs()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+TRITONSERVER_Error*
+RespondToRequest(TRITONBACKEND_Request* request)
+{
+  TRITONBACKEND_Response* response = nullptr;
+  TRITONSERVER_Error* err = TRITONBACKEND_ResponseNew(&response, request);
+  if (err != nullptr) {
+    return err;
+  }
+
+  TRITONBACKEND_Input* input = nullptr;
+  TRITONSERVER_DataType datatype = TRITONSERVER_TYPE_INVALID;
+  const int64_t* shape = nullptr;
+  uint32_t dims_count = 0;
+  uint64_t byte_size = 0;
+  uint32_t buffer_count = 0;
+  uint32_t output_count = 0;
+  err = TRITONBACKEND_RequestInputByIndex(request, 0 /* index */, &input);
+  if (err == nullptr) {
+    err = TRITONBACKEND_InputProperties(
+        input, nullptr /* name */, &datatype, &shape, &dims_count, &byte_size,
+        &buffer_count);
+  }
+  if (err == nullptr) {
+    err = TRITONBACKEND_RequestOutputCount(request, &output_count);
+  }
+  for (uint32_t idx = 0; (err == nullptr) && (idx < output_count); ++idx) {
+    const char* name = nullptr;
+    TRITONBACKEND_Output* output = nullptr;
+    void* buffer = nullptr;
+    TRITONSERVER_MemoryType memory_type = TRITONSERVER_MEMORY_CPU;
+    int64_t memory_type_id = 0;
+    err = TRITONBACKEND_RequestOutputName(request, idx, &name);
+    if (err == nullptr) {
+      err = TRITONBACKEND_ResponseOutput(
+          response, &output, name, datatype, shape, dims_count);
+    }
+    if (err == nullptr) {
+      err = TRITONBACKEND_OutputBuffer(
+          output, &buffer, byte_size, &memory_type, &memory_type_id);
+    }
+    if ((err == nullptr) && (memory_type != TRITONSERVER_MEMORY_GPU)) {
+      err = CopyInput(input, buffer_count, buffer, byte_size);
+    }
+  }
+
+  // The response is sent even on error so that the client is not left
+  // waiting, the error is reported in the response.
+  TRITONSERVER_Error* send_err = TRITONBACKEND_ResponseSend(
+      response, TRITONSERVER_RESPONSE_COMPLETE_FINAL, err);
+  if (err != nullptr) {
+    TRITONSERVER_ErrorDelete(err);
+    err = TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INTERNAL, "failed to produce the outputs");
+  }
+  if (send_err != nullptr) {
+    TRITONSERVER_ErrorDelete(send_err);
+  }
+  return err;
+}
+
+}  // namespace
+
+extern "C" {
+
+TRITONBACKEND_ISPEC TRITONSERVER_Error*
+TRITONBACKEND_ModelInitialize(TRITONBACKEND_Model* model)
+{
+  ModelState* state = new ModelState();
+  TRITONSERVER_Error* err = ParseModelConfig(model, state);
+  if (err == nullptr) {
+    err = TRITONBACKEND_ModelSetState(model, state);
+  }
+  if (err != nullptr) {
+    delete state;
+  }
+  return err;
+}
+
+TRITONBACKEND_ISPEC TRITONSERVER_Error*
+TRITONBACKEND_ModelFinalize(TRITONBACKEND_Model* model)
+{
+  void* state = nullptr;
+  TRITONSERVER_Error* err = TRITONBACKEND_ModelState(model, &state);
+  if (err == nullptr) {
+    delete reinterpret_cast<ModelState*>(state);
+  }
+  return err;
+}
+
+TRITONBACKEND_ISPEC TRITONSERVER_Error*
+TRITONBACKEND_ModelInstanceExecute(
+    TRITONBACKEND_ModelInstance* instance, TRITONBACKEND_Request** requests,
+    const uint32_t request_count)
+{
+  // The backend owns the requests from here on, so failures are only
+  // reported in the responses and statistics.
+  const uint64_t exec_start_ns = NowNs();
+  TRITONBACKEND_Model* model = nullptr;
+  void* state = nullptr;
+  TRITONSERVER_Error* state_err =
+      TRITONBACKEND_ModelInstanceModel(instance, &model);
+  if (state_err == nullptr) {
+    state_err = TRITONBACKEND_ModelState(model, &state);
+  }
+  if (state_err != nullptr) {
+    TRITONSERVER_ErrorDelete(state_err);
+  } else if (reinterpret_cast<ModelState*>(state)->execute_delay_us_ != 0) {
+    std::this_thread::sleep_for(std::chrono::microseconds(
+        reinterpret_cast<ModelState*>(state)->execute_delay_us_));
+  }
+
+  for (uint32_t r = 0; r < request_count; ++r) {
+    TRITONSERVER_Error* err = RespondToRequest(requests[r]);
+    const uint64_t exec_end_ns = NowNs();
+    TRITONSERVER_Error* stats_err = TRITONBACKEND_ModelInstanceReportStatistics(
+        instance, requests[r], (err == nullptr), exec_start_ns, exec_start_ns,
+        exec_end_ns, exec_end_ns);
+    if (err != nullptr) {
+      TRITONSERVER_ErrorDelete(err);
+    }
+    if (stats_err != nullptr) {
+      TRITONSERVER_ErrorDelete(stats_err);
+    }
+    TRITONSERVER_Error* release_err = TRITONBACKEND_RequestRelease(
+        requests[r], TRITONSERVER_REQUEST_RELEASE_ALL);
+    if (release_err != nullptr) {
+      TRITONSERVER_ErrorDelete(release_err);
+    }
+  }
+
+  const uint64_t exec_end_ns = NowNs();
+  TRITONSERVER_Error* stats_err =
+      TRITONBACKEND_ModelInstanceReportBatchStatistics(
+          instance, request_count, exec_start_ns, exec_start_ns, exec_end_ns,
+          exec_end_ns);
+  if (stats_err != nullptr) {
+    TRITONSERVER_ErrorDelete(stats_err);
+  }
+  return nullptr;  // success
+}
+
+}  // extern "C"
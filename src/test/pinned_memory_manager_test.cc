@@ -26,11 +26,15 @@
 #include "gtest/gtest.h"
 
 #include <cuda_runtime_api.h>
+#include <algorithm>
 #include <condition_variable>
+#include <cstring>
 #include <mutex>
 #include <thread>
 #include <vector>
+#include "numa_utils.h"
 #include "pinned_memory_manager.h"
+#include "slab_allocator.h"
 #include "tritonserver_apis.h"
 
 namespace tc = triton::core;
@@ -310,6 +314,353 @@ TEST_F(PinnedMemoryManagerTest, ParallelAllocFallback)
   }
 }
 
+TEST_F(PinnedMemoryManagerTest, SlabAllocFree)
+{
+  // A quarter of the pool, 4 slabs, is served by the slab allocator
+  options_.pinned_memory_pool_byte_size_ = uint64_t(1) << 26 /* 64 MB */;
+  auto status = tc::PinnedMemoryManager::Create(options_);
+  ASSERT_TRUE(status.IsOk()) << status.Message();
+
+  // 1000 and 1500 bytes are rounded up to the 1 KB and 2 KB classes
+  void* small_ptr = nullptr;
+  void* large_ptr = nullptr;
+  TRITONSERVER_MemoryType allocated_type = TRITONSERVER_MEMORY_GPU;
+  status = tc::PinnedMemoryManager::Alloc(
+      &small_ptr, 1000, &allocated_type, false /* allow_nonpinned_fallback */);
+  ASSERT_TRUE(status.IsOk()) << status.Message();
+  ASSERT_TRUE(allocated_type == TRITONSERVER_MEMORY_CPU_PINNED)
+      << "Expect pointer to pinned memory";
+  CHECK_POINTER_ATTRIBUTES(small_ptr, cudaMemoryTypeHost, 0);
+  status = tc::PinnedMemoryManager::Alloc(
+      &large_ptr, 1500, &allocated_type, false /* allow_nonpinned_fallback */);
+  ASSERT_TRUE(status.IsOk()) << status.Message();
+  ASSERT_TRUE(allocated_type == TRITONSERVER_MEMORY_CPU_PINNED)
+      << "Expect pointer to pinned memory";
+  CHECK_POINTER_ATTRIBUTES(large_ptr, cudaMemoryTypeHost, 0);
+
+  EXPECT_NE(small_ptr, large_ptr) << "Expect distinct blocks";
+  memset(small_ptr, 1, 1000);
+  memset(large_ptr, 2, 1500);
+
+  // A freed block is handed out again for a size of the same class
+  status = tc::PinnedMemoryManager::Free(small_ptr);
+  EXPECT_TRUE(status.IsOk()) << status.Message();
+  void* reused_ptr = nullptr;
+  status = tc::PinnedMemoryManager::Alloc(
+      &reused_ptr, 1024, &allocated_type, false /* allow_nonpinned_fallback */);
+  ASSERT_TRUE(status.IsOk()) << status.Message();
+  EXPECT_EQ(reused_ptr, small_ptr) << "Expect the freed block to be reused";
+
+  status = tc::PinnedMemoryManager::Free(reused_ptr);
+  EXPECT_TRUE(status.IsOk()) << status.Message();
+  status = tc::PinnedMemoryManager::Free(large_ptr);
+  EXPECT_TRUE(status.IsOk()) << status.Message();
+}
+
+TEST_F(PinnedMemoryManagerTest, SlabExhaustedFallsBackToPool)
+{
+  options_.pinned_memory_pool_byte_size_ = uint64_t(1) << 26 /* 64 MB */;
+  auto status = tc::PinnedMemoryManager::Create(options_);
+  ASSERT_TRUE(status.IsOk()) << status.Message();
+
+  // The 16 MB slab region holds 16 blocks of the largest class
+  const size_t block_byte_size = tc::SlabAllocator::kMaxBlockByteSize;
+  const size_t slab_block_count = 16;
+  std::vector<void*> slab_ptrs;
+  TRITONSERVER_MemoryType allocated_type = TRITONSERVER_MEMORY_GPU;
+  for (size_t idx = 0; idx < slab_block_count; idx++) {
+    void* ptr = nullptr;
+    status = tc::PinnedMemoryManager::Alloc(
+        &ptr, block_byte_size, &allocated_type,
+        false /* allow_nonpinned_fallback */);
+    ASSERT_TRUE(status.IsOk()) << status.Message();
+    ASSERT_TRUE(allocated_type == TRITONSERVER_MEMORY_CPU_PINNED)
+        << "Expect pointer to pinned memory";
+    slab_ptrs.push_back(ptr);
+  }
+  char* region_begin = static_cast<char*>(
+      *std::min_element(slab_ptrs.begin(), slab_ptrs.end()));
+  char* region_end = static_cast<char*>(*std::max_element(
+                          slab_ptrs.begin(), slab_ptrs.end())) +
+                      block_byte_size;
+  ASSERT_EQ(
+      size_t(region_end - region_begin), slab_block_count * block_byte_size)
+      << "Expect the blocks to fill the slab region";
+
+  // Once the slabs are used up, allocations of any class are served by
+  // the rest of the pool, which follows the slab region
+  std::vector<void*> pool_ptrs;
+  for (const size_t byte_size : {block_byte_size, size_t(1024)}) {
+    void* ptr = nullptr;
+    status = tc::PinnedMemoryManager::Alloc(
+        &ptr, byte_size, &allocated_type,
+        false /* allow_nonpinned_fallback */);
+    ASSERT_TRUE(status.IsOk()) << status.Message();
+    ASSERT_TRUE(allocated_type == TRITONSERVER_MEMORY_CPU_PINNED)
+        << "Expect pointer to pinned memory";
+    CHECK_POINTER_ATTRIBUTES(ptr, cudaMemoryTypeHost, 0);
+    EXPECT_GE(static_cast<char*>(ptr), region_end)
+        << "Expect allocation of " << byte_size << " bytes outside of the "
+        << "slab region";
+    pool_ptrs.push_back(ptr);
+  }
+
+  // Both kinds of allocations are returned to where they came from
+  for (void* ptr : pool_ptrs) {
+    status = tc::PinnedMemoryManager::Free(ptr);
+    EXPECT_TRUE(status.IsOk()) << status.Message();
+  }
+  status = tc::PinnedMemoryManager::Free(slab_ptrs.back());
+  EXPECT_TRUE(status.IsOk()) << status.Message();
+  void* ptr = nullptr;
+  status = tc::PinnedMemoryManager::Alloc(
+      &ptr, block_byte_size, &allocated_type,
+      false /* allow_nonpinned_fallback */);
+  ASSERT_TRUE(status.IsOk()) << status.Message();
+  EXPECT_EQ(ptr, slab_ptrs.back()) << "Expect the freed slab block reused";
+  slab_ptrs.back() = ptr;
+  for (void* slab_ptr : slab_ptrs) {
+    status = tc::PinnedMemoryManager::Free(slab_ptr);
+    EXPECT_TRUE(status.IsOk()) << status.Message();
+  }
+}
+
+TEST_F(PinnedMemoryManagerTest, QuarterPoolReservedForSlabs)
+{
+  options_.pinned_memory_pool_byte_size_ = uint64_t(1) << 26 /* 64 MB */;
+  auto status = tc::PinnedMemoryManager::Create(options_);
+  ASSERT_TRUE(status.IsOk()) << status.Message();
+
+  // Allocations above the largest class are served by the 48 MB that
+  // aren't reserved for the slab allocator
+  void* ptr = nullptr;
+  TRITONSERVER_MemoryType allocated_type = TRITONSERVER_MEMORY_GPU;
+  status = tc::PinnedMemoryManager::Alloc(
+      &ptr, 40 << 20, &allocated_type, false /* allow_nonpinned_fallback */);
+  ASSERT_TRUE(status.IsOk()) << status.Message();
+  ASSERT_TRUE(allocated_type == TRITONSERVER_MEMORY_CPU_PINNED)
+      << "Expect pointer to pinned memory";
+  CHECK_POINTER_ATTRIBUTES(ptr, cudaMemoryTypeHost, 0);
+  status = tc::PinnedMemoryManager::Free(ptr);
+  EXPECT_TRUE(status.IsOk()) << status.Message();
+
+  // 56 MB would fit the pool but not the part outside of the slab region
+  status = tc::PinnedMemoryManager::Alloc(
+      &ptr, 56 << 20, &allocated_type, false /* allow_nonpinned_fallback */);
+  ASSERT_FALSE(status.IsOk()) << "Unexpected successful allocation";
+  status = tc::PinnedMemoryManager::Alloc(
+      &ptr, 56 << 20, &allocated_type, true /* allow_nonpinned_fallback */);
+  ASSERT_TRUE(status.IsOk()) << status.Message();
+  ASSERT_TRUE(allocated_type == TRITONSERVER_MEMORY_CPU)
+      << "Expect pointer to non-pinned memory";
+  status = tc::PinnedMemoryManager::Free(ptr);
+  EXPECT_TRUE(status.IsOk()) << status.Message();
+}
+
+TEST_F(PinnedMemoryManagerTest, SmallPoolHasNoSlabs)
+{
+  // A quarter of 8 MB is less than a slab, so nothing is reserved
+  options_.pinned_memory_pool_byte_size_ = uint64_t(1) << 23 /* 8 MB */;
+  auto status = tc::PinnedMemoryManager::Create(options_);
+  ASSERT_TRUE(status.IsOk()) << status.Message();
+
+  void* ptr = nullptr;
+  TRITONSERVER_MemoryType allocated_type = TRITONSERVER_MEMORY_GPU;
+  status = tc::PinnedMemoryManager::Alloc(
+      &ptr, 7 << 20, &allocated_type, false /* allow_nonpinned_fallback */);
+  ASSERT_TRUE(status.IsOk()) << status.Message();
+  ASSERT_TRUE(allocated_type == TRITONSERVER_MEMORY_CPU_PINNED)
+      << "Expect pointer to pinned memory";
+  CHECK_POINTER_ATTRIBUTES(ptr, cudaMemoryTypeHost, 0);
+  status = tc::PinnedMemoryManager::Free(ptr);
+  EXPECT_TRUE(status.IsOk()) << status.Message();
+}
+
+// Pool options for the growth tests: a 1 MB pool, too small for slabs,
+// that may grow by segments of at least 1 MB up to 4 MB.
+void
+SetGrowthOptions(tc::PinnedMemoryManager::Options* options)
+{
+  options->pinned_memory_pool_byte_size_ = uint64_t(1) << 20;
+  options->pinned_memory_pool_max_byte_size_ = uint64_t(4) << 20;
+  options->pinned_memory_pool_growth_byte_size_ = uint64_t(1) << 20;
+}
+
+TEST_F(PinnedMemoryManagerTest, GrowBeyondPool)
+{
+  SetGrowthOptions(&options_);
+  auto status = tc::PinnedMemoryManager::Create(options_);
+  ASSERT_TRUE(status.IsOk()) << status.Message();
+
+  // 2 MB doesn't fit the pool and is served by an added segment, while
+  // the pool itself is still used for what fits
+  void* segment_ptr = nullptr;
+  TRITONSERVER_MemoryType allocated_type = TRITONSERVER_MEMORY_GPU;
+  status = tc::PinnedMemoryManager::Alloc(
+      &segment_ptr, 2 << 20, &allocated_type,
+      false /* allow_nonpinned_fallback */);
+  ASSERT_TRUE(status.IsOk()) << status.Message();
+  ASSERT_TRUE(allocated_type == TRITONSERVER_MEMORY_CPU_PINNED)
+      << "Expect pointer to pinned memory";
+  CHECK_POINTER_ATTRIBUTES(segment_ptr, cudaMemoryTypeHost, 0);
+  void* pool_ptr = nullptr;
+  status = tc::PinnedMemoryManager::Alloc(
+      &pool_ptr, 512 << 10, &allocated_type,
+      false /* allow_nonpinned_fallback */);
+  ASSERT_TRUE(status.IsOk()) << status.Message();
+  ASSERT_TRUE(allocated_type == TRITONSERVER_MEMORY_CPU_PINNED)
+      << "Expect pointer to pinned memory";
+  CHECK_POINTER_ATTRIBUTES(pool_ptr, cudaMemoryTypeHost, 0);
+  memset(segment_ptr, 1, 2 << 20);
+  memset(pool_ptr, 2, 512 << 10);
+
+  status = tc::PinnedMemoryManager::Free(segment_ptr);
+  EXPECT_TRUE(status.IsOk()) << status.Message();
+  status = tc::PinnedMemoryManager::Free(pool_ptr);
+  EXPECT_TRUE(status.IsOk()) << status.Message();
+}
+
+TEST_F(PinnedMemoryManagerTest, GrowthCappedAtMax)
+{
+  SetGrowthOptions(&options_);
+  auto status = tc::PinnedMemoryManager::Create(options_);
+  ASSERT_TRUE(status.IsOk()) << status.Message();
+
+  void* first_ptr = nullptr;
+  TRITONSERVER_MemoryType allocated_type = TRITONSERVER_MEMORY_GPU;
+  status = tc::PinnedMemoryManager::Alloc(
+      &first_ptr, 2 << 20, &allocated_type,
+      false /* allow_nonpinned_fallback */);
+  ASSERT_TRUE(status.IsOk()) << status.Message();
+
+  // Another segment would grow the pool beyond 4 MB
+  void* second_ptr = nullptr;
+  status = tc::PinnedMemoryManager::Alloc(
+      &second_ptr, 1 << 20, &allocated_type,
+      false /* allow_nonpinned_fallback */);
+  ASSERT_FALSE(status.IsOk()) << "Unexpected successful allocation";
+  status = tc::PinnedMemoryManager::Alloc(
+      &second_ptr, 1 << 20, &allocated_type,
+      true /* allow_nonpinned_fallback */);
+  ASSERT_TRUE(status.IsOk()) << status.Message();
+  ASSERT_TRUE(allocated_type == TRITONSERVER_MEMORY_CPU)
+      << "Expect pointer to non-pinned memory";
+
+  status = tc::PinnedMemoryManager::Free(second_ptr);
+  EXPECT_TRUE(status.IsOk()) << status.Message();
+  status = tc::PinnedMemoryManager::Free(first_ptr);
+  EXPECT_TRUE(status.IsOk()) << status.Message();
+}
+
+TEST_F(PinnedMemoryManagerTest, FreeReturnsToOwningSegment)
+{
+  SetGrowthOptions(&options_);
+  auto status = tc::PinnedMemoryManager::Create(options_);
+  ASSERT_TRUE(status.IsOk()) << status.Message();
+
+  void* segment_ptr = nullptr;
+  void* pool_ptr = nullptr;
+  TRITONSERVER_MemoryType allocated_type = TRITONSERVER_MEMORY_GPU;
+  status = tc::PinnedMemoryManager::Alloc(
+      &segment_ptr, 2 << 20, &allocated_type,
+      false /* allow_nonpinned_fallback */);
+  ASSERT_TRUE(status.IsOk()) << status.Message();
+  status = tc::PinnedMemoryManager::Alloc(
+      &pool_ptr, 512 << 10, &allocated_type,
+      false /* allow_nonpinned_fallback */);
+  ASSERT_TRUE(status.IsOk()) << status.Message();
+  status = tc::PinnedMemoryManager::Free(segment_ptr);
+  EXPECT_TRUE(status.IsOk()) << status.Message();
+  status = tc::PinnedMemoryManager::Free(pool_ptr);
+  EXPECT_TRUE(status.IsOk()) << status.Message();
+
+  // The freed memory is available again in the segment and the pool, so
+  // the same allocations succeed without growing the pool any further
+  status = tc::PinnedMemoryManager::Alloc(
+      &segment_ptr, 2 << 20, &allocated_type,
+      false /* allow_nonpinned_fallback */);
+  ASSERT_TRUE(status.IsOk()) << status.Message();
+  status = tc::PinnedMemoryManager::Alloc(
+      &pool_ptr, 512 << 10, &allocated_type,
+      false /* allow_nonpinned_fallback */);
+  ASSERT_TRUE(status.IsOk()) << status.Message();
+  void* ptr = nullptr;
+  status = tc::PinnedMemoryManager::Alloc(
+      &ptr, 2 << 20, &allocated_type, false /* allow_nonpinned_fallback */);
+  ASSERT_FALSE(status.IsOk())
+      << "Expect the freed segment to be reused instead of a new one";
+
+  status = tc::PinnedMemoryManager::Free(segment_ptr);
+  EXPECT_TRUE(status.IsOk()) << status.Message();
+  status = tc::PinnedMemoryManager::Free(pool_ptr);
+  EXPECT_TRUE(status.IsOk()) << status.Message();
+}
+
+TEST_F(PinnedMemoryManagerTest, IdleSegmentReleased)
+{
+  SetGrowthOptions(&options_);
+  options_.pinned_memory_pool_idle_timeout_ms_ = 0;
+  auto status = tc::PinnedMemoryManager::Create(options_);
+  ASSERT_TRUE(status.IsOk()) << status.Message();
+
+  void* ptr = nullptr;
+  TRITONSERVER_MemoryType allocated_type = TRITONSERVER_MEMORY_GPU;
+  status = tc::PinnedMemoryManager::Alloc(
+      &ptr, 2 << 20, &allocated_type, false /* allow_nonpinned_fallback */);
+  ASSERT_TRUE(status.IsOk()) << status.Message();
+  status = tc::PinnedMemoryManager::Free(ptr);
+  EXPECT_TRUE(status.IsOk()) << status.Message();
+
+  // 2.5 MB fits neither the released segment nor the room left next to
+  // it, so the pool must have shrunk back
+  status = tc::PinnedMemoryManager::Alloc(
+      &ptr, 5 << 19, &allocated_type, false /* allow_nonpinned_fallback */);
+  ASSERT_TRUE(status.IsOk()) << status.Message();
+  ASSERT_TRUE(allocated_type == TRITONSERVER_MEMORY_CPU_PINNED)
+      << "Expect pointer to pinned memory";
+  CHECK_POINTER_ATTRIBUTES(ptr, cudaMemoryTypeHost, 0);
+  status = tc::PinnedMemoryManager::Free(ptr);
+  EXPECT_TRUE(status.IsOk()) << status.Message();
+}
+
+TEST_F(PinnedMemoryManagerTest, NodePoolGrowsOnItsNode)
+{
+  SetGrowthOptions(&options_);
+  options_.host_policy_map_["numa_0"]["numa-node"] = "0";
+  auto status = tc::PinnedMemoryManager::Create(options_);
+  ASSERT_TRUE(status.IsOk()) << status.Message();
+
+  // The calling thread isn't bound to the node, the segment is still
+  // allocated on the node of the pool
+  void* ptr = nullptr;
+  TRITONSERVER_MemoryType allocated_type = TRITONSERVER_MEMORY_GPU;
+  status = tc::PinnedMemoryManager::Alloc(
+      &ptr, 2 << 20, &allocated_type, false /* allow_nonpinned_fallback */);
+  ASSERT_TRUE(status.IsOk()) << status.Message();
+  ASSERT_TRUE(allocated_type == TRITONSERVER_MEMORY_CPU_PINNED)
+      << "Expect pointer to pinned memory";
+  CHECK_POINTER_ATTRIBUTES(ptr, cudaMemoryTypeHost, 0);
+  memset(ptr, 1, 2 << 20);
+  EXPECT_EQ(tc::NumaNodeOfAddress(ptr), 0)
+      << "Expect the segment on NUMA node 0";
+  status = tc::PinnedMemoryManager::Free(ptr);
+  EXPECT_TRUE(status.IsOk()) << status.Message();
+
+  // A thread bound to the node allocates from the same segment
+  status = tc::SetNumaMemoryPolicy(options_.host_policy_map_["numa_0"]);
+  ASSERT_TRUE(status.IsOk()) << status.Message();
+  void* bound_ptr = nullptr;
+  status = tc::PinnedMemoryManager::Alloc(
+      &bound_ptr, 2 << 20, &allocated_type,
+      false /* allow_nonpinned_fallback */);
+  tc::ResetNumaMemoryPolicy();
+  ASSERT_TRUE(status.IsOk()) << status.Message();
+  EXPECT_EQ(tc::NumaNodeOfAddress(bound_ptr), 0)
+      << "Expect the segment on NUMA node 0";
+  status = tc::PinnedMemoryManager::Free(bound_ptr);
+  EXPECT_TRUE(status.IsOk()) << status.Message();
+}
+
 }  // namespace
 
 int
@@ -0,0 +1,142 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <vector>
+#include "response_batch.h"
+
+namespace tc = triton::core;
+
+namespace {
+
+// The deliveries of a batch. The response pointers are never
+// dereferenced by the batch, so the test uses fake ones.
+struct Deliveries {
+  std::vector<size_t> counts_;
+  std::vector<uint32_t> flags_;
+  // Dropped on the final delivery, like the last response deleted by
+  // the client from the callback
+  std::shared_ptr<tc::ResponseBatch> owner_;
+};
+
+void
+BatchComplete(
+    TRITONSERVER_InferenceResponse** responses, const uint32_t count,
+    const uint32_t flags, void* userp)
+{
+  Deliveries* deliveries = reinterpret_cast<Deliveries*>(userp);
+  deliveries->counts_.push_back(count);
+  deliveries->flags_.push_back(flags);
+  if ((flags & TRITONSERVER_RESPONSE_COMPLETE_FINAL) != 0) {
+    deliveries->owner_.reset();
+  }
+}
+
+TRITONSERVER_InferenceResponse*
+FakeResponse(const uintptr_t id)
+{
+  return reinterpret_cast<TRITONSERVER_InferenceResponse*>(id);
+}
+
+TEST(ResponseBatchTest, ReleasedWithoutResponse)
+{
+  // A request that fails to be enqueued, or is released without a
+  // response, must not keep its batch alive.
+  Deliveries deliveries;
+  std::shared_ptr<tc::ResponseBatch> batch =
+      tc::ResponseBatch::Create(BatchComplete, &deliveries, 0);
+  std::weak_ptr<tc::ResponseBatch> weak = batch;
+  batch.reset();
+
+  EXPECT_TRUE(weak.expired());
+  EXPECT_TRUE(deliveries.counts_.empty());
+}
+
+TEST(ResponseBatchTest, ReleasedAfterFinal)
+{
+  Deliveries deliveries;
+  std::shared_ptr<tc::ResponseBatch> batch =
+      tc::ResponseBatch::Create(BatchComplete, &deliveries, 0);
+  std::weak_ptr<tc::ResponseBatch> weak = batch;
+  tc::ResponseBatch::Complete(FakeResponse(1), 0 /* flags */, batch.get());
+  tc::ResponseBatch::Complete(
+      nullptr, TRITONSERVER_RESPONSE_COMPLETE_FINAL, batch.get());
+  batch.reset();
+
+  EXPECT_TRUE(weak.expired());
+  const std::vector<size_t> expected_counts{1, 0};
+  EXPECT_EQ(deliveries.counts_, expected_counts);
+  const std::vector<uint32_t> expected_flags{
+      0, TRITONSERVER_RESPONSE_COMPLETE_FINAL};
+  EXPECT_EQ(deliveries.flags_, expected_flags);
+}
+
+TEST(ResponseBatchTest, LastReferenceDroppedByCallback)
+{
+  // The batch must outlive the delivery whose callback drops the last
+  // reference to it.
+  Deliveries deliveries;
+  deliveries.owner_ =
+      tc::ResponseBatch::Create(BatchComplete, &deliveries, 0);
+  std::weak_ptr<tc::ResponseBatch> weak = deliveries.owner_;
+  void* userp = deliveries.owner_.get();
+  tc::ResponseBatch::Complete(FakeResponse(1), 0 /* flags */, userp);
+  tc::ResponseBatch::Complete(
+      FakeResponse(2), TRITONSERVER_RESPONSE_COMPLETE_FINAL, userp);
+
+  const std::vector<size_t> expected_counts{1, 1};
+  EXPECT_EQ(deliveries.counts_, expected_counts);
+  EXPECT_TRUE(weak.expired());
+}
+
+TEST(ResponseBatchTest, WaitingResponsesDeliveredWithFinal)
+{
+  Deliveries deliveries;
+  std::shared_ptr<tc::ResponseBatch> batch =
+      tc::ResponseBatch::Create(BatchComplete, &deliveries, 60000000);
+  tc::ResponseBatch::Complete(FakeResponse(1), 0 /* flags */, batch.get());
+  tc::ResponseBatch::Complete(FakeResponse(2), 0 /* flags */, batch.get());
+  tc::ResponseBatch::Complete(
+      FakeResponse(3), TRITONSERVER_RESPONSE_COMPLETE_FINAL, batch.get());
+
+  const std::vector<size_t> expected_counts{3};
+  EXPECT_EQ(deliveries.counts_, expected_counts);
+  const std::vector<uint32_t> expected_flags{
+      TRITONSERVER_RESPONSE_COMPLETE_FINAL};
+  EXPECT_EQ(deliveries.flags_, expected_flags);
+}
+
+}  // namespace
+
+int
+main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -58,7 +58,9 @@ InferenceRequest::InferenceRequest(
     Model* model, const int64_t requested_model_version)
     : needs_normalization_(true), model_raw_(model),
       requested_model_version_(requested_model_version), flags_(0),
-      correlation_id_(0), batch_size_(0), timeout_us_(0), collect_stats_(true)
+      correlation_id_(0), batch_size_(0), timeout_us_(0),
+      arena_(std::make_shared<RequestArena>()),
+      original_inputs_(InputMap::allocator_type(arena_)), collect_stats_(true)
 {
   // Unit test doesn't need actual response factory logic
   // or other priority/request_counting logic, it just needs
@@ -98,6 +100,7 @@ InferenceRequest::PrepareForInference()
   // Remove override inputs as those are added during any previous
   // inference execution.
   inputs_.clear();
+  indexed_inputs_.clear();
   override_inputs_.clear();
 
   // Initially show the actual inputs to be only the original
@@ -105,6 +108,7 @@ InferenceRequest::PrepareForInference()
   // 'inputs_'.
   for (auto& pr : original_inputs_) {
     inputs_.emplace(std::make_pair(pr.first, std::addressof(pr.second)));
+    indexed_inputs_.push_back(std::addressof(pr.second));
   }
 
   // Clear the timestamps
@@ -540,6 +544,98 @@ CreateCacheExpectFail(
   ASSERT_EQ(cache, nullptr);
 }
 
+// Add an output holding a copy of 'data' to 'response'
+void
+AddOutput(
+    tc::InferenceResponse* response, const std::string& name,
+    inference::DataType dtype, const std::vector<int64_t>& shape,
+    const std::vector<tc::Byte>& data)
+{
+  tc::InferenceResponse::Output* output = nullptr;
+  helpers::CheckStatus(response->AddOutput(name, dtype, shape, &output));
+  TRITONSERVER_MemoryType memory_type = TRITONSERVER_MEMORY_CPU;
+  int64_t memory_type_id = 0;
+  void* buffer = nullptr;
+  helpers::CheckStatus(output->AllocateDataBuffer(
+      &buffer, data.size(), &memory_type, &memory_type_id));
+  if (!data.empty()) {
+    std::memcpy(buffer, data.data(), data.size());
+  }
+}
+
+// Serialized BYTES tensor of 'count' copies of 'str'
+std::vector<tc::Byte>
+BytesTensor(const std::string& str, const size_t count)
+{
+  std::vector<tc::Byte> data;
+  for (size_t i = 0; i < count; ++i) {
+    const uint32_t len = str.size();
+    const auto len_bytes = reinterpret_cast<const tc::Byte*>(&len);
+    data.insert(data.end(), len_bytes, len_bytes + sizeof(len));
+    data.insert(
+        data.end(), reinterpret_cast<const tc::Byte*>(str.data()),
+        reinterpret_cast<const tc::Byte*>(str.data()) + str.size());
+  }
+  return data;
+}
+
+void
+ExpectSameOutputs(
+    const tc::InferenceResponse& expected, const tc::InferenceResponse& actual)
+{
+  ASSERT_EQ(actual.Outputs().size(), expected.Outputs().size());
+  for (size_t i = 0; i < expected.Outputs().size(); ++i) {
+    const auto& e = expected.Outputs()[i];
+    const auto& a = actual.Outputs()[i];
+    EXPECT_EQ(a.Name(), e.Name());
+    EXPECT_EQ(a.DType(), e.DType());
+    EXPECT_EQ(a.Shape(), e.Shape());
+
+    const void* e_base;
+    const void* a_base;
+    size_t e_byte_size, a_byte_size;
+    TRITONSERVER_MemoryType memory_type;
+    int64_t memory_type_id;
+    void* userp;
+    CheckStatus(e.DataBuffer(
+        &e_base, &e_byte_size, &memory_type, &memory_type_id, &userp));
+    CheckStatus(a.DataBuffer(
+        &a_base, &a_byte_size, &memory_type, &memory_type_id, &userp));
+    ASSERT_EQ(a_byte_size, e_byte_size) << "output '" << e.Name() << "'";
+    if (e_byte_size > 0) {
+      EXPECT_EQ(std::memcmp(a_base, e_base, e_byte_size), 0)
+          << "output '" << e.Name() << "' data differs";
+    }
+  }
+}
+
+// Pack 'response' into a cache entry with 'codec' and return a copy of
+// the packed bytes
+std::vector<tc::Byte>
+Pack(tc::InferenceResponse* response, const tc::CacheCodec codec)
+{
+  tc::CacheEntry entry;
+  entry.SetCodec(codec);
+  CheckStatus(entry.AppendResponse(response));
+  const auto& buffer = entry.Buffers().at(0);
+  const auto base = static_cast<const tc::Byte*>(buffer.first);
+  return std::vector<tc::Byte>(base, base + buffer.second);
+}
+
+// Unpack 'packed' into 'response'. The bytes are copied into a buffer of
+// exactly their size so that reads past the end are caught by memory
+// checkers.
+tc::Status
+Unpack(const std::vector<tc::Byte>& packed, tc::InferenceResponse* response)
+{
+  std::unique_ptr<tc::Byte[]> bytes(new tc::Byte[packed.size()]);
+  std::copy(packed.begin(), packed.end(), bytes.get());
+  tc::CacheEntry entry;
+  entry.AddBuffer(bytes.get(), packed.size());
+  tc::InferenceResponse* responses[] = {response};
+  return entry.DeserializeBuffers(responses);
+}
+
 }  // namespace helpers
 
 namespace {
@@ -904,6 +1000,48 @@ ParallelLookupInsert(
   }
 }
 
+// Lookup inserted and missing keys with a single batched lookup
+void
+BatchLookup(
+    std::shared_ptr<tc::TritonCache> cache,
+    std::unique_ptr<tc::InferenceResponse>& insert_response,
+    std::vector<tc::InferenceRequest*>& unique_requests)
+{
+  std::vector<std::unique_ptr<tc::InferenceResponse>> responses;
+  std::vector<tc::InferenceResponse*> lookup_responses;
+  std::vector<std::string> keys;
+  for (size_t idx = 0; idx < unique_requests.size(); idx++) {
+    std::unique_ptr<tc::InferenceResponse> response;
+    helpers::CheckStatus(
+        unique_requests[idx]->ResponseFactory()->CreateResponse(&response));
+    lookup_responses.push_back(response.get());
+    responses.push_back(std::move(response));
+    // Only insert every other key so that the batch has hits and misses
+    auto key = "batch" + std::to_string(idx);
+    if ((idx % 2) == 0) {
+      helpers::CheckStatus(cache->Insert(insert_response.get(), key));
+    }
+    keys.push_back(key);
+  }
+
+  std::vector<tc::Status> statuses;
+  helpers::CheckStatus(cache->Lookup(keys, lookup_responses, &statuses));
+  ASSERT_EQ(statuses.size(), keys.size());
+  for (size_t idx = 0; idx < statuses.size(); idx++) {
+    if ((idx % 2) == 0) {
+      ASSERT_TRUE(statuses[idx].IsOk()) << statuses[idx].Message();
+      ASSERT_EQ(
+          responses[idx]->Outputs().size(), insert_response->Outputs().size());
+    } else {
+      ASSERT_EQ(statuses[idx].StatusCode(), tc::Status::Code::NOT_FOUND);
+    }
+  }
+
+  // Mismatching number of keys and responses is rejected as a whole
+  lookup_responses.pop_back();
+  ASSERT_FALSE(cache->Lookup(keys, lookup_responses, &statuses).IsOk());
+}
+
 void
 EndToEnd(
     std::shared_ptr<tc::TritonCache> cache, tc::InferenceRequest* request,
@@ -1117,6 +1255,15 @@ TEST_F(RequestResponseCacheTest, TestLocalCacheParallelLookupInsert)
       cache, thread_count, response_400bytes, unique_requests);
 }
 
+TEST_F(RequestResponseCacheTest, TestLocalCacheBatchLookup)
+{
+  // Set size large enough to hold all responses
+  auto cache =
+      helpers::CreateLocalCache(2 * unique_requests.size() * output100_size);
+  ASSERT_NE(cache, nullptr);
+  tests::BatchLookup(cache, response_400bytes, unique_requests);
+}
+
 TEST_F(RequestResponseCacheTest, TestLocalCacheEndToEnd)
 {
   auto cache = helpers::CreateLocalCache(8 * 1024 * 1024);
@@ -1124,6 +1271,164 @@ TEST_F(RequestResponseCacheTest, TestLocalCacheEndToEnd)
   tests::EndToEnd(cache, request0, response0, outputs0);
 }
 
+//
+// Cache codec testing
+//
+
+TEST(CacheCodecTest, RoundTrip)
+{
+  // Slowly varying values compress with both codecs
+  std::vector<float> values(256);
+  for (size_t i = 0; i < values.size(); ++i) {
+    values[i] = 1.0f + (i / 16) * 0.25f;
+  }
+  const size_t byte_size = values.size() * sizeof(float);
+  for (const auto codec :
+       {tc::CacheCodec::SHUFFLE, tc::CacheCodec::FLOAT_DELTA}) {
+    std::vector<uint8_t> encoded;
+    ASSERT_TRUE(tc::CacheEncode(
+        codec, sizeof(float), values.data(), byte_size, &encoded));
+    EXPECT_LT(encoded.size(), byte_size);
+
+    std::vector<float> decoded(values.size());
+    helpers::CheckStatus(tc::CacheDecode(
+        codec, sizeof(float), encoded.data(), encoded.size(), decoded.data(),
+        byte_size));
+    EXPECT_EQ(decoded, values);
+  }
+}
+
+TEST(CacheCodecTest, IncompressibleAndEmpty)
+{
+  // Data that doesn't shrink, and empty data, is stored as is
+  std::vector<uint8_t> encoded;
+  const uint8_t distinct[] = {1, 2, 3, 4, 5, 6, 7, 8};
+  EXPECT_FALSE(tc::CacheEncode(
+      tc::CacheCodec::SHUFFLE, 1, distinct, sizeof(distinct), &encoded));
+  EXPECT_FALSE(
+      tc::CacheEncode(tc::CacheCodec::SHUFFLE, 4, distinct, 0, &encoded));
+  // FLOAT_DELTA only applies to 32-bit elements
+  const std::vector<uint8_t> zeros(64, 0);
+  EXPECT_FALSE(tc::CacheEncode(
+      tc::CacheCodec::FLOAT_DELTA, 8, zeros.data(), zeros.size(), &encoded));
+}
+
+TEST(CacheCodecTest, RejectTruncatedAndCorrupted)
+{
+  const std::vector<uint8_t> zeros(1024, 0);
+  std::vector<uint8_t> encoded;
+  ASSERT_TRUE(tc::CacheEncode(
+      tc::CacheCodec::SHUFFLE, 4, zeros.data(), zeros.size(), &encoded));
+
+  std::vector<uint8_t> decoded(zeros.size());
+  // Every proper prefix is rejected. Each is copied to a buffer of its
+  // exact size so that an over-read is caught by memory checkers.
+  for (size_t size = 0; size < encoded.size(); ++size) {
+    std::unique_ptr<uint8_t[]> truncated(new uint8_t[size]);
+    std::copy(encoded.begin(), encoded.begin() + size, truncated.get());
+    EXPECT_FALSE(tc::CacheDecode(
+                     tc::CacheCodec::SHUFFLE, 4, truncated.get(), size,
+                     decoded.data(), decoded.size())
+                     .IsOk())
+        << "prefix of " << size << " bytes";
+  }
+
+  // A literal run longer than the remaining input
+  std::vector<uint8_t> corrupted{127, 0, 0};
+  EXPECT_FALSE(tc::CacheDecode(
+                   tc::CacheCodec::SHUFFLE, 1, corrupted.data(),
+                   corrupted.size(), decoded.data(), decoded.size())
+                   .IsOk());
+  // A repeat that doesn't fit the output
+  corrupted = {255, 0};
+  EXPECT_FALSE(tc::CacheDecode(
+                   tc::CacheCodec::SHUFFLE, 1, corrupted.data(),
+                   corrupted.size(), decoded.data(), 8)
+                   .IsOk());
+  // Trailing bytes after the output is complete
+  encoded.push_back(0);
+  EXPECT_FALSE(tc::CacheDecode(
+                   tc::CacheCodec::SHUFFLE, 4, encoded.data(), encoded.size(),
+                   decoded.data(), decoded.size())
+                   .IsOk());
+}
+
+TEST_F(RequestResponseCacheTest, TestCacheEntryCodecRoundTrip)
+{
+  // Several outputs, one compressible per codec, a BYTES output and an
+  // empty output
+  std::vector<float> values(128);
+  for (size_t i = 0; i < values.size(); ++i) {
+    values[i] = 0.5f * (i / 32);
+  }
+  const auto value_bytes = reinterpret_cast<const tc::Byte*>(values.data());
+  const std::vector<tc::Byte> fp32(
+      value_bytes, value_bytes + values.size() * sizeof(float));
+  const std::vector<tc::Byte> strings = helpers::BytesTensor("abcd", 64);
+  const std::vector<tc::Byte> distinct{1, 2, 3, 4, 5, 6, 7, 8};
+
+  size_t uncompressed_byte_size = 0;
+  for (const auto codec :
+       {tc::CacheCodec::NONE, tc::CacheCodec::SHUFFLE,
+        tc::CacheCodec::FLOAT_DELTA}) {
+    std::unique_ptr<tc::InferenceResponse> response;
+    helpers::reset_response(&response, request0);
+    helpers::AddOutput(
+        response.get(), "fp32", inference::DataType::TYPE_FP32,
+        {1, (int64_t)values.size()}, fp32);
+    helpers::AddOutput(
+        response.get(), "bytes", inference::DataType::TYPE_STRING, {1, 64},
+        strings);
+    helpers::AddOutput(
+        response.get(), "empty", inference::DataType::TYPE_INT32, {1, 0}, {});
+    helpers::AddOutput(
+        response.get(), "uint8", inference::DataType::TYPE_UINT8, {1, 8},
+        distinct);
+
+    const auto packed = helpers::Pack(response.get(), codec);
+    if (codec == tc::CacheCodec::NONE) {
+      uncompressed_byte_size = packed.size();
+    } else {
+      EXPECT_LT(packed.size(), uncompressed_byte_size);
+    }
+
+    std::unique_ptr<tc::InferenceResponse> lookup_response;
+    helpers::reset_response(&lookup_response, request0);
+    helpers::CheckStatus(helpers::Unpack(packed, lookup_response.get()));
+    helpers::ExpectSameOutputs(*response, *lookup_response);
+  }
+}
+
+TEST_F(RequestResponseCacheTest, TestCacheEntryRejectTruncatedAndCorrupted)
+{
+  const std::vector<tc::Byte> zeros(1024, tc::Byte{0});
+  std::unique_ptr<tc::InferenceResponse> response;
+  helpers::reset_response(&response, request0);
+  helpers::AddOutput(
+      response.get(), "zeros", inference::DataType::TYPE_INT32, {1, 256},
+      zeros);
+  const auto packed = helpers::Pack(response.get(), tc::CacheCodec::SHUFFLE);
+
+  for (size_t size = 0; size < packed.size(); ++size) {
+    std::unique_ptr<tc::InferenceResponse> lookup_response;
+    helpers::reset_response(&lookup_response, request0);
+    const std::vector<tc::Byte> truncated(
+        packed.begin(), packed.begin() + size);
+    EXPECT_FALSE(helpers::Unpack(truncated, lookup_response.get()).IsOk())
+        << "prefix of " << size << " bytes";
+  }
+
+  // Flip each byte in turn, a lookup must either fail or produce outputs
+  // without reading out of bounds or allocating for a corrupted size
+  for (size_t pos = 0; pos < packed.size(); ++pos) {
+    auto corrupted = packed;
+    corrupted[pos] ^= 0xFF;
+    std::unique_ptr<tc::InferenceResponse> lookup_response;
+    helpers::reset_response(&lookup_response, request0);
+    helpers::Unpack(corrupted, lookup_response.get());
+  }
+}
+
 
 //
 // Redis Cache Testing
@@ -0,0 +1,464 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Microbenchmarks of the request path through the schedulers, the
+// rate limiter and the response cache. The models are served by the
+// null backend, so the measured time is the overhead of the core. Each
+// thread keeps one request in flight, the batch formation quality is
+// reported from the model statistics as the average executed batch
+// size.
+//
+// The null backend is looked up in the directory given by the
+// TRITON_NULL_BACKEND_DIR environment variable, which defaults to the
+// directory it is built into.
+
+#include <atomic>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "benchmark/benchmark.h"
+#include "benchmark_util.h"
+#include "triton/core/tritonserver.h"
+
+#define TRITONJSON_STATUSTYPE TRITONSERVER_Error*
+#define TRITONJSON_STATUSRETURN(M) \
+  return TRITONSERVER_ErrorNew(TRITONSERVER_ERROR_INTERNAL, (M).c_str())
+#define TRITONJSON_STATUSSUCCESS nullptr
+#include "triton/common/triton_json.h"
+
+namespace {
+
+using triton::core::test::Check;
+using triton::core::test::LatencySamples;
+using triton::core::test::ModelRepository;
+using triton::core::test::NowNs;
+using triton::core::test::StartServer;
+
+TRITONSERVER_Server* server = nullptr;
+TRITONSERVER_ResponseAllocator* allocator = nullptr;
+std::atomic<uint64_t> next_correlation_id{1};
+
+//
+// A reusable request of a benchmark thread, with one inference in
+// flight at a time.
+//
+class Client {
+ public:
+  // The request has 'element_count' INT32 input elements
+  explicit Client(const char* model_name, const int64_t element_count = 1)
+      : input_(element_count, 0)
+  {
+    const int64_t shape[] = {1, element_count};
+    valid_ =
+        Check(
+            TRITONSERVER_InferenceRequestNew(
+                &request_, server, model_name, -1 /* model_version */),
+            "creating request") &&
+        Check(
+            TRITONSERVER_InferenceRequestAddInput(
+                request_, "INPUT0", TRITONSERVER_TYPE_INT32, shape, 2),
+            "adding input") &&
+        Check(
+            TRITONSERVER_InferenceRequestAppendInputData(
+                request_, "INPUT0", input_.data(),
+                input_.size() * sizeof(int32_t),
+                TRITONSERVER_MEMORY_CPU, 0),
+            "appending input data") &&
+        Check(
+            TRITONSERVER_InferenceRequestAddRequestedOutput(
+                request_, "OUTPUT0"),
+            "adding requested output") &&
+        Check(
+            TRITONSERVER_InferenceRequestSetReleaseCallback(
+                request_, RequestRelease, this),
+            "setting release callback") &&
+        Check(
+            TRITONSERVER_InferenceRequestSetResponseCallback(
+                request_, allocator, nullptr, ResponseComplete, this),
+            "setting response callback");
+  }
+
+  ~Client()
+  {
+    if (request_ != nullptr) {
+      Check(TRITONSERVER_InferenceRequestDelete(request_), "deleting request");
+    }
+  }
+
+  // Set the first input element, the input data is shared with the
+  // request so the value is used by the following inferences.
+  void SetInputValue(const int32_t value) { input_[0] = value; }
+
+  // Run one inference, as a single-request sequence if 'sequence'.
+  // Return false on error.
+  bool Infer(bool sequence)
+  {
+    if (!valid_) {
+      return false;
+    }
+    if (sequence) {
+      if (!Check(
+              TRITONSERVER_InferenceRequestSetCorrelationId(
+                  request_, next_correlation_id.fetch_add(1)),
+              "setting correlation id") ||
+          !Check(
+              TRITONSERVER_InferenceRequestSetFlags(
+                  request_, TRITONSERVER_REQUEST_FLAG_SEQUENCE_START |
+                                TRITONSERVER_REQUEST_FLAG_SEQUENCE_END),
+              "setting flags")) {
+        return false;
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      pending_ = 2;  // the release and the final response
+      success_ = true;
+    }
+    if (!Check(
+            TRITONSERVER_ServerInferAsync(server, request_, nullptr),
+            "running inference")) {
+      return false;
+    }
+    std::unique_lock<std::mutex> lk(mu_);
+    cv_.wait(lk, [this] { return pending_ == 0; });
+    return success_;
+  }
+
+ private:
+  static void RequestRelease(
+      TRITONSERVER_InferenceRequest* request, const uint32_t flags,
+      void* userp)
+  {
+    reinterpret_cast<Client*>(userp)->Complete(true);
+  }
+
+  static void ResponseComplete(
+      TRITONSERVER_InferenceResponse* response, const uint32_t flags,
+      void* userp)
+  {
+    bool success = true;
+    if (response != nullptr) {
+      success = Check(
+          TRITONSERVER_InferenceResponseError(response), "inference response");
+      Check(
+          TRITONSERVER_InferenceResponseDelete(response), "deleting response");
+    }
+    if ((flags & TRITONSERVER_RESPONSE_COMPLETE_FINAL) != 0) {
+      reinterpret_cast<Client*>(userp)->Complete(success);
+    }
+  }
+
+  void Complete(bool success)
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    success_ = success_ && success;
+    if (--pending_ == 0) {
+      cv_.notify_one();
+    }
+  }
+
+  TRITONSERVER_InferenceRequest* request_ = nullptr;
+  std::vector<int32_t> input_;
+  bool valid_ = false;
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  int pending_ = 0;
+  bool success_ = true;
+};
+
+struct ModelStats {
+  uint64_t inference_count_ = 0;
+  uint64_t execution_count_ = 0;
+  uint64_t queue_count_ = 0;
+  uint64_t queue_ns_ = 0;
+  uint64_t cache_hit_count_ = 0;
+  uint64_t cache_miss_count_ = 0;
+};
+
+TRITONSERVER_Error*
+GetModelStats(const char* model_name, ModelStats* stats)
+{
+  TRITONSERVER_Message* message = nullptr;
+  TRITONSERVER_Error* err = TRITONSERVER_ServerModelStatistics(
+      server, model_name, -1 /* model_version */, &message);
+  if (err != nullptr) {
+    return err;
+  }
+
+  const char* base = nullptr;
+  size_t byte_size = 0;
+  triton::common::TritonJson::Value json;
+  triton::common::TritonJson::Value model_stats;
+  triton::common::TritonJson::Value model_stat;
+  triton::common::TritonJson::Value inference_stats;
+  triton::common::TritonJson::Value queue;
+  triton::common::TritonJson::Value cache_hit;
+  triton::common::TritonJson::Value cache_miss;
+  err = TRITONSERVER_MessageSerializeToJson(message, &base, &byte_size);
+  if (err == nullptr) {
+    err = json.Parse(base, byte_size);
+  }
+  if (err == nullptr) {
+    err = json.MemberAsArray("model_stats", &model_stats);
+  }
+  if (err == nullptr) {
+    err = model_stats.IndexAsObject(0, &model_stat);
+  }
+  if (err == nullptr) {
+    err = model_stat.MemberAsUInt("inference_count", &stats->inference_count_);
+  }
+  if (err == nullptr) {
+    err = model_stat.MemberAsUInt("execution_count", &stats->execution_count_);
+  }
+  if (err == nullptr) {
+    err = model_stat.MemberAsObject("inference_stats", &inference_stats);
+  }
+  if (err == nullptr) {
+    err = inference_stats.MemberAsObject("queue", &queue);
+  }
+  if (err == nullptr) {
+    err = queue.MemberAsUInt("count", &stats->queue_count_);
+  }
+  if (err == nullptr) {
+    err = queue.MemberAsUInt("ns", &stats->queue_ns_);
+  }
+  if (err == nullptr) {
+    err = inference_stats.MemberAsObject("cache_hit", &cache_hit);
+  }
+  if (err == nullptr) {
+    err = cache_hit.MemberAsUInt("count", &stats->cache_hit_count_);
+  }
+  if (err == nullptr) {
+    err = inference_stats.MemberAsObject("cache_miss", &cache_miss);
+  }
+  if (err == nullptr) {
+    err = cache_miss.MemberAsUInt("count", &stats->cache_miss_count_);
+  }
+  TRITONSERVER_MessageDelete(message);
+  return err;
+}
+
+// Report the counters derived from the change of the statistics of
+// 'model_name' since 'before'. Only called by the first thread.
+void
+ReportModelStats(
+    benchmark::State& state, const char* model_name, const ModelStats& before)
+{
+  ModelStats after;
+  if (!Check(GetModelStats(model_name, &after), "getting statistics")) {
+    return;
+  }
+  const uint64_t inferences = after.inference_count_ - before.inference_count_;
+  const uint64_t executions = after.execution_count_ - before.execution_count_;
+  const uint64_t queued = after.queue_count_ - before.queue_count_;
+  const uint64_t queue_ns = after.queue_ns_ - before.queue_ns_;
+  const uint64_t hits = after.cache_hit_count_ - before.cache_hit_count_;
+  const uint64_t lookups =
+      hits + (after.cache_miss_count_ - before.cache_miss_count_);
+  state.counters["avg_batch_size"] =
+      (executions == 0) ? 0.0 : double(inferences) / executions;
+  state.counters["avg_queue_ns"] =
+      (queued == 0) ? 0.0 : double(queue_ns) / queued;
+  if (lookups != 0) {
+    state.counters["cache_hit_ratio"] = double(hits) / lookups;
+  }
+}
+
+// Run inferences with 'client' until the benchmark ends, calling
+// 'prepare' before each.
+template <typename PrepareFn>
+void
+RunInferences(
+    benchmark::State& state, const char* model_name, Client& client,
+    bool sequence, PrepareFn prepare)
+{
+  // The other threads wait for the first one to enter the loop, and
+  // all have left it before the statistics are read again.
+  ModelStats before;
+  if ((state.thread_index() == 0) &&
+      !Check(GetModelStats(model_name, &before), "getting statistics")) {
+    state.SkipWithError("failed to get the model statistics");
+  }
+
+  LatencySamples latencies;
+  for (auto _ : state) {
+    prepare();
+    const uint64_t start_ns = NowNs();
+    if (!client.Infer(sequence)) {
+      state.SkipWithError("inference failed");
+      break;
+    }
+    latencies.Add(NowNs() - start_ns);
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["ns_per_request"] = benchmark::Counter(
+      state.iterations() * 1e-9,
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+  latencies.Report(state);
+
+  if (state.thread_index() == 0) {
+    ReportModelStats(state, model_name, before);
+  }
+}
+
+void
+BM_Infer(benchmark::State& state, const char* model_name, bool sequence)
+{
+  Client client(model_name);
+  RunInferences(state, model_name, client, sequence, [] {});
+}
+
+// Argument is the number of INT32 input elements, the cached responses
+// hold as many output elements. Lookups of the same input hit the
+// cache after the first insertion, and lookups of distinct inputs miss
+// and insert, evicting older entries once the cache is full.
+void
+BM_Cache(benchmark::State& state, bool hit)
+{
+  static std::atomic<int32_t> next_value{1};
+  Client client("null_cached", state.range(0));
+  RunInferences(state, "null_cached", client, false, [&client, hit] {
+    if (!hit) {
+      client.SetInputValue(next_value.fetch_add(1));
+    }
+  });
+  state.SetBytesProcessed(state.iterations() * state.range(0) * 4);
+}
+
+// Wall-clock time, as the threads mostly wait on the server
+BENCHMARK_CAPTURE(BM_Infer, dynamic_batcher, "null_dynamic", false)
+    ->ThreadRange(1, 32)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_Infer, sequence_batcher, "null_sequence", true)
+    ->ThreadRange(1, 32)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_Infer, ensemble, "null_ensemble", false)
+    ->ThreadRange(1, 32)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_Infer, rate_limiter, "null_rate_limited", false)
+    ->ThreadRange(1, 32)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_Cache, hit, true)
+    ->RangeMultiplier(16)
+    ->Range(16, 256 << 10)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_Cache, miss, false)
+    ->RangeMultiplier(16)
+    ->Range(16, 256 << 10)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+
+// Add the models of the benchmarks to 'repository'. Return false on
+// error.
+bool
+AddModels(ModelRepository* repository)
+{
+  const std::string io =
+      "input [{ name: \"INPUT0\" data_type: TYPE_INT32 dims: [ 1 ] }]\n"
+      "output [{ name: \"OUTPUT0\" data_type: TYPE_INT32 dims: [ 1 ] }]\n";
+  const std::string variable_io =
+      "input [{ name: \"INPUT0\" data_type: TYPE_INT32 dims: [ -1 ] }]\n"
+      "output [{ name: \"OUTPUT0\" data_type: TYPE_INT32 dims: [ -1 ] }]\n";
+  return repository->AddModel(
+             "null_dynamic",
+             "backend: \"null\"\nmax_batch_size: 64\n" + io +
+                 "dynamic_batching {}\n"
+                 "instance_group [{ count: 1 kind: KIND_CPU }]\n") &&
+         repository->AddModel(
+             "null_sequence",
+             "backend: \"null\"\nmax_batch_size: 64\n" + io +
+                 "sequence_batching { direct {} }\n"
+                 "instance_group [{ count: 1 kind: KIND_CPU }]\n") &&
+         repository->AddModel(
+             "null_ensemble",
+             "platform: \"ensemble\"\nmax_batch_size: 64\n" + io +
+                 "ensemble_scheduling { step [{\n"
+                 "  model_name: \"null_dynamic\" model_version: -1\n"
+                 "  input_map { key: \"INPUT0\" value: \"INPUT0\" }\n"
+                 "  output_map { key: \"OUTPUT0\" value: \"OUTPUT0\" }\n"
+                 "}]}\n") &&
+         repository->AddModel(
+             "null_rate_limited",
+             "backend: \"null\"\nmax_batch_size: 64\n" + io +
+                 "instance_group [{ count: 4 kind: KIND_CPU\n"
+                 "  rate_limiter { resources [{ name: \"R\" count: 1 }] }\n"
+                 "}]\n") &&
+         repository->AddModel(
+             "null_cached",
+             "backend: \"null\"\nmax_batch_size: 64\n" + variable_io +
+                 "dynamic_batching {}\n"
+                 "response_cache { enable: true }\n"
+                 "instance_group [{ count: 1 kind: KIND_CPU }]\n");
+}
+
+// The rate limiter resource of "null_rate_limited" and the response
+// cache of "null_cached"
+bool
+ConfigureServer(TRITONSERVER_ServerOptions* options)
+{
+  return Check(
+             TRITONSERVER_ServerOptionsSetRateLimiterMode(
+                 options, TRITONSERVER_RATE_LIMIT_EXEC_COUNT),
+             "setting rate limiter mode") &&
+         Check(
+             TRITONSERVER_ServerOptionsAddRateLimiterResource(
+                 options, "R", 2, -1 /* device */),
+             "adding rate limiter resource") &&
+         Check(
+             TRITONSERVER_ServerOptionsSetCacheConfig(
+                 options, "local", "{\"size\": 268435456}"),
+             "setting cache config");
+}
+
+}  // namespace
+
+int
+main(int argc, char** argv)
+{
+  benchmark::Initialize(&argc, argv);
+
+  ModelRepository repository;
+  if (!repository.Create("scheduler_benchmark") || !AddModels(&repository)) {
+    std::cerr << "error: failed to create the model repository" << std::endl;
+    return 1;
+  }
+  if (!StartServer(
+          repository, NULL_BACKEND_DIR, ConfigureServer, &server,
+          &allocator)) {
+    return 1;
+  }
+
+  benchmark::RunSpecifiedBenchmarks();
+
+  Check(TRITONSERVER_ResponseAllocatorDelete(allocator), "deleting allocator");
+  Check(TRITONSERVER_ServerDelete(server), "deleting server");
+  return 0;
+}
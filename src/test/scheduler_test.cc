@@ -0,0 +1,778 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Tests of the scheduling of requests through the C API, with models
+// served by the null backend that is looked up in the directory given
+// by the TRITON_NULL_BACKEND_DIR environment variable, or in the
+// directory it is built into.
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+#include "benchmark_util.h"
+#include "triton/core/tritonserver.h"
+
+#define TRITONJSON_STATUSTYPE TRITONSERVER_Error*
+#define TRITONJSON_STATUSRETURN(M) \
+  return TRITONSERVER_ErrorNew(TRITONSERVER_ERROR_INTERNAL, (M).c_str())
+#define TRITONJSON_STATUSSUCCESS nullptr
+#include "triton/common/triton_json.h"
+
+namespace {
+
+using triton::core::test::ModelRepository;
+
+#define FAIL_TEST_IF_ERR(X, MSG)                                              \
+  do {                                                                        \
+    std::shared_ptr<TRITONSERVER_Error> err__((X), TRITONSERVER_ErrorDelete); \
+    ASSERT_TRUE((err__ == nullptr))                                           \
+        << "error: " << (MSG) << ": "                                         \
+        << TRITONSERVER_ErrorCodeString(err__.get()) << " - "                 \
+        << TRITONSERVER_ErrorMessage(err__.get());                            \
+  } while (false)
+
+const std::string kIdentityIO =
+    "backend: \"null\"\nmax_batch_size: 8\n"
+    "input [{ name: \"INPUT0\" data_type: TYPE_INT32 dims: [ 1 ] }]\n"
+    "output [{ name: \"OUTPUT0\" data_type: TYPE_INT32 dims: [ 1 ] }]\n";
+
+// The optional settings of an issued request
+struct RequestOptions {
+  // The number of elements of the input, all set to the input value
+  int64_t element_count_ = 1;
+  uint64_t correlation_id_ = 0;
+  uint32_t flags_ = 0;
+  uint64_t priority_ = 0;
+  TRITONSERVER_InferenceTrace* trace_ = nullptr;
+};
+
+//
+// Requests with an INT32 input of a single value issued together, and the
+// first output value of their responses in the order the responses
+// complete.
+//
+class Inferences {
+ public:
+  Inferences(
+      TRITONSERVER_Server* server, TRITONSERVER_ResponseAllocator* allocator,
+      const size_t count)
+      : server_(server), allocator_(allocator), inputs_(count),
+        requests_(count, nullptr)
+  {
+  }
+
+  // Issue request 'index' of 'model_name', which has input 'value',
+  // with the settings in 'options'. Return the error of
+  // TRITONSERVER_ServerInferAsync, the request is not issued if there
+  // is one.
+  TRITONSERVER_Error* Issue(
+      const char* model_name, const size_t index, const int32_t value,
+      const RequestOptions& options = RequestOptions())
+  {
+    inputs_[index].assign(options.element_count_, value);
+    const int64_t shape[] = {1, options.element_count_};
+    TRITONSERVER_InferenceRequest* request = nullptr;
+    TRITONSERVER_Error* err = TRITONSERVER_InferenceRequestNew(
+        &request, server_, model_name, -1 /* model_version */);
+    if (err == nullptr) {
+      err = TRITONSERVER_InferenceRequestAddInput(
+          request, "INPUT0", TRITONSERVER_TYPE_INT32, shape, 2);
+    }
+    if (err == nullptr) {
+      err = TRITONSERVER_InferenceRequestAppendInputData(
+          request, "INPUT0", inputs_[index].data(),
+          inputs_[index].size() * sizeof(int32_t), TRITONSERVER_MEMORY_CPU, 0);
+    }
+    if ((err == nullptr) && (options.correlation_id_ != 0)) {
+      err = TRITONSERVER_InferenceRequestSetCorrelationId(
+          request, options.correlation_id_);
+    }
+    if (err == nullptr) {
+      err = TRITONSERVER_InferenceRequestSetFlags(request, options.flags_);
+    }
+    if (err == nullptr) {
+      err = TRITONSERVER_InferenceRequestSetPriorityUInt64(
+          request, options.priority_);
+    }
+    if (err == nullptr) {
+      err = TRITONSERVER_InferenceRequestSetReleaseCallback(
+          request, RequestRelease, this);
+    }
+    if (err == nullptr) {
+      err = TRITONSERVER_InferenceRequestSetResponseCallback(
+          request, allocator_, nullptr, ResponseComplete, this);
+    }
+    if (err == nullptr) {
+      {
+        std::lock_guard<std::mutex> lk(mu_);
+        ++pending_;
+        ++unreleased_;
+        requests_[index] = request;
+      }
+      err = TRITONSERVER_ServerInferAsync(server_, request, options.trace_);
+      if (err != nullptr) {
+        std::lock_guard<std::mutex> lk(mu_);
+        --pending_;
+        --unreleased_;
+        requests_[index] = nullptr;
+      }
+    }
+    if ((err != nullptr) && (request != nullptr)) {
+      TRITONSERVER_InferenceRequestDelete(request);
+    }
+    return err;
+  }
+
+  // Cancel request 'index' if it has not been released yet
+  TRITONSERVER_Error* Cancel(const size_t index)
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (requests_[index] == nullptr) {
+      return nullptr;
+    }
+    return TRITONSERVER_InferenceRequestCancel(requests_[index]);
+  }
+
+  // Wait for the final responses and the release of all issued
+  // requests
+  void Wait()
+  {
+    std::unique_lock<std::mutex> lk(mu_);
+    cv_.wait(lk, [this] { return (pending_ == 0) && (unreleased_ == 0); });
+  }
+
+  // The output values of the successful responses in completion order
+  const std::vector<int32_t>& Outputs() const { return outputs_; }
+  size_t ErrorCount() const { return error_count_; }
+
+ private:
+  static void RequestRelease(
+      TRITONSERVER_InferenceRequest* request, const uint32_t flags,
+      void* userp)
+  {
+    Inferences* inferences = reinterpret_cast<Inferences*>(userp);
+    std::lock_guard<std::mutex> lk(inferences->mu_);
+    std::replace(
+        inferences->requests_.begin(), inferences->requests_.end(), request,
+        static_cast<TRITONSERVER_InferenceRequest*>(nullptr));
+    TRITONSERVER_InferenceRequestDelete(request);
+    if (--inferences->unreleased_ == 0) {
+      inferences->cv_.notify_all();
+    }
+  }
+
+  static void ResponseComplete(
+      TRITONSERVER_InferenceResponse* response, const uint32_t flags,
+      void* userp)
+  {
+    Inferences* inferences = reinterpret_cast<Inferences*>(userp);
+    std::lock_guard<std::mutex> lk(inferences->mu_);
+    if (response != nullptr) {
+      int32_t value = 0;
+      TRITONSERVER_Error* err = TRITONSERVER_InferenceResponseError(response);
+      if (err == nullptr) {
+        const char* name;
+        TRITONSERVER_DataType datatype;
+        const int64_t* shape;
+        uint64_t dim_count;
+        const void* base;
+        size_t byte_size;
+        TRITONSERVER_MemoryType memory_type;
+        int64_t memory_type_id;
+        void* buffer_userp;
+        err = TRITONSERVER_InferenceResponseOutput(
+            response, 0 /* index */, &name, &datatype, &shape, &dim_count,
+            &base, &byte_size, &memory_type, &memory_type_id, &buffer_userp);
+        if ((err == nullptr) && (byte_size >= sizeof(value))) {
+          std::memcpy(&value, base, sizeof(value));
+        }
+      }
+      if (err == nullptr) {
+        inferences->outputs_.push_back(value);
+      } else {
+        ++inferences->error_count_;
+        TRITONSERVER_ErrorDelete(err);
+      }
+      TRITONSERVER_InferenceResponseDelete(response);
+    }
+    if ((flags & TRITONSERVER_RESPONSE_COMPLETE_FINAL) != 0) {
+      if (--inferences->pending_ == 0) {
+        inferences->cv_.notify_all();
+      }
+    }
+  }
+
+  TRITONSERVER_Server* server_;
+  TRITONSERVER_ResponseAllocator* allocator_;
+  std::vector<std::vector<int32_t>> inputs_;
+
+  std::mutex mu_;
+  // The issued requests that have not been released yet
+  std::vector<TRITONSERVER_InferenceRequest*> requests_;
+  std::condition_variable cv_;
+  size_t pending_ = 0;
+  size_t unreleased_ = 0;
+  std::vector<int32_t> outputs_;
+  size_t error_count_ = 0;
+};
+
+// Response allocator that fails every output allocation, so that the
+// responses are sent with an error.
+TRITONSERVER_Error*
+FailingResponseAlloc(
+    TRITONSERVER_ResponseAllocator* allocator, const char* tensor_name,
+    size_t byte_size, TRITONSERVER_MemoryType memory_type,
+    int64_t memory_type_id, void* userp, void** buffer, void** buffer_userp,
+    TRITONSERVER_MemoryType* actual_memory_type,
+    int64_t* actual_memory_type_id)
+{
+  return TRITONSERVER_ErrorNew(
+      TRITONSERVER_ERROR_UNAVAILABLE, "no memory for the output");
+}
+
+// The number of executions of the latest version of 'model_name'
+TRITONSERVER_Error*
+GetExecutionCount(
+    TRITONSERVER_Server* server, const char* model_name, uint64_t* count)
+{
+  TRITONSERVER_Message* message = nullptr;
+  TRITONSERVER_Error* err = TRITONSERVER_ServerModelStatistics(
+      server, model_name, -1 /* model_version */, &message);
+  if (err != nullptr) {
+    return err;
+  }
+
+  const char* base = nullptr;
+  size_t byte_size = 0;
+  triton::common::TritonJson::Value json;
+  triton::common::TritonJson::Value model_stats;
+  triton::common::TritonJson::Value model_stat;
+  err = TRITONSERVER_MessageSerializeToJson(message, &base, &byte_size);
+  if (err == nullptr) {
+    err = json.Parse(base, byte_size);
+  }
+  if (err == nullptr) {
+    err = json.MemberAsArray("model_stats", &model_stats);
+  }
+  if (err == nullptr) {
+    err = model_stats.IndexAsObject(0, &model_stat);
+  }
+  if (err == nullptr) {
+    err = model_stat.MemberAsUInt("execution_count", count);
+  }
+  TRITONSERVER_MessageDelete(message);
+  return err;
+}
+
+// The ids of the traces whose records a trace collector delivered
+class CollectedTraces {
+ public:
+  static void Batch(
+      const TRITONSERVER_InferenceTraceRecord* records,
+      const size_t record_count, void* userp)
+  {
+    CollectedTraces* collected = reinterpret_cast<CollectedTraces*>(userp);
+    std::lock_guard<std::mutex> lk(collected->mu_);
+    for (size_t idx = 0; idx < record_count; ++idx) {
+      collected->ids_.insert(records[idx].trace_id);
+    }
+  }
+
+  bool Contains(const uint64_t trace_id)
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    return ids_.find(trace_id) != ids_.end();
+  }
+
+ private:
+  std::mutex mu_;
+  std::set<uint64_t> ids_;
+};
+
+class SchedulerTest : public ::testing::Test {
+ protected:
+  static void SetUpTestSuite()
+  {
+    repository_ = new ModelRepository();
+    ASSERT_TRUE(repository_->Create("scheduler_test"));
+    // Four shards, each batching for one of four instances, so without
+    // the single batcher the batches would complete out of order.
+    ASSERT_TRUE(repository_->AddModel(
+        "ordered_sharded",
+        kIdentityIO +
+            "dynamic_batching { preserve_ordering: true\n"
+            "  max_queue_delay_microseconds: 100 }\n"
+            "instance_group [{ count: 4 kind: KIND_CPU }]\n"
+            "parameters { key: \"TRITON_DYNAMIC_BATCHER_SHARD_COUNT\"\n"
+            "  value: { string_value: \"4\" } }\n"
+            "parameters { key: \"execute_delay_us\"\n"
+            "  value: { string_value: \"500\" } }\n"));
+    // Pairs of identical requests would be coalesced if coalescing
+    // were not disabled by preserve_ordering.
+    ASSERT_TRUE(repository_->AddModel(
+        "ordered_coalesced",
+        kIdentityIO +
+            "dynamic_batching { preserve_ordering: true\n"
+            "  max_queue_delay_microseconds: 100 }\n"
+            "instance_group [{ count: 2 kind: KIND_CPU }]\n"
+            "parameters { key: \"TRITON_DYNAMIC_BATCHER_COALESCE_REQUESTS\"\n"
+            "  value: { string_value: \"true\" } }\n"
+            "parameters { key: \"execute_delay_us\"\n"
+            "  value: { string_value: \"500\" } }\n"));
+    // Requests of two shapes interleaved would be regrouped by shape if
+    // shape bucketing were not disabled by preserve_ordering.
+    ASSERT_TRUE(repository_->AddModel(
+        "ordered_bucketed",
+        "backend: \"null\"\nmax_batch_size: 8\n"
+        "input [{ name: \"INPUT0\" data_type: TYPE_INT32 dims: [ -1 ] }]\n"
+        "output [{ name: \"OUTPUT0\" data_type: TYPE_INT32 dims: [ -1 ] }]\n"
+        "dynamic_batching { preserve_ordering: true\n"
+        "  max_queue_delay_microseconds: 10000 }\n"
+        "parameters { key: \"TRITON_DYNAMIC_BATCHER_SHAPE_BUCKETING\"\n"
+        "  value: { string_value: \"true\" } }\n"
+        "parameters { key: \"execute_delay_us\"\n"
+        "  value: { string_value: \"500\" } }\n"));
+    ASSERT_TRUE(repository_->AddModel("identity", kIdentityIO));
+    // A single instance and no batcher, so that a request waits in the
+    // payload queue while another one executes.
+    ASSERT_TRUE(repository_->AddModel(
+        "slow_single",
+        kIdentityIO + "instance_group [{ count: 1 kind: KIND_CPU }]\n"
+                      "parameters { key: \"execute_delay_us\"\n"
+                      "  value: { string_value: \"100000\" } }\n"));
+    ASSERT_TRUE(repository_->AddModel(
+        "slow_ensemble",
+        "platform: \"ensemble\"\nmax_batch_size: 8\n"
+        "input [{ name: \"INPUT0\" data_type: TYPE_INT32 dims: [ 1 ] }]\n"
+        "output [{ name: \"OUTPUT0\" data_type: TYPE_INT32 dims: [ 1 ] }]\n"
+        "ensemble_scheduling { step [{ model_name: \"slow_single\"\n"
+        "  model_version: -1\n"
+        "  input_map { key: \"INPUT0\" value: \"INPUT0\" }\n"
+        "  output_map { key: \"OUTPUT0\" value: \"OUTPUT0\" } }] }\n"));
+    // A single sequence slot, so that the other sequences wait in the
+    // backlog while one is active.
+    ASSERT_TRUE(repository_->AddModel(
+        "single_slot_sequence",
+        "backend: \"null\"\nmax_batch_size: 1\n"
+        "input [{ name: \"INPUT0\" data_type: TYPE_INT32 dims: [ 1 ] }]\n"
+        "output [{ name: \"OUTPUT0\" data_type: TYPE_INT32 dims: [ 1 ] }]\n"
+        "sequence_batching { direct { }\n"
+        "  max_sequence_idle_microseconds: 60000000 }\n"
+        "instance_group [{ count: 1 kind: KIND_CPU }]\n"));
+    // The steps of four requests fill the max batch size of the step
+    // model, the delay is long enough that only a full batch is flushed.
+    ASSERT_TRUE(repository_->AddModel(
+        "batched_step",
+        "backend: \"null\"\nmax_batch_size: 4\n"
+        "input [{ name: \"INPUT0\" data_type: TYPE_INT32 dims: [ 1 ] }]\n"
+        "output [{ name: \"OUTPUT0\" data_type: TYPE_INT32 dims: [ 1 ] }]\n"));
+    ASSERT_TRUE(repository_->AddModel(
+        "step_batched_ensemble",
+        "platform: \"ensemble\"\nmax_batch_size: 4\n"
+        "input [{ name: \"INPUT0\" data_type: TYPE_INT32 dims: [ 1 ] }]\n"
+        "output [{ name: \"OUTPUT0\" data_type: TYPE_INT32 dims: [ 1 ] }]\n"
+        "ensemble_scheduling { step [{ model_name: \"batched_step\"\n"
+        "  model_version: -1\n"
+        "  input_map { key: \"INPUT0\" value: \"INPUT0\" }\n"
+        "  output_map { key: \"OUTPUT0\" value: \"OUTPUT0\" } }] }\n"
+        "parameters { key: "
+        "\"TRITON_ENSEMBLE_STEP_BATCH_DELAY_MICROSECONDS\"\n"
+        "  value: { string_value: \"60000000\" } }\n"));
+    ASSERT_TRUE(triton::core::test::StartServer(
+        *repository_, NULL_BACKEND_DIR,
+        [](TRITONSERVER_ServerOptions*) { return true; }, &server_,
+        &allocator_));
+  }
+
+  static void TearDownTestSuite()
+  {
+    if (allocator_ != nullptr) {
+      FAIL_TEST_IF_ERR(
+          TRITONSERVER_ResponseAllocatorDelete(allocator_),
+          "deleting allocator");
+    }
+    if (server_ != nullptr) {
+      FAIL_TEST_IF_ERR(TRITONSERVER_ServerDelete(server_), "deleting server");
+    }
+    delete repository_;
+  }
+
+  void SetUp() override
+  {
+    ASSERT_TRUE(server_ != nullptr) << "server has not been created";
+  }
+
+  static ModelRepository* repository_;
+  static TRITONSERVER_Server* server_;
+  static TRITONSERVER_ResponseAllocator* allocator_;
+};
+
+ModelRepository* SchedulerTest::repository_ = nullptr;
+TRITONSERVER_Server* SchedulerTest::server_ = nullptr;
+TRITONSERVER_ResponseAllocator* SchedulerTest::allocator_ = nullptr;
+
+TEST_F(SchedulerTest, PreserveOrderingWithShards)
+{
+  constexpr size_t kCount = 256;
+  Inferences inferences(server_, allocator_, kCount);
+  for (size_t idx = 0; idx < kCount; ++idx) {
+    FAIL_TEST_IF_ERR(
+        inferences.Issue("ordered_sharded", idx, idx), "issuing inference");
+  }
+  inferences.Wait();
+
+  EXPECT_EQ(inferences.ErrorCount(), 0u);
+  ASSERT_EQ(inferences.Outputs().size(), kCount);
+  for (size_t idx = 0; idx < kCount; ++idx) {
+    EXPECT_EQ(inferences.Outputs()[idx], (int32_t)idx)
+        << "response " << idx << " out of order";
+  }
+}
+
+TEST_F(SchedulerTest, PreserveOrderingWithCoalescing)
+{
+  constexpr size_t kCount = 256;
+  Inferences inferences(server_, allocator_, kCount);
+  for (size_t idx = 0; idx < kCount; ++idx) {
+    FAIL_TEST_IF_ERR(
+        inferences.Issue("ordered_coalesced", idx, idx / 2),
+        "issuing inference");
+  }
+  inferences.Wait();
+
+  EXPECT_EQ(inferences.ErrorCount(), 0u);
+  ASSERT_EQ(inferences.Outputs().size(), kCount);
+  for (size_t idx = 0; idx < kCount; ++idx) {
+    EXPECT_EQ(inferences.Outputs()[idx], (int32_t)(idx / 2))
+        << "response " << idx << " out of order";
+  }
+}
+
+TEST_F(SchedulerTest, PreserveOrderingWithShapeBucketing)
+{
+  constexpr size_t kCount = 64;
+  Inferences inferences(server_, allocator_, kCount);
+  for (size_t idx = 0; idx < kCount; ++idx) {
+    RequestOptions options;
+    options.element_count_ = 1 + (idx % 2);
+    FAIL_TEST_IF_ERR(
+        inferences.Issue("ordered_bucketed", idx, idx, options),
+        "issuing inference");
+  }
+  inferences.Wait();
+
+  EXPECT_EQ(inferences.ErrorCount(), 0u);
+  ASSERT_EQ(inferences.Outputs().size(), kCount);
+  for (size_t idx = 0; idx < kCount; ++idx) {
+    EXPECT_EQ(inferences.Outputs()[idx], (int32_t)idx)
+        << "response " << idx << " out of order";
+  }
+}
+
+TEST_F(SchedulerTest, FailedRequestKeptByTailSampling)
+{
+  // Only the traces of failed requests are kept
+  CollectedTraces collected;
+  TRITONSERVER_InferenceTraceCollector* collector = nullptr;
+  FAIL_TEST_IF_ERR(
+      TRITONSERVER_InferenceTraceCollectorNew(
+          &collector, 1024 /* ring_capacity */, 10 /* flush_interval_ms */,
+          CollectedTraces::Batch, &collected),
+      "creating trace collector");
+  FAIL_TEST_IF_ERR(
+      TRITONSERVER_InferenceTraceCollectorSetTailSampling(
+          collector, 3600000000 /* latency_threshold_us */,
+          0 /* sample_ratio */),
+      "setting tail sampling");
+
+  TRITONSERVER_ResponseAllocator* failing_allocator = nullptr;
+  FAIL_TEST_IF_ERR(
+      TRITONSERVER_ResponseAllocatorNew(
+          &failing_allocator, FailingResponseAlloc,
+          triton::core::test::ResponseRelease, nullptr /* start_fn */),
+      "creating failing response allocator");
+
+  // Traces that only collect timestamps, the responses don't share them
+  TRITONSERVER_InferenceTrace* trace = nullptr;
+  uint64_t succeeded_id = 0;
+  FAIL_TEST_IF_ERR(
+      TRITONSERVER_InferenceTraceCollectedNew(
+          &trace, TRITONSERVER_TRACE_LEVEL_TIMESTAMPS, 0 /* parent_id */,
+          collector),
+      "creating trace");
+  FAIL_TEST_IF_ERR(
+      TRITONSERVER_InferenceTraceId(trace, &succeeded_id), "getting trace id");
+  RequestOptions options;
+  options.trace_ = trace;
+  Inferences succeeded(server_, allocator_, 1);
+  FAIL_TEST_IF_ERR(
+      succeeded.Issue("identity", 0, 0, options), "issuing inference");
+  succeeded.Wait();
+
+  uint64_t failed_id = 0;
+  FAIL_TEST_IF_ERR(
+      TRITONSERVER_InferenceTraceCollectedNew(
+          &trace, TRITONSERVER_TRACE_LEVEL_TIMESTAMPS, 0 /* parent_id */,
+          collector),
+      "creating trace");
+  FAIL_TEST_IF_ERR(
+      TRITONSERVER_InferenceTraceId(trace, &failed_id), "getting trace id");
+  options.trace_ = trace;
+  Inferences failed(server_, failing_allocator, 1);
+  FAIL_TEST_IF_ERR(
+      failed.Issue("identity", 0, 0, options), "issuing inference");
+  failed.Wait();
+
+  // The traces are released with their requests, deleting the collector
+  // delivers the records kept.
+  FAIL_TEST_IF_ERR(
+      TRITONSERVER_InferenceTraceCollectorDelete(collector),
+      "deleting trace collector");
+  FAIL_TEST_IF_ERR(
+      TRITONSERVER_ResponseAllocatorDelete(failing_allocator),
+      "deleting failing response allocator");
+
+  EXPECT_EQ(succeeded.ErrorCount(), 0u);
+  ASSERT_EQ(failed.ErrorCount(), 1u);
+  EXPECT_FALSE(collected.Contains(succeeded_id))
+      << "trace of the successful request is expected to be dropped";
+  EXPECT_TRUE(collected.Contains(failed_id))
+      << "trace of the failed request is expected to be kept";
+}
+
+TEST_F(SchedulerTest, BacklogServedByPriority)
+{
+  Inferences inferences(server_, allocator_, 4);
+
+  // Sequence 1 holds the only slot until it ends.
+  RequestOptions options;
+  options.correlation_id_ = 1;
+  options.flags_ = TRITONSERVER_REQUEST_FLAG_SEQUENCE_START;
+  FAIL_TEST_IF_ERR(
+      inferences.Issue("single_slot_sequence", 0, 0, options),
+      "issuing inference");
+
+  // A low priority sequence is backlogged ahead of a high priority one
+  options.flags_ = TRITONSERVER_REQUEST_FLAG_SEQUENCE_START |
+                   TRITONSERVER_REQUEST_FLAG_SEQUENCE_END;
+  options.correlation_id_ = 2;
+  options.priority_ = 2;
+  FAIL_TEST_IF_ERR(
+      inferences.Issue("single_slot_sequence", 1, 1, options),
+      "issuing inference");
+  options.correlation_id_ = 3;
+  options.priority_ = 1;
+  FAIL_TEST_IF_ERR(
+      inferences.Issue("single_slot_sequence", 2, 2, options),
+      "issuing inference");
+
+  options.correlation_id_ = 1;
+  options.flags_ = TRITONSERVER_REQUEST_FLAG_SEQUENCE_END;
+  options.priority_ = 0;
+  FAIL_TEST_IF_ERR(
+      inferences.Issue("single_slot_sequence", 3, 3, options),
+      "issuing inference");
+  inferences.Wait();
+
+  EXPECT_EQ(inferences.ErrorCount(), 0u);
+  const std::vector<int32_t> expected{0, 3, 2, 1};
+  EXPECT_EQ(inferences.Outputs(), expected);
+}
+
+TEST_F(SchedulerTest, CancelledQueuedRequestNotExecuted)
+{
+  Inferences inferences(server_, allocator_, 3);
+
+  // The first request occupies the instance while the others wait
+  for (size_t idx = 0; idx < 3; ++idx) {
+    FAIL_TEST_IF_ERR(
+        inferences.Issue("slow_single", idx, idx), "issuing inference");
+  }
+  FAIL_TEST_IF_ERR(inferences.Cancel(1), "cancelling inference");
+  inferences.Wait();
+
+  EXPECT_EQ(inferences.ErrorCount(), 1u);
+  const std::vector<int32_t> expected{0, 2};
+  EXPECT_EQ(inferences.Outputs(), expected);
+}
+
+TEST_F(SchedulerTest, CancelledEnsembleStepNotExecuted)
+{
+  Inferences inferences(server_, allocator_, 3);
+
+  // The step request of the ensemble waits behind the first request
+  FAIL_TEST_IF_ERR(
+      inferences.Issue("slow_single", 0, 0), "issuing inference");
+  FAIL_TEST_IF_ERR(
+      inferences.Issue("slow_ensemble", 1, 1), "issuing inference");
+  FAIL_TEST_IF_ERR(
+      inferences.Issue("slow_single", 2, 2), "issuing inference");
+  FAIL_TEST_IF_ERR(inferences.Cancel(1), "cancelling inference");
+  inferences.Wait();
+
+  EXPECT_EQ(inferences.ErrorCount(), 1u);
+  const std::vector<int32_t> expected{0, 2};
+  EXPECT_EQ(inferences.Outputs(), expected);
+}
+
+TEST_F(SchedulerTest, EnsembleStepsBatchedAndSplit)
+{
+  constexpr size_t kCount = 4;
+  Inferences inferences(server_, allocator_, kCount);
+  for (size_t idx = 0; idx < kCount; ++idx) {
+    FAIL_TEST_IF_ERR(
+        inferences.Issue("step_batched_ensemble", idx, idx),
+        "issuing inference");
+  }
+  inferences.Wait();
+
+  // Each request gets back the slice of the batched output for its own
+  // input.
+  EXPECT_EQ(inferences.ErrorCount(), 0u);
+  std::vector<int32_t> outputs = inferences.Outputs();
+  std::sort(outputs.begin(), outputs.end());
+  const std::vector<int32_t> expected{0, 1, 2, 3};
+  EXPECT_EQ(outputs, expected);
+
+  uint64_t execution_count = 0;
+  FAIL_TEST_IF_ERR(
+      GetExecutionCount(server_, "batched_step", &execution_count),
+      "getting model statistics");
+  EXPECT_EQ(execution_count, 1u);
+}
+
+//
+// A server whose queued input budget holds the input of a single
+// request.
+//
+class QueuedInputBudgetTest : public ::testing::Test {
+ protected:
+  static void SetUpTestSuite()
+  {
+    repository_ = new ModelRepository();
+    ASSERT_TRUE(repository_->Create("queued_input_budget_test"));
+    ASSERT_TRUE(repository_->AddModel(
+        "slow_identity",
+        kIdentityIO + "parameters { key: \"execute_delay_us\"\n"
+                      "  value: { string_value: \"100000\" } }\n"));
+    ASSERT_TRUE(repository_->AddModel(
+        "budget_ensemble",
+        "platform: \"ensemble\"\nmax_batch_size: 8\n"
+        "input [{ name: \"INPUT0\" data_type: TYPE_INT32 dims: [ 1 ] }]\n"
+        "output [{ name: \"OUTPUT0\" data_type: TYPE_INT32 dims: [ 1 ] }]\n"
+        "ensemble_scheduling { step [{ model_name: \"slow_identity\"\n"
+        "  model_version: -1\n"
+        "  input_map { key: \"INPUT0\" value: \"INPUT0\" }\n"
+        "  output_map { key: \"OUTPUT0\" value: \"OUTPUT0\" } }] }\n"));
+    ASSERT_TRUE(triton::core::test::StartServer(
+        *repository_, NULL_BACKEND_DIR,
+        [](TRITONSERVER_ServerOptions* options) {
+          return triton::core::test::Check(
+              TRITONSERVER_ServerOptionsSetMaxQueuedInputByteSize(
+                  options, sizeof(int32_t)),
+              "setting queued input budget");
+        },
+        &server_, &allocator_));
+  }
+
+  static void TearDownTestSuite()
+  {
+    if (allocator_ != nullptr) {
+      FAIL_TEST_IF_ERR(
+          TRITONSERVER_ResponseAllocatorDelete(allocator_),
+          "deleting allocator");
+    }
+    if (server_ != nullptr) {
+      FAIL_TEST_IF_ERR(TRITONSERVER_ServerDelete(server_), "deleting server");
+    }
+    delete repository_;
+  }
+
+  void SetUp() override
+  {
+    ASSERT_TRUE(server_ != nullptr) << "server has not been created";
+  }
+
+  static ModelRepository* repository_;
+  static TRITONSERVER_Server* server_;
+  static TRITONSERVER_ResponseAllocator* allocator_;
+};
+
+ModelRepository* QueuedInputBudgetTest::repository_ = nullptr;
+TRITONSERVER_Server* QueuedInputBudgetTest::server_ = nullptr;
+TRITONSERVER_ResponseAllocator* QueuedInputBudgetTest::allocator_ = nullptr;
+
+TEST_F(QueuedInputBudgetTest, EnsembleStepsNotChargedToServer)
+{
+  // The ensemble request takes the whole budget, its step request must
+  // not be charged to the server again.
+  constexpr size_t kCount = 4;
+  Inferences inferences(server_, allocator_, kCount);
+  for (size_t idx = 0; idx < kCount; ++idx) {
+    FAIL_TEST_IF_ERR(
+        inferences.Issue("budget_ensemble", idx, idx), "issuing inference");
+    inferences.Wait();
+  }
+
+  EXPECT_EQ(inferences.ErrorCount(), 0u);
+  ASSERT_EQ(inferences.Outputs().size(), kCount);
+  for (size_t idx = 0; idx < kCount; ++idx) {
+    EXPECT_EQ(inferences.Outputs()[idx], (int32_t)idx);
+  }
+}
+
+TEST_F(QueuedInputBudgetTest, EnsembleRequestChargedToServer)
+{
+  // The first request holds the budget while its step executes, so the
+  // second one doesn't fit.
+  Inferences inferences(server_, allocator_, 2);
+  FAIL_TEST_IF_ERR(
+      inferences.Issue("budget_ensemble", 0, 0), "issuing inference");
+  std::shared_ptr<TRITONSERVER_Error> err(
+      inferences.Issue("budget_ensemble", 1, 1), TRITONSERVER_ErrorDelete);
+  inferences.Wait();
+
+  ASSERT_TRUE(err != nullptr) << "request is expected to exceed the budget";
+  EXPECT_EQ(TRITONSERVER_ErrorCode(err.get()), TRITONSERVER_ERROR_UNAVAILABLE);
+  EXPECT_EQ(inferences.ErrorCount(), 0u);
+  EXPECT_EQ(inferences.Outputs().size(), 1u);
+}
+
+}  // namespace
+
+int
+main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
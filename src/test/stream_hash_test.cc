@@ -0,0 +1,123 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <string>
+#include "stream_hash.h"
+
+namespace tc = triton::core;
+
+namespace {
+
+uint64_t
+HashOneShot(const std::string& data, const uint64_t seed = 0)
+{
+  tc::StreamHash64 hash(seed);
+  hash.Update(data.data(), data.size());
+  return hash.Digest();
+}
+
+// A deterministic test input of 'size' bytes
+std::string
+TestData(const size_t size)
+{
+  std::string data(size, '\0');
+  uint32_t state = 12345;
+  for (auto& c : data) {
+    state = state * 1103515245 + 12345;
+    c = static_cast<char>(state >> 24);
+  }
+  return data;
+}
+
+TEST(StreamHashTest, KnownVectors)
+{
+  // Published XXH64 digests
+  EXPECT_EQ(HashOneShot(""), 0xEF46DB3751D8E999ULL);
+  EXPECT_EQ(HashOneShot("a"), 0xD24EC4F1A98C6E5BULL);
+  EXPECT_EQ(HashOneShot("abc"), 0x44BC2CF5AD770999ULL);
+  EXPECT_EQ(
+      HashOneShot("Nobody inspects the spammish repetition"),
+      0xFBCEA83C8A378BF1ULL);
+}
+
+TEST(StreamHashTest, Deterministic)
+{
+  const std::string data = TestData(1000);
+  EXPECT_EQ(HashOneShot(data), HashOneShot(data));
+  EXPECT_NE(HashOneShot(data), HashOneShot(data, 1 /* seed */));
+  EXPECT_NE(HashOneShot(data), HashOneShot(data.substr(1)));
+}
+
+TEST(StreamHashTest, ChunkedEqualsOneShot)
+{
+  // Cover sizes below, at and above the 32-byte stripe, and chunk sizes
+  // that leave partially filled stripes between calls
+  for (const size_t size : {0, 1, 7, 31, 32, 33, 64, 100, 1000, 4099}) {
+    const std::string data = TestData(size);
+    const uint64_t expected = HashOneShot(data);
+    for (const size_t chunk : {1, 3, 8, 31, 32, 33, 500}) {
+      tc::StreamHash64 hash;
+      for (size_t offset = 0; offset < size; offset += chunk) {
+        hash.Update(data.data() + offset, std::min(chunk, size - offset));
+      }
+      EXPECT_EQ(hash.Digest(), expected)
+          << "size " << size << " in chunks of " << chunk;
+    }
+  }
+}
+
+TEST(StreamHashTest, DigestDoesNotModifyState)
+{
+  const std::string data = TestData(100);
+  tc::StreamHash64 hash;
+  hash.Update(data.data(), 40);
+  hash.Digest();
+  hash.Update(data.data() + 40, data.size() - 40);
+  EXPECT_EQ(hash.Digest(), HashOneShot(data));
+}
+
+TEST(StreamHashTest, StringsAreLengthPrefixed)
+{
+  tc::StreamHash64 first;
+  first.Update(std::string("ab"));
+  first.Update(std::string("c"));
+  tc::StreamHash64 second;
+  second.Update(std::string("a"));
+  second.Update(std::string("bc"));
+  EXPECT_NE(first.Digest(), second.Digest());
+}
+
+}  // namespace
+
+int
+main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
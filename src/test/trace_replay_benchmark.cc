@@ -0,0 +1,431 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// End-to-end benchmark of the in-process C API. A recorded traffic
+// trace is replayed open-loop through TRITONSERVER_ServerInferAsync
+// against models served by the null backend, and the throughput, the
+// latency percentiles and the process CPU time per request are
+// reported.
+//
+//   trace_replay_benchmark --trace <file> [--speed <factor>]
+//
+// The trace has one request per line, lines starting with '#' are
+// ignored:
+//
+//   <arrival_us> <model> <batch_size> <element_count> <priority>
+//       <sequence_id> <flags>
+//
+// 'arrival_us' is the offset of the request from the start of the
+// replay, '--speed' divides all offsets. The INT32 input has shape
+// [batch_size, element_count]. 'sequence_id' 0 is not part of a
+// sequence, 'flags' is '-' or a combination of 'S' (sequence start) and
+// 'E' (sequence end).
+//
+// The models are:
+//   identity          dynamic batching, two priority levels
+//   sleep             as identity, executing for 1ms
+//   identity_sequence direct sequence batching
+//
+// The null backend is looked up in the directory given by the
+// TRITON_NULL_BACKEND_DIR environment variable, which defaults to the
+// directory it is built into.
+
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "benchmark_util.h"
+#include "triton/core/tritonserver.h"
+
+namespace {
+
+using triton::core::test::Check;
+using triton::core::test::LatencySamples;
+using triton::core::test::ModelRepository;
+using triton::core::test::NowNs;
+using triton::core::test::StartServer;
+
+TRITONSERVER_Server* server = nullptr;
+TRITONSERVER_ResponseAllocator* allocator = nullptr;
+
+// The CPU time consumed by all threads of the process
+uint64_t
+ProcessCpuNs()
+{
+  struct timespec ts;
+  if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0) {
+    return 0;
+  }
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+struct TraceEntry {
+  uint64_t arrival_ns_;
+  std::string model_name_;
+  int64_t batch_size_;
+  int64_t element_count_;
+  uint32_t priority_;
+  uint64_t sequence_id_;
+  uint32_t flags_;
+};
+
+// Load the trace in 'path', scaling the arrival offsets by 1 / 'speed'.
+// Return false if the trace can't be read.
+bool
+LoadTrace(
+    const std::string& path, const double speed,
+    std::vector<TraceEntry>* trace)
+{
+  std::ifstream in(path);
+  if (!in) {
+    std::cerr << "error: failed to open trace '" << path << "'" << std::endl;
+    return false;
+  }
+
+  std::string line;
+  size_t line_number = 0;
+  while (std::getline(in, line)) {
+    ++line_number;
+    if (line.empty() || (line[0] == '#')) {
+      continue;
+    }
+    std::istringstream fields(line);
+    TraceEntry entry;
+    double arrival_us = 0;
+    std::string flags;
+    fields >> arrival_us >> entry.model_name_ >> entry.batch_size_ >>
+        entry.element_count_ >> entry.priority_ >> entry.sequence_id_ >>
+        flags;
+    if (!fields || (entry.batch_size_ <= 0) || (entry.element_count_ <= 0)) {
+      std::cerr << "error: invalid trace entry at " << path << ":"
+                << line_number << std::endl;
+      return false;
+    }
+    entry.arrival_ns_ = (uint64_t)(arrival_us * 1000 / speed);
+    entry.flags_ = 0;
+    if (flags.find('S') != std::string::npos) {
+      entry.flags_ |= TRITONSERVER_REQUEST_FLAG_SEQUENCE_START;
+    }
+    if (flags.find('E') != std::string::npos) {
+      entry.flags_ |= TRITONSERVER_REQUEST_FLAG_SEQUENCE_END;
+    }
+    trace->emplace_back(std::move(entry));
+  }
+
+  // Requests are issued in arrival order
+  std::stable_sort(
+      trace->begin(), trace->end(),
+      [](const TraceEntry& a, const TraceEntry& b) {
+        return a.arrival_ns_ < b.arrival_ns_;
+      });
+  return true;
+}
+
+// Add the models of the trace to 'repository'. Return false on error.
+bool
+AddModels(ModelRepository* repository)
+{
+  const std::string io =
+      "backend: \"null\"\nmax_batch_size: 64\n"
+      "input [{ name: \"INPUT0\" data_type: TYPE_INT32 dims: [ -1 ] }]\n"
+      "output [{ name: \"OUTPUT0\" data_type: TYPE_INT32 dims: [ -1 ] }]\n"
+      "instance_group [{ count: 1 kind: KIND_CPU }]\n";
+  const std::string dynamic_batching =
+      "dynamic_batching { priority_levels: 2 default_priority_level: 2 }\n";
+  return repository->AddModel("identity", io + dynamic_batching) &&
+         repository->AddModel(
+             "sleep", io + dynamic_batching +
+                          "parameters { key: \"execute_delay_us\"\n"
+                          "  value: { string_value: \"1000\" } }\n") &&
+         repository->AddModel(
+             "identity_sequence", io + "sequence_batching { direct {} }\n");
+}
+
+//
+// The outcome of the replay, updated from the response callbacks
+//
+class Replay {
+ public:
+  explicit Replay(const std::vector<TraceEntry>& trace)
+      : trace_(trace), latencies_ns_(trace.size(), 0),
+        success_(trace.size(), 0)
+  {
+  }
+
+  // Issue all requests of the trace at their arrival offsets, and wait
+  // for them to complete. Return false if a request could not be
+  // issued.
+  bool Run()
+  {
+    start_ns_ = NowNs();
+    start_cpu_ns_ = ProcessCpuNs();
+    pending_ = trace_.size();
+    size_t issued = 0;
+    for (; issued < trace_.size(); ++issued) {
+      const uint64_t arrival_ns = start_ns_ + trace_[issued].arrival_ns_;
+      const uint64_t now_ns = NowNs();
+      if (arrival_ns > now_ns) {
+        std::this_thread::sleep_for(
+            std::chrono::nanoseconds(arrival_ns - now_ns));
+      }
+      if (!Issue(issued)) {
+        break;
+      }
+    }
+
+    std::unique_lock<std::mutex> lk(mu_);
+    pending_ -= (trace_.size() - issued);
+    cv_.wait(lk, [this] { return pending_ == 0; });
+    end_ns_ = NowNs();
+    end_cpu_ns_ = ProcessCpuNs();
+    return issued == trace_.size();
+  }
+
+  void Report() const
+  {
+    LatencySamples latencies;
+    for (size_t idx = 0; idx < trace_.size(); ++idx) {
+      if (success_[idx]) {
+        latencies.Add(latencies_ns_[idx]);
+      }
+    }
+    const double duration_s = (end_ns_ - start_ns_) / 1e9;
+    const auto percentile_us = [&latencies](const size_t p) {
+      return latencies.Percentile(p) / 1e3;
+    };
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "requests:           " << trace_.size() << "\n"
+              << "failed:             " << (trace_.size() - latencies.Size())
+              << "\n"
+              << "duration (s):       " << std::setprecision(3) << duration_s
+              << "\n"
+              << std::setprecision(1)
+              << "throughput (req/s): "
+              << ((duration_s > 0) ? latencies.Size() / duration_s : 0.0)
+              << "\n"
+              << "latency p50 (us):   " << percentile_us(50) << "\n"
+              << "latency p90 (us):   " << percentile_us(90) << "\n"
+              << "latency p99 (us):   " << percentile_us(99) << "\n"
+              << "latency max (us):   " << percentile_us(100) << "\n"
+              << "cpu per request (us): "
+              << (trace_.empty() ? 0.0
+                                 : (end_cpu_ns_ - start_cpu_ns_) / 1e3 /
+                                       trace_.size())
+              << std::endl;
+  }
+
+ private:
+  // The state of one request in flight
+  struct Request {
+    Replay* replay_;
+    size_t index_;
+    uint64_t issue_ns_;
+    std::vector<int32_t> input_;
+  };
+
+  bool Issue(const size_t index)
+  {
+    const TraceEntry& entry = trace_[index];
+    std::unique_ptr<Request> context(new Request{
+        this, index, 0,
+        std::vector<int32_t>(entry.batch_size_ * entry.element_count_, 0)});
+    const int64_t shape[] = {entry.batch_size_, entry.element_count_};
+    TRITONSERVER_InferenceRequest* request = nullptr;
+    bool valid =
+        Check(
+            TRITONSERVER_InferenceRequestNew(
+                &request, server, entry.model_name_.c_str(),
+                -1 /* model_version */),
+            "creating request") &&
+        Check(
+            TRITONSERVER_InferenceRequestAddInput(
+                request, "INPUT0", TRITONSERVER_TYPE_INT32, shape, 2),
+            "adding input") &&
+        Check(
+            TRITONSERVER_InferenceRequestAppendInputData(
+                request, "INPUT0", context->input_.data(),
+                context->input_.size() * sizeof(int32_t),
+                TRITONSERVER_MEMORY_CPU, 0),
+            "appending input data") &&
+        Check(
+            TRITONSERVER_InferenceRequestAddRequestedOutput(
+                request, "OUTPUT0"),
+            "adding requested output") &&
+        Check(
+            TRITONSERVER_InferenceRequestSetPriority(request, entry.priority_),
+            "setting priority") &&
+        Check(
+            TRITONSERVER_InferenceRequestSetCorrelationId(
+                request, entry.sequence_id_),
+            "setting correlation id") &&
+        Check(
+            TRITONSERVER_InferenceRequestSetFlags(request, entry.flags_),
+            "setting flags") &&
+        Check(
+            TRITONSERVER_InferenceRequestSetReleaseCallback(
+                request, RequestRelease, nullptr),
+            "setting release callback") &&
+        Check(
+            TRITONSERVER_InferenceRequestSetResponseCallback(
+                request, allocator, nullptr, ResponseComplete, context.get()),
+            "setting response callback");
+    if (valid) {
+      context->issue_ns_ = NowNs();
+      valid = Check(
+          TRITONSERVER_ServerInferAsync(server, request, nullptr),
+          "running inference");
+      if (valid) {
+        // Owned by the response callback from here on
+        context.release();
+        return true;
+      }
+    }
+    if (request != nullptr) {
+      Check(TRITONSERVER_InferenceRequestDelete(request), "deleting request");
+    }
+    return false;
+  }
+
+  static void RequestRelease(
+      TRITONSERVER_InferenceRequest* request, const uint32_t flags,
+      void* userp)
+  {
+    Check(TRITONSERVER_InferenceRequestDelete(request), "deleting request");
+  }
+
+  static void ResponseComplete(
+      TRITONSERVER_InferenceResponse* response, const uint32_t flags,
+      void* userp)
+  {
+    Request* context = reinterpret_cast<Request*>(userp);
+    Replay* replay = context->replay_;
+    bool success = true;
+    if (response != nullptr) {
+      success = Check(
+          TRITONSERVER_InferenceResponseError(response), "inference response");
+      Check(
+          TRITONSERVER_InferenceResponseDelete(response), "deleting response");
+    }
+    if ((flags & TRITONSERVER_RESPONSE_COMPLETE_FINAL) != 0) {
+      // Each request has its own slots, only the counter is shared
+      replay->latencies_ns_[context->index_] = NowNs() - context->issue_ns_;
+      replay->success_[context->index_] = success;
+      delete context;
+      std::lock_guard<std::mutex> lk(replay->mu_);
+      if (--replay->pending_ == 0) {
+        replay->cv_.notify_all();
+      }
+    }
+  }
+
+  const std::vector<TraceEntry>& trace_;
+  std::vector<uint64_t> latencies_ns_;
+  std::vector<uint8_t> success_;
+  uint64_t start_ns_ = 0;
+  uint64_t end_ns_ = 0;
+  uint64_t start_cpu_ns_ = 0;
+  uint64_t end_cpu_ns_ = 0;
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  size_t pending_ = 0;
+};
+
+void
+Usage(const char* program)
+{
+  std::cerr << "usage: " << program << " --trace <file> [--speed <factor>]"
+            << std::endl;
+}
+
+}  // namespace
+
+int
+main(int argc, char** argv)
+{
+  std::string trace_path;
+  double speed = 1.0;
+  for (int idx = 1; idx < argc; ++idx) {
+    const std::string arg = argv[idx];
+    if ((arg == "--trace") && ((idx + 1) < argc)) {
+      trace_path = argv[++idx];
+    } else if ((arg == "--speed") && ((idx + 1) < argc)) {
+      speed = std::atof(argv[++idx]);
+    } else {
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+  if (trace_path.empty() || (speed <= 0)) {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  std::vector<TraceEntry> trace;
+  if (!LoadTrace(trace_path, speed, &trace)) {
+    return 1;
+  }
+
+  ModelRepository repository;
+  if (!repository.Create("trace_replay_benchmark") ||
+      !AddModels(&repository)) {
+    std::cerr << "error: failed to create the model repository" << std::endl;
+    return 1;
+  }
+  if (!StartServer(
+          repository, NULL_BACKEND_DIR,
+          [](TRITONSERVER_ServerOptions*) { return true; }, &server,
+          &allocator)) {
+    return 1;
+  }
+
+  int ret = 0;
+  {
+    Replay replay(trace);
+    if (!replay.Run()) {
+      ret = 1;
+    }
+    replay.Report();
+  }
+
+  Check(TRITONSERVER_ResponseAllocatorDelete(allocator), "deleting allocator");
+  Check(TRITONSERVER_ServerDelete(server), "deleting server");
+  return ret;
+}
@@ -0,0 +1,162 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifdef TRITON_ENABLE_TRACING
+
+#include "trace_collector.h"
+
+#include <random>
+#include <unordered_map>
+
+namespace triton { namespace core {
+
+namespace {
+
+// Identifies a collector in the thread rings, an address could be
+// reused by a later collector.
+std::atomic<uint64_t> next_collector_id{1};
+
+// The largest number of records delivered in one batch callback
+constexpr size_t kMaxBatchSize = 4096;
+
+}  // namespace
+
+TraceCollector::TraceCollector(
+    size_t ring_capacity, uint64_t flush_interval_ms,
+    TRITONSERVER_InferenceTraceBatchFn_t batch_fn, void* userp)
+    : id_(next_collector_id.fetch_add(1)), ring_capacity_(ring_capacity),
+      flush_interval_(flush_interval_ms), batch_fn_(batch_fn), userp_(userp),
+      dropped_count_(0), tail_sampling_(false), latency_threshold_ns_(0),
+      sample_ratio_(1.0), exit_(false)
+{
+  batch_.reserve(kMaxBatchSize);
+  drain_thread_ = std::thread([this]() { DrainThread(); });
+}
+
+TraceCollector::~TraceCollector()
+{
+  {
+    std::lock_guard<std::mutex> lk(exit_mtx_);
+    exit_ = true;
+  }
+  exit_cv_.notify_one();
+  drain_thread_.join();
+  Drain();
+}
+
+TraceCollector::Ring*
+TraceCollector::LocalRing()
+{
+  // The ring is shared with the collector so that the records of a
+  // thread that exits are still delivered.
+  thread_local std::unordered_map<uint64_t, std::shared_ptr<Ring>> rings;
+  auto it = rings.find(id_);
+  if (it == rings.end()) {
+    std::shared_ptr<Ring> ring(new Ring(ring_capacity_));
+    {
+      std::lock_guard<std::mutex> lk(rings_mtx_);
+      rings_.push_back(ring);
+    }
+    it = rings.emplace(id_, std::move(ring)).first;
+  }
+  return it->second.get();
+}
+
+void
+TraceCollector::Record(const TRITONSERVER_InferenceTraceRecord& record)
+{
+  TRITONSERVER_InferenceTraceRecord lrecord = record;
+  if (!LocalRing()->TryPush(lrecord)) {
+    dropped_count_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void
+TraceCollector::SetTailSampling(
+    uint64_t latency_threshold_ns, double sample_ratio)
+{
+  tail_sampling_ = true;
+  latency_threshold_ns_ = latency_threshold_ns;
+  sample_ratio_ = sample_ratio;
+}
+
+bool
+TraceCollector::KeepTrace(bool failed, uint64_t duration_ns) const
+{
+  if (failed || (duration_ns >= latency_threshold_ns_)) {
+    return true;
+  }
+  thread_local std::minstd_rand rng(std::random_device{}());
+  return std::uniform_real_distribution<double>(0.0, 1.0)(rng) < sample_ratio_;
+}
+
+const char*
+TraceCollector::InternName(const std::string& name)
+{
+  std::lock_guard<std::mutex> lk(names_mtx_);
+  return names_.insert(name).first->c_str();
+}
+
+void
+TraceCollector::DrainThread()
+{
+  std::unique_lock<std::mutex> lk(exit_mtx_);
+  while (!exit_) {
+    exit_cv_.wait_for(lk, flush_interval_, [this]() { return exit_; });
+    lk.unlock();
+    Drain();
+    lk.lock();
+  }
+}
+
+void
+TraceCollector::Drain()
+{
+  std::vector<std::shared_ptr<Ring>> rings;
+  {
+    std::lock_guard<std::mutex> lk(rings_mtx_);
+    rings = rings_;
+  }
+
+  TRITONSERVER_InferenceTraceRecord record;
+  for (const auto& ring : rings) {
+    while (ring->TryPop(&record)) {
+      batch_.push_back(record);
+      if (batch_.size() == kMaxBatchSize) {
+        batch_fn_(batch_.data(), batch_.size(), userp_);
+        batch_.clear();
+      }
+    }
+  }
+  if (!batch_.empty()) {
+    batch_fn_(batch_.data(), batch_.size(), userp_);
+    batch_.clear();
+  }
+}
+
+}}  // namespace triton::core
+
+#endif  // TRITON_ENABLE_TRACING
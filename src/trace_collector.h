@@ -0,0 +1,123 @@
+// Copyright 2023, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#ifdef TRITON_ENABLE_TRACING
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mpsc_ring.h"
+#include "tritonserver_apis.h"
+
+namespace triton { namespace core {
+
+//
+// Collector of the activity records of the traces created with it. A
+// record is pushed into a ring buffer owned by the reporting thread, so
+// reporting doesn't call into the user or take a lock. A background
+// thread drains the rings and delivers the records to the batch
+// callback in batches. Records that don't fit into a full ring are
+// dropped and counted.
+//
+class TraceCollector {
+ public:
+  // Create a collector whose rings hold 'ring_capacity' records each
+  // and which delivers the records every 'flush_interval_ms'.
+  TraceCollector(
+      size_t ring_capacity, uint64_t flush_interval_ms,
+      TRITONSERVER_InferenceTraceBatchFn_t batch_fn, void* userp);
+  // Deliver the remaining records and stop the background thread.
+  ~TraceCollector();
+
+  TraceCollector(const TraceCollector&) = delete;
+  TraceCollector& operator=(const TraceCollector&) = delete;
+
+  void Record(const TRITONSERVER_InferenceTraceRecord& record);
+
+  // Keep the records of a trace only if it failed, took at least
+  // 'latency_threshold_ns' or is picked with probability
+  // 'sample_ratio'. The traces then buffer their records until they
+  // are released. Must be set before any trace is created.
+  void SetTailSampling(uint64_t latency_threshold_ns, double sample_ratio);
+  bool TailSampling() const { return tail_sampling_; }
+  // Whether to keep the records of a released trace
+  bool KeepTrace(bool failed, uint64_t duration_ns) const;
+
+  // Return a copy of 'name' that lives as long as the collector, for
+  // the records to refer to.
+  const char* InternName(const std::string& name);
+
+  // The number of records dropped because the ring was full
+  uint64_t DroppedCount() const { return dropped_count_.load(); }
+
+ private:
+  using Ring = MPSCRing<TRITONSERVER_InferenceTraceRecord>;
+
+  // Return the ring of the calling thread, creating it on first use
+  Ring* LocalRing();
+  void DrainThread();
+  // Deliver the records in all rings
+  void Drain();
+
+  const uint64_t id_;
+  const size_t ring_capacity_;
+  const std::chrono::milliseconds flush_interval_;
+  TRITONSERVER_InferenceTraceBatchFn_t batch_fn_;
+  void* userp_;
+
+  std::atomic<uint64_t> dropped_count_;
+
+  bool tail_sampling_;
+  uint64_t latency_threshold_ns_;
+  double sample_ratio_;
+
+  // Guards 'rings_', the rings are only popped by the drain thread
+  std::mutex rings_mtx_;
+  std::vector<std::shared_ptr<Ring>> rings_;
+
+  std::mutex names_mtx_;
+  std::set<std::string> names_;
+
+  std::vector<TRITONSERVER_InferenceTraceRecord> batch_;
+
+  std::mutex exit_mtx_;
+  std::condition_variable exit_cv_;
+  bool exit_;
+  std::thread drain_thread_;
+};
+
+}}  // namespace triton::core
+
+#endif  // TRITON_ENABLE_TRACING
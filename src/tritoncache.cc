@@ -97,6 +97,38 @@ TRITONCACHE_CacheEntryBufferCount(TRITONCACHE_CacheEntry* entry, size_t* count)
   return nullptr;  // success
 }
 
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONCACHE_CacheEntryByteSize(TRITONCACHE_CacheEntry* entry, size_t* byte_size)
+{
+  if (!entry || !byte_size) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG, "entry or byte_size was nullptr");
+  }
+
+  const auto lentry = reinterpret_cast<CacheEntry*>(entry);
+  size_t total = 0;
+  for (const auto& buffer : lentry->Buffers()) {
+    total += buffer.second;
+  }
+  *byte_size = total;
+  return nullptr;  // success
+}
+
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONCACHE_CacheEntryComputeCost(
+    TRITONCACHE_CacheEntry* entry, uint64_t* compute_cost_ns)
+{
+  if (!entry || !compute_cost_ns) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        "entry or compute_cost_ns was nullptr");
+  }
+
+  const auto lentry = reinterpret_cast<CacheEntry*>(entry);
+  *compute_cost_ns = lentry->ComputeCostNs();
+  return nullptr;  // success
+}
+
 // Adds buffer to entry
 TRITONAPI_DECLSPEC TRITONSERVER_Error*
 TRITONCACHE_CacheEntryAddBuffer(
@@ -133,6 +165,47 @@ TRITONCACHE_CacheEntryAddBuffer(
   return nullptr;  // success
 }
 
+// Adds buffer to entry that is released through a callback once Triton
+// no longer references it
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONCACHE_CacheEntryAddSharedBuffer(
+    TRITONCACHE_CacheEntry* entry, void* base,
+    TRITONSERVER_BufferAttributes* attrs,
+    TRITONCACHE_BufferReleaseFn_t release_fn, void* release_userp)
+{
+  if (!entry || !base || !attrs || !release_fn) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        "entry, base, attrs, or release_fn was nullptr");
+  }
+
+  size_t byte_size = 0;
+  TRITONSERVER_BufferAttributesByteSize(attrs, &byte_size);
+  if (!byte_size) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG, "Buffer byte size was zero");
+  }
+
+  TRITONSERVER_MemoryType memory_type;
+  TRITONSERVER_BufferAttributesMemoryType(attrs, &memory_type);
+  // DLIS-2673: Add better memory_type support
+  if (memory_type != TRITONSERVER_MEMORY_CPU &&
+      memory_type != TRITONSERVER_MEMORY_CPU_PINNED) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        "Only buffers in CPU memory are allowed in cache currently");
+  }
+
+  // The last of the entry and any response borrowing the buffer to drop
+  // its reference hands the buffer back to the cache.
+  std::shared_ptr<void> owner(base, [release_fn, release_userp](void* b) {
+    release_fn(b, release_userp);
+  });
+  const auto lentry = reinterpret_cast<CacheEntry*>(entry);
+  lentry->AddSharedBuffer(base, byte_size, std::move(owner));
+  return nullptr;  // success
+}
+
 // Gets buffer at index from entry
 TRITONAPI_DECLSPEC TRITONSERVER_Error*
 TRITONCACHE_CacheEntryGetBuffer(
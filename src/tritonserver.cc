@@ -29,20 +29,25 @@
 
 #include "buffer_attributes.h"
 #include "cuda_utils.h"
+#include "host_memory_registry.h"
 #include "infer_parameter.h"
 #include "infer_request.h"
 #include "infer_response.h"
 #include "infer_stats.h"
+#include "json_writer.h"
 #include "metric_family.h"
 #include "metrics.h"
 #include "model.h"
 #include "model_config_utils.h"
 #include "model_repository_manager.h"
+#include "profiling.h"
 #include "rate_limiter.h"
 #include "response_allocator.h"
+#include "response_batch.h"
 #include "server.h"
 #include "server_message.h"
 #include "status.h"
+#include "trace_collector.h"
 #include "triton/common/logging.h"
 #include "triton/common/model_config.h"
 #include "triton/common/nvtx.h"
@@ -89,6 +94,10 @@ RateLimitModeToString(const tc::RateLimitMode rate_limit_mode)
       rl_mode_str = "OFF";
       break;
     }
+    case tc::RateLimitMode::RL_GPU_TIME: {
+      rl_mode_str = "GPU_TIME";
+      break;
+    }
   }
   return rl_mode_str;
 }
@@ -233,6 +242,14 @@ class TritonServerOptions {
 
   uint64_t PinnedMemoryPoolByteSize() const { return pinned_memory_pool_size_; }
   void SetPinnedMemoryPoolByteSize(uint64_t s) { pinned_memory_pool_size_ = s; }
+  uint64_t PinnedMemoryPoolMaxByteSize() const
+  {
+    return pinned_memory_pool_max_size_;
+  }
+  void SetPinnedMemoryPoolMaxByteSize(uint64_t s)
+  {
+    pinned_memory_pool_max_size_ = s;
+  }
 
   const std::map<int, uint64_t>& CudaMemoryPoolByteSize() const
   {
@@ -243,6 +260,21 @@ class TritonServerOptions {
     cuda_memory_pool_size_[id] = s;
   }
 
+  bool CudaMemoryPoolAsync() const { return cuda_memory_pool_async_; }
+  void SetCudaMemoryPoolAsync(bool b) { cuda_memory_pool_async_ = b; }
+
+  const std::map<int, uint64_t>& CudaMemoryPoolReleaseThreshold() const
+  {
+    return cuda_memory_pool_release_threshold_;
+  }
+  void SetCudaMemoryPoolReleaseThreshold(int id, uint64_t s)
+  {
+    cuda_memory_pool_release_threshold_[id] = s;
+  }
+
+  bool CudaMemoryPoolGrowth() const { return cuda_memory_pool_growth_; }
+  void SetCudaMemoryPoolGrowth(bool b) { cuda_memory_pool_growth_ = b; }
+
   double MinSupportedComputeCapability() const
   {
     return min_compute_capability_;
@@ -270,6 +302,31 @@ class TritonServerOptions {
   unsigned int ModelLoadThreadCount() const { return model_load_thread_count_; }
   void SetModelLoadThreadCount(unsigned int c) { model_load_thread_count_ = c; }
 
+  bool ModelLoadOnDemand() const { return model_load_on_demand_; }
+  void SetModelLoadOnDemand(bool e) { model_load_on_demand_ = e; }
+  uint64_t ModelIdleUnloadTimeout() const
+  {
+    return model_idle_unload_timeout_sec_;
+  }
+  uint64_t ModelLoadOnDemandByteSize() const
+  {
+    return model_load_on_demand_byte_size_;
+  }
+  void SetModelIdleUnload(uint64_t timeout_sec, uint64_t byte_size_budget)
+  {
+    model_idle_unload_timeout_sec_ = timeout_sec;
+    model_load_on_demand_byte_size_ = byte_size_budget;
+  }
+
+  uint64_t MaxQueuedInputByteSize() const
+  {
+    return max_queued_input_byte_size_;
+  }
+  void SetMaxQueuedInputByteSize(uint64_t b)
+  {
+    max_queued_input_byte_size_ = b;
+  }
+
   bool ModelNamespacingEnabled() { return enable_model_namespacing_; }
   void SetModelNamespacingEnabled(const bool e)
   {
@@ -344,10 +401,18 @@ class TritonServerOptions {
   uint64_t metrics_interval_;
   unsigned int exit_timeout_;
   uint64_t pinned_memory_pool_size_;
+  uint64_t pinned_memory_pool_max_size_;
   unsigned int buffer_manager_thread_count_;
   unsigned int model_load_thread_count_;
+  bool model_load_on_demand_;
+  uint64_t model_idle_unload_timeout_sec_;
+  uint64_t model_load_on_demand_byte_size_;
+  uint64_t max_queued_input_byte_size_;
   bool enable_model_namespacing_;
   std::map<int, uint64_t> cuda_memory_pool_size_;
+  bool cuda_memory_pool_async_;
+  std::map<int, uint64_t> cuda_memory_pool_release_threshold_;
+  bool cuda_memory_pool_growth_;
   double min_compute_capability_;
   std::string backend_dir_;
   std::string repoagent_dir_;
@@ -367,8 +432,11 @@ TritonServerOptions::TritonServerOptions()
       rate_limit_mode_(tc::RateLimitMode::RL_OFF), metrics_(true),
       gpu_metrics_(true), cpu_metrics_(true), metrics_interval_(2000),
       exit_timeout_(30), pinned_memory_pool_size_(1 << 28),
-      buffer_manager_thread_count_(0), model_load_thread_count_(4),
-      enable_model_namespacing_(false),
+      pinned_memory_pool_max_size_(0), buffer_manager_thread_count_(0),
+      model_load_thread_count_(4), model_load_on_demand_(false),
+      model_idle_unload_timeout_sec_(0), model_load_on_demand_byte_size_(0),
+      max_queued_input_byte_size_(0), enable_model_namespacing_(false),
+      cuda_memory_pool_async_(false), cuda_memory_pool_growth_(true),
 #ifdef TRITON_ENABLE_GPU
       min_compute_capability_(TRITON_MIN_COMPUTE_CAPABILITY),
 #else
@@ -454,12 +522,14 @@ TritonServerOptions::SetHostPolicy(
     const std::string& value)
 {
   // Check if supported setting is passed
-  if ((setting != "numa-node") && (setting != "cpu-cores")) {
+  if ((setting != "numa-node") && (setting != "cpu-cores") &&
+      (setting != "batcher-cpu-cores")) {
     return TRITONSERVER_ErrorNew(
         TRITONSERVER_ERROR_UNSUPPORTED,
         std::string(
             "Unsupported host policy setting '" + setting +
-            "' is specified, supported settings are 'numa-node', 'cpu-cores'")
+            "' is specified, supported settings are 'numa-node', "
+            "'cpu-cores', 'batcher-cpu-cores'")
             .c_str());
   }
 
@@ -469,14 +539,175 @@ TritonServerOptions::SetHostPolicy(
   return nullptr;  // success
 }
 
-#define SetDurationStat(DOC, PARENT, STAT_NAME, COUNT, NS)   \
-  do {                                                       \
-    triton::common::TritonJson::Value dstat(                 \
-        DOC, triton::common::TritonJson::ValueType::OBJECT); \
-    dstat.AddUInt("count", (COUNT));                         \
-    dstat.AddUInt("ns", (NS));                               \
-    PARENT.Add(STAT_NAME, std::move(dstat));                 \
-  } while (false)
+//
+// TritonServerModelHandle
+//
+// Implementation for TRITONSERVER_ModelHandle.
+//
+class TritonServerModelHandle {
+ public:
+  TritonServerModelHandle(
+      const std::shared_ptr<tc::Model>& model, const int64_t model_version)
+      : model_(model), model_version_(model_version)
+  {
+  }
+
+  const std::shared_ptr<tc::Model>& Model() const { return model_; }
+  int64_t RequestedModelVersion() const { return model_version_; }
+
+ private:
+  const std::shared_ptr<tc::Model> model_;
+  const int64_t model_version_;
+};
+
+#ifdef TRITON_ENABLE_STATS
+// Write the {"count", "ns"} object of a duration statistic as the
+// 'stat_name' member of the current object.
+void
+WriteDurationStat(
+    tc::JsonWriter* writer, const char* stat_name, const uint64_t count,
+    const uint64_t ns)
+{
+  writer->Key(stat_name);
+  writer->BeginObject();
+  writer->Key("count");
+  writer->UInt(count);
+  writer->Key("ns");
+  writer->UInt(ns);
+  writer->EndObject();
+}
+
+// Serialize the statistics of 'model' into 'json'. The statistics are
+// written to 'json' directly instead of building a document first.
+TRITONSERVER_Error*
+SerializeModelStatistics(
+    const tc::Model& model, const std::string& model_name,
+    const int64_t model_version, std::string* json)
+{
+  json->clear();
+  tc::JsonWriter writer(json);
+  writer.BeginObject();
+
+  writer.Key("name");
+  writer.String(model_name);
+  writer.Key("version");
+  writer.String(std::to_string(model_version));
+
+  writer.Key("last_inference");
+  writer.UInt(model.StatsAggregator().LastInferenceMs());
+  writer.Key("inference_count");
+  writer.UInt(model.StatsAggregator().InferenceCount());
+  writer.Key("execution_count");
+  writer.UInt(model.StatsAggregator().ExecutionCount());
+
+  // Add infer statistic
+  const auto& infer_stats = model.StatsAggregator().ImmutableInferStats();
+  const auto& infer_batch_stats =
+      model.StatsAggregator().ImmutableInferBatchStats();
+
+  // Compute figures only calculated when not going through cache, so
+  // subtract cache_hit count from success count. Cache hit count will
+  // simply be 0 when cache is disabled.
+  uint64_t compute_count =
+      infer_stats.success_count_ - infer_stats.cache_hit_count_;
+  writer.Key("inference_stats");
+  writer.BeginObject();
+  WriteDurationStat(
+      &writer, "success", infer_stats.success_count_,
+      infer_stats.request_duration_ns_);
+  WriteDurationStat(
+      &writer, "fail", infer_stats.failure_count_,
+      infer_stats.failure_duration_ns_);
+  WriteDurationStat(
+      &writer, "queue", infer_stats.success_count_,
+      infer_stats.queue_duration_ns_);
+  WriteDurationStat(
+      &writer, "compute_input", compute_count,
+      infer_stats.compute_input_duration_ns_);
+  WriteDurationStat(
+      &writer, "compute_infer", compute_count,
+      infer_stats.compute_infer_duration_ns_);
+  WriteDurationStat(
+      &writer, "compute_output", compute_count,
+      infer_stats.compute_output_duration_ns_);
+  WriteDurationStat(
+      &writer, "cache_hit", infer_stats.cache_hit_count_,
+      infer_stats.cache_hit_duration_ns_);
+  // NOTE: cache_miss_count_ should equal compute_count if non-zero
+  WriteDurationStat(
+      &writer, "cache_miss", infer_stats.cache_miss_count_,
+      infer_stats.cache_miss_duration_ns_);
+  writer.EndObject();
+
+  writer.Key("batch_stats");
+  writer.BeginArray();
+  for (const auto& batch : infer_batch_stats) {
+    writer.BeginObject();
+    writer.Key("batch_size");
+    writer.UInt(batch.first);
+    WriteDurationStat(
+        &writer, "compute_input", batch.second.count_,
+        batch.second.compute_input_duration_ns_);
+    WriteDurationStat(
+        &writer, "compute_infer", batch.second.count_,
+        batch.second.compute_infer_duration_ns_);
+    WriteDurationStat(
+        &writer, "compute_output", batch.second.count_,
+        batch.second.compute_output_duration_ns_);
+    writer.EndObject();
+  }
+  writer.EndArray();
+
+  // Per-step statistics are only collected by ensembles
+  const auto& ensemble_step_stats =
+      model.StatsAggregator().ImmutableEnsembleStepStats();
+  if (!ensemble_step_stats.empty()) {
+    const auto& ensemble_steps = model.Config().ensemble_scheduling().step();
+    writer.Key("ensemble_step_stats");
+    writer.BeginArray();
+    for (const auto& step : ensemble_step_stats) {
+      writer.BeginObject();
+      writer.Key("step");
+      writer.UInt(step.first);
+      if (step.first < (size_t)ensemble_steps.size()) {
+        writer.Key("model");
+        writer.String(ensemble_steps[step.first].model_name());
+      }
+      WriteDurationStat(
+          &writer, "wait", step.second.execution_count_,
+          step.second.wait_duration_ns_);
+      WriteDurationStat(
+          &writer, "execution", step.second.execution_count_,
+          step.second.execution_duration_ns_);
+      WriteDurationStat(
+          &writer, "critical_path", step.second.critical_path_count_,
+          step.second.critical_path_duration_ns_);
+      writer.EndObject();
+    }
+    writer.EndArray();
+  }
+
+  // Add memory usage
+  writer.Key("memory_usage");
+  writer.BeginArray();
+  const std::vector<tc::BufferAttributes>& usages =
+      model.AccumulatedMemoryUsage();
+  for (const auto& usage : usages) {
+    writer.BeginObject();
+    writer.Key("type");
+    writer.String(TRITONSERVER_MemoryTypeString(usage.MemoryType()));
+    writer.Key("id");
+    writer.Int(usage.MemoryTypeId());
+    writer.Key("byte_size");
+    writer.UInt(usage.ByteSize());
+    writer.EndObject();
+  }
+  writer.EndArray();
+
+  writer.EndObject();
+  return nullptr;  // success
+}
+#endif  // TRITON_ENABLE_STATS
 
 }  // namespace
 
@@ -720,6 +951,13 @@ TRITONSERVER_LogMessage(
   }
 }
 
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONSERVER_ProfilingSetEnabled(bool enabled)
+{
+  tc::SetProfilingEnabled(enabled);
+  return nullptr;  // Success
+}
+
 //
 // TRITONSERVER_Error
 //
@@ -793,6 +1031,23 @@ TRITONSERVER_ResponseAllocatorSetBufferAttributesFunction(
   return nullptr;  // success
 }
 
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONSERVER_ResponseAllocatorSetBorrowBuffers(
+    TRITONSERVER_ResponseAllocator* allocator, bool enable)
+{
+  reinterpret_cast<tc::ResponseAllocator*>(allocator)->SetBorrowBuffers(
+      enable);
+  return nullptr;  // success
+}
+
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONSERVER_ResponseAllocatorSetQueryStable(
+    TRITONSERVER_ResponseAllocator* allocator, bool stable)
+{
+  reinterpret_cast<tc::ResponseAllocator*>(allocator)->SetQueryStable(stable);
+  return nullptr;  // success
+}
+
 TRITONAPI_DECLSPEC TRITONSERVER_Error*
 TRITONSERVER_ResponseAllocatorDelete(TRITONSERVER_ResponseAllocator* allocator)
 {
@@ -915,6 +1170,10 @@ TRITONSERVER_InferenceTraceActivityString(
       return "TENSOR_BACKEND_INPUT";
     case TRITONSERVER_TRACE_TENSOR_BACKEND_OUTPUT:
       return "TENSOR_BACKEND_OUTPUT";
+    case TRITONSERVER_TRACE_COPY_PEER:
+      return "COPY_PEER";
+    case TRITONSERVER_TRACE_COPY_STAGED:
+      return "COPY_STAGED";
   }
 
   return "<unknown>";
@@ -1060,6 +1319,126 @@ TRITONSERVER_InferenceTraceModelVersion(
 #endif  // TRITON_ENABLE_TRACING
 }
 
+//
+// TRITONSERVER_InferenceTraceCollector
+//
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONSERVER_InferenceTraceCollectorNew(
+    TRITONSERVER_InferenceTraceCollector** collector, uint32_t ring_capacity,
+    uint64_t flush_interval_ms, TRITONSERVER_InferenceTraceBatchFn_t batch_fn,
+    void* userp)
+{
+#ifdef TRITON_ENABLE_TRACING
+  if ((ring_capacity == 0) || (flush_interval_ms == 0) ||
+      (batch_fn == nullptr)) {
+    *collector = nullptr;
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        "trace collector requires a non-zero ring capacity and flush "
+        "interval and a batch callback");
+  }
+  tc::TraceCollector* lcollector =
+      new tc::TraceCollector(ring_capacity, flush_interval_ms, batch_fn, userp);
+  *collector =
+      reinterpret_cast<TRITONSERVER_InferenceTraceCollector*>(lcollector);
+  return nullptr;  // Success
+#else
+  *collector = nullptr;
+  return TRITONSERVER_ErrorNew(
+      TRITONSERVER_ERROR_UNSUPPORTED, "inference tracing not supported");
+#endif  // TRITON_ENABLE_TRACING
+}
+
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONSERVER_InferenceTraceCollectorDelete(
+    TRITONSERVER_InferenceTraceCollector* collector)
+{
+#ifdef TRITON_ENABLE_TRACING
+  tc::TraceCollector* lcollector =
+      reinterpret_cast<tc::TraceCollector*>(collector);
+  delete lcollector;
+  return nullptr;  // Success
+#else
+  return TRITONSERVER_ErrorNew(
+      TRITONSERVER_ERROR_UNSUPPORTED, "inference tracing not supported");
+#endif  // TRITON_ENABLE_TRACING
+}
+
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONSERVER_InferenceTraceCollectorSetTailSampling(
+    TRITONSERVER_InferenceTraceCollector* collector,
+    uint64_t latency_threshold_us, double sample_ratio)
+{
+#ifdef TRITON_ENABLE_TRACING
+  if ((sample_ratio < 0.0) || (sample_ratio > 1.0)) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        "trace sample ratio must be between 0 and 1");
+  }
+  tc::TraceCollector* lcollector =
+      reinterpret_cast<tc::TraceCollector*>(collector);
+  // Saturate so that a threshold too large to convert keeps no trace
+  // by latency rather than wrapping to a small one
+  const uint64_t latency_threshold_ns =
+      (latency_threshold_us > (UINT64_MAX / 1000))
+          ? UINT64_MAX
+          : (latency_threshold_us * 1000);
+  lcollector->SetTailSampling(latency_threshold_ns, sample_ratio);
+  return nullptr;  // Success
+#else
+  return TRITONSERVER_ErrorNew(
+      TRITONSERVER_ERROR_UNSUPPORTED, "inference tracing not supported");
+#endif  // TRITON_ENABLE_TRACING
+}
+
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONSERVER_InferenceTraceCollectorDroppedCount(
+    TRITONSERVER_InferenceTraceCollector* collector, uint64_t* dropped_count)
+{
+#ifdef TRITON_ENABLE_TRACING
+  tc::TraceCollector* lcollector =
+      reinterpret_cast<tc::TraceCollector*>(collector);
+  *dropped_count = lcollector->DroppedCount();
+  return nullptr;  // Success
+#else
+  return TRITONSERVER_ErrorNew(
+      TRITONSERVER_ERROR_UNSUPPORTED, "inference tracing not supported");
+#endif  // TRITON_ENABLE_TRACING
+}
+
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONSERVER_InferenceTraceCollectedNew(
+    TRITONSERVER_InferenceTrace** trace, TRITONSERVER_InferenceTraceLevel level,
+    uint64_t parent_id, TRITONSERVER_InferenceTraceCollector* collector)
+{
+#ifdef TRITON_ENABLE_TRACING
+  if ((level & TRITONSERVER_TRACE_LEVEL_MIN) > 0) {
+    level = static_cast<TRITONSERVER_InferenceTraceLevel>(
+        (level ^ TRITONSERVER_TRACE_LEVEL_MIN) |
+        TRITONSERVER_TRACE_LEVEL_TIMESTAMPS);
+  }
+  if ((level & TRITONSERVER_TRACE_LEVEL_MAX) > 0) {
+    level = static_cast<TRITONSERVER_InferenceTraceLevel>(
+        (level ^ TRITONSERVER_TRACE_LEVEL_MAX) |
+        TRITONSERVER_TRACE_LEVEL_TIMESTAMPS);
+  }
+  if ((level & TRITONSERVER_TRACE_LEVEL_TENSORS) > 0) {
+    *trace = nullptr;
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        "collected traces don't support tensor tracing");
+  }
+  tc::InferenceTrace* ltrace = new tc::InferenceTrace(
+      level, parent_id, reinterpret_cast<tc::TraceCollector*>(collector));
+  *trace = reinterpret_cast<TRITONSERVER_InferenceTrace*>(ltrace);
+  return nullptr;  // Success
+#else
+  *trace = nullptr;
+  return TRITONSERVER_ErrorNew(
+      TRITONSERVER_ERROR_UNSUPPORTED, "inference tracing not supported");
+#endif  // TRITON_ENABLE_TRACING
+}
+
 //
 // TRITONSERVER_ServerOptions
 //
@@ -1179,6 +1558,10 @@ TRITONSERVER_ServerOptionsSetRateLimiterMode(
       loptions->SetRateLimiterMode(tc::RateLimitMode::RL_OFF);
       break;
     }
+    case TRITONSERVER_RATE_LIMIT_GPU_TIME: {
+      loptions->SetRateLimiterMode(tc::RateLimitMode::RL_GPU_TIME);
+      break;
+    }
     default: {
       return TRITONSERVER_ErrorNew(
           TRITONSERVER_ERROR_INVALID_ARG,
@@ -1210,6 +1593,16 @@ TRITONSERVER_ServerOptionsSetPinnedMemoryPoolByteSize(
   return nullptr;  // Success
 }
 
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONSERVER_ServerOptionsSetPinnedMemoryPoolMaxByteSize(
+    TRITONSERVER_ServerOptions* options, uint64_t size)
+{
+  TritonServerOptions* loptions =
+      reinterpret_cast<TritonServerOptions*>(options);
+  loptions->SetPinnedMemoryPoolMaxByteSize(size);
+  return nullptr;  // Success
+}
+
 TRITONAPI_DECLSPEC TRITONSERVER_Error*
 TRITONSERVER_ServerOptionsSetCudaMemoryPoolByteSize(
     TRITONSERVER_ServerOptions* options, int gpu_device, uint64_t size)
@@ -1220,6 +1613,36 @@ TRITONSERVER_ServerOptionsSetCudaMemoryPoolByteSize(
   return nullptr;  // Success
 }
 
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONSERVER_ServerOptionsSetCudaMemoryPoolAsync(
+    TRITONSERVER_ServerOptions* options, bool enable)
+{
+  TritonServerOptions* loptions =
+      reinterpret_cast<TritonServerOptions*>(options);
+  loptions->SetCudaMemoryPoolAsync(enable);
+  return nullptr;  // Success
+}
+
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONSERVER_ServerOptionsSetCudaMemoryPoolReleaseThreshold(
+    TRITONSERVER_ServerOptions* options, int gpu_device, uint64_t size)
+{
+  TritonServerOptions* loptions =
+      reinterpret_cast<TritonServerOptions*>(options);
+  loptions->SetCudaMemoryPoolReleaseThreshold(gpu_device, size);
+  return nullptr;  // Success
+}
+
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONSERVER_ServerOptionsSetCudaMemoryPoolGrowth(
+    TRITONSERVER_ServerOptions* options, bool enable)
+{
+  TritonServerOptions* loptions =
+      reinterpret_cast<TritonServerOptions*>(options);
+  loptions->SetCudaMemoryPoolGrowth(enable);
+  return nullptr;  // Success
+}
+
 // Deprecated. See TRITONSERVER_ServerOptionsSetCacheConfig instead.
 TRITONAPI_DECLSPEC TRITONSERVER_Error*
 TRITONSERVER_ServerOptionsSetResponseCacheByteSize(
@@ -1310,6 +1733,37 @@ TRITONSERVER_ServerOptionsSetModelLoadThreadCount(
   return nullptr;  // Success
 }
 
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONSERVER_ServerOptionsSetModelLoadOnDemand(
+    TRITONSERVER_ServerOptions* options, bool enable)
+{
+  TritonServerOptions* loptions =
+      reinterpret_cast<TritonServerOptions*>(options);
+  loptions->SetModelLoadOnDemand(enable);
+  return nullptr;  // Success
+}
+
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONSERVER_ServerOptionsSetModelIdleUnload(
+    TRITONSERVER_ServerOptions* options, uint64_t idle_timeout_sec,
+    uint64_t byte_size_budget)
+{
+  TritonServerOptions* loptions =
+      reinterpret_cast<TritonServerOptions*>(options);
+  loptions->SetModelIdleUnload(idle_timeout_sec, byte_size_budget);
+  return nullptr;  // Success
+}
+
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONSERVER_ServerOptionsSetMaxQueuedInputByteSize(
+    TRITONSERVER_ServerOptions* options, uint64_t byte_size)
+{
+  TritonServerOptions* loptions =
+      reinterpret_cast<TritonServerOptions*>(options);
+  loptions->SetMaxQueuedInputByteSize(byte_size);
+  return nullptr;  // Success
+}
+
 TRITONAPI_DECLSPEC TRITONSERVER_Error*
 TRITONSERVER_ServerOptionsSetModelNamespacing(
     TRITONSERVER_ServerOptions* options, bool enable_namespace)
@@ -1569,7 +2023,8 @@ TRITONSERVER_InferenceRequestNew(
   tc::InferenceServer* lserver = reinterpret_cast<tc::InferenceServer*>(server);
 
   std::shared_ptr<tc::Model> model;
-  RETURN_IF_STATUS_ERROR(lserver->GetModel(model_name, model_version, &model));
+  RETURN_IF_STATUS_ERROR(
+      lserver->GetInferenceModel(model_name, model_version, &model));
 
   *inference_request = reinterpret_cast<TRITONSERVER_InferenceRequest*>(
       new tc::InferenceRequest(model, model_version));
@@ -1577,6 +2032,47 @@ TRITONSERVER_InferenceRequestNew(
   return nullptr;  // Success
 }
 
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONSERVER_ModelHandleNew(
+    TRITONSERVER_ModelHandle** model_handle, TRITONSERVER_Server* server,
+    const char* model_name, const int64_t model_version)
+{
+  tc::InferenceServer* lserver = reinterpret_cast<tc::InferenceServer*>(server);
+
+  std::shared_ptr<tc::Model> model;
+  RETURN_IF_STATUS_ERROR(
+      lserver->GetInferenceModel(model_name, model_version, &model));
+
+  *model_handle = reinterpret_cast<TRITONSERVER_ModelHandle*>(
+      new TritonServerModelHandle(model, model_version));
+
+  return nullptr;  // Success
+}
+
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONSERVER_ModelHandleDelete(TRITONSERVER_ModelHandle* model_handle)
+{
+  TritonServerModelHandle* lhandle =
+      reinterpret_cast<TritonServerModelHandle*>(model_handle);
+  delete lhandle;
+  return nullptr;  // Success
+}
+
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONSERVER_InferenceRequestNewFromHandle(
+    TRITONSERVER_InferenceRequest** inference_request,
+    TRITONSERVER_ModelHandle* model_handle)
+{
+  TritonServerModelHandle* lhandle =
+      reinterpret_cast<TritonServerModelHandle*>(model_handle);
+
+  *inference_request = reinterpret_cast<TRITONSERVER_InferenceRequest*>(
+      new tc::InferenceRequest(
+          lhandle->Model(), lhandle->RequestedModelVersion()));
+
+  return nullptr;  // Success
+}
+
 TRITONAPI_DECLSPEC TRITONSERVER_Error*
 TRITONSERVER_InferenceRequestDelete(
     TRITONSERVER_InferenceRequest* inference_request)
@@ -1587,6 +2083,26 @@ TRITONSERVER_InferenceRequestDelete(
   return nullptr;  // Success
 }
 
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONSERVER_InferenceRequestReset(
+    TRITONSERVER_InferenceRequest* inference_request)
+{
+  tc::InferenceRequest* lrequest =
+      reinterpret_cast<tc::InferenceRequest*>(inference_request);
+  RETURN_IF_STATUS_ERROR(lrequest->Reset());
+  return nullptr;  // Success
+}
+
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONSERVER_InferenceRequestCancel(
+    TRITONSERVER_InferenceRequest* inference_request)
+{
+  tc::InferenceRequest* lrequest =
+      reinterpret_cast<tc::InferenceRequest*>(inference_request);
+  lrequest->Cancel();
+  return nullptr;  // Success
+}
+
 TRITONAPI_DECLSPEC TRITONSERVER_Error*
 TRITONSERVER_InferenceRequestId(
     TRITONSERVER_InferenceRequest* inference_request, const char** id)
@@ -1836,6 +2352,21 @@ TRITONSERVER_InferenceRequestAppendInputDataWithHostPolicy(
   return nullptr;  // Success
 }
 
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONSERVER_InferenceRequestSetInputHostPolicyReplication(
+    TRITONSERVER_InferenceRequest* inference_request, const char* name,
+    const bool replicate)
+{
+  tc::InferenceRequest* lrequest =
+      reinterpret_cast<tc::InferenceRequest*>(inference_request);
+
+  tc::InferenceRequest::Input* input;
+  RETURN_IF_STATUS_ERROR(lrequest->MutableOriginalInput(name, &input));
+  input->SetReplicateForHostPolicy(replicate);
+
+  return nullptr;  // Success
+}
+
 TRITONAPI_DECLSPEC TRITONSERVER_Error*
 TRITONSERVER_InferenceRequestAppendInputDataWithBufferAttributes(
     TRITONSERVER_InferenceRequest* inference_request, const char* name,
@@ -1854,6 +2385,39 @@ TRITONSERVER_InferenceRequestAppendInputDataWithBufferAttributes(
   return nullptr;  // Success
 }
 
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONSERVER_InferenceRequestAppendInputDataFromCudaIpcHandle(
+    TRITONSERVER_InferenceRequest* inference_request, const char* name,
+    const void* cuda_ipc_handle, size_t byte_offset, size_t byte_size,
+    int64_t memory_type_id)
+{
+  tc::InferenceRequest* lrequest =
+      reinterpret_cast<tc::InferenceRequest*>(inference_request);
+
+  tc::InferenceRequest::Input* input;
+  RETURN_IF_STATUS_ERROR(lrequest->MutableOriginalInput(name, &input));
+  RETURN_IF_STATUS_ERROR(input->AppendDataFromCudaIpcHandle(
+      cuda_ipc_handle, byte_offset, byte_size, memory_type_id));
+
+  return nullptr;  // Success
+}
+
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONSERVER_InferenceRequestAppendInputDataFromBytesOffsets(
+    TRITONSERVER_InferenceRequest* inference_request, const char* name,
+    const char* data, const uint64_t* offsets, uint64_t element_count)
+{
+  tc::InferenceRequest* lrequest =
+      reinterpret_cast<tc::InferenceRequest*>(inference_request);
+
+  tc::InferenceRequest::Input* input;
+  RETURN_IF_STATUS_ERROR(lrequest->MutableOriginalInput(name, &input));
+  RETURN_IF_STATUS_ERROR(
+      input->AppendDataFromBytesOffsets(data, offsets, element_count));
+
+  return nullptr;  // Success
+}
+
 TRITONAPI_DECLSPEC TRITONSERVER_Error*
 TRITONSERVER_InferenceRequestRemoveAllInputData(
     TRITONSERVER_InferenceRequest* inference_request, const char* name)
@@ -1928,6 +2492,27 @@ TRITONSERVER_InferenceRequestSetResponseCallback(
   return nullptr;  // Success
 }
 
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONSERVER_InferenceRequestSetResponseBatchCallback(
+    TRITONSERVER_InferenceRequest* inference_request,
+    TRITONSERVER_ResponseAllocator* response_allocator,
+    void* response_allocator_userp,
+    TRITONSERVER_InferenceResponseBatchCompleteFn_t response_fn,
+    void* response_userp, const uint64_t batch_window_us)
+{
+  tc::InferenceRequest* lrequest =
+      reinterpret_cast<tc::InferenceRequest*>(inference_request);
+  tc::ResponseAllocator* lallocator =
+      reinterpret_cast<tc::ResponseAllocator*>(response_allocator);
+  std::shared_ptr<tc::ResponseBatch> batch =
+      tc::ResponseBatch::Create(response_fn, response_userp, batch_window_us);
+  RETURN_IF_STATUS_ERROR(lrequest->SetResponseCallback(
+      lallocator, response_allocator_userp, tc::ResponseBatch::Complete,
+      batch.get()));
+  lrequest->ResponseFactory()->SetResponseUserpOwner(batch);
+  return nullptr;  // Success
+}
+
 TRITONAPI_DECLSPEC TRITONSERVER_Error*
 TRITONSERVER_InferenceRequestSetStringParameter(
     TRITONSERVER_InferenceRequest* request, const char* name, const char* value)
@@ -1965,7 +2550,7 @@ TRITONSERVER_InferenceResponseDelete(
 {
   tc::InferenceResponse* lresponse =
       reinterpret_cast<tc::InferenceResponse*>(inference_response);
-  delete lresponse;
+  tc::InferenceResponse::Delete(lresponse);
   return nullptr;  // Success
 }
 
@@ -2115,6 +2700,45 @@ TRITONSERVER_InferenceResponseOutputClassificationLabel(
   return nullptr;  // Success
 }
 
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONSERVER_InferenceResponseOutputClassificationTopK(
+    TRITONSERVER_InferenceResponse* inference_response, const uint32_t index,
+    const uint32_t class_count, uint32_t* count, const uint64_t** class_indices,
+    const double** scores, const char* const** labels)
+{
+  tc::InferenceResponse* lresponse =
+      reinterpret_cast<tc::InferenceResponse*>(inference_response);
+
+  const tc::InferenceResponse::Classifications* classifications;
+  RETURN_IF_STATUS_ERROR(
+      lresponse->TopKClassifications(index, class_count, &classifications));
+
+  *count = classifications->indices_.size();
+  *class_indices = classifications->indices_.data();
+  *scores = classifications->scores_.data();
+  *labels = classifications->labels_.data();
+
+  return nullptr;  // Success
+}
+
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONSERVER_InferenceResponseOutputBytesOffsets(
+    TRITONSERVER_InferenceResponse* inference_response, const uint32_t index,
+    uint64_t* element_count, const uint64_t** offsets, const char** data)
+{
+  tc::InferenceResponse* lresponse =
+      reinterpret_cast<tc::InferenceResponse*>(inference_response);
+
+  const tc::ContiguousBytes* bytes;
+  RETURN_IF_STATUS_ERROR(lresponse->ContiguousBytesOutput(index, &bytes));
+
+  *element_count = bytes->offsets_.size() - 1;
+  *offsets = bytes->offsets_.data();
+  *data = bytes->data_.data();
+
+  return nullptr;  // Success
+}
+
 //
 // TRITONSERVER_BufferAttributes
 //
@@ -2249,6 +2873,10 @@ TRITONSERVER_ServerNew(
     tc::Metrics::EnableMetrics();
     tc::Metrics::SetMetricsInterval(loptions->MetricsInterval());
     tc::Metrics::SetConfigMap(loptions->MetricsConfigMap());
+    // ex: --metrics-config=lock_metrics=true
+    if (tc::Metrics::ConfigFlag("lock_metrics")) {
+      tc::Metrics::EnableLockMetrics();
+    }
   }
 #endif  // TRITON_ENABLE_METRICS
 
@@ -2261,7 +2889,13 @@ TRITONSERVER_ServerNew(
   lserver->SetRateLimiterMode(loptions->RateLimiterMode());
   lserver->SetRateLimiterResources(loptions->RateLimiterResources());
   lserver->SetPinnedMemoryPoolByteSize(loptions->PinnedMemoryPoolByteSize());
+  lserver->SetPinnedMemoryPoolMaxByteSize(
+      loptions->PinnedMemoryPoolMaxByteSize());
   lserver->SetCudaMemoryPoolByteSize(loptions->CudaMemoryPoolByteSize());
+  lserver->SetCudaMemoryPoolAsync(loptions->CudaMemoryPoolAsync());
+  lserver->SetCudaMemoryPoolReleaseThreshold(
+      loptions->CudaMemoryPoolReleaseThreshold());
+  lserver->SetCudaMemoryPoolGrowth(loptions->CudaMemoryPoolGrowth());
   bool cache_enabled = !loptions->CacheConfig().empty();
   lserver->SetResponseCacheEnabled(cache_enabled);
   lserver->SetCacheConfig(loptions->CacheConfig());
@@ -2274,6 +2908,11 @@ TRITONSERVER_ServerNew(
   lserver->SetRepoAgentDir(loptions->RepoAgentDir());
   lserver->SetBufferManagerThreadCount(loptions->BufferManagerThreadCount());
   lserver->SetModelLoadThreadCount(loptions->ModelLoadThreadCount());
+  lserver->SetModelLoadOnDemand(loptions->ModelLoadOnDemand());
+  lserver->SetModelIdleUnload(
+      loptions->ModelIdleUnloadTimeout(),
+      loptions->ModelLoadOnDemandByteSize());
+  lserver->SetMaxQueuedInputByteSize(loptions->MaxQueuedInputByteSize());
   lserver->SetModelNamespacingEnabled(loptions->ModelNamespacingEnabled());
 
   // SetBackendCmdlineConfig must be called after all AddBackendConfig calls
@@ -2391,12 +3030,31 @@ TRITONSERVER_ServerNew(
   options_table.InsertRow(std::vector<std::string>{
       "pinned_memory_pool_byte_size",
       std::to_string(lserver->PinnedMemoryPoolByteSize())});
+  if (lserver->PinnedMemoryPoolMaxByteSize() != 0) {
+    options_table.InsertRow(std::vector<std::string>{
+        "pinned_memory_pool_max_byte_size",
+        std::to_string(lserver->PinnedMemoryPoolMaxByteSize())});
+  }
   for (const auto& cuda_memory_pool : lserver->CudaMemoryPoolByteSize()) {
     options_table.InsertRow(std::vector<std::string>{
         "cuda_memory_pool_byte_size{" + std::to_string(cuda_memory_pool.first) +
             "}",
         std::to_string(cuda_memory_pool.second)});
   }
+  options_table.InsertRow(std::vector<std::string>{
+      "cuda_memory_pool_async",
+      std::to_string(lserver->CudaMemoryPoolAsync())});
+  if (lserver->CudaMemoryPoolAsync()) {
+    for (const auto& threshold : lserver->CudaMemoryPoolReleaseThreshold()) {
+      options_table.InsertRow(std::vector<std::string>{
+          "cuda_memory_pool_release_threshold{" +
+              std::to_string(threshold.first) + "}",
+          std::to_string(threshold.second)});
+    }
+    options_table.InsertRow(std::vector<std::string>{
+        "cuda_memory_pool_growth",
+        std::to_string(lserver->CudaMemoryPoolGrowth())});
+  }
 
   std::stringstream compute_capability_ss;
   compute_capability_ss.setf(std::ios::fixed);
@@ -2511,6 +3169,21 @@ TRITONSERVER_ServerPollModelRepository(TRITONSERVER_Server* server)
   return nullptr;  // Success
 }
 
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONSERVER_ServerRegisterHostMemory(
+    TRITONSERVER_Server* server, void* base, size_t byte_size)
+{
+  RETURN_IF_STATUS_ERROR(tc::HostMemoryRegistry::Register(base, byte_size));
+  return nullptr;  // Success
+}
+
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONSERVER_ServerUnregisterHostMemory(TRITONSERVER_Server* server, void* base)
+{
+  RETURN_IF_STATUS_ERROR(tc::HostMemoryRegistry::Unregister(base));
+  return nullptr;  // Success
+}
+
 TRITONAPI_DECLSPEC TRITONSERVER_Error*
 TRITONSERVER_ServerIsLive(TRITONSERVER_Server* server, bool* live)
 {
@@ -2633,12 +3306,89 @@ TRITONSERVER_ServerModelMetadata(
   RETURN_IF_STATUS_ERROR(
       lserver->ModelReadyVersions(model_name, &ready_versions));
 
+  // The platform and inputs/outputs only depend on the model config, so
+  // they are serialized once and cached in the model. The versions
+  // depend on the requested version and on the model repository.
+  std::string io_metadata_json;
+  if (!model->LookUpSerialized("metadata", 0 /* stamp */, &io_metadata_json)) {
+    triton::common::TritonJson::Value io_doc(
+        triton::common::TritonJson::ValueType::OBJECT);
+    const auto& model_config = model->Config();
+    if (!model_config.platform().empty()) {
+      RETURN_IF_STATUS_ERROR(
+          io_doc.AddStringRef("platform", model_config.platform().c_str()));
+    } else {
+      RETURN_IF_STATUS_ERROR(
+          io_doc.AddStringRef("platform", model_config.backend().c_str()));
+    }
+
+    triton::common::TritonJson::Value inputs(
+        io_doc, triton::common::TritonJson::ValueType::ARRAY);
+    for (const auto& io : model_config.input()) {
+      triton::common::TritonJson::Value io_metadata(
+          io_doc, triton::common::TritonJson::ValueType::OBJECT);
+      RETURN_IF_STATUS_ERROR(
+          io_metadata.AddStringRef("name", io.name().c_str()));
+      RETURN_IF_STATUS_ERROR(io_metadata.AddStringRef(
+          "datatype",
+          triton::common::DataTypeToProtocolString(io.data_type())));
+
+      // Input shape. If the model supports batching then must include
+      // '-1' for the batch dimension.
+      triton::common::TritonJson::Value io_metadata_shape(
+          io_doc, triton::common::TritonJson::ValueType::ARRAY);
+      if (model_config.max_batch_size() >= 1) {
+        RETURN_IF_STATUS_ERROR(io_metadata_shape.AppendInt(-1));
+      }
+      for (const auto d : io.dims()) {
+        RETURN_IF_STATUS_ERROR(io_metadata_shape.AppendInt(d));
+      }
+      RETURN_IF_STATUS_ERROR(
+          io_metadata.Add("shape", std::move(io_metadata_shape)));
+
+      RETURN_IF_STATUS_ERROR(inputs.Append(std::move(io_metadata)));
+    }
+    RETURN_IF_STATUS_ERROR(io_doc.Add("inputs", std::move(inputs)));
+
+    triton::common::TritonJson::Value outputs(
+        io_doc, triton::common::TritonJson::ValueType::ARRAY);
+    for (const auto& io : model_config.output()) {
+      triton::common::TritonJson::Value io_metadata(
+          io_doc, triton::common::TritonJson::ValueType::OBJECT);
+      RETURN_IF_STATUS_ERROR(
+          io_metadata.AddStringRef("name", io.name().c_str()));
+      RETURN_IF_STATUS_ERROR(io_metadata.AddStringRef(
+          "datatype",
+          triton::common::DataTypeToProtocolString(io.data_type())));
+
+      // Output shape. If the model supports batching then must include
+      // '-1' for the batch dimension.
+      triton::common::TritonJson::Value io_metadata_shape(
+          io_doc, triton::common::TritonJson::ValueType::ARRAY);
+      if (model_config.max_batch_size() >= 1) {
+        RETURN_IF_STATUS_ERROR(io_metadata_shape.AppendInt(-1));
+      }
+      for (const auto d : io.dims()) {
+        RETURN_IF_STATUS_ERROR(io_metadata_shape.AppendInt(d));
+      }
+      RETURN_IF_STATUS_ERROR(
+          io_metadata.Add("shape", std::move(io_metadata_shape)));
+
+      RETURN_IF_STATUS_ERROR(outputs.Append(std::move(io_metadata)));
+    }
+    RETURN_IF_STATUS_ERROR(io_doc.Add("outputs", std::move(outputs)));
+
+    triton::common::TritonJson::WriteBuffer buffer;
+    RETURN_IF_STATUS_ERROR(io_doc.Write(&buffer));
+    io_metadata_json = std::move(buffer.MutableContents());
+    model->CacheSerialized("metadata", 0 /* stamp */, io_metadata_json);
+  }
+
   triton::common::TritonJson::Value metadata(
       triton::common::TritonJson::ValueType::OBJECT);
 
-  // Can use string ref in this function even though model can be
-  // unloaded and config becomes invalid, because TritonServeMessage
-  // serializes the json when it is constructed below.
+  // Can use string ref in this function because the json is serialized
+  // below.
   RETURN_IF_STATUS_ERROR(metadata.AddStringRef("name", model_name));
 
   triton::common::TritonJson::Value versions(
@@ -2655,69 +3405,16 @@ TRITONSERVER_ServerModelMetadata(
 
   RETURN_IF_STATUS_ERROR(metadata.Add("versions", std::move(versions)));
 
-  const auto& model_config = model->Config();
-  if (!model_config.platform().empty()) {
-    RETURN_IF_STATUS_ERROR(
-        metadata.AddStringRef("platform", model_config.platform().c_str()));
-  } else {
-    RETURN_IF_STATUS_ERROR(
-        metadata.AddStringRef("platform", model_config.backend().c_str()));
-  }
-
-  triton::common::TritonJson::Value inputs(
-      metadata, triton::common::TritonJson::ValueType::ARRAY);
-  for (const auto& io : model_config.input()) {
-    triton::common::TritonJson::Value io_metadata(
-        metadata, triton::common::TritonJson::ValueType::OBJECT);
-    RETURN_IF_STATUS_ERROR(io_metadata.AddStringRef("name", io.name().c_str()));
-    RETURN_IF_STATUS_ERROR(io_metadata.AddStringRef(
-        "datatype", triton::common::DataTypeToProtocolString(io.data_type())));
-
-    // Input shape. If the model supports batching then must include
-    // '-1' for the batch dimension.
-    triton::common::TritonJson::Value io_metadata_shape(
-        metadata, triton::common::TritonJson::ValueType::ARRAY);
-    if (model_config.max_batch_size() >= 1) {
-      RETURN_IF_STATUS_ERROR(io_metadata_shape.AppendInt(-1));
-    }
-    for (const auto d : io.dims()) {
-      RETURN_IF_STATUS_ERROR(io_metadata_shape.AppendInt(d));
-    }
-    RETURN_IF_STATUS_ERROR(
-        io_metadata.Add("shape", std::move(io_metadata_shape)));
-
-    RETURN_IF_STATUS_ERROR(inputs.Append(std::move(io_metadata)));
-  }
-  RETURN_IF_STATUS_ERROR(metadata.Add("inputs", std::move(inputs)));
-
-  triton::common::TritonJson::Value outputs(
-      metadata, triton::common::TritonJson::ValueType::ARRAY);
-  for (const auto& io : model_config.output()) {
-    triton::common::TritonJson::Value io_metadata(
-        metadata, triton::common::TritonJson::ValueType::OBJECT);
-    RETURN_IF_STATUS_ERROR(io_metadata.AddStringRef("name", io.name().c_str()));
-    RETURN_IF_STATUS_ERROR(io_metadata.AddStringRef(
-        "datatype", triton::common::DataTypeToProtocolString(io.data_type())));
-
-    // Output shape. If the model supports batching then must include
-    // '-1' for the batch dimension.
-    triton::common::TritonJson::Value io_metadata_shape(
-        metadata, triton::common::TritonJson::ValueType::ARRAY);
-    if (model_config.max_batch_size() >= 1) {
-      RETURN_IF_STATUS_ERROR(io_metadata_shape.AppendInt(-1));
-    }
-    for (const auto d : io.dims()) {
-      RETURN_IF_STATUS_ERROR(io_metadata_shape.AppendInt(d));
-    }
-    RETURN_IF_STATUS_ERROR(
-        io_metadata.Add("shape", std::move(io_metadata_shape)));
-
-    RETURN_IF_STATUS_ERROR(outputs.Append(std::move(io_metadata)));
-  }
-  RETURN_IF_STATUS_ERROR(metadata.Add("outputs", std::move(outputs)));
+  // Join the two objects, both have members so replace the closing
+  // brace of the first and the opening brace of the second by a comma.
+  triton::common::TritonJson::WriteBuffer buffer;
+  RETURN_IF_STATUS_ERROR(metadata.Write(&buffer));
+  std::string metadata_json = std::move(buffer.MutableContents());
+  metadata_json.back() = ',';
+  metadata_json.append(io_metadata_json, 1, std::string::npos);
 
   *model_metadata = reinterpret_cast<TRITONSERVER_Message*>(
-      new tc::TritonServerMessage(metadata));
+      new tc::TritonServerMessage(std::move(metadata_json)));
   return nullptr;  // success
 }
 
@@ -2774,119 +3471,40 @@ TRITONSERVER_ServerModelStatistics(
     }
   }
 
-  // Can use string ref in this function because TritonServeMessage
-  // serializes the json when it is constructed below.
-  triton::common::TritonJson::Value metadata(
-      triton::common::TritonJson::ValueType::OBJECT);
-
-  triton::common::TritonJson::Value model_stats_json(
-      metadata, triton::common::TritonJson::ValueType::ARRAY);
+  // The statistics of each model are serialized separately and cached
+  // in the model until they are updated again, so polling the
+  // statistics of idle models doesn't rebuild them.
+  std::string model_stats_json = "{\"model_stats\":[";
+  bool first_model = true;
   for (const auto& mv_pair : ready_model_versions) {
     for (const auto& version : mv_pair.second) {
       std::shared_ptr<tc::Model> model;
       RETURN_IF_STATUS_ERROR(lserver->GetModel(mv_pair.first, version, &model));
 
-      // Add memory usage
-      triton::common::TritonJson::Value memory_usage(
-          metadata, triton::common::TritonJson::ValueType::ARRAY);
-      const std::vector<tc::BufferAttributes>& usages =
-          model->AccumulatedMemoryUsage();
-      for (const auto& usage : usages) {
-        triton::common::TritonJson::Value usage_json(
-            metadata, triton::common::TritonJson::ValueType::OBJECT);
-        std::string type = TRITONSERVER_MemoryTypeString(usage.MemoryType());
-        RETURN_IF_STATUS_ERROR(usage_json.AddString("type", std::move(type)));
-        RETURN_IF_STATUS_ERROR(usage_json.AddInt("id", usage.MemoryTypeId()));
-        RETURN_IF_STATUS_ERROR(
-            usage_json.AddUInt("byte_size", usage.ByteSize()));
-        RETURN_IF_STATUS_ERROR(memory_usage.Append(std::move(usage_json)));
+      // Read the stamp first so that an update made while serializing
+      // invalidates the cached statistics.
+      const uint64_t stamp = model->StatsAggregator().UpdateCount();
+      std::string model_stat_json;
+      if (!model->LookUpSerialized("statistics", stamp, &model_stat_json)) {
+        TRITONSERVER_Error* err = SerializeModelStatistics(
+            *model, mv_pair.first, version, &model_stat_json);
+        if (err != nullptr) {
+          return err;
+        }
+        model->CacheSerialized("statistics", stamp, model_stat_json);
       }
 
-      // Add infer statistic
-      const auto& infer_stats = model->StatsAggregator().ImmutableInferStats();
-      const auto& infer_batch_stats =
-          model->StatsAggregator().ImmutableInferBatchStats();
-
-      triton::common::TritonJson::Value inference_stats(
-          metadata, triton::common::TritonJson::ValueType::OBJECT);
-      // Compute figures only calculated when not going through cache, so
-      // subtract cache_hit count from success count. Cache hit count will
-      // simply be 0 when cache is disabled.
-      uint64_t compute_count =
-          infer_stats.success_count_ - infer_stats.cache_hit_count_;
-      SetDurationStat(
-          metadata, inference_stats, "success", infer_stats.success_count_,
-          infer_stats.request_duration_ns_);
-      SetDurationStat(
-          metadata, inference_stats, "fail", infer_stats.failure_count_,
-          infer_stats.failure_duration_ns_);
-      SetDurationStat(
-          metadata, inference_stats, "queue", infer_stats.success_count_,
-          infer_stats.queue_duration_ns_);
-      SetDurationStat(
-          metadata, inference_stats, "compute_input", compute_count,
-          infer_stats.compute_input_duration_ns_);
-      SetDurationStat(
-          metadata, inference_stats, "compute_infer", compute_count,
-          infer_stats.compute_infer_duration_ns_);
-      SetDurationStat(
-          metadata, inference_stats, "compute_output", compute_count,
-          infer_stats.compute_output_duration_ns_);
-      SetDurationStat(
-          metadata, inference_stats, "cache_hit", infer_stats.cache_hit_count_,
-          infer_stats.cache_hit_duration_ns_);
-      // NOTE: cache_miss_count_ should equal compute_count if non-zero
-      SetDurationStat(
-          metadata, inference_stats, "cache_miss",
-          infer_stats.cache_miss_count_, infer_stats.cache_miss_duration_ns_);
-
-      triton::common::TritonJson::Value batch_stats(
-          metadata, triton::common::TritonJson::ValueType::ARRAY);
-      for (const auto& batch : infer_batch_stats) {
-        triton::common::TritonJson::Value batch_stat(
-            metadata, triton::common::TritonJson::ValueType::OBJECT);
-        RETURN_IF_STATUS_ERROR(batch_stat.AddUInt("batch_size", batch.first));
-        SetDurationStat(
-            metadata, batch_stat, "compute_input", batch.second.count_,
-            batch.second.compute_input_duration_ns_);
-        SetDurationStat(
-            metadata, batch_stat, "compute_infer", batch.second.count_,
-            batch.second.compute_infer_duration_ns_);
-        SetDurationStat(
-            metadata, batch_stat, "compute_output", batch.second.count_,
-            batch.second.compute_output_duration_ns_);
-        RETURN_IF_STATUS_ERROR(batch_stats.Append(std::move(batch_stat)));
+      if (!first_model) {
+        model_stats_json.push_back(',');
       }
-
-      triton::common::TritonJson::Value model_stat(
-          metadata, triton::common::TritonJson::ValueType::OBJECT);
-      RETURN_IF_STATUS_ERROR(
-          model_stat.AddStringRef("name", mv_pair.first.c_str()));
-      RETURN_IF_STATUS_ERROR(
-          model_stat.AddString("version", std::move(std::to_string(version))));
-
-      RETURN_IF_STATUS_ERROR(model_stat.AddUInt(
-          "last_inference", model->StatsAggregator().LastInferenceMs()));
-      RETURN_IF_STATUS_ERROR(model_stat.AddUInt(
-          "inference_count", model->StatsAggregator().InferenceCount()));
-      RETURN_IF_STATUS_ERROR(model_stat.AddUInt(
-          "execution_count", model->StatsAggregator().ExecutionCount()));
-
-      RETURN_IF_STATUS_ERROR(
-          model_stat.Add("inference_stats", std::move(inference_stats)));
-      RETURN_IF_STATUS_ERROR(
-          model_stat.Add("batch_stats", std::move(batch_stats)));
-      RETURN_IF_STATUS_ERROR(
-          model_stat.Add("memory_usage", std::move(memory_usage)));
-
-      RETURN_IF_STATUS_ERROR(model_stats_json.Append(std::move(model_stat)));
+      first_model = false;
+      model_stats_json.append(model_stat_json);
     }
   }
+  model_stats_json.append("]}");
 
-  RETURN_IF_STATUS_ERROR(
-      metadata.Add("model_stats", std::move(model_stats_json)));
   *model_stats = reinterpret_cast<TRITONSERVER_Message*>(
-      new tc::TritonServerMessage(metadata));
+      new tc::TritonServerMessage(std::move(model_stats_json)));
 
   return nullptr;  // success
 
@@ -2904,9 +3522,15 @@ TRITONSERVER_ServerModelConfig(
   std::shared_ptr<tc::Model> model;
   RETURN_IF_STATUS_ERROR(lserver->GetModel(model_name, model_version, &model));
 
+  // The serialized config is cached in the model until the config
+  // changes.
+  const std::string key = "config:" + std::to_string(config_version);
   std::string model_config_json;
-  RETURN_IF_STATUS_ERROR(tc::ModelConfigToJson(
-      model->Config(), config_version, &model_config_json));
+  if (!model->LookUpSerialized(key, 0 /* stamp */, &model_config_json)) {
+    RETURN_IF_STATUS_ERROR(tc::ModelConfigToJson(
+        model->Config(), config_version, &model_config_json));
+    model->CacheSerialized(key, 0 /* stamp */, model_config_json);
+  }
 
   *model_config = reinterpret_cast<TRITONSERVER_Message*>(
       new tc::TritonServerMessage(std::move(model_config_json)));
@@ -2926,34 +3550,31 @@ TRITONSERVER_ServerModelIndex(
   std::vector<tc::ModelRepositoryManager::ModelIndex> index;
   RETURN_IF_STATUS_ERROR(lserver->RepositoryIndex(ready_only, &index));
 
-  // Can use string ref in this function because TritonServerMessage
-  // serializes the json when it is constructed below.
-  triton::common::TritonJson::Value repository_index_json(
-      triton::common::TritonJson::ValueType::ARRAY);
-
+  std::string repository_index_json;
+  tc::JsonWriter writer(&repository_index_json);
+  writer.BeginArray();
   for (const auto& in : index) {
-    triton::common::TritonJson::Value model_index(
-        repository_index_json, triton::common::TritonJson::ValueType::OBJECT);
-    RETURN_IF_STATUS_ERROR(model_index.AddStringRef("name", in.name_.c_str()));
+    writer.BeginObject();
+    writer.Key("name");
+    writer.String(in.name_);
     if (!in.name_only_) {
       if (in.version_ >= 0) {
-        RETURN_IF_STATUS_ERROR(model_index.AddString(
-            "version", std::move(std::to_string(in.version_))));
+        writer.Key("version");
+        writer.String(std::to_string(in.version_));
       }
-      RETURN_IF_STATUS_ERROR(model_index.AddStringRef(
-          "state", tc::ModelReadyStateString(in.state_).c_str()));
+      writer.Key("state");
+      writer.String(tc::ModelReadyStateString(in.state_));
       if (!in.reason_.empty()) {
-        RETURN_IF_STATUS_ERROR(
-            model_index.AddStringRef("reason", in.reason_.c_str()));
+        writer.Key("reason");
+        writer.String(in.reason_);
       }
     }
-
-    RETURN_IF_STATUS_ERROR(
-        repository_index_json.Append(std::move(model_index)));
+    writer.EndObject();
   }
+  writer.EndArray();
 
   *repository_index = reinterpret_cast<TRITONSERVER_Message*>(
-      new tc::TritonServerMessage(repository_index_json));
+      new tc::TritonServerMessage(std::move(repository_index_json)));
 
   return nullptr;  // success
 }
@@ -3091,6 +3712,62 @@ TRITONSERVER_ServerInferAsync(
   return nullptr;  // Success
 }
 
+TRITONAPI_DECLSPEC TRITONSERVER_Error*
+TRITONSERVER_ServerInferAsyncBatch(
+    TRITONSERVER_Server* server,
+    TRITONSERVER_InferenceRequest** inference_requests,
+    const uint32_t request_count, TRITONSERVER_InferenceTrace** traces)
+{
+  tc::InferenceServer* lserver = reinterpret_cast<tc::InferenceServer*>(server);
+
+  // Attach the traces first so that they are released like with
+  // TRITONSERVER_ServerInferAsync if the batch is rejected.
+  std::vector<std::unique_ptr<tc::InferenceRequest>> ureqs;
+  ureqs.reserve(request_count);
+  tc::Status status;
+  for (uint32_t i = 0; i < request_count; ++i) {
+    tc::InferenceRequest* lrequest =
+        reinterpret_cast<tc::InferenceRequest*>(inference_requests[i]);
+    ureqs.emplace_back(lrequest);
+    if ((traces != nullptr) && (traces[i] != nullptr)) {
+#ifdef TRITON_ENABLE_TRACING
+      tc::InferenceTrace* ltrace =
+          reinterpret_cast<tc::InferenceTrace*>(traces[i]);
+      ltrace->SetModelName(lrequest->ModelName());
+      ltrace->SetModelVersion(lrequest->ActualModelVersion());
+      ltrace->SetRequestId(lrequest->Id());
+
+      lrequest->SetTrace(std::make_shared<tc::InferenceTraceProxy>(ltrace));
+#else
+      status = tc::Status(
+          tc::Status::Code::UNSUPPORTED, "inference tracing not supported");
+#endif  // TRITON_ENABLE_TRACING
+    }
+  }
+
+  for (size_t i = 0; status.IsOk() && (i < ureqs.size()); ++i) {
+    status = ureqs[i]->PrepareForInference();
+  }
+
+  // Run inference...
+  if (status.IsOk()) {
+    status = lserver->InferAsyncBatch(ureqs);
+  }
+
+  // If there is an error then the caller retains ownership of all
+  // requests, so release them from the unique_ptrs after releasing the
+  // traces attached above. On success 'ureqs' is already empty.
+  for (auto& ureq : ureqs) {
+#ifdef TRITON_ENABLE_TRACING
+    ureq->ReleaseTrace();
+#endif  // TRITON_ENABLE_TRACING
+    ureq.release();
+  }
+
+  RETURN_IF_STATUS_ERROR(status);
+  return nullptr;  // Success
+}
+
 //
 // TRITONSERVER_MetricFamily
 //
@@ -82,6 +82,10 @@ TRITONSERVER_LogMessage()
 {
 }
 TRITONAPI_DECLSPEC void
+TRITONSERVER_ProfilingSetEnabled()
+{
+}
+TRITONAPI_DECLSPEC void
 TRITONSERVER_ErrorNew()
 {
 }
@@ -110,6 +114,14 @@ TRITONSERVER_ResponseAllocatorSetQueryFunction()
 {
 }
 TRITONAPI_DECLSPEC void
+TRITONSERVER_ResponseAllocatorSetBorrowBuffers()
+{
+}
+TRITONAPI_DECLSPEC void
+TRITONSERVER_ResponseAllocatorSetQueryStable()
+{
+}
+TRITONAPI_DECLSPEC void
 TRITONSERVER_ResponseAllocatorSetBufferAttributesFunction()
 {
 }
@@ -178,14 +190,54 @@ TRITONSERVER_InferenceTraceRequestId()
 {
 }
 TRITONAPI_DECLSPEC void
+TRITONSERVER_InferenceTraceCollectorNew()
+{
+}
+TRITONAPI_DECLSPEC void
+TRITONSERVER_InferenceTraceCollectorDelete()
+{
+}
+TRITONAPI_DECLSPEC void
+TRITONSERVER_InferenceTraceCollectorSetTailSampling()
+{
+}
+TRITONAPI_DECLSPEC void
+TRITONSERVER_InferenceTraceCollectorDroppedCount()
+{
+}
+TRITONAPI_DECLSPEC void
+TRITONSERVER_InferenceTraceCollectedNew()
+{
+}
+TRITONAPI_DECLSPEC void
 TRITONSERVER_InferenceRequestNew()
 {
 }
 TRITONAPI_DECLSPEC void
+TRITONSERVER_ModelHandleNew()
+{
+}
+TRITONAPI_DECLSPEC void
+TRITONSERVER_ModelHandleDelete()
+{
+}
+TRITONAPI_DECLSPEC void
+TRITONSERVER_InferenceRequestNewFromHandle()
+{
+}
+TRITONAPI_DECLSPEC void
 TRITONSERVER_InferenceRequestDelete()
 {
 }
 TRITONAPI_DECLSPEC void
+TRITONSERVER_InferenceRequestReset()
+{
+}
+TRITONAPI_DECLSPEC void
+TRITONSERVER_InferenceRequestCancel()
+{
+}
+TRITONAPI_DECLSPEC void
 TRITONSERVER_InferenceRequestId()
 {
 }
@@ -266,6 +318,10 @@ TRITONSERVER_InferenceRequestAppendInputDataWithHostPolicy()
 {
 }
 TRITONAPI_DECLSPEC void
+TRITONSERVER_InferenceRequestSetInputHostPolicyReplication()
+{
+}
+TRITONAPI_DECLSPEC void
 TRITONSERVER_InferenceRequestRemoveAllInputData()
 {
 }
@@ -290,6 +346,10 @@ TRITONSERVER_InferenceRequestSetResponseCallback()
 {
 }
 TRITONAPI_DECLSPEC void
+TRITONSERVER_InferenceRequestSetResponseBatchCallback()
+{
+}
+TRITONAPI_DECLSPEC void
 TRITONSERVER_InferenceResponseDelete()
 {
 }
@@ -326,6 +386,14 @@ TRITONSERVER_InferenceResponseOutputClassificationLabel()
 {
 }
 TRITONAPI_DECLSPEC void
+TRITONSERVER_InferenceResponseOutputClassificationTopK()
+{
+}
+TRITONAPI_DECLSPEC void
+TRITONSERVER_InferenceResponseOutputBytesOffsets()
+{
+}
+TRITONAPI_DECLSPEC void
 TRITONSERVER_ServerOptionsNew()
 {
 }
@@ -366,9 +434,25 @@ TRITONSERVER_ServerOptionsSetPinnedMemoryPoolByteSize()
 {
 }
 TRITONAPI_DECLSPEC void
+TRITONSERVER_ServerOptionsSetPinnedMemoryPoolMaxByteSize()
+{
+}
+TRITONAPI_DECLSPEC void
 TRITONSERVER_ServerOptionsSetCudaMemoryPoolByteSize()
 {
 }
+TRITONAPI_DECLSPEC void
+TRITONSERVER_ServerOptionsSetCudaMemoryPoolAsync()
+{
+}
+TRITONAPI_DECLSPEC void
+TRITONSERVER_ServerOptionsSetCudaMemoryPoolReleaseThreshold()
+{
+}
+TRITONAPI_DECLSPEC void
+TRITONSERVER_ServerOptionsSetCudaMemoryPoolGrowth()
+{
+}
 // Deprecated. See TRITONSERVER_ServerOptionsSetCacheConfig instead.
 TRITONAPI_DECLSPEC void
 TRITONSERVER_ServerOptionsSetResponseCacheByteSize()
@@ -407,6 +491,18 @@ TRITONSERVER_ServerOptionsSetModelLoadThreadCount()
 {
 }
 TRITONAPI_DECLSPEC void
+TRITONSERVER_ServerOptionsSetModelLoadOnDemand()
+{
+}
+TRITONAPI_DECLSPEC void
+TRITONSERVER_ServerOptionsSetModelIdleUnload()
+{
+}
+TRITONAPI_DECLSPEC void
+TRITONSERVER_ServerOptionsSetMaxQueuedInputByteSize()
+{
+}
+TRITONAPI_DECLSPEC void
 TRITONSERVER_ServerOptionsSetModelNamespacing()
 {
 }
@@ -475,6 +571,14 @@ TRITONSERVER_InferenceRequestAppendInputDataWithBufferAttributes()
 {
 }
 TRITONAPI_DECLSPEC void
+TRITONSERVER_InferenceRequestAppendInputDataFromCudaIpcHandle()
+{
+}
+TRITONAPI_DECLSPEC void
+TRITONSERVER_InferenceRequestAppendInputDataFromBytesOffsets()
+{
+}
+TRITONAPI_DECLSPEC void
 TRITONSERVER_BufferAttributesNew()
 {
 }
@@ -531,6 +635,14 @@ TRITONSERVER_ServerPollModelRepository()
 {
 }
 TRITONAPI_DECLSPEC void
+TRITONSERVER_ServerRegisterHostMemory()
+{
+}
+TRITONAPI_DECLSPEC void
+TRITONSERVER_ServerUnregisterHostMemory()
+{
+}
+TRITONAPI_DECLSPEC void
 TRITONSERVER_ServerIsLive()
 {
 }
@@ -603,6 +715,10 @@ TRITONSERVER_ServerInferAsync()
 {
 }
 TRITONAPI_DECLSPEC void
+TRITONSERVER_ServerInferAsyncBatch()
+{
+}
+TRITONAPI_DECLSPEC void
 TRITONBACKEND_ApiVersion()
 {
 }
@@ -615,6 +731,10 @@ TRITONBACKEND_MemoryManagerFree()
 {
 }
 TRITONAPI_DECLSPEC void
+TRITONBACKEND_MemoryManagerCopyBatch()
+{
+}
+TRITONAPI_DECLSPEC void
 TRITONBACKEND_InputProperties()
 {
 }
@@ -639,6 +759,10 @@ TRITONBACKEND_OutputBuffer()
 {
 }
 TRITONAPI_DECLSPEC void
+TRITONBACKEND_OutputBufferBatch()
+{
+}
+TRITONAPI_DECLSPEC void
 TRITONBACKEND_OutputBufferAttributes()
 {
 }
@@ -659,6 +783,14 @@ TRITONBACKEND_RequestFlags()
 {
 }
 TRITONAPI_DECLSPEC void
+TRITONBACKEND_RequestIsCancelled()
+{
+}
+TRITONAPI_DECLSPEC void
+TRITONBACKEND_RequestIsWarmup()
+{
+}
+TRITONAPI_DECLSPEC void
 TRITONBACKEND_RequestInputCount()
 {
 }
@@ -675,6 +807,10 @@ TRITONBACKEND_RequestInputByIndex()
 {
 }
 TRITONAPI_DECLSPEC void
+TRITONBACKEND_RequestsInputBatch()
+{
+}
+TRITONAPI_DECLSPEC void
 TRITONBACKEND_RequestOutputCount()
 {
 }
@@ -815,6 +951,22 @@ TRITONBACKEND_ModelRepository()
 {
 }
 TRITONAPI_DECLSPEC void
+TRITONBACKEND_ModelRepositoryFileSize()
+{
+}
+TRITONAPI_DECLSPEC void
+TRITONBACKEND_ModelRepositoryReadRange()
+{
+}
+TRITONAPI_DECLSPEC void
+TRITONBACKEND_ModelRepositoryMapFile()
+{
+}
+TRITONAPI_DECLSPEC void
+TRITONBACKEND_ModelRepositoryUnmapFile()
+{
+}
+TRITONAPI_DECLSPEC void
 TRITONBACKEND_ModelConfig()
 {
 }
@@ -925,6 +1077,11 @@ TRITONREPOAGENT_ModelRepositoryLocationRelease()
 {
 }
 
+TRITONAPI_DECLSPEC void
+TRITONREPOAGENT_ModelRepositoryVisitFiles()
+{
+}
+
 TRITONAPI_DECLSPEC void
 TRITONREPOAGENT_ModelRepositoryUpdate()
 {
@@ -1025,11 +1182,26 @@ TRITONCACHE_CacheEntryBufferCount()
 {
 }
 
+TRITONAPI_DECLSPEC void
+TRITONCACHE_CacheEntryByteSize()
+{
+}
+
+TRITONAPI_DECLSPEC void
+TRITONCACHE_CacheEntryComputeCost()
+{
+}
+
 TRITONAPI_DECLSPEC void
 TRITONCACHE_CacheEntryAddBuffer()
 {
 }
 
+TRITONAPI_DECLSPEC void
+TRITONCACHE_CacheEntryAddSharedBuffer()
+{
+}
+
 TRITONAPI_DECLSPEC void
 TRITONCACHE_CacheEntryGetBuffer()
 {
@@ -1060,6 +1232,11 @@ TRITONCACHE_CacheLookup()
 {
 }
 
+TRITONAPI_DECLSPEC void
+TRITONCACHE_CacheBatchLookup()
+{
+}
+
 TRITONAPI_DECLSPEC void
 TRITONCACHE_Copy()
 {